@@ -13,8 +13,6 @@ REGEX_INCLUDE = '\s*#include ((<[^>]+>)|("[^"]+"))'#https://stackoverflow.com/qu
 REGEX_COMMENTS = '//.*?\n|/\*.*?\*/'
 
 # Ask Ramon how he would like these dealt with
-DEFINE_SEARCH_METHOD_REGEX = '#define SEARCH_METHOD [1-9]'
-DEFINE_RADIX_BITS_REGEX = '#define RADIX_BITS [1-9]'
 DEFINE_PRINT_ERRORS_REGEX = '#define PRINT_ERRORS'
 
 # DIRECTORIES
@@ -141,7 +139,7 @@ def retrieve_pattern_from_source(source, pattern):
     result = re.findall(pattern, source)
     return set([f"#include {match[0]}" for match in result])
 
-def remove_pattern_from_source(source, pattern):
+def remove_pattern_from_source(source, pattern, keep=set()):
     '''
     Removes all #include statements from a C or C++ source file content.
 
@@ -149,11 +147,24 @@ def remove_pattern_from_source(source, pattern):
     The function is intended to be used with source code from .c or .h files.
 
     :param source: The source code string from which #include statements are to be removed. This should be the content of a .c or .h file as a string.
+    :param keep: A set of #include statements that are left in place, such as platform headers that sit inside preprocessor guards.
 
     :return: A string representing the source code with all #include statements removed. If no #include statements are found, the original source string is returned unchanged.
     '''
     
-    return re.sub(pattern, " ", source)
+    return re.sub(pattern, lambda match: match.group(0) if f"#include {match.group(1)}" in keep else " ", source)
+
+def retrieve_platform_lib(c_stand, incoming_lib):
+    '''
+    Finds the angle-bracketed headers that are not part of the Standard C Library (e.g., #include <sys/mman.h>).
+
+    These headers are platform specific and are usually included inside preprocessor guards, so they are left where they are instead of being hoisted to the top of the amalgamation.
+
+    :param incoming_lib: A set of strings representing the library headers included by a file.
+
+    :return: A set of strings representing the angle-bracketed headers from incoming_lib that are not part of the standard C library.
+    '''
+    return set([lib for lib in incoming_lib if '<' in lib and lib not in c_stand])
 
 def check_against_standard_library(c_stand, incoming_lib, amalg_c_stand_lib):
     '''
@@ -457,10 +468,12 @@ class FileNode():
         original = read_file(file_dir)
         # retrieve included libraries
         includes = retrieve_pattern_from_source(original, REGEX_INCLUDE)
+        # platform headers stay in place
+        platform_includes = retrieve_platform_lib(c_stand, includes)
         # find local dependencies
-        self.header_dep = check_against_standard_library(c_stand, includes, self.c_stand_dep)
+        self.header_dep = check_against_standard_library(c_stand, includes - platform_includes, self.c_stand_dep)
         # remove includes and assign source
-        self.contents = remove_pattern_from_source(original, REGEX_INCLUDE)
+        self.contents = remove_pattern_from_source(original, REGEX_INCLUDE, platform_includes)
         # format local dependencies
         self.header_dep = format_external_lib(self.header_dep)
 
@@ -0,0 +1,558 @@
+/******************************************************************************/
+/**
+ * @file        benchmark.c
+ * @author      EmbedDB Team (See Authors.md)
+ * @brief       Benchmark driver that loads the bundled data sets and measures
+ *              insert, key query, range query and SQL-style query performance
+ *              across several EmbedDB configurations.
+ * @copyright   Copyright 2024
+ *              EmbedDB Team
+ * @par Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *
+ * @par 1.Redistributions of source code must retain the above copyright notice,
+ *  this list of conditions and the following disclaimer.
+ *
+ * @par 2.Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ *
+ * @par 3.Neither the name of the copyright holder nor the names of its contributors
+ *  may be used to endorse or promote products derived from this software without
+ *  specific prior written permission.
+ *
+ * @par THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+/******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../src/embedDB/embedDB.h"
+#include "../src/embedDB/utilityFunctions.h"
+#include "../src/query-interface/advancedQueries.h"
+
+/*
+ * Usage: benchmark [maxRecords] [numQueries] [dataSetFilter] [configFilter]
+ *  maxRecords:     Number of records inserted from each data set (0 inserts the whole file)
+ *  numQueries:     Number of key queries of each kind
+ *  dataSetFilter:  Only run data sets whose name contains this text
+ *  configFilter:   Only run configurations whose name contains this text
+ */
+#define BENCH_DEFAULT_RECORDS 500000
+#define BENCH_DEFAULT_QUERIES 10000
+#define BENCH_KEY_RANGE_QUERIES 100
+#define BENCH_DATA_RANGE_QUERIES 20
+#define BENCH_SQL_RUNS 3
+
+/* Layout of the bundled data set files */
+#define BENCH_FILE_PAGE_SIZE 512
+#define BENCH_FILE_HEADER_SIZE 16
+#define BENCH_RECORD_SIZE 16
+#define BENCH_KEY_SIZE 4
+#define BENCH_DATA_SIZE 12
+
+#define BENCH_DATA_PATH "build/artifacts/benchDataFile.bin"
+#define BENCH_INDEX_PATH "build/artifacts/benchIndexFile.bin"
+
+/* SQL-style queries from benchmarks.md that are run on a data set */
+#define BENCH_SQL_WEATHER 0  /* Queries 1 and 2: daily temperature and wind aggregates */
+#define BENCH_SQL_ETHYLENE 1 /* Query 3: count of records with a positive concentration */
+#define BENCH_SQL_WATCH 2    /* Query 5: bucketed count of records with large X motion */
+
+typedef struct {
+    char *name;
+    char *path;
+    char *randomPath; /* Same records in random order. Used for random key queries */
+    uint8_t sqlQueries;
+    uint8_t useBitmap; /* The bitmap buckets are sized for temperatures. Values far outside them make bitmap updates slow. The index needs the bitmap */
+} benchDataSet;
+
+typedef struct {
+    char *name;
+    uint32_t parameters; /* Added to EMBEDDB_RESET_DATA, and EMBEDDB_USE_INDEX | EMBEDDB_USE_BMAP if the data set uses a bitmap */
+    uint8_t radixBits;
+    uint16_t pageSize;
+    uint8_t bufferSizeInBlocks;
+} benchConfig;
+
+static benchDataSet dataSets[] = {
+    {"uwa500K", "data/uwa500K.bin", "data/uwa500K_randomized.bin", BENCH_SQL_WEATHER, 1},
+    {"sea100K", "data/sea100K.bin", "data/sea100K_randomized.bin", BENCH_SQL_WEATHER, 1},
+    {"ethylene_CO", "data/ethylene_CO.bin", "data/ethylene_CO_randomized.bin", BENCH_SQL_ETHYLENE, 1},
+    {"Watch_gyroscope", "data/Watch_gyroscope.bin", "data/Watch_gyroscope_randomized.bin", BENCH_SQL_WATCH, 0},
+};
+
+static benchConfig configs[] = {
+    {"spline", 0, 0, 512, 4},
+    {"radix8", EMBEDDB_USE_RADIX, 8, 512, 4},
+    {"radix16", EMBEDDB_USE_RADIX, 16, 512, 4},
+    {"binary", EMBEDDB_USE_BINARY_SEARCH, 0, 512, 4},
+    {"estimate", EMBEDDB_USE_ESTIMATE_SEARCH, 0, 512, 4},
+    {"spline-1024", 0, 0, 1024, 4},
+    {"spline-4096", 0, 0, 4096, 4},
+    {"pool-8", EMBEDDB_USE_BUFFER_POOL, 0, 512, 8},
+    {"pool-16", EMBEDDB_USE_BUFFER_POOL, 0, 512, 16},
+};
+
+/* Measurements of one operation. Latencies are in nanoseconds */
+typedef struct {
+    uint64_t *latencies;
+    uint32_t count;
+    uint32_t capacity;
+    uint64_t totalTime;
+    uint32_t errors;
+} benchResult;
+
+/* Lowest and highest value of the first data column. Used to pick data range queries */
+typedef struct {
+    uint32_t minKey;
+    uint32_t maxKey;
+    int32_t minData;
+    int32_t maxData;
+    uint32_t numRecords;
+} benchLoaded;
+
+static uint32_t randomState = 1;
+
+/* Generator with the same sequence on every platform so runs are reproducible */
+static uint32_t benchRandom() {
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 17;
+    randomState ^= randomState << 5;
+    return randomState;
+}
+
+static uint64_t benchNow() {
+    struct timespec ts;
+#if defined(__unix__) || defined(__APPLE__)
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+#else
+    timespec_get(&ts, TIME_UTC);
+#endif
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static int compareLatency(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+static void resultInit(benchResult *result, uint32_t capacity) {
+    result->latencies = malloc((size_t)(capacity > 0 ? capacity : 1) * sizeof(uint64_t));
+    if (result->latencies == NULL) {
+        printf("ERROR: Failed to allocate the latency buffer.\n");
+        exit(1);
+    }
+    result->count = 0;
+    result->capacity = capacity;
+    result->totalTime = 0;
+    result->errors = 0;
+}
+
+static void resultAdd(benchResult *result, uint64_t latency) {
+    if (result->count < result->capacity)
+        result->latencies[result->count++] = latency;
+    result->totalTime += latency;
+}
+
+static double percentile(benchResult *result, uint32_t pct) {
+    if (result->count == 0)
+        return 0;
+    return result->latencies[(uint64_t)(result->count - 1) * pct / 100] / 1000.0;
+}
+
+static void printHeader() {
+    printf("%-16s %-12s %-14s %8s %12s %10s %10s %10s %10s %10s %9s %9s %9s %7s\n", "dataSet", "config", "operation", "ops", "ops/s",
+           "mean(us)", "p50(us)", "p90(us)", "p99(us)", "max(us)", "reads", "writes", "bufHits", "errors");
+}
+
+/* Prints the percentiles of an operation and the page I/O it needed, then frees the result */
+static void printResult(char *dataSet, char *config, char *operation, benchResult *result, embedDBState *state) {
+    qsort(result->latencies, result->count, sizeof(uint64_t), compareLatency);
+    double seconds = result->totalTime / 1e9;
+    printf("%-16s %-12s %-14s %8lu %12.0f %10.2f %10.2f %10.2f %10.2f %10.2f %9lu %9lu %9lu %7lu\n", dataSet, config, operation,
+           (unsigned long)result->count, seconds > 0 ? result->count / seconds : 0, result->count > 0 ? result->totalTime / 1000.0 / result->count : 0,
+           percentile(result, 50), percentile(result, 90), percentile(result, 99), percentile(result, 100),
+           (unsigned long)(state->numReads + state->numIdxReads), (unsigned long)(state->numWrites + state->numIdxWrites),
+           (unsigned long)state->bufferHits, (unsigned long)result->errors);
+    fflush(stdout);
+    free(result->latencies);
+    embedDBResetStats(state);
+}
+
+/**
+ * @brief	Reads the next record from a data set file
+ * @param	file	Data set file
+ * @param	page	Buffer of BENCH_FILE_PAGE_SIZE bytes holding the current page
+ * @param	next	Index of the next record on the page. Set to the page count to read a new page
+ * @return	Pointer to the record or NULL at the end of the file
+ */
+static int8_t *nextFileRecord(FILE *file, int8_t *page, uint16_t *next) {
+    while (*next >= EMBEDDB_GET_COUNT(page)) {
+        if (fread(page, BENCH_FILE_PAGE_SIZE, 1, file) == 0)
+            return NULL;
+        *next = 0;
+    }
+    return page + BENCH_FILE_HEADER_SIZE + (*next)++ * BENCH_RECORD_SIZE;
+}
+
+static embedDBState *createState(benchDataSet *dataSet, benchConfig *config, uint32_t maxRecords) {
+    embedDBState *state = calloc(1, sizeof(embedDBState));
+    if (state == NULL)
+        return NULL;
+    state->keySize = BENCH_KEY_SIZE;
+    state->dataSize = BENCH_DATA_SIZE;
+    state->pageSize = config->pageSize;
+    state->bufferSizeInBlocks = config->bufferSizeInBlocks;
+    state->buffer = malloc((size_t)state->bufferSizeInBlocks * state->pageSize);
+    state->numSplinePoints = 300;
+    state->radixBits = config->radixBits;
+    state->eraseSizeInPages = 4;
+
+    /* Size storage so that no record is overwritten */
+    uint32_t perPage = (config->pageSize - 64) / BENCH_RECORD_SIZE;
+    state->numDataPages = (maxRecords / perPage + 64) / 4 * 4;
+    state->numIndexPages = (state->numDataPages / 8 + 64) / 4 * 4;
+
+    state->fileInterface = getFileInterface();
+    char dataPath[] = BENCH_DATA_PATH, indexPath[] = BENCH_INDEX_PATH;
+    state->dataFile = setupFile(dataPath);
+    state->indexFile = dataSet->useBitmap ? setupFile(indexPath) : NULL;
+    state->parameters = EMBEDDB_RESET_DATA | config->parameters;
+    if (dataSet->useBitmap)
+        state->parameters |= EMBEDDB_USE_INDEX | EMBEDDB_USE_BMAP;
+    state->bitmapSize = dataSet->useBitmap ? 2 : 0;
+    state->inBitmap = inBitmapInt16;
+    state->updateBitmap = updateBitmapInt16;
+    state->buildBitmapFromRange = buildBitmapInt16FromRange;
+    state->compareKey = int32Comparator;
+    state->compareData = int32Comparator;
+
+    if (state->buffer == NULL || embedDBInit(state, 1) != 0) {
+        printf("ERROR: Failed to initialize configuration %s.\n", config->name);
+        free(state->buffer);
+        free(state->fileInterface);
+        tearDownFile(state->dataFile);
+        if (state->indexFile != NULL)
+            tearDownFile(state->indexFile);
+        free(state);
+        return NULL;
+    }
+    return state;
+}
+
+static void freeState(embedDBState *state) {
+    embedDBClose(state);
+    tearDownFile(state->dataFile);
+    if (state->indexFile != NULL)
+        tearDownFile(state->indexFile);
+    free(state->fileInterface);
+    free(state->buffer);
+    free(state);
+}
+
+/* Inserts up to maxRecords from the data set and times each put */
+static void benchInsert(benchDataSet *dataSet, benchConfig *config, embedDBState *state, uint32_t maxRecords, benchLoaded *loaded) {
+    FILE *file = fopen(dataSet->path, "rb");
+    int8_t page[BENCH_FILE_PAGE_SIZE] = {0};
+    uint16_t next = 0;
+    benchResult result;
+    resultInit(&result, maxRecords);
+    loaded->numRecords = 0;
+    loaded->minData = INT32_MAX;
+    loaded->maxData = INT32_MIN;
+
+    int8_t *record;
+    while (loaded->numRecords < maxRecords && (record = nextFileRecord(file, page, &next)) != NULL) {
+        uint64_t start = benchNow();
+        int8_t status = embedDBPut(state, record, record + BENCH_KEY_SIZE);
+        resultAdd(&result, benchNow() - start);
+        if (status != 0) {
+            result.errors++;
+            continue;
+        }
+        uint32_t key = *(uint32_t *)record;
+        int32_t data = *(int32_t *)(record + BENCH_KEY_SIZE);
+        if (loaded->numRecords == 0)
+            loaded->minKey = key;
+        loaded->maxKey = key;
+        if (data < loaded->minData)
+            loaded->minData = data;
+        if (data > loaded->maxData)
+            loaded->maxData = data;
+        loaded->numRecords++;
+    }
+    uint64_t start = benchNow();
+    embedDBFlush(state);
+    result.totalTime += benchNow() - start;
+    fclose(file);
+    printResult(dataSet->name, config->name, "insert", &result, state);
+}
+
+/**
+ * @brief	Queries keys read from a data set file and checks the data returned
+ * @param	path		File with the keys to query, in the order they are queried
+ * @param	step		Only every step-th record of the file is queried
+ * @param	operation	Name of the operation printed with the results
+ */
+static void benchGet(benchDataSet *dataSet, benchConfig *config, embedDBState *state, benchLoaded *loaded, char *path, uint32_t step, uint32_t numQueries, char *operation) {
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        printf("ERROR: Failed to open %s.\n", path);
+        return;
+    }
+    int8_t page[BENCH_FILE_PAGE_SIZE] = {0};
+    int8_t data[BENCH_DATA_SIZE];
+    uint16_t next = 0;
+    uint32_t index = 0;
+    benchResult result;
+    resultInit(&result, numQueries);
+
+    int8_t *record;
+    while (result.count < numQueries && (record = nextFileRecord(file, page, &next)) != NULL) {
+        uint32_t key = *(uint32_t *)record;
+        /* Random files hold every record of the data set, so skip keys that were not inserted */
+        if (key < loaded->minKey || key > loaded->maxKey || index++ % step != 0)
+            continue;
+        uint64_t start = benchNow();
+        int8_t status = embedDBGet(state, &key, data);
+        resultAdd(&result, benchNow() - start);
+        if (status != 0 || memcmp(data, record + BENCH_KEY_SIZE, BENCH_DATA_SIZE) != 0)
+            result.errors++;
+    }
+    fclose(file);
+    printResult(dataSet->name, config->name, operation, &result, state);
+}
+
+/* Counts the records an iterator returns and adds the time it took to the result */
+static void timeIterator(embedDBState *state, embedDBIterator *it, benchResult *result) {
+    uint32_t key;
+    int8_t data[BENCH_DATA_SIZE];
+    uint64_t start = benchNow();
+    embedDBInitIterator(state, it);
+    while (embedDBNext(state, it, &key, data)) {
+        if ((it->minKey != NULL && key < *(uint32_t *)it->minKey) || (it->maxKey != NULL && key > *(uint32_t *)it->maxKey))
+            result->errors++;
+    }
+    embedDBCloseIterator(it);
+    resultAdd(result, benchNow() - start);
+}
+
+/* Iterates over randomly placed key ranges each covering 1% of the keys */
+static void benchKeyRange(benchDataSet *dataSet, benchConfig *config, embedDBState *state, benchLoaded *loaded) {
+    benchResult result;
+    resultInit(&result, BENCH_KEY_RANGE_QUERIES);
+    uint32_t span = loaded->maxKey - loaded->minKey;
+    uint32_t width = span / 100;
+    for (uint32_t i = 0; i < BENCH_KEY_RANGE_QUERIES; i++) {
+        uint32_t minKey = loaded->minKey + (uint32_t)((uint64_t)benchRandom() * (span - width) / UINT32_MAX);
+        uint32_t maxKey = minKey + width;
+        embedDBIterator it;
+        it.minKey = &minKey;
+        it.maxKey = &maxKey;
+        it.minData = NULL;
+        it.maxData = NULL;
+        timeIterator(state, &it, &result);
+    }
+    printResult(dataSet->name, config->name, "key-range", &result, state);
+}
+
+/* Iterates over all records with the first data column in a random range covering 10% of its values */
+static void benchDataRange(benchDataSet *dataSet, benchConfig *config, embedDBState *state, benchLoaded *loaded) {
+    benchResult result;
+    resultInit(&result, BENCH_DATA_RANGE_QUERIES);
+    int64_t span = (int64_t)loaded->maxData - loaded->minData;
+    int64_t width = span / 10;
+    for (uint32_t i = 0; i < BENCH_DATA_RANGE_QUERIES; i++) {
+        int32_t minData = (int32_t)(loaded->minData + (int64_t)((double)benchRandom() / UINT32_MAX * (span - width)));
+        int32_t maxData = (int32_t)(minData + width);
+        embedDBIterator it;
+        it.minKey = NULL;
+        it.maxKey = NULL;
+        it.minData = &minData;
+        it.maxData = &maxData;
+        timeIterator(state, &it, &result);
+    }
+    printResult(dataSet->name, config->name, "data-range", &result, state);
+}
+
+/* Group functions for the SQL-style queries */
+static int8_t sameDayGroup(const void *lastRecord, const void *record) {
+    return *(uint32_t *)lastRecord / 86400 == *(uint32_t *)record / 86400;
+}
+
+static void writeDayGroup(embedDBAggregateFunc *aggFunc, embedDBSchema *schema, void *recordBuffer, const void *lastRecord) {
+    uint32_t day = *(uint32_t *)lastRecord / 86400;
+    memcpy((int8_t *)recordBuffer + getColOffsetFromSchema(schema, aggFunc->colNum), &day, sizeof(uint32_t));
+}
+
+static int8_t sameBucketGroup(const void *lastRecord, const void *record) {
+    return *(uint32_t *)lastRecord / 706000 == *(uint32_t *)record / 706000;
+}
+
+static void writeBucketGroup(embedDBAggregateFunc *aggFunc, embedDBSchema *schema, void *recordBuffer, const void *lastRecord) {
+    uint32_t bucket = *(uint32_t *)lastRecord / 706000;
+    memcpy((int8_t *)recordBuffer + getColOffsetFromSchema(schema, aggFunc->colNum), &bucket, sizeof(uint32_t));
+}
+
+/* Runs an operator chain to the end and frees it. Returns the number of records produced. Closing an aggregate operator detaches its input, so the caller frees the operators below an aggregate */
+static uint32_t runQuery(embedDBOperator *op) {
+    uint32_t numResults = 0;
+    op->init(op);
+    while (exec(op))
+        numResults++;
+    op->close(op);
+    embedDBFreeOperatorRecursive(&op);
+    return numResults;
+}
+
+static void freeFunctions(embedDBAggregateFunc **functions, uint32_t length) {
+    for (uint32_t i = 0; i < length; i++) {
+        free(functions[i]->state);
+        free(functions[i]);
+    }
+}
+
+/**
+ * @brief	Runs one of the SQL-style queries of benchmarks.md once
+ * @param	query	Query number as listed in benchmarks.md
+ * @return	Number of result records
+ */
+static uint32_t runSqlQuery(embedDBState *state, embedDBSchema *schema, uint8_t query) {
+    embedDBIterator it;
+    it.minKey = NULL;
+    it.maxKey = NULL;
+    it.minData = NULL;
+    it.maxData = NULL;
+    embedDBInitIterator(state, &it);
+    embedDBOperator *scan = createTableScanOperator(state, &it, schema);
+    uint32_t numResults = 0;
+
+    if (query == 1) {
+        /* SELECT key / 86400, min(temp), max(temp), avg(temp) FROM uwa GROUP BY key / 86400 */
+        embedDBAggregateFunc *functions[] = {createMinAggregate(1, -4), createMaxAggregate(1, -4), createAvgAggregate(1, 4)};
+        embedDBAggregateFunc aggFunctions[] = {{NULL, NULL, writeDayGroup, NULL, 4}, *functions[0], *functions[1], *functions[2]};
+        numResults = runQuery(createAggregateOperator(scan, sameDayGroup, aggFunctions, 4));
+        embedDBFreeOperatorRecursive(&scan);
+        freeFunctions(functions, 3);
+    } else if (query == 2) {
+        /* SELECT key / 86400, avg(temp), max(wind) FROM uwa GROUP BY key / 86400 HAVING max(wind) > 15 */
+        embedDBAggregateFunc *functions[] = {createAvgAggregate(1, 4), createMaxAggregate(3, -4)};
+        embedDBAggregateFunc aggFunctions[] = {{NULL, NULL, writeDayGroup, NULL, 4}, *functions[0], *functions[1]};
+        embedDBOperator *agg = createAggregateOperator(scan, sameDayGroup, aggFunctions, 3);
+        int32_t minWind = 150;
+        numResults = runQuery(createSelectionOperator(agg, 2, SELECT_GT, &minWind));
+        embedDBFreeOperatorRecursive(&scan);
+        freeFunctions(functions, 2);
+    } else if (query == 3) {
+        /* SELECT COUNT(*) FROM ethylene WHERE conc > 0 */
+        int32_t minConc = 0;
+        numResults = runQuery(createSelectionOperator(scan, 1, SELECT_GT, &minConc));
+    } else {
+        /* SELECT key / 706000 as Bucket, COUNT(*) as Count FROM watch WHERE x > 500000000 GROUP BY key / 706000 */
+        int32_t minX = 500000000;
+        embedDBOperator *select = createSelectionOperator(scan, 1, SELECT_GT, &minX);
+        embedDBAggregateFunc *functions[] = {createCountAggregate()};
+        embedDBAggregateFunc aggFunctions[] = {{NULL, NULL, writeBucketGroup, NULL, 4}, *functions[0]};
+        numResults = runQuery(createAggregateOperator(select, sameBucketGroup, aggFunctions, 2));
+        embedDBFreeOperatorRecursive(&select);
+        freeFunctions(functions, 1);
+    }
+    embedDBCloseIterator(&it);
+    return numResults;
+}
+
+static void benchSql(benchDataSet *dataSet, benchConfig *config, embedDBState *state) {
+    int8_t colSizes[] = {4, 4, 4, 4};
+    int8_t colSignedness[] = {embedDB_COLUMN_UNSIGNED, embedDB_COLUMN_SIGNED, embedDB_COLUMN_SIGNED, embedDB_COLUMN_SIGNED};
+    embedDBSchema *schema = embedDBCreateSchema(4, colSizes, colSignedness);
+    uint8_t queries[2], numQueries = 0;
+    if (dataSet->sqlQueries == BENCH_SQL_WEATHER) {
+        queries[numQueries++] = 1;
+        queries[numQueries++] = 2;
+    } else if (dataSet->sqlQueries == BENCH_SQL_ETHYLENE) {
+        queries[numQueries++] = 3;
+    } else {
+        queries[numQueries++] = 5;
+    }
+
+    for (uint8_t q = 0; q < numQueries; q++) {
+        char operation[16];
+        snprintf(operation, sizeof(operation), "sql-query-%d", queries[q]);
+        benchResult result;
+        resultInit(&result, BENCH_SQL_RUNS);
+        for (uint32_t run = 0; run < BENCH_SQL_RUNS; run++) {
+            uint64_t start = benchNow();
+            runSqlQuery(state, schema, queries[q]);
+            resultAdd(&result, benchNow() - start);
+        }
+        printResult(dataSet->name, config->name, operation, &result, state);
+    }
+    embedDBFreeSchema(&schema);
+}
+
+int main(int argc, char *argv[]) {
+    uint32_t maxRecords = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 10) : BENCH_DEFAULT_RECORDS;
+    uint32_t numQueries = argc > 2 ? (uint32_t)strtoul(argv[2], NULL, 10) : BENCH_DEFAULT_QUERIES;
+    char *dataSetFilter = argc > 3 ? argv[3] : "";
+    char *configFilter = argc > 4 ? argv[4] : "";
+
+    printf("EmbedDB benchmark: %lu records per data set, %lu key queries\n\n", (unsigned long)maxRecords, (unsigned long)numQueries);
+    printHeader();
+
+    for (size_t d = 0; d < sizeof(dataSets) / sizeof(dataSets[0]); d++) {
+        benchDataSet *dataSet = &dataSets[d];
+        if (strstr(dataSet->name, dataSetFilter) == NULL)
+            continue;
+
+        /* Count the records of the data set so storage can be sized for them */
+        FILE *file = fopen(dataSet->path, "rb");
+        if (file == NULL) {
+            printf("ERROR: Failed to open %s.\n", dataSet->path);
+            continue;
+        }
+        int8_t page[BENCH_FILE_PAGE_SIZE] = {0};
+        uint16_t next = 0;
+        uint32_t numRecords = 0;
+        while ((maxRecords == 0 || numRecords < maxRecords) && nextFileRecord(file, page, &next) != NULL)
+            numRecords++;
+        fclose(file);
+
+        for (size_t c = 0; c < sizeof(configs) / sizeof(configs[0]); c++) {
+            benchConfig *config = &configs[c];
+            if (strstr(config->name, configFilter) == NULL)
+                continue;
+            embedDBState *state = createState(dataSet, config, numRecords);
+            if (state == NULL)
+                continue;
+            randomState = 1;
+            benchLoaded loaded;
+            benchInsert(dataSet, config, state, numRecords, &loaded);
+            uint32_t step = loaded.numRecords / (numQueries > 0 ? numQueries : 1);
+            benchGet(dataSet, config, state, &loaded, dataSet->path, step > 0 ? step : 1, numQueries, "get-seq");
+            benchGet(dataSet, config, state, &loaded, dataSet->randomPath, 1, numQueries, "get-random");
+            benchKeyRange(dataSet, config, state, &loaded);
+            benchDataRange(dataSet, config, state, &loaded);
+            benchSql(dataSet, config, state);
+            freeState(state);
+        }
+    }
+
+    remove(BENCH_DATA_PATH);
+    remove(BENCH_INDEX_PATH);
+    printf("\nComplete.\n");
+    return 0;
+}
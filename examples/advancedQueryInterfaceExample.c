@@ -282,7 +282,7 @@ int main() {
 
     // Prepare uwa table
     embedDBOperator* scan4_1 = createTableScanOperator(stateUWA, &it, baseSchema);
-    embedDBOperator* shift4_1 = malloc(sizeof(embedDBOperator));  // Custom operator to shift the year 2000 to 2015 to make the join work
+    embedDBOperator* shift4_1 = embedDBCreateOperator();  // Custom operator to shift the year 2000 to 2015 to make the join work
     shift4_1->input = scan4_1;
     shift4_1->init = customShiftInit;
     shift4_1->next = customShiftNext;
@@ -46,35 +46,868 @@
 #include "../spline/radixspline.h"
 #include "../spline/spline.h"
 
+#if defined(__unix__) || defined(__APPLE__)
+#include <pthread.h>
+#include <sched.h>
+#define SCAN_USE_THREADS 1
+#else
+#define SCAN_USE_THREADS 0
+#endif
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE4_2__)
+#include <nmmintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+/* Tells the CPU the thread is spinning, which leaves the core to the other hardware thread while waiting */
+#if defined(__SSE2__) || defined(_M_X64)
+#define SPIN_PAUSE() _mm_pause()
+#elif defined(__aarch64__)
+#define SPIN_PAUSE() __asm__ __volatile__("yield")
+#else
+#define SPIN_PAUSE()
+#endif
+
+/**
+ * Number of keys left in the search window when the in-page search switches from halving to comparing every key.
+ * Note: The keys of the final window are compared with SIMD instructions when the target supports them. Must be between 1 and 8
+ */
+#define SEARCH_SCAN_KEYS 8
+
+/**
+ * Number of data pages read ahead into the buffer pool once an iterator reads consecutive data pages
+ * Note: Read ahead requires EMBEDDB_USE_BUFFER_POOL and a file interface with readMany. Set to 0 to disable read ahead
+ */
+#define READ_AHEAD_PAGES 4
+
+/**
+ * Number of records a compressed data page can hold for each record that fits on an uncompressed page
+ * Note: With EMBEDDB_USE_COMPRESSION the write buffer and the decompressed read page are allocated with room for this many more records
+ */
+#define COMPRESSED_RECORDS_FACTOR 4
+
+/**
+ * Number of times a reader tries to copy the state between two writes before it makes the writer wait for it
+ * Note: Readers only delay the writer when it inserts so fast that there is no gap between its writes long enough to take a snapshot
+ */
+#define SNAPSHOT_RETRIES 64
+
 /**
- * 0 = Modified binary search
- * 1 = Binary serach
- * 2 = Modified linear search (Spline)
+ * Number of times the writer checks for a reader waiting on it before it starts its change anyway
+ * Note: The first SNAPSHOT_WRITER_SPINS checks only pause the CPU, later ones also yield the thread so a reader on the same core can run
  */
-#define SEARCH_METHOD 2
+#define SNAPSHOT_WRITER_WAIT 4096
+#define SNAPSHOT_WRITER_SPINS 64
 
 /**
- * Number of bits to be indexed by the Radix Search structure
- * Note: The Radix search structure is only used with Spline (SEARCH_METHOD == 2) To use a pure Spline index without a Radix table, set RADIX_BITS to 0
+ * Number of consecutive data pages a worker of embedDBParallelScan takes at a time
+ * Note: Smaller chunks spread the work more evenly, larger chunks keep the reads of a worker sequential
  */
-#define RADIX_BITS 0
+#define SCAN_CHUNK_PAGES 16
+
+/* Identifies the first page of a checkpoint slot. "EDBC" */
+#define EMBEDDB_CHECKPOINT_MAGIC 0x43424445
+
+/* Cursors saved by a checkpoint. Recovery starts from these values and replays the pages written after them */
+typedef struct {
+    uint32_t sequence;           /* Incremented on every checkpoint. The newest valid checkpoint is used for recovery */
+    id_t nextDataPageId;         /* Next logical data page id */
+    id_t minDataPageId;          /* Lowest logical data page id that is saved on file */
+    uint32_t numAvailDataPages;  /* Number of writable data pages left before needing to delete */
+    uint64_t minKey;             /* Minimum key */
+    id_t avgKeyDiff;             /* Estimate for difference between key values */
+    int32_t maxError;            /* Maximum key error */
+    id_t nextIdxPageId;          /* Next logical index page id */
+    id_t minIndexPageId;         /* Lowest logical index page id that is saved on file */
+    uint32_t numAvailIndexPages; /* Number of writable index pages left before needing to delete */
+    id_t nextVarPageId;          /* Next logical variable data page id */
+    uint64_t minVarRecordId;     /* Minimum record id that we still have variable data for */
+    uint32_t numAvailVarPages;   /* Number of writable var pages left before needing to delete */
+} embedDBCheckpointInfo;
+
+/* Position in the checkpoint byte stream, which is split across the pages of a checkpoint slot */
+typedef struct {
+    id_t pageNum;      /* Checkpoint file page the stream reads or writes next */
+    uint32_t offset;   /* Offset in the current page. Equal to the page size when the next page must be read */
+    uint32_t checksum; /* FNV-1a hash of the bytes streamed so far */
+} embedDBCheckpointCursor;
+
+/* Summary of the data pages of one index page. In the zone map each zone is followed by the OR of the bitmaps of its data pages and, with EMBEDDB_USE_MAX_MIN, their smallest and largest data */
+typedef struct {
+    id_t indexPageId;     /* Logical id of the index page. UINT32_MAX if the zone is unused */
+    id_t firstDataPageId; /* Logical id of the first data page of the index page */
+    count_t numDataPages; /* Number of data pages in the zone */
+    int8_t hasDataRange;  /* 1 if the smallest and largest data of the zone are known */
+} embedDBZone;
+
+/* Value index page: 4 for id, 2 for count, 2 for position in run, 2 for pages in run, 2 unused, 4 for first data page id, 4 for next data page id, then the entries */
+#define EMBEDDB_VALUE_INDEX_HEADER_SIZE 20
+
+/* One entry of a value index run. The entries of a run on file are sorted by value, then by data page */
+typedef struct {
+    int32_t value;   /* Value of the indexed column */
+    id_t dataPageId; /* Logical id of a data page holding the value */
+} embedDBValueEntry;
+
+/* Summary of one value index page, kept in memory so a lookup only reads the pages that may hold a value in its range */
+typedef struct {
+    int32_t minValue;     /* Smallest value on the page. INT32_MAX if the page is empty */
+    int32_t maxValue;     /* Largest value on the page. INT32_MIN if the page is empty */
+    count_t runPage;      /* Position of the page in its run */
+    count_t numRunPages;  /* Number of pages in the run */
+    id_t firstDataPageId; /* First data page whose values are all in the run or the runs after it */
+    id_t nextDataPageId;  /* First data page whose values are not all in the run or the runs before it */
+} embedDBValuePage;
+
+/* Value index written to state->valueIndexFile. It is a log of sorted runs of up to an erase block of pages, each holding the distinct values of consecutive data pages */
+typedef struct {
+    id_t nextPageId;                /* Next logical value index page id */
+    id_t minPageId;                 /* Lowest logical value index page id that is saved on file */
+    uint32_t numAvailPages;         /* Number of writable value index pages left before needing to delete */
+    id_t firstDataPageId;           /* Data pages from this one up to nextDataPageId have all their values in a run on file or in the run buffer */
+    id_t nextDataPageId;            /* Next data page to be added */
+    id_t runFirstDataPageId;        /* First data page whose values will all be in the run being filled or the runs after it */
+    count_t maxPageEntries;         /* Maximum entries on a value index page */
+    uint32_t maxRunEntries;         /* Maximum entries in a run */
+    uint32_t numRunEntries;         /* Entries in the run being filled */
+    embedDBValueEntry *runEntries;  /* Run being filled. Its entries are only sorted when it is written */
+    int8_t *pageBuffer;             /* Value index page being written or last read */
+    int32_t *pageValues;            /* Values of the data page being added */
+    embedDBValuePage *pages;        /* Summary of each physical value index page */
+} embedDBValueIndex;
 
 /* Helper Functions */
-int8_t embedDBInitData(embedDBState *state);
-int8_t embedDBInitDataFromFile(embedDBState *state);
-int8_t embedDBInitIndex(embedDBState *state);
-int8_t embedDBInitIndexFromFile(embedDBState *state);
-int8_t embedDBInitVarData(embedDBState *state);
-int8_t embedDBInitVarDataFromFile(embedDBState *state);
+int8_t embedDBInitData(embedDBState *state, embedDBCheckpointInfo *checkpoint);
+int8_t embedDBInitDataFromFile(embedDBState *state, embedDBCheckpointInfo *checkpoint);
+int8_t embedDBInitIndex(embedDBState *state, embedDBCheckpointInfo *checkpoint);
+int8_t embedDBInitIndexFromFile(embedDBState *state, embedDBCheckpointInfo *checkpoint);
+int8_t embedDBInitVarData(embedDBState *state, embedDBCheckpointInfo *checkpoint);
+int8_t embedDBInitVarDataFromFile(embedDBState *state, embedDBCheckpointInfo *checkpoint);
+int8_t recoveryReadPageId(embedDBState *state, uint8_t fileType, id_t physicalPageId, id_t *logicalPageId);
+int8_t embedDBFindPageRange(embedDBState *state, uint8_t fileType, uint32_t numPages, id_t hint, id_t *minPageId, id_t *nextPageId);
+int8_t embedDBInitCheckpoint(embedDBState *state, embedDBCheckpointInfo *checkpoint);
+int8_t embedDBLoadCheckpoint(embedDBState *state, embedDBCheckpointInfo *checkpoint);
+uint32_t checkpointSlotPages(embedDBState *state);
+int8_t checkpointTransfer(embedDBState *state, embedDBCheckpointCursor *cursor, void *bytes, uint32_t length, int8_t write);
+int8_t checkpointStream(embedDBState *state, embedDBCheckpointInfo *checkpoint, embedDBCheckpointCursor *cursor, int8_t write);
+void embedDBResetSpline(embedDBState *state);
 void updateAverageKeyDifference(embedDBState *state, void *buffer);
 void embedDBInitSplineFromFile(embedDBState *state);
 int32_t getMaxError(embedDBState *state, void *buffer);
 void updateMaxiumError(embedDBState *state, void *buffer);
+void writeFullDataPage(embedDBState *state);
+void writeIndexRecord(embedDBState *state, void *indexPage, count_t indexRecord);
+int8_t readIndexRecord(embedDBState *state, id_t dataPageId, void **record);
 int8_t embedDBSetupVarDataStream(embedDBState *state, void *key, embedDBVarDataStream **varData, id_t recordNumber);
+int8_t embedDBFillVarDataStream(embedDBState *state, void *key, embedDBVarDataStream *varData, id_t recordNumber);
+int32_t embedDBFindVarRecord(embedDBState *state, void *key, void *data);
+int8_t embedDBNextVarRecord(embedDBState *state, embedDBIterator *it, void *key, void *data, count_t *recordNum);
 uint32_t cleanSpline(embedDBState *state, void *key);
 void readToWriteBuf(embedDBState *state);
+int32_t iteratorSkipPageByIndex(embedDBState *state, embedDBIterator *it);
 void readToWriteBufVar(embedDBState *state);
 void embedDBFlushVar(embedDBState *state);
+int8_t embedDBInitBufferPool(embedDBState *state);
+void *bufferPoolFind(embedDBState *state, uint8_t fileType, id_t pageNum);
+uint16_t bufferPoolVictim(embedDBState *state);
+void bufferPoolInsert(embedDBState *state, uint8_t fileType, id_t pageNum, void *page);
+uint32_t bufferPoolReadAhead(embedDBState *state, uint8_t fileType, void *file, id_t pageNum, uint32_t numPages);
+int8_t iteratorReadDataPage(embedDBState *state, embedDBIterator *it);
+void bufferPoolInvalidate(embedDBState *state, uint8_t fileType, id_t pageNum);
+int8_t embedDBInitZoneMap(embedDBState *state);
+void zoneAddDataPage(embedDBState *state, id_t indexPageId, id_t dataPageId, void *bitmap, void *minData, void *maxData);
+int8_t embedDBInitValueIndex(embedDBState *state);
+int8_t embedDBInitValueIndexFromFile(embedDBState *state);
+void valueIndexAddPage(embedDBState *state, void *page, id_t dataPageId);
+int8_t valueIndexWriteRun(embedDBState *state, id_t nextDataPageId, id_t nextRunFirstDataPageId);
+void valueIndexFindPages(embedDBState *state, embedDBIterator *it);
+id_t writeValueIndexPage(embedDBState *state, void *buffer);
+int8_t readValueIndexPage(embedDBState *state, id_t pageNum);
+static id_t writeVariablePageGather(embedDBState *state, void *buffer, void *data);
+
+/**
+ * @brief	Loads a 4 or 8 byte key as an unsigned integer.
+ * @param	key		Pointer to the key
+ * @param	keySize	Size of the key in bytes. Must be 4 or 8
+ */
+static inline uint64_t loadUnsignedKey(void *key, uint8_t keySize) {
+    if (keySize == 4) {
+        uint32_t value;
+        memcpy(&value, key, sizeof(uint32_t));
+        return value;
+    }
+    uint64_t value;
+    memcpy(&value, key, sizeof(uint64_t));
+    return value;
+}
+
+/**
+ * @brief	Compares two keys. Keys are compared as unsigned integers without calling the key comparator when EMBEDDB_USE_UNSIGNED_KEYS is set.
+ * @param	state	embedDB algorithm state structure
+ * @param	a		First key
+ * @param	b		Second key
+ * @return	Negative if a < b, 0 if a == b, positive if a > b
+ */
+static inline int8_t compareKeys(embedDBState *state, void *a, void *b) {
+    if (!EMBEDDB_USING_UNSIGNED_KEYS(state->parameters))
+        return state->compareKey(a, b);
+    if (state->keySize == 4 || state->keySize == 8) {
+        uint64_t keyA = loadUnsignedKey(a, state->keySize), keyB = loadUnsignedKey(b, state->keySize);
+        return (keyA > keyB) - (keyA < keyB);
+    }
+    uint64_t keyA = 0, keyB = 0;
+    memcpy(&keyA, a, state->keySize);
+    memcpy(&keyB, b, state->keySize);
+    return (keyA > keyB) - (keyA < keyB);
+}
+
+/**
+ * @brief	Returns the number of bytes between the keys of consecutive records on a data page.
+ * @param	state	embedDB algorithm state structure
+ */
+static inline uint16_t embedDBKeyStride(embedDBState *state) {
+    return EMBEDDB_USING_PAX(state->parameters) ? state->keySize : state->recordSize;
+}
+
+/**
+ * @brief	Returns the key of a record on a data page.
+ * @param	state	embedDB algorithm state structure
+ * @param	page	In memory data page
+ * @param	record	Index of the record on the page
+ */
+static inline void *embedDBRecordKey(embedDBState *state, void *page, count_t record) {
+    return (int8_t *)page + state->headerSize + record * embedDBKeyStride(state);
+}
+
+/**
+ * @brief	Returns the data of a record on a data page. With EMBEDDB_USE_PAX and more than one data column, the columns are copied together into scratch.
+ * @param	state	embedDB algorithm state structure
+ * @param	page	In memory data page
+ * @param	record	Index of the record on the page
+ * @param	scratch	Space for dataSize bytes used if the data is split into columns on the page
+ * @return	Pointer to the data of the record
+ */
+static inline void *embedDBRecordData(embedDBState *state, void *page, count_t record, void *scratch) {
+    if (!EMBEDDB_USING_PAX(state->parameters))
+        return (int8_t *)page + state->headerSize + record * state->recordSize + state->keySize;
+
+    int8_t *column = (int8_t *)page + state->headerSize + state->maxRecordsPerPage * state->keySize;
+    if (state->numDataColumns <= 1)
+        return column + record * state->dataSize;
+
+    int8_t *output = (int8_t *)scratch;
+    for (uint8_t i = 0; i < state->numDataColumns; i++) {
+        uint8_t columnSize = abs(state->dataColumnSizes[i]);
+        memcpy(output, column + record * columnSize, columnSize);
+        output += columnSize;
+        column += state->maxRecordsPerPage * columnSize;
+    }
+    return scratch;
+}
+
+/**
+ * @brief	Copies the data of a record on a data page.
+ * @param	state	embedDB algorithm state structure
+ * @param	page	In memory data page
+ * @param	record	Index of the record on the page
+ * @param	data	Pre-allocated memory to copy data for record
+ */
+static inline void embedDBCopyRecordData(embedDBState *state, void *page, count_t record, void *data) {
+    void *recordData = embedDBRecordData(state, page, record, data);
+    if (recordData != data)
+        memcpy(data, recordData, state->dataSize);
+}
+
+/**
+ * @brief	Writes the key and data of a record to a data page.
+ * @param	state	embedDB algorithm state structure
+ * @param	page	In memory data page
+ * @param	record	Index of the record on the page
+ * @param	key		Key for record
+ * @param	data	Data for record
+ */
+static inline void embedDBWriteRecord(embedDBState *state, void *page, count_t record, void *key, void *data) {
+    memcpy(embedDBRecordKey(state, page, record), key, state->keySize);
+    if (!EMBEDDB_USING_PAX(state->parameters) || state->numDataColumns <= 1) {
+        memcpy(embedDBRecordData(state, page, record, NULL), data, state->dataSize);
+        return;
+    }
+
+    int8_t *column = (int8_t *)page + state->headerSize + state->maxRecordsPerPage * state->keySize;
+    int8_t *input = (int8_t *)data;
+    for (uint8_t i = 0; i < state->numDataColumns; i++) {
+        uint8_t columnSize = abs(state->dataColumnSizes[i]);
+        memcpy(column + record * columnSize, input, columnSize);
+        input += columnSize;
+        column += state->maxRecordsPerPage * columnSize;
+    }
+}
+
+/**
+ * @brief	Returns the variable data location of a record on a data page.
+ * @param	state	embedDB algorithm state structure
+ * @param	page	In memory data page
+ * @param	record	Index of the record on the page
+ */
+static inline void *embedDBRecordVarLocation(embedDBState *state, void *page, count_t record) {
+    if (!EMBEDDB_USING_PAX(state->parameters))
+        return (int8_t *)page + state->headerSize + record * state->recordSize + state->keySize + state->dataSize;
+    return (int8_t *)page + state->headerSize + state->maxRecordsPerPage * (state->keySize + state->dataSize) + record * sizeof(uint32_t);
+}
+
+/**
+ * @brief	Returns the size of a data page in memory. Compressed pages hold more records than fit on a page uncompressed.
+ * @param	state	embedDB algorithm state structure
+ */
+static inline uint32_t embedDBDataPageSize(embedDBState *state) {
+    if (!EMBEDDB_USING_COMPRESSION(state->parameters))
+        return state->pageSize;
+    return state->headerSize + (uint32_t)state->maxRecordsPerPage * state->recordSize;
+}
+
+/**
+ * @brief	Writes the low bits of a value to a bit stream, starting from the lowest bit of each byte.
+ * @param	bits		Bit stream. If NULL, only the position is advanced, which is used to find the size of the compressed records
+ * @param	position	Bit position in the stream. Advanced by numBits
+ * @param	value		Value to write
+ * @param	numBits		Number of bits of the value to write. Between 0 and 64
+ */
+static inline void writeBits(uint8_t *bits, uint32_t *position, uint64_t value, uint8_t numBits) {
+    if (bits == NULL) {
+        *position += numBits;
+        return;
+    }
+    while (numBits > 0) {
+        uint8_t offset = *position & 7;
+        uint8_t length = min(8 - offset, numBits);
+        uint8_t mask = (uint8_t)(((1u << length) - 1) << offset);
+        uint8_t *byte = bits + (*position >> 3);
+        *byte = (uint8_t)((*byte & ~mask) | ((value << offset) & mask));
+        value >>= length;
+        numBits -= length;
+        *position += length;
+    }
+}
+
+/**
+ * @brief	Reads bits written by writeBits.
+ * @param	bits		Bit stream
+ * @param	position	Bit position in the stream. Advanced by numBits
+ * @param	numBits		Number of bits to read. Between 0 and 64
+ * @return	Value of the bits
+ */
+static inline uint64_t readBits(uint8_t *bits, uint32_t *position, uint8_t numBits) {
+    uint64_t value = 0;
+    uint8_t shift = 0;
+    while (shift < numBits) {
+        uint8_t offset = *position & 7;
+        uint8_t length = min(8 - offset, numBits - shift);
+        value |= (uint64_t)((bits[*position >> 3] >> offset) & ((1u << length) - 1)) << shift;
+        shift += length;
+        *position += length;
+    }
+    return value;
+}
+
+/**
+ * @brief	Sign extends the low numBits bits of a value.
+ */
+static inline int64_t signExtend(uint64_t value, uint8_t numBits) {
+    if (numBits == 0)
+        return 0;
+    if (numBits < 64 && ((value >> (numBits - 1)) & 1))
+        value |= UINT64_MAX << numBits;
+    return (int64_t)value;
+}
+
+/* Bits used to store the delta of delta of a key for each prefix of a compressed key. Keys that need more bits are stored with keySize bytes */
+static const uint8_t keyDeltaBits[] = {0, 7, 9, 12};
+
+/**
+ * @brief	Compresses a key as the difference between its delta and the delta of the previous key.
+ * 			A prefix of up to four 1 bits, ended by a 0 bit if shorter, selects the number of bits that follow from keyDeltaBits.
+ * @param	state			embedDB algorithm state structure
+ * @param	bits			Bit stream. If NULL, only the position is advanced
+ * @param	position		Bit position in the stream
+ * @param	key				Key to compress
+ * @param	prevKey			Key of the previous record
+ * @param	prevPrevKey		Key of the record before the previous record. NULL if the previous record is the first of the page
+ */
+static void compressKey(embedDBState *state, uint8_t *bits, uint32_t *position, void *key, void *prevKey, void *prevPrevKey) {
+    uint8_t keyBits = state->keySize * 8;
+    uint64_t thisKey = 0, prev = 0, prevPrev = 0;
+    memcpy(&thisKey, key, state->keySize);
+    memcpy(&prev, prevKey, state->keySize);
+    memcpy(&prevPrev, prevPrevKey == NULL ? prevKey : prevPrevKey, state->keySize);
+    uint64_t deltaOfDelta = (thisKey - prev) - (prev - prevPrev);
+    int64_t value = signExtend(deltaOfDelta, keyBits);
+
+    for (uint8_t prefix = 0; prefix < sizeof(keyDeltaBits); prefix++) {
+        uint8_t numBits = keyDeltaBits[prefix];
+        if (numBits == 0 ? value == 0 : value >= -((int64_t)1 << (numBits - 1)) && value < ((int64_t)1 << (numBits - 1))) {
+            writeBits(bits, position, ((uint64_t)1 << prefix) - 1, prefix + 1);
+            writeBits(bits, position, deltaOfDelta, numBits);
+            return;
+        }
+    }
+    writeBits(bits, position, ((uint64_t)1 << sizeof(keyDeltaBits)) - 1, sizeof(keyDeltaBits));
+    writeBits(bits, position, deltaOfDelta, keyBits);
+}
+
+/**
+ * @brief	Decompresses a key written by compressKey.
+ * @param	state			embedDB algorithm state structure
+ * @param	bits			Bit stream
+ * @param	position		Bit position in the stream
+ * @param	key				Return variable for the key
+ * @param	prevKey			Key of the previous record
+ * @param	prevPrevKey		Key of the record before the previous record. NULL if the previous record is the first of the page
+ */
+static void decompressKey(embedDBState *state, uint8_t *bits, uint32_t *position, void *key, void *prevKey, void *prevPrevKey) {
+    uint8_t prefix = 0;
+    while (prefix < sizeof(keyDeltaBits) && readBits(bits, position, 1))
+        prefix++;
+    uint8_t numBits = prefix < sizeof(keyDeltaBits) ? keyDeltaBits[prefix] : state->keySize * 8;
+    uint64_t deltaOfDelta = (uint64_t)signExtend(readBits(bits, position, numBits), numBits);
+
+    uint64_t prev = 0, prevPrev = 0;
+    memcpy(&prev, prevKey, state->keySize);
+    memcpy(&prevPrev, prevPrevKey == NULL ? prevKey : prevPrevKey, state->keySize);
+    uint64_t thisKey = prev + (prev - prevPrev) + deltaOfDelta;
+    memcpy(key, &thisKey, state->keySize);
+}
+
+/**
+ * @brief	Compresses a value as the XOR with the previous value of its column.
+ * 			An unchanged value is a single 0 bit. Otherwise a 1 bit is followed by the number of trailing zero bits of the XOR (6 bits),
+ * 			the number of remaining bits minus one (6 bits) and the remaining bits.
+ * @param	bits		Bit stream. If NULL, only the position is advanced
+ * @param	position	Bit position in the stream
+ * @param	value		Value to compress
+ * @param	prevValue	Value of the column in the previous record
+ * @param	numBits		Size of the value in bits. Between 8 and 64
+ */
+static void compressValue(uint8_t *bits, uint32_t *position, uint64_t value, uint64_t prevValue, uint8_t numBits) {
+    uint64_t changed = value ^ prevValue;
+    if (changed == 0) {
+        writeBits(bits, position, 0, 1);
+        return;
+    }
+    uint8_t leading = 0, trailing = 0;
+    while (!((changed >> (numBits - 1 - leading)) & 1))
+        leading++;
+    while (!((changed >> trailing) & 1))
+        trailing++;
+    uint8_t length = numBits - leading - trailing;
+    writeBits(bits, position, 1, 1);
+    writeBits(bits, position, trailing, 6);
+    writeBits(bits, position, length - 1, 6);
+    writeBits(bits, position, changed >> trailing, length);
+}
+
+/**
+ * @brief	Decompresses a value written by compressValue.
+ * @param	bits		Bit stream
+ * @param	position	Bit position in the stream
+ * @param	prevValue	Value of the column in the previous record
+ * @return	The value
+ */
+static uint64_t decompressValue(uint8_t *bits, uint32_t *position, uint64_t prevValue) {
+    if (!readBits(bits, position, 1))
+        return prevValue;
+    uint8_t trailing = (uint8_t)readBits(bits, position, 6);
+    uint8_t length = (uint8_t)readBits(bits, position, 6) + 1;
+    return prevValue ^ (readBits(bits, position, length) << trailing);
+}
+
+/* Largest number of bits compressValue writes for a value of numBits bits */
+#define COMPRESSED_VALUE_MAX_BITS(numBits) (13 + (numBits))
+
+/**
+ * @brief	Compresses the data of a record column by column. Columns larger than 8 bytes are split into 8 byte values.
+ * @param	state		embedDB algorithm state structure
+ * @param	bits		Bit stream. If NULL, only the position is advanced
+ * @param	position	Bit position in the stream
+ * @param	data		Data of the record
+ * @param	prevData	Data of the previous record. NULL to store the data uncompressed
+ */
+static void compressData(embedDBState *state, uint8_t *bits, uint32_t *position, int8_t *data, int8_t *prevData) {
+    uint8_t numColumns = state->numDataColumns > 1 ? state->numDataColumns : 1;
+    uint16_t offset = 0;
+    for (uint8_t i = 0; i < numColumns; i++) {
+        uint8_t columnSize = numColumns > 1 ? abs(state->dataColumnSizes[i]) : state->dataSize;
+        while (columnSize > 0) {
+            uint8_t size = min(columnSize, 8);
+            uint64_t value = 0, prevValue = 0;
+            memcpy(&value, data + offset, size);
+            if (prevData == NULL) {
+                writeBits(bits, position, value, size * 8);
+            } else {
+                memcpy(&prevValue, prevData + offset, size);
+                compressValue(bits, position, value, prevValue, size * 8);
+            }
+            offset += size;
+            columnSize -= size;
+        }
+    }
+}
+
+/**
+ * @brief	Decompresses the data of a record written by compressData.
+ * @param	state		embedDB algorithm state structure
+ * @param	bits		Bit stream
+ * @param	position	Bit position in the stream
+ * @param	data		Return variable for the data of the record
+ * @param	prevData	Data of the previous record. NULL if the data is stored uncompressed
+ */
+static void decompressData(embedDBState *state, uint8_t *bits, uint32_t *position, int8_t *data, int8_t *prevData) {
+    uint8_t numColumns = state->numDataColumns > 1 ? state->numDataColumns : 1;
+    uint16_t offset = 0;
+    for (uint8_t i = 0; i < numColumns; i++) {
+        uint8_t columnSize = numColumns > 1 ? abs(state->dataColumnSizes[i]) : state->dataSize;
+        while (columnSize > 0) {
+            uint8_t size = min(columnSize, 8);
+            uint64_t value = 0, prevValue = 0;
+            if (prevData == NULL) {
+                value = readBits(bits, position, size * 8);
+            } else {
+                memcpy(&prevValue, prevData + offset, size);
+                value = decompressValue(bits, position, prevValue);
+            }
+            memcpy(data + offset, &value, size);
+            offset += size;
+            columnSize -= size;
+        }
+    }
+}
+
+/**
+ * @brief	Compresses a record of a data page against the records before it. The first record of a page is stored uncompressed.
+ * @param	state		embedDB algorithm state structure
+ * @param	bits		Bit stream. If NULL, only the position is advanced
+ * @param	position	Bit position in the stream
+ * @param	page		Uncompressed data page
+ * @param	record		Index of the record on the page
+ */
+static void compressRecord(embedDBState *state, uint8_t *bits, uint32_t *position, void *page, count_t record) {
+    int8_t data[INT8_MAX], prevData[INT8_MAX];
+    uint32_t varLocation = 0, prevVarLocation = 0;
+    embedDBCopyRecordData(state, page, record, data);
+    if (EMBEDDB_USING_VDATA(state->parameters))
+        memcpy(&varLocation, embedDBRecordVarLocation(state, page, record), sizeof(uint32_t));
+
+    if (record == 0) {
+        uint64_t key = 0;
+        memcpy(&key, embedDBRecordKey(state, page, 0), state->keySize);
+        writeBits(bits, position, key, state->keySize * 8);
+        compressData(state, bits, position, data, NULL);
+        if (EMBEDDB_USING_VDATA(state->parameters))
+            writeBits(bits, position, varLocation, 32);
+        return;
+    }
+
+    compressKey(state, bits, position, embedDBRecordKey(state, page, record), embedDBRecordKey(state, page, record - 1), record > 1 ? embedDBRecordKey(state, page, record - 2) : NULL);
+    embedDBCopyRecordData(state, page, record - 1, prevData);
+    compressData(state, bits, position, data, prevData);
+    if (EMBEDDB_USING_VDATA(state->parameters)) {
+        memcpy(&prevVarLocation, embedDBRecordVarLocation(state, page, record - 1), sizeof(uint32_t));
+        compressValue(bits, position, varLocation, prevVarLocation, 32);
+    }
+}
+
+/**
+ * @brief	Decompresses a record written by compressRecord onto an uncompressed data page that holds the records before it.
+ * @param	state		embedDB algorithm state structure
+ * @param	bits		Bit stream
+ * @param	position	Bit position in the stream
+ * @param	page		Uncompressed data page
+ * @param	record		Index of the record on the page
+ */
+static void decompressRecord(embedDBState *state, uint8_t *bits, uint32_t *position, void *page, count_t record) {
+    int8_t data[INT8_MAX], prevData[INT8_MAX];
+    uint64_t key = 0;
+    uint32_t varLocation = 0;
+
+    if (record == 0) {
+        key = readBits(bits, position, state->keySize * 8);
+        decompressData(state, bits, position, data, NULL);
+        if (EMBEDDB_USING_VDATA(state->parameters))
+            varLocation = (uint32_t)readBits(bits, position, 32);
+    } else {
+        decompressKey(state, bits, position, &key, embedDBRecordKey(state, page, record - 1), record > 1 ? embedDBRecordKey(state, page, record - 2) : NULL);
+        embedDBCopyRecordData(state, page, record - 1, prevData);
+        decompressData(state, bits, position, data, prevData);
+        if (EMBEDDB_USING_VDATA(state->parameters)) {
+            uint32_t prevVarLocation = 0;
+            memcpy(&prevVarLocation, embedDBRecordVarLocation(state, page, record - 1), sizeof(uint32_t));
+            varLocation = (uint32_t)decompressValue(bits, position, prevVarLocation);
+        }
+    }
+
+    embedDBWriteRecord(state, page, record, &key, data);
+    if (EMBEDDB_USING_VDATA(state->parameters))
+        memcpy(embedDBRecordVarLocation(state, page, record), &varLocation, sizeof(uint32_t));
+}
+
+/**
+ * @brief	Returns 1 if the data write buffer has no room for another record.
+ * 			A compressed page is full once the record would not fit in the compressed bits left on the page.
+ * 			The variable data location is counted at its largest size, so the result does not depend on where the variable data is written.
+ * @param	state	embedDB algorithm state structure
+ * @param	key		Key for the next record
+ * @param	data	Data for the next record
+ */
+static int8_t embedDBDataPageFull(embedDBState *state, void *key, void *data) {
+    void *page = state->dataWriteBuffer;
+    count_t count = EMBEDDB_GET_COUNT(page);
+    if (count >= state->maxRecordsPerPage)
+        return 1;
+    if (!EMBEDDB_USING_COMPRESSION(state->parameters) || count == 0)
+        return 0;
+
+    int8_t prevData[INT8_MAX];
+    uint32_t bits = state->compressedPageBits;
+    compressKey(state, NULL, &bits, key, embedDBRecordKey(state, page, count - 1), count > 1 ? embedDBRecordKey(state, page, count - 2) : NULL);
+    embedDBCopyRecordData(state, page, count - 1, prevData);
+    compressData(state, NULL, &bits, (int8_t *)data, prevData);
+    if (EMBEDDB_USING_VDATA(state->parameters))
+        bits += COMPRESSED_VALUE_MAX_BITS(32);
+    return bits > (uint32_t)state->pageSize * 8;
+}
+
+/**
+ * @brief	Compresses a data page into the data read buffer, which is free while pages are compressed as read pages are decompressed into their own buffer.
+ * 			The header is copied uncompressed.
+ * @param	state	embedDB algorithm state structure
+ * @param	page	Uncompressed data page
+ * @return	Pointer to the compressed page
+ */
+static void *compressPage(embedDBState *state, void *page) {
+    uint8_t *output = (uint8_t *)state->buffer + state->pageSize * EMBEDDB_DATA_READ_BUFFER;
+    memcpy(output, page, state->headerSize);
+    memset(output + state->headerSize, 0, state->pageSize - state->headerSize);
+
+    uint32_t position = state->headerSize * 8;
+    count_t count = EMBEDDB_GET_COUNT(page);
+    for (count_t i = 0; i < count; i++)
+        compressRecord(state, output, &position, page, i);
+    return output;
+}
+
+/**
+ * @brief	Decompresses a data page written by compressPage into the decompress buffer.
+ * @param	state	embedDB algorithm state structure
+ * @param	page	Compressed data page
+ */
+static void decompressPage(embedDBState *state, void *page) {
+    int8_t *output = (int8_t *)state->dataDecompressBuffer;
+    memcpy(output, page, state->headerSize);
+
+    uint32_t position = state->headerSize * 8;
+    count_t count = min(EMBEDDB_GET_COUNT(page), state->maxRecordsPerPage);
+    EMBEDDB_GET_COUNT(output) = count;
+    for (count_t i = 0; i < count; i++)
+        decompressRecord(state, (uint8_t *)page, &position, output, i);
+}
+
+/**
+ * @brief	Makes a data page read from storage the data read buffer. Compressed pages are decompressed first.
+ * @param	state	embedDB algorithm state structure
+ * @param	page	Data page as stored
+ */
+static inline void embedDBSetDataReadBuffer(embedDBState *state, void *page) {
+    state->dataReadBuffer = page;
+    if (EMBEDDB_USING_COMPRESSION(state->parameters)) {
+        decompressPage(state, page);
+        state->dataReadBuffer = state->dataDecompressBuffer;
+    }
+}
+
+/**
+ * @brief	Returns the key comparator passed to the spline and radix table, which compare keys as unsigned integers when it is NULL.
+ * @param	state	embedDB algorithm state structure
+ */
+static inline int8_t (*splineComparator(embedDBState *state))(void *, void *) {
+    return EMBEDDB_USING_UNSIGNED_KEYS(state->parameters) ? NULL : state->compareKey;
+}
+
+/**
+ * @brief	Returns the value of the summed column of a record.
+ * @param	state	embedDB algorithm state structure
+ * @param	data	Data of the record
+ */
+static inline int64_t embedDBSumValue(embedDBState *state, void *data) {
+    int8_t *column = (int8_t *)data + state->sumColumnOffset;
+    switch (state->sumColumnSize) {
+        case -1: {
+            int8_t value;
+            memcpy(&value, column, sizeof(value));
+            return value;
+        }
+        case 1: {
+            uint8_t value;
+            memcpy(&value, column, sizeof(value));
+            return value;
+        }
+        case -2: {
+            int16_t value;
+            memcpy(&value, column, sizeof(value));
+            return value;
+        }
+        case 2: {
+            uint16_t value;
+            memcpy(&value, column, sizeof(value));
+            return value;
+        }
+        case -4: {
+            int32_t value;
+            memcpy(&value, column, sizeof(value));
+            return value;
+        }
+        case 4: {
+            uint32_t value;
+            memcpy(&value, column, sizeof(value));
+            return value;
+        }
+        default: {
+            int64_t value;
+            memcpy(&value, column, sizeof(value));
+            return value;
+        }
+    }
+}
+
+/**
+ * @brief	Adds the summed column of a record to the sum in the header of a data page.
+ * @param	state	embedDB algorithm state structure
+ * @param	page	In memory data page
+ * @param	data	Data of the record
+ */
+static inline void embedDBAddToPageSum(embedDBState *state, void *page, void *data) {
+    int64_t sum;
+    memcpy(&sum, EMBEDDB_GET_SUM(page, state), sizeof(int64_t));
+    sum += embedDBSumValue(state, data);
+    memcpy(EMBEDDB_GET_SUM(page, state), &sum, sizeof(int64_t));
+}
+
+/**
+ * @brief	Returns the size of an index record. With EMBEDDB_USE_SUM the bitmap is followed by a summary of the data page:
+ * 			the record count, the sum, the min and max key, then the min and max data with EMBEDDB_USE_MAX_MIN.
+ * @param	state	embedDB algorithm state structure
+ */
+static inline uint16_t embedDBIndexRecordSize(embedDBState *state) {
+    if (!EMBEDDB_USING_SUM(state->parameters))
+        return state->bitmapSize;
+    return state->bitmapSize + sizeof(count_t) + sizeof(int64_t) + state->keySize * 2 + (EMBEDDB_USING_MAX_MIN(state->parameters) ? state->dataSize * 2 : 0);
+}
+
+/**
+ * @brief	Returns the size of a zone in the zone map, including its bitmap and data range. Rounded up so every zone is aligned.
+ * @param	state	embedDB algorithm state structure
+ */
+static inline uint32_t embedDBZoneSize(embedDBState *state) {
+    uint32_t size = sizeof(embedDBZone) + state->bitmapSize + (EMBEDDB_USING_MAX_MIN(state->parameters) ? state->dataSize * 2 : 0);
+    return (size + sizeof(id_t) - 1) / sizeof(id_t) * sizeof(id_t);
+}
+
+/**
+ * @brief	Returns the zone an index page is stored in. The zone map has one more zone than there are index pages so the index write buffer has a zone too.
+ * @param	state		embedDB algorithm state structure
+ * @param	indexPageId	Logical id of the index page
+ */
+static inline embedDBZone *embedDBGetZone(embedDBState *state, id_t indexPageId) {
+    return (embedDBZone *)((int8_t *)state->zoneMap + (indexPageId % (state->numIndexPages + 1)) * embedDBZoneSize(state));
+}
+
+/**
+ * @brief	Determines if the iterator can use the index or zone map to skip data pages.
+ * @param	state	embedDB algorithm state structure
+ * @param	it		embedDB iterator state structure
+ */
+static inline int8_t iteratorCanSkipPages(embedDBState *state, embedDBIterator *it) {
+    return it->queryBitmap != NULL || it->valuePages != NULL || (state->zoneMap != NULL && (it->minData != NULL || it->maxData != NULL));
+}
+
+/**
+ * @brief	Marks the start of a change to the state that readers take snapshots of. The sequence stays odd until snapshotEndWrite.
+ * 			Nested calls, like embedDBPutBatch inserting through embedDBPut, leave the sequence to the outermost call.
+ * @param	state	embedDB algorithm state structure
+ * @return	1 if this call started the change and must end it, 0 if a change was already in progress.
+ */
+static inline int8_t snapshotBeginWrite(embedDBState *state) {
+    uint32_t sequence = state->snapshotSequence;
+    if (sequence & 1)
+        return 0;
+    /* Let a reader that keeps missing the gaps between writes take its snapshot. The wait is bounded so a reader that is not scheduled cannot stop
+     * the writer, and the reader gets another chance before the next change */
+    for (uint32_t i = 0; i < SNAPSHOT_WRITER_WAIT && __atomic_load_n(&state->snapshotWaiting, __ATOMIC_ACQUIRE) != 0; i++) {
+        SPIN_PAUSE();
+#if SCAN_USE_THREADS
+        if (i >= SNAPSHOT_WRITER_SPINS)
+            sched_yield();
+#endif
+    }
+    __atomic_store_n(&state->snapshotSequence, sequence + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    return 1;
+}
+
+/**
+ * @brief	Marks the end of a change started by snapshotBeginWrite, after which readers can take a snapshot again.
+ * @param	state	embedDB algorithm state structure
+ * @param	began	Return value of snapshotBeginWrite
+ */
+static inline void snapshotEndWrite(embedDBState *state, int8_t began) {
+    if (began)
+        __atomic_store_n(&state->snapshotSequence, state->snapshotSequence + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief	Determines if writing pages to a file would erase pages still held by the snapshot of a reader. Must be called between snapshotBeginWrite and snapshotEndWrite.
+ * @param	state		embedDB algorithm state structure
+ * @param	fileType	EMBEDDB_DATA_FILE or EMBEDDB_INDEX_FILE
+ * @param	numPages	Number of pages about to be written
+ * @return	1 if a snapshot holds a page that would be erased, 0 if not.
+ */
+static int8_t snapshotHoldsErasedPages(embedDBState *state, uint8_t fileType, uint32_t numPages) {
+    uint32_t numAvailPages = fileType == EMBEDDB_DATA_FILE ? state->numAvailDataPages : state->numAvailIndexPages;
+    if (numPages <= numAvailPages)
+        return 0;
+    uint32_t numErases = (numPages - numAvailPages + state->eraseSizeInPages - 1) / state->eraseSizeInPages;
+    id_t firstKeptPageId = (fileType == EMBEDDB_DATA_FILE ? state->minDataPageId : state->minIndexPageId) + numErases * state->eraseSizeInPages;
+
+    /* The sequence is already odd, so a reader pinning its pages after this point sees the change and takes its snapshot again */
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    for (uint8_t i = 0; i < EMBEDDB_MAX_READERS; i++) {
+        embedDBSnapshotPin *pin = &state->snapshotPins[i];
+        id_t pinnedPageId = __atomic_load_n(fileType == EMBEDDB_DATA_FILE ? &pin->minDataPageId : &pin->minIndexPageId, __ATOMIC_RELAXED);
+        if (pinnedPageId < firstKeptPageId)
+            return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief	Determines if writing data pages, and the index pages they fill, would erase pages still held by the snapshot of a reader.
+ * @param	state			embedDB algorithm state structure
+ * @param	numDataPages	Number of data pages about to be written
+ * @param	flush			1 if the index write buffer is written after the data pages, as embedDBFlush does
+ * @return	1 if a snapshot holds a page that would be erased, 0 if not.
+ */
+static int8_t snapshotHoldsNextPages(embedDBState *state, uint32_t numDataPages, int8_t flush) {
+    if (numDataPages == 0 || snapshotHoldsErasedPages(state, EMBEDDB_DATA_FILE, numDataPages))
+        return numDataPages != 0;
+    if (state->indexFile == NULL)
+        return 0;
+    void *indexBuffer = (int8_t *)state->buffer + state->pageSize * EMBEDDB_INDEX_WRITE_BUFFER;
+    uint32_t numIndexPages = flush ? 1 : (EMBEDDB_GET_COUNT(indexBuffer) + numDataPages - 1) / state->maxIdxRecordsPerPage;
+    return snapshotHoldsErasedPages(state, EMBEDDB_INDEX_FILE, numIndexPages);
+}
 
 void printBitmap(char *bm) {
     for (int8_t i = 0; i <= 7; i++) {
@@ -84,26 +917,159 @@ void printBitmap(char *bm) {
 }
 
 /**
- * @brief	Determine if two bitmaps have any overlapping bits
+ * @brief	Determine if two bitmaps have any overlapping bits. The bitmaps are compared 8 bytes at a time.
  * @return	1 if there is any overlap, else 0
  */
 int8_t bitmapOverlap(uint8_t *bm1, uint8_t *bm2, int8_t size) {
-    for (int8_t i = 0; i < size; i++)
-        if ((*((uint8_t *)(bm1 + i)) & *((uint8_t *)(bm2 + i))) >= 1)
+    int8_t i = 0;
+    for (; i + (int8_t)sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+        uint64_t word1, word2;
+        memcpy(&word1, bm1 + i, sizeof(uint64_t));
+        memcpy(&word2, bm2 + i, sizeof(uint64_t));
+        if (word1 & word2)
             return 1;
+    }
+    if (i < size) {
+        /* Compare the bytes left over as one word */
+        uint64_t word1 = 0, word2 = 0;
+        memcpy(&word1, bm1 + i, size - i);
+        memcpy(&word2, bm2 + i, size - i);
+        if (word1 & word2)
+            return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief	Compares two int32_t values for qsort.
+ */
+static int compareInt32(const void *a, const void *b) {
+    int32_t i1 = *(const int32_t *)a, i2 = *(const int32_t *)b;
+    return (i1 > i2) - (i1 < i2);
+}
+
+int8_t embedDBLearnBitmapBuckets(embedDBBitmapBuckets *buckets, int32_t *values, uint32_t numValues, uint8_t numBuckets) {
+    if (numValues == 0 || numBuckets == 0 || numBuckets > EMBEDDB_MAX_BITMAP_BUCKETS)
+        return -1;
 
+    qsort(values, numValues, sizeof(int32_t), compareInt32);
+
+    /* The upper bound of each bucket is the value at its quantile. Repeated values would make empty buckets so they are skipped */
+    uint8_t numBoundaries = 0;
+    for (uint8_t i = 1; i < numBuckets; i++) {
+        uint32_t rank = (uint64_t)numValues * i / numBuckets;
+        int32_t boundary = values[rank > 0 ? rank - 1 : 0];
+        if (numBoundaries > 0 && boundary <= buckets->boundaries[numBoundaries - 1])
+            continue;
+        buckets->boundaries[numBoundaries++] = boundary;
+    }
+    buckets->numBuckets = numBoundaries + 1;
     return 0;
 }
 
+/**
+ * @brief	Returns the bucket of a value. A binary search for the number of boundaries smaller than the value.
+ * @param	buckets	Bucket boundaries
+ * @param	value	Value to find the bucket of
+ */
+static inline uint8_t bitmapBucket(embedDBBitmapBuckets *buckets, int32_t value) {
+    uint8_t low = 0, high = buckets->numBuckets - 1;
+    while (low < high) {
+        uint8_t mid = (low + high) / 2;
+        if (buckets->boundaries[mid] < value)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    return low;
+}
+
+/**
+ * @brief	Returns the value of the column the bucket bitmap is built on.
+ * @param	state	embedDB algorithm state structure
+ * @param	data	Data of a record
+ */
+static inline int32_t bitmapBucketValue(embedDBState *state, void *data) {
+    int32_t value;
+    memcpy(&value, (int8_t *)data + state->bitmapBuckets->columnOffset, sizeof(int32_t));
+    return value;
+}
+
+/**
+ * @brief	Adds the data of a record to a bitmap, using the bucket boundaries with EMBEDDB_USE_BITMAP_BUCKETS and state->updateBitmap otherwise.
+ * @param	state	embedDB algorithm state structure
+ * @param	data	Data of the record
+ * @param	bm		Bitmap to update
+ */
+static inline void embedDBUpdateBitmap(embedDBState *state, void *data, void *bm) {
+    if (!EMBEDDB_USING_BITMAP_BUCKETS(state->parameters)) {
+        state->updateBitmap(data, bm);
+        return;
+    }
+    uint8_t bucket = bitmapBucket(state->bitmapBuckets, bitmapBucketValue(state, data));
+    ((uint8_t *)bm)[bucket / 8] |= 1 << (bucket % 8);
+}
+
+/**
+ * @brief	Builds the bitmap of the buckets that may hold data between the min and max data.
+ * @param	state	embedDB algorithm state structure
+ * @param	minData	Smallest data. NULL for no lower bound
+ * @param	maxData	Largest data. NULL for no upper bound
+ * @param	bm		Bitmap to set. Must be cleared
+ */
+static void embedDBBuildBitmapFromRange(embedDBState *state, void *minData, void *maxData, void *bm) {
+    if (!EMBEDDB_USING_BITMAP_BUCKETS(state->parameters)) {
+        state->buildBitmapFromRange(minData, maxData, bm);
+        return;
+    }
+    /* Every page written while the boundaries are learned has every bit set */
+    if (state->bitmapSample != NULL) {
+        memset(bm, 0xFF, state->bitmapSize);
+        return;
+    }
+    uint8_t first = minData != NULL ? bitmapBucket(state->bitmapBuckets, bitmapBucketValue(state, minData)) : 0;
+    uint8_t last = maxData != NULL ? bitmapBucket(state->bitmapBuckets, bitmapBucketValue(state, maxData)) : state->bitmapBuckets->numBuckets - 1;
+    for (uint16_t bucket = first; bucket <= last; bucket++)
+        ((uint8_t *)bm)[bucket / 8] |= 1 << (bucket % 8);
+}
+
+/**
+ * @brief	Adds the data of a record inserted in the data write buffer to the sample used to learn the bucket boundaries.
+ * 			Pages are given every bit of the bitmap until the sample is full. The boundaries are then learned and the bitmap of the write buffer is rebuilt with them.
+ * @param	state	embedDB algorithm state structure
+ * @param	data	Data of the record
+ */
+static void bitmapAddSample(embedDBState *state, void *data) {
+    void *bm = EMBEDDB_GET_BITMAP(state->dataWriteBuffer);
+    state->bitmapSample[state->numBitmapSamples++] = bitmapBucketValue(state, data);
+    memset(bm, 0xFF, state->bitmapSize);
+    if (state->numBitmapSamples < (uint32_t)state->bitmapBuckets->numSamplePages * state->maxRecordsPerPage)
+        return;
+
+    embedDBLearnBitmapBuckets(state->bitmapBuckets, state->bitmapSample, state->numBitmapSamples, min(state->bitmapSize * 8, EMBEDDB_MAX_BITMAP_BUCKETS));
+    free(state->bitmapSample);
+    state->bitmapSample = NULL;
+
+    int8_t dataScratch[INT8_MAX];
+    memset(bm, 0, state->bitmapSize);
+    count_t count = EMBEDDB_GET_COUNT(state->dataWriteBuffer);
+    for (count_t i = 0; i < count; i++)
+        embedDBUpdateBitmap(state, embedDBRecordData(state, state->dataWriteBuffer, i, dataScratch), bm);
+}
+
 void initBufferPage(embedDBState *state, int pageNum) {
     /* Initialize page */
     uint16_t i = 0;
     void *buf = (char *)state->buffer + pageNum * state->pageSize;
-
-    for (i = 0; i < state->pageSize; i++) {
-        ((int8_t *)buf)[i] = 0;
+    uint32_t size = state->pageSize;
+    if (pageNum == EMBEDDB_DATA_WRITE_BUFFER) {
+        buf = state->dataWriteBuffer;
+        size = embedDBDataPageSize(state);
+        state->compressedPageBits = state->headerSize * 8;
     }
 
+    memset(buf, 0, size);
+
     if (pageNum != EMBEDDB_VAR_WRITE_BUFFER(state->parameters)) {
         /* Initialize header key min. Max and sum is already set to zero by the
          * for-loop above */
@@ -160,7 +1126,7 @@ void *embedDBGetMinKey(embedDBState *state, void *buffer) {
  */
 void *embedDBGetMaxKey(embedDBState *state, void *buffer) {
     int16_t count = EMBEDDB_GET_COUNT(buffer);
-    return (void *)((int8_t *)buffer + state->headerSize + (count - 1) * state->recordSize);
+    return embedDBRecordKey(state, buffer, count - 1);
 }
 
 /**
@@ -177,11 +1143,94 @@ int8_t embedDBInit(embedDBState *state, size_t indexMaxError) {
         return -1;
     }
 
+    /* Select the method used to find data pages */
+    if (EMBEDDB_USING_BINARY_SEARCH(state->parameters) + EMBEDDB_USING_ESTIMATE_SEARCH(state->parameters) + EMBEDDB_USING_RADIX(state->parameters) > 1) {
+#ifdef PRINT_ERRORS
+        printf("ERROR: Only one of EMBEDDB_USE_BINARY_SEARCH, EMBEDDB_USE_ESTIMATE_SEARCH and EMBEDDB_USE_RADIX can be set.\n");
+#endif
+        return -1;
+    }
+    if (EMBEDDB_USING_RADIX(state->parameters) && (state->radixBits == 0 || state->radixBits > 32)) {
+#ifdef PRINT_ERRORS
+        printf("ERROR: Radix table must index between 1 and 32 bits.\n");
+#endif
+        return -1;
+    }
+    if (EMBEDDB_USING_BINARY_SEARCH(state->parameters)) {
+        state->searchMethod = EMBEDDB_SEARCH_BINARY;
+    } else if (EMBEDDB_USING_ESTIMATE_SEARCH(state->parameters)) {
+        state->searchMethod = EMBEDDB_SEARCH_ESTIMATE;
+    } else {
+        state->searchMethod = EMBEDDB_SEARCH_SPLINE;
+    }
+    if (!EMBEDDB_USING_RADIX(state->parameters))
+        state->radixBits = 0;
+    state->spl = NULL;
+    state->rdix = NULL;
+    state->cleanSpline = 0;
+    state->clock = NULL;
+    state->insertListener = NULL;
+    state->insertListenerError = 0;
+    embedDBResetStats(state);
+
     state->recordSize = state->keySize + state->dataSize;
     if (EMBEDDB_USING_VDATA(state->parameters)) {
         state->recordSize += 4;
     }
 
+    /* Data columns of a PAX or compressed page must add up to the data size */
+    if ((EMBEDDB_USING_PAX(state->parameters) || EMBEDDB_USING_COMPRESSION(state->parameters)) && state->numDataColumns > 1) {
+        int16_t columnsSize = 0;
+        for (uint8_t i = 0; i < state->numDataColumns; i++)
+            columnsSize += abs(state->dataColumnSizes[i]);
+        if (columnsSize != state->dataSize) {
+#ifdef PRINT_ERRORS
+            printf("ERROR: Sum of the data column sizes (%d) does not match the data size (%d).\n", columnsSize, state->dataSize);
+#endif
+            return -1;
+        }
+    }
+
+    /* The summed column must be an integer inside the data */
+    if (EMBEDDB_USING_SUM(state->parameters)) {
+        uint8_t sumSize = abs(state->sumColumnSize);
+        if ((sumSize != 1 && sumSize != 2 && sumSize != 4 && sumSize != 8) || state->sumColumnOffset + sumSize > state->dataSize) {
+#ifdef PRINT_ERRORS
+            printf("ERROR: Sum column must be 1, 2, 4 or 8 bytes inside the data.\n");
+#endif
+            return -1;
+        }
+    }
+
+    /* Zones summarize index pages */
+    if (EMBEDDB_USING_ZONE_MAP(state->parameters) && !EMBEDDB_USING_INDEX(state->parameters)) {
+#ifdef PRINT_ERRORS
+        printf("ERROR: embedDB using a zone map requires an index.\n");
+#endif
+        return -1;
+    }
+
+    /* Bucket bitmaps have one bit per bucket and are built on an int32_t column */
+    state->bitmapSample = NULL;
+    if (EMBEDDB_USING_BITMAP_BUCKETS(state->parameters)) {
+        embedDBBitmapBuckets *buckets = state->bitmapBuckets;
+        if (!EMBEDDB_USING_BMAP(state->parameters) || buckets == NULL || state->bitmapSize < 1 || state->bitmapSize > 8 || buckets->numBuckets > state->bitmapSize * 8 || buckets->columnOffset + sizeof(int32_t) > (uint8_t)state->dataSize || (buckets->numBuckets == 0 && buckets->numSamplePages == 0)) {
+#ifdef PRINT_ERRORS
+            printf("ERROR: Bitmap buckets require a bitmap of 1 to 8 bytes, at most 8 buckets per byte, an int32_t column inside the data and sample pages if the boundaries are learned.\n");
+#endif
+            return -1;
+        }
+    }
+
+    /* The value index is built on an int32_t column inside the data */
+    state->valueIndex = NULL;
+    if (EMBEDDB_USING_VALUE_INDEX(state->parameters) && state->valueIndexColumnOffset + sizeof(int32_t) > (uint8_t)state->dataSize) {
+#ifdef PRINT_ERRORS
+        printf("ERROR: The value index requires an int32_t column inside the data.\n");
+#endif
+        return -1;
+    }
+
     state->indexMaxError = indexMaxError;
 
     /* Calculate block header size */
@@ -191,23 +1240,59 @@ int8_t embedDBInit(embedDBState *state, size_t indexMaxError) {
     if (EMBEDDB_USING_INDEX(state->parameters))
         state->headerSize += state->bitmapSize;
 
+    /* The min/max values and the sum are stored from EMBEDDB_MIN_OFFSET, so leave room for the bitmap even without an index */
+    if (EMBEDDB_USING_MAX_MIN(state->parameters) || EMBEDDB_USING_SUM(state->parameters))
+        state->headerSize = max(state->headerSize, EMBEDDB_MIN_OFFSET);
+
     if (EMBEDDB_USING_MAX_MIN(state->parameters))
         state->headerSize += state->keySize * 2 + state->dataSize * 2;
 
+    if (EMBEDDB_USING_SUM(state->parameters))
+        state->headerSize += sizeof(int64_t);
+
     /* Flags to show that these values have not been initalized with actual data yet */
     state->minKey = UINT32_MAX;
+    state->maxKey = 0;
     state->bufferedPageId = -1;
     state->bufferedIndexPageId = -1;
     state->bufferedVarPage = -1;
+    state->bufferPool = NULL;
+    state->zoneMap = NULL;
+    state->dataReadBuffer = (int8_t *)state->buffer + state->pageSize * EMBEDDB_DATA_READ_BUFFER;
+
+    /* No reader handles are open yet */
+    state->snapshotSequence = 0;
+    state->snapshotWaiting = 0;
+    for (uint8_t i = 0; i < EMBEDDB_MAX_READERS; i++) {
+        state->snapshotPins[i].inUse = 0;
+        state->snapshotPins[i].minDataPageId = UINT32_MAX;
+        state->snapshotPins[i].minIndexPageId = UINT32_MAX;
+    }
 
     /* Calculate number of records per page */
     state->maxRecordsPerPage = (state->pageSize - state->headerSize) / state->recordSize;
 
+    /* Allocate first page of buffer as output page */
+    state->dataWriteBuffer = (int8_t *)state->buffer + state->pageSize * EMBEDDB_DATA_WRITE_BUFFER;
+    state->dataDecompressBuffer = NULL;
+
+    /* Compressed pages hold more records than fit on a page, so the write buffer and the decompressed read page are allocated separately */
+    if (EMBEDDB_USING_COMPRESSION(state->parameters)) {
+        state->maxRecordsPerPage = (count_t)min((uint32_t)state->maxRecordsPerPage * COMPRESSED_RECORDS_FACTOR, UINT16_MAX);
+        state->dataWriteBuffer = malloc(embedDBDataPageSize(state));
+        state->dataDecompressBuffer = malloc(embedDBDataPageSize(state));
+        if (state->dataWriteBuffer == NULL || state->dataDecompressBuffer == NULL) {
+#ifdef PRINT_ERRORS
+            printf("ERROR: Failed to allocate the buffers for compressed pages.\n");
+#endif
+            return -1;
+        }
+    }
+
     /* Initialize max error to maximum records per page */
     state->maxError = state->maxRecordsPerPage;
 
-    /* Allocate first page of buffer as output page */
-    initBufferPage(state, 0);
+    initBufferPage(state, EMBEDDB_DATA_WRITE_BUFFER);
 
     if (state->numDataPages < (EMBEDDB_USING_INDEX(state->parameters) * 2 + 2) * state->eraseSizeInPages) {
 #ifdef PRINT_ERRORS
@@ -216,12 +1301,19 @@ int8_t embedDBInit(embedDBState *state, size_t indexMaxError) {
         return -1;
     }
 
+    /* Setup buffer pool using the buffer pages past the fixed read/write buffers */
+    if (EMBEDDB_USING_BUFFER_POOL(state->parameters)) {
+        if (embedDBInitBufferPool(state) != 0) {
+            return -1;
+        }
+    }
+
     /* Initalize the spline or radix spline structure if either are to be used */
-    if (SEARCH_METHOD == 2) {
+    if (state->searchMethod == EMBEDDB_SEARCH_SPLINE) {
         state->cleanSpline = 1;
         int8_t splineInitResult = 0;
-        if (RADIX_BITS > 0) {
-            splineInitResult = initRadixSpline(state, RADIX_BITS);
+        if (state->radixBits > 0) {
+            splineInitResult = initRadixSpline(state, state->radixBits);
 
         } else {
             state->spl = malloc(sizeof(spline));
@@ -235,56 +1327,260 @@ int8_t embedDBInit(embedDBState *state, size_t indexMaxError) {
         }
     }
 
-    /* Allocate file for data*/
-    int8_t dataInitResult = 0;
-    dataInitResult = embedDBInitData(state);
+    /* Load the newest checkpoint so recovery only has to read the pages written after it */
+    embedDBCheckpointInfo checkpointInfo;
+    embedDBCheckpointInfo *checkpoint = NULL;
+    state->checkpointSequence = 0;
+    if (EMBEDDB_USING_CHECKPOINT(state->parameters)) {
+        int8_t checkpointResult = embedDBInitCheckpoint(state, &checkpointInfo);
+        if (checkpointResult < 0)
+            return -1;
+        if (checkpointResult == 1)
+            checkpoint = &checkpointInfo;
+    }
+
+    /* Allocate file for data*/
+    int8_t dataInitResult = 0;
+    dataInitResult = embedDBInitData(state, checkpoint);
+
+    if (dataInitResult != 0) {
+        return dataInitResult;
+    }
+
+    /* Start sampling to learn the bucket boundaries. The bitmaps of recovered pages can only be used with the boundaries they were built with */
+    if (EMBEDDB_USING_BITMAP_BUCKETS(state->parameters) && state->bitmapBuckets->numBuckets == 0) {
+        if (state->nextDataPageId > 0) {
+#ifdef PRINT_ERRORS
+            printf("ERROR: The bucket boundaries learned for the recovered data must be provided.\n");
+#endif
+            return -1;
+        }
+        state->numBitmapSamples = 0;
+        state->bitmapSample = malloc((size_t)state->bitmapBuckets->numSamplePages * state->maxRecordsPerPage * sizeof(int32_t));
+        if (state->bitmapSample == NULL) {
+#ifdef PRINT_ERRORS
+            printf("ERROR: Failed to allocate the sample for the bitmap buckets.\n");
+#endif
+            return -1;
+        }
+    }
+
+    /* Allocate file and buffer for index */
+    int8_t indexInitResult = 0;
+    if (EMBEDDB_USING_INDEX(state->parameters)) {
+        if (state->bufferSizeInBlocks < 4) {
+#ifdef PRINT_ERRORS
+            printf("ERROR: embedDB using index requires at least 4 page buffers.\n");
+#endif
+            return -1;
+        } else {
+            indexInitResult = embedDBInitIndex(state, checkpoint);
+        }
+    } else {
+        state->indexFile = NULL;
+        state->numIndexPages = 0;
+    }
+
+    if (indexInitResult != 0) {
+        return indexInitResult;
+    }
+
+    /* Allocate file and buffers for the value index */
+    if (EMBEDDB_USING_VALUE_INDEX(state->parameters)) {
+        if (embedDBInitValueIndex(state) != 0)
+            return -1;
+    }
+
+    /* Allocate file and buffer for variable data */
+    int8_t varDataInitResult = 0;
+    if (EMBEDDB_USING_VDATA(state->parameters)) {
+        if (state->bufferSizeInBlocks < 4 + (EMBEDDB_USING_INDEX(state->parameters) ? 2 : 0)) {
+#ifdef PRINT_ERRORS
+            printf("ERROR: embedDB using variable records requires at least 4 page buffers if there is no index and 6 if there is.\n");
+#endif
+            return -1;
+        } else {
+            varDataInitResult = embedDBInitVarData(state, checkpoint);
+        }
+        return varDataInitResult;
+    } else {
+        state->varFile = NULL;
+        state->numVarPages = 0;
+    }
+
+    embedDBResetStats(state);
+    return 0;
+}
+
+/**
+ * @brief   Sets up the buffer pool in the pages of the buffer that are not used by the fixed read/write buffers.
+ * @param   state   embedDB algorithm state structure
+ * @return  Return 0 if success. Non-zero value if error.
+ */
+int8_t embedDBInitBufferPool(embedDBState *state) {
+    int32_t numFrames = (int32_t)state->bufferSizeInBlocks - EMBEDDB_NUM_FIXED_BUFFERS(state->parameters);
+    if (numFrames < 1) {
+#ifdef PRINT_ERRORS
+        printf("ERROR: embedDB buffer pool requires at least one page buffer past the %d fixed read/write buffers.\n", EMBEDDB_NUM_FIXED_BUFFERS(state->parameters));
+#endif
+        return -1;
+    }
+
+    embedDBBufferPool *pool = malloc(sizeof(embedDBBufferPool));
+    if (pool == NULL) {
+#ifdef PRINT_ERRORS
+        printf("ERROR: Failed to allocate buffer pool.\n");
+#endif
+        return -1;
+    }
+    pool->frames = malloc(numFrames * sizeof(embedDBBufferFrame));
+    if (pool->frames == NULL) {
+#ifdef PRINT_ERRORS
+        printf("ERROR: Failed to allocate buffer pool frames.\n");
+#endif
+        free(pool);
+        return -1;
+    }
+
+    pool->pages = (int8_t *)state->buffer + EMBEDDB_NUM_FIXED_BUFFERS(state->parameters) * state->pageSize;
+    pool->numFrames = numFrames;
+    pool->clockHand = 0;
+    for (uint16_t i = 0; i < pool->numFrames; i++) {
+        pool->frames[i].pageId = UINT32_MAX;
+        pool->frames[i].fileType = EMBEDDB_DATA_FILE;
+        pool->frames[i].referenced = 0;
+    }
+
+    state->bufferPool = pool;
+    return 0;
+}
+
+/**
+ * @brief   Searches the buffer pool for a page.
+ * @param   state       embedDB algorithm state structure
+ * @param   fileType    File the page belongs to (EMBEDDB_DATA_FILE, EMBEDDB_INDEX_FILE or EMBEDDB_VAR_FILE)
+ * @param   pageNum     Physical page number
+ * @return  Pointer to the cached page, NULL if the page is not in the pool.
+ */
+void *bufferPoolFind(embedDBState *state, uint8_t fileType, id_t pageNum) {
+    embedDBBufferPool *pool = state->bufferPool;
+    for (uint16_t i = 0; i < pool->numFrames; i++) {
+        if (pool->frames[i].pageId == pageNum && pool->frames[i].fileType == fileType) {
+            pool->frames[i].referenced = 1;
+            return (int8_t *)pool->pages + i * state->pageSize;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief   Chooses the buffer pool frame to replace using the clock algorithm.
+ * @param   state       embedDB algorithm state structure
+ * @return  Index of the frame to replace.
+ */
+uint16_t bufferPoolVictim(embedDBState *state) {
+    embedDBBufferPool *pool = state->bufferPool;
+
+    /* Advance the clock hand, giving a second chance to every referenced frame it passes */
+    while (pool->frames[pool->clockHand].referenced) {
+        pool->frames[pool->clockHand].referenced = 0;
+        pool->clockHand = (pool->clockHand + 1) % pool->numFrames;
+    }
+
+    uint16_t victim = pool->clockHand;
+    pool->clockHand = (pool->clockHand + 1) % pool->numFrames;
+    return victim;
+}
 
-    if (dataInitResult != 0) {
-        return dataInitResult;
-    }
+/**
+ * @brief   Copies a page into the buffer pool, replacing a frame chosen by the clock algorithm.
+ * @param   state       embedDB algorithm state structure
+ * @param   fileType    File the page belongs to (EMBEDDB_DATA_FILE, EMBEDDB_INDEX_FILE or EMBEDDB_VAR_FILE)
+ * @param   pageNum     Physical page number
+ * @param   page        Page data to cache
+ */
+void bufferPoolInsert(embedDBState *state, uint8_t fileType, id_t pageNum, void *page) {
+    embedDBBufferPool *pool = state->bufferPool;
+    uint16_t victim = bufferPoolVictim(state);
+
+    memcpy((int8_t *)pool->pages + victim * state->pageSize, page, state->pageSize);
+    pool->frames[victim].pageId = pageNum;
+    pool->frames[victim].fileType = fileType;
+    pool->frames[victim].referenced = 1;
+}
 
-    /* Allocate file and buffer for index */
-    int8_t indexInitResult = 0;
-    if (EMBEDDB_USING_INDEX(state->parameters)) {
-        if (state->bufferSizeInBlocks < 4) {
-#ifdef PRINT_ERRORS
-            printf("ERROR: embedDB using index requires at least 4 page buffers.\n");
-#endif
-            return -1;
-        } else {
-            indexInitResult = embedDBInitIndex(state);
-        }
-    } else {
-        state->indexFile = NULL;
-        state->numIndexPages = 0;
+/**
+ * @brief   Reads consecutive pages from storage into the buffer pool with one call to fileInterface->readMany.
+ *          The run stops early at the first page that is already buffered, and uses at most half of the pool.
+ * @param   state       embedDB algorithm state structure
+ * @param   fileType    File the pages belong to (EMBEDDB_DATA_FILE or EMBEDDB_INDEX_FILE)
+ * @param   file        File to read from
+ * @param   pageNum     Physical page number of the first page
+ * @param   numPages    Number of pages to read
+ * @return  Number of pages read into the buffer pool.
+ */
+uint32_t bufferPoolReadAhead(embedDBState *state, uint8_t fileType, void *file, id_t pageNum, uint32_t numPages) {
+    embedDBBufferPool *pool = state->bufferPool;
+    uint16_t frames[max(READ_AHEAD_PAGES, 1)];
+    void *pages[max(READ_AHEAD_PAGES, 1)];
+    id_t bufferedId = fileType == EMBEDDB_DATA_FILE ? state->bufferedPageId : state->bufferedIndexPageId;
+
+    numPages = min(numPages, min(max(READ_AHEAD_PAGES, 1), max(pool->numFrames / 2, 1)));
+    uint32_t count = 0;
+    while (count < numPages) {
+        if (pageNum + count == bufferedId || bufferPoolFind(state, fileType, pageNum + count) != NULL)
+            break;
+
+        /* A frame already taken by this run can come around again once its reference bit is cleared */
+        uint16_t frame;
+        uint32_t taken;
+        do {
+            frame = bufferPoolVictim(state);
+            for (taken = 0; taken < count && frames[taken] != frame; taken++) {
+            }
+        } while (taken < count);
+
+        frames[count] = frame;
+        pages[count] = (int8_t *)pool->pages + frame * state->pageSize;
+        count++;
     }
 
-    if (indexInitResult != 0) {
-        return indexInitResult;
+    if (count == 0)
+        return 0;
+
+    uint32_t numRead = state->fileInterface->readMany(pages, pageNum, count, state->pageSize, file);
+    for (uint32_t i = 0; i < count; i++) {
+        pool->frames[frames[i]].pageId = i < numRead ? pageNum + i : UINT32_MAX;
+        pool->frames[frames[i]].fileType = fileType;
+        pool->frames[frames[i]].referenced = i < numRead;
     }
 
-    /* Allocate file and buffer for variable data */
-    int8_t varDataInitResult = 0;
-    if (EMBEDDB_USING_VDATA(state->parameters)) {
-        if (state->bufferSizeInBlocks < 4 + (EMBEDDB_USING_INDEX(state->parameters) ? 2 : 0)) {
-#ifdef PRINT_ERRORS
-            printf("ERROR: embedDB using variable records requires at least 4 page buffers if there is no index and 6 if there is.\n");
-#endif
-            return -1;
-        } else {
-            varDataInitResult = embedDBInitVarData(state);
+    if (fileType == EMBEDDB_DATA_FILE)
+        state->numReads += numRead;
+    else
+        state->numIdxReads += numRead;
+    state->stats.files[fileType].reads += numRead;
+    return numRead;
+}
+
+/**
+ * @brief   Removes a page from the buffer pool. Used when the physical page is overwritten in storage.
+ * @param   state       embedDB algorithm state structure
+ * @param   fileType    File the page belongs to (EMBEDDB_DATA_FILE, EMBEDDB_INDEX_FILE or EMBEDDB_VAR_FILE)
+ * @param   pageNum     Physical page number
+ */
+void bufferPoolInvalidate(embedDBState *state, uint8_t fileType, id_t pageNum) {
+    embedDBBufferPool *pool = state->bufferPool;
+    for (uint16_t i = 0; i < pool->numFrames; i++) {
+        if (pool->frames[i].pageId == pageNum && pool->frames[i].fileType == fileType) {
+            pool->frames[i].pageId = UINT32_MAX;
+            pool->frames[i].referenced = 0;
+            return;
         }
-        return varDataInitResult;
-    } else {
-        state->varFile = NULL;
-        state->numVarPages = 0;
     }
-
-    embedDBResetStats(state);
-    return 0;
 }
 
-int8_t embedDBInitData(embedDBState *state) {
+int8_t embedDBInitData(embedDBState *state, embedDBCheckpointInfo *checkpoint) {
     state->nextDataPageId = 0;
     state->avgKeyDiff = 1;
     state->nextDataPageId = 0;
@@ -302,10 +1598,14 @@ int8_t embedDBInitData(embedDBState *state) {
     if (!EMBEDDB_RESETING_DATA(state->parameters)) {
         int8_t openStatus = state->fileInterface->open(state->dataFile, EMBEDDB_FILE_MODE_R_PLUS_B);
         if (openStatus) {
-            return embedDBInitDataFromFile(state);
+            return embedDBInitDataFromFile(state, checkpoint);
         }
     }
 
+    /* The checkpoint spline describes pages that are no longer on file */
+    if (checkpoint != NULL)
+        embedDBResetSpline(state);
+
     int8_t openStatus = state->fileInterface->open(state->dataFile, EMBEDDB_FILE_MODE_W_PLUS_B);
     if (!openStatus) {
 #ifdef PRINT_ERRORS
@@ -317,58 +1617,68 @@ int8_t embedDBInitData(embedDBState *state) {
     return 0;
 }
 
-int8_t embedDBInitDataFromFile(embedDBState *state) {
-    id_t logicalPageId = 0;
-    id_t maxLogicalPageId = 0;
-    id_t physicalPageId = 0;
-
-    /* This will become zero if there is no more to read */
-    int8_t moreToRead = !(readPage(state, physicalPageId));
-
-    bool haveWrappedInMemory = false;
-    int count = 0;
-    void *buffer = (int8_t *)state->buffer + state->pageSize;
-    while (moreToRead && count < state->numDataPages) {
-        memcpy(&logicalPageId, buffer, sizeof(id_t));
-        if (count == 0 || logicalPageId == maxLogicalPageId + 1) {
-            maxLogicalPageId = logicalPageId;
-            physicalPageId++;
-            updateMaxiumError(state, buffer);
-            moreToRead = !(readPage(state, physicalPageId));
-            count++;
-        } else {
-            haveWrappedInMemory = logicalPageId == (maxLogicalPageId - state->numDataPages + 1);
-            break;
-        }
-    }
+int8_t embedDBInitDataFromFile(embedDBState *state, embedDBCheckpointInfo *checkpoint) {
+    id_t minPageId = 0, nextPageId = 0;
+    int8_t usedCheckpoint = embedDBFindPageRange(state, EMBEDDB_DATA_FILE, state->numDataPages, checkpoint != NULL ? checkpoint->nextDataPageId : 0, &minPageId, &nextPageId);
 
-    if (count == 0)
+    if (usedCheckpoint < 0) {
+        if (checkpoint != NULL)
+            embedDBResetSpline(state);
         return 0;
-
-    state->nextDataPageId = maxLogicalPageId + 1;
-    state->minDataPageId = 0;
-    id_t physicalPageIDOfSmallestData = 0;
-    if (haveWrappedInMemory) {
-        physicalPageIDOfSmallestData = logicalPageId % state->numDataPages;
     }
-    readPage(state, physicalPageIDOfSmallestData);
-    memcpy(&(state->minDataPageId), buffer, sizeof(id_t));
-    state->numAvailDataPages = state->numDataPages + state->minDataPageId - maxLogicalPageId - 1;
-    if (state->keySize <= 4) {
-        uint32_t minKey = 0;
-        memcpy(&minKey, embedDBGetMinKey(state, buffer), state->keySize);
-        state->minKey = minKey;
+
+    if (usedCheckpoint) {
+        /* Start from the checkpoint and replay the pages written after it the same way they were written */
+        state->nextDataPageId = checkpoint->nextDataPageId;
+        state->minDataPageId = checkpoint->minDataPageId;
+        state->numAvailDataPages = checkpoint->numAvailDataPages;
+        state->minKey = checkpoint->minKey;
+        state->avgKeyDiff = checkpoint->avgKeyDiff;
+        state->maxError = checkpoint->maxError;
+        while (state->nextDataPageId < nextPageId) {
+            if (readPage(state, state->nextDataPageId % state->numDataPages) != 0)
+                return -1;
+            if (state->numAvailDataPages <= 0) {
+                state->numAvailDataPages += state->eraseSizeInPages;
+                state->minDataPageId += state->eraseSizeInPages;
+                if (state->cleanSpline)
+                    cleanSpline(state, &state->minKey);
+                state->minKey += state->eraseSizeInPages * state->maxRecordsPerPage * state->avgKeyDiff;
+            }
+            state->numAvailDataPages--;
+            if (state->searchMethod == EMBEDDB_SEARCH_SPLINE && state->radixBits == 0)
+                splineAdd(state->spl, embedDBGetMinKey(state, state->dataReadBuffer), state->nextDataPageId);
+            updateAverageKeyDifference(state, state->dataReadBuffer);
+            updateMaxiumError(state, state->dataReadBuffer);
+            state->nextDataPageId++;
+        }
     } else {
-        uint64_t minKey = 0;
-        memcpy(&minKey, embedDBGetMinKey(state, buffer), state->keySize);
-        state->minKey = minKey;
+        state->nextDataPageId = nextPageId;
+        state->minDataPageId = minPageId;
+        state->numAvailDataPages = state->numDataPages + minPageId - nextPageId;
+        readPage(state, minPageId % state->numDataPages);
+        if (state->keySize <= 4) {
+            uint32_t minKey = 0;
+            memcpy(&minKey, embedDBGetMinKey(state, state->dataReadBuffer), state->keySize);
+            state->minKey = minKey;
+        } else {
+            uint64_t minKey = 0;
+            memcpy(&minKey, embedDBGetMinKey(state, state->dataReadBuffer), state->keySize);
+            state->minKey = minKey;
+        }
     }
 
     /* Put largest key back into the buffer */
-    readPage(state, state->nextDataPageId - 1);
+    readPage(state, (state->nextDataPageId - 1) % state->numDataPages);
+    memcpy(&state->maxKey, embedDBGetMaxKey(state, state->dataReadBuffer), state->keySize);
 
-    updateAverageKeyDifference(state, buffer);
-    if (SEARCH_METHOD == 2) {
+    if (!usedCheckpoint)
+        updateAverageKeyDifference(state, state->dataReadBuffer);
+
+    /* The spline only has to be rebuilt from the pages if the checkpoint did not have it */
+    if (state->searchMethod == EMBEDDB_SEARCH_SPLINE && (!usedCheckpoint || state->radixBits > 0)) {
+        if (checkpoint != NULL)
+            embedDBResetSpline(state);
         embedDBInitSplineFromFile(state);
     }
 
@@ -377,25 +1687,24 @@ int8_t embedDBInitDataFromFile(embedDBState *state) {
 
 void embedDBInitSplineFromFile(embedDBState *state) {
     id_t pageNumberToRead = state->minDataPageId;
-    void *buffer = (int8_t *)state->buffer + state->pageSize * EMBEDDB_DATA_READ_BUFFER;
     id_t pagesRead = 0;
     id_t numberOfPagesToRead = state->nextDataPageId - state->minDataPageId;
     while (pagesRead < numberOfPagesToRead) {
         readPage(state, pageNumberToRead % state->numDataPages);
-        if (RADIX_BITS > 0) {
-            radixsplineAddPoint(state->rdix, embedDBGetMinKey(state, buffer), pageNumberToRead++);
+        if (state->radixBits > 0) {
+            radixsplineAddPoint(state->rdix, embedDBGetMinKey(state, state->dataReadBuffer), pageNumberToRead++);
         } else {
-            splineAdd(state->spl, embedDBGetMinKey(state, buffer), pageNumberToRead++);
+            splineAdd(state->spl, embedDBGetMinKey(state, state->dataReadBuffer), pageNumberToRead++);
         }
         pagesRead++;
     }
 }
 
-int8_t embedDBInitIndex(embedDBState *state) {
+int8_t embedDBInitIndex(embedDBState *state, embedDBCheckpointInfo *checkpoint) {
     /* Setup index file. */
 
     /* 4 for id, 2 for count, 2 unused, 4 for minKey (pageId), 4 for maxKey (pageId) */
-    state->maxIdxRecordsPerPage = (state->pageSize - 16) / state->bitmapSize;
+    state->maxIdxRecordsPerPage = (state->pageSize - 16) / embedDBIndexRecordSize(state);
 
     /* Allocate third page of buffer as index output page */
     initBufferPage(state, EMBEDDB_INDEX_WRITE_BUFFER);
@@ -416,31 +1725,401 @@ int8_t embedDBInitIndex(embedDBState *state) {
         return -1;
     }
 
-    if (state->numIndexPages % state->eraseSizeInPages != 0) {
-#ifdef PRINT_ERRORS
-        printf("ERROR: Ensure index space is a multiple of erase block size\n");
-#endif
-        return -1;
-    }
+    if (state->numIndexPages % state->eraseSizeInPages != 0) {
+#ifdef PRINT_ERRORS
+        printf("ERROR: Ensure index space is a multiple of erase block size\n");
+#endif
+        return -1;
+    }
+
+    if (state->indexFile == NULL) {
+#ifdef PRINT_ERRORS
+        printf("ERROR: No index file provided!\n");
+#endif
+        return -1;
+    }
+
+    if (EMBEDDB_USING_ZONE_MAP(state->parameters)) {
+        if (embedDBInitZoneMap(state) != 0)
+            return -1;
+    }
+
+    if (!EMBEDDB_RESETING_DATA(state->parameters)) {
+        int8_t openStatus = state->fileInterface->open(state->indexFile, EMBEDDB_FILE_MODE_R_PLUS_B);
+        if (openStatus) {
+            return embedDBInitIndexFromFile(state, checkpoint);
+        }
+    }
+
+    int8_t openStatus = state->fileInterface->open(state->indexFile, EMBEDDB_FILE_MODE_W_PLUS_B);
+    if (!openStatus) {
+#ifdef PRINT_ERRORS
+        printf("Error: Can't open index file!\n");
+#endif
+        return -1;
+    }
+
+    return 0;
+}
+
+int8_t embedDBInitIndexFromFile(embedDBState *state, embedDBCheckpointInfo *checkpoint) {
+    id_t minPageId = 0, nextPageId = 0;
+    int8_t usedCheckpoint = embedDBFindPageRange(state, EMBEDDB_INDEX_FILE, state->numIndexPages, checkpoint != NULL ? checkpoint->nextIdxPageId : 0, &minPageId, &nextPageId);
+
+    if (usedCheckpoint < 0)
+        return 0;
+
+    if (usedCheckpoint) {
+        /* Replay the erases of the index pages written after the checkpoint */
+        state->nextIdxPageId = checkpoint->nextIdxPageId;
+        state->minIndexPageId = checkpoint->minIndexPageId;
+        state->numAvailIndexPages = checkpoint->numAvailIndexPages;
+        for (; state->nextIdxPageId < nextPageId; state->nextIdxPageId++) {
+            if (state->numAvailIndexPages <= 0) {
+                state->numAvailIndexPages += state->eraseSizeInPages;
+                state->minIndexPageId += state->eraseSizeInPages;
+            }
+            state->numAvailIndexPages--;
+        }
+    } else {
+        state->nextIdxPageId = nextPageId;
+        state->minIndexPageId = minPageId;
+        state->numAvailIndexPages = state->numIndexPages + minPageId - nextPageId;
+    }
+
+    /* Rebuild the zones of the index pages on file */
+    if (state->zoneMap != NULL) {
+        void *buf = (int8_t *)state->buffer + state->pageSize * EMBEDDB_INDEX_READ_BUFFER;
+        uint32_t recordSize = embedDBIndexRecordSize(state);
+        /* Index records only hold the data range of their page when using EMBEDDB_USE_SUM */
+        int8_t hasDataRange = EMBEDDB_USING_SUM(state->parameters) && EMBEDDB_USING_MAX_MIN(state->parameters);
+        for (id_t indexPageId = state->minIndexPageId; indexPageId < state->nextIdxPageId; indexPageId++) {
+            if (readIndexPage(state, indexPageId % state->numIndexPages) != 0) {
+#ifdef PRINT_ERRORS
+                printf("ERROR: Failed to read index page %i (%i)\n", indexPageId, indexPageId % state->numIndexPages);
+#endif
+                return -1;
+            }
+            id_t firstDataPageId;
+            memcpy(&firstDataPageId, (int8_t *)buf + 8, sizeof(id_t));
+            count_t count = EMBEDDB_GET_COUNT(buf);
+            for (count_t i = 0; i < count; i++) {
+                int8_t *record = (int8_t *)buf + EMBEDDB_IDX_HEADER_SIZE + i * recordSize;
+                int8_t *minData = NULL;
+                if (hasDataRange) {
+                    count_t numRecords;
+                    memcpy(&numRecords, record + state->bitmapSize, sizeof(count_t));
+                    if (numRecords > 0)
+                        minData = record + state->bitmapSize + sizeof(count_t) + sizeof(int64_t) + state->keySize * 2;
+                }
+                zoneAddDataPage(state, indexPageId, firstDataPageId + i, record, minData, minData != NULL ? minData + state->dataSize : NULL);
+            }
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief	Keeps the smallest and largest value of a value index page and the data pages covered by its run.
+ * @param	page		Value index page
+ * @param	summary		Return variable for the summary
+ */
+static void valueIndexSummarize(int8_t *page, embedDBValuePage *summary) {
+    count_t count = EMBEDDB_GET_COUNT(page);
+    embedDBValueEntry *entries = (embedDBValueEntry *)(page + EMBEDDB_VALUE_INDEX_HEADER_SIZE);
+    summary->minValue = count > 0 ? entries[0].value : INT32_MAX;
+    summary->maxValue = count > 0 ? entries[count - 1].value : INT32_MIN;
+    memcpy(&summary->runPage, page + 6, sizeof(count_t));
+    memcpy(&summary->numRunPages, page + 8, sizeof(count_t));
+    memcpy(&summary->firstDataPageId, page + 12, sizeof(id_t));
+    memcpy(&summary->nextDataPageId, page + 16, sizeof(id_t));
+}
+
+int8_t embedDBInitValueIndex(embedDBState *state) {
+    if (state->numValueIndexPages < state->eraseSizeInPages * 2) {
+#ifdef PRINT_ERRORS
+        printf("ERROR: Minimum value index space is two erase blocks\n");
+#endif
+        return -1;
+    }
+
+    if (state->numValueIndexPages % state->eraseSizeInPages != 0) {
+#ifdef PRINT_ERRORS
+        printf("ERROR: Ensure value index space is a multiple of erase block size\n");
+#endif
+        return -1;
+    }
+
+    if (state->valueIndexFile == NULL) {
+#ifdef PRINT_ERRORS
+        printf("ERROR: No value index file provided!\n");
+#endif
+        return -1;
+    }
+
+    embedDBValueIndex *vi = calloc(1, sizeof(embedDBValueIndex));
+    if (vi == NULL) {
+#ifdef PRINT_ERRORS
+        printf("ERROR: Failed to allocate the value index.\n");
+#endif
+        return -1;
+    }
+    state->valueIndex = vi;
+
+    vi->maxPageEntries = (state->pageSize - EMBEDDB_VALUE_INDEX_HEADER_SIZE) / sizeof(embedDBValueEntry);
+    vi->maxRunEntries = (uint32_t)vi->maxPageEntries * state->eraseSizeInPages;
+    vi->runEntries = malloc(vi->maxRunEntries * sizeof(embedDBValueEntry));
+    vi->pageBuffer = malloc(state->pageSize);
+    vi->pageValues = malloc(state->maxRecordsPerPage * sizeof(int32_t));
+    vi->pages = malloc(state->numValueIndexPages * sizeof(embedDBValuePage));
+    if (vi->runEntries == NULL || vi->pageBuffer == NULL || vi->pageValues == NULL || vi->pages == NULL) {
+#ifdef PRINT_ERRORS
+        printf("ERROR: Failed to allocate the value index buffers.\n");
+#endif
+        return -1;
+    }
+    vi->numAvailPages = state->numValueIndexPages;
+
+    int8_t openStatus = 0;
+    if (!EMBEDDB_RESETING_DATA(state->parameters)) {
+        openStatus = state->fileInterface->open(state->valueIndexFile, EMBEDDB_FILE_MODE_R_PLUS_B);
+        if (openStatus && embedDBInitValueIndexFromFile(state) != 0)
+            return -1;
+    }
+
+    if (!openStatus) {
+        openStatus = state->fileInterface->open(state->valueIndexFile, EMBEDDB_FILE_MODE_W_PLUS_B);
+        if (!openStatus) {
+#ifdef PRINT_ERRORS
+            printf("Error: Can't open value index file!\n");
+#endif
+            return -1;
+        }
+    }
+
+    /* Add the data pages on file whose values are not all in a run yet */
+    if (vi->nextDataPageId < state->minDataPageId)
+        vi->firstDataPageId = vi->nextDataPageId = state->minDataPageId;
+    vi->runFirstDataPageId = vi->nextDataPageId;
+    for (id_t pageId = vi->nextDataPageId; pageId < state->nextDataPageId; pageId++) {
+        if (readPage(state, pageId % state->numDataPages) != 0)
+            return -1;
+        valueIndexAddPage(state, state->dataReadBuffer, pageId);
+    }
+
+    return 0;
+}
+
+int8_t embedDBInitValueIndexFromFile(embedDBState *state) {
+    embedDBValueIndex *vi = state->valueIndex;
+    id_t minPageId = 0, nextPageId = 0;
+    if (embedDBFindPageRange(state, EMBEDDB_VALUE_INDEX_FILE, state->numValueIndexPages, 0, &minPageId, &nextPageId) < 0)
+        return 0;
+
+    vi->nextPageId = nextPageId;
+    vi->minPageId = minPageId;
+    vi->numAvailPages = state->numValueIndexPages + minPageId - nextPageId;
+
+    /* Rebuild the summaries of the pages on file */
+    for (id_t pageId = minPageId; pageId < nextPageId; pageId++) {
+        if (readValueIndexPage(state, pageId % state->numValueIndexPages) != 0)
+            return -1;
+        valueIndexSummarize(vi->pageBuffer, &vi->pages[pageId % state->numValueIndexPages]);
+    }
+
+    /* The oldest run may have lost its first pages to an erase */
+    embedDBValuePage *oldest = &vi->pages[minPageId % state->numValueIndexPages];
+    vi->firstDataPageId = oldest->runPage == 0 ? oldest->firstDataPageId : oldest->nextDataPageId;
+
+    /* The newest run may not have been written completely. Its first data page may have been split with the run before it */
+    embedDBValuePage *newest = &vi->pages[(nextPageId - 1) % state->numValueIndexPages];
+    if (newest->runPage + 1 == newest->numRunPages)
+        vi->nextDataPageId = newest->nextDataPageId;
+    else
+        vi->nextDataPageId = newest->firstDataPageId > 0 ? newest->firstDataPageId - 1 : 0;
+    if (vi->firstDataPageId > vi->nextDataPageId)
+        vi->firstDataPageId = vi->nextDataPageId;
+    return 0;
+}
+
+/**
+ * @brief	Allocates the zone map with every zone unused.
+ * @param	state	embedDB algorithm state structure
+ * @return	Return 0 if success, -1 if the zone map could not be allocated.
+ */
+int8_t embedDBInitZoneMap(embedDBState *state) {
+    state->zoneMap = malloc((size_t)(state->numIndexPages + 1) * embedDBZoneSize(state));
+    if (state->zoneMap == NULL) {
+#ifdef PRINT_ERRORS
+        printf("ERROR: Failed to allocate the zone map.\n");
+#endif
+        return -1;
+    }
+    for (uint32_t i = 0; i <= state->numIndexPages; i++)
+        embedDBGetZone(state, i)->indexPageId = UINT32_MAX;
+    return 0;
+}
+
+int8_t embedDBInitVarData(embedDBState *state, embedDBCheckpointInfo *checkpoint) {
+    // Initialize variable data outpt buffer
+    initBufferPage(state, EMBEDDB_VAR_WRITE_BUFFER(state->parameters));
+
+    state->variableDataHeaderSize = state->keySize + sizeof(id_t);
+    state->currentVarLoc = state->variableDataHeaderSize;
+    state->minVarRecordId = 0;
+    state->numAvailVarPages = state->numVarPages;
+    state->nextVarPageId = 0;
+
+    if (!EMBEDDB_RESETING_DATA(state->parameters)) {
+        int8_t openResult = state->fileInterface->open(state->varFile, EMBEDDB_FILE_MODE_R_PLUS_B);
+        if (openResult) {
+            return embedDBInitVarDataFromFile(state, checkpoint);
+        }
+    }
+
+    int8_t openResult = state->fileInterface->open(state->varFile, EMBEDDB_FILE_MODE_W_PLUS_B);
+    if (!openResult) {
+#ifdef PRINT_ERRORS
+        printf("Error: Can't open variable data file!\n");
+#endif
+        return -1;
+    }
+
+    return 0;
+}
+
+int8_t embedDBInitVarDataFromFile(embedDBState *state, embedDBCheckpointInfo *checkpoint) {
+    void *buffer = (int8_t *)state->buffer + state->pageSize * EMBEDDB_VAR_READ_BUFFER(state->parameters);
+    id_t minPageId = 0, nextPageId = 0;
+    int8_t usedCheckpoint = embedDBFindPageRange(state, EMBEDDB_VAR_FILE, state->numVarPages, checkpoint != NULL ? checkpoint->nextVarPageId : 0, &minPageId, &nextPageId);
+
+    if (usedCheckpoint < 0)
+        return 0;
+
+    state->nextVarPageId = nextPageId;
+    if (usedCheckpoint && nextPageId - checkpoint->nextVarPageId <= checkpoint->numAvailVarPages) {
+        /* Nothing was erased since the checkpoint */
+        state->minVarRecordId = checkpoint->minVarRecordId;
+        state->numAvailVarPages = checkpoint->numAvailVarPages - (nextPageId - checkpoint->nextVarPageId);
+    } else {
+        /* The newest record on the oldest page has been erased if the file has wrapped */
+        if (minPageId > 0) {
+            readVariablePage(state, minPageId % state->numVarPages);
+            memcpy(&(state->minVarRecordId), (int8_t *)buffer + sizeof(id_t), state->keySize);
+            state->minVarRecordId++;
+        }
+        state->numAvailVarPages = state->numVarPages + minPageId - nextPageId;
+    }
+
+    state->currentVarLoc = state->nextVarPageId % state->numVarPages * state->pageSize + state->variableDataHeaderSize;
+
+    return 0;
+}
+
+/**
+ * @brief	Reads the logical page id at the start of a physical page. Used during recovery.
+ * @param	state			embedDB algorithm state structure
+ * @param	fileType		EMBEDDB_DATA_FILE, EMBEDDB_INDEX_FILE, EMBEDDB_VAR_FILE or EMBEDDB_VALUE_INDEX_FILE
+ * @param	physicalPageId	Physical page to read
+ * @param	logicalPageId	Return variable for the logical page id
+ * @return	Return 0 if success, -1 if the page could not be read.
+ */
+int8_t recoveryReadPageId(embedDBState *state, uint8_t fileType, id_t physicalPageId, id_t *logicalPageId) {
+    void *buf = NULL;
+    if (fileType == EMBEDDB_DATA_FILE) {
+        if (readPage(state, physicalPageId) != 0)
+            return -1;
+        buf = state->dataReadBuffer;
+    } else if (fileType == EMBEDDB_INDEX_FILE) {
+        if (readIndexPage(state, physicalPageId) != 0)
+            return -1;
+        buf = (int8_t *)state->buffer + state->pageSize * EMBEDDB_INDEX_READ_BUFFER;
+    } else if (fileType == EMBEDDB_VALUE_INDEX_FILE) {
+        if (readValueIndexPage(state, physicalPageId) != 0)
+            return -1;
+        buf = ((embedDBValueIndex *)state->valueIndex)->pageBuffer;
+    } else {
+        if (readVariablePage(state, physicalPageId) != 0)
+            return -1;
+        buf = (int8_t *)state->buffer + state->pageSize * EMBEDDB_VAR_READ_BUFFER(state->parameters);
+    }
+    memcpy(logicalPageId, buf, sizeof(id_t));
+    return 0;
+}
+
+/**
+ * @brief	Finds the logical pages that are stored in a file when restarting.
+ * 			If the last page of the checkpoint is still on file, only the pages written after it are read.
+ * 			Otherwise the wrap point is found with a binary search, as logical ids increase by one from physical page 0 up to the newest page.
+ * @param	state		embedDB algorithm state structure
+ * @param	fileType	EMBEDDB_DATA_FILE, EMBEDDB_INDEX_FILE, EMBEDDB_VAR_FILE or EMBEDDB_VALUE_INDEX_FILE
+ * @param	numPages	Number of pages in the file
+ * @param	hint		Next logical page id saved by the checkpoint. 0 if there is no checkpoint
+ * @param	minPageId	Return variable for the smallest logical page id on file
+ * @param	nextPageId	Return variable for one past the largest logical page id on file
+ * @return	Returns 1 if the checkpoint was used, 0 if the file was searched and -1 if the file has no pages.
+ */
+int8_t embedDBFindPageRange(embedDBState *state, uint8_t fileType, uint32_t numPages, id_t hint, id_t *minPageId, id_t *nextPageId) {
+    id_t firstPageId = 0, pageId = 0, lastPageId = 0;
+    if (recoveryReadPageId(state, fileType, 0, &firstPageId) != 0)
+        return -1;
+
+    int8_t usedHint = hint > 0 && recoveryReadPageId(state, fileType, (hint - 1) % numPages, &pageId) == 0 && pageId == hint - 1;
+    if (usedHint) {
+        lastPageId = hint - 1;
+        for (uint32_t i = 1; i < numPages; i++) {
+            if (recoveryReadPageId(state, fileType, (lastPageId + 1) % numPages, &pageId) != 0 || pageId != lastPageId + 1)
+                break;
+            lastPageId++;
+        }
+    } else {
+        uint32_t low = 0, high = numPages - 1;
+        while (low < high) {
+            uint32_t mid = low + (high - low + 1) / 2;
+            if (recoveryReadPageId(state, fileType, mid, &pageId) == 0 && pageId == firstPageId + mid) {
+                low = mid;
+            } else {
+                high = mid - 1;
+            }
+        }
+        lastPageId = firstPageId + low;
+    }
+
+    /* If the file has wrapped, the page after the newest one is the oldest page */
+    *nextPageId = lastPageId + 1;
+    *minPageId = firstPageId;
+    if (recoveryReadPageId(state, fileType, *nextPageId % numPages, &pageId) == 0 && pageId == *nextPageId - numPages)
+        *minPageId = pageId;
 
-    if (state->indexFile == NULL) {
+    return usedHint;
+}
+
+/**
+ * @brief	Opens the checkpoint file and loads the newest valid checkpoint from it.
+ * @param	state		embedDB algorithm state structure
+ * @param	checkpoint	Return variable for the checkpoint
+ * @return	Returns 1 if a checkpoint was loaded, 0 if there is none and -1 if error.
+ */
+int8_t embedDBInitCheckpoint(embedDBState *state, embedDBCheckpointInfo *checkpoint) {
+    if (state->checkpointFile == NULL) {
 #ifdef PRINT_ERRORS
-        printf("ERROR: No index file provided!\n");
+        printf("ERROR: No checkpoint file provided!\n");
 #endif
         return -1;
     }
 
     if (!EMBEDDB_RESETING_DATA(state->parameters)) {
-        int8_t openStatus = state->fileInterface->open(state->indexFile, EMBEDDB_FILE_MODE_R_PLUS_B);
+        int8_t openStatus = state->fileInterface->open(state->checkpointFile, EMBEDDB_FILE_MODE_R_PLUS_B);
         if (openStatus) {
-            return embedDBInitIndexFromFile(state);
+            return embedDBLoadCheckpoint(state, checkpoint);
         }
     }
 
-    int8_t openStatus = state->fileInterface->open(state->indexFile, EMBEDDB_FILE_MODE_W_PLUS_B);
+    int8_t openStatus = state->fileInterface->open(state->checkpointFile, EMBEDDB_FILE_MODE_W_PLUS_B);
     if (!openStatus) {
 #ifdef PRINT_ERRORS
-        printf("Error: Can't open index file!\n");
+        printf("Error: Can't open checkpoint file!\n");
 #endif
         return -1;
     }
@@ -448,111 +2127,220 @@ int8_t embedDBInitIndex(embedDBState *state) {
     return 0;
 }
 
-int8_t embedDBInitIndexFromFile(embedDBState *state) {
-    id_t logicalIndexPageId = 0;
-    id_t maxLogicaIndexPageId = 0;
-    id_t physicalIndexPageId = 0;
+/**
+ * @brief	Loads the newest checkpoint that is complete. The spline in the checkpoint is loaded into the state.
+ * @param	state		embedDB algorithm state structure
+ * @param	checkpoint	Return variable for the checkpoint
+ * @return	Returns 1 if a checkpoint was loaded, 0 if neither slot holds a valid checkpoint.
+ */
+int8_t embedDBLoadCheckpoint(embedDBState *state, embedDBCheckpointInfo *checkpoint) {
+    uint32_t slotPages = checkpointSlotPages(state);
+    memset(checkpoint, 0, sizeof(embedDBCheckpointInfo));
+
+    /* Read the sequence numbers to try the newest slot first */
+    uint32_t sequence[2] = {0, 0};
+    int8_t haveSlot[2] = {0, 0};
+    for (uint8_t slot = 0; slot < 2; slot++) {
+        uint32_t header[2] = {0, 0};
+        embedDBCheckpointCursor cursor = {slot * slotPages, state->pageSize, 0};
+        haveSlot[slot] = checkpointTransfer(state, &cursor, header, sizeof(header), 0) == 0 && header[0] == EMBEDDB_CHECKPOINT_MAGIC;
+        sequence[slot] = header[1];
+    }
 
-    /* This will become zero if there is no more to read */
-    int8_t moreToRead = !(readIndexPage(state, physicalIndexPageId));
+    uint8_t newest = (haveSlot[1] && (!haveSlot[0] || sequence[1] > sequence[0])) ? 1 : 0;
+    for (uint8_t i = 0; i < 2; i++) {
+        uint8_t slot = i == 0 ? newest : 1 - newest;
+        if (!haveSlot[slot])
+            continue;
+        embedDBCheckpointCursor cursor = {slot * slotPages, state->pageSize, 2166136261u};
+        if (checkpointStream(state, checkpoint, &cursor, 0) == 0) {
+            state->checkpointSequence = checkpoint->sequence + 1;
+            return 1;
+        }
+        /* Slot was torn by a failed write */
+        embedDBResetSpline(state);
+    }
+    return 0;
+}
 
-    bool haveWrappedInMemory = false;
-    int count = 0;
-    void *buffer = (int8_t *)state->buffer + state->pageSize * EMBEDDB_INDEX_READ_BUFFER;
+/**
+ * @brief	Returns the number of pages in each of the two checkpoint slots. A slot has space for a full spline.
+ * @param	state	embedDB algorithm state structure
+ * @return	Number of pages per checkpoint slot
+ */
+uint32_t checkpointSlotPages(embedDBState *state) {
+    uint32_t pointSize = state->keySize + sizeof(uint32_t);
+    uint32_t size = sizeof(uint32_t) * 5 + sizeof(embedDBCheckpointInfo) + sizeof(uint32_t) * 5 + state->keySize + pointSize * (state->numSplinePoints + 3) + sizeof(uint32_t);
+    return (size + state->pageSize - 1) / state->pageSize;
+}
 
-    while (moreToRead && count < state->numIndexPages) {
-        memcpy(&logicalIndexPageId, buffer, sizeof(id_t));
-        if (count == 0 || logicalIndexPageId == maxLogicaIndexPageId + 1) {
-            maxLogicaIndexPageId = logicalIndexPageId;
-            physicalIndexPageId++;
-            moreToRead = !(readIndexPage(state, physicalIndexPageId));
-            count++;
-        } else {
-            haveWrappedInMemory = logicalIndexPageId == maxLogicaIndexPageId - state->numIndexPages + 1;
-            break;
+/**
+ * @brief	Copies bytes to or from the checkpoint stream. Checkpoint pages are read and written through the data read buffer.
+ * @param	state	embedDB algorithm state structure
+ * @param	cursor	Position in the checkpoint stream
+ * @param	bytes	Bytes to write, or space to read the bytes into
+ * @param	length	Number of bytes
+ * @param	write	1 to write to the checkpoint, 0 to read from it
+ * @return	Return 0 if success, -1 if error.
+ */
+int8_t checkpointTransfer(embedDBState *state, embedDBCheckpointCursor *cursor, void *bytes, uint32_t length, int8_t write) {
+    int8_t *page = (int8_t *)state->buffer + state->pageSize * EMBEDDB_DATA_READ_BUFFER;
+    int8_t *ptr = (int8_t *)bytes;
+
+    /* Read buffer no longer holds a data page */
+    state->bufferedPageId = -1;
+    state->dataReadBuffer = page;
+
+    while (length > 0) {
+        if (cursor->offset == state->pageSize) {
+            if (write) {
+                if (state->fileInterface->write(page, cursor->pageNum, state->pageSize, state->checkpointFile) == 0)
+                    return -1;
+            } else if (state->fileInterface->read(page, cursor->pageNum, state->pageSize, state->checkpointFile) == 0) {
+                return -1;
+            }
+            cursor->pageNum++;
+            cursor->offset = 0;
         }
-    }
 
-    if (count == 0)
-        return 0;
+        uint32_t numBytes = state->pageSize - cursor->offset;
+        if (numBytes > length)
+            numBytes = length;
+        if (write) {
+            memcpy(page + cursor->offset, ptr, numBytes);
+        } else {
+            memcpy(ptr, page + cursor->offset, numBytes);
+        }
+        for (uint32_t i = 0; i < numBytes; i++) {
+            cursor->checksum = (cursor->checksum ^ (uint8_t)ptr[i]) * 16777619u;
+        }
 
-    state->nextIdxPageId = maxLogicaIndexPageId + 1;
-    id_t physicalPageIDOfSmallestData = 0;
-    if (haveWrappedInMemory) {
-        physicalPageIDOfSmallestData = logicalIndexPageId % state->numIndexPages;
+        cursor->offset += numBytes;
+        ptr += numBytes;
+        length -= numBytes;
     }
-    readIndexPage(state, physicalPageIDOfSmallestData);
-    memcpy(&(state->minIndexPageId), buffer, sizeof(id_t));
-    state->numAvailIndexPages = state->numIndexPages + state->minIndexPageId - maxLogicaIndexPageId - 1;
-
     return 0;
 }
 
-int8_t embedDBInitVarData(embedDBState *state) {
-    // Initialize variable data outpt buffer
-    initBufferPage(state, EMBEDDB_VAR_WRITE_BUFFER(state->parameters));
+/**
+ * @brief	Writes a checkpoint to the stream or reads one from it. Fields are streamed in the same order in both directions.
+ * 			When reading, the spline in the checkpoint is loaded into the state.
+ * @param	state		embedDB algorithm state structure
+ * @param	checkpoint	Checkpoint to write, or return variable for the checkpoint read
+ * @param	cursor		Position in the checkpoint stream
+ * @param	write		1 to write the checkpoint, 0 to read it
+ * @return	Return 0 if success, -1 if error or if the checkpoint read is not valid for this state.
+ */
+int8_t checkpointStream(embedDBState *state, embedDBCheckpointInfo *checkpoint, embedDBCheckpointCursor *cursor, int8_t write) {
+    uint8_t haveSpline = state->searchMethod == EMBEDDB_SEARCH_SPLINE && state->radixBits == 0;
+    uint32_t header[5] = {EMBEDDB_CHECKPOINT_MAGIC, checkpoint->sequence, state->pageSize, state->keySize, haveSpline ? state->numSplinePoints : 0};
+    uint32_t expected[5];
+    memcpy(expected, header, sizeof(header));
 
-    state->variableDataHeaderSize = state->keySize + sizeof(id_t);
-    state->currentVarLoc = state->variableDataHeaderSize;
-    state->minVarRecordId = 0;
-    state->numAvailVarPages = state->numVarPages;
-    state->nextVarPageId = 0;
+    if (checkpointTransfer(state, cursor, header, sizeof(header), write) != 0)
+        return -1;
+    if (!write) {
+        if (header[0] != expected[0] || header[2] != expected[2] || header[3] != expected[3] || header[4] != expected[4])
+            return -1;
+        checkpoint->sequence = header[1];
+    }
 
-    if (!EMBEDDB_RESETING_DATA(state->parameters)) {
-        int8_t openResult = state->fileInterface->open(state->varFile, EMBEDDB_FILE_MODE_R_PLUS_B);
-        if (openResult) {
-            return embedDBInitVarDataFromFile(state);
+    if (checkpointTransfer(state, cursor, checkpoint, sizeof(embedDBCheckpointInfo), write) != 0)
+        return -1;
+
+    if (haveSpline) {
+        spline *spl = state->spl;
+        uint32_t pointSize = spl->keySize + sizeof(uint32_t);
+        uint32_t splineHeader[4] = {spl->count, spl->numAddCalls, spl->tempLastPoint, spl->lastLoc};
+        if (checkpointTransfer(state, cursor, splineHeader, sizeof(splineHeader), write) != 0)
+            return -1;
+        if (!write) {
+            if (splineHeader[0] > spl->size)
+                return -1;
+            spl->count = splineHeader[0];
+            spl->numAddCalls = splineHeader[1];
+            spl->tempLastPoint = splineHeader[2];
+            spl->lastLoc = splineHeader[3];
+            spl->pointsStartIndex = 0;
+        }
+        if (checkpointTransfer(state, cursor, spl->lastKey, spl->keySize, write) != 0 ||
+            checkpointTransfer(state, cursor, spl->lower, pointSize, write) != 0 ||
+            checkpointTransfer(state, cursor, spl->upper, pointSize, write) != 0 ||
+            checkpointTransfer(state, cursor, spl->firstSplinePoint, pointSize, write) != 0)
+            return -1;
+        for (size_t i = 0; i < spl->count; i++) {
+            if (checkpointTransfer(state, cursor, splinePointLocation(spl, i), pointSize, write) != 0)
+                return -1;
         }
     }
 
-    int8_t openResult = state->fileInterface->open(state->varFile, EMBEDDB_FILE_MODE_W_PLUS_B);
-    if (!openResult) {
-#ifdef PRINT_ERRORS
-        printf("Error: Can't open variable data file!\n");
-#endif
+    /* Checksum of everything before it detects a checkpoint that was only partly written */
+    uint32_t checksum = cursor->checksum;
+    uint32_t storedChecksum = checksum;
+    if (checkpointTransfer(state, cursor, &storedChecksum, sizeof(uint32_t), write) != 0)
         return -1;
-    }
+    if (!write)
+        return storedChecksum == checksum ? 0 : -1;
 
+    /* Write the last partly filled page */
+    if (state->fileInterface->write(state->dataReadBuffer, cursor->pageNum, state->pageSize, state->checkpointFile) == 0)
+        return -1;
     return 0;
 }
 
-int8_t embedDBInitVarDataFromFile(embedDBState *state) {
-    void *buffer = (int8_t *)state->buffer + state->pageSize * EMBEDDB_VAR_READ_BUFFER(state->parameters);
-    id_t logicalVariablePageId = 0;
-    id_t maxLogicalVariablePageId = 0;
-    id_t physicalVariablePageId = 0;
-    int8_t moreToRead = !(readVariablePage(state, physicalVariablePageId));
-    uint32_t count = 0;
-    bool haveWrappedInMemory = false;
-    while (moreToRead && count < state->numVarPages) {
-        memcpy(&logicalVariablePageId, buffer, sizeof(id_t));
-        if (count == 0 || logicalVariablePageId == maxLogicalVariablePageId + 1) {
-            maxLogicalVariablePageId = logicalVariablePageId;
-            physicalVariablePageId++;
-            moreToRead = !(readVariablePage(state, physicalVariablePageId));
-            count++;
-        } else {
-            haveWrappedInMemory = logicalVariablePageId == maxLogicalVariablePageId - state->numVarPages + 1;
-            break;
-        }
-    }
+/**
+ * @brief	Removes every point from the spline so it can be rebuilt from the data pages.
+ * @param	state	embedDB algorithm state structure
+ */
+void embedDBResetSpline(embedDBState *state) {
+    if (state->searchMethod != EMBEDDB_SEARCH_SPLINE || state->radixBits > 0)
+        return;
+    state->spl->count = 0;
+    state->spl->pointsStartIndex = 0;
+    state->spl->numAddCalls = 0;
+    state->spl->tempLastPoint = 0;
+}
 
-    if (count == 0)
-        return 0;
+/**
+ * @brief	Writes a checkpoint of the data, index and variable data cursors and the spline to the checkpoint file.
+ * 			Recovery loads the newest valid checkpoint and only reads the pages written after it.
+ * 			Checkpoints alternate between two slots in the file so a torn write leaves the previous one intact.
+ * @param	state	embedDB algorithm state structure
+ * @return	Return 0 if success. Non-zero value if error.
+ */
+int8_t embedDBCheckpoint(embedDBState *state) {
+    if (!EMBEDDB_USING_CHECKPOINT(state->parameters) || state->checkpointFile == NULL)
+        return -1;
 
-    state->nextVarPageId = maxLogicalVariablePageId + 1;
-    id_t minVarPageId = 0;
-    if (haveWrappedInMemory) {
-        id_t physicalPageIDOfSmallestData = logicalVariablePageId % state->numVarPages;
-        readVariablePage(state, physicalPageIDOfSmallestData);
-        memcpy(&(state->minVarRecordId), (int8_t *)buffer + sizeof(id_t), state->keySize);
-        memcpy(&minVarPageId, buffer, sizeof(id_t));
-        state->minVarRecordId++;
+    embedDBCheckpointInfo checkpoint;
+    memset(&checkpoint, 0, sizeof(embedDBCheckpointInfo));
+    checkpoint.sequence = state->checkpointSequence;
+    checkpoint.nextDataPageId = state->nextDataPageId;
+    checkpoint.minDataPageId = state->minDataPageId;
+    checkpoint.numAvailDataPages = state->numAvailDataPages;
+    checkpoint.minKey = state->minKey;
+    checkpoint.avgKeyDiff = state->avgKeyDiff;
+    checkpoint.maxError = state->maxError;
+    if (EMBEDDB_USING_INDEX(state->parameters)) {
+        checkpoint.nextIdxPageId = state->nextIdxPageId;
+        checkpoint.minIndexPageId = state->minIndexPageId;
+        checkpoint.numAvailIndexPages = state->numAvailIndexPages;
+    }
+    if (EMBEDDB_USING_VDATA(state->parameters)) {
+        checkpoint.nextVarPageId = state->nextVarPageId;
+        checkpoint.minVarRecordId = state->minVarRecordId;
+        checkpoint.numAvailVarPages = state->numAvailVarPages;
     }
 
-    state->numAvailVarPages = state->numVarPages + minVarPageId - maxLogicalVariablePageId - 1;
-    state->currentVarLoc = state->nextVarPageId % state->numVarPages * state->pageSize + state->variableDataHeaderSize;
+    embedDBCheckpointCursor cursor = {(state->checkpointSequence % 2) * checkpointSlotPages(state), 0, 2166136261u};
+    if (checkpointStream(state, &checkpoint, &cursor, 1) != 0 || !state->fileInterface->flush(state->checkpointFile)) {
+#ifdef PRINT_ERRORS
+        printf("ERROR: Failed to write checkpoint %i.\n", state->checkpointSequence);
+#endif
+        return -1;
+    }
 
+    state->checkpointSequence++;
     return 0;
 }
 
@@ -566,6 +2354,8 @@ void embedDBPrintInit(embedDBState *state) {
     printf("Key size: %d Data size: %d %sRecord size: %d\n", state->keySize, state->dataSize, EMBEDDB_USING_VDATA(state->parameters) ? "Variable data pointer size: 4 " : "", state->recordSize);
     printf("Use index: %d  Max/min: %d Sum: %d Bmap: %d\n", EMBEDDB_USING_INDEX(state->parameters), EMBEDDB_USING_MAX_MIN(state->parameters), EMBEDDB_USING_SUM(state->parameters), EMBEDDB_USING_BMAP(state->parameters));
     printf("Header size: %d  Records per page: %d\n", state->headerSize, state->maxRecordsPerPage);
+    if (state->bufferPool != NULL)
+        printf("Buffer pool pages: %d\n", state->bufferPool->numFrames);
 }
 
 /**
@@ -590,8 +2380,8 @@ float embedDBCalculateSlope(embedDBState *state, void *buffer) {
         }
 
         // convert to keys
-        memcpy(&slopeY1, ((int8_t *)buffer + state->headerSize + state->recordSize * slopeX1), state->keySize);
-        memcpy(&slopeY2, ((int8_t *)buffer + state->headerSize + state->recordSize * slopeX2), state->keySize);
+        memcpy(&slopeY1, embedDBRecordKey(state, buffer, slopeX1), state->keySize);
+        memcpy(&slopeY2, embedDBRecordKey(state, buffer, slopeX2), state->keySize);
 
         // return slope of keys
         return (float)(slopeY2 - slopeY1) / (float)(slopeX2 - slopeX1);
@@ -604,8 +2394,8 @@ float embedDBCalculateSlope(embedDBState *state, void *buffer) {
         }
 
         // convert to keys
-        memcpy(&slopeY1, ((int8_t *)buffer + state->headerSize + state->recordSize * slopeX1), state->keySize);
-        memcpy(&slopeY2, ((int8_t *)buffer + state->headerSize + state->recordSize * slopeX2), state->keySize);
+        memcpy(&slopeY1, embedDBRecordKey(state, buffer, slopeX1), state->keySize);
+        memcpy(&slopeY2, embedDBRecordKey(state, buffer, slopeX2), state->keySize);
 
         // return slope of keys
         return (float)(slopeY2 - slopeY1) / (float)(slopeX2 - slopeX1);
@@ -628,7 +2418,7 @@ int32_t getMaxError(embedDBState *state, void *buffer) {
 
         for (int i = 0; i < state->maxRecordsPerPage; i++) {
             // loop all keys in page
-            memcpy(&currentKey, ((int8_t *)buffer + state->headerSize + state->recordSize * i), state->keySize);
+            memcpy(&currentKey, embedDBRecordKey(state, buffer, i), state->keySize);
 
             // make currentKey value relative to current page
             currentKey = currentKey - minKey;
@@ -655,11 +2445,11 @@ int32_t getMaxError(embedDBState *state, void *buffer) {
         memcpy(&minKey, embedDBGetMinKey(state, buffer), state->keySize);
 
         // get slope of keys within page
-        float slope = embedDBCalculateSlope(state, state->buffer);  // this is incorrect, should be buffer. TODO: fix
+        float slope = embedDBCalculateSlope(state, state->dataWriteBuffer);  // this is incorrect, should be buffer. TODO: fix
 
         for (int i = 0; i < state->maxRecordsPerPage; i++) {
             // loop all keys in page
-            memcpy(&currentKey, ((int8_t *)buffer + state->headerSize + state->recordSize * i), state->keySize);
+            memcpy(&currentKey, embedDBRecordKey(state, buffer, i), state->keySize);
 
             // make currentKey value relative to current page
             currentKey = currentKey - minKey;
@@ -688,13 +2478,168 @@ int32_t getMaxError(embedDBState *state, void *buffer) {
  * @param	state	embedDB algorithm state structure
  */
 void indexPage(embedDBState *state, uint32_t pageNumber) {
-    if (SEARCH_METHOD == 2) {
-        if (RADIX_BITS > 0) {
-            radixsplineAddPoint(state->rdix, embedDBGetMinKey(state, state->buffer), pageNumber);
+    if (state->valueIndex != NULL)
+        valueIndexAddPage(state, state->dataWriteBuffer, pageNumber);
+
+    if (state->searchMethod == EMBEDDB_SEARCH_SPLINE) {
+        if (state->radixBits > 0) {
+            radixsplineAddPoint(state->rdix, embedDBGetMinKey(state, state->dataWriteBuffer), pageNumber);
         } else {
-            splineAdd(state->spl, embedDBGetMinKey(state, state->buffer), pageNumber);
+            splineAdd(state->spl, embedDBGetMinKey(state, state->dataWriteBuffer), pageNumber);
+        }
+    }
+}
+
+/**
+ * @brief	Writes the full data write buffer to storage, adds it to the search structure and index, then resets the write buffer.
+ * @param	state	embedDB algorithm state structure
+ */
+void writeFullDataPage(embedDBState *state) {
+    id_t pageNum = writePage(state, state->dataWriteBuffer);
+
+    indexPage(state, pageNum);
+
+    /* Save record in index file */
+    if (state->indexFile != NULL) {
+        void *buf = (int8_t *)state->buffer + state->pageSize * (EMBEDDB_INDEX_WRITE_BUFFER);
+        count_t idxcount = EMBEDDB_GET_COUNT(buf);
+        if (idxcount >= state->maxIdxRecordsPerPage) {
+            /* Save index page */
+            writeIndexPage(state, buf);
+
+            idxcount = 0;
+            initBufferPage(state, EMBEDDB_INDEX_WRITE_BUFFER);
+
+            /* Add page id to minimum value spot in page */
+            id_t *ptr = (id_t *)((int8_t *)buf + 8);
+            *ptr = pageNum;
         }
+
+        EMBEDDB_INC_COUNT(buf);
+
+        /* Copy record onto index page */
+        writeIndexRecord(state, buf, idxcount);
+    }
+
+    updateAverageKeyDifference(state, state->dataWriteBuffer);
+    updateMaxiumError(state, state->dataWriteBuffer);
+
+    initBufferPage(state, EMBEDDB_DATA_WRITE_BUFFER);
+
+    if (EMBEDDB_USING_CHECKPOINT(state->parameters) && state->checkpointInterval > 0 && state->nextDataPageId % state->checkpointInterval == 0)
+        embedDBCheckpoint(state);
+}
+
+/**
+ * @brief	Copies the bitmap of the data write buffer, and its summary when using EMBEDDB_USE_SUM, to a record of an index page.
+ * 			The data page is also added to the zone of the index page when using EMBEDDB_USE_ZONE_MAP.
+ * @param	state		embedDB algorithm state structure
+ * @param	indexPage	Index write buffer
+ * @param	indexRecord	Index of the record on the index page
+ */
+void writeIndexRecord(embedDBState *state, void *indexPage, count_t indexRecord) {
+    void *page = state->dataWriteBuffer;
+    int8_t *record = (int8_t *)indexPage + EMBEDDB_IDX_HEADER_SIZE + embedDBIndexRecordSize(state) * indexRecord;
+    memcpy(record, EMBEDDB_GET_BITMAP(page), state->bitmapSize);
+
+    if (state->zoneMap != NULL) {
+        int8_t hasDataRange = EMBEDDB_USING_MAX_MIN(state->parameters) && EMBEDDB_GET_COUNT(page) > 0;
+        zoneAddDataPage(state, state->nextIdxPageId, state->nextDataPageId - 1, EMBEDDB_GET_BITMAP(page), hasDataRange ? EMBEDDB_GET_MIN_DATA(page, state) : NULL, hasDataRange ? EMBEDDB_GET_MAX_DATA(page, state) : NULL);
+    }
+
+    if (!EMBEDDB_USING_SUM(state->parameters))
+        return;
+
+    count_t count = EMBEDDB_GET_COUNT(page);
+    record += state->bitmapSize;
+    memcpy(record, &count, sizeof(count_t));
+    record += sizeof(count_t);
+    memcpy(record, EMBEDDB_GET_SUM(page, state), sizeof(int64_t));
+    record += sizeof(int64_t);
+    memcpy(record, embedDBGetMinKey(state, page), state->keySize);
+    memcpy(record + state->keySize, count > 0 ? embedDBGetMaxKey(state, page) : embedDBGetMinKey(state, page), state->keySize);
+    record += state->keySize * 2;
+    if (EMBEDDB_USING_MAX_MIN(state->parameters))
+        memcpy(record, EMBEDDB_GET_MIN_DATA(page, state), state->dataSize * 2);
+}
+
+/**
+ * @brief	Adds a data page to the zone of its index page. The zone is started over if it belonged to an older index page.
+ * @param	state		embedDB algorithm state structure
+ * @param	indexPageId	Logical id of the index page holding the index record of the data page
+ * @param	dataPageId	Logical id of the data page
+ * @param	bitmap		Bitmap of the data page
+ * @param	minData		Smallest data of the data page. NULL if not known or the page is empty
+ * @param	maxData		Largest data of the data page. NULL if not known or the page is empty
+ */
+void zoneAddDataPage(embedDBState *state, id_t indexPageId, id_t dataPageId, void *bitmap, void *minData, void *maxData) {
+    embedDBZone *zone = embedDBGetZone(state, indexPageId);
+    uint8_t *zoneBitmap = (uint8_t *)(zone + 1);
+    int8_t *zoneMinData = (int8_t *)zoneBitmap + state->bitmapSize;
+    int8_t *zoneMaxData = zoneMinData + state->dataSize;
+    if (zone->indexPageId != indexPageId) {
+        zone->indexPageId = indexPageId;
+        zone->firstDataPageId = dataPageId;
+        zone->hasDataRange = 0;
+        memset(zoneBitmap, 0, state->bitmapSize);
     }
+    zone->numDataPages = dataPageId - zone->firstDataPageId + 1;
+
+    for (int8_t i = 0; i < state->bitmapSize; i++)
+        zoneBitmap[i] |= ((uint8_t *)bitmap)[i];
+
+    if (minData == NULL)
+        return;
+    if (!zone->hasDataRange || state->compareData(minData, zoneMinData) < 0)
+        memcpy(zoneMinData, minData, state->dataSize);
+    if (!zone->hasDataRange || state->compareData(maxData, zoneMaxData) > 0)
+        memcpy(zoneMaxData, maxData, state->dataSize);
+    zone->hasDataRange = 1;
+}
+
+/**
+ * @brief	Reads the clock of the state.
+ * @return	Current clock ticks, 0 if no clock is set
+ */
+static uint32_t statsClock(embedDBState *state) {
+    return state->clock != NULL ? state->clock() : 0;
+}
+
+/**
+ * @brief	Counts a call of an operation and reads the clock to time it.
+ * @param	state		embedDB algorithm state structure
+ * @param	operation	One of the EMBEDDB_STATS_ operations, such as EMBEDDB_STATS_PUT
+ * @return	Clock ticks at the start of the operation
+ */
+static uint32_t statsBegin(embedDBState *state, uint8_t operation) {
+    state->stats.operations[operation]++;
+    return statsClock(state);
+}
+
+/**
+ * @brief	Adds the ticks since the start of an operation to its latency histogram. Does nothing without a clock.
+ * @param	state		embedDB algorithm state structure
+ * @param	operation	Operation passed to statsBegin
+ * @param	start		Clock ticks returned by statsBegin
+ */
+static void statsEnd(embedDBState *state, uint8_t operation, uint32_t start) {
+    if (state->clock == NULL)
+        return;
+
+    /* Unsigned subtraction is correct when the clock wraps around */
+    uint32_t ticks = state->clock() - start;
+    embedDBLatencyStats *latency = &state->stats.latency[operation];
+
+    /* Bucket is the number of bits needed for the ticks */
+    uint8_t bucket = 0;
+    while (bucket < EMBEDDB_STATS_LATENCY_BUCKETS - 1 && (ticks >> bucket) != 0)
+        bucket++;
+
+    latency->histogram[bucket]++;
+    latency->count++;
+    latency->totalTicks += ticks;
+    if (ticks > latency->maxTicks)
+        latency->maxTicks = ticks;
 }
 
 /**
@@ -704,66 +2649,33 @@ void indexPage(embedDBState *state, uint32_t pageNumber) {
  * @param	data	Data for record
  * @return	Return 0 if success. Non-zero value if error.
  */
-int8_t embedDBPut(embedDBState *state, void *key, void *data) {
+static int8_t putRecord(embedDBState *state, void *key, void *data) {
     /* Copy record into block */
-    count_t count = EMBEDDB_GET_COUNT(state->buffer);
-    if (state->minKey != UINT32_MAX) {
-        void *previousKey = NULL;
-        if (count == 0) {
-            readPage(state, (state->nextDataPageId - 1) % state->numDataPages);
-            previousKey = ((int8_t *)state->buffer + state->pageSize * EMBEDDB_DATA_READ_BUFFER) +
-                          (state->recordSize * (state->maxRecordsPerPage - 1)) + state->headerSize;
-        } else {
-            previousKey = (int8_t *)state->buffer + (state->recordSize * (count - 1)) + state->headerSize;
-        }
-        if (state->compareKey(key, previousKey) != 1) {
+    count_t count = EMBEDDB_GET_COUNT(state->dataWriteBuffer);
+    if (state->minKey != UINT32_MAX && compareKeys(state, key, &state->maxKey) != 1) {
 #ifdef PRINT_ERRORS
-            printf("Keys must be strictly ascending order. Insert Failed.\n");
+        printf("Keys must be strictly ascending order. Insert Failed.\n");
 #endif
-            return 1;
-        }
+        return 1;
     }
 
-    /* Write current page if full */
-    if (count >= state->maxRecordsPerPage) {
-        // As the first buffer is the data write buffer, no manipulation is required
-        id_t pageNum = writePage(state, state->buffer);
-
-        indexPage(state, pageNum);
-
-        /* Save record in index file */
-        if (state->indexFile != NULL) {
-            void *buf = (int8_t *)state->buffer + state->pageSize * (EMBEDDB_INDEX_WRITE_BUFFER);
-            count_t idxcount = EMBEDDB_GET_COUNT(buf);
-            if (idxcount >= state->maxIdxRecordsPerPage) {
-                /* Save index page */
-                writeIndexPage(state, buf);
-
-                idxcount = 0;
-                initBufferPage(state, EMBEDDB_INDEX_WRITE_BUFFER);
-
-                /* Add page id to minimum value spot in page */
-                id_t *ptr = (id_t *)((int8_t *)buf + 8);
-                *ptr = pageNum;
-            }
+    int8_t began = snapshotBeginWrite(state);
 
-            EMBEDDB_INC_COUNT(buf);
-
-            /* Copy record onto index page */
-            void *bm = EMBEDDB_GET_BITMAP(state->buffer);
-            memcpy((void *)((int8_t *)buf + EMBEDDB_IDX_HEADER_SIZE + state->bitmapSize * idxcount), bm, state->bitmapSize);
+    /* Write current page if full */
+    if (embedDBDataPageFull(state, key, data)) {
+        if (snapshotHoldsNextPages(state, 1, 0)) {
+#ifdef PRINT_ERRORS
+            printf("ERROR: Storage is full and the oldest pages are held by a reader snapshot. Insert Failed.\n");
+#endif
+            snapshotEndWrite(state, began);
+            return 2;
         }
-
-        updateAverageKeyDifference(state, state->buffer);
-        updateMaxiumError(state, state->buffer);
-
+        writeFullDataPage(state);
         count = 0;
-        initBufferPage(state, 0);
     }
 
     /* Copy record onto page */
-    memcpy((int8_t *)state->buffer + (state->recordSize * count) + state->headerSize, key, state->keySize);
-    memcpy((int8_t *)state->buffer + (state->recordSize * count) + state->headerSize + state->keySize, data, state->dataSize);
+    embedDBWriteRecord(state, state->dataWriteBuffer, count, key, data);
 
     /* Copy variable data offset if using variable data*/
     if (EMBEDDB_USING_VDATA(state->parameters)) {
@@ -773,15 +2685,18 @@ int8_t embedDBPut(embedDBState *state, void *key, void *data) {
         } else {
             dataLocation = EMBEDDB_NO_VAR_DATA;
         }
-        memcpy((int8_t *)state->buffer + (state->recordSize * count) + state->headerSize + state->keySize + state->dataSize, &dataLocation, sizeof(uint32_t));
+        memcpy(embedDBRecordVarLocation(state, state->dataWriteBuffer, count), &dataLocation, sizeof(uint32_t));
     }
 
     /* Update count */
-    EMBEDDB_INC_COUNT(state->buffer);
+    EMBEDDB_INC_COUNT(state->dataWriteBuffer);
+    if (EMBEDDB_USING_COMPRESSION(state->parameters))
+        compressRecord(state, NULL, &state->compressedPageBits, state->dataWriteBuffer, count);
 
     /* Set minimum key for first record insert */
     if (state->minKey == UINT32_MAX)
         memcpy(&state->minKey, key, state->keySize);
+    memcpy(&state->maxKey, key, state->keySize);
 
     if (EMBEDDB_USING_MAX_MIN(state->parameters)) {
         /* Update MIN/MAX */
@@ -789,38 +2704,263 @@ int8_t embedDBPut(embedDBState *state, void *key, void *data) {
         if (count != 0) {
             /* Since keys are inserted in ascending order, every insert will
              * update max. Min will never change after first record. */
-            ptr = EMBEDDB_GET_MAX_KEY(state->buffer, state);
+            ptr = EMBEDDB_GET_MAX_KEY(state->dataWriteBuffer, state);
             memcpy(ptr, key, state->keySize);
 
-            ptr = EMBEDDB_GET_MIN_DATA(state->buffer, state);
+            ptr = EMBEDDB_GET_MIN_DATA(state->dataWriteBuffer, state);
             if (state->compareData(data, ptr) < 0)
                 memcpy(ptr, data, state->dataSize);
-            ptr = EMBEDDB_GET_MAX_DATA(state->buffer, state);
+            ptr = EMBEDDB_GET_MAX_DATA(state->dataWriteBuffer, state);
             if (state->compareData(data, ptr) > 0)
                 memcpy(ptr, data, state->dataSize);
         } else {
             /* First record inserted */
-            ptr = EMBEDDB_GET_MIN_KEY(state->buffer);
+            ptr = EMBEDDB_GET_MIN_KEY(state->dataWriteBuffer);
             memcpy(ptr, key, state->keySize);
-            ptr = EMBEDDB_GET_MAX_KEY(state->buffer, state);
+            ptr = EMBEDDB_GET_MAX_KEY(state->dataWriteBuffer, state);
             memcpy(ptr, key, state->keySize);
 
-            ptr = EMBEDDB_GET_MIN_DATA(state->buffer, state);
+            ptr = EMBEDDB_GET_MIN_DATA(state->dataWriteBuffer, state);
             memcpy(ptr, data, state->dataSize);
-            ptr = EMBEDDB_GET_MAX_DATA(state->buffer, state);
+            ptr = EMBEDDB_GET_MAX_DATA(state->dataWriteBuffer, state);
             memcpy(ptr, data, state->dataSize);
         }
     }
 
     if (EMBEDDB_USING_BMAP(state->parameters)) {
         /* Update bitmap */
-        char *bm = (char *)EMBEDDB_GET_BITMAP(state->buffer);
-        state->updateBitmap(data, bm);
+        char *bm = (char *)EMBEDDB_GET_BITMAP(state->dataWriteBuffer);
+        if (state->bitmapSample != NULL)
+            bitmapAddSample(state, data);
+        else
+            embedDBUpdateBitmap(state, data, bm);
+    }
+
+    if (EMBEDDB_USING_SUM(state->parameters))
+        embedDBAddToPageSum(state, state->dataWriteBuffer, data);
+
+    snapshotEndWrite(state, began);
+    return 0;
+}
+
+/**
+ * @brief	Puts a given key, data pair into structure, counting and timing the put.
+ */
+static int8_t countedPut(embedDBState *state, void *key, void *data) {
+    uint32_t start = statsBegin(state, EMBEDDB_STATS_PUT);
+    int8_t result = putRecord(state, key, data);
+    statsEnd(state, EMBEDDB_STATS_PUT, start);
+    return result;
+}
+
+/**
+ * @brief	Passes an inserted record to the insert listener. A failure is kept in insertListenerError as the record is already inserted.
+ */
+static void notifyInsertListener(embedDBState *state, void *key, void *data) {
+    if (state->insertListener == NULL)
+        return;
+    int8_t result = state->insertListener(state->insertListenerContext, key, data);
+    if (result != 0) {
+#ifdef PRINT_ERRORS
+        printf("ERROR: Insert listener failed with %d. The record stays inserted.\n", result);
+#endif
+        state->insertListenerError = result;
+    }
+}
+
+/**
+ * @brief	Puts a given key, data pair into structure, counting and timing the put, then passes it to the insert listener.
+ */
+int8_t embedDBPut(embedDBState *state, void *key, void *data) {
+    int8_t result = countedPut(state, key, data);
+    if (result == 0)
+        notifyInsertListener(state, key, data);
+    return result;
+}
+
+/**
+ * @brief	Returns the largest number of data pages an insert of numRecords records can write. Compressed pages are assumed to hold only records of
+ * 			the largest compressed size, so the count can be too high for them.
+ */
+static uint32_t batchPageWrites(embedDBState *state, uint32_t numRecords) {
+    count_t count = EMBEDDB_GET_COUNT(state->dataWriteBuffer);
+    /* Pages are only written once the record after them arrives */
+    if (!EMBEDDB_USING_COMPRESSION(state->parameters))
+        return (count + numRecords - 1) / state->maxRecordsPerPage;
+
+    /* Largest compressed record: the longest key prefix with the whole key, then every value of at most 8 bytes with its compressValue header */
+    uint32_t recordBits = sizeof(keyDeltaBits) + state->keySize * 8 + state->dataSize * 8;
+    uint8_t numColumns = state->numDataColumns > 1 ? state->numDataColumns : 1;
+    for (uint8_t i = 0; i < numColumns; i++) {
+        uint8_t columnSize = numColumns > 1 ? abs(state->dataColumnSizes[i]) : state->dataSize;
+        recordBits += COMPRESSED_VALUE_MAX_BITS(0) * ((columnSize + 7) / 8);
+    }
+    if (EMBEDDB_USING_VDATA(state->parameters))
+        recordBits += COMPRESSED_VALUE_MAX_BITS(32);
+    uint32_t recordsPerPage = (uint32_t)(state->pageSize - state->headerSize) * 8 / recordBits;
+    recordsPerPage = max(1, min(recordsPerPage, state->maxRecordsPerPage));
+
+    /* The open page is written at most once, then every later page holds at least recordsPerPage records */
+    return (count > 0 ? 1 : 0) + (numRecords - 1) / recordsPerPage;
+}
+
+/**
+ * @brief	Inserts the records of embedDBPutBatch.
+ */
+static int8_t putBatch(embedDBState *state, void *keys, void *data, uint32_t numRecords) {
+    if (numRecords == 0)
+        return 0;
+
+    /* Check the order of the whole batch once before inserting anything */
+    int8_t *key = (int8_t *)keys;
+    if (state->minKey != UINT32_MAX && compareKeys(state, key, &state->maxKey) != 1) {
+#ifdef PRINT_ERRORS
+        printf("Keys must be strictly ascending order. Insert Failed.\n");
+#endif
+        return 1;
+    }
+    for (uint32_t i = 1; i < numRecords; i++) {
+        if (compareKeys(state, key + state->keySize, key) != 1) {
+#ifdef PRINT_ERRORS
+            printf("Keys must be strictly ascending order. Insert Failed.\n");
+#endif
+            return 1;
+        }
+        key += state->keySize;
+    }
+
+    int8_t began = snapshotBeginWrite(state);
+
+    /* The space is checked before the first insert, so a batch that would erase pages held by a reader snapshot inserts nothing */
+    if (snapshotHoldsNextPages(state, batchPageWrites(state, numRecords), 0)) {
+#ifdef PRINT_ERRORS
+        printf("ERROR: Storage is full and the oldest pages are held by a reader snapshot. Insert Failed.\n");
+#endif
+        snapshotEndWrite(state, began);
+        return 2;
+    }
+
+    /* Variable data pages must be kept in step with the data pages, compressed pages fill up one record at a time and the bitmap bucket sample is
+     * taken one record at a time, so each record goes through the regular insert */
+    if (EMBEDDB_USING_VDATA(state->parameters) || EMBEDDB_USING_COMPRESSION(state->parameters) || state->bitmapSample != NULL) {
+        for (uint32_t i = 0; i < numRecords; i++) {
+            void *recordKey = (int8_t *)keys + i * state->keySize;
+            void *recordData = (int8_t *)data + i * state->dataSize;
+            int8_t r = EMBEDDB_USING_VDATA(state->parameters) ? embedDBPutVar(state, recordKey, recordData, NULL, 0) : embedDBPut(state, recordKey, recordData);
+            if (r != 0) {
+                snapshotEndWrite(state, began);
+                return r;
+            }
+        }
+        snapshotEndWrite(state, began);
+        return 0;
+    }
+
+    if (state->minKey == UINT32_MAX)
+        memcpy(&state->minKey, keys, state->keySize);
+
+    uint32_t numInserted = 0;
+    while (numInserted < numRecords) {
+        count_t count = EMBEDDB_GET_COUNT(state->dataWriteBuffer);
+        if (count >= state->maxRecordsPerPage) {
+            writeFullDataPage(state);
+            count = 0;
+        }
+
+        /* Fill as much of the page as the batch allows */
+        count_t numToCopy = min(state->maxRecordsPerPage - count, numRecords - numInserted);
+        int8_t *firstKey = (int8_t *)keys + numInserted * state->keySize;
+        int8_t *firstData = (int8_t *)data + numInserted * state->dataSize;
+        key = firstKey;
+        int8_t *value = firstData;
+        if (EMBEDDB_USING_PAX(state->parameters)) {
+            for (count_t i = 0; i < numToCopy; i++) {
+                embedDBWriteRecord(state, state->dataWriteBuffer, count + i, key, value);
+                key += state->keySize;
+                value += state->dataSize;
+            }
+        } else {
+            int8_t *record = (int8_t *)state->dataWriteBuffer + state->headerSize + state->recordSize * count;
+            for (count_t i = 0; i < numToCopy; i++) {
+                memcpy(record, key, state->keySize);
+                memcpy(record + state->keySize, value, state->dataSize);
+                record += state->recordSize;
+                key += state->keySize;
+                value += state->dataSize;
+            }
+        }
+        int8_t *lastKey = key - state->keySize;
+
+        if (EMBEDDB_USING_MAX_MIN(state->parameters)) {
+            /* Find the smallest and largest data in the copied records, then update the header once */
+            void *minData = count == 0 ? firstData : EMBEDDB_GET_MIN_DATA(state->dataWriteBuffer, state);
+            void *maxData = count == 0 ? firstData : EMBEDDB_GET_MAX_DATA(state->dataWriteBuffer, state);
+            value = firstData;
+            for (count_t i = 0; i < numToCopy; i++) {
+                if (state->compareData(value, minData) < 0)
+                    minData = value;
+                if (state->compareData(value, maxData) > 0)
+                    maxData = value;
+                value += state->dataSize;
+            }
+            if (count == 0)
+                memcpy(EMBEDDB_GET_MIN_KEY(state->dataWriteBuffer), firstKey, state->keySize);
+            memcpy(EMBEDDB_GET_MAX_KEY(state->dataWriteBuffer, state), lastKey, state->keySize);
+            if (minData != EMBEDDB_GET_MIN_DATA(state->dataWriteBuffer, state))
+                memcpy(EMBEDDB_GET_MIN_DATA(state->dataWriteBuffer, state), minData, state->dataSize);
+            if (maxData != EMBEDDB_GET_MAX_DATA(state->dataWriteBuffer, state))
+                memcpy(EMBEDDB_GET_MAX_DATA(state->dataWriteBuffer, state), maxData, state->dataSize);
+        }
+
+        if (EMBEDDB_USING_BMAP(state->parameters)) {
+            char *bm = (char *)EMBEDDB_GET_BITMAP(state->dataWriteBuffer);
+            value = firstData;
+            for (count_t i = 0; i < numToCopy; i++) {
+                embedDBUpdateBitmap(state, value, bm);
+                value += state->dataSize;
+            }
+        }
+
+        if (EMBEDDB_USING_SUM(state->parameters)) {
+            value = firstData;
+            for (count_t i = 0; i < numToCopy; i++) {
+                embedDBAddToPageSum(state, state->dataWriteBuffer, value);
+                value += state->dataSize;
+            }
+        }
+
+        EMBEDDB_GET_COUNT(state->dataWriteBuffer) = count + numToCopy;
+        memcpy(&state->maxKey, lastKey, state->keySize);
+        numInserted += numToCopy;
     }
+    state->stats.operations[EMBEDDB_STATS_PUT] += numInserted;
 
+    snapshotEndWrite(state, began);
+
+    if (state->insertListener != NULL) {
+        for (uint32_t i = 0; i < numRecords; i++)
+            notifyInsertListener(state, (int8_t *)keys + i * state->keySize, (int8_t *)data + i * state->dataSize);
+    }
     return 0;
 }
 
+/**
+ * @brief	Puts an array of key, data pairs into structure.
+ * 			The batch must be in strictly ascending key order and larger than every key already inserted.
+ * 			The whole batch is inserted or, if it returns an error, nothing is. Records inserted with a batch have no variable data.
+ * @param	state		embedDB algorithm state structure
+ * @param	keys		Array of numRecords keys, each keySize bytes
+ * @param	data		Array of numRecords data values, each dataSize bytes
+ * @param	numRecords	Number of records in the batch
+ * @return	Return 0 if success. Non-zero value if error.
+ */
+int8_t embedDBPutBatch(embedDBState *state, void *keys, void *data, uint32_t numRecords) {
+    uint32_t start = statsBegin(state, EMBEDDB_STATS_PUT_BATCH);
+    int8_t result = putBatch(state, keys, data, numRecords);
+    statsEnd(state, EMBEDDB_STATS_PUT_BATCH, start);
+    return result;
+}
+
 void updateMaxiumError(embedDBState *state, void *buffer) {
     // Calculate error within the page
     int32_t maxError = getMaxError(state, buffer);
@@ -847,30 +2987,35 @@ void updateAverageKeyDifference(embedDBState *state, void *buffer) {
 }
 
 /**
- * @brief	Puts the given key, data, and variable length data into the structure.
- * @param	state			embedDB algorithm state structure
- * @param	key				Key for record
- * @param	data			Data for record
- * @param	variableData	Variable length data for record
- * @param	length			Length of the variable length data in bytes
- * @return	Return 0 if success. Non-zero value if error.
+ * @brief	Puts the given key, data, and variable length data into the structure. With direct set, variable data pages that are fully covered by
+ * 			the variable data are written from the caller's buffer with the file interface's gather write.
  */
-int8_t embedDBPutVar(embedDBState *state, void *key, void *data, void *variableData, uint32_t length) {
+static int8_t putVarRecord(embedDBState *state, void *key, void *data, void *variableData, uint32_t length, int8_t direct) {
     if (!EMBEDDB_USING_VDATA(state->parameters)) {
 #ifdef PRINT_ERRORS
         printf("Error: Can't insert variable data because it is not enabled\n");
 #endif
         return -1;
     }
+    direct = direct && state->fileInterface->writeGather != NULL;
 
     // Insert their data
+    int8_t began = snapshotBeginWrite(state);
+    int8_t pageFull = embedDBDataPageFull(state, key, data);
+    if (pageFull && snapshotHoldsNextPages(state, 1, 0)) {
+#ifdef PRINT_ERRORS
+        printf("ERROR: Storage is full and the oldest pages are held by a reader snapshot. Insert Failed.\n");
+#endif
+        snapshotEndWrite(state, began);
+        return 2;
+    }
 
     /*
      * Check that there is enough space remaining in this page to start the insert of the variable
      * data here and if the data page will be written in embedDBGet
      */
     void *buf = (int8_t *)state->buffer + state->pageSize * (EMBEDDB_VAR_WRITE_BUFFER(state->parameters));
-    if (state->currentVarLoc % state->pageSize > state->pageSize - 4 || EMBEDDB_GET_COUNT(state->buffer) >= state->maxRecordsPerPage) {
+    if (state->currentVarLoc % state->pageSize > state->pageSize - 4 || pageFull) {
         writeVariablePage(state, buf);
         initBufferPage(state, EMBEDDB_VAR_WRITE_BUFFER(state->parameters));
         // Move data writing location to the beginning of the next page, leaving the room for the header
@@ -880,13 +3025,18 @@ int8_t embedDBPutVar(embedDBState *state, void *key, void *data, void *variableD
     if (variableData == NULL) {
         // Var data enabled, but not provided
         state->recordHasVarData = 0;
-        return embedDBPut(state, key, data);
+        int8_t r = countedPut(state, key, data);
+        snapshotEndWrite(state, began);
+        if (r == 0)
+            notifyInsertListener(state, key, data);
+        return r;
     }
 
-    // Perform the regular insert
+    // Perform the regular insert. The listener sees the record only once its variable data is written
     state->recordHasVarData = 1;
     int8_t r;
-    if ((r = embedDBPut(state, key, data)) != 0) {
+    if ((r = countedPut(state, key, data)) != 0) {
+        snapshotEndWrite(state, began);
         return r;
     }
 
@@ -909,6 +3059,20 @@ int8_t embedDBPutVar(embedDBState *state, void *key, void *data, void *variableD
 
     int amtWritten = 0;
     while (length > 0) {
+        /* A page the data fills completely is written from the caller's buffer, with the header from a separate buffer */
+        uint16_t headerSize = state->variableDataHeaderSize;
+        if (direct && state->currentVarLoc % state->pageSize == headerSize && length >= (uint32_t)(state->pageSize - headerSize)) {
+            int8_t header[sizeof(id_t) + sizeof(uint64_t)];
+            memcpy(header + sizeof(id_t), key, state->keySize);
+            writeVariablePageGather(state, header, (int8_t *)variableData + amtWritten);
+
+            length -= state->pageSize - headerSize;
+            amtWritten += state->pageSize - headerSize;
+            state->currentVarLoc += state->pageSize;
+            state->stats.varPagesDirect++;
+            continue;
+        }
+
         // Copy data into the buffer. Write the min of the space left in this page and the remaining length of the data
         uint16_t amtToWrite = min(state->pageSize - state->currentVarLoc % state->pageSize, length);
         memcpy((uint8_t *)buf + (state->currentVarLoc % state->pageSize), (uint8_t *)variableData + amtWritten, amtToWrite);
@@ -926,9 +3090,40 @@ int8_t embedDBPutVar(embedDBState *state, void *key, void *data, void *variableD
             state->currentVarLoc += state->variableDataHeaderSize;
         }
     }
+    snapshotEndWrite(state, began);
+    notifyInsertListener(state, key, data);
     return 0;
 }
 
+/**
+ * @brief	Puts the given key, data, and variable length data into the structure.
+ * @param	state			embedDB algorithm state structure
+ * @param	key				Key for record
+ * @param	data			Data for record
+ * @param	variableData	Variable length data for record
+ * @param	length			Length of the variable length data in bytes
+ * @return	Return 0 if success. Non-zero value if error.
+ */
+int8_t embedDBPutVar(embedDBState *state, void *key, void *data, void *variableData, uint32_t length) {
+    return putVarRecord(state, key, data, variableData, length, 0);
+}
+
+/**
+ * @brief	Puts the given key, data, and large variable length data into the structure. Variable data pages that the data fills completely are
+ * 			written straight from @c variableData with the file interface's gather write instead of being copied through the variable data
+ * 			write buffer. The data before the first page boundary and after the last full page is still copied through the write buffer.
+ * 			If the file interface has no gather write, this is the same as embedDBPutVar. @c variableData is never written to.
+ * @param	state			embedDB algorithm state structure
+ * @param	key				Key for record
+ * @param	data			Data for record
+ * @param	variableData	Variable length data for record
+ * @param	length			Length of the variable length data in bytes
+ * @return	Return 0 if success. Non-zero value if error.
+ */
+int8_t embedDBPutVarBulk(embedDBState *state, void *key, void *data, void *variableData, uint32_t length) {
+    return putVarRecord(state, key, data, variableData, length, 1);
+}
+
 /**
  * @brief	Given a key, estimates the location of the key within the node.
  * @param	state	embedDB algorithm state structure
@@ -947,6 +3142,137 @@ int16_t embedDBEstimateKeyLocation(embedDBState *state, void *buffer, void *key)
     return (thisKey - minKey) / slope;
 }
 
+/**
+ * @brief	Counts the bits set in a compare mask.
+ */
+static inline count_t countBits(uint32_t bits) {
+    count_t numBits = 0;
+    for (; bits != 0; bits &= bits - 1)
+        numBits++;
+    return numBits;
+}
+
+/**
+ * @brief	Counts the 4 byte unsigned keys in a window of records that are less than the search key.
+ * @param	keys		Pointer to the key of the first record in the window
+ * @param	recordSize	Size of each record in bytes
+ * @param	length		Number of records in the window. At most SEARCH_SCAN_KEYS
+ * @param	searchKey	Key to compare against
+ * @return	Number of keys less than the search key
+ */
+static inline count_t countKeysBelow32(int8_t *keys, uint16_t recordSize, count_t length, uint32_t searchKey) {
+#if defined(__AVX2__)
+    /* Gather the strided keys and only load the lanes inside the window */
+    __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    __m256i mask = _mm256_cmpgt_epi32(_mm256_set1_epi32(length), lanes);
+    __m256i offsets = _mm256_mullo_epi32(lanes, _mm256_set1_epi32(recordSize));
+    __m256i values = _mm256_mask_i32gather_epi32(_mm256_setzero_si256(), (const int *)keys, offsets, mask, 1);
+    /* Flip the sign bits so the signed compare orders the keys as unsigned */
+    __m256i sign = _mm256_set1_epi32(INT32_MIN);
+    __m256i below = _mm256_cmpgt_epi32(_mm256_xor_si256(_mm256_set1_epi32(searchKey), sign), _mm256_xor_si256(values, sign));
+    return countBits(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_and_si256(below, mask))));
+#elif defined(__SSE2__) || defined(_M_X64) || defined(__ARM_NEON)
+    /* Copy the strided keys together. Keys past the window are set to the largest key so they are never below */
+    uint32_t values[8];
+    for (count_t i = 0; i < 8; i++) {
+        values[i] = UINT32_MAX;
+        if (i < length)
+            memcpy(&values[i], keys + recordSize * i, sizeof(uint32_t));
+    }
+#if defined(__ARM_NEON)
+    uint32x4_t search = vdupq_n_u32(searchKey);
+    uint32x4_t below = vaddq_u32(vshrq_n_u32(vcltq_u32(vld1q_u32(values), search), 31), vshrq_n_u32(vcltq_u32(vld1q_u32(values + 4), search), 31));
+    uint32x2_t sum = vadd_u32(vget_low_u32(below), vget_high_u32(below));
+    return vget_lane_u32(sum, 0) + vget_lane_u32(sum, 1);
+#else
+    __m128i sign = _mm_set1_epi32(INT32_MIN);
+    __m128i search = _mm_xor_si128(_mm_set1_epi32(searchKey), sign);
+    __m128i low = _mm_cmpgt_epi32(search, _mm_xor_si128(_mm_loadu_si128((__m128i *)values), sign));
+    __m128i high = _mm_cmpgt_epi32(search, _mm_xor_si128(_mm_loadu_si128((__m128i *)(values + 4)), sign));
+    return countBits(_mm_movemask_ps(_mm_castsi128_ps(low)) | (_mm_movemask_ps(_mm_castsi128_ps(high)) << 4));
+#endif
+#else
+    count_t numBelow = 0;
+    for (count_t i = 0; i < length; i++) {
+        uint32_t value;
+        memcpy(&value, keys + recordSize * i, sizeof(uint32_t));
+        numBelow += value < searchKey;
+    }
+    return numBelow;
+#endif
+}
+
+/**
+ * @brief	Counts the 8 byte unsigned keys in a window of records that are less than the search key.
+ * @param	keys		Pointer to the key of the first record in the window
+ * @param	recordSize	Size of each record in bytes
+ * @param	length		Number of records in the window. At most SEARCH_SCAN_KEYS
+ * @param	searchKey	Key to compare against
+ * @return	Number of keys less than the search key
+ */
+static inline count_t countKeysBelow64(int8_t *keys, uint16_t recordSize, count_t length, uint64_t searchKey) {
+#if defined(__AVX2__)
+    __m256i sign = _mm256_set1_epi64x(INT64_MIN);
+    __m256i search = _mm256_xor_si256(_mm256_set1_epi64x((int64_t)searchKey), sign);
+    count_t numBelow = 0;
+    for (count_t first = 0; first < length; first += 4) {
+        __m128i lanes = _mm_setr_epi32(first, first + 1, first + 2, first + 3);
+        __m256i mask = _mm256_cvtepi32_epi64(_mm_cmpgt_epi32(_mm_set1_epi32(length), lanes));
+        __m128i offsets = _mm_mullo_epi32(lanes, _mm_set1_epi32(recordSize));
+        __m256i values = _mm256_mask_i32gather_epi64(_mm256_setzero_si256(), (const long long *)keys, offsets, mask, 1);
+        __m256i below = _mm256_and_si256(_mm256_cmpgt_epi64(search, _mm256_xor_si256(values, sign)), mask);
+        numBelow += countBits(_mm256_movemask_pd(_mm256_castsi256_pd(below)));
+    }
+    return numBelow;
+#elif defined(__SSE4_2__) || (defined(__ARM_NEON) && defined(__aarch64__))
+    uint64_t values[8];
+    for (count_t i = 0; i < 8; i++) {
+        values[i] = UINT64_MAX;
+        if (i < length)
+            memcpy(&values[i], keys + recordSize * i, sizeof(uint64_t));
+    }
+    count_t numBelow = 0;
+#if defined(__SSE4_2__)
+    __m128i sign = _mm_set1_epi64x(INT64_MIN);
+    __m128i search = _mm_xor_si128(_mm_set1_epi64x((int64_t)searchKey), sign);
+    for (count_t i = 0; i < length; i += 2) {
+        __m128i below = _mm_cmpgt_epi64(search, _mm_xor_si128(_mm_loadu_si128((__m128i *)(values + i)), sign));
+        numBelow += countBits(_mm_movemask_pd(_mm_castsi128_pd(below)));
+    }
+#else
+    uint64x2_t search = vdupq_n_u64(searchKey);
+    for (count_t i = 0; i < length; i += 2) {
+        uint64x2_t below = vshrq_n_u64(vcltq_u64(vld1q_u64(values + i), search), 63);
+        numBelow += vgetq_lane_u64(below, 0) + vgetq_lane_u64(below, 1);
+    }
+#endif
+    return numBelow;
+#else
+    count_t numBelow = 0;
+    for (count_t i = 0; i < length; i++) {
+        uint64_t value;
+        memcpy(&value, keys + recordSize * i, sizeof(uint64_t));
+        numBelow += value < searchKey;
+    }
+    return numBelow;
+#endif
+}
+
+/**
+ * @brief	Counts the unsigned keys in a window of records that are less than the search key.
+ * @param	keys		Pointer to the key of the first record in the window
+ * @param	recordSize	Size of each record in bytes
+ * @param	keySize		Size of the keys. Must be 4 or 8
+ * @param	length		Number of records in the window. At most SEARCH_SCAN_KEYS
+ * @param	searchKey	Key to compare against
+ * @return	Number of keys less than the search key
+ */
+static inline count_t countKeysBelow(int8_t *keys, uint16_t recordSize, uint8_t keySize, count_t length, uint64_t searchKey) {
+    if (keySize == 4)
+        return countKeysBelow32(keys, recordSize, length, (uint32_t)searchKey);
+    return countKeysBelow64(keys, recordSize, length, searchKey);
+}
+
 /**
  * @brief	Given a key, searches the node for the key. If interior node, returns child record number containing next page id to follow. If leaf node, returns if of first record with that key or (<= key). Returns -1 if key is not found.
  * @param	state	embedDB algorithm state structure
@@ -976,9 +3302,44 @@ id_t embedDBSearchNode(embedDBState *state, void *buffer, void *key, int8_t rang
         middle = last;
     }
 
+    if (EMBEDDB_USING_UNSIGNED_KEYS(state->parameters) && (state->keySize == 4 || state->keySize == 8)) {
+        /* Search for the first key that is not less than the search key without branching on the comparisons */
+        uint64_t searchKey = loadUnsignedKey(key, state->keySize);
+        int8_t *keys = (int8_t *)buffer + state->headerSize;
+        uint16_t keyStride = embedDBKeyStride(state);
+        count_t base = 0, length = count > 0 ? count : 0;
+
+        /* Start from the keys within the max error of the estimated location if they contain the key */
+        if (state->maxError != -1 && middle > 0 && middle < count) {
+            int16_t low = middle - state->maxError, high = middle + state->maxError + 1;
+            if (low < 0)
+                low = 0;
+            if (high > count)
+                high = count;
+            if ((low == 0 || loadUnsignedKey(keys + keyStride * (low - 1), state->keySize) < searchKey) &&
+                (high == count || loadUnsignedKey(keys + keyStride * high, state->keySize) >= searchKey)) {
+                base = low;
+                length = high - low;
+            }
+        }
+
+        while (length > SEARCH_SCAN_KEYS) {
+            count_t half = length / 2;
+            base = loadUnsignedKey(keys + keyStride * (base + half), state->keySize) < searchKey ? base + half : base;
+            length -= half;
+        }
+        count_t position = base + countKeysBelow(keys + keyStride * base, keyStride, state->keySize, length, searchKey);
+
+        if (position < count && loadUnsignedKey(keys + keyStride * position, state->keySize) == searchKey)
+            return position;
+        if (range)
+            return position > 0 ? position - 1 : 0;
+        return -1;
+    }
+
     while (first <= last) {
-        mkey = (int8_t *)buffer + state->headerSize + (state->recordSize * middle);
-        compare = state->compareKey(mkey, key);
+        mkey = embedDBRecordKey(state, buffer, middle);
+        compare = compareKeys(state, mkey, key);
         if (compare < 0) {
             first = middle + 1;
         } else if (compare == 0) {
@@ -1000,14 +3361,13 @@ id_t embedDBSearchNode(embedDBState *state, void *buffer, void *key, int8_t rang
  * 			into the passed buffer pointer.
  * @param	state		embedDB algorithm state structure
  * @param 	numReads	Tracks total number of reads for statistics
- * @param	buf			buffer to store page with desired record
  * @param	key			Key for the record to search for
  * @param	pageId		Page id to start search from
  * @param 	low			Lower bound for the page the record could be found on
  * @param 	high		Upper bound for the page the record could be found on
  * @return	Return 0 if success. Non-zero value if error.
  */
-int8_t linearSearch(embedDBState *state, int16_t *numReads, void *buf, void *key, int32_t pageId, int32_t low, int32_t high) {
+int8_t linearSearch(embedDBState *state, int16_t *numReads, void *key, int32_t pageId, int32_t low, int32_t high) {
     int32_t pageError = 0;
     int32_t physPageId;
     while (1) {
@@ -1025,10 +3385,10 @@ int8_t linearSearch(embedDBState *state, int16_t *numReads, void *buf, void *key
         }
         *numReads += state->numReads - start;
 
-        if (state->compareKey(key, embedDBGetMinKey(state, buf)) < 0) { /* Key is less than smallest record in block. */
+        if (compareKeys(state, key, embedDBGetMinKey(state, state->dataReadBuffer)) < 0) { /* Key is less than smallest record in block. */
             high = --pageId;
             pageError++;
-        } else if (state->compareKey(key, embedDBGetMaxKey(state, buf)) > 0) { /* Key is larger than largest record in block. */
+        } else if (compareKeys(state, key, embedDBGetMaxKey(state, state->dataReadBuffer)) > 0) { /* Key is larger than largest record in block. */
             low = ++pageId;
             pageError++;
         } else {
@@ -1059,13 +3419,163 @@ int8_t searchBuffer(embedDBState *state, void *buffer, void *key, void *data) {
     // return 0 if found
     if (nextId != NO_RECORD_FOUND) {
         // Key found
-        memcpy(data, (void *)((int8_t *)buffer + state->headerSize + state->recordSize * nextId + state->keySize), state->dataSize);
+        embedDBCopyRecordData(state, buffer, nextId, data);
         return nextId;
     }
     // Key not found
     return NO_RECORD_FOUND;
 }
 
+/**
+ * @brief	Searches for the data page that may contain the given key with the search method of the state. Used by readPageForKey.
+ * @param	state	embedDB algorithm state structure
+ * @param	key		Key for the record to search for
+ * @return	Return 0 if a page was read. Non-zero value if error or no page can contain the key.
+ */
+static int8_t searchPageForKey(embedDBState *state, void *key) {
+    uint64_t thisKey = 0;
+    memcpy(&thisKey, key, state->keySize);
+
+    int16_t numReads = 0;
+
+    if (state->searchMethod == EMBEDDB_SEARCH_ESTIMATE) {
+        /* Perform a modified binary search that uses info on key location sequence for first placement. */
+
+        // Estimated difference between the first keys of adjacent pages
+        int64_t keysPerPage = (int64_t)state->maxRecordsPerPage * state->avgKeyDiff;
+        if (keysPerPage == 0)
+            keysPerPage = 1;
+
+        // Guess logical page id
+        uint32_t pageId;
+        if (compareKeys(state, key, (void *)&(state->minKey)) < 0) {
+            pageId = state->minDataPageId;
+        } else {
+            pageId = (thisKey - state->minKey) / keysPerPage + state->minDataPageId;
+
+            if (pageId >= state->nextDataPageId)
+                pageId = state->nextDataPageId - 1; /* Logical page would be beyond maximum. Set to last page. */
+        }
+
+        int64_t offset = 0;
+        uint32_t first = state->minDataPageId, last = state->nextDataPageId - 1;
+        while (1) {
+            /* Read page into buffer */
+            if (readPage(state, pageId % state->numDataPages) != 0)
+                return -1;
+            numReads++;
+
+            if (first >= last)
+                break;
+
+            if (compareKeys(state, key, embedDBGetMinKey(state, state->dataReadBuffer)) < 0) {
+                /* Key is less than smallest record in block. */
+                if (pageId == first)
+                    break;
+                last = pageId - 1;
+                uint64_t minKey = 0;
+                memcpy(&minKey, embedDBGetMinKey(state, state->dataReadBuffer), state->keySize);
+                offset = -(int64_t)((minKey - thisKey) / keysPerPage) - 1;
+                if ((int64_t)pageId + offset < first)
+                    offset = (int64_t)first - pageId;
+                pageId += offset;
+
+            } else if (compareKeys(state, key, embedDBGetMaxKey(state, state->dataReadBuffer)) > 0) {
+                /* Key is larger than largest record in block. */
+                if (pageId == last)
+                    break;
+                first = pageId + 1;
+                uint64_t maxKey = 0;
+                memcpy(&maxKey, embedDBGetMaxKey(state, state->dataReadBuffer), state->keySize);
+                offset = (thisKey - maxKey) / keysPerPage + 1;
+                if ((int64_t)pageId + offset > last)
+                    offset = (int64_t)last - pageId;
+                pageId += offset;
+            } else {
+                /* Found correct block */
+                break;
+            }
+        }
+    } else if (state->searchMethod == EMBEDDB_SEARCH_BINARY) {
+        /* Regular binary search */
+        uint32_t first = state->minDataPageId, last = state->nextDataPageId - 1;
+        uint32_t pageId = (first + last) / 2;
+        while (1) {
+            /* Read page into buffer */
+            if (readPage(state, pageId % state->numDataPages) != 0)
+                return -1;
+            numReads++;
+
+            if (first >= last)
+                break;
+
+            if (compareKeys(state, key, embedDBGetMinKey(state, state->dataReadBuffer)) < 0) {
+                /* Key is less than smallest record in block. */
+                if (pageId == first)
+                    break;
+                last = pageId - 1;
+                pageId = (first + last) / 2;
+            } else if (compareKeys(state, key, embedDBGetMaxKey(state, state->dataReadBuffer)) > 0) {
+                /* Key is larger than largest record in block. */
+                first = pageId + 1;
+                pageId = (first + last) / 2;
+            } else {
+                /* Found correct block */
+                break;
+            }
+        }
+    } else {
+        /* Spline search */
+        uint32_t location, lowbound, highbound;
+        uint32_t modelStart = statsClock(state);
+        if (state->radixBits > 0) {
+            radixsplineFind(state->rdix, key, splineComparator(state), &location, &lowbound, &highbound);
+        } else {
+            splineFind(state->spl, key, splineComparator(state), &location, &lowbound, &highbound);
+        }
+        state->stats.getModelTicks += statsClock(state) - modelStart;
+
+        // The spline may estimate a page before the oldest page kept
+        lowbound = max(lowbound, state->minDataPageId);
+        location = max(location, lowbound);
+
+        // Check if the currently buffered page is the correct one
+        if (!(lowbound <= state->bufferedPageId &&
+              highbound >= state->bufferedPageId &&
+              compareKeys(state, embedDBGetMinKey(state, state->dataReadBuffer), key) <= 0 &&
+              compareKeys(state, embedDBGetMaxKey(state, state->dataReadBuffer), key) >= 0)) {
+            if (linearSearch(state, &numReads, key, location, lowbound, highbound) == -1) {
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief	Uses the search method to read the data page that may contain the given key into the data read buffer.
+ * 			Counts the data pages probed and, with a clock, the ticks spent finding the page.
+ * @param	state	embedDB algorithm state structure
+ * @param	key		Key for the record to search for
+ * @return	Return 0 if a page was read. Non-zero value if error or no page can contain the key.
+ */
+int8_t readPageForKey(embedDBState *state, void *key) {
+    embedDBFileStats *dataStats = &state->stats.files[EMBEDDB_DATA_FILE];
+    uint32_t probesBefore = dataStats->reads + dataStats->bufferHits;
+    uint64_t modelTicksBefore = state->stats.getModelTicks;
+    uint32_t start = statsClock(state);
+
+    int8_t result = searchPageForKey(state, key);
+
+    uint32_t probes = dataStats->reads + dataStats->bufferHits - probesBefore;
+    state->stats.getPagesProbed += probes;
+    if (probes > state->stats.getMaxPagesProbed)
+        state->stats.getMaxPagesProbed = probes;
+    if (state->clock != NULL)
+        state->stats.getProbeTicks += (uint32_t)(statsClock(state) - start) - (state->stats.getModelTicks - modelTicksBefore);
+    return result;
+}
+
 /**
  * @brief	Given a key, returns data associated with key.
  * 			Note: Space for data must be already allocated.
@@ -1075,11 +3585,10 @@ int8_t searchBuffer(embedDBState *state, void *buffer, void *key, void *data) {
  * @param	data	Pre-allocated memory to copy data for record
  * @return	Return 0 if success. Non-zero value if error.
  */
-int8_t embedDBGet(embedDBState *state, void *key, void *data) {
-    void *outputBuffer = state->buffer;
+static int8_t getRecord(embedDBState *state, void *key, void *data) {
+    void *outputBuffer = state->dataWriteBuffer;
     if (state->nextDataPageId == 0) {
-        int8_t success = searchBuffer(state, outputBuffer, key, data);
-        if (success == 0) return success;
+        if (searchBuffer(state, outputBuffer, key, data) != NO_RECORD_FOUND) return 0;
 
 #ifdef PRINT_ERRORS
         printf("ERROR: No data in database.\n");
@@ -1090,9 +3599,6 @@ int8_t embedDBGet(embedDBState *state, void *key, void *data) {
     uint64_t thisKey = 0;
     memcpy(&thisKey, key, state->keySize);
 
-    void *buf = (int8_t *)state->buffer + state->pageSize;
-    int16_t numReads = 0;
-
     // if write buffer is not empty
     if ((EMBEDDB_GET_COUNT(outputBuffer) != 0)) {
         // get the max/min key from output buffer
@@ -1104,114 +3610,263 @@ int8_t embedDBGet(embedDBState *state, void *key, void *data) {
         if (thisKey > bufMaxKey) return -1;
         // if key >= buffer's min, check buffer
         if (thisKey >= bufMinKey) {
-            return (searchBuffer(state, outputBuffer, key, data));
+            return searchBuffer(state, outputBuffer, key, data) == NO_RECORD_FOUND ? -1 : 0;
         }
     }
 
-#if SEARCH_METHOD == 0
-    /* Perform a modified binary search that uses info on key location sequence for first placement. */
+    if (readPageForKey(state, key) != 0)
+        return -1;
 
-    // Guess logical page id
-    uint32_t pageId;
-    if (state->compareKey(key, (void *)&(state->minKey)) < 0) {
-        pageId = state->minDataPageId;
-    } else {
-        pageId = (thisKey - state->minKey) / (state->maxRecordsPerPage * state->avgKeyDiff) + state->minDataPageId;
+    uint32_t searchStart = statsClock(state);
+    id_t nextId = embedDBSearchNode(state, state->dataReadBuffer, key, 0);
+    state->stats.getRecordTicks += statsClock(state) - searchStart;
 
-        if (pageId >= state->nextDataPageId)
-            pageId = state->nextDataPageId - 1; /* Logical page would be beyond maximum. Set to last page. */
+    if (nextId != -1) {
+        /* Key found */
+        embedDBCopyRecordData(state, state->dataReadBuffer, nextId, data);
+        return 0;
     }
+    // Key not found
+    return -1;
+}
 
-    int32_t offset = 0;
-    uint32_t first = state->minDataPageId, last = state->nextDataPageId - 1;
-    while (1) {
-        /* Read page into buffer */
-        if (readPage(state, pageId % state->numDataPages) != 0)
+/**
+ * @brief	Given a key, returns data associated with key, counting and timing the get.
+ */
+int8_t embedDBGet(embedDBState *state, void *key, void *data) {
+    uint32_t start = statsBegin(state, EMBEDDB_STATS_GET);
+    int8_t result = getRecord(state, key, data);
+    statsEnd(state, EMBEDDB_STATS_GET, start);
+    return result;
+}
+
+/**
+ * @brief	Looks up the keys of embedDBGetMany.
+ */
+static int32_t getMany(embedDBState *state, void *keys, void *data, int8_t *found, uint32_t numKeys) {
+    for (uint32_t i = 1; i < numKeys; i++) {
+        if (compareKeys(state, (int8_t *)keys + i * state->keySize, (int8_t *)keys + (i - 1) * state->keySize) < 0) {
+#ifdef PRINT_ERRORS
+            printf("ERROR: Keys must be in ascending order.\n");
+#endif
             return -1;
-        numReads++;
+        }
+    }
 
-        if (first >= last)
-            break;
+    void *outputBuffer = state->dataWriteBuffer;
+    int8_t haveOutputRecords = EMBEDDB_GET_COUNT(outputBuffer) != 0;
+    int8_t havePage = 0;
+    int32_t numFound = 0;
+
+    for (uint32_t i = 0; i < numKeys; i++) {
+        void *key = (int8_t *)keys + i * state->keySize;
+        void *keyData = (int8_t *)data + i * state->dataSize;
+        found[i] = 0;
+
+        /* Keys at least as large as the smallest key in the write buffer can only be in the write buffer */
+        if (haveOutputRecords && compareKeys(state, key, embedDBGetMinKey(state, outputBuffer)) >= 0) {
+            if (searchBuffer(state, outputBuffer, key, keyData) != NO_RECORD_FOUND) {
+                found[i] = 1;
+                numFound++;
+            }
+            continue;
+        }
 
-        if (state->compareKey(key, embedDBGetMinKey(state, buf)) < 0) {
-            /* Key is less than smallest record in block. */
-            last = pageId - 1;
-            uint64_t minKey = 0;
-            memcpy(&minKey, embedDBGetMinKey(state, buf), state->keySize);
-            offset = (thisKey - minKey) / (state->maxRecordsPerPage * state->avgKeyDiff) - 1;
-            if (pageId + offset < first)
-                offset = first - pageId;
-            pageId += offset;
-
-        } else if (state->compareKey(key, embedDBGetMaxKey(state, buf)) > 0) {
-            /* Key is larger than largest record in block. */
-            first = pageId + 1;
-            uint64_t maxKey = 0;
-            memcpy(&maxKey, embedDBGetMaxKey(state, buf), state->keySize);
-            offset = (thisKey - maxKey) / (state->maxRecordsPerPage * state->avgKeyDiff) + 1;
-            if (pageId + offset > last)
-                offset = last - pageId;
-            pageId += offset;
-        } else {
-            /* Found correct block */
-            break;
+        if (state->nextDataPageId == 0)
+            continue;
+
+        /* Only search for a new page once the keys have moved past the page in the read buffer */
+        if (!havePage || compareKeys(state, key, embedDBGetMaxKey(state, state->dataReadBuffer)) > 0) {
+            havePage = readPageForKey(state, key) == 0;
+            if (!havePage)
+                continue;
+        }
+
+        id_t nextId = embedDBSearchNode(state, state->dataReadBuffer, key, 0);
+        if (nextId != NO_RECORD_FOUND) {
+            embedDBCopyRecordData(state, state->dataReadBuffer, nextId, keyData);
+            found[i] = 1;
+            numFound++;
         }
     }
-#elif SEARCH_METHOD == 1
-    /* Regular binary search */
-    uint32_t first = state->minDataPageId, last = state->nextDataPageId - 1;
-    uint32_t pageId = (first + last) / 2;
-    while (1) {
-        /* Read page into buffer */
-        if (readPage(state, pageId % state->numDataPages) != 0)
-            return -1;
-        numReads++;
+    return numFound;
+}
 
-        if (first >= last)
-            break;
+/**
+ * @brief	Given an array of keys in ascending order, returns the data associated with each key.
+ * 			Each data page is searched for only once, and every key on that page is resolved before moving on.
+ * 			Note: Space for data must be already allocated.
+ * @param	state	embedDB algorithm state structure
+ * @param	keys	Array of numKeys keys in ascending order
+ * @param	data	Pre-allocated memory for numKeys data values. Data for keys that are not found is left unchanged
+ * @param	found	Pre-allocated array of numKeys flags. Set to 1 if the key was found, 0 if not
+ * @param	numKeys	Number of keys to look up
+ * @return	Return number of keys found, -1 if the keys are not in ascending order.
+ */
+int32_t embedDBGetMany(embedDBState *state, void *keys, void *data, int8_t *found, uint32_t numKeys) {
+    uint32_t start = statsBegin(state, EMBEDDB_STATS_GET_MANY);
+    int32_t result = getMany(state, keys, data, found, numKeys);
+    if (result >= 0)
+        state->stats.operations[EMBEDDB_STATS_GET] += numKeys;
+    statsEnd(state, EMBEDDB_STATS_GET_MANY, start);
+    return result;
+}
+
+/**
+ * @brief	Returns the logical id of the first data page that may hold a key greater than or equal to the given key.
+ * @param	state	embedDB algorithm state structure
+ * @param	key		Key to search for. NULL for the first page
+ */
+static id_t firstPageForKey(embedDBState *state, void *key) {
+    if (key == NULL || state->nextDataPageId == state->minDataPageId)
+        return state->minDataPageId;
 
-        if (state->compareKey(key, embedDBGetMinKey(state, buf)) < 0) {
-            /* Key is less than smallest record in block. */
-            last = pageId - 1;
-            pageId = (first + last) / 2;
-        } else if (state->compareKey(key, embedDBGetMaxKey(state, buf)) > 0) {
-            /* Key is larger than largest record in block. */
-            first = pageId + 1;
-            pageId = (first + last) / 2;
+    if (state->searchMethod == EMBEDDB_SEARCH_SPLINE) {
+        uint32_t location, lowbound, highbound;
+        if (state->radixBits > 0) {
+            radixsplineFind(state->rdix, key, splineComparator(state), &location, &lowbound, &highbound);
         } else {
-            /* Found correct block */
-            break;
+            splineFind(state->spl, key, splineComparator(state), &location, &lowbound, &highbound);
         }
+        return max(lowbound, state->minDataPageId);
     }
-#elif SEARCH_METHOD == 2
-    /* Spline search */
-    uint32_t location, lowbound, highbound;
-    if (RADIX_BITS > 0) {
-        radixsplineFind(state->rdix, key, state->compareKey, &location, &lowbound, &highbound);
-    } else {
-        splineFind(state->spl, key, state->compareKey, &location, &lowbound, &highbound);
+
+    /* The binary searches end on the page holding the key, or next to where it would be */
+    if (readPageForKey(state, key) != 0)
+        return state->minDataPageId;
+    id_t pageId;
+    memcpy(&pageId, state->dataReadBuffer, sizeof(id_t));
+    return max(pageId, state->minDataPageId);
+}
+
+/**
+ * @brief	Adds the aggregates of a group of records to the result.
+ * @param	state	embedDB algorithm state structure
+ * @param	result	Aggregates to add to
+ * @param	count	Number of records in the group
+ * @param	sum		Sum of the summed column of the group
+ * @param	minData	Smallest data of the group. Only used with EMBEDDB_USE_MAX_MIN
+ * @param	maxData	Largest data of the group. Only used with EMBEDDB_USE_MAX_MIN
+ */
+static void aggregateMerge(embedDBState *state, embedDBAggregate *result, uint32_t count, int64_t sum, void *minData, void *maxData) {
+    if (count == 0)
+        return;
+    if (EMBEDDB_USING_MAX_MIN(state->parameters)) {
+        if (result->minData != NULL && (result->count == 0 || state->compareData(minData, result->minData) < 0))
+            memcpy(result->minData, minData, state->dataSize);
+        if (result->maxData != NULL && (result->count == 0 || state->compareData(maxData, result->maxData) > 0))
+            memcpy(result->maxData, maxData, state->dataSize);
     }
+    result->count += count;
+    result->sum += sum;
+}
 
-    // Check if the currently buffered page is the correct one
-    if (!(lowbound <= state->bufferedPageId &&
-          highbound >= state->bufferedPageId &&
-          state->compareKey(embedDBGetMinKey(state, buf), key) <= 0 &&
-          state->compareKey(embedDBGetMaxKey(state, buf), key) >= 0)) {
-        if (linearSearch(state, &numReads, buf, key, location, lowbound, highbound) == -1) {
-            return -1;
-        }
+/**
+ * @brief	Adds the records of a data page that are in a key range to the aggregates, checking each record.
+ * @param	state	embedDB algorithm state structure
+ * @param	page	In memory data page
+ * @param	minKey	Smallest key of the range. NULL for no lower bound
+ * @param	maxKey	Largest key of the range. NULL for no upper bound
+ * @param	result	Aggregates to add to
+ */
+static void aggregatePageRecords(embedDBState *state, void *page, void *minKey, void *maxKey, embedDBAggregate *result) {
+    int8_t dataScratch[INT8_MAX];
+    count_t count = EMBEDDB_GET_COUNT(page);
+    for (count_t i = 0; i < count; i++) {
+        void *key = embedDBRecordKey(state, page, i);
+        if (minKey != NULL && compareKeys(state, key, minKey) < 0)
+            continue;
+        if (maxKey != NULL && compareKeys(state, key, maxKey) > 0)
+            break;
+        void *data = embedDBRecordData(state, page, i, dataScratch);
+        aggregateMerge(state, result, 1, EMBEDDB_USING_SUM(state->parameters) ? embedDBSumValue(state, data) : 0, data, data);
     }
+}
 
+/**
+ * @brief	Computes the count, sum, average, min and max of the records in a key range.
+ * 			Only the pages at the ends of the range are searched record by record. Pages entirely inside the range are added from their summary
+ * 			in the index record when using EMBEDDB_USE_INDEX, or from the page header otherwise.
+ * @param	state	embedDB algorithm state structure
+ * @param	minKey	Smallest key of the range. NULL for no lower bound
+ * @param	maxKey	Largest key of the range. NULL for no upper bound
+ * @param	result	Return variable for the aggregates. minData and maxData must be set before the call
+ * @return	Return 0 if success, -1 if a page failed to read.
+ */
+int8_t embedDBGetRangeAggregate(embedDBState *state, void *minKey, void *maxKey, embedDBAggregate *result) {
+    result->count = 0;
+    result->sum = 0;
+    result->average = 0;
+
+    int8_t useIndex = EMBEDDB_USING_SUM(state->parameters) && state->indexFile != NULL;
+    for (id_t pageId = firstPageForKey(state, minKey); pageId <= state->nextDataPageId; pageId++) {
+        void *page = NULL, *summary = NULL;
+        if (pageId == state->nextDataPageId) {
+            page = state->dataWriteBuffer;
+        } else if (useIndex && readIndexRecord(state, pageId, &summary) < 0) {
+            return -1;
+        }
+        if (page == NULL && summary == NULL) {
+            if (readPage(state, pageId % state->numDataPages) != 0) {
+#ifdef PRINT_ERRORS
+                printf("ERROR: Failed to read data page %i (%i)\n", pageId, pageId % state->numDataPages);
 #endif
-    id_t nextId = embedDBSearchNode(state, buf, key, 0);
+                return -1;
+            }
+            page = state->dataReadBuffer;
+        }
 
-    if (nextId != -1) {
-        /* Key found */
-        memcpy(data, (void *)((int8_t *)buf + state->headerSize + state->recordSize * nextId + state->keySize), state->dataSize);
-        return 0;
+        /* Find the summary of the page in the index record or the page header */
+        count_t count;
+        int64_t sum = 0;
+        int8_t *pageMinKey, *pageMaxKey, *minData, *maxData;
+        if (summary != NULL) {
+            int8_t *ptr = (int8_t *)summary + state->bitmapSize;
+            memcpy(&count, ptr, sizeof(count_t));
+            memcpy(&sum, ptr + sizeof(count_t), sizeof(int64_t));
+            pageMinKey = ptr + sizeof(count_t) + sizeof(int64_t);
+            pageMaxKey = pageMinKey + state->keySize;
+            minData = pageMaxKey + state->keySize;
+            maxData = minData + state->dataSize;
+        } else {
+            count = EMBEDDB_GET_COUNT(page);
+            if (count == 0)
+                continue;
+            pageMinKey = embedDBGetMinKey(state, page);
+            pageMaxKey = embedDBGetMaxKey(state, page);
+            if (EMBEDDB_USING_SUM(state->parameters))
+                memcpy(&sum, EMBEDDB_GET_SUM(page, state), sizeof(int64_t));
+            minData = EMBEDDB_GET_MIN_DATA(page, state);
+            maxData = EMBEDDB_GET_MAX_DATA(page, state);
+        }
+
+        if (maxKey != NULL && compareKeys(state, pageMinKey, maxKey) > 0)
+            break;
+        if (count == 0 || (minKey != NULL && compareKeys(state, pageMaxKey, minKey) < 0))
+            continue;
+
+        /* Use the summary if every record of the page is in the range */
+        if ((minKey == NULL || compareKeys(state, pageMinKey, minKey) >= 0) && (maxKey == NULL || compareKeys(state, pageMaxKey, maxKey) <= 0)) {
+            aggregateMerge(state, result, count, sum, minData, maxData);
+            continue;
+        }
+
+        /* Page at an end of the range */
+        if (page == NULL) {
+            if (readPage(state, pageId % state->numDataPages) != 0) {
+#ifdef PRINT_ERRORS
+                printf("ERROR: Failed to read data page %i (%i)\n", pageId, pageId % state->numDataPages);
+#endif
+                return -1;
+            }
+            page = state->dataReadBuffer;
+        }
+        aggregatePageRecords(state, page, minKey, maxKey, result);
     }
-    // Key not found
-    return -1;
+
+    if (EMBEDDB_USING_SUM(state->parameters) && result->count > 0)
+        result->average = (float)result->sum / result->count;
+    return 0;
 }
 
 /**
@@ -1233,23 +3888,8 @@ int8_t embedDBGetVar(embedDBState *state, void *key, void *data, embedDBVarDataS
         return 0;
     }
 
-    // get pointer for output buffer
-    void *outputBuffer = (int8_t *)state->buffer;
-    // search output buffer for recrd, mem copy fixed record into data
-    int recordNum = searchBuffer(state, outputBuffer, key, data);
-    // if there are records found in the output buffer
-    if (recordNum != NO_RECORD_FOUND) {
-        // flush variable record buffer to storage to read later on
-        embedDBFlushVar(state);
-        // copy contents of write buffer to read buffer for embedDBSetupVarDataStream()
-        readToWriteBuf(state);
-        // else if there are records in the file system, mem cpy fixed record into data
-    } else if (embedDBGet(state, key, data) == RECORD_FOUND) {
-        // get pointer from the read buffer
-        void *buf = (int8_t *)state->buffer + (state->pageSize * EMBEDDB_DATA_READ_BUFFER);
-        // retrieve offset
-        recordNum = embedDBSearchNode(state, buf, key, 0);
-    } else {
+    int32_t recordNum = embedDBFindVarRecord(state, key, data);
+    if (recordNum == NO_RECORD_FOUND) {
         return NO_RECORD_FOUND;
     }
 
@@ -1265,8 +3905,66 @@ int8_t embedDBGetVar(embedDBState *state, void *key, void *data, embedDBVarDataS
         case 3:
             return -1;
     }
-
-    return -1;
+
+    return -1;
+}
+
+/**
+ * @brief	Given a key, returns data associated with key and sets up a caller-owned stream for its variable data, so nothing is allocated.
+ * @param	state	embedDB algorithm state structure
+ * @param	key		Key for record
+ * @param	data	Pre-allocated memory to copy data for record
+ * @param	varData	Pre-allocated stream to set up. Its totalBytes is 0 if there is no variable data
+ * @return	Return 0 if success. Non-zero value if error.
+ * 			-1 : Error reading file
+ * 			1  : Variable data was deleted to make room for newer data
+ */
+int8_t embedDBGetVarInto(embedDBState *state, void *key, void *data, embedDBVarDataStream *varData) {
+    if (!EMBEDDB_USING_VDATA(state->parameters)) {
+#ifdef PRINT_ERRORS
+        printf("ERROR: embedDBGetVarInto called when not using variable data\n");
+#endif
+        return 0;
+    }
+
+    int32_t recordNum = embedDBFindVarRecord(state, key, data);
+    if (recordNum == NO_RECORD_FOUND) {
+        return NO_RECORD_FOUND;
+    }
+
+    switch (embedDBFillVarDataStream(state, key, varData, recordNum)) {
+        case 0:
+        case 4:
+            return 0;
+        case 1:
+            return 1;
+    }
+    return -1;
+}
+
+/**
+ * @brief	Finds the record for a key and copies its data. Leaves the page of the record in the data read buffer for the variable data stream.
+ * @return	Index of the record on the page, or NO_RECORD_FOUND
+ */
+int32_t embedDBFindVarRecord(embedDBState *state, void *key, void *data) {
+    // get pointer for output buffer
+    void *outputBuffer = (int8_t *)state->dataWriteBuffer;
+    // search output buffer for recrd, mem copy fixed record into data
+    int recordNum = searchBuffer(state, outputBuffer, key, data);
+    // if there are records found in the output buffer
+    if (recordNum != NO_RECORD_FOUND) {
+        // flush variable record buffer to storage to read later on
+        embedDBFlushVar(state);
+        // copy contents of write buffer to read buffer for embedDBSetupVarDataStream()
+        readToWriteBuf(state);
+        // else if there are records in the file system, mem cpy fixed record into data
+    } else if (embedDBGet(state, key, data) == RECORD_FOUND) {
+        // retrieve offset from the page in the read buffer
+        recordNum = embedDBSearchNode(state, state->dataReadBuffer, key, 0);
+    } else {
+        return NO_RECORD_FOUND;
+    }
+    return recordNum;
 }
 
 /**
@@ -1281,12 +3979,12 @@ void embedDBInitIterator(embedDBState *state, embedDBIterator *it) {
         /* Verify that bitmap index is useful (must have set either min or max data value) */
         if (it->minData != NULL || it->maxData != NULL) {
             it->queryBitmap = calloc(1, state->bitmapSize);
-            state->buildBitmapFromRange(it->minData, it->maxData, it->queryBitmap);
+            embedDBBuildBitmapFromRange(state, it->minData, it->maxData, it->queryBitmap);
         }
     }
 
 #ifdef PRINT_ERRORS
-    if (!EMBEDDB_USING_BMAP(state->parameters)) {
+    if (!EMBEDDB_USING_BMAP(state->parameters) && state->valueIndex == NULL) {
         printf("WARN: Iterator not using index. If this is not intended, ensure that the embedDBState is using a bitmap and was initialized with an index file\n");
     } else if (!EMBEDDB_USING_INDEX(state->parameters)) {
         printf("WARN: Iterator not using index to full extent. If this is not intended, ensure that the embedDBState was initialized with an index file\n");
@@ -1294,13 +3992,13 @@ void embedDBInitIterator(embedDBState *state, embedDBIterator *it) {
 #endif
 
     // Determine which data page should be the first examined if there is a min key
-    if (it->minKey != NULL && SEARCH_METHOD == 2) {
+    if (it->minKey != NULL && state->searchMethod == EMBEDDB_SEARCH_SPLINE) {
         /* Spline search */
         uint32_t location, lowbound, highbound;
-        if (RADIX_BITS > 0) {
-            radixsplineFind(state->rdix, it->minKey, state->compareKey, &location, &lowbound, &highbound);
+        if (state->radixBits > 0) {
+            radixsplineFind(state->rdix, it->minKey, splineComparator(state), &location, &lowbound, &highbound);
         } else {
-            splineFind(state->spl, it->minKey, state->compareKey, &location, &lowbound, &highbound);
+            splineFind(state->spl, it->minKey, splineComparator(state), &location, &lowbound, &highbound);
         }
 
         // Use the low bound as the start for our search
@@ -1309,6 +4007,12 @@ void embedDBInitIterator(embedDBState *state, embedDBIterator *it) {
         it->nextDataPage = state->minDataPageId;
     }
     it->nextDataRec = 0;
+    it->lastDataPage = UINT32_MAX;
+
+    /* Find the data pages that hold a value in the data range with the value index */
+    it->valuePages = NULL;
+    if (state->valueIndex != NULL && (it->minData != NULL || it->maxData != NULL))
+        valueIndexFindPages(state, it);
 }
 
 /**
@@ -1319,6 +4023,9 @@ void embedDBCloseIterator(embedDBIterator *it) {
     if (it->queryBitmap != NULL) {
         free(it->queryBitmap);
     }
+    if (it->valuePages != NULL) {
+        free(it->valuePages);
+    }
 }
 
 /**
@@ -1340,11 +4047,21 @@ void embedDBFlushVar(embedDBState *state) {
 /**
  * @brief	Flushes output buffer.
  * @param	state	algorithm state structure
+ * @return	Return 0 if success. Non-zero value if a file failed to flush.
  */
-int8_t embedDBFlush(embedDBState *state) {
+static int8_t flushBuffers(embedDBState *state) {
+    int8_t began = snapshotBeginWrite(state);
+    if (snapshotHoldsNextPages(state, 1, 1)) {
+#ifdef PRINT_ERRORS
+        printf("ERROR: Storage is full and the oldest pages are held by a reader snapshot. Flush Failed.\n");
+#endif
+        snapshotEndWrite(state, began);
+        return 2;
+    }
+
     // As the first buffer is the data write buffer, no address change is required
-    id_t pageNum = writePage(state, (int8_t *)state->buffer + EMBEDDB_DATA_WRITE_BUFFER * state->pageSize);
-    state->fileInterface->flush(state->dataFile);
+    id_t pageNum = writePage(state, state->dataWriteBuffer);
+    int8_t flushed = state->fileInterface->flush(state->dataFile);
 
     indexPage(state, pageNum);
 
@@ -1354,14 +4071,25 @@ int8_t embedDBFlush(embedDBState *state) {
         EMBEDDB_INC_COUNT(buf);
 
         /* Copy record onto index page */
-        void *bm = EMBEDDB_GET_BITMAP(state->buffer);
-        memcpy((void *)((int8_t *)buf + EMBEDDB_IDX_HEADER_SIZE + state->bitmapSize * idxcount), bm, state->bitmapSize);
+        writeIndexRecord(state, buf, idxcount);
 
         writeIndexPage(state, buf);
-        state->fileInterface->flush(state->indexFile);
+        flushed &= state->fileInterface->flush(state->indexFile);
 
         /* Reinitialize buffer */
         initBufferPage(state, EMBEDDB_INDEX_WRITE_BUFFER);
+
+        /* Add page id to minimum value spot in page */
+        id_t *ptr = (id_t *)((int8_t *)buf + 8);
+        *ptr = state->nextDataPageId;
+    }
+
+    /* Write the run being filled so the values of the flushed pages are on file */
+    if (state->valueIndex != NULL) {
+        embedDBValueIndex *vi = state->valueIndex;
+        if (vi->numRunEntries > 0)
+            valueIndexWriteRun(state, vi->nextDataPageId, vi->nextDataPageId);
+        flushed &= state->fileInterface->flush(state->valueIndexFile);
     }
 
     /* Reinitialize buffer */
@@ -1371,7 +4099,7 @@ int8_t embedDBFlush(embedDBState *state) {
     if (EMBEDDB_USING_VDATA(state->parameters)) {
         // send write buffer pointer to write variable page
         writeVariablePage(state, (int8_t *)state->buffer + EMBEDDB_VAR_WRITE_BUFFER(state->parameters) * state->pageSize);
-        state->fileInterface->flush(state->varFile);
+        flushed &= state->fileInterface->flush(state->varFile);
         // init new buffer
         initBufferPage(state, EMBEDDB_VAR_WRITE_BUFFER(state->parameters));
         // determine how many bytes are left
@@ -1379,9 +4107,30 @@ int8_t embedDBFlush(embedDBState *state) {
         // create new offset
         state->currentVarLoc += temp + state->variableDataHeaderSize;
     }
+
+    if (EMBEDDB_USING_CHECKPOINT(state->parameters))
+        flushed &= embedDBCheckpoint(state) == 0;
+
+    snapshotEndWrite(state, began);
+    if (!flushed) {
+#ifdef PRINT_ERRORS
+        printf("ERROR: Failed to flush files.\n");
+#endif
+        return -1;
+    }
     return 0;
 }
 
+/**
+ * @brief	Flushes output buffer, counting and timing the flush.
+ */
+int8_t embedDBFlush(embedDBState *state) {
+    uint32_t start = statsBegin(state, EMBEDDB_STATS_FLUSH);
+    int8_t result = flushBuffers(state);
+    statsEnd(state, EMBEDDB_STATS_FLUSH, start);
+    return result;
+}
+
 /**
  * @brief	Iterates through a page in the read buffer.
  * @param	state	embedDB algorithm state structure
@@ -1392,17 +4141,17 @@ int8_t embedDBFlush(embedDBState *state) {
  */
 int8_t iterateReadBuffer(embedDBState *state, embedDBIterator *it, void *key, void *data) {
     //  Keep reading record until we find one that matches the query
-    int8_t *buf = (int8_t *)state->buffer + EMBEDDB_DATA_READ_BUFFER * state->pageSize;
+    int8_t *buf = (int8_t *)state->dataReadBuffer;
     uint32_t pageRecordCount = EMBEDDB_GET_COUNT(buf);
 
     while (it->nextDataRec < pageRecordCount) {
-        memcpy(key, buf + state->headerSize + it->nextDataRec * state->recordSize, state->keySize);
-        memcpy(data, buf + state->headerSize + it->nextDataRec * state->recordSize + state->keySize, state->dataSize);
+        memcpy(key, embedDBRecordKey(state, buf, it->nextDataRec), state->keySize);
+        embedDBCopyRecordData(state, buf, it->nextDataRec, data);
         it->nextDataRec++;
         // Check record
-        if (it->minKey != NULL && state->compareKey(key, it->minKey) < 0)
+        if (it->minKey != NULL && compareKeys(state, key, it->minKey) < 0)
             continue;
-        if (it->maxKey != NULL && state->compareKey(key, it->maxKey) > 0)
+        if (it->maxKey != NULL && compareKeys(state, key, it->maxKey) > 0)
             return ITERATE_NO_MORE_RECORDS;
         if (it->minData != NULL && state->compareData(data, it->minData) < 0)
             continue;
@@ -1423,14 +4172,14 @@ int8_t iterateReadBuffer(embedDBState *state, embedDBIterator *it, void *key, vo
  * @param	data	Return variable for data (Pre-allocated)
  * @return	1 if successful, 0 if no more records
  */
-int8_t embedDBNext(embedDBState *state, embedDBIterator *it, void *key, void *data) {
+static int8_t nextRecord(embedDBState *state, embedDBIterator *it, void *key, void *data) {
     while (1) {
         // return 0 since all pages including buffer has been read.
         if (it->nextDataPage > (state->nextDataPageId)) return 0;
         // if we have reached the end, read from output buffer if it is not empty
         if (it->nextDataPage == (state->nextDataPageId)) {
             // point to outputBuffer
-            void *outputBuffer = (int8_t *)state->buffer;
+            void *outputBuffer = (int8_t *)state->dataWriteBuffer;
             // if there are no records in the buffer, return
             if (EMBEDDB_GET_COUNT(outputBuffer) == 0) return 0;
             // else, place write buffer in read
@@ -1440,49 +4189,632 @@ int8_t embedDBNext(embedDBState *state, embedDBIterator *it, void *key, void *da
             return (i != ITERATE_NO_MATCH) ? i : 0;
         }
         // If we are just starting to read a new page and we have a query bitmap
-        if (it->nextDataRec == 0 && it->queryBitmap != NULL) {
-            // Find what index page determines if we should read the data page
-            uint32_t indexPage = it->nextDataPage / state->maxIdxRecordsPerPage;
-            uint16_t indexRec = it->nextDataPage % state->maxIdxRecordsPerPage;
+        if (it->nextDataRec == 0 && iteratorCanSkipPages(state, it)) {
+            int32_t skip = iteratorSkipPageByIndex(state, it);
+            if (skip == -1)
+                return 0;
+            if (skip) {
+                // Do not read these data pages, try the next one
+                it->nextDataPage += skip;
+                state->stats.nextPagesSkipped += skip;
+                continue;
+            }
+        }
+
+        if (iteratorReadDataPage(state, it) != 0) {
+#ifdef PRINT_ERRORS
+            printf("ERROR: Failed to read data page %i (%i)\n", it->nextDataPage, it->nextDataPage % state->numDataPages);
+#endif
+            return 0;
+        }
+        if (it->nextDataRec == 0)
+            state->stats.nextPagesRead++;
+
+        int8_t i = iterateReadBuffer(state, it, key, data);
+        if (i != ITERATE_NO_MATCH) return i;
+        // Finished reading through whole data page and didn't find a match
+        it->nextDataPage++;
+        it->nextDataRec = 0;
+        // Try next data page by looping back to top
+    }
+}
+
+/**
+ * @brief	Return next key, data pair for iterator, counting and timing the call.
+ */
+int8_t embedDBNext(embedDBState *state, embedDBIterator *it, void *key, void *data) {
+    uint32_t start = statsBegin(state, EMBEDDB_STATS_NEXT);
+    int8_t result = nextRecord(state, it, key, data);
+    statsEnd(state, EMBEDDB_STATS_NEXT, start);
+    return result;
+}
+
+/**
+ * @brief	Returns the index of the first record on a page with a key greater than or equal to the given key.
+ */
+static count_t pageLowerBound(embedDBState *state, void *page, void *key) {
+    count_t low = 0, high = EMBEDDB_GET_COUNT(page);
+    while (low < high) {
+        count_t mid = low + (high - low) / 2;
+        if (compareKeys(state, embedDBRecordKey(state, page, mid), key) < 0)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    return low;
+}
+
+int8_t embedDBIteratorSeek(embedDBState *state, embedDBIterator *it, void *key) {
+    if (it->nextDataPage > state->nextDataPageId)
+        return 0;
+
+    /* Keys at least as large as the smallest key in the write buffer can only be in the write buffer */
+    void *outputBuffer = state->dataWriteBuffer;
+    id_t pageId = state->nextDataPageId;
+    count_t record = 0;
+    if (EMBEDDB_GET_COUNT(outputBuffer) > 0 && compareKeys(state, key, embedDBGetMinKey(state, outputBuffer)) >= 0) {
+        record = pageLowerBound(state, outputBuffer, key);
+    } else if (it->nextDataPage < state->nextDataPageId) {
+        /* Pages before the iterator are never returned to, and the spline bounds the pages the key may be on */
+        id_t low = max(it->nextDataPage, state->minDataPageId), high = state->nextDataPageId - 1;
+        if (state->searchMethod == EMBEDDB_SEARCH_SPLINE) {
+            uint32_t location, lowbound, highbound;
+            if (state->radixBits > 0) {
+                radixsplineFind(state->rdix, key, splineComparator(state), &location, &lowbound, &highbound);
+            } else {
+                splineFind(state->spl, key, splineComparator(state), &location, &lowbound, &highbound);
+            }
+            low = min(max(low, lowbound), high);
+            high = max(min(high, highbound), low);
+        }
+
+        /* Binary search for the last page starting at or before the key */
+        while (low < high) {
+            id_t mid = low + (high - low + 1) / 2;
+            if (readPage(state, mid % state->numDataPages) != 0)
+                return -1;
+            if (compareKeys(state, embedDBGetMinKey(state, state->dataReadBuffer), key) <= 0)
+                low = mid;
+            else
+                high = mid - 1;
+        }
+        if (readPage(state, low % state->numDataPages) != 0)
+            return -1;
 
-            if (state->indexFile != NULL && indexPage >= state->minIndexPageId && indexPage < state->nextIdxPageId) {
-                // If the index page that contains this data page exists, else we must read the data page regardless cause we don't have the index saved for it
+        pageId = low;
+        record = pageLowerBound(state, state->dataReadBuffer, key);
+        if (record == EMBEDDB_GET_COUNT(state->dataReadBuffer)) {
+            pageId++;
+            record = 0;
+        }
+    }
+
+    /* Only move forward, so the iterator never returns a record twice */
+    if (pageId < it->nextDataPage || (pageId == it->nextDataPage && record <= it->nextDataRec))
+        return 0;
+    it->nextDataPage = pageId;
+    it->nextDataRec = record;
+    return 0;
+}
+
+/**
+ * @brief	Reads the next data page of the iterator into the data read buffer.
+ * 			Once the iterator reads consecutive data pages, the pages that follow are read ahead into the buffer pool with one call to fileInterface->readMany.
+ * 			The index page for the end of the read ahead pages is also read ahead if the iterator uses the index.
+ * @param	state	embedDB algorithm state structure
+ * @param	it		embedDB iterator state structure
+ * @return	Return 0 if success, -1 if error.
+ */
+int8_t iteratorReadDataPage(embedDBState *state, embedDBIterator *it) {
+    id_t pageNum = it->nextDataPage;
+    id_t physPageNum = pageNum % state->numDataPages;
+    int8_t sequential = it->lastDataPage != UINT32_MAX && pageNum == it->lastDataPage + 1;
+    it->lastDataPage = pageNum;
+
+    if (READ_AHEAD_PAGES > 0 && sequential && state->bufferPool != NULL && state->fileInterface->readMany != NULL) {
+        /* Pages lent by the file are already in memory */
+        int8_t canBorrow = state->fileInterface->borrow != NULL && state->fileInterface->borrow(physPageNum, state->pageSize, state->dataFile) != NULL;
+
+        /* Only read pages in storage that are physically consecutive */
+        uint32_t numPages = min(READ_AHEAD_PAGES, state->nextDataPageId - pageNum);
+        numPages = min(numPages, state->numDataPages - physPageNum);
+        uint32_t numRead = canBorrow ? 0 : bufferPoolReadAhead(state, EMBEDDB_DATA_FILE, state->dataFile, physPageNum, numPages);
+
+        if (numRead > 1 && it->queryBitmap != NULL && state->indexFile != NULL) {
+            uint32_t indexPage = (pageNum + numRead - 1) / state->maxIdxRecordsPerPage;
+            if (indexPage != pageNum / state->maxIdxRecordsPerPage && indexPage >= state->minIndexPageId && indexPage < state->nextIdxPageId)
+                bufferPoolReadAhead(state, EMBEDDB_INDEX_FILE, state->indexFile, indexPage % state->numIndexPages, 1);
+        }
+    }
+
+    return readPage(state, physPageNum);
+}
+
+/**
+ * @brief	Finds the zone holding a data page.
+ * @param	state		embedDB algorithm state structure
+ * @param	dataPageId	Logical id of the data page
+ * @return	Pointer to the zone, or NULL if no zone holds the data page.
+ */
+static embedDBZone *findZone(embedDBState *state, id_t dataPageId) {
+    /* The zone of the index write buffer is only used once a data page has been added to it */
+    id_t low = state->minIndexPageId, high = state->nextIdxPageId;
+    if (embedDBGetZone(state, high)->indexPageId != high) {
+        if (high == low)
+            return NULL;
+        high--;
+    }
+
+    /* Zones are in data page order, so search for the last zone starting at or before the data page */
+    while (low < high) {
+        id_t mid = low + (high - low + 1) / 2;
+        if (embedDBGetZone(state, mid)->firstDataPageId <= dataPageId)
+            low = mid;
+        else
+            high = mid - 1;
+    }
+
+    embedDBZone *zone = embedDBGetZone(state, low);
+    if (zone->indexPageId != low || dataPageId < zone->firstDataPageId || dataPageId - zone->firstDataPageId >= zone->numDataPages)
+        return NULL;
+    return zone;
+}
+
+/**
+ * @brief	Determines if any data page of a zone may hold a record matching the data filter of an iterator.
+ * @param	state	embedDB algorithm state structure
+ * @param	it		embedDB iterator state structure
+ * @param	zone	Zone to check
+ * @return	1 if the zone may hold a match, 0 if it cannot.
+ */
+static int8_t zoneOverlapsQuery(embedDBState *state, embedDBIterator *it, embedDBZone *zone) {
+    uint8_t *zoneBitmap = (uint8_t *)(zone + 1);
+    if (it->queryBitmap != NULL && !bitmapOverlap(it->queryBitmap, zoneBitmap, state->bitmapSize))
+        return 0;
+    if (!zone->hasDataRange)
+        return 1;
+    int8_t *zoneMinData = (int8_t *)zoneBitmap + state->bitmapSize;
+    int8_t *zoneMaxData = zoneMinData + state->dataSize;
+    if (it->minData != NULL && state->compareData(zoneMaxData, it->minData) < 0)
+        return 0;
+    if (it->maxData != NULL && state->compareData(zoneMinData, it->maxData) > 0)
+        return 0;
+    return 1;
+}
+
+/**
+ * @brief	Uses the value index, the zone map and the index to determine how many data pages, starting at the next data page of the iterator, can be skipped.
+ * 			The value index knows exactly which of the pages it covers hold a value in the data range.
+ * 			When the zone of the next data page cannot match the query, every data page left in the zone is skipped without reading its index page.
+ * @param	state	embedDB algorithm state structure
+ * @param	it		embedDB iterator state structure
+ * @return	Number of data pages to skip, 0 if the page must be read, -1 if the index page failed to read.
+ */
+int32_t iteratorSkipPageByIndex(embedDBState *state, embedDBIterator *it) {
+    if (it->valuePages != NULL && it->nextDataPage >= it->valuePagesStart && it->nextDataPage < it->valuePagesEnd) {
+        id_t pageId = it->nextDataPage;
+        while (pageId < it->valuePagesEnd && !(it->valuePages[(pageId - it->valuePagesStart) / 8] & (1 << ((pageId - it->valuePagesStart) % 8))))
+            pageId++;
+        return pageId - it->nextDataPage;
+    }
+    if (state->zoneMap != NULL) {
+        embedDBZone *zone = findZone(state, it->nextDataPage);
+        if (zone != NULL && !zoneOverlapsQuery(state, it, zone))
+            return zone->firstDataPageId + zone->numDataPages - it->nextDataPage;
+    }
+    if (it->queryBitmap == NULL)
+        return 0;
+
+    // If the index record for this data page does not exist, we must read the data page regardless cause we don't have the index saved for it
+    void *indexBM = NULL;
+    int8_t found = readIndexRecord(state, it->nextDataPage, &indexBM);
+    if (found != 0)
+        return found < 0 ? -1 : 0;
+
+    // Determine if we should read the data page
+    return !bitmapOverlap(it->queryBitmap, indexBM, state->bitmapSize);
+}
+
+/**
+ * @brief	Finds the index record of a data page.
+ * 			Index pages hold the records of maxIdxRecordsPerPage data pages unless an index page was written early by embedDBFlush,
+ * 			so the first data page of the index page is checked before using the record.
+ * @param	state		embedDB algorithm state structure
+ * @param	dataPageId	Logical id of the data page
+ * @param	record		Return variable for a pointer to the index record in the index read buffer
+ * @return	Return 0 if found, 1 if the data page has no index record in storage, -1 if the index page failed to read.
+ */
+int8_t readIndexRecord(embedDBState *state, id_t dataPageId, void **record) {
+    if (state->indexFile == NULL)
+        return 1;
+
+    // Find what index page determines if we should read the data page
+    uint32_t indexPage = dataPageId / state->maxIdxRecordsPerPage;
+    if (indexPage < state->minIndexPageId || indexPage >= state->nextIdxPageId)
+        return 1;
 
-                if (readIndexPage(state, indexPage % state->numIndexPages) != 0) {
+    if (readIndexPage(state, indexPage % state->numIndexPages) != 0) {
 #ifdef PRINT_ERRORS
-                    printf("ERROR: Failed to read index page %i (%i)\n", indexPage, indexPage % state->numIndexPages);
+        printf("ERROR: Failed to read index page %i (%i)\n", indexPage, indexPage % state->numIndexPages);
 #endif
-                    return 0;
-                }
+        return -1;
+    }
+
+    int8_t *buf = (int8_t *)state->buffer + EMBEDDB_INDEX_READ_BUFFER * state->pageSize;
+    id_t firstDataPageId;
+    memcpy(&firstDataPageId, buf + 8, sizeof(id_t));
+    if (dataPageId < firstDataPageId || dataPageId - firstDataPageId >= EMBEDDB_GET_COUNT(buf))
+        return 1;
+
+    *record = buf + EMBEDDB_IDX_HEADER_SIZE + (dataPageId - firstDataPageId) * embedDBIndexRecordSize(state);
+    return 0;
+}
 
-                // Get bitmap for data page in question
-                void *indexBM = (int8_t *)state->buffer + EMBEDDB_INDEX_READ_BUFFER * state->pageSize + EMBEDDB_IDX_HEADER_SIZE + indexRec * state->bitmapSize;
+/**
+ * @brief	Finds the next run of consecutive records in a page that match the iterator query.
+ * 			The page header is used to skip or fully accept the page so that records are only checked when needed.
+ * @param	state	embedDB algorithm state structure
+ * @param	it		embedDB iterator state structure
+ * @param	buf		Page to search
+ * @param	begin	Return variable for the index of the first record of the run
+ * @param	end		Return variable for one past the index of the last record of the run
+ * @return	ITERATE_MATCH if a run was found, ITERATE_NO_MORE_RECORDS if the records are past the query, and ITERATE_NO_MATCH if no more records in the page match.
+ */
+int8_t iterateRecordRange(embedDBState *state, embedDBIterator *it, int8_t *buf, count_t *begin, count_t *end) {
+    count_t pageRecordCount = EMBEDDB_GET_COUNT(buf);
+    if (it->nextDataRec >= pageRecordCount)
+        return ITERATE_NO_MATCH;
+
+    /* Key bounds only need checking if the page is not entirely inside them */
+    int8_t checkMinKey = it->minKey != NULL && compareKeys(state, embedDBGetMinKey(state, buf), it->minKey) < 0;
+    int8_t checkMaxKey = it->maxKey != NULL && compareKeys(state, embedDBGetMaxKey(state, buf), it->maxKey) > 0;
+    if (it->maxKey != NULL && compareKeys(state, embedDBGetMinKey(state, buf), it->maxKey) > 0)
+        return ITERATE_NO_MORE_RECORDS;
+
+    /* Use the min and max data in the header to skip the page or avoid checking the data of each record */
+    int8_t checkData = it->minData != NULL || it->maxData != NULL;
+    if (checkData && EMBEDDB_USING_MAX_MIN(state->parameters)) {
+        void *pageMinData = EMBEDDB_GET_MIN_DATA(buf, state);
+        void *pageMaxData = EMBEDDB_GET_MAX_DATA(buf, state);
+        if ((it->minData != NULL && state->compareData(pageMaxData, it->minData) < 0) ||
+            (it->maxData != NULL && state->compareData(pageMinData, it->maxData) > 0)) {
+            it->nextDataRec = pageRecordCount;
+            return ITERATE_NO_MATCH;
+        }
+        checkData = (it->minData != NULL && state->compareData(pageMinData, it->minData) < 0) ||
+                    (it->maxData != NULL && state->compareData(pageMaxData, it->maxData) > 0);
+    }
+
+    /* Find the first matching record */
+    uint16_t keyStride = embedDBKeyStride(state);
+    int8_t dataScratch[INT8_MAX];
+    count_t rec = it->nextDataRec;
+    int8_t *recordKey = (int8_t *)embedDBRecordKey(state, buf, rec);
+    while (rec < pageRecordCount) {
+        if (checkMinKey) {
+            if (compareKeys(state, recordKey, it->minKey) < 0) {
+                rec++;
+                recordKey += keyStride;
+                continue;
+            }
+            // Keys are sorted so every following record is above the min key
+            checkMinKey = 0;
+        }
+        if (checkMaxKey && compareKeys(state, recordKey, it->maxKey) > 0) {
+            it->nextDataRec = pageRecordCount;
+            return ITERATE_NO_MORE_RECORDS;
+        }
+        if (checkData) {
+            void *recordData = embedDBRecordData(state, buf, rec, dataScratch);
+            if ((it->minData != NULL && state->compareData(recordData, it->minData) < 0) ||
+                (it->maxData != NULL && state->compareData(recordData, it->maxData) > 0)) {
+                rec++;
+                recordKey += keyStride;
+                continue;
+            }
+        }
+        break;
+    }
+    if (rec >= pageRecordCount) {
+        it->nextDataRec = pageRecordCount;
+        return ITERATE_NO_MATCH;
+    }
+
+    /* Extend the run while records keep matching */
+    *begin = rec;
+    rec++;
+    recordKey += keyStride;
+    if (checkMaxKey || checkData) {
+        while (rec < pageRecordCount) {
+            if (checkMaxKey && compareKeys(state, recordKey, it->maxKey) > 0)
+                break;
+            if (checkData) {
+                void *recordData = embedDBRecordData(state, buf, rec, dataScratch);
+                if ((it->minData != NULL && state->compareData(recordData, it->minData) < 0) ||
+                    (it->maxData != NULL && state->compareData(recordData, it->maxData) > 0))
+                    break;
+            }
+            rec++;
+            recordKey += keyStride;
+        }
+    } else {
+        rec = pageRecordCount;
+    }
+    *end = rec;
+    it->nextDataRec = rec;
+    return ITERATE_MATCH;
+}
+
+/**
+ * @brief	Return the next run of records for iterator without copying them out of the page buffer.
+ * 			Every record in the range [begin, end) matches the iterator query. Use embedDBGetColumn to find the fields of the records.
+ * 			The records are only valid until the next call to embedDB.
+ * @param	state	embedDB algorithm state structure
+ * @param	it		embedDB iterator state structure
+ * @param	records	Return variable for a pointer to the first record of the page
+ * @param	begin	Return variable for the index of the first matching record
+ * @param	end		Return variable for one past the index of the last matching record
+ * @return	1 if successful, 0 if no more records
+ */
+int8_t embedDBNextPage(embedDBState *state, embedDBIterator *it, void **records, count_t *begin, count_t *end) {
+    while (1) {
+        // return 0 since all pages including buffer has been read.
+        if (it->nextDataPage > state->nextDataPageId) return 0;
 
-                // Determine if we should read the data page
-                if (!bitmapOverlap(it->queryBitmap, indexBM, state->bitmapSize)) {
-                    // Do not read this data page, try the next one
-                    it->nextDataPage++;
+        int8_t *buf;
+        if (it->nextDataPage == state->nextDataPageId) {
+            // Use the write buffer directly once all pages in storage have been read
+            buf = (int8_t *)state->dataWriteBuffer;
+        } else {
+            if (it->nextDataRec == 0 && iteratorCanSkipPages(state, it)) {
+                int32_t skip = iteratorSkipPageByIndex(state, it);
+                if (skip == -1)
+                    return 0;
+                if (skip) {
+                    it->nextDataPage += skip;
                     continue;
                 }
             }
-        }
 
-        if (readPage(state, it->nextDataPage % state->numDataPages) != 0) {
+            if (iteratorReadDataPage(state, it) != 0) {
 #ifdef PRINT_ERRORS
-            printf("ERROR: Failed to read data page %i (%i)\n", it->nextDataPage, it->nextDataPage % state->numDataPages);
+                printf("ERROR: Failed to read data page %i (%i)\n", it->nextDataPage, it->nextDataPage % state->numDataPages);
 #endif
-            return 0;
+                return 0;
+            }
+            buf = (int8_t *)state->dataReadBuffer;
         }
 
-        int8_t i = iterateReadBuffer(state, it, key, data);
-        if (i != ITERATE_NO_MATCH) return i;
-        // Finished reading through whole data page and didn't find a match
+        int8_t i = iterateRecordRange(state, it, buf, begin, end);
+        if (i == ITERATE_MATCH) {
+            *records = buf + state->headerSize;
+            return 1;
+        }
+        if (i == ITERATE_NO_MORE_RECORDS || it->nextDataPage == state->nextDataPageId)
+            return 0;
         it->nextDataPage++;
         it->nextDataRec = 0;
-        // Try next data page by looping back to top
     }
 }
 
+/**
+ * @brief	Return a column of the records returned by embedDBNextPage. The column value of record i is at the returned pointer + i * stride.
+ * 			With EMBEDDB_USE_PAX the values of a column are next to each other on the page, so only the bytes of the column are read.
+ * @param	state	embedDB algorithm state structure
+ * @param	records	Records returned by embedDBNextPage
+ * @param	offset	Offset of the column in a record, where the key starts at 0 and the data at keySize
+ * @param	stride	Return variable for the number of bytes between the column values of consecutive records
+ * @return	Pointer to the column value of the first record of the page
+ */
+void *embedDBGetColumn(embedDBState *state, void *records, uint16_t offset, uint16_t *stride) {
+    if (!EMBEDDB_USING_PAX(state->parameters)) {
+        *stride = state->recordSize;
+        return (int8_t *)records + offset;
+    }
+
+    /* Find the column of the page that holds the offset. Columns are stored in record order, each maxRecordsPerPage values long */
+    uint16_t columnStart = 0, columnSize = state->keySize;
+    if (offset >= state->keySize) {
+        columnStart = state->keySize;
+        columnSize = state->dataSize;
+        if (state->numDataColumns > 1) {
+            for (uint8_t i = 0; i < state->numDataColumns; i++) {
+                columnSize = abs(state->dataColumnSizes[i]);
+                if (offset < columnStart + columnSize)
+                    break;
+                columnStart += columnSize;
+            }
+        }
+        if (offset >= state->keySize + state->dataSize) {
+            columnStart = state->keySize + state->dataSize;
+            columnSize = sizeof(uint32_t);
+        }
+    }
+    *stride = columnSize;
+    return (int8_t *)records + state->maxRecordsPerPage * columnStart + (offset - columnStart);
+}
+
+/* Work shared by the workers of a parallel scan */
+typedef struct {
+    embedDBState *state;  /* State being scanned */
+    embedDBIterator *it;  /* Iterator with the filters and the first data page */
+    embedDBScanFunc func; /* Called with the records of each page */
+    void *context;        /* Passed to func */
+    uint32_t nextChunk;   /* Next chunk of data pages to take. Incremented atomically */
+    id_t stopPageId;      /* Pages from this one on are past the max key of the iterator. Lowered atomically */
+    int8_t failed;        /* Set if a page failed to read */
+} scanShared;
+
+/* One worker of a parallel scan. The state copy reads through the buffers of the worker */
+typedef struct {
+    scanShared *shared;
+    embedDBState view;
+    int8_t *records; /* Matching records of the page being scanned */
+    uint8_t worker;
+} scanWorker;
+
+/**
+ * @brief	Passes the records of a page that match the iterator to the scan function.
+ * @return	ITERATE_NO_MORE_RECORDS if the page has records past the max key of the iterator, otherwise ITERATE_NO_MATCH.
+ */
+static int8_t scanPage(scanWorker *worker, embedDBIterator *it, int8_t *page) {
+    embedDBState *state = &worker->view;
+    uint32_t numRecords = 0;
+    count_t begin, end;
+    int8_t result;
+    while ((result = iterateRecordRange(state, it, page, &begin, &end)) == ITERATE_MATCH) {
+        for (count_t i = begin; i < end; i++) {
+            int8_t *record = worker->records + numRecords * state->recordSize;
+            memcpy(record, embedDBRecordKey(state, page, i), state->keySize);
+            embedDBCopyRecordData(state, page, i, record + state->keySize);
+            numRecords++;
+        }
+    }
+    if (numRecords > 0)
+        worker->shared->func(worker->records, numRecords, worker->shared->context, worker->worker);
+    return result;
+}
+
+/**
+ * @brief	Takes chunks of data pages until none are left and scans each page of the chunk.
+ */
+static void *scanWorkerRun(void *arg) {
+    scanWorker *worker = (scanWorker *)arg;
+    scanShared *shared = worker->shared;
+    embedDBState *state = &worker->view;
+    id_t firstPageId = shared->it->nextDataPage;
+    while (!__atomic_load_n(&shared->failed, __ATOMIC_RELAXED)) {
+        uint32_t chunk = __atomic_fetch_add(&shared->nextChunk, 1, __ATOMIC_RELAXED);
+        id_t pageId = firstPageId + chunk * SCAN_CHUNK_PAGES;
+        if (pageId >= state->nextDataPageId || pageId >= __atomic_load_n(&shared->stopPageId, __ATOMIC_RELAXED))
+            break;
+        id_t endPageId = min(pageId + SCAN_CHUNK_PAGES, state->nextDataPageId);
+
+        embedDBIterator it = *shared->it;
+        it.nextDataPage = pageId;
+        it.lastDataPage = UINT32_MAX;
+        while (it.nextDataPage < endPageId) {
+            it.nextDataRec = 0;
+            if (iteratorCanSkipPages(state, &it)) {
+                int32_t skip = iteratorSkipPageByIndex(state, &it);
+                if (skip == -1) {
+                    __atomic_store_n(&shared->failed, 1, __ATOMIC_RELAXED);
+                    return NULL;
+                }
+                if (skip) {
+                    state->stats.nextPagesSkipped += min((id_t)skip, endPageId - it.nextDataPage);
+                    it.nextDataPage += skip;
+                    continue;
+                }
+            }
+            if (readPage(state, it.nextDataPage % state->numDataPages) != 0) {
+#ifdef PRINT_ERRORS
+                printf("ERROR: Failed to read data page %i (%i)\n", it.nextDataPage, it.nextDataPage % state->numDataPages);
+#endif
+                __atomic_store_n(&shared->failed, 1, __ATOMIC_RELAXED);
+                return NULL;
+            }
+            state->stats.nextPagesRead++;
+            if (scanPage(worker, &it, (int8_t *)state->dataReadBuffer) == ITERATE_NO_MORE_RECORDS) {
+                /* Pages are in key order, so no later page can match */
+                id_t stopPageId = __atomic_load_n(&shared->stopPageId, __ATOMIC_RELAXED);
+                while (it.nextDataPage < stopPageId && !__atomic_compare_exchange_n(&shared->stopPageId, &stopPageId, it.nextDataPage, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                }
+                break;
+            }
+            it.nextDataPage++;
+        }
+    }
+    return NULL;
+}
+
+int8_t embedDBParallelScan(embedDBState *state, embedDBIterator *it, uint8_t numWorkers, embedDBScanFunc func, void *context) {
+    numWorkers = max(1, min(numWorkers, EMBEDDB_MAX_SCAN_WORKERS));
+#if !SCAN_USE_THREADS
+    numWorkers = 1;
+#endif
+    scanShared shared;
+    shared.state = state;
+    shared.it = it;
+    shared.func = func;
+    shared.context = context;
+    shared.nextChunk = 0;
+    shared.stopPageId = UINT32_MAX;
+    shared.failed = 0;
+
+    /* Each worker has its own read buffers and no buffer pool. The spline, index and zone map are only read */
+    scanWorker *workers = calloc(numWorkers, sizeof(scanWorker));
+    if (workers == NULL)
+        return -1;
+    int8_t allocated = 1;
+    for (uint8_t w = 0; w < numWorkers; w++) {
+        scanWorker *worker = &workers[w];
+        embedDBState *view = &worker->view;
+        memcpy(view, state, sizeof(embedDBState));
+        worker->shared = &shared;
+        worker->worker = w;
+        view->buffer = calloc(EMBEDDB_NUM_FIXED_BUFFERS(state->parameters), state->pageSize);
+        view->dataDecompressBuffer = EMBEDDB_USING_COMPRESSION(state->parameters) ? malloc(embedDBDataPageSize(state)) : NULL;
+        worker->records = malloc((size_t)state->maxRecordsPerPage * state->recordSize);
+        allocated &= view->buffer != NULL && worker->records != NULL && (view->dataDecompressBuffer != NULL || !EMBEDDB_USING_COMPRESSION(state->parameters));
+        view->dataReadBuffer = (int8_t *)view->buffer + state->pageSize * EMBEDDB_DATA_READ_BUFFER;
+        view->bufferedPageId = -1;
+        view->bufferedIndexPageId = -1;
+        view->bufferPool = NULL;
+        view->numReads = 0;
+        view->numIdxReads = 0;
+        view->bufferHits = 0;
+        memset(&view->stats, 0, sizeof(embedDBStats));
+    }
+
+    if (allocated) {
+#if SCAN_USE_THREADS
+        pthread_t threads[EMBEDDB_MAX_SCAN_WORKERS];
+        int8_t started[EMBEDDB_MAX_SCAN_WORKERS] = {0};
+        /* Chunks a worker could not be started for are taken by the other workers */
+        for (uint8_t w = 1; w < numWorkers; w++)
+            started[w] = pthread_create(&threads[w], NULL, scanWorkerRun, &workers[w]) == 0;
+        scanWorkerRun(&workers[0]);
+        for (uint8_t w = 1; w < numWorkers; w++) {
+            if (started[w])
+                pthread_join(threads[w], NULL);
+        }
+#else
+        scanWorkerRun(&workers[0]);
+#endif
+
+        /* Records in the write buffer come last */
+        if (!shared.failed && it->nextDataPage <= state->nextDataPageId && shared.stopPageId == UINT32_MAX && EMBEDDB_GET_COUNT(state->dataWriteBuffer) > 0) {
+            embedDBIterator bufferIt = *it;
+            bufferIt.nextDataRec = 0;
+            scanPage(&workers[0], &bufferIt, (int8_t *)state->dataWriteBuffer);
+        }
+    }
+
+    for (uint8_t w = 0; w < numWorkers; w++) {
+        state->numReads += workers[w].view.numReads;
+        state->numIdxReads += workers[w].view.numIdxReads;
+        state->bufferHits += workers[w].view.bufferHits;
+        for (uint8_t f = EMBEDDB_DATA_FILE; f <= EMBEDDB_INDEX_FILE; f++) {
+            state->stats.files[f].reads += workers[w].view.stats.files[f].reads;
+            state->stats.files[f].bufferHits += workers[w].view.stats.files[f].bufferHits;
+        }
+        state->stats.nextPagesRead += workers[w].view.stats.nextPagesRead;
+        state->stats.nextPagesSkipped += workers[w].view.stats.nextPagesSkipped;
+        free(workers[w].view.buffer);
+        free(workers[w].view.dataDecompressBuffer);
+        free(workers[w].records);
+    }
+    free(workers);
+    if (!allocated) {
+#ifdef PRINT_ERRORS
+        printf("ERROR: Failed to allocate the buffers of the scan workers.\n");
+#endif
+        return -1;
+    }
+    return shared.failed ? -1 : 0;
+}
+
 /**
  * @brief	Return next key, data, variable data set for iterator
  * @param	state	embedDB algorithm state structure
@@ -1500,19 +4832,11 @@ int8_t embedDBNextVar(embedDBState *state, embedDBIterator *it, void *key, void
         return 0;
     }
 
-    // ensure record exists
-    int8_t r = embedDBNext(state, it, key, data);
-    if (!r) {
+    count_t recordNum;
+    if (!embedDBNextVarRecord(state, it, key, data, &recordNum)) {
         return 0;
     }
 
-    void *outputBuffer = (int8_t *)state->buffer;
-    if (it->nextDataPage == 0 && (EMBEDDB_GET_COUNT(outputBuffer) > 0)) {
-        embedDBFlushVar(state);
-    }
-
-    // Get the vardata address from the record
-    count_t recordNum = it->nextDataRec - 1;
     int8_t setupResult = embedDBSetupVarDataStream(state, key, varData, recordNum);
     switch (setupResult) {
         case 0:
@@ -1523,7 +4847,52 @@ int8_t embedDBNextVar(embedDBState *state, embedDBIterator *it, void *key, void
             return 0;
     }
 
-    return 0;
+    return 0;
+}
+
+/**
+ * @brief	Return next key, data, variable data set for iterator. Sets up a caller-owned stream for the variable data, so the same stream can be reused for every record without allocating.
+ * @param	state	embedDB algorithm state structure
+ * @param	it		embedDB iterator state structure
+ * @param	key		Return variable for key (Pre-allocated)
+ * @param	data	Return variable for data (Pre-allocated)
+ * @param	varData	Pre-allocated stream to set up. Its totalBytes is 0 if the record has no variable data or it was overwritten
+ * @return	1 if successful, 0 if no more records
+ */
+int8_t embedDBNextVarInto(embedDBState *state, embedDBIterator *it, void *key, void *data, embedDBVarDataStream *varData) {
+    if (!EMBEDDB_USING_VDATA(state->parameters)) {
+#ifdef PRINT_ERRORS
+        printf("ERROR: embedDBNextVarInto called when not using variable data\n");
+#endif
+        return 0;
+    }
+
+    count_t recordNum;
+    if (!embedDBNextVarRecord(state, it, key, data, &recordNum)) {
+        return 0;
+    }
+    return embedDBFillVarDataStream(state, key, varData, recordNum) != 2;
+}
+
+/**
+ * @brief	Returns the next record of the iterator and the index of the record on the page in the data read buffer
+ * @return	1 if successful, 0 if no more records
+ */
+int8_t embedDBNextVarRecord(embedDBState *state, embedDBIterator *it, void *key, void *data, count_t *recordNum) {
+    // ensure record exists
+    int8_t r = embedDBNext(state, it, key, data);
+    if (!r) {
+        return 0;
+    }
+
+    void *outputBuffer = (int8_t *)state->dataWriteBuffer;
+    if (it->nextDataPage == 0 && (EMBEDDB_GET_COUNT(outputBuffer) > 0)) {
+        embedDBFlushVar(state);
+    }
+
+    // Get the vardata address from the record
+    *recordNum = it->nextDataRec - 1;
+    return 1;
 }
 
 /**
@@ -1534,22 +4903,51 @@ int8_t embedDBNextVar(embedDBState *state, embedDBIterator *it, void *key, void
  * @return  Returns 0 if sucessfull or no variable data for the record, 1 if the records variable data was overwritten, 2 if the page failed to read, and 3 if the memorey failed to allocate.
  */
 int8_t embedDBSetupVarDataStream(embedDBState *state, void *key, embedDBVarDataStream **varData, id_t recordNumber) {
-    // create pointer to read buffer
-    void *dataBuf = (int8_t *)state->buffer + state->pageSize * EMBEDDB_DATA_READ_BUFFER;
-    // create pointer for record inside read buffer
-    void *record = (int8_t *)dataBuf + state->headerSize + recordNumber * state->recordSize;
+    embedDBVarDataStream stream;
+    int8_t result = embedDBFillVarDataStream(state, key, &stream, recordNumber);
+    if (result != 0) {
+        *varData = NULL;
+        // No variable data for the record, return 0
+        return result == 4 ? 0 : result;
+    }
+
+    // Create varDataStream
+    embedDBVarDataStream *varDataStream = malloc(sizeof(embedDBVarDataStream));
+    if (varDataStream == NULL) {
+#ifdef PRINT_ERRORS
+        printf("ERROR: Failed to alloc memory for embedDBVarDataStream\n");
+#endif
+        return 3;
+    }
+
+    *varDataStream = stream;
+    *varData = varDataStream;
+    return 0;
+}
+
+/**
+ * @brief Set up a pre-allocated varDataStream object to return the variable data for a record
+ * @param	state	embedDB algorithm state structure
+ * @param   key     Key for the record
+ * @param   varData Stream to set up. Left empty (totalBytes of 0) if there is no variable data
+ * @return  Returns 0 if sucessfull, 1 if the records variable data was overwritten, 2 if the page failed to read, and 4 if the record has no variable data.
+ */
+int8_t embedDBFillVarDataStream(embedDBState *state, void *key, embedDBVarDataStream *varData, id_t recordNumber) {
+    varData->totalBytes = 0;
+    varData->bytesRead = 0;
+    varData->dataStart = 0;
+    varData->fileOffset = 0;
+
     // create pointer for variable record which is an offset to approximate location
     uint32_t varDataAddr = 0;
-    memcpy(&varDataAddr, (int8_t *)record + state->keySize + state->dataSize, sizeof(uint32_t));
-    // No variable data for the record, return 0
+    memcpy(&varDataAddr, embedDBRecordVarLocation(state, state->dataReadBuffer, recordNumber), sizeof(uint32_t));
+    // No variable data for the record
     if (varDataAddr == EMBEDDB_NO_VAR_DATA) {
-        *varData = NULL;
-        return 0;
+        return 4;
     }
 
     // Check if the variable data associated with this key has been overwritten due to file wrap around
-    if (state->compareKey(key, &state->minVarRecordId) < 0) {
-        *varData = NULL;
+    if (compareKeys(state, key, &state->minVarRecordId) < 0) {
         return 1;
     }
 
@@ -1578,21 +4976,10 @@ int8_t embedDBSetupVarDataStream(embedDBState *state, void *key, embedDBVarDataS
         varDataAddr %= (state->numVarPages * state->pageSize);
     }
 
-    // Create varDataStream
-    embedDBVarDataStream *varDataStream = malloc(sizeof(embedDBVarDataStream));
-    if (varDataStream == NULL) {
-#ifdef PRINT_ERRORS
-        printf("ERROR: Failed to alloc memory for embedDBVarDataStream\n");
-#endif
-        return 3;
-    }
-
-    varDataStream->dataStart = varDataAddr;
-    varDataStream->totalBytes = dataLen;
-    varDataStream->bytesRead = 0;
-    varDataStream->fileOffset = varDataAddr;
-
-    *varData = varDataStream;
+    varData->dataStart = varDataAddr;
+    varData->totalBytes = dataLen;
+    varData->bytesRead = 0;
+    varData->fileOffset = varDataAddr;
     return 0;
 }
 
@@ -1611,6 +4998,10 @@ uint32_t embedDBVarDataStreamRead(embedDBState *state, embedDBVarDataStream *str
 #endif
         return 0;
     }
+    // A read that ended on a page boundary leaves the offset on the header of the next page
+    if (stream->fileOffset % state->pageSize == 0 && stream->bytesRead < stream->totalBytes)
+        stream->fileOffset += state->variableDataHeaderSize;
+
     // Read in var page containing the data to read
     uint32_t pageNum = (stream->fileOffset / state->pageSize) % state->numVarPages;
 
@@ -1648,6 +5039,91 @@ uint32_t embedDBVarDataStreamRead(embedDBState *state, embedDBVarDataStream *str
     return amtRead;
 }
 
+/**
+ * @brief	Gets a variable data page that stays in memory for a span. Borrowed pages are used in place, otherwise the page is read
+ * 			straight into a buffer pool frame, and only without either is it read into the variable data read buffer.
+ * @return	Pointer to the page, NULL if it could not be read.
+ */
+static void *readVariablePageSpan(embedDBState *state, id_t pageNum) {
+    if (state->fileInterface->borrow != NULL) {
+        void *page = state->fileInterface->borrow(pageNum, state->pageSize, state->varFile);
+        if (page != NULL) {
+            state->numReads++;
+            state->stats.files[EMBEDDB_VAR_FILE].reads++;
+            return page;
+        }
+    }
+
+    if (state->bufferPool == NULL) {
+        if (readVariablePage(state, pageNum) != 0)
+            return NULL;
+        return (int8_t *)state->buffer + state->pageSize * EMBEDDB_VAR_READ_BUFFER(state->parameters);
+    }
+
+    void *page = bufferPoolFind(state, EMBEDDB_VAR_FILE, pageNum);
+    if (page != NULL) {
+        state->bufferHits++;
+        state->stats.files[EMBEDDB_VAR_FILE].bufferHits++;
+        return page;
+    }
+
+    embedDBBufferPool *pool = state->bufferPool;
+    uint16_t frame = bufferPoolVictim(state);
+    page = (int8_t *)pool->pages + frame * state->pageSize;
+    pool->frames[frame].pageId = UINT32_MAX;
+    pool->frames[frame].referenced = 0;
+    if (state->fileInterface->read(page, pageNum, state->pageSize, state->varFile) == 0)
+        return NULL;
+    pool->frames[frame].pageId = pageNum;
+    pool->frames[frame].fileType = EMBEDDB_VAR_FILE;
+    pool->frames[frame].referenced = 1;
+    state->numReads++;
+    state->stats.files[EMBEDDB_VAR_FILE].reads++;
+    return page;
+}
+
+/**
+ * @brief	Returns the next bytes of a variable data stream as spans of the pages holding them, so they can be used without being copied.
+ * 			With a file interface that lends pages, such as the mmap interface, the spans point into the file and stay valid until it is closed.
+ * 			Otherwise they point into the buffer pool, at most half the pool per call, or without a pool into the variable data read buffer,
+ * 			one span per call, and stay valid until the next read of the state.
+ * @param	state		embedDB algorithm state structure
+ * @param	stream		Variable data stream. Moved past the bytes of the returned spans
+ * @param	spans		Pre-allocated array of spans to fill
+ * @param	maxSpans	Number of spans in @c spans
+ * @return	Number of spans filled. 0 once the stream has been read or if a page could not be read
+ */
+uint32_t embedDBVarDataStreamSpans(embedDBState *state, embedDBVarDataStream *stream, embedDBVarDataSpan *spans, uint32_t maxSpans) {
+    if (state->fileInterface->borrow == NULL)
+        maxSpans = min(maxSpans, state->bufferPool != NULL ? max(state->bufferPool->numFrames / 2, 1) : 1);
+
+    uint32_t numSpans = 0;
+    while (numSpans < maxSpans && stream->bytesRead < stream->totalBytes) {
+        // Data continues after the header of the next page
+        if (stream->fileOffset % state->pageSize == 0)
+            stream->fileOffset += state->variableDataHeaderSize;
+
+        uint32_t pageNum = (stream->fileOffset / state->pageSize) % state->numVarPages;
+        void *page = readVariablePageSpan(state, pageNum);
+        if (page == NULL) {
+#ifdef PRINT_ERRORS
+            printf("ERROR: Couldn't read variable data page %d\n", pageNum);
+#endif
+            return numSpans;
+        }
+
+        uint16_t pageOffset = stream->fileOffset % state->pageSize;
+        uint16_t length = min(stream->totalBytes - stream->bytesRead, (uint32_t)(state->pageSize - pageOffset));
+        spans[numSpans].page = page;
+        spans[numSpans].offset = pageOffset;
+        spans[numSpans].length = length;
+        numSpans++;
+        stream->bytesRead += length;
+        stream->fileOffset += length;
+    }
+    return numSpans;
+}
+
 /**
  * @brief	Prints statistics.
  * @param	state	embedDB state structure
@@ -1660,8 +5136,26 @@ void embedDBPrintStats(embedDBState *state) {
     printf("Num index writes: %d\n", state->numIdxWrites);
     printf("Max Error: %d\n", state->maxError);
 
-    if (SEARCH_METHOD == 2) {
-        if (RADIX_BITS > 0) {
+    static const char *fileNames[] = {"Data", "Index", "Var", "Value index"};
+    for (uint8_t f = 0; f < EMBEDDB_NUM_FILES; f++) {
+        embedDBFileStats *file = &state->stats.files[f];
+        printf("%s file: reads: %u writes: %u buffer hits: %u erases: %u wraps: %u\n", fileNames[f], file->reads, file->writes, file->bufferHits, file->erases, file->wraps);
+    }
+    printf("Pages probed by get: %u (max %u)\n", state->stats.getPagesProbed, state->stats.getMaxPagesProbed);
+    printf("Pages read by next: %u skipped: %u\n", state->stats.nextPagesRead, state->stats.nextPagesSkipped);
+    printf("Var pages written direct: %u\n", state->stats.varPagesDirect);
+    printf("Spline points erased: %u\n", state->stats.splinePointsErased);
+
+    static const char *operationNames[] = {"Put", "Get", "Next", "Flush", "Put batch", "Get many"};
+    for (uint8_t op = 0; op < EMBEDDB_STATS_NUM_OPS; op++) {
+        embedDBLatencyStats *latency = &state->stats.latency[op];
+        if (latency->count == 0)
+            continue;
+        printf("%s latency ticks: mean: %lu p50: %u p99: %u max: %u\n", operationNames[op], (unsigned long)(latency->totalTicks / latency->count), embedDBLatencyPercentile(latency, 50), embedDBLatencyPercentile(latency, 99), latency->maxTicks);
+    }
+
+    if (state->searchMethod == EMBEDDB_SEARCH_SPLINE) {
+        if (state->radixBits > 0) {
             splinePrint(state->rdix->spl);
             radixsplinePrint(state->rdix);
         } else {
@@ -1690,11 +5184,23 @@ id_t writePage(embedDBState *state, void *buffer) {
         // Erase pages to make space for new data
         state->numAvailDataPages += state->eraseSizeInPages;
         state->minDataPageId += state->eraseSizeInPages;
+        state->stats.files[EMBEDDB_DATA_FILE].erases++;
         if (state->cleanSpline)
             cleanSpline(state, &state->minKey);
         // Estimate the smallest key now. Could determine exactly by reading this page
         state->minKey += state->eraseSizeInPages * state->maxRecordsPerPage * state->avgKeyDiff;
     }
+    if (pageNum > 0 && pageNum % state->numDataPages == 0)
+        state->stats.files[EMBEDDB_DATA_FILE].wraps++;
+
+    /* Any cached copy of the physical page is about to be stale */
+    if (state->bufferedPageId == pageNum % state->numDataPages)
+        state->bufferedPageId = -1;
+    if (state->bufferPool != NULL)
+        bufferPoolInvalidate(state, EMBEDDB_DATA_FILE, pageNum % state->numDataPages);
+
+    if (EMBEDDB_USING_COMPRESSION(state->parameters))
+        buffer = compressPage(state, buffer);
 
     /* Seek to page location in file */
     int32_t val = state->fileInterface->write(buffer, pageNum % state->numDataPages, state->pageSize, state->dataFile);
@@ -1707,6 +5213,7 @@ id_t writePage(embedDBState *state, void *buffer) {
 
     state->numAvailDataPages--;
     state->numWrites++;
+    state->stats.files[EMBEDDB_DATA_FILE].writes++;
 
     return pageNum;
 }
@@ -1718,19 +5225,20 @@ id_t writePage(embedDBState *state, void *buffer) {
  * @return	Returns the number of points deleted
  */
 uint32_t cleanSpline(embedDBState *state, void *key) {
+    /* Binary search for the first point that is not smaller than the key */
     uint32_t numPointsErased = 0;
-    void *currentPoint;
-    for (size_t i = 0; i < state->spl->count; i++) {
-        currentPoint = splinePointLocation(state->spl, i);
-        int8_t compareResult = state->compareKey(currentPoint, key);
-        if (compareResult < 0)
-            numPointsErased++;
+    uint32_t last = (uint32_t)state->spl->count;
+    while (numPointsErased < last) {
+        uint32_t mid = numPointsErased + (last - numPointsErased) / 2;
+        if (compareKeys(state, splinePointLocation(state->spl, mid), key) < 0)
+            numPointsErased = mid + 1;
         else
-            break;
+            last = mid;
     }
     if (state->spl->count - numPointsErased == 1)
         numPointsErased--;
     splineErase(state->spl, numPointsErased);
+    state->stats.splinePointsErased += numPointsErased;
     return numPointsErased;
 }
 
@@ -1754,7 +5262,15 @@ id_t writeIndexPage(embedDBState *state, void *buffer) {
         // Erase index pages to make room for new page
         state->numAvailIndexPages += state->eraseSizeInPages;
         state->minIndexPageId += state->eraseSizeInPages;
+        state->stats.files[EMBEDDB_INDEX_FILE].erases++;
     }
+    if (pageNum > 0 && pageNum % state->numIndexPages == 0)
+        state->stats.files[EMBEDDB_INDEX_FILE].wraps++;
+
+    if (state->bufferedIndexPageId == pageNum % state->numIndexPages)
+        state->bufferedIndexPageId = -1;
+    if (state->bufferPool != NULL)
+        bufferPoolInvalidate(state, EMBEDDB_INDEX_FILE, pageNum % state->numIndexPages);
 
     /* Seek to page location in file */
     int32_t val = state->fileInterface->write(buffer, pageNum % state->numIndexPages, state->pageSize, state->indexFile);
@@ -1767,6 +5283,7 @@ id_t writeIndexPage(embedDBState *state, void *buffer) {
 
     state->numAvailIndexPages--;
     state->numIdxWrites++;
+    state->stats.files[EMBEDDB_INDEX_FILE].writes++;
 
     return pageNum;
 }
@@ -1778,6 +5295,18 @@ id_t writeIndexPage(embedDBState *state, void *buffer) {
  * @return	Return page number if success, -1 if error.
  */
 id_t writeVariablePage(embedDBState *state, void *buffer) {
+    return writeVariablePageGather(state, buffer, NULL);
+}
+
+/**
+ * @brief	Writes a variable data page made of a header and, if given, the data in a separate buffer.
+ * @param	state	embedDB algorithm state structure
+ * @param	buffer	The page, or only its header if @c data is not NULL. The logical page number is written into it
+ * @param	data	The pageSize - variableDataHeaderSize bytes after the header, written with the file interface's gather write. NULL to write
+ * 					the whole page from @c buffer
+ * @return	Return the logical page number written, or -1 if error.
+ */
+static id_t writeVariablePageGather(embedDBState *state, void *buffer, void *data) {
     if (state->varFile == NULL) {
         return -1;
     }
@@ -1788,6 +5317,7 @@ id_t writeVariablePage(embedDBState *state, void *buffer) {
     // Erase data if needed
     if (state->numAvailVarPages <= 0) {
         state->numAvailVarPages += state->eraseSizeInPages;
+        state->stats.files[EMBEDDB_VAR_FILE].erases++;
         // Last page that is deleted
         id_t pageNum = (physicalPageId + state->eraseSizeInPages - 1) % state->numVarPages;
 
@@ -1801,11 +5331,19 @@ id_t writeVariablePage(embedDBState *state, void *buffer) {
     }
 
     // Add logical page number to data page
-    void *buf = (int8_t *)state->buffer + state->pageSize * EMBEDDB_VAR_WRITE_BUFFER(state->parameters);
-    memcpy(buf, &state->nextVarPageId, sizeof(id_t));
+    memcpy(buffer, &state->nextVarPageId, sizeof(id_t));
+
+    if (state->bufferedVarPage == physicalPageId)
+        state->bufferedVarPage = -1;
+    if (state->bufferPool != NULL)
+        bufferPoolInvalidate(state, EMBEDDB_VAR_FILE, physicalPageId);
 
     // Write to file
-    uint32_t val = state->fileInterface->write(buffer, physicalPageId, state->pageSize, state->varFile);
+    uint32_t val;
+    if (data == NULL)
+        val = state->fileInterface->write(buffer, physicalPageId, state->pageSize, state->varFile);
+    else
+        val = state->fileInterface->writeGather(buffer, state->variableDataHeaderSize, data, physicalPageId, state->pageSize, state->varFile);
     if (val == 0) {
 #ifndef PRINT
         printf("Failed to write vardata page: %i\n", state->nextVarPageId);
@@ -1813,9 +5351,12 @@ id_t writeVariablePage(embedDBState *state, void *buffer) {
         return -1;
     }
 
+    if (state->nextVarPageId > 0 && physicalPageId == 0)
+        state->stats.files[EMBEDDB_VAR_FILE].wraps++;
     state->nextVarPageId++;
     state->numAvailVarPages--;
     state->numWrites++;
+    state->stats.files[EMBEDDB_VAR_FILE].writes++;
 
     return state->nextVarPageId - 1;
 }
@@ -1830,19 +5371,50 @@ int8_t readPage(embedDBState *state, id_t pageNum) {
     /* Check if page is currently in buffer */
     if (pageNum == state->bufferedPageId) {
         state->bufferHits++;
+        state->stats.files[EMBEDDB_DATA_FILE].bufferHits++;
         return 0;
     }
 
-    // point to write buffer
+    /* Use the page directly from storage if the file interface can lend it */
+    if (state->fileInterface->borrow != NULL) {
+        void *page = state->fileInterface->borrow(pageNum, state->pageSize, state->dataFile);
+        if (page != NULL) {
+            state->numReads++;
+            state->stats.files[EMBEDDB_DATA_FILE].reads++;
+            state->bufferedPageId = pageNum;
+            embedDBSetDataReadBuffer(state, page);
+            return 0;
+        }
+    }
+
+    // point to read buffer
     void *buf = (int8_t *)state->buffer + state->pageSize;
 
+    /* Check if page is in the buffer pool */
+    if (state->bufferPool != NULL) {
+        void *cached = bufferPoolFind(state, EMBEDDB_DATA_FILE, pageNum);
+        if (cached != NULL) {
+            memcpy(buf, cached, state->pageSize);
+            state->bufferHits++;
+            state->stats.files[EMBEDDB_DATA_FILE].bufferHits++;
+            state->bufferedPageId = pageNum;
+            embedDBSetDataReadBuffer(state, buf);
+            return 0;
+        }
+    }
+
     /* Page is not in buffer. Read from storage. */
     /* Read page into start of buffer 1 */
     if (0 == state->fileInterface->read(buf, pageNum, state->pageSize, state->dataFile))
         return -1;
 
     state->numReads++;
+    state->stats.files[EMBEDDB_DATA_FILE].reads++;
     state->bufferedPageId = pageNum;
+    embedDBSetDataReadBuffer(state, buf);
+
+    if (state->bufferPool != NULL)
+        bufferPoolInsert(state, EMBEDDB_DATA_FILE, pageNum, buf);
     return 0;
 }
 
@@ -1854,9 +5426,14 @@ void readToWriteBuf(embedDBState *state) {
     // point to read buffer
     void *readBuf = (int8_t *)state->buffer + state->pageSize * EMBEDDB_DATA_READ_BUFFER;
     // point to write buffer
-    void *writeBuf = (int8_t *)state->buffer + state->pageSize * EMBEDDB_DATA_WRITE_BUFFER;
+    void *writeBuf = state->dataWriteBuffer;
+    if (EMBEDDB_USING_COMPRESSION(state->parameters))
+        readBuf = state->dataDecompressBuffer;
     // copy write buffer to the read buffer.
-    memcpy(readBuf, writeBuf, state->pageSize);
+    memcpy(readBuf, writeBuf, embedDBDataPageSize(state));
+    // read buffer no longer holds a page from storage
+    state->bufferedPageId = -1;
+    state->dataReadBuffer = readBuf;
 }
 
 /**
@@ -1882,21 +5459,270 @@ int8_t readIndexPage(embedDBState *state, id_t pageNum) {
     /* Check if page is currently in buffer */
     if (pageNum == state->bufferedIndexPageId) {
         state->bufferHits++;
+        state->stats.files[EMBEDDB_INDEX_FILE].bufferHits++;
         return 0;
     }
 
     void *buf = (int8_t *)state->buffer + state->pageSize * EMBEDDB_INDEX_READ_BUFFER;
 
+    /* Check if page is in the buffer pool */
+    if (state->bufferPool != NULL) {
+        void *cached = bufferPoolFind(state, EMBEDDB_INDEX_FILE, pageNum);
+        if (cached != NULL) {
+            memcpy(buf, cached, state->pageSize);
+            state->bufferHits++;
+            state->stats.files[EMBEDDB_INDEX_FILE].bufferHits++;
+            state->bufferedIndexPageId = pageNum;
+            return 0;
+        }
+    }
+
     /* Page is not in buffer. Read from storage. */
     /* Read page into start of buffer */
     if (0 == state->fileInterface->read(buf, pageNum, state->pageSize, state->indexFile))
         return -1;
 
     state->numIdxReads++;
+    state->stats.files[EMBEDDB_INDEX_FILE].reads++;
     state->bufferedIndexPageId = pageNum;
+
+    if (state->bufferPool != NULL)
+        bufferPoolInsert(state, EMBEDDB_INDEX_FILE, pageNum, buf);
+    return 0;
+}
+
+/**
+ * @brief	Compares two value index entries for qsort. Orders by value, then by data page.
+ */
+static int compareValueEntry(const void *a, const void *b) {
+    const embedDBValueEntry *e1 = (const embedDBValueEntry *)a, *e2 = (const embedDBValueEntry *)b;
+    if (e1->value != e2->value)
+        return (e1->value > e2->value) - (e1->value < e2->value);
+    return (e1->dataPageId > e2->dataPageId) - (e1->dataPageId < e2->dataPageId);
+}
+
+/**
+ * @brief	Adds the distinct values of the indexed column of a data page to the value index.
+ * 			A run that fills up is sorted and written, and the rest of the values go in the next run.
+ * @param	state		embedDB algorithm state structure
+ * @param	page		Data page
+ * @param	dataPageId	Logical id of the data page
+ */
+void valueIndexAddPage(embedDBState *state, void *page, id_t dataPageId) {
+    embedDBValueIndex *vi = state->valueIndex;
+    int8_t dataScratch[INT8_MAX];
+    count_t count = EMBEDDB_GET_COUNT(page);
+    for (count_t i = 0; i < count; i++)
+        memcpy(vi->pageValues + i, (int8_t *)embedDBRecordData(state, page, i, dataScratch) + state->valueIndexColumnOffset, sizeof(int32_t));
+    qsort(vi->pageValues, count, sizeof(int32_t), compareInt32);
+
+    for (count_t i = 0; i < count; i++) {
+        if (i > 0 && vi->pageValues[i] == vi->pageValues[i - 1])
+            continue;
+
+        /* The page is split over two runs, so neither run holds all of its values */
+        if (vi->numRunEntries >= vi->maxRunEntries)
+            valueIndexWriteRun(state, dataPageId, dataPageId + 1);
+
+        vi->runEntries[vi->numRunEntries].value = vi->pageValues[i];
+        vi->runEntries[vi->numRunEntries].dataPageId = dataPageId;
+        vi->numRunEntries++;
+    }
+    vi->nextDataPageId = dataPageId + 1;
+
+    if (vi->numRunEntries >= vi->maxRunEntries)
+        valueIndexWriteRun(state, dataPageId + 1, dataPageId + 1);
+}
+
+/**
+ * @brief	Sorts the run being filled and writes it to as many value index pages as it needs, then starts the next run.
+ * @param	state					embedDB algorithm state structure
+ * @param	nextDataPageId			First data page whose values are not all in the runs written so far
+ * @param	nextRunFirstDataPageId	First data page whose values will all be in the next run or the runs after it
+ * @return	Return 0 if success, -1 if error.
+ */
+int8_t valueIndexWriteRun(embedDBState *state, id_t nextDataPageId, id_t nextRunFirstDataPageId) {
+    embedDBValueIndex *vi = state->valueIndex;
+    qsort(vi->runEntries, vi->numRunEntries, sizeof(embedDBValueEntry), compareValueEntry);
+
+    int8_t *page = vi->pageBuffer;
+    count_t numRunPages = (vi->numRunEntries + vi->maxPageEntries - 1) / vi->maxPageEntries;
+    int8_t result = 0;
+    for (count_t runPage = 0; runPage < numRunPages; runPage++) {
+        uint32_t first = (uint32_t)runPage * vi->maxPageEntries;
+        count_t count = min(vi->numRunEntries - first, vi->maxPageEntries);
+        memset(page, 0, EMBEDDB_VALUE_INDEX_HEADER_SIZE);
+        memcpy(page + 4, &count, sizeof(count_t));
+        memcpy(page + 6, &runPage, sizeof(count_t));
+        memcpy(page + 8, &numRunPages, sizeof(count_t));
+        memcpy(page + 12, &vi->runFirstDataPageId, sizeof(id_t));
+        memcpy(page + 16, &nextDataPageId, sizeof(id_t));
+        memcpy(page + EMBEDDB_VALUE_INDEX_HEADER_SIZE, vi->runEntries + first, count * sizeof(embedDBValueEntry));
+
+        id_t pageNum = writeValueIndexPage(state, page);
+        if (pageNum == (id_t)-1) {
+            /* The values of the data pages before the next run are lost */
+            vi->firstDataPageId = nextRunFirstDataPageId;
+            result = -1;
+            break;
+        }
+        valueIndexSummarize(page, &vi->pages[pageNum % state->numValueIndexPages]);
+    }
+
+    vi->numRunEntries = 0;
+    vi->runFirstDataPageId = nextRunFirstDataPageId;
+    return result;
+}
+
+/**
+ * @brief	Writes value index page in buffer to storage. Returns page number.
+ * @param	state	embedDB algorithm state structure
+ * @param	buffer	Buffer to use for writing value index page
+ * @return	Return page number if success, -1 if error.
+ */
+id_t writeValueIndexPage(embedDBState *state, void *buffer) {
+    embedDBValueIndex *vi = state->valueIndex;
+
+    /* Always writes to next page number */
+    id_t pageNum = vi->nextPageId++;
+
+    /* Setup page number in header */
+    memcpy(buffer, &(pageNum), sizeof(id_t));
+
+    if (vi->numAvailPages <= 0) {
+        // Erase value index pages to make room for new page
+        vi->numAvailPages += state->eraseSizeInPages;
+        vi->minPageId += state->eraseSizeInPages;
+        state->stats.files[EMBEDDB_VALUE_INDEX_FILE].erases++;
+
+        /* The values of the data pages of the erased runs are no longer on file. If the oldest run lost its first pages, none of its data pages are covered */
+        embedDBValuePage *oldest = &vi->pages[vi->minPageId % state->numValueIndexPages];
+        vi->firstDataPageId = max(vi->firstDataPageId, oldest->runPage == 0 ? oldest->firstDataPageId : oldest->nextDataPageId);
+    }
+    if (pageNum > 0 && pageNum % state->numValueIndexPages == 0)
+        state->stats.files[EMBEDDB_VALUE_INDEX_FILE].wraps++;
+
+    int32_t val = state->fileInterface->write(buffer, pageNum % state->numValueIndexPages, state->pageSize, state->valueIndexFile);
+    if (val == 0) {
+#ifdef PRINT_ERRORS
+        printf("Failed to write value index page: %i (%i)\n", pageNum, pageNum % state->numValueIndexPages);
+#endif
+        return -1;
+    }
+
+    vi->numAvailPages--;
+    state->stats.files[EMBEDDB_VALUE_INDEX_FILE].writes++;
+
+    return pageNum;
+}
+
+/**
+ * @brief	Reads given value index page from storage into the value index page buffer.
+ * @param	state	embedDB algorithm state structure
+ * @param	pageNum	Physical page number to read
+ * @return	Return 0 if success, -1 if error.
+ */
+int8_t readValueIndexPage(embedDBState *state, id_t pageNum) {
+    embedDBValueIndex *vi = state->valueIndex;
+    if (state->fileInterface->read(vi->pageBuffer, pageNum, state->pageSize, state->valueIndexFile) == 0) {
+#ifdef PRINT_ERRORS
+        printf("ERROR: Failed to read value index page %i\n", pageNum);
+#endif
+        return -1;
+    }
+    state->stats.files[EMBEDDB_VALUE_INDEX_FILE].reads++;
     return 0;
 }
 
+/**
+ * @brief	Sets the bits of the data pages in [start, end) that a list of value index entries has with a value in [minValue, maxValue].
+ * @param	entries		Value index entries
+ * @param	count		Number of entries
+ * @param	sorted		1 if the entries are sorted. The run being filled is only sorted when written
+ * @param	pages		Bitset of the data pages from start
+ */
+static void valueIndexMarkPages(embedDBValueEntry *entries, uint32_t count, int8_t sorted, uint8_t *pages, id_t start, id_t end, int32_t minValue, int32_t maxValue) {
+    uint32_t i = 0;
+    if (sorted) {
+        /* Binary search for the first entry not below the range */
+        uint32_t high = count;
+        while (i < high) {
+            uint32_t mid = i + (high - i) / 2;
+            if (entries[mid].value < minValue)
+                i = mid + 1;
+            else
+                high = mid;
+        }
+    }
+
+    for (; i < count; i++) {
+        if (entries[i].value > maxValue) {
+            if (sorted)
+                break;
+            continue;
+        }
+        if (entries[i].value < minValue || entries[i].dataPageId < start || entries[i].dataPageId >= end)
+            continue;
+        id_t bit = entries[i].dataPageId - start;
+        pages[bit / 8] |= 1 << (bit % 8);
+    }
+}
+
+/**
+ * @brief	Returns 1 if a value index page may list a data page from start with a value in [minValue, maxValue].
+ */
+static inline int8_t valuePageOverlaps(embedDBValuePage *page, id_t start, int32_t minValue, int32_t maxValue) {
+    return page->maxValue >= minValue && page->minValue <= maxValue && page->nextDataPageId >= start;
+}
+
+/**
+ * @brief	Finds the data pages that hold a value of the indexed column in the data range of an iterator.
+ * 			Only the value index pages whose values overlap the range are read. The index is not used if it would read
+ * 			half as many pages as the data pages it covers, or if a page cannot be read.
+ * @param	state	embedDB algorithm state structure
+ * @param	it		Iterator with nextDataPage, minData and maxData set
+ */
+void valueIndexFindPages(embedDBState *state, embedDBIterator *it) {
+    embedDBValueIndex *vi = state->valueIndex;
+    id_t start = max(vi->firstDataPageId, it->nextDataPage);
+    id_t end = vi->nextDataPageId;
+    if (start >= end)
+        return;
+
+    int32_t minValue = INT32_MIN, maxValue = INT32_MAX;
+    if (it->minData != NULL)
+        memcpy(&minValue, (int8_t *)it->minData + state->valueIndexColumnOffset, sizeof(int32_t));
+    if (it->maxData != NULL)
+        memcpy(&maxValue, (int8_t *)it->maxData + state->valueIndexColumnOffset, sizeof(int32_t));
+
+    uint32_t numPagesToRead = 0;
+    for (id_t pageId = vi->minPageId; pageId < vi->nextPageId; pageId++) {
+        if (valuePageOverlaps(&vi->pages[pageId % state->numValueIndexPages], start, minValue, maxValue))
+            numPagesToRead++;
+    }
+    if (numPagesToRead * 2 >= end - start)
+        return;
+
+    uint8_t *pages = calloc((end - start + 7) / 8, 1);
+    if (pages == NULL)
+        return;
+
+    for (id_t pageId = vi->minPageId; pageId < vi->nextPageId; pageId++) {
+        if (!valuePageOverlaps(&vi->pages[pageId % state->numValueIndexPages], start, minValue, maxValue))
+            continue;
+        if (readValueIndexPage(state, pageId % state->numValueIndexPages) != 0) {
+            free(pages);
+            return;
+        }
+        valueIndexMarkPages((embedDBValueEntry *)(vi->pageBuffer + EMBEDDB_VALUE_INDEX_HEADER_SIZE), EMBEDDB_GET_COUNT(vi->pageBuffer), 1, pages, start, end, minValue, maxValue);
+    }
+    valueIndexMarkPages(vi->runEntries, vi->numRunEntries, 0, pages, start, end, minValue, maxValue);
+
+    it->valuePages = pages;
+    it->valuePagesStart = start;
+    it->valuePagesEnd = end;
+}
+
 /**
  * @brief	Reads given variable data page from storage
  * @param 	state 	embedDB algorithm state structure
@@ -1907,12 +5733,25 @@ int8_t readVariablePage(embedDBState *state, id_t pageNum) {
     // Check if page is currently in buffer
     if (pageNum == state->bufferedVarPage) {
         state->bufferHits++;
+        state->stats.files[EMBEDDB_VAR_FILE].bufferHits++;
         return 0;
     }
 
     // Get buffer to read into
     void *buf = (int8_t *)state->buffer + EMBEDDB_VAR_READ_BUFFER(state->parameters) * state->pageSize;
 
+    // Check if page is in the buffer pool
+    if (state->bufferPool != NULL) {
+        void *cached = bufferPoolFind(state, EMBEDDB_VAR_FILE, pageNum);
+        if (cached != NULL) {
+            memcpy(buf, cached, state->pageSize);
+            state->bufferHits++;
+            state->stats.files[EMBEDDB_VAR_FILE].bufferHits++;
+            state->bufferedVarPage = pageNum;
+            return 0;
+        }
+    }
+
     // Read in one page worth of data
     if (state->fileInterface->read(buf, pageNum, state->pageSize, state->varFile) == 0) {
         return -1;
@@ -1920,7 +5759,11 @@ int8_t readVariablePage(embedDBState *state, id_t pageNum) {
 
     // Track stats
     state->numReads++;
+    state->stats.files[EMBEDDB_VAR_FILE].reads++;
     state->bufferedVarPage = pageNum;
+
+    if (state->bufferPool != NULL)
+        bufferPoolInsert(state, EMBEDDB_VAR_FILE, pageNum, buf);
     return 0;
 }
 
@@ -1934,6 +5777,260 @@ void embedDBResetStats(embedDBState *state) {
     state->bufferHits = 0;
     state->numIdxReads = 0;
     state->numIdxWrites = 0;
+    memset(&state->stats, 0, sizeof(embedDBStats));
+}
+
+/**
+ * @brief	Copies the statistics of a state and fills in the current spline size and error.
+ * @param	state	embedDB state structure
+ * @param	stats	Return variable for the statistics
+ */
+void embedDBGetStats(embedDBState *state, embedDBStats *stats) {
+    memcpy(stats, &state->stats, sizeof(embedDBStats));
+    stats->splinePoints = 0;
+    stats->splineMaxError = 0;
+    stats->splineBytes = 0;
+    if (state->spl == NULL)
+        return;
+
+    stats->splinePoints = (uint32_t)state->spl->count;
+    stats->splineMaxError = state->spl->maxError;
+    stats->splineBytes = state->radixBits > 0 && state->rdix != NULL ? (uint32_t)radixsplineSize(state->rdix) : (uint32_t)splineSize(state->spl);
+}
+
+/**
+ * @brief	Sets the clock used to time put, get, next and flush. Timing is off until a clock is set and can be turned off again with NULL.
+ * @param	state	embedDB state structure after embedDBInit
+ * @param	clock	Function returning the current tick count, or NULL
+ */
+void embedDBSetClock(embedDBState *state, embedDBClock clock) {
+    state->clock = clock;
+}
+
+/**
+ * @brief	Sets the function called with each record once it is inserted. Only one listener can be set and NULL removes it. Clears insertListenerError.
+ * @param	state		embedDB state structure after embedDBInit
+ * @param	listener	Function called with each inserted record, or NULL
+ * @param	context		Pointer passed to the listener
+ */
+void embedDBSetInsertListener(embedDBState *state, embedDBInsertListener listener, void *context) {
+    state->insertListener = listener;
+    state->insertListenerContext = context;
+    state->insertListenerError = 0;
+}
+
+/**
+ * @brief	Estimates a latency percentile from a histogram.
+ * @param	latency		Latencies of an operation
+ * @param	percentile	Percentile between 0 and 100
+ * @return	Upper bound in ticks of the histogram bucket holding the percentile, at most the slowest operation. 0 if nothing was timed.
+ */
+uint32_t embedDBLatencyPercentile(embedDBLatencyStats *latency, uint8_t percentile) {
+    if (latency->count == 0)
+        return 0;
+
+    /* Rank of the operation at the percentile, counting from 1 */
+    uint64_t rank = ((uint64_t)latency->count * min(percentile, 100) + 99) / 100;
+    if (rank == 0)
+        rank = 1;
+
+    uint64_t seen = 0;
+    for (uint8_t bucket = 0; bucket < EMBEDDB_STATS_LATENCY_BUCKETS; bucket++) {
+        seen += latency->histogram[bucket];
+        if (seen >= rank) {
+            if (bucket == EMBEDDB_STATS_LATENCY_BUCKETS - 1)
+                return latency->maxTicks;
+            uint32_t upperBound = (uint32_t)((1ull << bucket) - 1);
+            return min(upperBound, latency->maxTicks);
+        }
+    }
+    return latency->maxTicks;
+}
+
+/**
+ * @brief	Opens a reader handle on a state and takes its first snapshot. The state must be initialized and use a file interface whose read can be called from several threads at once.
+ * @param	state	embedDB state structure written by one thread
+ * @param	reader	Reader handle to set up
+ * @return	Return 0 if success. Non-zero value if every reader slot is in use or the buffers could not be allocated.
+ */
+int8_t embedDBInitReader(embedDBState *state, embedDBReader *reader) {
+    reader->writer = state;
+    reader->view.buffer = NULL;
+    reader->view.dataWriteBuffer = NULL;
+    reader->view.dataDecompressBuffer = NULL;
+    reader->viewSpline.points = NULL;
+    reader->viewSpline.firstSplinePoint = NULL;
+
+    /* Claim a free slot for the pins of the reader */
+    uint8_t slot = 0;
+    for (; slot < EMBEDDB_MAX_READERS; slot++) {
+        uint32_t expected = 0;
+        if (__atomic_compare_exchange_n(&state->snapshotPins[slot].inUse, &expected, 1, 0, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+            break;
+    }
+    if (slot == EMBEDDB_MAX_READERS) {
+#ifdef PRINT_ERRORS
+        printf("ERROR: Every reader slot is in use. At most %d readers can be open.\n", EMBEDDB_MAX_READERS);
+#endif
+        return -1;
+    }
+    reader->slot = slot;
+
+    /* The reader has its own copy of the fixed buffers so that the write buffer can be copied into it */
+    embedDBState *view = &reader->view;
+    view->buffer = calloc(EMBEDDB_NUM_FIXED_BUFFERS(state->parameters), state->pageSize);
+    view->dataWriteBuffer = view->buffer;
+    int8_t allocated = view->buffer != NULL;
+    if (EMBEDDB_USING_COMPRESSION(state->parameters)) {
+        view->dataWriteBuffer = malloc(embedDBDataPageSize(state));
+        view->dataDecompressBuffer = malloc(embedDBDataPageSize(state));
+        allocated &= view->dataWriteBuffer != NULL && view->dataDecompressBuffer != NULL;
+    }
+    if (state->spl != NULL) {
+        size_t pointSize = state->keySize + sizeof(uint32_t);
+        reader->viewSpline.points = malloc(state->spl->size * pointSize);
+        reader->viewSpline.firstSplinePoint = malloc(pointSize);
+        allocated &= reader->viewSpline.points != NULL && reader->viewSpline.firstSplinePoint != NULL;
+    }
+    if (!allocated) {
+#ifdef PRINT_ERRORS
+        printf("ERROR: Failed to allocate the buffers of the reader.\n");
+#endif
+        embedDBCloseReader(reader);
+        return -1;
+    }
+
+    view->numReads = 0;
+    view->numIdxReads = 0;
+    view->bufferHits = 0;
+    memset(&view->stats, 0, sizeof(embedDBStats));
+    embedDBSnapshot(reader);
+    return 0;
+}
+
+/**
+ * @brief	Copies the writer state, write buffer and spline into the reader and pins the oldest pages the copy reads.
+ * 			May read a state the writer is changing, in which case the snapshot must be taken again.
+ * @param	reader	Reader handle
+ */
+static void snapshotCopy(embedDBReader *reader) {
+    embedDBState *writer = reader->writer;
+    embedDBState *view = &reader->view;
+    void *buffer = view->buffer, *writeBuffer = view->dataWriteBuffer;
+    void *points = reader->viewSpline.points, *firstPoint = reader->viewSpline.firstSplinePoint;
+
+    memcpy(view, writer, sizeof(embedDBState));
+    view->buffer = buffer;
+    view->dataWriteBuffer = writeBuffer;
+    memcpy(writeBuffer, writer->dataWriteBuffer, embedDBDataPageSize(writer));
+
+    /* Leave out the oldest pages when the next write erases them, so a reader that keeps taking snapshots does not hold up the writer */
+    if (view->numAvailDataPages == 0) {
+        view->minDataPageId += view->eraseSizeInPages;
+        view->minKey += view->eraseSizeInPages * view->maxRecordsPerPage * view->avgKeyDiff;
+    }
+    if (view->indexFile != NULL && view->numAvailIndexPages == 0)
+        view->minIndexPageId += view->eraseSizeInPages;
+
+    /* The runs of the value index change with every page the writer adds */
+    view->valueIndex = NULL;
+
+    /* Copy the points in use in order. The count and start may be torn, so they are kept inside the point array */
+    if (writer->spl != NULL) {
+        spline *viewSpline = &reader->viewSpline;
+        memcpy(viewSpline, writer->spl, sizeof(spline));
+        size_t pointSize = viewSpline->keySize + sizeof(uint32_t);
+        size_t start = viewSpline->pointsStartIndex % viewSpline->size;
+        size_t count = min(viewSpline->count, viewSpline->size);
+        size_t numBeforeWrap = min(count, viewSpline->size - start);
+        memcpy(points, (int8_t *)viewSpline->points + start * pointSize, numBeforeWrap * pointSize);
+        memcpy((int8_t *)points + numBeforeWrap * pointSize, viewSpline->points, (count - numBeforeWrap) * pointSize);
+        memcpy(firstPoint, viewSpline->firstSplinePoint, pointSize);
+        viewSpline->points = points;
+        viewSpline->firstSplinePoint = firstPoint;
+        viewSpline->pointsStartIndex = 0;
+        viewSpline->count = count;
+        viewSpline->upper = NULL;
+        viewSpline->lower = NULL;
+        viewSpline->lastKey = NULL;
+    }
+
+    embedDBSnapshotPin *pin = &writer->snapshotPins[reader->slot];
+    __atomic_store_n(&pin->minDataPageId, view->minDataPageId, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&pin->minIndexPageId, view->indexFile != NULL ? view->minIndexPageId : UINT32_MAX, __ATOMIC_SEQ_CST);
+}
+
+/**
+ * @brief	Replaces the snapshot of a reader with the current state of the writer. Can be called while the writer inserts without any locking.
+ * 			Iterators initialized on the old snapshot must not be used afterwards.
+ * @param	reader	Reader handle
+ */
+void embedDBSnapshot(embedDBReader *reader) {
+    embedDBState *writer = reader->writer;
+    embedDBState *view = &reader->view;
+    id_t numReads = view->numReads, numIdxReads = view->numIdxReads, bufferHits = view->bufferHits;
+    embedDBStats stats = view->stats;
+    void *decompressBuffer = view->dataDecompressBuffer;
+
+    /* The copy is consistent if the writer did not start a change before or while it was taken */
+    uint32_t numTries = 0;
+    while (1) {
+        uint32_t sequence = __atomic_load_n(&writer->snapshotSequence, __ATOMIC_ACQUIRE);
+        if (!(sequence & 1)) {
+            snapshotCopy(reader);
+            __atomic_thread_fence(__ATOMIC_SEQ_CST);
+            if (__atomic_load_n(&writer->snapshotSequence, __ATOMIC_RELAXED) == sequence)
+                break;
+        }
+        if (++numTries == SNAPSHOT_RETRIES)
+            __atomic_fetch_add(&writer->snapshotWaiting, 1, __ATOMIC_SEQ_CST);
+        SPIN_PAUSE();
+    }
+    if (numTries >= SNAPSHOT_RETRIES)
+        __atomic_fetch_sub(&writer->snapshotWaiting, 1, __ATOMIC_RELEASE);
+
+    /* Reads only go through the buffers of the reader. The search uses the copied spline and the pages are not cached in the shared buffer pool */
+    view->dataDecompressBuffer = decompressBuffer;
+    view->dataReadBuffer = (int8_t *)view->buffer + view->pageSize * EMBEDDB_DATA_READ_BUFFER;
+    view->bufferedPageId = -1;
+    view->bufferedIndexPageId = -1;
+    view->bufferedVarPage = -1;
+    view->bufferPool = NULL;
+    view->zoneMap = NULL;
+    view->bitmapSample = NULL;
+    view->spl = writer->spl != NULL ? &reader->viewSpline : NULL;
+    view->rdix = NULL;
+    view->radixBits = 0;
+    view->numReads = numReads;
+    view->numIdxReads = numIdxReads;
+    view->bufferHits = bufferHits;
+    view->stats = stats;
+    view->numWrites = 0;
+    view->numIdxWrites = 0;
+}
+
+/**
+ * @brief	Releases the snapshot of a reader so the writer can erase its pages, and frees the reader buffers.
+ * @param	reader	Reader handle
+ */
+void embedDBCloseReader(embedDBReader *reader) {
+    embedDBSnapshotPin *pin = &reader->writer->snapshotPins[reader->slot];
+    __atomic_store_n(&pin->minDataPageId, UINT32_MAX, __ATOMIC_RELEASE);
+    __atomic_store_n(&pin->minIndexPageId, UINT32_MAX, __ATOMIC_RELEASE);
+    __atomic_store_n(&pin->inUse, 0, __ATOMIC_RELEASE);
+
+    embedDBState *view = &reader->view;
+    if (view->dataWriteBuffer != view->buffer)
+        free(view->dataWriteBuffer);
+    free(view->dataDecompressBuffer);
+    free(view->buffer);
+    free(reader->viewSpline.points);
+    free(reader->viewSpline.firstSplinePoint);
+    view->buffer = NULL;
+    view->dataWriteBuffer = NULL;
+    view->dataDecompressBuffer = NULL;
+    reader->viewSpline.points = NULL;
+    reader->viewSpline.firstSplinePoint = NULL;
 }
 
 /**
@@ -1950,8 +6047,14 @@ void embedDBClose(embedDBState *state) {
     if (state->varFile != NULL) {
         state->fileInterface->close(state->varFile);
     }
-    if (SEARCH_METHOD == 2) {  // Spline
-        if (RADIX_BITS > 0) {
+    if (EMBEDDB_USING_CHECKPOINT(state->parameters) && state->checkpointFile != NULL) {
+        state->fileInterface->close(state->checkpointFile);
+    }
+    if (EMBEDDB_USING_VALUE_INDEX(state->parameters) && state->valueIndexFile != NULL) {
+        state->fileInterface->close(state->valueIndexFile);
+    }
+    if (state->searchMethod == EMBEDDB_SEARCH_SPLINE) {  // Spline
+        if (state->radixBits > 0) {
             radixsplineClose(state->rdix);
             free(state->rdix);
             state->rdix = NULL;
@@ -1963,4 +6066,32 @@ void embedDBClose(embedDBState *state) {
             state->spl = NULL;
         }
     }
+    if (state->bufferPool != NULL) {
+        free(state->bufferPool->frames);
+        free(state->bufferPool);
+        state->bufferPool = NULL;
+    }
+    if (state->zoneMap != NULL) {
+        free(state->zoneMap);
+        state->zoneMap = NULL;
+    }
+    if (state->bitmapSample != NULL) {
+        free(state->bitmapSample);
+        state->bitmapSample = NULL;
+    }
+    if (state->valueIndex != NULL) {
+        embedDBValueIndex *vi = state->valueIndex;
+        free(vi->runEntries);
+        free(vi->pageBuffer);
+        free(vi->pageValues);
+        free(vi->pages);
+        free(vi);
+        state->valueIndex = NULL;
+    }
+    if (EMBEDDB_USING_COMPRESSION(state->parameters)) {
+        free(state->dataWriteBuffer);
+        free(state->dataDecompressBuffer);
+        state->dataWriteBuffer = NULL;
+        state->dataDecompressBuffer = NULL;
+    }
 }
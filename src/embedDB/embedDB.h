@@ -59,6 +59,17 @@ typedef uint16_t count_t;
 #define EMBEDDB_USE_BMAP 8
 #define EMBEDDB_USE_VDATA 16
 #define EMBEDDB_RESET_DATA 32
+#define EMBEDDB_USE_BUFFER_POOL 64
+#define EMBEDDB_USE_CHECKPOINT 128
+#define EMBEDDB_USE_BINARY_SEARCH 256
+#define EMBEDDB_USE_ESTIMATE_SEARCH 512
+#define EMBEDDB_USE_RADIX 1024
+#define EMBEDDB_USE_UNSIGNED_KEYS 2048
+#define EMBEDDB_USE_PAX 4096
+#define EMBEDDB_USE_COMPRESSION 8192
+#define EMBEDDB_USE_ZONE_MAP 16384
+#define EMBEDDB_USE_BITMAP_BUCKETS 32768
+#define EMBEDDB_USE_VALUE_INDEX 65536
 
 #define EMBEDDB_USING_INDEX(x) ((x & EMBEDDB_USE_INDEX) > 0 ? 1 : 0)
 #define EMBEDDB_USING_MAX_MIN(x) ((x & EMBEDDB_USE_MAX_MIN) > 0 ? 1 : 0)
@@ -66,6 +77,22 @@ typedef uint16_t count_t;
 #define EMBEDDB_USING_BMAP(x) ((x & EMBEDDB_USE_BMAP) > 0 ? 1 : 0)
 #define EMBEDDB_USING_VDATA(x) ((x & EMBEDDB_USE_VDATA) > 0 ? 1 : 0)
 #define EMBEDDB_RESETING_DATA(x) ((x & EMBEDDB_RESET_DATA) > 0 ? 1 : 0)
+#define EMBEDDB_USING_BUFFER_POOL(x) ((x & EMBEDDB_USE_BUFFER_POOL) > 0 ? 1 : 0)
+#define EMBEDDB_USING_CHECKPOINT(x) ((x & EMBEDDB_USE_CHECKPOINT) > 0 ? 1 : 0)
+#define EMBEDDB_USING_BINARY_SEARCH(x) ((x & EMBEDDB_USE_BINARY_SEARCH) > 0 ? 1 : 0)
+#define EMBEDDB_USING_ESTIMATE_SEARCH(x) ((x & EMBEDDB_USE_ESTIMATE_SEARCH) > 0 ? 1 : 0)
+#define EMBEDDB_USING_RADIX(x) ((x & EMBEDDB_USE_RADIX) > 0 ? 1 : 0)
+#define EMBEDDB_USING_UNSIGNED_KEYS(x) ((x & EMBEDDB_USE_UNSIGNED_KEYS) > 0 ? 1 : 0)
+#define EMBEDDB_USING_PAX(x) ((x & EMBEDDB_USE_PAX) > 0 ? 1 : 0)
+#define EMBEDDB_USING_COMPRESSION(x) ((x & EMBEDDB_USE_COMPRESSION) > 0 ? 1 : 0)
+#define EMBEDDB_USING_ZONE_MAP(x) ((x & EMBEDDB_USE_ZONE_MAP) > 0 ? 1 : 0)
+#define EMBEDDB_USING_BITMAP_BUCKETS(x) ((x & EMBEDDB_USE_BITMAP_BUCKETS) > 0 ? 1 : 0)
+#define EMBEDDB_USING_VALUE_INDEX(x) ((x & EMBEDDB_USE_VALUE_INDEX) > 0 ? 1 : 0)
+
+/* Methods used to find the data page for a key. Selected with the parameter flags during init */
+#define EMBEDDB_SEARCH_ESTIMATE 0 /* Binary search starting from a page estimated with the average key difference */
+#define EMBEDDB_SEARCH_BINARY 1   /* Binary search over all data pages */
+#define EMBEDDB_SEARCH_SPLINE 2   /* Spline, with a radix table if EMBEDDB_USE_RADIX is set */
 
 /* Offsets with header */
 #define EMBEDDB_COUNT_OFFSET 4
@@ -90,6 +117,8 @@ typedef uint16_t count_t;
 #define EMBEDDB_GET_MIN_DATA(x, y) ((void *)((int8_t *)x + EMBEDDB_MIN_OFFSET + y->keySize * 2))
 #define EMBEDDB_GET_MAX_DATA(x, y) ((void *)((int8_t *)x + EMBEDDB_MIN_OFFSET + y->keySize * 2 + y->dataSize))
 
+#define EMBEDDB_GET_SUM(x, y) ((void *)((int8_t *)x + EMBEDDB_MIN_OFFSET + (EMBEDDB_USING_MAX_MIN(y->parameters) ? y->keySize * 2 + y->dataSize * 2 : 0)))
+
 #define EMBEDDB_DATA_WRITE_BUFFER 0
 #define EMBEDDB_DATA_READ_BUFFER 1
 #define EMBEDDB_INDEX_WRITE_BUFFER 2
@@ -97,6 +126,16 @@ typedef uint16_t count_t;
 #define EMBEDDB_VAR_WRITE_BUFFER(x) ((x & EMBEDDB_USE_INDEX) ? 4 : 2)
 #define EMBEDDB_VAR_READ_BUFFER(x) ((x & EMBEDDB_USE_INDEX) ? 5 : 3)
 
+/* Number of buffer pages reserved for the fixed read/write buffers. Any pages past these can be used by the buffer pool. */
+#define EMBEDDB_NUM_FIXED_BUFFERS(x) (2 + ((x & EMBEDDB_USE_INDEX) ? 2 : 0) + ((x & EMBEDDB_USE_VDATA) ? 2 : 0))
+
+/* File identifiers used to tag the pages held in the buffer pool */
+#define EMBEDDB_DATA_FILE 0
+#define EMBEDDB_INDEX_FILE 1
+#define EMBEDDB_VAR_FILE 2
+#define EMBEDDB_VALUE_INDEX_FILE 3
+#define EMBEDDB_NUM_FILES 4
+
 #define EMBEDDB_FILE_MODE_W_PLUS_B 0  // Open file as read/write, creates file if doesn't exist, overwrites if it does. aka "w+b"
 #define EMBEDDB_FILE_MODE_R_PLUS_B 1  // Open file as read/write, file must exist, keeps data if it does. aka "r+b"
 
@@ -175,16 +214,162 @@ typedef struct {
      * @return	1 for success and 0 for failure
      */
     int8_t (*flush)(void *file);
+
+    /**
+     * @brief	Optional. Lends a pointer to a page held in memory by the file so it can be read without a copy
+     * @param	pageNum		Page number to lend. Is treated as an offset from the beginning of the file
+     * @param	pageSize	Number of bytes in a page
+     * @param	file		The file data that was stored in embedDBState->dataFile etc
+     * @return	Pointer to the page that stays valid until the file is closed, or NULL if the page cannot be lent. Set the function pointer to NULL if not supported
+     */
+    void *(*borrow)(uint32_t pageNum, uint32_t pageSize, void *file);
+
+    /**
+     * @brief	Optional. Reads consecutive pages with one request to storage
+     * @param	buffers		Pre-allocated space for each page, one pointer per page
+     * @param	pageNum		Page number of the first page. Is treated as an offset from the beginning of the file
+     * @param	numPages	Number of consecutive pages to read
+     * @param	pageSize	Number of bytes in a page
+     * @param	file		The file to read from. This is the file data that was stored in embedDBState->dataFile etc
+     * @return	Number of pages read, starting from the first page. 0 for failure. Set the function pointer to NULL if not supported
+     */
+    uint32_t (*readMany)(void **buffers, uint32_t pageNum, uint32_t numPages, uint32_t pageSize, void *file);
+
+    /**
+     * @brief	Optional. Writes a single page made of a header followed by data from a separate buffer, so neither has to be copied into a page first
+     * @param	header		The first headerSize bytes of the page
+     * @param	headerSize	Number of bytes in header
+     * @param	data		The remaining pageSize - headerSize bytes of the page
+     * @param	pageNum		Page number to write. Is treated as an offset from the beginning of the file
+     * @param	pageSize	Number of bytes in a page
+     * @param	file		The file data that was stored in embedDBState->dataFile etc
+     * @return	1 for success and 0 for failure. Set the function pointer to NULL if not supported
+     */
+    int8_t (*writeGather)(void *header, uint32_t headerSize, void *data, uint32_t pageNum, uint32_t pageSize, void *file);
 } embedDBFileInterface;
 
+/**
+ * @brief	Describes a page held in one frame of the buffer pool
+ */
+typedef struct {
+    id_t pageId;        /* Physical page id held in the frame. UINT32_MAX if the frame is empty */
+    uint8_t fileType;   /* File the page belongs to (EMBEDDB_DATA_FILE, EMBEDDB_INDEX_FILE or EMBEDDB_VAR_FILE) */
+    uint8_t referenced; /* Clock reference bit. Cleared as the clock hand passes, set on every hit */
+} embedDBBufferFrame;
+
+/**
+ * @brief	Page cache shared by the data, index and variable data read paths. Uses the pages of embedDBState->buffer past the fixed read/write buffers and clock replacement.
+ */
+typedef struct {
+    void *pages;                /* Start of the pool pages inside embedDBState->buffer */
+    embedDBBufferFrame *frames; /* Descriptor for each pool page */
+    uint16_t numFrames;         /* Number of pages in the pool */
+    uint16_t clockHand;         /* Next frame to be considered for replacement */
+} embedDBBufferPool;
+
+/* Operations timed by the statistics. Used to index embedDBStats->operations and embedDBStats->latency */
+#define EMBEDDB_STATS_PUT 0
+#define EMBEDDB_STATS_GET 1
+#define EMBEDDB_STATS_NEXT 2
+#define EMBEDDB_STATS_FLUSH 3
+#define EMBEDDB_STATS_PUT_BATCH 4
+#define EMBEDDB_STATS_GET_MANY 5
+#define EMBEDDB_STATS_NUM_OPS 6
+
+/* Buckets of a latency histogram. Bucket 0 counts operations taking 0 ticks, bucket i counts those taking less than 2^i ticks, and the last bucket counts the rest */
+#define EMBEDDB_STATS_LATENCY_BUCKETS 24
+
+/**
+ * @brief	Clock used to time operations. Returns ticks in any unit, such as microseconds since start up. May wrap around
+ */
+typedef uint32_t (*embedDBClock)(void);
+
+/**
+ * @brief	Called with each record after embedDBPut, embedDBPutVar or embedDBPutBatch inserts it, for example to keep a rollup up to date
+ * @param	context	Pointer given to embedDBSetInsertListener
+ * @return	0 if success. Any other value is kept in insertListenerError of the state. The insert still returns 0 as the record stays inserted
+ */
+typedef int8_t (*embedDBInsertListener)(void *context, void *key, void *data);
+
+/**
+ * @brief	Page counts for one file
+ */
+typedef struct {
+    uint32_t reads;      /* Pages read from storage */
+    uint32_t writes;     /* Pages written to storage */
+    uint32_t bufferHits; /* Pages found in a buffer or the buffer pool instead of being read */
+    uint32_t erases;     /* Number of times the oldest pages were erased to make room */
+    uint32_t wraps;      /* Number of times writing wrapped around to the first physical page */
+} embedDBFileStats;
+
+/**
+ * @brief	Latencies of one operation, in clock ticks
+ */
+typedef struct {
+    uint32_t count;                                    /* Number of operations timed */
+    uint64_t totalTicks;                               /* Sum of the ticks of every timed operation */
+    uint32_t maxTicks;                                 /* Ticks of the slowest operation */
+    uint32_t histogram[EMBEDDB_STATS_LATENCY_BUCKETS]; /* Number of operations in each bucket */
+} embedDBLatencyStats;
+
+/**
+ * @brief	Statistics of an embedDB state. Read with embedDBGetStats and cleared with embedDBResetStats
+ */
+typedef struct {
+    embedDBFileStats files[EMBEDDB_NUM_FILES];          /* Page counts indexed by EMBEDDB_DATA_FILE, EMBEDDB_INDEX_FILE, EMBEDDB_VAR_FILE and EMBEDDB_VALUE_INDEX_FILE */
+    uint32_t operations[EMBEDDB_STATS_NUM_OPS];         /* Number of calls of each operation, whether timed or not. Puts and gets also count each record of embedDBPutBatch and each key of embedDBGetMany */
+    uint32_t getPagesProbed;                            /* Data pages read or checked in a buffer while finding the page of a key with embedDBGet or embedDBGetMany */
+    uint32_t getMaxPagesProbed;                         /* Most data pages probed to find the page of one key */
+    uint64_t getModelTicks;                             /* Ticks embedDBGet spent estimating the page with the spline. Only counted with a clock */
+    uint64_t getProbeTicks;                             /* Ticks embedDBGet spent reading and checking pages to find the page. Only counted with a clock */
+    uint64_t getRecordTicks;                            /* Ticks embedDBGet spent searching for the key in its page. Only counted with a clock */
+    uint32_t nextPagesRead;                             /* Data pages read by embedDBNext */
+    uint32_t nextPagesSkipped;                          /* Data pages embedDBNext skipped using the index bitmaps or the zone map */
+    uint32_t varPagesDirect;                            /* Variable data pages embedDBPutVarBulk wrote straight from the caller's buffer */
+    uint32_t splinePointsErased;                        /* Spline points removed because their data pages were erased */
+    uint32_t splinePoints;                              /* Spline points in use. Set by embedDBGetStats */
+    uint32_t splineMaxError;                            /* Maximum page error of the spline. Set by embedDBGetStats */
+    uint32_t splineBytes;                               /* Memory used by the spline and radix table. Set by embedDBGetStats */
+    embedDBLatencyStats latency[EMBEDDB_STATS_NUM_OPS]; /* Latency of each operation. Only counted with a clock */
+} embedDBStats;
+
+/* Largest number of buckets of a bitmap built from bucket boundaries. One bucket for each bit of a 64 bit bitmap */
+#define EMBEDDB_MAX_BITMAP_BUCKETS 64
+
+/**
+ * @brief	Bucket boundaries of the bitmap when using EMBEDDB_USE_BITMAP_BUCKETS. Bucket i holds the values larger than boundaries[i - 1] and up to boundaries[i].
+ * 			The last bucket holds the values larger than every boundary.
+ */
+typedef struct {
+    int32_t boundaries[EMBEDDB_MAX_BITMAP_BUCKETS - 1]; /* Ascending upper bound of each bucket except the last */
+    uint8_t numBuckets;                                 /* Number of buckets, at most 8 * bitmapSize. 0 to learn the boundaries from the first numSamplePages data pages */
+    uint8_t columnOffset;                               /* Offset in the data of the int32_t column the bitmap is built on */
+    uint16_t numSamplePages;                            /* Number of data pages sampled to learn the boundaries. Only used when numBuckets is 0 */
+} embedDBBitmapBuckets;
+
+/* Largest number of reader handles that can be open on one embedDB state at a time */
+#define EMBEDDB_MAX_READERS 4
+
+/**
+ * @brief	Oldest pages the snapshot of a reader handle may still read. The writer does not erase them until the reader takes a newer snapshot or is closed.
+ */
+typedef struct {
+    uint32_t inUse;      /* 1 if a reader handle owns the slot */
+    id_t minDataPageId;  /* Oldest data page of the snapshot. UINT32_MAX if the reader holds no snapshot */
+    id_t minIndexPageId; /* Oldest index page of the snapshot. UINT32_MAX if the reader holds no snapshot */
+} embedDBSnapshotPin;
+
 typedef struct {
     void *dataFile;                                                       /* File for storing data records. */
     void *indexFile;                                                      /* File for storing index records. */
     void *varFile;                                                        /* File for storing variable length data. */
+    void *checkpointFile;                                                 /* File for storing recovery checkpoints. Only used with EMBEDDB_USE_CHECKPOINT */
+    void *valueIndexFile;                                                 /* File for storing the value index. Only used with EMBEDDB_USE_VALUE_INDEX */
     embedDBFileInterface *fileInterface;                                  /* Interface to the file storage */
     uint32_t numDataPages;                                                /* The number of pages will use for storing fixed records*/
     uint32_t numIndexPages;                                               /* The number of pages will use for storing the data index */
     uint32_t numVarPages;                                                 /* The number of pages will use for storing variable data */
+    uint32_t numValueIndexPages;                                          /* The number of pages will use for storing the value index. Only used with EMBEDDB_USE_VALUE_INDEX */
     count_t eraseSizeInPages;                                             /* Erase size in pages */
     uint32_t numAvailDataPages;                                           /* Number of writable data pages left before needing to delete */
     uint32_t numAvailIndexPages;                                          /* Number of writable index pages left before needing to delete */
@@ -200,13 +385,19 @@ typedef struct {
     spline *spl;                                                          /* Spline model */
     uint32_t numSplinePoints;                                             /* Number of spline points to allocate */
     radixspline *rdix;                                                    /* Radix Spline search model */
+    uint8_t radixBits;                                                    /* Number of bits indexed by the radix table. Only used with EMBEDDB_USE_RADIX */
+    uint8_t searchMethod;                                                 /* Method used to find data pages. One of EMBEDDB_SEARCH_* (calculated during init()) */
     int32_t indexMaxError;                                                /* Max error for indexing structure (Spline or PGM) */
-    int8_t bufferSizeInBlocks;                                            /* Size of buffer in blocks */
+    uint16_t bufferSizeInBlocks;                                          /* Size of buffer in blocks */
     count_t pageSize;                                                     /* Size of physical page on device */
-    int8_t parameters;                                                    /* Parameter flags for indexing and bitmaps */
+    uint32_t parameters;                                                  /* Parameter flags for indexing and bitmaps */
     int8_t keySize;                                                       /* Size of key in bytes (fixed-size records) */
     int8_t dataSize;                                                      /* Size of data in bytes (fixed-size records). Do not include space for variable size records if you are using them. */
     int8_t recordSize;                                                    /* Size of record in bytes (fixed-size records) */
+    uint8_t numDataColumns;                                               /* Number of columns the data is split into on a page. Only used with EMBEDDB_USE_PAX or EMBEDDB_USE_COMPRESSION. 0 stores the data as one column */
+    int8_t *dataColumnSizes;                                              /* Size of each data column in bytes. Negative sizes are treated as positive so schema column sizes can be used. Only used with EMBEDDB_USE_PAX or EMBEDDB_USE_COMPRESSION */
+    uint8_t sumColumnOffset;                                              /* Offset in the data of the integer column summed on each page. Only used with EMBEDDB_USE_SUM */
+    int8_t sumColumnSize;                                                 /* Size of the summed column in bytes: 1, 2, 4 or 8. Negative for a signed column, like schema column sizes. Only used with EMBEDDB_USE_SUM */
     int8_t headerSize;                                                    /* Size of header in bytes (calculated during init()) */
     int8_t variableDataHeaderSize;                                        /* Size of page header in variable data files (calculated during init()) */
     int8_t bitmapSize;                                                    /* Size of bitmap in bytes */
@@ -220,6 +411,11 @@ typedef struct {
     void (*buildBitmapFromRange)(void *minData, void *maxData, void *bm); /* Given a record, builds bitmap based on its data (key) value */
     void (*updateBitmap)(void *data, void *bm);                           /* Given a record, updates bitmap based on its data (key) value */
     int8_t (*inBitmap)(void *data, void *bm);                             /* Returns 1 if data (key) value is a valid value given the bitmap */
+    embedDBBitmapBuckets *bitmapBuckets;                                  /* Bucket boundaries used instead of the bitmap functions. Learned boundaries are written back here. Only used with EMBEDDB_USE_BITMAP_BUCKETS */
+    int32_t *bitmapSample;                                                /* Values sampled to learn the bucket boundaries. NULL once the boundaries are known */
+    uint32_t numBitmapSamples;                                            /* Number of values in bitmapSample */
+    uint8_t valueIndexColumnOffset;                                       /* Offset in the data of the int32_t column the value index is built on. Only used with EMBEDDB_USE_VALUE_INDEX */
+    void *valueIndex;                                                     /* Page summaries and buffers of the value index. NULL if not using EMBEDDB_USE_VALUE_INDEX */
     uint64_t minKey;                                                      /* Minimum key */
     uint64_t maxKey;                                                      /* Maximum key */
     int32_t maxError;                                                     /* Maximum key error */
@@ -229,11 +425,38 @@ typedef struct {
     id_t numIdxReads;                                                     /* Number of index page reads */
     id_t bufferHits;                                                      /* Number of pages returned from buffer rather than storage */
     id_t bufferedPageId;                                                  /* Page id currently in read buffer */
+    void *dataReadBuffer;                                                 /* Data page last read. Either the data read buffer, a page lent by fileInterface->borrow or the decompressed page */
+    void *dataWriteBuffer;                                                /* Data page records are inserted into. The first page of the buffer unless pages are compressed */
+    void *dataDecompressBuffer;                                           /* Data page last read, decompressed. Only used with EMBEDDB_USE_COMPRESSION */
+    uint32_t compressedPageBits;                                          /* Bits the records of the write buffer take once compressed. Only used with EMBEDDB_USE_COMPRESSION */
     id_t bufferedIndexPageId;                                             /* Index page id currently in index read buffer */
     id_t bufferedVarPage;                                                 /* Variable page id currently in variable read buffer */
+    embedDBBufferPool *bufferPool;                                        /* Page cache using the buffer pages past the fixed buffers. NULL if not using EMBEDDB_USE_BUFFER_POOL */
+    void *zoneMap;                                                        /* Summary of the data pages of each index page, used by iterators to skip whole index pages. NULL if not using EMBEDDB_USE_ZONE_MAP */
     uint8_t recordHasVarData;                                             /* Internal flag to signal that the record currently being written has var data */
+    uint32_t checkpointInterval;                                          /* Number of data pages written between checkpoints. 0 to only checkpoint on embedDBFlush. Only used with EMBEDDB_USE_CHECKPOINT */
+    uint32_t checkpointSequence;                                          /* Sequence number of the next checkpoint written */
+    uint32_t snapshotSequence;                                            /* Odd while an insert or flush changes the state that readers take snapshots of */
+    uint32_t snapshotWaiting;                                             /* Number of readers that could not take a snapshot in SNAPSHOT_RETRIES tries. The writer waits a bounded time for them before its next change */
+    embedDBSnapshotPin snapshotPins[EMBEDDB_MAX_READERS];                 /* Pages held by the snapshot of each reader handle */
+    embedDBStats stats;                                                   /* Counters and latencies split by file and operation. Cleared by embedDBResetStats */
+    embedDBClock clock;                                                   /* Clock used to time operations. NULL unless set with embedDBSetClock */
+    embedDBInsertListener insertListener;                                 /* Called with each inserted record. NULL unless set with embedDBSetInsertListener */
+    void *insertListenerContext;                                          /* Passed to insertListener */
+    int8_t insertListenerError;                                           /* Last non-zero result of insertListener. Cleared by embedDBSetInsertListener or the caller */
 } embedDBState;
 
+/**
+ * @brief	Handle for reading a consistent snapshot of an embedDB state from another thread while one writer keeps inserting into it.
+ * 			Pass &reader->view to embedDBGet, embedDBGetMany, embedDBGetRangeAggregate and the iterator functions. Only fixed-size records can be read.
+ */
+typedef struct {
+    embedDBState *writer; /* State the snapshots are taken of */
+    embedDBState view;    /* Copy of the writer state at the last snapshot. Reads go through its own read, index and write buffer copies */
+    spline viewSpline;    /* Copy of the writer spline at the last snapshot */
+    uint8_t slot;         /* Slot of the reader in writer->snapshotPins */
+} embedDBReader;
+
 typedef struct {
     uint32_t nextDataPage; /* Next data page that the iterator should read */
     uint16_t nextDataRec;  /* Next record on the data page tat the iterator should read */
@@ -242,6 +465,10 @@ typedef struct {
     void *minData;
     void *maxData;
     void *queryBitmap;
+    uint32_t lastDataPage; /* Last data page read by the iterator. Used to detect sequential reads */
+    uint8_t *valuePages;   /* Bit for each data page from valuePagesStart that holds a value in the data range, found with the value index. NULL if the value index is not used */
+    id_t valuePagesStart;  /* First data page with a bit in valuePages */
+    id_t valuePagesEnd;    /* One past the last data page with a bit in valuePages */
 } embedDBIterator;
 
 typedef struct {
@@ -251,6 +478,32 @@ typedef struct {
     uint32_t fileOffset; /* Where the iterator should start reading data next time (offset from start of file) */
 } embedDBVarDataStream;
 
+typedef struct {
+    void *page;      /* Variable data page holding the bytes */
+    uint16_t offset; /* Offset of the first byte in the page */
+    uint16_t length; /* Number of bytes */
+} embedDBVarDataSpan;
+
+typedef struct {
+    uint32_t count;  /* Number of records in the key range */
+    int64_t sum;     /* Sum of the sum column. Only set with EMBEDDB_USE_SUM */
+    float average;   /* Average of the sum column. Only set with EMBEDDB_USE_SUM */
+    void *minData;   /* Pre-allocated. Smallest data in the range according to compareData. Only set with EMBEDDB_USE_MAX_MIN. NULL to skip */
+    void *maxData;   /* Pre-allocated. Largest data in the range according to compareData. Only set with EMBEDDB_USE_MAX_MIN. NULL to skip */
+} embedDBAggregate;
+
+/* Largest number of threads embedDBParallelScan reads pages with */
+#define EMBEDDB_MAX_SCAN_WORKERS 16
+
+/**
+ * @brief	Called by embedDBParallelScan with the matching records of one data page.
+ * @param	records		Records, each the key followed by the data. Only valid during the call
+ * @param	numRecords	Number of records
+ * @param	context		Context passed to embedDBParallelScan
+ * @param	worker		Number of the worker calling, from 0 to numWorkers - 1. Calls with the same worker number never run at the same time
+ */
+typedef void (*embedDBScanFunc)(void *records, uint32_t numRecords, void *context, uint8_t worker);
+
 typedef enum {
     ITERATE_NO_MATCH = -1,
     ITERATE_MATCH = 1,
@@ -277,9 +530,37 @@ void embedDBPrintInit(embedDBState *state);
  * @param	key		Key for record
  * @param	data	Data for record
  * @return	Return 0 if success. Non-zero value if error.
+ * 			1 : Key is not larger than every key already inserted
+ * 			2 : Storage is full and the oldest pages are held by a reader snapshot. Nothing was inserted, try again once the reader moves on
  */
 int8_t embedDBPut(embedDBState *state, void *key, void *data);
 
+/**
+ * @brief	Puts an array of key, data pairs into structure.
+ * 			The batch must be in strictly ascending key order and larger than every key already inserted.
+ * 			The whole batch is inserted or, if it returns an error, nothing is. Records inserted with a batch have no variable data.
+ * @param	state		embedDB algorithm state structure
+ * @param	keys		Array of numRecords keys, each keySize bytes
+ * @param	data		Array of numRecords data values, each dataSize bytes
+ * @param	numRecords	Number of records in the batch
+ * @return	Return 0 if success. Non-zero value if error.
+ * 			1 : Keys are not in ascending order
+ * 			2 : The batch could erase pages held by a reader snapshot. With compressed pages the number of pages is estimated from the largest
+ * 			    compressed record, so a batch that would just fit can be rejected. Smaller batches or embedDBPut can then insert the records
+ */
+int8_t embedDBPutBatch(embedDBState *state, void *keys, void *data, uint32_t numRecords);
+
+/**
+ * @brief	Sets equi-depth bucket boundaries so each bucket holds about the same number of the sample values.
+ * 			Repeated values are kept in one bucket, so fewer buckets than requested may be used.
+ * @param	buckets		Bucket boundaries to set. The columnOffset is not changed
+ * @param	values		Sample values. Sorted in place
+ * @param	numValues	Number of sample values
+ * @param	numBuckets	Number of buckets wanted. At most EMBEDDB_MAX_BITMAP_BUCKETS
+ * @return	Return 0 if success, -1 if there are no values or the number of buckets is not supported.
+ */
+int8_t embedDBLearnBitmapBuckets(embedDBBitmapBuckets *buckets, int32_t *values, uint32_t numValues, uint8_t numBuckets);
+
 /**
  * @brief	Puts the given key, data, and variable length data into the structure.
  * @param	state			embedDB algorithm state structure
@@ -287,10 +568,23 @@ int8_t embedDBPut(embedDBState *state, void *key, void *data);
  * @param	data			Data for record
  * @param	variableData	Variable length data for record
  * @param	length			Length of the variable length data in bytes
- * @return	Return 0 if success. Non-zero value if error.
+ * @return	Return 0 if success. Non-zero value if error. Returns 2 without inserting if storage is full and the oldest pages are held by a reader snapshot.
  */
 int8_t embedDBPutVar(embedDBState *state, void *key, void *data, void *variableData, uint32_t length);
 
+/**
+ * @brief	Puts the given key, data, and large variable length data into the structure. Variable data pages that the data fills completely are
+ * 			written straight from @c variableData instead of being copied through the variable data write buffer. The bytes just before each
+ * 			of those pages are overwritten with the page header during the write and restored before returning.
+ * @param	state			embedDB algorithm state structure
+ * @param	key				Key for record
+ * @param	data			Data for record
+ * @param	variableData	Variable length data for record. Must be writable and not read by another thread during the call
+ * @param	length			Length of the variable length data in bytes
+ * @return	Return 0 if success. Non-zero value if error.
+ */
+int8_t embedDBPutVarBulk(embedDBState *state, void *key, void *data, void *variableData, uint32_t length);
+
 /**
  * @brief	Given a key, returns data associated with key.
  * 			Note: Space for data must be already allocated.
@@ -302,6 +596,31 @@ int8_t embedDBPutVar(embedDBState *state, void *key, void *data, void *variableD
  */
 int8_t embedDBGet(embedDBState *state, void *key, void *data);
 
+/**
+ * @brief	Given an array of keys in ascending order, returns the data associated with each key.
+ * 			Each data page is searched for only once, and every key on that page is resolved before moving on.
+ * 			Note: Space for data must be already allocated.
+ * @param	state	embedDB algorithm state structure
+ * @param	keys	Array of numKeys keys in ascending order
+ * @param	data	Pre-allocated memory for numKeys data values. Data for keys that are not found is left unchanged
+ * @param	found	Pre-allocated array of numKeys flags. Set to 1 if the key was found, 0 if not
+ * @param	numKeys	Number of keys to look up
+ * @return	Return number of keys found, -1 if the keys are not in ascending order.
+ */
+int32_t embedDBGetMany(embedDBState *state, void *keys, void *data, int8_t *found, uint32_t numKeys);
+
+/**
+ * @brief	Computes the count, sum, average, min and max of the records in a key range.
+ * 			Only the pages at the ends of the range are searched record by record. Pages entirely inside the range are added from their summary
+ * 			in the index record when using EMBEDDB_USE_INDEX, or from the page header otherwise.
+ * @param	state	embedDB algorithm state structure
+ * @param	minKey	Smallest key of the range. NULL for no lower bound
+ * @param	maxKey	Largest key of the range. NULL for no upper bound
+ * @param	result	Return variable for the aggregates. minData and maxData must be set before the call
+ * @return	Return 0 if success, -1 if a page failed to read.
+ */
+int8_t embedDBGetRangeAggregate(embedDBState *state, void *minKey, void *maxKey, embedDBAggregate *result);
+
 /**
  * @brief	Given a key, returns data associated with key.
  * 			Data is copied from database into data buffer.
@@ -315,6 +634,18 @@ int8_t embedDBGet(embedDBState *state, void *key, void *data);
  */
 int8_t embedDBGetVar(embedDBState *state, void *key, void *data, embedDBVarDataStream **varData);
 
+/**
+ * @brief	Given a key, returns data associated with key and sets up a caller-owned stream for its variable data, so nothing is allocated.
+ * @param	state	embedDB algorithm state structure
+ * @param	key		Key for record
+ * @param	data	Pre-allocated memory to copy data for record
+ * @param	varData	Pre-allocated stream to set up. Its totalBytes is 0 if there is no variable data
+ * @return	Return 0 if success. Non-zero value if error.
+ * 			-1 : Error reading file
+ * 			1  : Variable data was deleted to make room for newer data
+ */
+int8_t embedDBGetVarInto(embedDBState *state, void *key, void *data, embedDBVarDataStream *varData);
+
 /**
  * @brief	Initialize iterator on embedDB structure.
  * @param	state	embedDB algorithm state structure
@@ -338,6 +669,55 @@ void embedDBCloseIterator(embedDBIterator *it);
  */
 int8_t embedDBNext(embedDBState *state, embedDBIterator *it, void *key, void *data);
 
+/**
+ * @brief	Moves an iterator forward to the first record with a key greater than or equal to the given key, so the next call to embedDBNext returns it if it matches the iterator query.
+ * 			The data page is found with the search method of the state, such as the spline or radix spline, without reading the pages in between.
+ * 			Seeking to a key the iterator has already passed does nothing.
+ * @param	state	embedDB algorithm state structure
+ * @param	it		embedDB iterator state structure
+ * @param	key		Key to move to
+ * @return	Return 0 if success, -1 if a data page could not be read.
+ */
+int8_t embedDBIteratorSeek(embedDBState *state, embedDBIterator *it, void *key);
+
+/**
+ * @brief	Return the next run of records for iterator without copying them out of the page buffer.
+ * 			Every record in the range [begin, end) matches the iterator query. Use embedDBGetColumn to find the fields of the records.
+ * 			The records are only valid until the next call to embedDB.
+ * @param	state	embedDB algorithm state structure
+ * @param	it		embedDB iterator state structure
+ * @param	records	Return variable for a pointer to the first record of the page
+ * @param	begin	Return variable for the index of the first matching record
+ * @param	end		Return variable for one past the index of the last matching record
+ * @return	1 if successful, 0 if no more records
+ */
+int8_t embedDBNextPage(embedDBState *state, embedDBIterator *it, void **records, count_t *begin, count_t *end);
+
+/**
+ * @brief	Return a column of the records returned by embedDBNextPage. The column value of record i is at the returned pointer + i * stride.
+ * 			With EMBEDDB_USE_PAX the values of a column are next to each other on the page, so only the bytes of the column are read.
+ * @param	state	embedDB algorithm state structure
+ * @param	records	Records returned by embedDBNextPage
+ * @param	offset	Offset of the column in a record, where the key starts at 0 and the data at keySize
+ * @param	stride	Return variable for the number of bytes between the column values of consecutive records
+ * @return	Pointer to the column value of the first record of the page
+ */
+void *embedDBGetColumn(embedDBState *state, void *records, uint16_t offset, uint16_t *stride);
+
+/**
+ * @brief	Reads the records matching an iterator with several threads. The data pages from the start page of the iterator are split into chunks
+ * 			of consecutive pages that the workers take in turn, so a worker that finishes early takes more chunks. Each worker reads
+ * 			through its own buffers and skips pages with the bitmap index and zone map. Records are passed to func a page at a time, not in key order.
+ * 			The file interface read must be safe to call from several threads, like the POSIX file interface. The state must not be changed during the scan.
+ * @param	state		embedDB algorithm state structure
+ * @param	it			Iterator initialized with embedDBInitIterator. Its filters are used by every worker. It is not advanced
+ * @param	numWorkers	Number of workers, including the calling thread. At most EMBEDDB_MAX_SCAN_WORKERS. Only the calling thread is used where threads are not available
+ * @param	func		Function called with each page of matching records
+ * @param	context		Passed to func
+ * @return	Return 0 if success, -1 if a page failed to read or the worker buffers could not be allocated.
+ */
+int8_t embedDBParallelScan(embedDBState *state, embedDBIterator *it, uint8_t numWorkers, embedDBScanFunc func, void *context);
+
 /**
  * @brief	Return next key, data, variable data set for iterator
  * @param	state	embedDB algorithm state structure
@@ -349,6 +729,17 @@ int8_t embedDBNext(embedDBState *state, embedDBIterator *it, void *key, void *da
  */
 int8_t embedDBNextVar(embedDBState *state, embedDBIterator *it, void *key, void *data, embedDBVarDataStream **varData);
 
+/**
+ * @brief	Return next key, data, variable data set for iterator. Sets up a caller-owned stream for the variable data, so the same stream can be reused for every record without allocating.
+ * @param	state	embedDB algorithm state structure
+ * @param	it		embedDB iterator state structure
+ * @param	key		Return variable for key (Pre-allocated)
+ * @param	data	Return variable for data (Pre-allocated)
+ * @param	varData	Pre-allocated stream to set up. Its totalBytes is 0 if the record has no variable data or it was overwritten
+ * @return	1 if successful, 0 if no more records
+ */
+int8_t embedDBNextVarInto(embedDBState *state, embedDBIterator *it, void *key, void *data, embedDBVarDataStream *varData);
+
 /**
  * @brief	Reads data from variable data stream into the given buffer.
  * @param	state	embedDB algorithm state structure
@@ -359,12 +750,35 @@ int8_t embedDBNextVar(embedDBState *state, embedDBIterator *it, void *key, void
  */
 uint32_t embedDBVarDataStreamRead(embedDBState *state, embedDBVarDataStream *stream, void *buffer, uint32_t length);
 
+/**
+ * @brief	Returns the next bytes of a variable data stream as spans of the pages holding them, so they can be used without being copied.
+ * 			With a file interface that lends pages, such as the mmap interface, the spans point into the file and stay valid until it is closed.
+ * 			Otherwise they point into the buffer pool, at most half the pool per call, or without a pool into the variable data read buffer,
+ * 			one span per call, and stay valid until the next read of the state.
+ * @param	state		embedDB algorithm state structure
+ * @param	stream		Variable data stream. Moved past the bytes of the returned spans
+ * @param	spans		Pre-allocated array of spans to fill
+ * @param	maxSpans	Number of spans in @c spans
+ * @return	Number of spans filled. 0 once the stream has been read or if a page could not be read
+ */
+uint32_t embedDBVarDataStreamSpans(embedDBState *state, embedDBVarDataStream *stream, embedDBVarDataSpan *spans, uint32_t maxSpans);
+
 /**
  * @brief	Flushes output buffer.
  * @param	state	embedDB algorithm state structure
+ * @return	Return 0 if success. Non-zero value if a file failed to flush or 2 if the write would erase pages held by a reader snapshot.
  */
 int8_t embedDBFlush(embedDBState *state);
 
+/**
+ * @brief	Writes a checkpoint of the data, index and variable data cursors and the spline to the checkpoint file.
+ * 			Recovery loads the newest valid checkpoint and only reads the pages written after it.
+ * 			Checkpoints alternate between two slots in the file so a torn write leaves the previous one intact.
+ * @param	state	embedDB algorithm state structure
+ * @return	Return 0 if success. Non-zero value if error.
+ */
+int8_t embedDBCheckpoint(embedDBState *state);
+
 /**
  * @brief	Reads given page from storage.
  * @param	state	embedDB algorithm state structure
@@ -413,6 +827,27 @@ id_t writeIndexPage(embedDBState *state, void *buffer);
  */
 id_t writeVariablePage(embedDBState *state, void *buffer);
 
+/**
+ * @brief	Opens a reader handle on a state and takes its first snapshot. The state must be initialized and use a file interface whose read can be called from several threads at once.
+ * @param	state	embedDB state structure written by one thread
+ * @param	reader	Reader handle to set up
+ * @return	Return 0 if success. Non-zero value if every reader slot is in use or the buffers could not be allocated.
+ */
+int8_t embedDBInitReader(embedDBState *state, embedDBReader *reader);
+
+/**
+ * @brief	Replaces the snapshot of a reader with the current state of the writer. Can be called while the writer inserts without any locking.
+ * 			Iterators initialized on the old snapshot must not be used afterwards.
+ * @param	reader	Reader handle
+ */
+void embedDBSnapshot(embedDBReader *reader);
+
+/**
+ * @brief	Releases the snapshot of a reader so the writer can erase its pages, and frees the reader buffers.
+ * @param	reader	Reader handle
+ */
+void embedDBCloseReader(embedDBReader *reader);
+
 /**
  * @brief	Prints statistics.
  * @param	state	embedDB state structure
@@ -425,6 +860,36 @@ void embedDBPrintStats(embedDBState *state);
  */
 void embedDBResetStats(embedDBState *state);
 
+/**
+ * @brief	Copies the statistics of a state and fills in the current spline size and error.
+ * @param	state	embedDB state structure
+ * @param	stats	Return variable for the statistics
+ */
+void embedDBGetStats(embedDBState *state, embedDBStats *stats);
+
+/**
+ * @brief	Sets the clock used to time put, get, next and flush. Timing is off until a clock is set and can be turned off again with NULL.
+ * @param	state	embedDB state structure after embedDBInit
+ * @param	clock	Function returning the current tick count, or NULL
+ */
+void embedDBSetClock(embedDBState *state, embedDBClock clock);
+
+/**
+ * @brief	Sets the function called with each record once it is inserted. Only one listener can be set and NULL removes it. Clears insertListenerError.
+ * @param	state		embedDB state structure after embedDBInit
+ * @param	listener	Function called with each inserted record, or NULL
+ * @param	context		Pointer passed to the listener
+ */
+void embedDBSetInsertListener(embedDBState *state, embedDBInsertListener listener, void *context);
+
+/**
+ * @brief	Estimates a latency percentile from a histogram.
+ * @param	latency		Latencies of an operation
+ * @param	percentile	Percentile between 0 and 100
+ * @return	Upper bound in ticks of the histogram bucket holding the percentile, at most the slowest operation. 0 if nothing was timed.
+ */
+uint32_t embedDBLatencyPercentile(embedDBLatencyStats *latency, uint8_t percentile);
+
 /**
  * @brief	Closes structure and frees any dynamic space.
  * @param	state	embedDB state structure
@@ -0,0 +1,440 @@
+/******************************************************************************/
+/**
+ * @file        shardManager.c
+ * @author      EmbedDB Team (See Authors.md)
+ * @brief       Sharding layer that spreads records over several EmbedDB instances
+ *              and merges the results of queries over all of them in key order.
+ * @copyright   Copyright 2024
+ *              EmbedDB Team
+ * @par Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *
+ * @par 1.Redistributions of source code must retain the above copyright notice,
+ *  this list of conditions and the following disclaimer.
+ *
+ * @par 2.Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ *
+ * @par 3.Neither the name of the copyright holder nor the names of its contributors
+ *  may be used to endorse or promote products derived from this software without
+ *  specific prior written permission.
+ *
+ * @par THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+/******************************************************************************/
+
+#include "shardManager.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <pthread.h>
+#define SHARD_USE_THREADS 1
+#else
+#define SHARD_USE_THREADS 0
+#endif
+
+/* Work done on one shard. Tasks over different shards are independent, so they can run on their own threads */
+typedef struct shardTask {
+    void (*run)(struct shardTask *task);
+    embedDBShardManager *manager;
+    uint8_t shard;                /* Shard the task works on */
+    void *keys;                   /* Keys of the task, or the key of a get */
+    void *data;                   /* Data of the task, or the memory a get copies the data to */
+    uint32_t numRecords;          /* Number of records of a batch */
+    embedDBShardCursor *cursor;   /* Cursor to refill */
+    int8_t result;                /* Result of the task. 0 if success */
+} shardTask;
+
+#if SHARD_USE_THREADS
+static void *shardTaskThread(void *arg) {
+    shardTask *task = (shardTask *)arg;
+    task->run(task);
+    return NULL;
+}
+#endif
+
+/**
+ * @brief	Runs the tasks, each on its own thread if the manager is parallel. A task whose thread cannot be started is run on the calling thread.
+ * @param	manager		Shard manager
+ * @param	tasks		Tasks to run
+ * @param	numTasks	Number of tasks
+ */
+static void shardRunTasks(embedDBShardManager *manager, shardTask *tasks, uint8_t numTasks) {
+#if SHARD_USE_THREADS
+    if (manager->parallel && numTasks > 1) {
+        pthread_t threads[EMBEDDB_MAX_SHARDS];
+        int8_t started[EMBEDDB_MAX_SHARDS];
+        for (uint8_t i = 0; i < numTasks; i++)
+            started[i] = pthread_create(&threads[i], NULL, shardTaskThread, &tasks[i]) == 0;
+        for (uint8_t i = 0; i < numTasks; i++) {
+            if (started[i])
+                pthread_join(threads[i], NULL);
+            else
+                tasks[i].run(&tasks[i]);
+        }
+        return;
+    }
+#endif
+    for (uint8_t i = 0; i < numTasks; i++)
+        tasks[i].run(&tasks[i]);
+}
+
+/* Returns the first non-zero result of the tasks */
+static int8_t shardTasksResult(shardTask *tasks, uint8_t numTasks) {
+    for (uint8_t i = 0; i < numTasks; i++) {
+        if (tasks[i].result != 0)
+            return tasks[i].result;
+    }
+    return 0;
+}
+
+static void shardPutBatchTask(shardTask *task) {
+    task->result = embedDBPutBatch(task->manager->shards[task->shard], task->keys, task->data, task->numRecords);
+}
+
+static void shardGetTask(shardTask *task) {
+    task->result = embedDBGet(task->manager->shards[task->shard], task->keys, task->data);
+}
+
+static void shardFlushTask(shardTask *task) {
+    task->result = embedDBFlush(task->manager->shards[task->shard]);
+}
+
+/**
+ * @brief	Moves the records not merged yet to the front of the buffer and reads records from the shard until the buffer is full or the shard has no more.
+ */
+static void shardFillTask(shardTask *task) {
+    embedDBState *state = task->manager->shards[task->shard];
+    embedDBShardCursor *cursor = task->cursor;
+    uint32_t recordSize = state->keySize + state->dataSize;
+    uint32_t numLeft = cursor->numRecords - cursor->next;
+    memmove(cursor->records, cursor->records + cursor->next * recordSize, numLeft * recordSize);
+    cursor->numRecords = numLeft;
+    cursor->next = 0;
+    while (cursor->numRecords < EMBEDDB_SHARD_BUFFER_RECORDS) {
+        int8_t *record = cursor->records + cursor->numRecords * recordSize;
+        if (!embedDBNext(state, &cursor->it, record, record + state->keySize)) {
+            cursor->done = 1;
+            break;
+        }
+        cursor->numRecords++;
+    }
+    task->result = 0;
+}
+
+/* FNV-1a hash of the bytes of the hashed column */
+static uint32_t shardHashColumn(embedDBShardManager *manager, void *data) {
+    uint8_t *column = (uint8_t *)data + manager->hashColumnOffset;
+    uint32_t hash = 2166136261u;
+    for (uint8_t i = 0; i < manager->hashColumnSize; i++) {
+        hash ^= column[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/* Returns the shard a key belongs to. Only used with key range and time window routing */
+static uint8_t shardForKey(embedDBShardManager *manager, void *key) {
+    embedDBState *state = manager->shards[0];
+    if (manager->routing == EMBEDDB_SHARD_BY_TIME_WINDOW) {
+        uint64_t keyValue = 0;
+        memcpy(&keyValue, key, state->keySize);
+        return (uint8_t)(keyValue / manager->windowSize % manager->numShards);
+    }
+    uint8_t shard = 0;
+    while (shard < manager->numShards - 1 && state->compareKey(key, (int8_t *)manager->boundaries + shard * state->keySize) >= 0)
+        shard++;
+    return shard;
+}
+
+/* Returns the shard a record is put into */
+static uint8_t shardForRecord(embedDBShardManager *manager, void *key, void *data) {
+    if (manager->routing == EMBEDDB_SHARD_BY_HASH)
+        return (uint8_t)(shardHashColumn(manager, data) % manager->numShards);
+    return shardForKey(manager, key);
+}
+
+int8_t embedDBShardInit(embedDBShardManager *manager) {
+    manager->getBuffer = NULL;
+    if (manager->shards == NULL || manager->numShards == 0 || manager->numShards > EMBEDDB_MAX_SHARDS) {
+#ifdef PRINT_ERRORS
+        printf("ERROR: Shard manager needs between 1 and %d shards.\n", EMBEDDB_MAX_SHARDS);
+#endif
+        return -1;
+    }
+    embedDBState *first = manager->shards[0];
+    for (uint8_t i = 0; i < manager->numShards; i++) {
+        embedDBState *state = manager->shards[i];
+        if (state == NULL || state->keySize != first->keySize || state->dataSize != first->dataSize || state->compareKey != first->compareKey) {
+#ifdef PRINT_ERRORS
+            printf("ERROR: Every shard must have the same key size, data size and key comparator.\n");
+#endif
+            return -1;
+        }
+    }
+
+    int8_t validRouting = 0;
+    if (manager->routing == EMBEDDB_SHARD_BY_KEY_RANGE)
+        validRouting = manager->numShards == 1 || manager->boundaries != NULL;
+    else if (manager->routing == EMBEDDB_SHARD_BY_TIME_WINDOW)
+        validRouting = manager->windowSize > 0;
+    else if (manager->routing == EMBEDDB_SHARD_BY_HASH)
+        validRouting = manager->hashColumnSize > 0 && manager->hashColumnOffset + manager->hashColumnSize <= first->dataSize;
+    if (!validRouting) {
+#ifdef PRINT_ERRORS
+        printf("ERROR: Shard routing needs key range boundaries, a time window size or a hash column inside the data.\n");
+#endif
+        return -1;
+    }
+
+    if (manager->routing == EMBEDDB_SHARD_BY_HASH) {
+        manager->getBuffer = malloc((size_t)manager->numShards * first->dataSize);
+        if (manager->getBuffer == NULL) {
+#ifdef PRINT_ERRORS
+            printf("ERROR: Failed to allocate the get buffer of the shard manager.\n");
+#endif
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int8_t embedDBShardPut(embedDBShardManager *manager, void *key, void *data) {
+    return embedDBPut(manager->shards[shardForRecord(manager, key, data)], key, data);
+}
+
+int8_t embedDBShardPutBatch(embedDBShardManager *manager, void *keys, void *data, uint32_t numRecords) {
+    if (numRecords == 0)
+        return 0;
+    uint8_t keySize = manager->shards[0]->keySize;
+    uint8_t dataSize = manager->shards[0]->dataSize;
+    uint8_t *recordShard = malloc(numRecords);
+    if (recordShard == NULL)
+        return -1;
+
+    uint32_t counts[EMBEDDB_MAX_SHARDS] = {0};
+    for (uint32_t i = 0; i < numRecords; i++) {
+        recordShard[i] = shardForRecord(manager, (int8_t *)keys + (size_t)i * keySize, (int8_t *)data + (size_t)i * dataSize);
+        counts[recordShard[i]]++;
+    }
+
+    /* All records of one shard need no copy */
+    if (counts[recordShard[0]] == numRecords) {
+        int8_t result = embedDBPutBatch(manager->shards[recordShard[0]], keys, data, numRecords);
+        free(recordShard);
+        return result;
+    }
+
+    int8_t *shardKeys = malloc((size_t)numRecords * keySize);
+    int8_t *shardData = malloc((size_t)numRecords * dataSize);
+    if (shardKeys == NULL || shardData == NULL) {
+        free(recordShard);
+        free(shardKeys);
+        free(shardData);
+        return -1;
+    }
+
+    /* Stable split of the records by shard, so each part stays in ascending key order */
+    shardTask tasks[EMBEDDB_MAX_SHARDS];
+    uint32_t offsets[EMBEDDB_MAX_SHARDS];
+    uint8_t numTasks = 0;
+    uint32_t offset = 0;
+    for (uint8_t s = 0; s < manager->numShards; s++) {
+        offsets[s] = offset;
+        if (counts[s] > 0) {
+            shardTask *task = &tasks[numTasks++];
+            task->run = shardPutBatchTask;
+            task->manager = manager;
+            task->shard = s;
+            task->keys = shardKeys + (size_t)offset * keySize;
+            task->data = shardData + (size_t)offset * dataSize;
+            task->numRecords = counts[s];
+            task->result = 0;
+        }
+        offset += counts[s];
+    }
+    for (uint32_t i = 0; i < numRecords; i++) {
+        uint32_t position = offsets[recordShard[i]]++;
+        memcpy(shardKeys + (size_t)position * keySize, (int8_t *)keys + (size_t)i * keySize, keySize);
+        memcpy(shardData + (size_t)position * dataSize, (int8_t *)data + (size_t)i * dataSize, dataSize);
+    }
+
+    shardRunTasks(manager, tasks, numTasks);
+    free(recordShard);
+    free(shardKeys);
+    free(shardData);
+    return shardTasksResult(tasks, numTasks);
+}
+
+int8_t embedDBShardGet(embedDBShardManager *manager, void *key, void *data) {
+    if (manager->routing != EMBEDDB_SHARD_BY_HASH)
+        return embedDBGet(manager->shards[shardForKey(manager, key)], key, data);
+
+    /* Any shard may hold the key. Shards that are empty or only hold smaller keys are not searched */
+    shardTask tasks[EMBEDDB_MAX_SHARDS];
+    uint8_t numTasks = 0;
+    for (uint8_t s = 0; s < manager->numShards; s++) {
+        embedDBState *state = manager->shards[s];
+        if (state->minKey == UINT32_MAX || state->compareKey(key, &state->maxKey) > 0)
+            continue;
+        if (!manager->parallel) {
+            if (embedDBGet(state, key, data) == 0)
+                return 0;
+            continue;
+        }
+        shardTask *task = &tasks[numTasks++];
+        task->run = shardGetTask;
+        task->manager = manager;
+        task->shard = s;
+        task->keys = key;
+        task->data = (int8_t *)manager->getBuffer + (size_t)s * state->dataSize;
+        task->result = -1;
+    }
+    shardRunTasks(manager, tasks, numTasks);
+    for (uint8_t i = 0; i < numTasks; i++) {
+        if (tasks[i].result == 0) {
+            memcpy(data, tasks[i].data, manager->shards[0]->dataSize);
+            return 0;
+        }
+    }
+    return -1;
+}
+
+int8_t embedDBShardFlush(embedDBShardManager *manager) {
+    shardTask tasks[EMBEDDB_MAX_SHARDS];
+    for (uint8_t s = 0; s < manager->numShards; s++) {
+        tasks[s].run = shardFlushTask;
+        tasks[s].manager = manager;
+        tasks[s].shard = s;
+        tasks[s].result = 0;
+    }
+    shardRunTasks(manager, tasks, manager->numShards);
+    return shardTasksResult(tasks, manager->numShards);
+}
+
+/* Returns 1 if the key range of a shard with key range routing overlaps the key filter of the iterator */
+static int8_t shardInKeyFilter(embedDBShardManager *manager, embedDBShardIterator *it, uint8_t shard) {
+    if (manager->routing != EMBEDDB_SHARD_BY_KEY_RANGE)
+        return 1;
+    embedDBState *state = manager->shards[0];
+    if (it->maxKey != NULL && shard > 0 && state->compareKey(it->maxKey, (int8_t *)manager->boundaries + (shard - 1) * state->keySize) < 0)
+        return 0;
+    if (it->minKey != NULL && shard < manager->numShards - 1 && state->compareKey(it->minKey, (int8_t *)manager->boundaries + shard * state->keySize) >= 0)
+        return 0;
+    return 1;
+}
+
+int8_t embedDBShardInitIterator(embedDBShardManager *manager, embedDBShardIterator *it) {
+    uint32_t recordSize = manager->shards[0]->keySize + manager->shards[0]->dataSize;
+    for (uint8_t s = 0; s < manager->numShards; s++) {
+        embedDBShardCursor *cursor = &it->cursors[s];
+        cursor->numRecords = 0;
+        cursor->next = 0;
+        cursor->done = 1;
+        cursor->records = NULL;
+    }
+    for (uint8_t s = 0; s < manager->numShards; s++) {
+        if (!shardInKeyFilter(manager, it, s))
+            continue;
+        embedDBShardCursor *cursor = &it->cursors[s];
+        cursor->records = malloc((size_t)EMBEDDB_SHARD_BUFFER_RECORDS * recordSize);
+        if (cursor->records == NULL) {
+#ifdef PRINT_ERRORS
+            printf("ERROR: Failed to allocate the buffer of a shard iterator.\n");
+#endif
+            embedDBShardCloseIterator(manager, it);
+            return -1;
+        }
+        cursor->it.minKey = it->minKey;
+        cursor->it.maxKey = it->maxKey;
+        cursor->it.minData = it->minData;
+        cursor->it.maxData = it->maxData;
+        embedDBInitIterator(manager->shards[s], &cursor->it);
+        cursor->done = 0;
+    }
+    return 0;
+}
+
+int8_t embedDBShardNext(embedDBShardManager *manager, embedDBShardIterator *it, void *key, void *data) {
+    embedDBState *state = manager->shards[0];
+    uint32_t recordSize = state->keySize + state->dataSize;
+
+    /* Once a shard has no buffered records every shard past half its buffer is refilled with it, so the shards are read together */
+    int8_t needFill = 0;
+    for (uint8_t s = 0; s < manager->numShards; s++) {
+        embedDBShardCursor *cursor = &it->cursors[s];
+        if (!cursor->done && cursor->next == cursor->numRecords)
+            needFill = 1;
+    }
+    if (needFill) {
+        shardTask tasks[EMBEDDB_MAX_SHARDS];
+        uint8_t numTasks = 0;
+        for (uint8_t s = 0; s < manager->numShards; s++) {
+            embedDBShardCursor *cursor = &it->cursors[s];
+            if (cursor->done || cursor->numRecords - cursor->next > EMBEDDB_SHARD_BUFFER_RECORDS / 2)
+                continue;
+            shardTask *task = &tasks[numTasks++];
+            task->run = shardFillTask;
+            task->manager = manager;
+            task->shard = s;
+            task->cursor = cursor;
+        }
+        shardRunTasks(manager, tasks, numTasks);
+    }
+
+    /* K-way merge. The number of shards is small, so the smallest buffered key is found with a scan */
+    int8_t *smallest = NULL;
+    embedDBShardCursor *smallestCursor = NULL;
+    for (uint8_t s = 0; s < manager->numShards; s++) {
+        embedDBShardCursor *cursor = &it->cursors[s];
+        if (cursor->next == cursor->numRecords)
+            continue;
+        int8_t *record = cursor->records + cursor->next * recordSize;
+        if (smallest == NULL || state->compareKey(record, smallest) < 0) {
+            smallest = record;
+            smallestCursor = cursor;
+        }
+    }
+    if (smallest == NULL)
+        return 0;
+    memcpy(key, smallest, state->keySize);
+    memcpy(data, smallest + state->keySize, state->dataSize);
+    smallestCursor->next++;
+    return 1;
+}
+
+void embedDBShardCloseIterator(embedDBShardManager *manager, embedDBShardIterator *it) {
+    for (uint8_t s = 0; s < manager->numShards; s++) {
+        embedDBShardCursor *cursor = &it->cursors[s];
+        if (cursor->records == NULL)
+            continue;
+        embedDBCloseIterator(&cursor->it);
+        free(cursor->records);
+        cursor->records = NULL;
+        cursor->numRecords = 0;
+        cursor->next = 0;
+        cursor->done = 1;
+    }
+}
+
+void embedDBShardClose(embedDBShardManager *manager) {
+    for (uint8_t s = 0; s < manager->numShards; s++)
+        embedDBClose(manager->shards[s]);
+    free(manager->getBuffer);
+    manager->getBuffer = NULL;
+}
@@ -0,0 +1,176 @@
+/******************************************************************************/
+/**
+ * @file        shardManager.h
+ * @author      EmbedDB Team (See Authors.md)
+ * @brief       Sharding layer that spreads records over several EmbedDB instances
+ *              and merges the results of queries over all of them in key order.
+ * @copyright   Copyright 2024
+ *              EmbedDB Team
+ * @par Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *
+ * @par 1.Redistributions of source code must retain the above copyright notice,
+ *  this list of conditions and the following disclaimer.
+ *
+ * @par 2.Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ *
+ * @par 3.Neither the name of the copyright holder nor the names of its contributors
+ *  may be used to endorse or promote products derived from this software without
+ *  specific prior written permission.
+ *
+ * @par THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+/******************************************************************************/
+
+#ifndef embedDB_SHARD_MANAGER_H_
+#define embedDB_SHARD_MANAGER_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#include "embedDB.h"
+
+#define EMBEDDB_SHARD_BY_KEY_RANGE 0   /* Each shard holds one range of keys */
+#define EMBEDDB_SHARD_BY_TIME_WINDOW 1 /* Consecutive windows of keys are given to the shards in turn */
+#define EMBEDDB_SHARD_BY_HASH 2        /* Records go to the shard picked by a hash of one data column */
+
+#define EMBEDDB_MAX_SHARDS 16
+
+/* Number of records each shard iterator reads ahead of the merge */
+#ifndef EMBEDDB_SHARD_BUFFER_RECORDS
+#define EMBEDDB_SHARD_BUFFER_RECORDS 128
+#endif
+
+/**
+ * @brief	Set of embedDB instances that are used as one. Every shard is its own embedDBState with its own files and buffers,
+ * 			so each shard keeps the ascending key order embedDBPut requires while the set can be written and read from one thread per shard.
+ */
+typedef struct {
+    embedDBState **shards;    /* Shards, each initialized by the caller with embedDBInit. All must have the same key size, data size and compareKey */
+    uint8_t numShards;        /* Number of shards. At most EMBEDDB_MAX_SHARDS */
+    uint8_t routing;          /* EMBEDDB_SHARD_BY_KEY_RANGE, EMBEDDB_SHARD_BY_TIME_WINDOW or EMBEDDB_SHARD_BY_HASH */
+    void *boundaries;         /* Key range routing. numShards - 1 ascending keys. Shard i holds the keys from boundary i - 1 up to but not including boundary i */
+    uint64_t windowSize;      /* Time window routing. Width of a window in key units. Window key / windowSize goes to shard window % numShards */
+    uint8_t hashColumnOffset; /* Hash routing. Offset in bytes of the hashed column in the data */
+    uint8_t hashColumnSize;   /* Hash routing. Size in bytes of the hashed column */
+    int8_t parallel;          /* 1 to work on the shards from one thread each. Ignored where threads are not available */
+    void *getBuffer;          /* Data found by each shard in a parallel get with hash routing. Allocated by embedDBShardInit */
+} embedDBShardManager;
+
+/**
+ * @brief	Records of one shard read ahead by a shard iterator.
+ */
+typedef struct {
+    embedDBIterator it;  /* Iterator over the shard */
+    int8_t *records;     /* Buffered records, each the key followed by the data. NULL if the shard is not iterated */
+    uint32_t numRecords; /* Number of records in the buffer */
+    uint32_t next;       /* Buffer position of the next record to merge */
+    int8_t done;         /* 1 once the shard iterator has returned every record */
+} embedDBShardCursor;
+
+typedef struct {
+    void *minKey;
+    void *maxKey;
+    void *minData;
+    void *maxData;
+    embedDBShardCursor cursors[EMBEDDB_MAX_SHARDS]; /* Cursor of each shard */
+} embedDBShardIterator;
+
+/**
+ * @brief	Checks the shard configuration and allocates the space it needs. The shards must already be initialized.
+ * @param	manager	Shard manager with the shards and routing set
+ * @return	Return 0 if success. Non-zero value if error.
+ */
+int8_t embedDBShardInit(embedDBShardManager *manager);
+
+/**
+ * @brief	Puts a key, data pair into the shard it is routed to.
+ * 			Keys only need to be ascending within each shard, so with time window and hash routing each shard receives its own time-ordered stream.
+ * @param	manager	Shard manager
+ * @param	key		Key for record
+ * @param	data	Data for record
+ * @return	Return 0 if success. Otherwise the result of embedDBPut on the shard.
+ */
+int8_t embedDBShardPut(embedDBShardManager *manager, void *key, void *data);
+
+/**
+ * @brief	Puts an array of key, data pairs into the shards. The records are split by shard, keeping their order,
+ * 			and each part is inserted with embedDBPutBatch. With parallel set every shard is written from its own thread.
+ * @param	manager		Shard manager
+ * @param	keys		Array of numRecords keys, each keySize bytes
+ * @param	data		Array of numRecords data values, each dataSize bytes
+ * @param	numRecords	Number of records in the batch
+ * @return	Return 0 if success. -1 if out of memory. Otherwise the first non-zero result of embedDBPutBatch.
+ * 			The shards that did not fail keep their records.
+ */
+int8_t embedDBShardPutBatch(embedDBShardManager *manager, void *keys, void *data, uint32_t numRecords);
+
+/**
+ * @brief	Given a key, returns data associated with key. With key range and time window routing only the shard of the key is searched.
+ * 			With hash routing every shard that may hold the key is searched, in parallel if parallel is set.
+ * @param	manager	Shard manager
+ * @param	key		Key for record
+ * @param	data	Pre-allocated memory to copy data for record
+ * @return	Return 0 if success. Non-zero value if error.
+ */
+int8_t embedDBShardGet(embedDBShardManager *manager, void *key, void *data);
+
+/**
+ * @brief	Flushes the write buffers of every shard.
+ * @param	manager	Shard manager
+ * @return	Return 0 if success. Otherwise the first non-zero result of embedDBFlush.
+ */
+int8_t embedDBShardFlush(embedDBShardManager *manager);
+
+/**
+ * @brief	Initialize an iterator over every shard. The minKey, maxKey, minData and maxData filters of the iterator are used for each shard.
+ * 			With key range routing shards outside the key filter are not read.
+ * @param	manager	Shard manager
+ * @param	it		Shard iterator with the filters set
+ * @return	Return 0 if success. Non-zero value if out of memory.
+ */
+int8_t embedDBShardInitIterator(embedDBShardManager *manager, embedDBShardIterator *it);
+
+/**
+ * @brief	Return the next record of all shards in ascending key order. Shard iterators are read ahead in batches,
+ * 			from one thread each if parallel is set, and merged.
+ * @param	manager	Shard manager
+ * @param	it		Shard iterator
+ * @param	key		Pre-allocated memory for the key
+ * @param	data	Pre-allocated memory for the data
+ * @return	1 if a record was returned, 0 if there are no more records.
+ */
+int8_t embedDBShardNext(embedDBShardManager *manager, embedDBShardIterator *it, void *key, void *data);
+
+/**
+ * @brief	Close a shard iterator and free its buffers.
+ * @param	manager	Shard manager
+ * @param	it		Shard iterator
+ */
+void embedDBShardCloseIterator(embedDBShardManager *manager, embedDBShardIterator *it);
+
+/**
+ * @brief	Closes every shard with embedDBClose and frees the space of the manager. Files and buffers of the shards are left to the caller.
+ * @param	manager	Shard manager
+ */
+void embedDBShardClose(embedDBShardManager *manager);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -36,6 +36,11 @@
  */
 /******************************************************************************/
 
+/* Needed for O_DIRECT in the POSIX file functions */
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
 #include "utilityFunctions.h"
 
 #include <string.h>
@@ -334,12 +339,27 @@ int8_t FILE_READ(void *buffer, uint32_t pageNum, uint32_t pageSize, void *file)
     return fread(buffer, pageSize, 1, fileInfo->file);
 }
 
+uint32_t FILE_READ_MANY(void **buffers, uint32_t pageNum, uint32_t numPages, uint32_t pageSize, void *file) {
+    FILE_INFO *fileInfo = (FILE_INFO *)file;
+    fseek(fileInfo->file, pageSize * pageNum, SEEK_SET);
+    uint32_t numRead = 0;
+    while (numRead < numPages && fread(buffers[numRead], pageSize, 1, fileInfo->file) == 1)
+        numRead++;
+    return numRead;
+}
+
 int8_t FILE_WRITE(void *buffer, uint32_t pageNum, uint32_t pageSize, void *file) {
     FILE_INFO *fileInfo = (FILE_INFO *)file;
     fseek(fileInfo->file, pageNum * pageSize, SEEK_SET);
     return fwrite(buffer, pageSize, 1, fileInfo->file);
 }
 
+int8_t FILE_WRITE_GATHER(void *header, uint32_t headerSize, void *data, uint32_t pageNum, uint32_t pageSize, void *file) {
+    FILE_INFO *fileInfo = (FILE_INFO *)file;
+    fseek(fileInfo->file, pageNum * pageSize, SEEK_SET);
+    return fwrite(header, headerSize, 1, fileInfo->file) == 1 && fwrite(data, pageSize - headerSize, 1, fileInfo->file) == 1;
+}
+
 int8_t FILE_CLOSE(void *file) {
     FILE_INFO *fileInfo = (FILE_INFO *)file;
     fclose(fileInfo->file);
@@ -377,5 +397,691 @@ embedDBFileInterface *getFileInterface() {
     fileInterface->write = FILE_WRITE;
     fileInterface->open = FILE_OPEN;
     fileInterface->flush = FILE_FLUSH;
+    fileInterface->borrow = NULL;
+    fileInterface->readMany = FILE_READ_MANY;
+    fileInterface->writeGather = FILE_WRITE_GATHER;
+    return fileInterface;
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+typedef struct {
+    char *filename;
+    int fd;
+    int8_t *map;       /* Mapping of the whole file. NULL until the file is opened */
+    uint32_t mapSize;  /* Largest size the file can grow to */
+    uint32_t fileSize; /* Number of bytes currently in the file */
+} MMAP_FILE_INFO;
+
+void *setupMmapFile(char *filename, uint32_t numPages, uint32_t pageSize) {
+    MMAP_FILE_INFO *fileInfo = malloc(sizeof(MMAP_FILE_INFO));
+    int nameLen = strlen(filename);
+    fileInfo->filename = calloc(1, nameLen + 1);
+    memcpy(fileInfo->filename, filename, nameLen);
+    fileInfo->fd = -1;
+    fileInfo->map = NULL;
+    fileInfo->mapSize = numPages * pageSize;
+    fileInfo->fileSize = 0;
+    return fileInfo;
+}
+
+int8_t MMAP_FILE_CLOSE(void *file) {
+    MMAP_FILE_INFO *fileInfo = (MMAP_FILE_INFO *)file;
+    if (fileInfo->map != NULL)
+        munmap(fileInfo->map, fileInfo->mapSize);
+    if (fileInfo->fd != -1)
+        close(fileInfo->fd);
+    fileInfo->map = NULL;
+    fileInfo->fd = -1;
+    return 1;
+}
+
+void tearDownMmapFile(void *file) {
+    MMAP_FILE_INFO *fileInfo = (MMAP_FILE_INFO *)file;
+    MMAP_FILE_CLOSE(file);
+    free(fileInfo->filename);
+    free(file);
+}
+
+int8_t MMAP_FILE_READ(void *buffer, uint32_t pageNum, uint32_t pageSize, void *file) {
+    MMAP_FILE_INFO *fileInfo = (MMAP_FILE_INFO *)file;
+    uint32_t offset = pageNum * pageSize;
+    /* Match fread and fail past the end of the file */
+    if (offset + pageSize > fileInfo->fileSize)
+        return 0;
+    memcpy(buffer, fileInfo->map + offset, pageSize);
+    return 1;
+}
+
+uint32_t MMAP_FILE_READ_MANY(void **buffers, uint32_t pageNum, uint32_t numPages, uint32_t pageSize, void *file) {
+    uint32_t numRead = 0;
+    while (numRead < numPages && MMAP_FILE_READ(buffers[numRead], pageNum + numRead, pageSize, file))
+        numRead++;
+    return numRead;
+}
+
+void *MMAP_FILE_BORROW(uint32_t pageNum, uint32_t pageSize, void *file) {
+    MMAP_FILE_INFO *fileInfo = (MMAP_FILE_INFO *)file;
+    uint32_t offset = pageNum * pageSize;
+    if (offset + pageSize > fileInfo->fileSize)
+        return NULL;
+    return fileInfo->map + offset;
+}
+
+int8_t MMAP_FILE_WRITE(void *buffer, uint32_t pageNum, uint32_t pageSize, void *file) {
+    MMAP_FILE_INFO *fileInfo = (MMAP_FILE_INFO *)file;
+    uint32_t offset = pageNum * pageSize;
+    if (offset + pageSize > fileInfo->mapSize)
+        return 0;
+    /* Grow the file before touching the mapping past its end */
+    if (offset + pageSize > fileInfo->fileSize) {
+        if (ftruncate(fileInfo->fd, offset + pageSize) != 0)
+            return 0;
+        fileInfo->fileSize = offset + pageSize;
+    }
+    memcpy(fileInfo->map + offset, buffer, pageSize);
+    return 1;
+}
+
+int8_t MMAP_FILE_WRITE_GATHER(void *header, uint32_t headerSize, void *data, uint32_t pageNum, uint32_t pageSize, void *file) {
+    MMAP_FILE_INFO *fileInfo = (MMAP_FILE_INFO *)file;
+    uint32_t offset = pageNum * pageSize;
+    if (offset + pageSize > fileInfo->mapSize)
+        return 0;
+    if (offset + pageSize > fileInfo->fileSize) {
+        if (ftruncate(fileInfo->fd, offset + pageSize) != 0)
+            return 0;
+        fileInfo->fileSize = offset + pageSize;
+    }
+    memcpy(fileInfo->map + offset, header, headerSize);
+    memcpy(fileInfo->map + offset + headerSize, data, pageSize - headerSize);
+    return 1;
+}
+
+int8_t MMAP_FILE_FLUSH(void *file) {
+    MMAP_FILE_INFO *fileInfo = (MMAP_FILE_INFO *)file;
+    if (fileInfo->fileSize == 0)
+        return 1;
+    return msync(fileInfo->map, fileInfo->fileSize, MS_ASYNC) == 0;
+}
+
+int8_t MMAP_FILE_OPEN(void *file, uint8_t mode) {
+    MMAP_FILE_INFO *fileInfo = (MMAP_FILE_INFO *)file;
+    MMAP_FILE_CLOSE(file);
+
+    if (mode == EMBEDDB_FILE_MODE_W_PLUS_B) {
+        fileInfo->fd = open(fileInfo->filename, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    } else if (mode == EMBEDDB_FILE_MODE_R_PLUS_B) {
+        fileInfo->fd = open(fileInfo->filename, O_RDWR);
+    } else {
+        return 0;
+    }
+
+    if (fileInfo->fd == -1)
+        return 0;
+
+    struct stat fileStat;
+    if (fstat(fileInfo->fd, &fileStat) != 0 || fileStat.st_size > fileInfo->mapSize) {
+        MMAP_FILE_CLOSE(file);
+        return 0;
+    }
+    fileInfo->fileSize = fileStat.st_size;
+
+    void *map = mmap(NULL, fileInfo->mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, fileInfo->fd, 0);
+    if (map == MAP_FAILED) {
+        MMAP_FILE_CLOSE(file);
+        return 0;
+    }
+    fileInfo->map = map;
+    return 1;
+}
+
+embedDBFileInterface *getMmapFileInterface() {
+    embedDBFileInterface *fileInterface = malloc(sizeof(embedDBFileInterface));
+    fileInterface->close = MMAP_FILE_CLOSE;
+    fileInterface->read = MMAP_FILE_READ;
+    fileInterface->write = MMAP_FILE_WRITE;
+    fileInterface->open = MMAP_FILE_OPEN;
+    fileInterface->flush = MMAP_FILE_FLUSH;
+    fileInterface->borrow = MMAP_FILE_BORROW;
+    fileInterface->readMany = MMAP_FILE_READ_MANY;
+    fileInterface->writeGather = MMAP_FILE_WRITE_GATHER;
+    return fileInterface;
+}
+
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+
+#include <stdint.h>
+#include <sys/uio.h>
+
+/* Buffers and file offsets are aligned to this many bytes for direct I/O */
+#define POSIX_FILE_ALIGNMENT 4096
+
+/* Largest number of pages given to a single preadv call */
+#define POSIX_FILE_MAX_IOVEC 16
+
+typedef struct {
+    char *filename;
+    int fd;
+    uint32_t pageSize;
+    int8_t direct;     /* 1 if direct I/O was requested */
+    void *alignedPage; /* Aligned page used for buffers that cannot be given to direct I/O. NULL if direct I/O is off */
+} POSIX_FILE_INFO;
+
+void *allocateAlignedBuffer(size_t size, size_t alignment) {
+    void *buffer = NULL;
+    if (posix_memalign(&buffer, alignment, size) != 0)
+        return NULL;
+    return buffer;
+}
+
+void *setupPosixFile(char *filename, uint32_t pageSize, int8_t direct) {
+    POSIX_FILE_INFO *fileInfo = malloc(sizeof(POSIX_FILE_INFO));
+    int nameLen = strlen(filename);
+    fileInfo->filename = calloc(1, nameLen + 1);
+    memcpy(fileInfo->filename, filename, nameLen);
+    fileInfo->fd = -1;
+    fileInfo->pageSize = pageSize;
+    fileInfo->direct = direct;
+    fileInfo->alignedPage = NULL;
+    return fileInfo;
+}
+
+int8_t POSIX_FILE_CLOSE(void *file) {
+    POSIX_FILE_INFO *fileInfo = (POSIX_FILE_INFO *)file;
+    if (fileInfo->fd != -1)
+        close(fileInfo->fd);
+    fileInfo->fd = -1;
+    free(fileInfo->alignedPage);
+    fileInfo->alignedPage = NULL;
+    return 1;
+}
+
+void tearDownPosixFile(void *file) {
+    POSIX_FILE_INFO *fileInfo = (POSIX_FILE_INFO *)file;
+    POSIX_FILE_CLOSE(file);
+    free(fileInfo->filename);
+    free(file);
+}
+
+/* Returns the buffer to give to the system call. Unaligned buffers go through the aligned page when using direct I/O */
+static void *posixFileTarget(POSIX_FILE_INFO *fileInfo, void *buffer) {
+    if (fileInfo->alignedPage != NULL && (uintptr_t)buffer % POSIX_FILE_ALIGNMENT != 0)
+        return fileInfo->alignedPage;
+    return buffer;
+}
+
+int8_t POSIX_FILE_READ(void *buffer, uint32_t pageNum, uint32_t pageSize, void *file) {
+    POSIX_FILE_INFO *fileInfo = (POSIX_FILE_INFO *)file;
+    void *target = posixFileTarget(fileInfo, buffer);
+    if (pread(fileInfo->fd, target, pageSize, (off_t)pageNum * pageSize) != (ssize_t)pageSize)
+        return 0;
+    if (target != buffer)
+        memcpy(buffer, target, pageSize);
+    return 1;
+}
+
+uint32_t POSIX_FILE_READ_MANY(void **buffers, uint32_t pageNum, uint32_t numPages, uint32_t pageSize, void *file) {
+    POSIX_FILE_INFO *fileInfo = (POSIX_FILE_INFO *)file;
+    uint32_t numRead = 0;
+#if defined(__linux__)
+    while (numRead < numPages) {
+        struct iovec iov[POSIX_FILE_MAX_IOVEC];
+        uint32_t numVecs = 0;
+        while (numVecs < POSIX_FILE_MAX_IOVEC && numRead + numVecs < numPages && posixFileTarget(fileInfo, buffers[numRead + numVecs]) == buffers[numRead + numVecs]) {
+            iov[numVecs].iov_base = buffers[numRead + numVecs];
+            iov[numVecs].iov_len = pageSize;
+            numVecs++;
+        }
+
+        /* A buffer that needs the aligned page is read on its own */
+        if (numVecs == 0) {
+            if (!POSIX_FILE_READ(buffers[numRead], pageNum + numRead, pageSize, file))
+                return numRead;
+            numRead++;
+            continue;
+        }
+
+        ssize_t bytesRead = preadv(fileInfo->fd, iov, numVecs, (off_t)(pageNum + numRead) * pageSize);
+        if (bytesRead <= 0)
+            return numRead;
+        numRead += bytesRead / pageSize;
+        if ((uint32_t)bytesRead < numVecs * pageSize)
+            return numRead;
+    }
+#else
+    while (numRead < numPages && POSIX_FILE_READ(buffers[numRead], pageNum + numRead, pageSize, file))
+        numRead++;
+#endif
+    return numRead;
+}
+
+int8_t POSIX_FILE_WRITE(void *buffer, uint32_t pageNum, uint32_t pageSize, void *file) {
+    POSIX_FILE_INFO *fileInfo = (POSIX_FILE_INFO *)file;
+    void *source = posixFileTarget(fileInfo, buffer);
+    if (source != buffer)
+        memcpy(source, buffer, pageSize);
+    return pwrite(fileInfo->fd, source, pageSize, (off_t)pageNum * pageSize) == (ssize_t)pageSize;
+}
+
+int8_t POSIX_FILE_WRITE_GATHER(void *header, uint32_t headerSize, void *data, uint32_t pageNum, uint32_t pageSize, void *file) {
+    POSIX_FILE_INFO *fileInfo = (POSIX_FILE_INFO *)file;
+    off_t offset = (off_t)pageNum * pageSize;
+    /* Direct I/O needs one aligned buffer, so the page is assembled in the aligned page */
+    if (fileInfo->alignedPage != NULL) {
+        memcpy(fileInfo->alignedPage, header, headerSize);
+        memcpy((int8_t *)fileInfo->alignedPage + headerSize, data, pageSize - headerSize);
+        return pwrite(fileInfo->fd, fileInfo->alignedPage, pageSize, offset) == (ssize_t)pageSize;
+    }
+#if defined(__linux__)
+    struct iovec iov[2];
+    iov[0].iov_base = header;
+    iov[0].iov_len = headerSize;
+    iov[1].iov_base = data;
+    iov[1].iov_len = pageSize - headerSize;
+    return pwritev(fileInfo->fd, iov, 2, offset) == (ssize_t)pageSize;
+#else
+    return pwrite(fileInfo->fd, header, headerSize, offset) == (ssize_t)headerSize &&
+           pwrite(fileInfo->fd, data, pageSize - headerSize, offset + headerSize) == (ssize_t)(pageSize - headerSize);
+#endif
+}
+
+int8_t POSIX_FILE_FLUSH(void *file) {
+    POSIX_FILE_INFO *fileInfo = (POSIX_FILE_INFO *)file;
+#if defined(__APPLE__)
+    return fsync(fileInfo->fd) == 0;
+#else
+    return fdatasync(fileInfo->fd) == 0;
+#endif
+}
+
+int8_t POSIX_FILE_OPEN(void *file, uint8_t mode) {
+    POSIX_FILE_INFO *fileInfo = (POSIX_FILE_INFO *)file;
+    POSIX_FILE_CLOSE(file);
+
+    int flags = O_RDWR;
+    if (mode == EMBEDDB_FILE_MODE_W_PLUS_B) {
+        flags |= O_CREAT | O_TRUNC;
+    } else if (mode != EMBEDDB_FILE_MODE_R_PLUS_B) {
+        return 0;
+    }
+
+    int8_t direct = fileInfo->direct && fileInfo->pageSize % POSIX_FILE_ALIGNMENT == 0;
+#ifdef O_DIRECT
+    if (direct)
+        fileInfo->fd = open(fileInfo->filename, flags | O_DIRECT, 0644);
+    /* Not every file system supports O_DIRECT */
+    if (fileInfo->fd == -1) {
+        direct = 0;
+        fileInfo->fd = open(fileInfo->filename, flags, 0644);
+    }
+#else
+    fileInfo->fd = open(fileInfo->filename, flags, 0644);
+#if defined(__APPLE__)
+    if (direct && fileInfo->fd != -1)
+        direct = fcntl(fileInfo->fd, F_NOCACHE, 1) != -1;
+#else
+    direct = 0;
+#endif
+#endif
+
+    if (fileInfo->fd == -1)
+        return 0;
+
+    if (direct) {
+        fileInfo->alignedPage = allocateAlignedBuffer(fileInfo->pageSize, POSIX_FILE_ALIGNMENT);
+        if (fileInfo->alignedPage == NULL) {
+            POSIX_FILE_CLOSE(file);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+embedDBFileInterface *getPosixFileInterface() {
+    embedDBFileInterface *fileInterface = malloc(sizeof(embedDBFileInterface));
+    fileInterface->close = POSIX_FILE_CLOSE;
+    fileInterface->read = POSIX_FILE_READ;
+    fileInterface->write = POSIX_FILE_WRITE;
+    fileInterface->open = POSIX_FILE_OPEN;
+    fileInterface->flush = POSIX_FILE_FLUSH;
+    fileInterface->borrow = NULL;
+    fileInterface->readMany = POSIX_FILE_READ_MANY;
+    fileInterface->writeGather = POSIX_FILE_WRITE_GATHER;
+    return fileInterface;
+}
+
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <pthread.h>
+#define WRITE_BEHIND_USE_THREADS 1
+#else
+#define WRITE_BEHIND_USE_THREADS 0
+#endif
+
+typedef struct {
+    embedDBFileInterface *fileInterface; /* Interface used to write the pages to storage */
+    void *file;                          /* File the pages are written to */
+    int8_t *pages;                       /* Copies of the pages waiting to be written, in a ring */
+    uint32_t *pageNums;                  /* Page number of each page in the ring */
+    uint32_t numPages;                   /* Number of pages the ring can hold */
+    uint32_t pageSize;                   /* Number of bytes in a page */
+    uint32_t head;                       /* Ring position of the oldest pending page. It is the page being written */
+    uint32_t count;                      /* Number of pending pages */
+    int8_t writeFailed;                  /* Set when a pending page failed to write. Reported by the next write or flush */
+    int8_t background;                   /* 1 if a thread writes the pages, 0 if they are written by writeBehindPoll */
+#if WRITE_BEHIND_USE_THREADS
+    int8_t stop;
+    pthread_t thread;
+    pthread_mutex_t ringLock; /* Protects the ring */
+    pthread_mutex_t fileLock; /* Serializes calls to the underlying file */
+    pthread_cond_t changed;   /* Signalled whenever a page is added to or removed from the ring */
+#endif
+} WRITE_BEHIND_FILE_INFO;
+
+static void writeBehindLockRing(WRITE_BEHIND_FILE_INFO *fileInfo) {
+#if WRITE_BEHIND_USE_THREADS
+    pthread_mutex_lock(&fileInfo->ringLock);
+#endif
+}
+
+static void writeBehindUnlockRing(WRITE_BEHIND_FILE_INFO *fileInfo) {
+#if WRITE_BEHIND_USE_THREADS
+    pthread_cond_broadcast(&fileInfo->changed);
+    pthread_mutex_unlock(&fileInfo->ringLock);
+#endif
+}
+
+static void writeBehindLockFile(WRITE_BEHIND_FILE_INFO *fileInfo) {
+#if WRITE_BEHIND_USE_THREADS
+    pthread_mutex_lock(&fileInfo->fileLock);
+#endif
+}
+
+static void writeBehindUnlockFile(WRITE_BEHIND_FILE_INFO *fileInfo) {
+#if WRITE_BEHIND_USE_THREADS
+    pthread_mutex_unlock(&fileInfo->fileLock);
+#endif
+}
+
+/* Writes the oldest pending page to storage. Returns 1 if a page was written and 0 if nothing was pending */
+static int8_t writeBehindWriteOldest(WRITE_BEHIND_FILE_INFO *fileInfo) {
+    writeBehindLockRing(fileInfo);
+    if (fileInfo->count == 0) {
+        writeBehindUnlockRing(fileInfo);
+        return 0;
+    }
+    /* The page stays in the ring while it is written so reads can still find it */
+    uint32_t slot = fileInfo->head;
+    writeBehindUnlockRing(fileInfo);
+
+    writeBehindLockFile(fileInfo);
+    int8_t success = fileInfo->fileInterface->write(fileInfo->pages + slot * fileInfo->pageSize, fileInfo->pageNums[slot], fileInfo->pageSize, fileInfo->file);
+    writeBehindUnlockFile(fileInfo);
+
+    writeBehindLockRing(fileInfo);
+    if (!success)
+        fileInfo->writeFailed = 1;
+    fileInfo->head = (fileInfo->head + 1) % fileInfo->numPages;
+    fileInfo->count--;
+    writeBehindUnlockRing(fileInfo);
+    return 1;
+}
+
+/* Waits until no pages are pending. Pages are written here if there is no background thread */
+static void writeBehindDrain(WRITE_BEHIND_FILE_INFO *fileInfo) {
+#if WRITE_BEHIND_USE_THREADS
+    if (fileInfo->background) {
+        pthread_mutex_lock(&fileInfo->ringLock);
+        while (fileInfo->count > 0)
+            pthread_cond_wait(&fileInfo->changed, &fileInfo->ringLock);
+        pthread_mutex_unlock(&fileInfo->ringLock);
+        return;
+    }
+#endif
+    while (writeBehindWriteOldest(fileInfo)) {
+    }
+}
+
+#if WRITE_BEHIND_USE_THREADS
+static void *writeBehindThread(void *file) {
+    WRITE_BEHIND_FILE_INFO *fileInfo = (WRITE_BEHIND_FILE_INFO *)file;
+    while (1) {
+        pthread_mutex_lock(&fileInfo->ringLock);
+        while (fileInfo->count == 0 && !fileInfo->stop)
+            pthread_cond_wait(&fileInfo->changed, &fileInfo->ringLock);
+        int8_t done = fileInfo->count == 0;
+        pthread_mutex_unlock(&fileInfo->ringLock);
+        if (done)
+            return NULL;
+        writeBehindWriteOldest(fileInfo);
+    }
+}
+#endif
+
+void *setupWriteBehindFile(embedDBFileInterface *fileInterface, void *file, uint32_t numPages, uint32_t pageSize, int8_t background) {
+    if (numPages == 0) {
+#ifdef PRINT_ERRORS
+        printf("ERROR: Write-behind file needs at least one pending page.\n");
+#endif
+        return NULL;
+    }
+#if !WRITE_BEHIND_USE_THREADS
+    if (background) {
+#ifdef PRINT_ERRORS
+        printf("ERROR: Background writes are not supported on this platform. Use writeBehindPoll.\n");
+#endif
+        return NULL;
+    }
+#endif
+
+    WRITE_BEHIND_FILE_INFO *fileInfo = malloc(sizeof(WRITE_BEHIND_FILE_INFO));
+    if (fileInfo == NULL)
+        return NULL;
+    fileInfo->pages = malloc((size_t)numPages * pageSize);
+    fileInfo->pageNums = malloc(numPages * sizeof(uint32_t));
+    if (fileInfo->pages == NULL || fileInfo->pageNums == NULL) {
+#ifdef PRINT_ERRORS
+        printf("ERROR: Failed to allocate write-behind pages.\n");
+#endif
+        free(fileInfo->pages);
+        free(fileInfo->pageNums);
+        free(fileInfo);
+        return NULL;
+    }
+    fileInfo->fileInterface = fileInterface;
+    fileInfo->file = file;
+    fileInfo->numPages = numPages;
+    fileInfo->pageSize = pageSize;
+    fileInfo->head = 0;
+    fileInfo->count = 0;
+    fileInfo->writeFailed = 0;
+    fileInfo->background = background;
+
+#if WRITE_BEHIND_USE_THREADS
+    fileInfo->stop = 0;
+    pthread_mutex_init(&fileInfo->ringLock, NULL);
+    pthread_mutex_init(&fileInfo->fileLock, NULL);
+    pthread_cond_init(&fileInfo->changed, NULL);
+    if (background && pthread_create(&fileInfo->thread, NULL, writeBehindThread, fileInfo) != 0) {
+#ifdef PRINT_ERRORS
+        printf("ERROR: Failed to start write-behind thread.\n");
+#endif
+        fileInfo->background = 0;
+        tearDownWriteBehindFile(fileInfo);
+        return NULL;
+    }
+#endif
+    return fileInfo;
+}
+
+void tearDownWriteBehindFile(void *file) {
+    WRITE_BEHIND_FILE_INFO *fileInfo = (WRITE_BEHIND_FILE_INFO *)file;
+    writeBehindDrain(fileInfo);
+#if WRITE_BEHIND_USE_THREADS
+    if (fileInfo->background) {
+        pthread_mutex_lock(&fileInfo->ringLock);
+        fileInfo->stop = 1;
+        pthread_cond_broadcast(&fileInfo->changed);
+        pthread_mutex_unlock(&fileInfo->ringLock);
+        pthread_join(fileInfo->thread, NULL);
+    }
+    pthread_mutex_destroy(&fileInfo->ringLock);
+    pthread_mutex_destroy(&fileInfo->fileLock);
+    pthread_cond_destroy(&fileInfo->changed);
+#endif
+    free(fileInfo->pages);
+    free(fileInfo->pageNums);
+    free(file);
+}
+
+int8_t writeBehindPoll(void *file) {
+    WRITE_BEHIND_FILE_INFO *fileInfo = (WRITE_BEHIND_FILE_INFO *)file;
+    /* The background thread owns the oldest page. Writing it here too could write one slot twice and skip another */
+    if (fileInfo->background)
+        return 0;
+    return writeBehindWriteOldest(fileInfo);
+}
+
+int8_t WRITE_BEHIND_READ(void *buffer, uint32_t pageNum, uint32_t pageSize, void *file) {
+    WRITE_BEHIND_FILE_INFO *fileInfo = (WRITE_BEHIND_FILE_INFO *)file;
+    writeBehindLockRing(fileInfo);
+    /* Search newest to oldest so the latest copy of a page is returned */
+    for (uint32_t i = fileInfo->count; i > 0; i--) {
+        uint32_t slot = (fileInfo->head + i - 1) % fileInfo->numPages;
+        if (fileInfo->pageNums[slot] == pageNum) {
+            memcpy(buffer, fileInfo->pages + slot * fileInfo->pageSize, pageSize);
+            writeBehindUnlockRing(fileInfo);
+            return 1;
+        }
+    }
+    writeBehindUnlockRing(fileInfo);
+
+    writeBehindLockFile(fileInfo);
+    int8_t success = fileInfo->fileInterface->read(buffer, pageNum, pageSize, fileInfo->file);
+    writeBehindUnlockFile(fileInfo);
+    return success;
+}
+
+uint32_t WRITE_BEHIND_READ_MANY(void **buffers, uint32_t pageNum, uint32_t numPages, uint32_t pageSize, void *file) {
+    WRITE_BEHIND_FILE_INFO *fileInfo = (WRITE_BEHIND_FILE_INFO *)file;
+    writeBehindLockRing(fileInfo);
+    int8_t anyPending = 0;
+    for (uint32_t i = 0; i < fileInfo->count && !anyPending; i++) {
+        uint32_t pendingPage = fileInfo->pageNums[(fileInfo->head + i) % fileInfo->numPages];
+        anyPending = pendingPage >= pageNum && pendingPage < pageNum + numPages;
+    }
+    writeBehindUnlockRing(fileInfo);
+
+    uint32_t numRead = 0;
+    if (!anyPending && fileInfo->fileInterface->readMany != NULL) {
+        writeBehindLockFile(fileInfo);
+        numRead = fileInfo->fileInterface->readMany(buffers, pageNum, numPages, pageSize, fileInfo->file);
+        writeBehindUnlockFile(fileInfo);
+        return numRead;
+    }
+
+    /* Read one page at a time so pending pages come from the ring */
+    while (numRead < numPages && WRITE_BEHIND_READ(buffers[numRead], pageNum + numRead, pageSize, file))
+        numRead++;
+    return numRead;
+}
+
+int8_t WRITE_BEHIND_WRITE(void *buffer, uint32_t pageNum, uint32_t pageSize, void *file) {
+    WRITE_BEHIND_FILE_INFO *fileInfo = (WRITE_BEHIND_FILE_INFO *)file;
+    writeBehindLockRing(fileInfo);
+    /* Only block when every pending page is in use */
+    while (fileInfo->count == fileInfo->numPages) {
+#if WRITE_BEHIND_USE_THREADS
+        if (fileInfo->background) {
+            pthread_cond_wait(&fileInfo->changed, &fileInfo->ringLock);
+            continue;
+        }
+#endif
+        writeBehindUnlockRing(fileInfo);
+        writeBehindWriteOldest(fileInfo);
+        writeBehindLockRing(fileInfo);
+    }
+
+    if (fileInfo->writeFailed) {
+        writeBehindUnlockRing(fileInfo);
+        return 0;
+    }
+
+    uint32_t slot = (fileInfo->head + fileInfo->count) % fileInfo->numPages;
+    memcpy(fileInfo->pages + slot * fileInfo->pageSize, buffer, pageSize);
+    fileInfo->pageNums[slot] = pageNum;
+    fileInfo->count++;
+    writeBehindUnlockRing(fileInfo);
+    return 1;
+}
+
+int8_t WRITE_BEHIND_FLUSH(void *file) {
+    WRITE_BEHIND_FILE_INFO *fileInfo = (WRITE_BEHIND_FILE_INFO *)file;
+    writeBehindDrain(fileInfo);
+    writeBehindLockFile(fileInfo);
+    int8_t success = fileInfo->fileInterface->flush(fileInfo->file);
+    writeBehindUnlockFile(fileInfo);
+    return success && !fileInfo->writeFailed;
+}
+
+int8_t WRITE_BEHIND_CLOSE(void *file) {
+    WRITE_BEHIND_FILE_INFO *fileInfo = (WRITE_BEHIND_FILE_INFO *)file;
+    writeBehindDrain(fileInfo);
+    writeBehindLockFile(fileInfo);
+    int8_t success = fileInfo->fileInterface->close(fileInfo->file);
+    writeBehindUnlockFile(fileInfo);
+    return success;
+}
+
+int8_t WRITE_BEHIND_OPEN(void *file, uint8_t mode) {
+    WRITE_BEHIND_FILE_INFO *fileInfo = (WRITE_BEHIND_FILE_INFO *)file;
+    writeBehindDrain(fileInfo);
+    fileInfo->writeFailed = 0;
+    writeBehindLockFile(fileInfo);
+    int8_t success = fileInfo->fileInterface->open(fileInfo->file, mode);
+    writeBehindUnlockFile(fileInfo);
+    return success;
+}
+
+void *WRITE_BEHIND_BORROW(uint32_t pageNum, uint32_t pageSize, void *file) {
+    WRITE_BEHIND_FILE_INFO *fileInfo = (WRITE_BEHIND_FILE_INFO *)file;
+    if (fileInfo->fileInterface->borrow == NULL)
+        return NULL;
+
+    /* Storage does not have the latest copy of a pending page */
+    writeBehindLockRing(fileInfo);
+    for (uint32_t i = 0; i < fileInfo->count; i++) {
+        if (fileInfo->pageNums[(fileInfo->head + i) % fileInfo->numPages] == pageNum) {
+            writeBehindUnlockRing(fileInfo);
+            return NULL;
+        }
+    }
+    writeBehindUnlockRing(fileInfo);
+
+    writeBehindLockFile(fileInfo);
+    void *page = fileInfo->fileInterface->borrow(pageNum, pageSize, fileInfo->file);
+    writeBehindUnlockFile(fileInfo);
+    return page;
+}
+
+embedDBFileInterface *getWriteBehindFileInterface() {
+    embedDBFileInterface *fileInterface = malloc(sizeof(embedDBFileInterface));
+    fileInterface->close = WRITE_BEHIND_CLOSE;
+    fileInterface->read = WRITE_BEHIND_READ;
+    fileInterface->write = WRITE_BEHIND_WRITE;
+    fileInterface->open = WRITE_BEHIND_OPEN;
+    fileInterface->flush = WRITE_BEHIND_FLUSH;
+    fileInterface->borrow = WRITE_BEHIND_BORROW;
+    fileInterface->readMany = WRITE_BEHIND_READ_MANY;
+    fileInterface->writeGather = NULL;
     return fileInterface;
 }
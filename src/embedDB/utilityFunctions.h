@@ -68,6 +68,28 @@ embedDBFileInterface *getFileInterface();
 void *setupFile(char *filename);
 void tearDownFile(void *file);
 
+#if defined(__unix__) || defined(__APPLE__)
+/* Memory mapped file functions. numPages is the largest number of pages the file can hold */
+embedDBFileInterface *getMmapFileInterface();
+void *setupMmapFile(char *filename, uint32_t numPages, uint32_t pageSize);
+void tearDownMmapFile(void *file);
+
+/* POSIX file functions using pread and pwrite. With direct set and pageSize a multiple of 4096, the
+ * operating system's page cache is bypassed (O_DIRECT or F_NOCACHE) */
+embedDBFileInterface *getPosixFileInterface();
+void *setupPosixFile(char *filename, uint32_t pageSize, int8_t direct);
+void tearDownPosixFile(void *file);
+void *allocateAlignedBuffer(size_t size, size_t alignment);
+#endif
+
+/* Write-behind file functions. Wraps another file so that full pages are queued and written later.
+ * With background set a thread writes the queued pages, otherwise call writeBehindPoll between inserts.
+ * writeBehindPoll returns 1 if it wrote a page, and 0 if nothing was pending or the file has a background thread. */
+embedDBFileInterface *getWriteBehindFileInterface();
+void *setupWriteBehindFile(embedDBFileInterface *fileInterface, void *file, uint32_t numPages, uint32_t pageSize, int8_t background);
+void tearDownWriteBehindFile(void *file);
+int8_t writeBehindPoll(void *file);
+
 #ifdef __cplusplus
 }
 #endif
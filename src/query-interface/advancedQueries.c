@@ -118,6 +118,13 @@ int8_t exec(embedDBOperator* operator) {
     return operator->next(operator);
 }
 
+/* State of a table scan. The bounds buffer holds the iterator bounds written by predicate pushdown */
+typedef struct {
+    embedDBState* state;
+    embedDBIterator* it;
+    void* bounds;
+} tableScanState;
+
 void initTableScan(embedDBOperator* operator) {
     if (operator->input != NULL) {
 #ifdef PRINT_ERRORS
@@ -139,7 +146,7 @@ void initTableScan(embedDBOperator* operator) {
     }
 
     // Check that the provided key schema matches what is in the state
-    embedDBState* embedDBstate = (embedDBState*)(((void**)operator->state)[0]);
+    embedDBState* embedDBstate = ((tableScanState*)operator->state)->state;
     if (operator->schema->columnSizes[0] <= 0 || abs(operator->schema->columnSizes[0]) != embedDBstate->keySize) {
 #ifdef PRINT_ERRORS
         printf("ERROR: Make sure the the key column is at index 0 of the schema initialization and that it matches the keySize in the state and is unsigned\n");
@@ -155,7 +162,7 @@ void initTableScan(embedDBOperator* operator) {
 
     // Init buffer
     if (operator->recordBuffer == NULL) {
-        operator->recordBuffer = createBufferFromSchema(operator->schema);
+        operator->recordBuffer = createBufferFromSchemaInArena(operator->arena, operator->schema);
         if (operator->recordBuffer == NULL) {
 #ifdef PRINT_ERRORS
             printf("ERROR: Failed to allocate buffer for TableScan operator\n");
@@ -175,8 +182,8 @@ int8_t nextTableScan(embedDBOperator* operator) {
     }
 
     // Get next record
-    embedDBState* state = (embedDBState*)(((void**)operator->state)[0]);
-    embedDBIterator* it = (embedDBIterator*)(((void**)operator->state)[1]);
+    embedDBState* state = ((tableScanState*)operator->state)->state;
+    embedDBIterator* it = ((tableScanState*)operator->state)->it;
     if (!embedDBNext(state, it, operator->recordBuffer, (int8_t*)operator->recordBuffer + state->keySize)) {
         return 0;
     }
@@ -186,9 +193,11 @@ int8_t nextTableScan(embedDBOperator* operator) {
 
 void closeTableScan(embedDBOperator* operator) {
     embedDBFreeSchema(&operator->schema);
-    free(operator->recordBuffer);
+    embedDBArenaFree(operator->arena, operator->recordBuffer);
     operator->recordBuffer = NULL;
-    free(operator->state);
+    if (operator->state != NULL)
+        embedDBArenaFree(operator->arena, ((tableScanState*)operator->state)->bounds);
+    embedDBArenaFree(operator->arena, operator->state);
     operator->state = NULL;
 }
 
@@ -207,7 +216,7 @@ embedDBOperator* createTableScanOperator(embedDBState* state, embedDBIterator* i
         return NULL;
     }
 
-    embedDBOperator* operator= malloc(sizeof(embedDBOperator));
+    embedDBOperator* operator= embedDBCreateOperator();
     if (operator== NULL) {
 #ifdef PRINT_ERRORS
         printf("ERROR: malloc failed while creating TableScan operator\n");
@@ -215,17 +224,19 @@ embedDBOperator* createTableScanOperator(embedDBState* state, embedDBIterator* i
         return NULL;
     }
 
-    operator->state = malloc(2 * sizeof(void*));
-    if (operator->state == NULL) {
+    tableScanState* scanState = embedDBQueryMalloc(sizeof(tableScanState));
+    if (scanState == NULL) {
 #ifdef PRINT_ERRORS
         printf("ERROR: malloc failed while creating TableScan operator\n");
 #endif
         return NULL;
     }
-    memcpy(operator->state, &state, sizeof(void*));
-    memcpy((int8_t*)operator->state + sizeof(void*), &it, sizeof(void*));
+    scanState->state = state;
+    scanState->it = it;
+    scanState->bounds = NULL;
+    operator->state = scanState;
 
-    operator->schema = copySchema(baseSchema);
+    operator->schema = copySchemaInArena(operator->arena, baseSchema);
     operator->input = NULL;
     operator->recordBuffer = NULL;
 
@@ -254,18 +265,10 @@ void initProjection(embedDBOperator* operator) {
 
     // Init output schema
     if (operator->schema == NULL) {
-        operator->schema = malloc(sizeof(embedDBSchema));
+        operator->schema = allocateSchemaInArena(operator->arena, numCols);
         if (operator->schema == NULL) {
 #ifdef PRINT_ERRORS
             printf("ERROR: Failed to allocate space for projection schema\n");
-#endif
-            return;
-        }
-        operator->schema->numCols = numCols;
-        operator->schema->columnSizes = malloc(numCols * sizeof(int8_t));
-        if (operator->schema->columnSizes == NULL) {
-#ifdef PRINT_ERRORS
-            printf("ERROR: Failed to allocate space for projection while building schema\n");
 #endif
             return;
         }
@@ -276,7 +279,7 @@ void initProjection(embedDBOperator* operator) {
 
     // Init output buffer
     if (operator->recordBuffer == NULL) {
-        operator->recordBuffer = createBufferFromSchema(operator->schema);
+        operator->recordBuffer = createBufferFromSchemaInArena(operator->arena, operator->schema);
         if (operator->recordBuffer == NULL) {
 #ifdef PRINT_ERRORS
             printf("ERROR: Failed to allocate buffer for TableScan operator\n");
@@ -315,9 +318,9 @@ void closeProjection(embedDBOperator* operator) {
     operator->input->close(operator->input);
 
     embedDBFreeSchema(&operator->schema);
-    free(operator->state);
+    embedDBArenaFree(operator->arena, operator->state);
     operator->state = NULL;
-    free(operator->recordBuffer);
+    embedDBArenaFree(operator->arena, operator->recordBuffer);
     operator->recordBuffer = NULL;
 }
 
@@ -340,7 +343,7 @@ embedDBOperator* createProjectionOperator(embedDBOperator* input, uint8_t numCol
         lastCol = cols[i];
     }
     // Create state
-    uint8_t* state = malloc(numCols + 1);
+    uint8_t* state = embedDBQueryMalloc(numCols + 1);
     if (state == NULL) {
 #ifdef PRINT_ERRORS
         printf("ERROR: malloc failed while creating Projection operator\n");
@@ -350,7 +353,7 @@ embedDBOperator* createProjectionOperator(embedDBOperator* input, uint8_t numCol
     state[0] = numCols;
     memcpy(state + 1, cols, numCols);
 
-    embedDBOperator* operator= malloc(sizeof(embedDBOperator));
+    embedDBOperator* operator= embedDBCreateOperator();
     if (operator== NULL) {
 #ifdef PRINT_ERRORS
         printf("ERROR: malloc failed while creating Projection operator\n");
@@ -369,6 +372,88 @@ embedDBOperator* createProjectionOperator(embedDBOperator* input, uint8_t numCol
     return operator;
 }
 
+void initSelection(embedDBOperator* operator);
+
+/**
+ * @brief	Tightens one iterator bound with a pushed down predicate value. The bound is copied into @c slot so an existing bound owned by the caller is never modified.
+ * @param	bound		Pointer to the iterator bound (it->minKey, it->maxData, etc.)
+ * @param	slot		Buffer owned by the table scan to hold the new bound
+ * @param	boundSize	Size of the whole bound (key size or data size)
+ * @param	value		Value of the predicate
+ * @param	colSize		Size of the column the predicate is on. Negative if signed
+ * @param	isMin		1 if the bound is a lower bound, 0 if it is an upper bound
+ */
+static void tightenBound(void** bound, void* slot, uint8_t boundSize, void* value, int8_t colSize, int8_t isMin) {
+    int8_t isSigned = colSize < 0;
+    int8_t size = isSigned ? -colSize : colSize;
+    if (*bound != NULL && compare(*bound, isMin ? SELECT_GTE : SELECT_LTE, value, isSigned, size))
+        return;
+
+    if (*bound == NULL)
+        memset(slot, 0, boundSize);
+    else if (*bound != slot)
+        memcpy(slot, *bound, boundSize);
+    memcpy(slot, value, size);
+    *bound = slot;
+}
+
+/**
+ * @brief	Pushes the predicate of a selection down into the iterator of the table scan below it, so the spline, bitmap and min/max headers
+ * 			skip records that can't match. Predicates on the key and on the first data column (the one compared by compareData and indexed
+ * 			by the bitmap) are pushed. The selection still filters every record, so the pushed bounds only need to include the matching records.
+ */
+static void pushDownSelection(embedDBOperator* operator) {
+    int8_t colNum = *(int8_t*)operator->state;
+    int8_t operation = *((int8_t*)operator->state + 1);
+    void* compVal;
+    memcpy(&compVal, (int8_t*)operator->state + 2, sizeof(void*));
+    if (colNum < 0 || colNum > 1 || operation == SELECT_NEQ || operation > SELECT_EQ)
+        return;
+
+    /* Selections don't change the schema, so look through them for the table scan */
+    embedDBOperator* scan = operator->input;
+    while (scan != NULL && scan->init == initSelection)
+        scan = scan->input;
+    if (scan == NULL || scan->init != initTableScan || scan->recordBuffer == NULL)
+        return;
+
+    tableScanState* scanState = scan->state;
+    embedDBState* state = scanState->state;
+    embedDBIterator* it = scanState->it;
+    if (scanState->bounds == NULL) {
+        scanState->bounds = embedDBArenaMalloc(scan->arena, 2 * (state->keySize + state->dataSize));
+        if (scanState->bounds == NULL) {
+#ifdef PRINT_ERRORS
+            printf("WARNING: Failed to allocate bounds for predicate pushdown\n");
+#endif
+            return;
+        }
+    }
+
+    int8_t* minKeySlot = scanState->bounds;
+    int8_t* maxKeySlot = minKeySlot + state->keySize;
+    int8_t* minDataSlot = maxKeySlot + state->keySize;
+    int8_t* maxDataSlot = minDataSlot + state->dataSize;
+    int8_t colSize = scan->schema->columnSizes[colNum];
+    int8_t setMin = operation == SELECT_GT || operation == SELECT_GTE || operation == SELECT_EQ;
+    int8_t setMax = operation == SELECT_LT || operation == SELECT_LTE || operation == SELECT_EQ;
+    if (colNum == 0) {
+        if (setMin)
+            tightenBound(&it->minKey, minKeySlot, state->keySize, compVal, colSize, 1);
+        if (setMax)
+            tightenBound(&it->maxKey, maxKeySlot, state->keySize, compVal, colSize, 0);
+    } else {
+        if (setMin)
+            tightenBound(&it->minData, minDataSlot, state->dataSize, compVal, colSize, 1);
+        if (setMax)
+            tightenBound(&it->maxData, maxDataSlot, state->dataSize, compVal, colSize, 0);
+    }
+
+    /* Rebuild the query bitmap and start page from the new bounds */
+    embedDBCloseIterator(it);
+    embedDBInitIterator(state, it);
+}
+
 void initSelection(embedDBOperator* operator) {
     if (operator->input == NULL) {
 #ifdef PRINT_ERRORS
@@ -380,14 +465,16 @@ void initSelection(embedDBOperator* operator) {
     // Init input
     operator->input->init(operator->input);
 
+    pushDownSelection(operator);
+
     // Init output schema
     if (operator->schema == NULL) {
-        operator->schema = copySchema(operator->input->schema);
+        operator->schema = copySchemaInArena(operator->arena, operator->input->schema);
     }
 
     // Init output buffer
     if (operator->recordBuffer == NULL) {
-        operator->recordBuffer = createBufferFromSchema(operator->schema);
+        operator->recordBuffer = createBufferFromSchemaInArena(operator->arena, operator->schema);
         if (operator->recordBuffer == NULL) {
 #ifdef PRINT_ERRORS
             printf("ERROR: Failed to allocate buffer for TableScan operator\n");
@@ -426,9 +513,9 @@ void closeSelection(embedDBOperator* operator) {
     operator->input->close(operator->input);
 
     embedDBFreeSchema(&operator->schema);
-    free(operator->state);
+    embedDBArenaFree(operator->arena, operator->state);
     operator->state = NULL;
-    free(operator->recordBuffer);
+    embedDBArenaFree(operator->arena, operator->recordBuffer);
     operator->recordBuffer = NULL;
 }
 
@@ -440,7 +527,7 @@ void closeSelection(embedDBOperator* operator) {
  * @param	compVal		A pointer to the value to compare with. Make sure the size of this is the same number of bytes as is described in the schema
  */
 embedDBOperator* createSelectionOperator(embedDBOperator* input, int8_t colNum, int8_t operation, void* compVal) {
-    int8_t* state = malloc(2 + sizeof(void*));
+    int8_t* state = embedDBQueryMalloc(2 + sizeof(void*));
     if (state == NULL) {
 #ifdef PRINT_ERRORS
         printf("ERROR: Failed to malloc while creating Selection operator\n");
@@ -451,7 +538,7 @@ embedDBOperator* createSelectionOperator(embedDBOperator* input, int8_t colNum,
     state[1] = operation;
     memcpy(state + 2, &compVal, sizeof(void*));
 
-    embedDBOperator* operator= malloc(sizeof(embedDBOperator));
+    embedDBOperator* operator= embedDBCreateOperator();
     if (operator== NULL) {
 #ifdef PRINT_ERRORS
         printf("ERROR: Failed to malloc while creating Selection operator\n");
@@ -469,6 +556,249 @@ embedDBOperator* createSelectionOperator(embedDBOperator* input, int8_t colNum,
     return operator;
 }
 
+/**
+ * @brief	Returns a pointer to the i-th selected record of a batch
+ */
+static inline void* batchRecord(embedDBBatch* batch, uint16_t i) {
+    return (int8_t*)batch->records + batch->selection[i] * batch->recordSize;
+}
+
+/**
+ * @brief	Allocates a batch able to hold the records of every operator in a chain from the arena of @c operator. The chain must already be initialized.
+ * @param	operator	The top level operator the batch will be passed to
+ * @param	capacity	Maximum number of records in the batch (e.g. EMBEDDB_BATCH_SIZE)
+ * @return	The batch or NULL if allocation failed
+ */
+embedDBBatch* embedDBCreateBatch(embedDBOperator* operator, uint16_t capacity) {
+    // Projections are done in place, so the batch must fit the widest record of the chain
+    uint16_t recordSize = 0;
+    for (embedDBOperator* op = operator; op != NULL; op = op->input) {
+        if (op->schema != NULL)
+            recordSize = max(recordSize, getRecordSizeFromSchema(op->schema));
+    }
+    if (capacity == 0 || recordSize == 0) {
+#ifdef PRINT_ERRORS
+        printf("ERROR: A batch needs a capacity and an initialized operator\n");
+#endif
+        return NULL;
+    }
+
+    embedDBBatch* batch = embedDBArenaMalloc(operator->arena, sizeof(embedDBBatch));
+    if (batch == NULL) {
+#ifdef PRINT_ERRORS
+        printf("ERROR: Failed to malloc while creating batch\n");
+#endif
+        return NULL;
+    }
+    batch->arena = operator->arena;
+    batch->records = embedDBArenaMalloc(batch->arena, (uint32_t)capacity * recordSize);
+    batch->selection = embedDBArenaMalloc(batch->arena, capacity * sizeof(uint16_t));
+    if (batch->records == NULL || batch->selection == NULL) {
+#ifdef PRINT_ERRORS
+        printf("ERROR: Failed to malloc while creating batch\n");
+#endif
+        embedDBFreeBatch(&batch);
+        return NULL;
+    }
+    batch->numRecords = 0;
+    batch->numSelected = 0;
+    batch->capacity = capacity;
+    batch->recordSize = recordSize;
+    return batch;
+}
+
+/**
+ * @brief	Frees a batch created by embedDBCreateBatch. Sets the batch pointer to NULL.
+ */
+void embedDBFreeBatch(embedDBBatch** batch) {
+    if (*batch == NULL)
+        return;
+    embedDBArenaFree((*batch)->arena, (*batch)->records);
+    embedDBArenaFree((*batch)->arena, (*batch)->selection);
+    embedDBArenaFree((*batch)->arena, *batch);
+    *batch = NULL;
+}
+
+/**
+ * @brief	Fills a batch by calling next on an operator that has no batch implementation
+ */
+static uint16_t rowBatch(embedDBOperator* operator, embedDBBatch* batch) {
+    uint16_t recordSize = getRecordSizeFromSchema(operator->schema);
+    uint16_t n = 0;
+    batch->recordSize = recordSize;
+    while (n < batch->capacity && operator->next(operator)) {
+        memcpy((int8_t*)batch->records + n * recordSize, operator->recordBuffer, recordSize);
+        batch->selection[n] = n;
+        n++;
+    }
+    batch->numRecords = n;
+    batch->numSelected = n;
+    return n;
+}
+
+/**
+ * @brief	Reads records from the iterator of a table scan directly into the batch
+ */
+static uint16_t tableScanBatch(embedDBOperator* operator, embedDBBatch* batch) {
+    if (operator->schema == NULL) {
+#ifdef PRINT_ERRORS
+        printf("ERROR: Must provide a base schema for a table scan operator\n");
+#endif
+        return 0;
+    }
+
+    embedDBState* state = ((tableScanState*)operator->state)->state;
+    embedDBIterator* it = ((tableScanState*)operator->state)->it;
+    uint16_t recordSize = state->keySize + state->dataSize;
+    uint16_t n = 0;
+    batch->recordSize = recordSize;
+    while (n < batch->capacity) {
+        int8_t* record = (int8_t*)batch->records + n * recordSize;
+        if (!embedDBNext(state, it, record, record + state->keySize))
+            break;
+        batch->selection[n] = n;
+        n++;
+    }
+    batch->numRecords = n;
+    batch->numSelected = n;
+    return n;
+}
+
+/* Keeps the selected rows whose column value compares true with the predicate. Compacts the selection vector without branching */
+#define FILTER_BATCH(type, op)                                                  \
+    for (uint16_t i = 0; i < batch->numSelected; i++) {                         \
+        type v;                                                                 \
+        memcpy(&v, column + batch->selection[i] * batch->recordSize, sizeof(type)); \
+        batch->selection[n] = batch->selection[i];                              \
+        n += (v op value);                                                      \
+    }
+
+#define FILTER_BATCH_TYPE(type)                \
+    {                                          \
+        type value;                            \
+        memcpy(&value, compVal, sizeof(type)); \
+        switch (operation) {                   \
+            case SELECT_GT:                    \
+                FILTER_BATCH(type, >)          \
+                break;                         \
+            case SELECT_LT:                    \
+                FILTER_BATCH(type, <)          \
+                break;                         \
+            case SELECT_GTE:                   \
+                FILTER_BATCH(type, >=)         \
+                break;                         \
+            case SELECT_LTE:                   \
+                FILTER_BATCH(type, <=)         \
+                break;                         \
+            case SELECT_EQ:                    \
+                FILTER_BATCH(type, ==)         \
+                break;                         \
+            case SELECT_NEQ:                   \
+                FILTER_BATCH(type, !=)         \
+                break;                         \
+        }                                      \
+        break;                                 \
+    }
+
+/**
+ * @brief	Filters the selection vector of each input batch until at least one record is selected or the input is exhausted
+ */
+static uint16_t selectionBatch(embedDBOperator* operator, embedDBBatch* batch) {
+    embedDBSchema* schema = operator->input->schema;
+    int8_t colNum = *(int8_t*)operator->state;
+    int8_t operation = *((int8_t*)operator->state + 1);
+    void* compVal;
+    memcpy(&compVal, (int8_t*)operator->state + 2, sizeof(void*));
+    uint16_t colPos = getColOffsetFromSchema(schema, colNum);
+    int8_t colSize = schema->columnSizes[colNum];
+
+    while (execBatch(operator->input, batch)) {
+        int8_t* column = (int8_t*)batch->records + colPos;
+        uint16_t n = 0;
+        switch (colSize) {
+            case -1:
+                FILTER_BATCH_TYPE(int8_t)
+            case 1:
+                FILTER_BATCH_TYPE(uint8_t)
+            case -2:
+                FILTER_BATCH_TYPE(int16_t)
+            case 2:
+                FILTER_BATCH_TYPE(uint16_t)
+            case -4:
+                FILTER_BATCH_TYPE(int32_t)
+            case 4:
+                FILTER_BATCH_TYPE(uint32_t)
+            case -8:
+                FILTER_BATCH_TYPE(int64_t)
+            case 8:
+                FILTER_BATCH_TYPE(uint64_t)
+            default: {
+                int8_t isSigned = embedDB_IS_COL_SIGNED(colSize);
+                for (uint16_t i = 0; i < batch->numSelected; i++) {
+                    batch->selection[n] = batch->selection[i];
+                    n += compare(column + batch->selection[i] * batch->recordSize, operation, compVal, isSigned, abs(colSize));
+                }
+            }
+        }
+        batch->numSelected = n;
+        if (n > 0)
+            return n;
+    }
+    return 0;
+}
+
+/**
+ * @brief	Projects the selected records of the input batch in place. Output records are never larger than input records and columns
+ * 			keep their order, so writing the records front to back never overwrites a record that hasn't been projected yet.
+ */
+static uint16_t projectionBatch(embedDBOperator* operator, embedDBBatch* batch) {
+    uint8_t numCols = *(uint8_t*)operator->state;
+    uint8_t* cols = (uint8_t*)operator->state + 1;
+    const embedDBSchema* inputSchema = operator->input->schema;
+    uint16_t outputSize = getRecordSizeFromSchema(operator->schema);
+
+    uint16_t n = execBatch(operator->input, batch);
+    for (uint16_t i = 0; i < n; i++) {
+        int8_t* input = batchRecord(batch, i);
+        int8_t* output = (int8_t*)batch->records + i * outputSize;
+        uint16_t curColPos = 0;
+        uint16_t nextProjColPos = 0;
+        uint8_t nextProjCol = 0;
+        for (uint8_t col = 0; col < inputSchema->numCols && nextProjCol != numCols; col++) {
+            uint8_t colSize = abs(inputSchema->columnSizes[col]);
+            if (col == cols[nextProjCol]) {
+                memmove(output + nextProjColPos, input + curColPos, colSize);
+                nextProjColPos += colSize;
+                nextProjCol++;
+            }
+            curColPos += colSize;
+        }
+        batch->selection[i] = i;
+    }
+    batch->recordSize = outputSize;
+    batch->numRecords = n;
+    batch->numSelected = n;
+    return n;
+}
+
+/**
+ * @brief	Extract the next batch of records from an operator. Table scans, selections and projections process a whole batch at a time.
+ * 			Other operators fill the batch by calling next.
+ * @return	The number of selected records. 0 if there are no more rows to return
+ */
+uint16_t execBatch(embedDBOperator* operator, embedDBBatch* batch) {
+    if (operator->next == nextTableScan) {
+        return tableScanBatch(operator, batch);
+    } else if (operator->next == nextSelection) {
+        return selectionBatch(operator, batch);
+    } else if (operator->next == nextProjection) {
+        return projectionBatch(operator, batch);
+    }
+    return rowBatch(operator, batch);
+}
+
+static void aggregateAddBatch(embedDBAggregateFunc* aggFunc, embedDBSchema* schema, embedDBBatch* batch, uint16_t first, uint16_t last);
+
 /**
  * @brief	A private struct to hold the state of the aggregate operator
  */
@@ -476,11 +806,30 @@ struct aggregateInfo {
     int8_t (*groupfunc)(const void* lastRecord, const void* record);  // Function that determins if both records are in the same group
     embedDBAggregateFunc* functions;                                  // An array of aggregate functions
     uint32_t functionsLength;                                         // The length of the functions array
-    void* lastRecordBuffer;                                           // Buffer for the last record read by input->next
-    uint16_t bufferSize;                                              // Size of the input buffer (and lastRecordBuffer)
-    int8_t isLastRecordUsable;                                        // Is the data in lastRecordBuffer usable for checking if the recently read record is in the same group? Is set to 0 at start, and also after the last record
+    void* lastRecordBuffer;                                           // Buffer for the last record of a group that continues into the next batch
+    uint16_t bufferSize;                                              // Size of the input records (and lastRecordBuffer)
+    embedDBBatch* batch;                                              // Batch of input records
+    uint16_t batchPos;                                                // Index of the next unread selected record in batch
 };
 
+/**
+ * @brief	Creates the output schema of an aggregate operator from @c arena, with one column for each aggregate function
+ */
+static embedDBSchema* createAggregateSchema(embedDBArena* arena, embedDBAggregateFunc* functions, uint32_t functionsLength) {
+    embedDBSchema* schema = allocateSchemaInArena(arena, functionsLength);
+    if (schema == NULL) {
+#ifdef PRINT_ERRORS
+        printf("ERROR: Failed to malloc while initializing aggregate operator\n");
+#endif
+        return NULL;
+    }
+    for (uint8_t i = 0; i < functionsLength; i++) {
+        schema->columnSizes[i] = functions[i].colSize;
+        functions[i].colNum = i;
+    }
+    return schema;
+}
+
 void initAggregate(embedDBOperator* operator) {
     if (operator->input == NULL) {
 #ifdef PRINT_ERRORS
@@ -493,35 +842,19 @@ void initAggregate(embedDBOperator* operator) {
     operator->input->init(operator->input);
 
     struct aggregateInfo* state = operator->state;
-    state->isLastRecordUsable = 0;
 
     // Init output schema
     if (operator->schema == NULL) {
-        operator->schema = malloc(sizeof(embedDBSchema));
+        operator->schema = createAggregateSchema(operator->arena, state->functions, state->functionsLength);
         if (operator->schema == NULL) {
-#ifdef PRINT_ERRORS
-            printf("ERROR: Failed to malloc while initializing aggregate operator\n");
-#endif
             return;
         }
-        operator->schema->numCols = state->functionsLength;
-        operator->schema->columnSizes = malloc(state->functionsLength);
-        if (operator->schema->columnSizes == NULL) {
-#ifdef PRINT_ERRORS
-            printf("ERROR: Failed to malloc while initializing aggregate operator\n");
-#endif
-            return;
-        }
-        for (uint8_t i = 0; i < state->functionsLength; i++) {
-            operator->schema->columnSizes[i] = state->functions[i].colSize;
-            state->functions[i].colNum = i;
-        }
     }
 
     // Init buffers
     state->bufferSize = getRecordSizeFromSchema(operator->input->schema);
     if (operator->recordBuffer == NULL) {
-        operator->recordBuffer = createBufferFromSchema(operator->schema);
+        operator->recordBuffer = createBufferFromSchemaInArena(operator->arena, operator->schema);
         if (operator->recordBuffer == NULL) {
 #ifdef PRINT_ERRORS
             printf("ERROR: Failed to malloc while initializing aggregate operator\n");
@@ -530,7 +863,7 @@ void initAggregate(embedDBOperator* operator) {
         }
     }
     if (state->lastRecordBuffer == NULL) {
-        state->lastRecordBuffer = malloc(state->bufferSize);
+        state->lastRecordBuffer = embedDBArenaMalloc(operator->arena, state->bufferSize);
         if (state->lastRecordBuffer == NULL) {
 #ifdef PRINT_ERRORS
             printf("ERROR: Failed to malloc while initializing aggregate operator\n");
@@ -538,11 +871,23 @@ void initAggregate(embedDBOperator* operator) {
             return;
         }
     }
+    if (state->batch == NULL) {
+        state->batch = embedDBCreateBatch(operator->input, EMBEDDB_BATCH_SIZE);
+        if (state->batch == NULL) {
+#ifdef PRINT_ERRORS
+            printf("ERROR: Failed to malloc while initializing aggregate operator\n");
+#endif
+            return;
+        }
+    }
+    state->batch->numSelected = 0;
+    state->batchPos = 0;
 }
 
 int8_t nextAggregate(embedDBOperator* operator) {
     struct aggregateInfo* state = operator->state;
     embedDBOperator* input = operator->input;
+    embedDBBatch* batch = state->batch;
 
     // Reset each operator
     for (int i = 0; i < state->functionsLength; i++) {
@@ -552,67 +897,66 @@ int8_t nextAggregate(embedDBOperator* operator) {
     }
 
     int8_t recordsInGroup = 0;
+    const void* lastRecord = NULL;
+    while (1) {
+        if (state->batchPos >= batch->numSelected) {
+            // The group may continue in the next batch, so save its last record before the batch is overwritten
+            if (lastRecord != NULL) {
+                memcpy(state->lastRecordBuffer, lastRecord, state->bufferSize);
+                lastRecord = state->lastRecordBuffer;
+            }
+            state->batchPos = 0;
+            if (!execBatch(input, batch)) {
+                break;
+            }
+        }
 
-    // Check flag used to indicate whether the last record read has been added to a group
-    if (state->isLastRecordUsable) {
-        recordsInGroup = 1;
-        for (int i = 0; i < state->functionsLength; i++) {
-            if (state->functions[i].add != NULL) {
-                state->functions[i].add(state->functions + i, input->schema, state->lastRecordBuffer);
+        // Find where the group ends in this batch
+        uint16_t first = state->batchPos;
+        uint16_t end = first;
+        while (end < batch->numSelected) {
+            const void* record = batchRecord(batch, end);
+            if (lastRecord != NULL && !state->groupfunc(lastRecord, record)) {
+                break;
             }
+            lastRecord = record;
+            end++;
         }
-    }
 
-    int8_t exitType = 0;
-    while (input->next(input)) {
-        // Check if record is in the same group as the last record
-        if (!state->isLastRecordUsable || state->groupfunc(state->lastRecordBuffer, input->recordBuffer)) {
+        for (int i = 0; i < state->functionsLength; i++) {
+            aggregateAddBatch(state->functions + i, input->schema, batch, first, end);
+        }
+        if (end > first) {
             recordsInGroup = 1;
-            for (int i = 0; i < state->functionsLength; i++) {
-                if (state->functions[i].add != NULL) {
-                    state->functions[i].add(state->functions + i, input->schema, input->recordBuffer);
-                }
-            }
-        } else {
-            exitType = 1;
+        }
+        state->batchPos = end;
+        if (end < batch->numSelected) {
             break;
         }
-
-        // Save this record
-        memcpy(state->lastRecordBuffer, input->recordBuffer, state->bufferSize);
-        state->isLastRecordUsable = 1;
     }
 
     if (!recordsInGroup) {
         return 0;
     }
 
-    if (exitType == 0) {
-        // Exited because ran out of records, so all read records have been added to a group
-        state->isLastRecordUsable = 0;
-    }
-
     // Perform final compute on all functions
     for (int i = 0; i < state->functionsLength; i++) {
         if (state->functions[i].compute != NULL) {
-            state->functions[i].compute(state->functions + i, operator->schema, operator->recordBuffer, state->lastRecordBuffer);
+            state->functions[i].compute(state->functions + i, operator->schema, operator->recordBuffer, lastRecord);
         }
     }
 
-    // Put last read record into lastRecordBuffer
-    memcpy(state->lastRecordBuffer, input->recordBuffer, state->bufferSize);
-
     return 1;
 }
 
 void closeAggregate(embedDBOperator* operator) {
     operator->input->close(operator->input);
-    operator->input = NULL;
     embedDBFreeSchema(&operator->schema);
-    free(((struct aggregateInfo*)operator->state)->lastRecordBuffer);
-    free(operator->state);
+    embedDBArenaFree(operator->arena, ((struct aggregateInfo*)operator->state)->lastRecordBuffer);
+    embedDBFreeBatch(&((struct aggregateInfo*)operator->state)->batch);
+    embedDBArenaFree(operator->arena, operator->state);
     operator->state = NULL;
-    free(operator->recordBuffer);
+    embedDBArenaFree(operator->arena, operator->recordBuffer);
     operator->recordBuffer = NULL;
 }
 
@@ -624,7 +968,7 @@ void closeAggregate(embedDBOperator* operator) {
  * @param	functionsLength			The number of embedDBAggregateFuncs in @c functions
  */
 embedDBOperator* createAggregateOperator(embedDBOperator* input, int8_t (*groupfunc)(const void* lastRecord, const void* record), embedDBAggregateFunc* functions, uint32_t functionsLength) {
-    struct aggregateInfo* state = malloc(sizeof(struct aggregateInfo));
+    struct aggregateInfo* state = embedDBQueryMalloc(sizeof(struct aggregateInfo));
     if (state == NULL) {
 #ifdef PRINT_ERRORS
         printf("ERROR: Failed to malloc while creating aggregate operator\n");
@@ -636,8 +980,9 @@ embedDBOperator* createAggregateOperator(embedDBOperator* input, int8_t (*groupf
     state->functions = functions;
     state->functionsLength = functionsLength;
     state->lastRecordBuffer = NULL;
+    state->batch = NULL;
 
-    embedDBOperator* operator= malloc(sizeof(embedDBOperator));
+    embedDBOperator* operator= embedDBCreateOperator();
     if (operator== NULL) {
 #ifdef PRINT_ERRORS
         printf("ERROR: Failed to malloc while creating aggregate operator\n");
@@ -656,11 +1001,440 @@ embedDBOperator* createAggregateOperator(embedDBOperator* input, int8_t (*groupf
     return operator;
 }
 
+/* Size of the header of a spill page. Holds the number of records on the page */
+#define HASH_SPILL_HEADER_SIZE 4
+
+/* Rounds a size up to a multiple of 8 so aggregate states in the hash table are aligned */
+#define HASH_ALIGN(size) (((size) + 7) & ~(uint32_t)7)
+
+/**
+ * @brief	A private struct to hold the state of the hash aggregate operator. The table entries hold, in order, the state of each aggregate
+ * 			function, the group key, the last record added to the group and a used flag.
+ */
+struct hashAggregateInfo {
+    void (*groupKey)(const void* record, void* key);  // Writes the group key of a record
+    uint8_t keySize;                                  // Size of the group key
+    embedDBAggregateFunc* functions;                  // An array of aggregate functions
+    uint32_t functionsLength;                         // The length of the functions array
+    embedDBHashAggregateConfig config;                // Memory budget and spill files
+    void* arena;                                      // Memory budget holding the spill pages and the hash table
+    int8_t* table;                                    // Start of the hash table in arena
+    int8_t* keyBuffer;                                // Group key of the record being added
+    uint32_t numSlots;                                // Number of entries in the table
+    uint32_t maxGroups;                               // Number of groups allowed before spilling, keeps the table from filling up
+    uint32_t numGroups;                               // Number of groups in the table
+    uint32_t emitPos;                                 // Next table entry to output
+    uint16_t entrySize;                               // Size of each table entry
+    uint16_t keyOffset;                               // Offset of the group key in an entry
+    uint16_t recordSize;                              // Size of input records
+    int8_t built;                                     // Has the table been built for the current pass?
+    uint32_t pass;                                    // 0 while reading the input operator, then the number of times the spill files have been read
+    int8_t spillOpen[2];                              // Which spill files have been opened
+    uint32_t spillPages;                              // Number of full pages written to the spill file of this pass
+    uint32_t spillRecords;                            // Number of records spilled in this pass
+    uint32_t readPages;                               // Number of pages in the spill file read by this pass
+    embedDBBatch* batch;                              // Batch of input records for the first pass
+};
+
+/**
+ * @brief	FNV-1a hash of a group key
+ */
+static uint32_t hashGroupKey(const int8_t* key, uint8_t keySize) {
+    uint32_t hash = 2166136261u;
+    for (uint8_t i = 0; i < keySize; i++) {
+        hash = (hash ^ (uint8_t)key[i]) * 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * @brief	Writes a record that doesn't fit in the table to the spill page of this pass. The page is written to the spill file when full.
+ * @return	0 if success, -1 if the record could not be spilled
+ */
+static int8_t hashSpillRecord(struct hashAggregateInfo* state, const void* record) {
+    embedDBHashAggregateConfig* config = &state->config;
+    if (config->fileInterface == NULL) {
+        return -1;
+    }
+
+    void* file = config->spillFiles[state->pass % 2];
+    int8_t* page = state->arena;
+    uint16_t count = *(uint16_t*)page;
+    if (state->spillRecords == 0) {
+        // Overwrite the file read two passes ago
+        if (state->spillOpen[state->pass % 2]) {
+            config->fileInterface->close(file);
+        }
+        if (!config->fileInterface->open(file, EMBEDDB_FILE_MODE_W_PLUS_B)) {
+            state->spillOpen[state->pass % 2] = 0;
+            return -1;
+        }
+        state->spillOpen[state->pass % 2] = 1;
+        state->spillPages = 0;
+        count = 0;
+    }
+
+    memcpy(page + HASH_SPILL_HEADER_SIZE + count * state->recordSize, record, state->recordSize);
+    count++;
+    *(uint16_t*)page = count;
+    state->spillRecords++;
+    if (HASH_SPILL_HEADER_SIZE + (count + 1) * state->recordSize > config->pageSize) {
+        if (!config->fileInterface->write(page, state->spillPages, config->pageSize, file)) {
+            return -1;
+        }
+        state->spillPages++;
+        *(uint16_t*)page = 0;
+    }
+    return 0;
+}
+
+/**
+ * @brief	Adds a record to its group, creating the group if it is new. Records of new groups are spilled once the table holds maxGroups.
+ * @return	0 if success, -1 if the record had to be dropped
+ */
+static int8_t hashAddRecord(struct hashAggregateInfo* state, embedDBSchema* inputSchema, const void* record) {
+    state->groupKey(record, state->keyBuffer);
+    uint32_t slot = hashGroupKey(state->keyBuffer, state->keySize) % state->numSlots;
+    int8_t* entry;
+    while (1) {
+        entry = state->table + slot * state->entrySize;
+        if (!entry[state->entrySize - 1]) {
+            break;
+        }
+        if (memcmp(entry + state->keyOffset, state->keyBuffer, state->keySize) == 0) {
+            break;
+        }
+        slot = slot + 1 == state->numSlots ? 0 : slot + 1;
+    }
+
+    int8_t* groupState = entry;
+    if (!entry[state->entrySize - 1]) {
+        if (state->numGroups >= state->maxGroups) {
+            return hashSpillRecord(state, record);
+        }
+        entry[state->entrySize - 1] = 1;
+        memcpy(entry + state->keyOffset, state->keyBuffer, state->keySize);
+        state->numGroups++;
+        for (uint32_t i = 0; i < state->functionsLength; i++) {
+            embedDBAggregateFunc* func = state->functions + i;
+            if (func->stateSize > 0) {
+                // Start from the function's own state so settings such as the column number are kept
+                memcpy(groupState, func->state, func->stateSize);
+            }
+            void* sharedState = func->state;
+            if (func->stateSize > 0) {
+                func->state = groupState;
+            }
+            if (func->reset != NULL) {
+                func->reset(func, inputSchema);
+            }
+            func->state = sharedState;
+            groupState += HASH_ALIGN(func->stateSize);
+        }
+        groupState = entry;
+    }
+
+    for (uint32_t i = 0; i < state->functionsLength; i++) {
+        embedDBAggregateFunc* func = state->functions + i;
+        void* sharedState = func->state;
+        if (func->stateSize > 0) {
+            func->state = groupState;
+        }
+        if (func->add != NULL) {
+            func->add(func, inputSchema, record);
+        }
+        func->state = sharedState;
+        groupState += HASH_ALIGN(func->stateSize);
+    }
+    memcpy(entry + state->keyOffset + state->keySize, record, state->recordSize);
+    return 0;
+}
+
+/**
+ * @brief	Builds the table for the current pass from the input operator or from the records spilled by the last pass
+ */
+static void hashBuildTable(embedDBOperator* operator) {
+    struct hashAggregateInfo* state = operator->state;
+    embedDBSchema* inputSchema = operator->input->schema;
+    embedDBHashAggregateConfig* config = &state->config;
+
+    memset(state->table, 0, state->numSlots * state->entrySize);
+    state->numGroups = 0;
+    state->emitPos = 0;
+    state->spillRecords = 0;
+    int8_t dropped = 0;
+
+    if (state->pass == 0) {
+        while (execBatch(operator->input, state->batch)) {
+            for (uint16_t i = 0; i < state->batch->numSelected; i++) {
+                dropped |= hashAddRecord(state, inputSchema, batchRecord(state->batch, i));
+            }
+        }
+    } else {
+        // Read the spill file of the last pass with the second spill page
+        void* file = config->spillFiles[(state->pass - 1) % 2];
+        int8_t* page = (int8_t*)state->arena + config->pageSize;
+        for (uint32_t pageNum = 0; pageNum < state->readPages; pageNum++) {
+            if (!config->fileInterface->read(page, pageNum, config->pageSize, file)) {
+                dropped = 1;
+                break;
+            }
+            uint16_t count = *(uint16_t*)page;
+            for (uint16_t i = 0; i < count; i++) {
+                dropped |= hashAddRecord(state, inputSchema, page + HASH_SPILL_HEADER_SIZE + i * state->recordSize);
+            }
+        }
+    }
+
+    // Write the partial spill page
+    if (state->spillRecords > 0 && *(uint16_t*)state->arena > 0) {
+        void* file = config->spillFiles[state->pass % 2];
+        if (config->fileInterface->write(state->arena, state->spillPages, config->pageSize, file)) {
+            state->spillPages++;
+        } else {
+            dropped = 1;
+        }
+    }
+    if (state->spillRecords > 0) {
+        config->fileInterface->flush(config->spillFiles[state->pass % 2]);
+    }
+
+    if (dropped) {
+#ifdef PRINT_ERRORS
+        printf("ERROR: Hash aggregate ran out of memory and could not spill every record. Some groups are incomplete\n");
+#endif
+    }
+    state->built = 1;
+}
+
+void initHashAggregate(embedDBOperator* operator) {
+    if (operator->input == NULL) {
+#ifdef PRINT_ERRORS
+        printf("ERROR: Hash aggregate operator needs an input operator\n");
+#endif
+        return;
+    }
+
+    // Init input
+    operator->input->init(operator->input);
+
+    struct hashAggregateInfo* state = operator->state;
+    embedDBHashAggregateConfig* config = &state->config;
+    state->recordSize = getRecordSizeFromSchema(operator->input->schema);
+    state->built = 0;
+    state->pass = 0;
+
+    // Init output schema
+    if (operator->schema == NULL) {
+        operator->schema = createAggregateSchema(operator->arena, state->functions, state->functionsLength);
+        if (operator->schema == NULL) {
+            return;
+        }
+    }
+
+    // Lay out the table entries
+    uint32_t entrySize = 0;
+    for (uint32_t i = 0; i < state->functionsLength; i++) {
+        entrySize += HASH_ALIGN(state->functions[i].stateSize);
+    }
+    state->keyOffset = entrySize;
+    state->entrySize = HASH_ALIGN(entrySize + state->keySize + state->recordSize + 1);
+
+    // Two spill pages (one written, one read) come out of the budget first
+    uint32_t spillSize = 0;
+    if (config->fileInterface != NULL) {
+        if (HASH_SPILL_HEADER_SIZE + state->recordSize > config->pageSize) {
+#ifdef PRINT_ERRORS
+            printf("ERROR: Hash aggregate spill pages must fit a record\n");
+#endif
+            return;
+        }
+        spillSize = HASH_ALIGN(2 * config->pageSize);
+    }
+    if (config->memoryBudget < spillSize + 2 * state->entrySize) {
+#ifdef PRINT_ERRORS
+        printf("ERROR: Hash aggregate memory budget must fit the spill pages and at least two groups\n");
+#endif
+        return;
+    }
+    state->numSlots = (config->memoryBudget - spillSize) / state->entrySize;
+    state->maxGroups = max(state->numSlots * 3 / 4, 1);
+
+    // Init buffers
+    if (operator->recordBuffer == NULL) {
+        operator->recordBuffer = createBufferFromSchemaInArena(operator->arena, operator->schema);
+    }
+    if (state->arena == NULL) {
+        state->arena = embedDBArenaMalloc(operator->arena, config->memoryBudget);
+    }
+    if (state->keyBuffer == NULL) {
+        state->keyBuffer = embedDBArenaMalloc(operator->arena, state->keySize);
+    }
+    if (state->batch == NULL) {
+        state->batch = embedDBCreateBatch(operator->input, EMBEDDB_BATCH_SIZE);
+    }
+    if (operator->recordBuffer == NULL || state->arena == NULL || state->keyBuffer == NULL || state->batch == NULL) {
+#ifdef PRINT_ERRORS
+        printf("ERROR: Failed to malloc while initializing hash aggregate operator\n");
+#endif
+        return;
+    }
+    state->table = (int8_t*)state->arena + spillSize;
+    *(uint16_t*)state->arena = 0;
+}
+
+int8_t nextHashAggregate(embedDBOperator* operator) {
+    struct hashAggregateInfo* state = operator->state;
+    if (state->table == NULL) {
+        return 0;
+    }
+
+    while (1) {
+        if (!state->built) {
+            hashBuildTable(operator);
+        }
+
+        // Output the next group in the table
+        while (state->emitPos < state->numSlots) {
+            int8_t* entry = state->table + state->emitPos * state->entrySize;
+            state->emitPos++;
+            if (!entry[state->entrySize - 1]) {
+                continue;
+            }
+            int8_t* groupState = entry;
+            for (uint32_t i = 0; i < state->functionsLength; i++) {
+                embedDBAggregateFunc* func = state->functions + i;
+                void* sharedState = func->state;
+                if (func->stateSize > 0) {
+                    func->state = groupState;
+                }
+                if (func->compute != NULL) {
+                    func->compute(func, operator->schema, operator->recordBuffer, entry + state->keyOffset + state->keySize);
+                }
+                func->state = sharedState;
+                groupState += HASH_ALIGN(func->stateSize);
+            }
+            return 1;
+        }
+
+        // The table is done, so aggregate the records spilled during this pass
+        if (state->spillRecords == 0) {
+            return 0;
+        }
+        state->readPages = state->spillPages;
+        state->pass++;
+        state->built = 0;
+    }
+}
+
+void closeHashAggregate(embedDBOperator* operator) {
+    operator->input->close(operator->input);
+    embedDBFreeSchema(&operator->schema);
+    struct hashAggregateInfo* state = operator->state;
+    for (uint8_t i = 0; i < 2; i++) {
+        if (state->spillOpen[i]) {
+            state->config.fileInterface->close(state->config.spillFiles[i]);
+        }
+    }
+    embedDBArenaFree(operator->arena, state->arena);
+    embedDBArenaFree(operator->arena, state->keyBuffer);
+    embedDBFreeBatch(&state->batch);
+    embedDBArenaFree(operator->arena, operator->state);
+    operator->state = NULL;
+    embedDBArenaFree(operator->arena, operator->recordBuffer);
+    operator->recordBuffer = NULL;
+}
+
+/**
+ * @brief	Creates an operator that groups records by a key computed from each record, without needing the input sorted by group. Groups are
+ * 			kept in a fixed size hash table. When it fills up, records of new groups are spilled to a scratch file and aggregated in later passes.
+ * 			Groups are output in no particular order.
+ * @param	input			The operator that this operator can pull records from
+ * @param	groupKey		A function that writes the group key of @c record to @c key
+ * @param	keySize			The size of the group key, in bytes
+ * @param	functions		An array of aggregate functions. Functions keep a copy of the first @c stateSize bytes of their state for each group
+ * @param	functionsLength	The number of embedDBAggregateFuncs in @c functions
+ * @param	config			The memory budget and spill files. Copied into the operator
+ */
+embedDBOperator* createHashAggregateOperator(embedDBOperator* input, void (*groupKey)(const void* record, void* key), uint8_t keySize, embedDBAggregateFunc* functions, uint32_t functionsLength, embedDBHashAggregateConfig* config) {
+    if (groupKey == NULL || keySize == 0 || config == NULL) {
+#ifdef PRINT_ERRORS
+        printf("ERROR: A hash aggregate operator needs a group key and a config\n");
+#endif
+        return NULL;
+    }
+
+    struct hashAggregateInfo* state = embedDBQueryCalloc(sizeof(struct hashAggregateInfo));
+    if (state == NULL) {
+#ifdef PRINT_ERRORS
+        printf("ERROR: Failed to malloc while creating hash aggregate operator\n");
+#endif
+        return NULL;
+    }
+    state->groupKey = groupKey;
+    state->keySize = keySize;
+    state->functions = functions;
+    state->functionsLength = functionsLength;
+    state->config = *config;
+
+    embedDBOperator* operator= embedDBCreateOperator();
+    if (operator== NULL) {
+#ifdef PRINT_ERRORS
+        printf("ERROR: Failed to malloc while creating hash aggregate operator\n");
+#endif
+        embedDBQueryFree(state);
+        return NULL;
+    }
+
+    operator->state = state;
+    operator->input = input;
+    operator->schema = NULL;
+    operator->recordBuffer = NULL;
+    operator->init = initHashAggregate;
+    operator->next = nextHashAggregate;
+    operator->close = closeHashAggregate;
+
+    return operator;
+}
+
+int8_t embedDBOperatorSeek(embedDBOperator* operator, void* key) {
+    /* Selections don't change the schema or the order, so look through them for the table scan */
+    embedDBOperator* scan = operator;
+    while (scan != NULL && scan->init == initSelection)
+        scan = scan->input;
+    if (scan == NULL || scan->init != initTableScan || scan->state == NULL)
+        return 0;
+
+    tableScanState* scanState = scan->state;
+    if (embedDBIteratorSeek(scanState->state, scanState->it, key) != 0)
+        return -1;
+    return 1;
+}
+
 struct keyJoinInfo {
     embedDBOperator* input2;
     int8_t firstCall;
+    uint8_t misses1;  // Times in a row input1 was moved forward without finding a match
+    uint8_t misses2;  // Times in a row input2 was moved forward without finding a match
 };
 
+/**
+ * @brief	Moves a key join input forward one record. Once the input has fallen behind the other input KEY_JOIN_MIN_GALLOP times in a row,
+ * 			it seeks to the key of the other input instead, so joining a sparse input with a dense one does not read every record of the dense one.
+ * @param	input	The input to move forward
+ * @param	key		The key of the record of the other input
+ * @param	misses	Times in a row the input was moved forward without finding a match
+ * @return	1 if a record was read, 0 if there are no more records
+ */
+static int8_t keyJoinAdvance(embedDBOperator* input, void* key, uint8_t* misses) {
+    if (++(*misses) > KEY_JOIN_MIN_GALLOP) {
+        *misses = 0;
+        if (embedDBOperatorSeek(input, key) < 0)
+            return 0;
+    }
+    return input->next(input);
+}
+
 void initKeyJoin(embedDBOperator* operator) {
     struct keyJoinInfo* state = operator->state;
     embedDBOperator* input1 = operator->input;
@@ -683,18 +1457,10 @@ void initKeyJoin(embedDBOperator* operator) {
 
     // Setup schema
     if (operator->schema == NULL) {
-        operator->schema = malloc(sizeof(embedDBSchema));
+        operator->schema = allocateSchemaInArena(operator->arena, schema1->numCols + schema2->numCols);
         if (operator->schema == NULL) {
 #ifdef PRINT_ERRORS
             printf("ERROR: Failed to malloc while initializing join operator\n");
-#endif
-            return;
-        }
-        operator->schema->numCols = schema1->numCols + schema2->numCols;
-        operator->schema->columnSizes = malloc(operator->schema->numCols * sizeof(int8_t));
-        if (operator->schema->columnSizes == NULL) {
-#ifdef PRINT_ERRORS
-            printf("ERROR: Failed to malloc while initializing join operator\n");
 #endif
             return;
         }
@@ -703,7 +1469,7 @@ void initKeyJoin(embedDBOperator* operator) {
     }
 
     // Allocate recordBuffer
-    operator->recordBuffer = malloc(getRecordSizeFromSchema(operator->schema));
+    operator->recordBuffer = embedDBArenaMalloc(operator->arena, getRecordSizeFromSchema(operator->schema));
     if (operator->recordBuffer == NULL) {
 #ifdef PRINT_ERRORS
         printf("ERROR: Failed to malloc while initializing join operator\n");
@@ -712,6 +1478,8 @@ void initKeyJoin(embedDBOperator* operator) {
     }
 
     state->firstCall = 1;
+    state->misses1 = 0;
+    state->misses2 = 0;
 }
 
 int8_t nextKeyJoin(embedDBOperator* operator) {
@@ -742,18 +1510,22 @@ int8_t nextKeyJoin(embedDBOperator* operator) {
         int8_t comp = compareUnsignedNumbers(record1, record2, colSize);
         if (comp == 0) {
             // Move both forward because if they match at this point, they've already been matched
+            state->misses1 = 0;
+            state->misses2 = 0;
             if (!input1->next(input1) || !input2->next(input2)) {
                 return 0;
             }
         } else if (comp < 0) {
             // Move record 1 forward
-            if (!input1->next(input1)) {
+            state->misses2 = 0;
+            if (!keyJoinAdvance(input1, record2, &state->misses1)) {
                 // We are out of records on one side. Given the assumption that the inputs are sorted, there are no more possible joins
                 return 0;
             }
         } else {
             // Move record 2 forward
-            if (!input2->next(input2)) {
+            state->misses1 = 0;
+            if (!keyJoinAdvance(input2, record1, &state->misses2)) {
                 // We are out of records on one side. Given the assumption that the inputs are sorted, there are no more possible joins
                 return 0;
             }
@@ -785,9 +1557,9 @@ void closeKeyJoin(embedDBOperator* operator) {
     input2->close(input2);
 
     embedDBFreeSchema(&operator->schema);
-    free(operator->state);
+    embedDBArenaFree(operator->arena, operator->state);
     operator->state = NULL;
-    free(operator->recordBuffer);
+    embedDBArenaFree(operator->arena, operator->recordBuffer);
     operator->recordBuffer = NULL;
 }
 
@@ -795,7 +1567,7 @@ void closeKeyJoin(embedDBOperator* operator) {
  * @brief	Creates an operator for perfoming an equijoin on the keys (sorted and distinct) of two tables
  */
 embedDBOperator* createKeyJoinOperator(embedDBOperator* input1, embedDBOperator* input2) {
-    embedDBOperator* operator= malloc(sizeof(embedDBOperator));
+    embedDBOperator* operator= embedDBCreateOperator();
     if (operator== NULL) {
 #ifdef PRINT_ERRORS
         printf("ERROR: Failed to malloc while creating join operator\n");
@@ -803,7 +1575,7 @@ embedDBOperator* createKeyJoinOperator(embedDBOperator* input1, embedDBOperator*
         return NULL;
     }
 
-    struct keyJoinInfo* state = malloc(sizeof(struct keyJoinInfo));
+    struct keyJoinInfo* state = embedDBQueryMalloc(sizeof(struct keyJoinInfo));
     if (state == NULL) {
 #ifdef PRINT_ERRORS
         printf("ERROR: Failed to malloc while creating join operator\n");
@@ -831,6 +1603,12 @@ void countAdd(embedDBAggregateFunc* aggFunc, embedDBSchema* inputSchema, const v
     (*(uint32_t*)aggFunc->state)++;
 }
 
+void countMerge(embedDBAggregateFunc* aggFunc, embedDBSchema* inputSchema, const void* otherState) {
+    uint32_t otherCount;
+    memcpy(&otherCount, otherState, sizeof(uint32_t));
+    *(uint32_t*)aggFunc->state += otherCount;
+}
+
 void countCompute(embedDBAggregateFunc* aggFunc, embedDBSchema* outputSchema, void* recordBuffer, const void* lastRecord) {
     // Put count in record
     memcpy((int8_t*)recordBuffer + getColOffsetFromSchema(outputSchema, aggFunc->colNum), aggFunc->state, sizeof(uint32_t));
@@ -840,11 +1618,13 @@ void countCompute(embedDBAggregateFunc* aggFunc, embedDBSchema* outputSchema, vo
  * @brief	Creates an aggregate function to count the number of records in a group. To be used in combination with an embedDBOperator produced by createAggregateOperator
  */
 embedDBAggregateFunc* createCountAggregate() {
-    embedDBAggregateFunc* aggFunc = malloc(sizeof(embedDBAggregateFunc));
+    embedDBAggregateFunc* aggFunc = embedDBQueryMalloc(sizeof(embedDBAggregateFunc));
     aggFunc->reset = countReset;
     aggFunc->add = countAdd;
     aggFunc->compute = countCompute;
-    aggFunc->state = malloc(sizeof(uint32_t));
+    aggFunc->merge = countMerge;
+    aggFunc->state = embedDBQueryMalloc(sizeof(uint32_t));
+    aggFunc->stateSize = sizeof(uint32_t);
     aggFunc->colSize = 4;
     return aggFunc;
 }
@@ -881,6 +1661,15 @@ void sumAdd(embedDBAggregateFunc* aggFunc, embedDBSchema* inputSchema, const voi
     }
 }
 
+void sumMerge(embedDBAggregateFunc* aggFunc, embedDBSchema* inputSchema, const void* otherState) {
+    // Signed and unsigned sums wrap the same, so both are added as unsigned
+    uint64_t sum, otherSum;
+    memcpy(&sum, aggFunc->state, sizeof(uint64_t));
+    memcpy(&otherSum, otherState, sizeof(uint64_t));
+    sum += otherSum;
+    memcpy(aggFunc->state, &sum, sizeof(uint64_t));
+}
+
 void sumCompute(embedDBAggregateFunc* aggFunc, embedDBSchema* outputSchema, void* recordBuffer, const void* lastRecord) {
     // Put count in record
     memcpy((int8_t*)recordBuffer + getColOffsetFromSchema(outputSchema, aggFunc->colNum), aggFunc->state, sizeof(int64_t));
@@ -891,19 +1680,21 @@ void sumCompute(embedDBAggregateFunc* aggFunc, embedDBSchema* outputSchema, void
  * @param	colNum	The index (zero-indexed) of the column which you want to sum. Column must be <= 8 bytes
  */
 embedDBAggregateFunc* createSumAggregate(uint8_t colNum) {
-    embedDBAggregateFunc* aggFunc = malloc(sizeof(embedDBAggregateFunc));
+    embedDBAggregateFunc* aggFunc = embedDBQueryMalloc(sizeof(embedDBAggregateFunc));
     aggFunc->reset = sumReset;
     aggFunc->add = sumAdd;
     aggFunc->compute = sumCompute;
-    aggFunc->state = malloc(sizeof(int8_t) + sizeof(int64_t));
+    aggFunc->merge = sumMerge;
+    aggFunc->state = embedDBQueryMalloc(sizeof(int8_t) + sizeof(int64_t));
+    aggFunc->stateSize = sizeof(int8_t) + sizeof(int64_t);
     *((uint8_t*)aggFunc->state + sizeof(int64_t)) = colNum;
     aggFunc->colSize = -8;
     return aggFunc;
 }
 
 struct minMaxState {
-    uint8_t colNum;  // Which column of input to use
-    void* current;   // The value currently regarded as the min/max
+    uint8_t colNum;     // Which column of input to use
+    int8_t current[];  // The value currently regarded as the min/max. Stored inline so the state can be copied for each group
 };
 
 void minReset(embedDBAggregateFunc* aggFunc, embedDBSchema* inputSchema) {
@@ -934,6 +1725,15 @@ void minAdd(embedDBAggregateFunc* aggFunc, embedDBSchema* inputSchema, const voi
     }
 }
 
+void minMerge(embedDBAggregateFunc* aggFunc, embedDBSchema* inputSchema, const void* otherState) {
+    struct minMaxState* state = aggFunc->state;
+    int8_t colSize = inputSchema->columnSizes[state->colNum];
+    const int8_t* otherValue = ((const struct minMaxState*)otherState)->current;
+    if (compare((void*)otherValue, SELECT_LT, state->current, embedDB_IS_COL_SIGNED(colSize), abs(colSize))) {
+        memcpy(state->current, otherValue, abs(colSize));
+    }
+}
+
 void minMaxCompute(embedDBAggregateFunc* aggFunc, embedDBSchema* outputSchema, void* recordBuffer, const void* lastRecord) {
     // Put count in record
     memcpy((int8_t*)recordBuffer + getColOffsetFromSchema(outputSchema, aggFunc->colNum), ((struct minMaxState*)aggFunc->state)->current, abs(outputSchema->columnSizes[aggFunc->colNum]));
@@ -945,14 +1745,14 @@ void minMaxCompute(embedDBAggregateFunc* aggFunc, embedDBSchema* outputSchema, v
  * @param	colSize	The size, in bytes, of the column to find the min of. Negative number represents a signed number, positive is unsigned.
  */
 embedDBAggregateFunc* createMinAggregate(uint8_t colNum, int8_t colSize) {
-    embedDBAggregateFunc* aggFunc = malloc(sizeof(embedDBAggregateFunc));
+    embedDBAggregateFunc* aggFunc = embedDBQueryMalloc(sizeof(embedDBAggregateFunc));
     if (aggFunc == NULL) {
 #ifdef PRINT_ERRORS
         printf("ERROR: Failed to allocate while creating min aggregate function\n");
 #endif
         return NULL;
     }
-    struct minMaxState* state = malloc(sizeof(struct minMaxState));
+    struct minMaxState* state = embedDBQueryMalloc(sizeof(struct minMaxState) + abs(colSize));
     if (state == NULL) {
 #ifdef PRINT_ERRORS
         printf("ERROR: Failed to allocate while creating min aggregate function\n");
@@ -960,18 +1760,13 @@ embedDBAggregateFunc* createMinAggregate(uint8_t colNum, int8_t colSize) {
         return NULL;
     }
     state->colNum = colNum;
-    state->current = malloc(abs(colSize));
-    if (state->current == NULL) {
-#ifdef PRINT_ERRORS
-        printf("ERROR: Failed to allocate while creating min aggregate function\n");
-#endif
-        return NULL;
-    }
     aggFunc->state = state;
+    aggFunc->stateSize = sizeof(struct minMaxState) + abs(colSize);
     aggFunc->colSize = colSize;
     aggFunc->reset = minReset;
     aggFunc->add = minAdd;
     aggFunc->compute = minMaxCompute;
+    aggFunc->merge = minMerge;
 
     return aggFunc;
 }
@@ -1004,20 +1799,29 @@ void maxAdd(embedDBAggregateFunc* aggFunc, embedDBSchema* inputSchema, const voi
     }
 }
 
+void maxMerge(embedDBAggregateFunc* aggFunc, embedDBSchema* inputSchema, const void* otherState) {
+    struct minMaxState* state = aggFunc->state;
+    int8_t colSize = inputSchema->columnSizes[state->colNum];
+    const int8_t* otherValue = ((const struct minMaxState*)otherState)->current;
+    if (compare((void*)otherValue, SELECT_GT, state->current, embedDB_IS_COL_SIGNED(colSize), abs(colSize))) {
+        memcpy(state->current, otherValue, abs(colSize));
+    }
+}
+
 /**
  * @brief	Creates an aggregate function to find the max value in a group
  * @param	colNum	The zero-indexed column to find the max of
  * @param	colSize	The size, in bytes, of the column to find the max of. Negative number represents a signed number, positive is unsigned.
  */
 embedDBAggregateFunc* createMaxAggregate(uint8_t colNum, int8_t colSize) {
-    embedDBAggregateFunc* aggFunc = malloc(sizeof(embedDBAggregateFunc));
+    embedDBAggregateFunc* aggFunc = embedDBQueryMalloc(sizeof(embedDBAggregateFunc));
     if (aggFunc == NULL) {
 #ifdef PRINT_ERRORS
         printf("ERROR: Failed to allocate while creating max aggregate function\n");
 #endif
         return NULL;
     }
-    struct minMaxState* state = malloc(sizeof(struct minMaxState));
+    struct minMaxState* state = embedDBQueryMalloc(sizeof(struct minMaxState) + abs(colSize));
     if (state == NULL) {
 #ifdef PRINT_ERRORS
         printf("ERROR: Failed to allocate while creating max aggregate function\n");
@@ -1025,18 +1829,13 @@ embedDBAggregateFunc* createMaxAggregate(uint8_t colNum, int8_t colSize) {
         return NULL;
     }
     state->colNum = colNum;
-    state->current = malloc(abs(colSize));
-    if (state->current == NULL) {
-#ifdef PRINT_ERRORS
-        printf("ERROR: Failed to allocate while creating max aggregate function\n");
-#endif
-        return NULL;
-    }
     aggFunc->state = state;
+    aggFunc->stateSize = sizeof(struct minMaxState) + abs(colSize);
     aggFunc->colSize = colSize;
     aggFunc->reset = maxReset;
     aggFunc->add = maxAdd;
     aggFunc->compute = minMaxCompute;
+    aggFunc->merge = maxMerge;
 
     return aggFunc;
 }
@@ -1086,6 +1885,17 @@ void avgAdd(struct embedDBAggregateFunc* aggFunc, embedDBSchema* inputSchema, co
     state->count++;
 }
 
+void avgMerge(struct embedDBAggregateFunc* aggFunc, embedDBSchema* inputSchema, const void* otherState) {
+    struct avgState* state = aggFunc->state;
+    struct avgState other;
+    memcpy(&other, otherState, sizeof(struct avgState));
+    uint64_t sum;
+    memcpy(&sum, &state->sum, sizeof(uint64_t));
+    sum += (uint64_t)other.sum;
+    memcpy(&state->sum, &sum, sizeof(uint64_t));
+    state->count += other.count;
+}
+
 void avgCompute(struct embedDBAggregateFunc* aggFunc, embedDBSchema* outputSchema, void* recordBuffer, const void* lastRecord) {
     struct avgState* state = aggFunc->state;
     if (aggFunc->colSize == 8) {
@@ -1113,14 +1923,14 @@ void avgCompute(struct embedDBAggregateFunc* aggFunc, embedDBSchema* outputSchem
  * @param	outputFloatSize	Size of float to output. Must be either 4 (float) or 8 (double)
  */
 embedDBAggregateFunc* createAvgAggregate(uint8_t colNum, int8_t outputFloatSize) {
-    embedDBAggregateFunc* aggFunc = malloc(sizeof(embedDBAggregateFunc));
+    embedDBAggregateFunc* aggFunc = embedDBQueryMalloc(sizeof(embedDBAggregateFunc));
     if (aggFunc == NULL) {
 #ifdef PRINT_ERRORS
         printf("ERROR: Failed to allocate while creating avg aggregate function\n");
 #endif
         return NULL;
     }
-    struct avgState* state = malloc(sizeof(struct avgState));
+    struct avgState* state = embedDBQueryMalloc(sizeof(struct avgState));
     if (state == NULL) {
 #ifdef PRINT_ERRORS
         printf("ERROR: Failed to allocate while creating avg aggregate function\n");
@@ -1129,6 +1939,7 @@ embedDBAggregateFunc* createAvgAggregate(uint8_t colNum, int8_t outputFloatSize)
     }
     state->colNum = colNum;
     aggFunc->state = state;
+    aggFunc->stateSize = sizeof(struct avgState);
     if (outputFloatSize > 8 || (outputFloatSize < 8 && outputFloatSize > 4)) {
 #ifdef PRINT_ERRORS
         printf("WARNING: The size of the output float for AVG must be exactly 4 or 8. Defaulting to 8.");
@@ -1145,17 +1956,264 @@ embedDBAggregateFunc* createAvgAggregate(uint8_t colNum, int8_t outputFloatSize)
     aggFunc->reset = avgReset;
     aggFunc->add = avgAdd;
     aggFunc->compute = avgCompute;
+    aggFunc->merge = avgMerge;
 
     return aggFunc;
 }
 
+/* Sums the column of the selected rows [first, last) of a batch. Signed values wrap the same as in sumAdd */
+#define SUM_BATCH(type)                                                      \
+    for (uint16_t i = first; i < last; i++) {                                \
+        type v;                                                              \
+        memcpy(&v, column + batch->selection[i] * batch->recordSize, sizeof(type)); \
+        total += (uint64_t)v;                                                \
+    }                                                                        \
+    break;
+
+/* Finds the selected row in [first, last) of a batch with the smallest (or largest) column value */
+#define EXTREME_BATCH(type)                                                      \
+    {                                                                            \
+        type best;                                                               \
+        memcpy(&best, column + batch->selection[first] * batch->recordSize, sizeof(type)); \
+        for (uint16_t i = first + 1; i < last; i++) {                            \
+            type v;                                                              \
+            memcpy(&v, column + batch->selection[i] * batch->recordSize, sizeof(type)); \
+            if (isMax ? v > best : v < best) {                                   \
+                best = v;                                                        \
+                bestRow = i;                                                     \
+            }                                                                    \
+        }                                                                        \
+        break;                                                                   \
+    }
+
 /**
- * @brief	Completely free a chain of functions recursively after it's already been closed.
+ * @brief	Adds the selected rows [first, last) of a batch to an aggregate function. The built-in functions are updated with one loop over
+ * 			the column, other functions have add called for each record.
+ */
+static void aggregateAddBatch(embedDBAggregateFunc* aggFunc, embedDBSchema* schema, embedDBBatch* batch, uint16_t first, uint16_t last) {
+    if (aggFunc->add == NULL || first == last) {
+        return;
+    }
+
+    if (aggFunc->add == countAdd) {
+        *(uint32_t*)aggFunc->state += last - first;
+        return;
+    }
+
+    if (aggFunc->add == sumAdd || aggFunc->add == avgAdd) {
+        uint8_t colNum = aggFunc->add == sumAdd ? *((uint8_t*)aggFunc->state + sizeof(int64_t)) : ((struct avgState*)aggFunc->state)->colNum;
+        int8_t* column = (int8_t*)batch->records + getColOffsetFromSchema(schema, colNum);
+        uint64_t total = 0;
+        switch (schema->columnSizes[colNum]) {
+            case -1:
+                SUM_BATCH(int8_t)
+            case 1:
+                SUM_BATCH(uint8_t)
+            case -2:
+                SUM_BATCH(int16_t)
+            case 2:
+                SUM_BATCH(uint16_t)
+            case -4:
+                SUM_BATCH(int32_t)
+            case 4:
+                SUM_BATCH(uint32_t)
+            case -8:
+                SUM_BATCH(int64_t)
+            case 8:
+                SUM_BATCH(uint64_t)
+            default:
+                for (uint16_t i = first; i < last; i++) {
+                    aggFunc->add(aggFunc, schema, batchRecord(batch, i));
+                }
+                return;
+        }
+        int64_t* sum = aggFunc->add == sumAdd ? (int64_t*)aggFunc->state : &((struct avgState*)aggFunc->state)->sum;
+        uint64_t newSum;
+        memcpy(&newSum, sum, sizeof(uint64_t));
+        newSum += total;
+        memcpy(sum, &newSum, sizeof(uint64_t));
+        if (aggFunc->add == avgAdd) {
+            ((struct avgState*)aggFunc->state)->count += last - first;
+        }
+        return;
+    }
+
+    if (aggFunc->add == minAdd || aggFunc->add == maxAdd) {
+        int8_t isMax = aggFunc->add == maxAdd;
+        uint8_t colNum = ((struct minMaxState*)aggFunc->state)->colNum;
+        int8_t* column = (int8_t*)batch->records + getColOffsetFromSchema(schema, colNum);
+        uint16_t bestRow = first;
+        switch (schema->columnSizes[colNum]) {
+            case -1:
+                EXTREME_BATCH(int8_t)
+            case 1:
+                EXTREME_BATCH(uint8_t)
+            case -2:
+                EXTREME_BATCH(int16_t)
+            case 2:
+                EXTREME_BATCH(uint16_t)
+            case -4:
+                EXTREME_BATCH(int32_t)
+            case 4:
+                EXTREME_BATCH(uint32_t)
+            case -8:
+                EXTREME_BATCH(int64_t)
+            case 8:
+                EXTREME_BATCH(uint64_t)
+            default:
+                for (uint16_t i = first; i < last; i++) {
+                    aggFunc->add(aggFunc, schema, batchRecord(batch, i));
+                }
+                return;
+        }
+        // Only the best record of the batch needs to be compared with the current min/max
+        aggFunc->add(aggFunc, schema, batchRecord(batch, bestRow));
+        return;
+    }
+
+    for (uint16_t i = first; i < last; i++) {
+        aggFunc->add(aggFunc, schema, batchRecord(batch, i));
+    }
+}
+
+/* Aggregate functions of every worker of a parallel aggregate. They are merged into the functions of the caller once the scan is done */
+struct parallelAggregateInfo {
+    embedDBAggregateFunc* functions;  // functionsLength functions for each worker
+    uint32_t functionsLength;
+    embedDBSchema* schema;            // Schema of the records being aggregated
+    embedDBBatch* batches;            // Batch of each worker that points at the records of a page
+};
+
+static void parallelAggregatePage(void* records, uint32_t numRecords, void* context, uint8_t worker) {
+    struct parallelAggregateInfo* info = context;
+    embedDBBatch* batch = &info->batches[worker];
+    batch->records = records;
+    batch->numRecords = numRecords;
+    batch->numSelected = numRecords;
+    for (uint32_t i = 0; i < info->functionsLength; i++) {
+        aggregateAddBatch(info->functions + worker * info->functionsLength + i, info->schema, batch, 0, numRecords);
+    }
+}
+
+int8_t embedDBParallelAggregate(embedDBState* state, embedDBIterator* it, embedDBSchema* baseSchema, embedDBAggregateFunc* functions, uint32_t functionsLength, uint8_t numWorkers, void* recordBuffer) {
+    for (uint32_t i = 0; i < functionsLength; i++) {
+        if (functions[i].stateSize == 0 || functions[i].merge == NULL) {
+#ifdef PRINT_ERRORS
+            printf("ERROR: Every aggregate function of a parallel aggregate needs a stateSize and a merge function\n");
+#endif
+            return -1;
+        }
+    }
+    numWorkers = max(1, min(numWorkers, EMBEDDB_MAX_SCAN_WORKERS));
+
+    // Every worker gets a copy of the functions with its own state, so only the selection vector is shared
+    uint32_t stateBytes = 0;
+    for (uint32_t i = 0; i < functionsLength; i++) {
+        stateBytes += functions[i].stateSize;
+    }
+    struct parallelAggregateInfo info;
+    info.functionsLength = functionsLength;
+    info.schema = baseSchema;
+    embedDBArena* arena = embedDBGetQueryArena();
+    info.functions = embedDBArenaMalloc(arena, numWorkers * functionsLength * sizeof(embedDBAggregateFunc));
+    info.batches = embedDBArenaMalloc(arena, numWorkers * sizeof(embedDBBatch));
+    int8_t* states = embedDBArenaMalloc(arena, numWorkers * stateBytes + 1);
+    uint16_t* selection = embedDBArenaMalloc(arena, state->maxRecordsPerPage * sizeof(uint16_t));
+    if (info.functions == NULL || info.batches == NULL || states == NULL || selection == NULL) {
+#ifdef PRINT_ERRORS
+        printf("ERROR: Failed to malloc while running parallel aggregate\n");
+#endif
+        embedDBArenaFree(arena, info.functions);
+        embedDBArenaFree(arena, info.batches);
+        embedDBArenaFree(arena, states);
+        embedDBArenaFree(arena, selection);
+        return -1;
+    }
+    for (uint16_t i = 0; i < state->maxRecordsPerPage; i++) {
+        selection[i] = i;
+    }
+
+    int8_t* workerState = states;
+    for (uint8_t w = 0; w < numWorkers; w++) {
+        info.batches[w].selection = selection;
+        info.batches[w].capacity = state->maxRecordsPerPage;
+        info.batches[w].recordSize = state->keySize + state->dataSize;
+        for (uint32_t i = 0; i < functionsLength; i++) {
+            embedDBAggregateFunc* func = info.functions + w * functionsLength + i;
+            *func = functions[i];
+            memcpy(workerState, functions[i].state, functions[i].stateSize);
+            func->state = workerState;
+            workerState += functions[i].stateSize;
+            if (func->reset != NULL) {
+                func->reset(func, baseSchema);
+            }
+        }
+    }
+
+    int8_t result = embedDBParallelScan(state, it, numWorkers, parallelAggregatePage, &info);
+
+    // Combine the worker states into the caller's functions
+    for (uint32_t i = 0; i < functionsLength; i++) {
+        memcpy(functions[i].state, info.functions[i].state, functions[i].stateSize);
+        for (uint8_t w = 1; w < numWorkers; w++) {
+            functions[i].merge(functions + i, baseSchema, info.functions[w * functionsLength + i].state);
+        }
+    }
+    embedDBArenaFree(arena, info.functions);
+    embedDBArenaFree(arena, info.batches);
+    embedDBArenaFree(arena, states);
+    embedDBArenaFree(arena, selection);
+    if (result != 0) {
+        return -1;
+    }
+
+    if (recordBuffer != NULL) {
+        embedDBSchema* outputSchema = createAggregateSchema(arena, functions, functionsLength);
+        if (outputSchema == NULL) {
+            return -1;
+        }
+        for (uint32_t i = 0; i < functionsLength; i++) {
+            if (functions[i].compute != NULL) {
+                functions[i].compute(functions + i, outputSchema, recordBuffer, NULL);
+            }
+        }
+        embedDBFreeSchema(&outputSchema);
+    }
+    return 0;
+}
+
+/**
+ * @brief	Allocates an operator with every field zeroed from the calling thread's query arena, or with malloc if no arena is set, and records where it
+ * 			came from in @c arena
+ */
+embedDBOperator* embedDBCreateOperator(void) {
+    embedDBOperator* operator= embedDBQueryCalloc(sizeof(embedDBOperator));
+    if (operator!= NULL) {
+        operator->arena = embedDBGetQueryArena();
+        if (operator->arena != NULL) {
+            operator->arena->numOperators++;
+        }
+    }
+    return operator;
+}
+
+/**
+ * @brief	Completely free a chain of operators recursively after it's already been closed. Operators allocated from an arena are not freed one by one.
+ * 			Instead the arena is reset once the last operator allocated from it is freed, so other chains in the same arena stay valid.
  */
 void embedDBFreeOperatorRecursive(embedDBOperator** operator) {
     if ((*operator)->input != NULL) {
         embedDBFreeOperatorRecursive(&(*operator)->input);
     }
+    // Memory in an arena is released all at once, when no operator allocated from it is left
+    embedDBArena* arena = (*operator)->arena;
+    if (arena != NULL) {
+        if (arena->numOperators > 0 && --arena->numOperators == 0) {
+            embedDBResetArena(arena);
+        }
+        (*operator) = NULL;
+        return;
+    }
     if ((*operator)->state != NULL) {
         free((*operator)->state);
         (*operator)->state = NULL;
@@ -46,6 +46,16 @@
 #define SELECT_EQ 4
 #define SELECT_NEQ 5
 
+/* Default number of records in a batch passed between operators by execBatch */
+#ifndef EMBEDDB_BATCH_SIZE
+#define EMBEDDB_BATCH_SIZE 64
+#endif
+
+/* Number of records in a row the key join reads from one input without a match before seeking that input to the key of the other */
+#ifndef KEY_JOIN_MIN_GALLOP
+#define KEY_JOIN_MIN_GALLOP 8
+#endif
+
 typedef struct embedDBAggregateFunc {
     /**
      * @brief	Resets the state
@@ -78,6 +88,16 @@ typedef struct embedDBAggregateFunc {
      * @brief	Which column number should compute write to
      */
     uint8_t colNum;
+
+    /**
+     * @brief	Number of bytes of @c state that hold the value of one group. The hash aggregate operator keeps a copy of this many bytes for each group, so they must not point to other per-group memory. 0 if every group shares @c state
+     */
+    uint16_t stateSize;
+
+    /**
+     * @brief	Combines the state of another part of the same group into @c state, so the records of a group can be aggregated in parts. @c otherState holds the first @c stateSize bytes of the state of the other part. NULL if the function cannot be combined
+     */
+    void (*merge)(struct embedDBAggregateFunc* aggFunc, embedDBSchema* inputSchema, const void* otherState);
 } embedDBAggregateFunc;
 
 typedef struct embedDBOperator {
@@ -116,6 +136,11 @@ typedef struct embedDBOperator {
      * @brief	The output record of this operator
      */
     void* recordBuffer;
+
+    /**
+     * @brief	The arena this operator, its state, schema and record buffer were allocated from, or NULL if they were allocated with malloc
+     */
+    embedDBArena* arena;
 } embedDBOperator;
 
 /**
@@ -125,10 +150,54 @@ typedef struct embedDBOperator {
 int8_t exec(embedDBOperator* operator);
 
 /**
- * @brief	Completely free a chain of operators recursively after it's already been closed.
+ * @brief	A batch of records passed between operators by execBatch. Rows are stored back to back in @c records and @c selection lists,
+ * 			in order, the rows that passed every operator so far.
+ */
+typedef struct {
+    void* records;         // Room for capacity rows of the widest schema in the operator chain
+    uint16_t* selection;   // Indexes of the selected rows in records
+    uint16_t numRecords;   // Number of rows in records
+    uint16_t numSelected;  // Number of entries in selection
+    uint16_t capacity;     // Maximum number of rows in the batch
+    uint16_t recordSize;   // Size of each row, from the schema of the operator that filled the batch
+    embedDBArena* arena;   // The arena the batch was allocated from, or NULL if it was allocated with malloc
+} embedDBBatch;
+
+/**
+ * @brief	Allocates a batch able to hold the records of every operator in a chain from the arena of @c operator. The chain must already be initialized.
+ * @param	operator	The top level operator the batch will be passed to
+ * @param	capacity	Maximum number of records in the batch (e.g. EMBEDDB_BATCH_SIZE)
+ * @return	The batch or NULL if allocation failed
+ */
+embedDBBatch* embedDBCreateBatch(embedDBOperator* operator, uint16_t capacity);
+
+/**
+ * @brief	Frees a batch created by embedDBCreateBatch. Sets the batch pointer to NULL.
+ */
+void embedDBFreeBatch(embedDBBatch** batch);
+
+/**
+ * @brief	Extract the next batch of records from an operator. Table scans, selections and projections process a whole batch at a time.
+ * 			Other operators fill the batch by calling next. The selected records are at
+ * 			<tt>(int8_t*)batch->records + batch->selection[i] * batch->recordSize</tt> for i < numSelected.
+ * 			An operator chain must be read either with exec or with execBatch, not both.
+ * @return	The number of selected records. 0 if there are no more rows to return
+ */
+uint16_t execBatch(embedDBOperator* operator, embedDBBatch* batch);
+
+/**
+ * @brief	Completely free a chain of operators recursively after it's already been closed. Operators allocated from an arena are not freed one by one.
+ * 			Instead the arena is reset once the last operator allocated from it is freed, so other chains in the same arena stay valid.
  */
 void embedDBFreeOperatorRecursive(embedDBOperator** operator);
 
+/**
+ * @brief	Allocates an operator with every field zeroed from the calling thread's query arena, or with malloc if no arena is set, and records where it
+ * 			came from in @c arena. Custom operators should be created with it so embedDBFreeOperatorRecursive frees them correctly.
+ * @return	The operator or NULL if allocation failed
+ */
+embedDBOperator* embedDBCreateOperator(void);
+
 ///////////////////////////////////////////
 // Pre-built operators for basic queries //
 ///////////////////////////////////////////
@@ -168,10 +237,58 @@ embedDBOperator* createSelectionOperator(embedDBOperator* input, int8_t colNum,
 embedDBOperator* createAggregateOperator(embedDBOperator* input, int8_t (*groupfunc)(const void* lastRecord, const void* record), embedDBAggregateFunc* functions, uint32_t functionsLength);
 
 /**
- * @brief	Creates an operator for perfoming an equijoin on the keys (sorted and distinct) of two tables
+ * @brief	Memory budget and spill files of a hash aggregate operator
+ */
+typedef struct {
+    uint32_t memoryBudget;                // Bytes for the hash table and, if spilling, two spill pages
+    uint16_t pageSize;                    // Size of the spill file pages
+    embedDBFileInterface* fileInterface;  // Reads and writes the spill files. NULL if all groups must fit in memory
+    void* spillFiles[2];                  // Two scratch files for the file interface. Their contents are overwritten
+} embedDBHashAggregateConfig;
+
+/**
+ * @brief	Creates an operator that groups records by a key computed from each record, without needing the input sorted by group. Groups are
+ * 			kept in a fixed size hash table. When it fills up, records of new groups are spilled to a scratch file and aggregated in later passes.
+ * 			Groups are output in no particular order.
+ * @param	input			The operator that this operator can pull records from
+ * @param	groupKey		A function that writes the group key of @c record to @c key
+ * @param	keySize			The size of the group key, in bytes
+ * @param	functions		An array of aggregate functions. Functions keep a copy of the first @c stateSize bytes of their state for each group
+ * @param	functionsLength	The number of embedDBAggregateFuncs in @c functions
+ * @param	config			The memory budget and spill files. Copied into the operator
+ */
+embedDBOperator* createHashAggregateOperator(embedDBOperator* input, void (*groupKey)(const void* record, void* key), uint8_t keySize, embedDBAggregateFunc* functions, uint32_t functionsLength, embedDBHashAggregateConfig* config);
+
+/**
+ * @brief	Creates an operator for perfoming an equijoin on the keys (sorted and distinct) of two tables. An input that falls behind is moved to
+ * 			the key of the other input with embedDBOperatorSeek, so a sparse table joined with a dense one only reads the pages of the dense table around the matching keys
  */
 embedDBOperator* createKeyJoinOperator(embedDBOperator* input1, embedDBOperator* input2);
 
+/**
+ * @brief	Moves a table scan, or selections over one, forward to the first record with a key greater than or equal to @c key using embedDBIteratorSeek.
+ * 			The next call to next returns that record if it passes the iterator and the selections. The operator must already be initialized.
+ * @param	operator	The operator to move forward
+ * @param	key			The key to move to. Same size as the key of the table
+ * @return	1 if the operator was moved, 0 if the operator cannot seek, -1 if a data page could not be read
+ */
+int8_t embedDBOperatorSeek(embedDBOperator* operator, void* key);
+
+/**
+ * @brief	Aggregates every record matching an iterator as one group with several threads. Pages are read by embedDBParallelScan, each worker
+ * 			adds its records to its own copy of the function states, and the copies are combined with the merge function of each aggregate.
+ * 			The file interface read of the state must be safe to call from several threads.
+ * @param	state			The state associated with the database to read from
+ * @param	it				An initialized iterator setup to read relevent records for this query. It is not advanced
+ * @param	baseSchema		The schema of the database being read from
+ * @param	functions		An array of aggregate functions. Each must set @c stateSize and @c merge
+ * @param	functionsLength	The number of embedDBAggregateFuncs in @c functions
+ * @param	numWorkers		Number of threads to read with, including the calling thread
+ * @param	recordBuffer	Pre-allocated record the functions compute their results into, with one column for each function. The lastRecord passed to compute is NULL. NULL to leave the results in the function states
+ * @return	Returns 0 if success, -1 if a function cannot be merged, or a page could not be read or the worker states could not be allocated
+ */
+int8_t embedDBParallelAggregate(embedDBState* state, embedDBIterator* it, embedDBSchema* baseSchema, embedDBAggregateFunc* functions, uint32_t functionsLength, uint8_t numWorkers, void* recordBuffer);
+
 //////////////////////////////////
 // Prebuilt aggregate functions //
 //////////////////////////////////
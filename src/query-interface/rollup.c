@@ -0,0 +1,350 @@
+/******************************************************************************/
+/**
+ * @file        rollup.c
+ * @author      EmbedDB Team (See Authors.md)
+ * @brief       Rollups that keep bucketed aggregates of an EmbedDB instance
+ *              up to date as records are inserted.
+ * @copyright   Copyright 2024
+ *              EmbedDB Team
+ * @par Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *
+ * @par 1.Redistributions of source code must retain the above copyright notice,
+ *  this list of conditions and the following disclaimer.
+ *
+ * @par 2.Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ *
+ * @par 3.Neither the name of the copyright holder nor the names of its contributors
+ *  may be used to endorse or promote products derived from this software without
+ *  specific prior written permission.
+ *
+ * @par THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+/******************************************************************************/
+
+#include "rollup.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief	Resets the function states for a new bucket
+ */
+static void rollupResetFunctions(embedDBRollup* rollup) {
+    for (uint32_t i = 0; i < rollup->functionsLength; i++) {
+        if (rollup->functions[i].reset != NULL) {
+            rollup->functions[i].reset(rollup->functions + i, rollup->sourceSchema);
+        }
+    }
+}
+
+/**
+ * @brief	Computes the row of the open bucket into @c row
+ */
+static void rollupComputeRow(embedDBRollup* rollup, void* row) {
+    memcpy(row, &rollup->openBucket, rollup->source->keySize);
+    for (uint32_t i = 0; i < rollup->functionsLength; i++) {
+        if (rollup->functions[i].compute != NULL) {
+            rollup->functions[i].compute(rollup->functions + i, rollup->schema, row, rollup->lastRecord);
+        }
+    }
+}
+
+/**
+ * @brief	Insert listener of the source instance
+ */
+static int8_t rollupInsertListener(void* context, void* key, void* data) {
+    return embedDBRollupAdd((embedDBRollup*)context, key, data);
+}
+
+/**
+ * @brief	Adds a record to the rollup, first closing the open bucket if the record belongs to a later bucket. Called by the source for each
+ * 			inserted record once the rollup is initialized.
+ * @param	rollup	Rollup after embedDBRollupInit
+ * @param	key		Key of the record. Must be larger than the keys already added
+ * @param	data	Data of the record
+ * @return	Return 0 if success. Otherwise the result of embedDBPut on the rollup instance.
+ */
+int8_t embedDBRollupAdd(embedDBRollup* rollup, void* key, void* data) {
+    embedDBState* source = rollup->source;
+    uint64_t keyValue = 0;
+    memcpy(&keyValue, key, source->keySize);
+    uint64_t bucket = keyValue / rollup->bucketWidth * rollup->bucketWidth;
+
+    int8_t result = 0;
+    if (rollup->bucketOpen && bucket != rollup->openBucket) {
+        rollupComputeRow(rollup, rollup->row);
+        result = embedDBPut(rollup->rollupState, rollup->row, (int8_t*)rollup->row + source->keySize);
+#ifdef PRINT_ERRORS
+        if (result != 0)
+            printf("ERROR: Could not insert the row of a closed bucket into the rollup\n");
+#endif
+        rollupResetFunctions(rollup);
+        rollup->bucketOpen = 0;
+    }
+
+    /* The records are only passed to the functions one at a time, so the last record is assembled in the layout of the source schema */
+    memcpy(rollup->lastRecord, key, source->keySize);
+    memcpy((int8_t*)rollup->lastRecord + source->keySize, data, source->dataSize);
+    for (uint32_t i = 0; i < rollup->functionsLength; i++) {
+        rollup->functions[i].add(rollup->functions + i, rollup->sourceSchema, rollup->lastRecord);
+    }
+    rollup->openBucket = bucket;
+    rollup->bucketOpen = 1;
+    return result;
+}
+
+/**
+ * @brief	Adds the records of the source that are newer than the last bucket saved in the rollup instance
+ */
+static int8_t rollupCatchUp(embedDBRollup* rollup) {
+    embedDBState* source = rollup->source;
+    embedDBState* rollupState = rollup->rollupState;
+    if (source->minKey == UINT32_MAX)
+        return 0;
+
+    uint64_t minKey = 0;
+    embedDBIterator it;
+    it.minKey = NULL;
+    it.maxKey = NULL;
+    it.minData = NULL;
+    it.maxData = NULL;
+    if (rollupState->minKey != UINT32_MAX) {
+        memcpy(&minKey, &rollupState->maxKey, rollupState->keySize);
+        minKey += rollup->bucketWidth;
+        it.minKey = &minKey;
+    }
+    embedDBInitIterator(source, &it);
+
+    int8_t result = 0;
+    int8_t* record = malloc(source->keySize + source->dataSize);
+    if (record == NULL) {
+#ifdef PRINT_ERRORS
+        printf("ERROR: Failed to malloc while initializing rollup\n");
+#endif
+        embedDBCloseIterator(&it);
+        return -1;
+    }
+    while (result == 0 && embedDBNext(source, &it, record, record + source->keySize)) {
+        result = embedDBRollupAdd(rollup, record, record + source->keySize);
+    }
+    free(record);
+    embedDBCloseIterator(&it);
+    return result;
+}
+
+/**
+ * @brief	Checks the rollup configuration, adds the records of the source that are newer than the last closed bucket, and registers the
+ * 			rollup as the insert listener of the source. Used both for a new rollup and to reopen one after a restart, as the open bucket is
+ * 			rebuilt from the raw records. Both instances must already be initialized.
+ * @param	rollup	Rollup with source, rollupState, sourceSchema, bucketWidth, functions and functionsLength set
+ * @return	Return 0 if success. Non-zero value if error.
+ */
+int8_t embedDBRollupInit(embedDBRollup* rollup) {
+    embedDBState* source = rollup->source;
+    embedDBState* rollupState = rollup->rollupState;
+    rollup->schema = NULL;
+    rollup->row = NULL;
+    rollup->lastRecord = NULL;
+    rollup->bucketOpen = 0;
+    if (source == NULL || rollupState == NULL || rollup->sourceSchema == NULL || rollup->functions == NULL) {
+#ifdef PRINT_ERRORS
+        printf("ERROR: A rollup needs a source, a rollup instance, the source schema and aggregate functions\n");
+#endif
+        return -1;
+    }
+    if (rollup->bucketWidth == 0 || rollup->functionsLength == 0 || rollup->functionsLength > UINT8_MAX - 1) {
+#ifdef PRINT_ERRORS
+        printf("ERROR: A rollup needs a bucket width and between 1 and 254 aggregate functions\n");
+#endif
+        return -1;
+    }
+    if (source->keySize > 8 || rollupState->keySize != source->keySize) {
+#ifdef PRINT_ERRORS
+        printf("ERROR: The rollup instance must have the key size of the source, at most 8 bytes\n");
+#endif
+        return -1;
+    }
+    if (getRecordSizeFromSchema(rollup->sourceSchema) != source->keySize + source->dataSize) {
+#ifdef PRINT_ERRORS
+        printf("ERROR: Size of the source schema doesn't match the records of the source\n");
+#endif
+        return -1;
+    }
+    int32_t rowDataSize = 0;
+    for (uint32_t i = 0; i < rollup->functionsLength; i++) {
+        if (rollup->functions[i].add == NULL) {
+#ifdef PRINT_ERRORS
+            printf("ERROR: Every rollup aggregate function needs an add function\n");
+#endif
+            return -1;
+        }
+        rowDataSize += abs(rollup->functions[i].colSize);
+    }
+    if (rowDataSize != rollupState->dataSize) {
+#ifdef PRINT_ERRORS
+        printf("ERROR: Data size of the rollup instance must be the total size of the aggregate function columns\n");
+#endif
+        return -1;
+    }
+
+    /* The rollup lives as long as the source, so it is not allocated from the query arena */
+    rollup->schema = malloc(sizeof(embedDBSchema));
+    if (rollup->schema != NULL) {
+        rollup->schema->numCols = (uint8_t)(rollup->functionsLength + 1);
+        rollup->schema->columnSizes = malloc(rollup->schema->numCols);
+        rollup->schema->arena = NULL;
+    }
+    rollup->row = malloc(source->keySize + rowDataSize);
+    rollup->lastRecord = malloc(source->keySize + source->dataSize);
+    if (rollup->schema == NULL || rollup->schema->columnSizes == NULL || rollup->row == NULL || rollup->lastRecord == NULL) {
+#ifdef PRINT_ERRORS
+        printf("ERROR: Failed to malloc while initializing rollup\n");
+#endif
+        embedDBRollupClose(rollup);
+        return -1;
+    }
+    rollup->schema->columnSizes[0] = source->keySize;
+    for (uint32_t i = 0; i < rollup->functionsLength; i++) {
+        rollup->schema->columnSizes[i + 1] = rollup->functions[i].colSize;
+        rollup->functions[i].colNum = (uint8_t)(i + 1);
+    }
+
+    rollupResetFunctions(rollup);
+    if (rollupCatchUp(rollup) != 0) {
+        embedDBRollupClose(rollup);
+        return -1;
+    }
+    embedDBSetInsertListener(source, rollupInsertListener, rollup);
+    return 0;
+}
+
+/**
+ * @brief	Stops updating the rollup and frees the space allocated by embedDBRollupInit. The aggregates of the open bucket are not saved.
+ * 			The caller flushes and closes the rollup instance.
+ * @param	rollup	Rollup after embedDBRollupInit
+ */
+void embedDBRollupClose(embedDBRollup* rollup) {
+    if (rollup->source != NULL && rollup->source->insertListenerContext == rollup)
+        embedDBSetInsertListener(rollup->source, NULL, NULL);
+    if (rollup->schema != NULL)
+        free(rollup->schema->columnSizes);
+    free(rollup->schema);
+    free(rollup->row);
+    free(rollup->lastRecord);
+    rollup->schema = NULL;
+    rollup->row = NULL;
+    rollup->lastRecord = NULL;
+    rollup->bucketOpen = 0;
+}
+
+/**
+ * @brief	A private struct to hold the state of the rollup scan operator
+ */
+struct rollupScanInfo {
+    embedDBRollup* rollup;    // Rollup being read
+    embedDBIterator* it;      // Iterator over the closed buckets, whose key bounds also apply to the open bucket
+    int8_t openBucketDone;    // 1 once the open bucket has been returned or skipped
+};
+
+void initRollupScan(embedDBOperator* operator) {
+    operator->input->init(operator->input);
+    struct rollupScanInfo* state = operator->state;
+    state->openBucketDone = 0;
+    if (operator->schema == NULL) {
+        operator->schema = copySchemaInArena(operator->arena, state->rollup->schema);
+    }
+    if (operator->recordBuffer == NULL) {
+        operator->recordBuffer = createBufferFromSchemaInArena(operator->arena, operator->schema);
+        if (operator->recordBuffer == NULL) {
+#ifdef PRINT_ERRORS
+            printf("ERROR: Failed to malloc while initializing rollup scan operator\n");
+#endif
+            return;
+        }
+    }
+}
+
+int8_t nextRollupScan(embedDBOperator* operator) {
+    struct rollupScanInfo* state = operator->state;
+    embedDBRollup* rollup = state->rollup;
+    if (operator->input->next(operator->input)) {
+        memcpy(operator->recordBuffer, operator->input->recordBuffer, getRecordSizeFromSchema(operator->schema));
+        return 1;
+    }
+
+    if (state->openBucketDone || !rollup->bucketOpen) {
+        return 0;
+    }
+    state->openBucketDone = 1;
+    embedDBState* rollupState = rollup->rollupState;
+    uint64_t openBucket = rollup->openBucket;
+    if ((state->it->minKey != NULL && rollupState->compareKey(&openBucket, state->it->minKey) < 0) ||
+        (state->it->maxKey != NULL && rollupState->compareKey(&openBucket, state->it->maxKey) > 0)) {
+        return 0;
+    }
+    rollupComputeRow(rollup, operator->recordBuffer);
+    return 1;
+}
+
+void closeRollupScan(embedDBOperator* operator) {
+    operator->input->close(operator->input);
+
+    embedDBFreeSchema(&operator->schema);
+    embedDBArenaFree(operator->arena, operator->state);
+    operator->state = NULL;
+    embedDBArenaFree(operator->arena, operator->recordBuffer);
+    operator->recordBuffer = NULL;
+}
+
+/**
+ * @brief	Creates an operator that returns the rows of the buckets matching an iterator over the rollup instance, followed by the row of the
+ * 			open bucket if its start key is within the key range of the iterator. Closed buckets are read from the rollup instance and the open
+ * 			bucket is computed from the function states, so no raw records are read. The output schema is that of the rollup rows.
+ * @param	rollup	Rollup after embedDBRollupInit
+ * @param	it		An initialized iterator over the rollup instance. Key bounds select buckets by their start key
+ */
+embedDBOperator* createRollupScanOperator(embedDBRollup* rollup, embedDBIterator* it) {
+    if (rollup == NULL || rollup->schema == NULL || it == NULL) {
+#ifdef PRINT_ERRORS
+        printf("ERROR: A rollup scan needs an initialized rollup and an iterator\n");
+#endif
+        return NULL;
+    }
+
+    embedDBOperator* scan = createTableScanOperator(rollup->rollupState, it, rollup->schema);
+    struct rollupScanInfo* state = embedDBQueryMalloc(sizeof(struct rollupScanInfo));
+    embedDBOperator* operator= embedDBCreateOperator();
+    if (scan == NULL || state == NULL || operator== NULL) {
+#ifdef PRINT_ERRORS
+        printf("ERROR: Failed to malloc while creating rollup scan operator\n");
+#endif
+        return NULL;
+    }
+    state->rollup = rollup;
+    state->it = it;
+    state->openBucketDone = 0;
+
+    operator->state = state;
+    operator->input = scan;
+    operator->schema = NULL;
+    operator->recordBuffer = NULL;
+    operator->init = initRollupScan;
+    operator->next = nextRollupScan;
+    operator->close = closeRollupScan;
+
+    return operator;
+}
@@ -0,0 +1,96 @@
+/******************************************************************************/
+/**
+ * @file        rollup.h
+ * @author      EmbedDB Team (See Authors.md)
+ * @brief       Rollups that keep bucketed aggregates of an EmbedDB instance
+ *              up to date as records are inserted.
+ * @copyright   Copyright 2024
+ *              EmbedDB Team
+ * @par Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions are met:
+ *
+ * @par 1.Redistributions of source code must retain the above copyright notice,
+ *  this list of conditions and the following disclaimer.
+ *
+ * @par 2.Redistributions in binary form must reproduce the above copyright notice,
+ *  this list of conditions and the following disclaimer in the documentation
+ *  and/or other materials provided with the distribution.
+ *
+ * @par 3.Neither the name of the copyright holder nor the names of its contributors
+ *  may be used to endorse or promote products derived from this software without
+ *  specific prior written permission.
+ *
+ * @par THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+/******************************************************************************/
+
+#ifndef _ROLLUP_H
+#define _ROLLUP_H
+
+#include "advancedQueries.h"
+
+/**
+ * @brief	Aggregates of the records of an EmbedDB instance over fixed width key buckets, kept in a second, smaller EmbedDB instance.
+ * 			Records are added to the open bucket as they are inserted, and once a record of a later bucket arrives the open bucket is
+ * 			closed and its aggregates are put into the rollup instance. The closed buckets outlive the raw records they were computed from.
+ */
+typedef struct {
+    embedDBState* source;             // Instance whose records are aggregated. Initialized by the caller
+    embedDBState* rollupState;        // Instance holding one row per closed bucket. Initialized by the caller with the key size of source and a data size that fits the function columns
+    embedDBSchema* sourceSchema;      // Schema of the source records, key column first
+    uint64_t bucketWidth;             // Width of a bucket in key units. The bucket of key k starts at k / bucketWidth * bucketWidth
+    embedDBAggregateFunc* functions;  // Aggregate functions computed for each bucket. Must not be used by other operators while the rollup is open
+    uint32_t functionsLength;         // Number of functions
+    embedDBSchema* schema;            // Schema of a row: the bucket start key, then one column for each function. Created by embedDBRollupInit
+    void* row;                        // Row of the bucket being closed
+    void* lastRecord;                 // Last record added to the open bucket, as the key followed by the data
+    uint64_t openBucket;              // Start key of the open bucket
+    int8_t bucketOpen;                // 1 if a record has been added to the open bucket
+} embedDBRollup;
+
+/**
+ * @brief	Checks the rollup configuration, adds the records of the source that are newer than the last closed bucket, and registers the
+ * 			rollup as the insert listener of the source. Used both for a new rollup and to reopen one after a restart, as the open bucket is
+ * 			rebuilt from the raw records. Both instances must already be initialized.
+ * @param	rollup	Rollup with source, rollupState, sourceSchema, bucketWidth, functions and functionsLength set
+ * @return	Return 0 if success. Non-zero value if error.
+ */
+int8_t embedDBRollupInit(embedDBRollup* rollup);
+
+/**
+ * @brief	Adds a record to the rollup, first closing the open bucket if the record belongs to a later bucket. Called by the source for each
+ * 			inserted record once the rollup is initialized.
+ * @param	rollup	Rollup after embedDBRollupInit
+ * @param	key		Key of the record. Must be larger than the keys already added
+ * @param	data	Data of the record
+ * @return	Return 0 if success. Otherwise the result of embedDBPut on the rollup instance.
+ */
+int8_t embedDBRollupAdd(embedDBRollup* rollup, void* key, void* data);
+
+/**
+ * @brief	Creates an operator that returns the rows of the buckets matching an iterator over the rollup instance, followed by the row of the
+ * 			open bucket if its start key is within the key range of the iterator. Closed buckets are read from the rollup instance and the open
+ * 			bucket is computed from the function states, so no raw records are read. The output schema is that of the rollup rows.
+ * @param	rollup	Rollup after embedDBRollupInit
+ * @param	it		An initialized iterator over the rollup instance. Key bounds select buckets by their start key
+ */
+embedDBOperator* createRollupScanOperator(embedDBRollup* rollup, embedDBIterator* it);
+
+/**
+ * @brief	Stops updating the rollup and frees the space allocated by embedDBRollupInit. The aggregates of the open bucket are not saved.
+ * 			The caller flushes and closes the rollup instance.
+ * @param	rollup	Rollup after embedDBRollupInit
+ */
+void embedDBRollupClose(embedDBRollup* rollup);
+
+#endif
@@ -40,6 +40,16 @@
 #include <stdlib.h>
 #include <string.h>
 
+/* Each thread building queries has its own arena setting on platforms with threads */
+#if defined(__unix__) || defined(__APPLE__)
+#define EMBEDDB_QUERY_THREAD_LOCAL __thread
+#else
+#define EMBEDDB_QUERY_THREAD_LOCAL
+#endif
+
+/* Arena query objects are allocated from. NULL to use malloc */
+static EMBEDDB_QUERY_THREAD_LOCAL embedDBArena* queryArena = NULL;
+
 /**
  * @brief	Create an embedDBSchema from a list of column sizes including both key and data
  * @param	numCols			The total number of columns in table
@@ -47,9 +57,13 @@
  * @param	colSignedness	An array describing if the data in the column is signed or unsigned. Use the defined constants embedDB_COLUMNN_SIGNED or embedDB_COLUMN_UNSIGNED
  */
 embedDBSchema* embedDBCreateSchema(uint8_t numCols, int8_t* colSizes, int8_t* colSignedness) {
-    embedDBSchema* schema = malloc(sizeof(embedDBSchema));
-    schema->columnSizes = malloc(numCols * sizeof(int8_t));
-    schema->numCols = numCols;
+    embedDBSchema* schema = allocateSchemaInArena(queryArena, numCols);
+    if (schema == NULL) {
+#ifdef PRINT_ERRORS
+        printf("ERROR: malloc failed while creating schema\n");
+#endif
+        return NULL;
+    }
     uint16_t totalSize = 0;
     for (uint8_t i = 0; i < numCols; i++) {
         int8_t sign = colSignedness[i];
@@ -81,8 +95,8 @@ embedDBSchema* embedDBCreateSchema(uint8_t numCols, int8_t* colSizes, int8_t* co
  */
 void embedDBFreeSchema(embedDBSchema** schema) {
     if (*schema == NULL) return;
-    free((*schema)->columnSizes);
-    free(*schema);
+    embedDBArenaFree((*schema)->arena, (*schema)->columnSizes);
+    embedDBArenaFree((*schema)->arena, *schema);
     *schema = NULL;
 }
 
@@ -90,29 +104,31 @@ void embedDBFreeSchema(embedDBSchema** schema) {
  * @brief	Uses schema to determine the length of buffer to allocate and callocs that space
  */
 void* createBufferFromSchema(embedDBSchema* schema) {
-    uint16_t totalSize = 0;
-    for (uint8_t i = 0; i < schema->numCols; i++) {
-        totalSize += abs(schema->columnSizes[i]);
-    }
-    return calloc(1, totalSize);
+    return createBufferFromSchemaInArena(queryArena, schema);
+}
+
+/**
+ * @brief	Same as createBufferFromSchema, allocating from @c arena instead of the query arena
+ */
+void* createBufferFromSchemaInArena(embedDBArena* arena, embedDBSchema* schema) {
+    return embedDBArenaCalloc(arena, getRecordSizeFromSchema(schema));
 }
 
 /**
  * @brief	Deep copy schema and return a pointer to the copy
  */
 embedDBSchema* copySchema(const embedDBSchema* schema) {
-    embedDBSchema* copy = malloc(sizeof(embedDBSchema));
+    return copySchemaInArena(queryArena, schema);
+}
+
+/**
+ * @brief	Same as copySchema, allocating the copy from @c arena instead of the query arena
+ */
+embedDBSchema* copySchemaInArena(embedDBArena* arena, const embedDBSchema* schema) {
+    embedDBSchema* copy = allocateSchemaInArena(arena, schema->numCols);
     if (copy == NULL) {
 #ifdef PRINT_ERRORS
         printf("ERROR: malloc failed while copying schema\n");
-#endif
-        return NULL;
-    }
-    copy->numCols = schema->numCols;
-    copy->columnSizes = malloc(schema->numCols * sizeof(int8_t));
-    if (copy->columnSizes == NULL) {
-#ifdef PRINT_ERRORS
-        printf("ERROR: malloc failed while copying schema\n");
 #endif
         return NULL;
     }
@@ -120,6 +136,25 @@ embedDBSchema* copySchema(const embedDBSchema* schema) {
     return copy;
 }
 
+/**
+ * @brief	Allocates a schema with room for @c numCols column sizes from @c arena, or with malloc if it is NULL. The column sizes are not set
+ * @return	The schema or NULL if there is not enough memory
+ */
+embedDBSchema* allocateSchemaInArena(embedDBArena* arena, uint8_t numCols) {
+    embedDBSchema* schema = embedDBArenaMalloc(arena, sizeof(embedDBSchema));
+    if (schema == NULL) {
+        return NULL;
+    }
+    schema->columnSizes = embedDBArenaMalloc(arena, numCols * sizeof(int8_t));
+    if (schema->columnSizes == NULL) {
+        embedDBArenaFree(arena, schema);
+        return NULL;
+    }
+    schema->numCols = numCols;
+    schema->arena = arena;
+    return schema;
+}
+
 /**
  * @brief	Finds byte offset of the column from the beginning of the record
  */
@@ -152,3 +187,115 @@ void printSchema(embedDBSchema* schema) {
     }
     printf("\n");
 }
+
+/**
+ * @brief	Sets up an arena over caller-owned memory
+ */
+void embedDBInitArena(embedDBArena* arena, void* memory, uint32_t size) {
+    arena->memory = memory;
+    arena->size = size;
+    arena->used = 0;
+    arena->numOperators = 0;
+}
+
+/**
+ * @brief	Frees everything allocated from an arena in one step
+ */
+void embedDBResetArena(embedDBArena* arena) {
+    arena->used = 0;
+    arena->numOperators = 0;
+}
+
+/**
+ * @brief	Sets the arena that schemas, operators and aggregate functions built by the calling thread are allocated from until it is changed. Each
+ * 			thread has its own arena setting. NULL (the default) allocates with malloc. Schemas and operators remember their arena, so they can be
+ * 			initialized, closed and freed after the setting changes.
+ */
+void embedDBSetQueryArena(embedDBArena* arena) {
+    queryArena = arena;
+}
+
+/**
+ * @brief	Returns the arena the calling thread set with embedDBSetQueryArena, or NULL if none is set
+ */
+embedDBArena* embedDBGetQueryArena(void) {
+    return queryArena;
+}
+
+/**
+ * @brief	Allocates memory for a query object from the query arena, or with malloc if no arena is set
+ * @return	Pointer to the memory or NULL if there is not enough
+ */
+void* embedDBQueryMalloc(uint32_t size) {
+    return embedDBArenaMalloc(queryArena, size);
+}
+
+/**
+ * @brief	Same as embedDBQueryMalloc with the memory set to zero
+ */
+void* embedDBQueryCalloc(uint32_t size) {
+    return embedDBArenaCalloc(queryArena, size);
+}
+
+/**
+ * @brief	Returns whether memory was allocated from the query arena
+ */
+int8_t embedDBInQueryArena(const void* ptr) {
+    return embedDBInArena(queryArena, ptr);
+}
+
+/**
+ * @brief	Frees memory from embedDBQueryMalloc. Memory in the query arena is only released by embedDBResetArena, so the same arena must still be
+ * 			set. Free memory that outlives a change of the setting with embedDBArenaFree and the arena it came from
+ */
+void embedDBQueryFree(void* ptr) {
+    embedDBArenaFree(queryArena, ptr);
+}
+
+/**
+ * @brief	Allocates memory from an arena, or with malloc if @c arena is NULL
+ * @return	Pointer to the memory or NULL if there is not enough
+ */
+void* embedDBArenaMalloc(embedDBArena* arena, uint32_t size) {
+    if (arena == NULL) {
+        return malloc(size);
+    }
+
+    // Keep every allocation 8 byte aligned
+    uint32_t start = (arena->used + 7) & ~(uint32_t)7;
+    if (start > arena->size || size > arena->size - start) {
+#ifdef PRINT_ERRORS
+        printf("ERROR: Query arena is full\n");
+#endif
+        return NULL;
+    }
+    arena->used = start + size;
+    return (int8_t*)arena->memory + start;
+}
+
+/**
+ * @brief	Same as embedDBArenaMalloc with the memory set to zero
+ */
+void* embedDBArenaCalloc(embedDBArena* arena, uint32_t size) {
+    void* ptr = embedDBArenaMalloc(arena, size);
+    if (ptr != NULL) {
+        memset(ptr, 0, size);
+    }
+    return ptr;
+}
+
+/**
+ * @brief	Frees memory from embedDBArenaMalloc with the same arena. Memory in the arena is only released by embedDBResetArena
+ */
+void embedDBArenaFree(embedDBArena* arena, void* ptr) {
+    if (!embedDBInArena(arena, ptr)) {
+        free(ptr);
+    }
+}
+
+/**
+ * @brief	Returns whether memory was allocated from an arena. Always 0 if @c arena is NULL
+ */
+int8_t embedDBInArena(const embedDBArena* arena, const void* ptr) {
+    return arena != NULL && (const int8_t*)ptr >= (const int8_t*)arena->memory && (const int8_t*)ptr < (const int8_t*)arena->memory + arena->size;
+}
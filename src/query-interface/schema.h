@@ -42,12 +42,24 @@
 #define embedDB_COLUMN_UNSIGNED 1
 #define embedDB_IS_COL_SIGNED(colSize) (colSize < 0 ? 1 : 0)
 
+/**
+ * @brief	A caller-owned block of memory that query objects are allocated from, front to back. Freeing single objects does nothing, the whole arena is
+ * 			reset at once. An arena must only be used by one thread at a time.
+ */
+typedef struct {
+    void* memory;           // Memory supplied by the caller
+    uint32_t size;          // Size of memory in bytes
+    uint32_t used;          // Number of bytes handed out so far
+    uint32_t numOperators;  // Operators allocated from the arena that have not been freed yet
+} embedDBArena;
+
 /**
  * @brief	A struct to desribe the number and sizes of attributes contained in the data of a embedDB table
  */
 typedef struct {
     uint8_t numCols;      // The number of columns in the table
     int8_t* columnSizes;  // A list of the sizes, in bytes, of each column. Negative numbers indicate signed columns while positive indicate an unsigned column
+    embedDBArena* arena;  // The arena the schema was allocated from, or NULL if it was allocated with malloc
 } embedDBSchema;
 
 /**
@@ -68,11 +80,27 @@ void embedDBFreeSchema(embedDBSchema** schema);
  */
 void* createBufferFromSchema(embedDBSchema* schema);
 
+/**
+ * @brief	Same as createBufferFromSchema, allocating from @c arena instead of the query arena
+ */
+void* createBufferFromSchemaInArena(embedDBArena* arena, embedDBSchema* schema);
+
 /**
  * @brief	Deep copy schema and return a pointer to the copy
  */
 embedDBSchema* copySchema(const embedDBSchema* schema);
 
+/**
+ * @brief	Same as copySchema, allocating the copy from @c arena instead of the query arena
+ */
+embedDBSchema* copySchemaInArena(embedDBArena* arena, const embedDBSchema* schema);
+
+/**
+ * @brief	Allocates a schema with room for @c numCols column sizes from @c arena, or with malloc if it is NULL. The column sizes are not set
+ * @return	The schema or NULL if there is not enough memory
+ */
+embedDBSchema* allocateSchemaInArena(embedDBArena* arena, uint8_t numCols);
+
 /**
  * @brief	Finds byte offset of the column from the beginning of the record
  */
@@ -85,4 +113,70 @@ uint16_t getRecordSizeFromSchema(embedDBSchema* schema);
 
 void printSchema(embedDBSchema* schema);
 
+
+/**
+ * @brief	Sets up an arena over caller-owned memory
+ */
+void embedDBInitArena(embedDBArena* arena, void* memory, uint32_t size);
+
+/**
+ * @brief	Frees everything allocated from an arena in one step
+ */
+void embedDBResetArena(embedDBArena* arena);
+
+/**
+ * @brief	Sets the arena that schemas, operators and aggregate functions built by the calling thread are allocated from until it is changed. Each
+ * 			thread has its own arena setting. NULL (the default) allocates with malloc. Schemas and operators remember their arena, so they can be
+ * 			initialized, closed and freed after the setting changes.
+ */
+void embedDBSetQueryArena(embedDBArena* arena);
+
+/**
+ * @brief	Returns the arena the calling thread set with embedDBSetQueryArena, or NULL if none is set
+ */
+embedDBArena* embedDBGetQueryArena(void);
+
+/**
+ * @brief	Allocates memory for a query object from the query arena, or with malloc if no arena is set
+ * @return	Pointer to the memory or NULL if there is not enough
+ */
+void* embedDBQueryMalloc(uint32_t size);
+
+/**
+ * @brief	Same as embedDBQueryMalloc with the memory set to zero
+ */
+void* embedDBQueryCalloc(uint32_t size);
+
+/**
+ * @brief	Frees memory from embedDBQueryMalloc. Memory in the query arena is only released by embedDBResetArena, so the same arena must still be
+ * 			set. Free memory that outlives a change of the setting with embedDBArenaFree and the arena it came from
+ */
+void embedDBQueryFree(void* ptr);
+
+/**
+ * @brief	Returns whether memory was allocated from the query arena
+ */
+int8_t embedDBInQueryArena(const void* ptr);
+
+/**
+ * @brief	Allocates memory from an arena, or with malloc if @c arena is NULL
+ * @return	Pointer to the memory or NULL if there is not enough
+ */
+void* embedDBArenaMalloc(embedDBArena* arena, uint32_t size);
+
+/**
+ * @brief	Same as embedDBArenaMalloc with the memory set to zero
+ */
+void* embedDBArenaCalloc(embedDBArena* arena, uint32_t size);
+
+/**
+ * @brief	Frees memory from embedDBArenaMalloc with the same arena. Memory in the arena is only released by embedDBResetArena
+ */
+void embedDBArenaFree(embedDBArena* arena, void* ptr);
+
+/**
+ * @brief	Returns whether memory was allocated from an arena. Always 0 if @c arena is NULL
+ */
+int8_t embedDBInArena(const embedDBArena* arena, const void* ptr);
+
 #endif
@@ -63,85 +63,119 @@ void radixsplineBuild(radixspline *rsidx, void **keys, uint32_t numKeys) {
 }
 
 /**
- * @brief   Rebuild the radix table with new shift amount
+ * @brief	Loads a key as an unsigned integer.
+ * @param	rsidx	Radix spline structure
+ * @param	key		Key of keySize bytes
+ */
+static inline uint64_t radixLoadKey(radixspline *rsidx, void *key) {
+    uint64_t keyVal = 0;
+    memcpy(&keyVal, key, rsidx->keySize);
+    return keyVal;
+}
+
+/**
+ * @brief	Returns the index in the spline of the point a radix table row refers to.
+ * 			Rows that refer to erased points refer to the first point. Rows past the last prefix stay UINT32_MAX.
+ * @param	rsidx	Radix spline structure
+ * @param	row		Row of the radix table
+ */
+static inline id_t radixTableEntry(radixspline *rsidx, uint32_t row) {
+    id_t pointNum;
+    memcpy(&pointNum, rsidx->table + row, sizeof(id_t));
+    if (pointNum == UINT32_MAX)
+        return UINT32_MAX;
+    return pointNum < rsidx->spl->numErased ? 0 : pointNum - rsidx->spl->numErased;
+}
+
+/**
+ * @brief   Rebuild the radix table with new shift amount. The points are not scanned again, every new row takes the old rows it covers.
  * @param   rsdix       Radix spline structure
- * @param   spl         Spline structure
  * @param   radixSize   Size of radix table
  * @param   shiftAmount Difference in shift amount between current radix table and desired radix table
  */
 void radixsplineRebuild(radixspline *rsidx, int8_t radixSize, int8_t shiftAmount) {
-    // radixsplinePrint(rsidx);
+    id_t oldPrevPrefix = rsidx->prevPrefix;
     rsidx->prevPrefix = rsidx->prevPrefix >> shiftAmount;
 
-    for (id_t i = 0; i < rsidx->size / pow(2, shiftAmount); i++) {
-        memcpy((int8_t *)rsidx->table + i * rsidx->keySize, (int8_t *)rsidx->table + (i << shiftAmount) * rsidx->keySize, rsidx->keySize);
+    /* Each new row covers 2^shiftAmount old rows and points to the last spline point seen in them */
+    for (id_t i = 0; i <= rsidx->prevPrefix; i++) {
+        id_t oldRow = ((i + 1) << shiftAmount) - 1;
+        if (oldRow > oldPrevPrefix)
+            oldRow = oldPrevPrefix;
+        rsidx->table[i] = rsidx->table[oldRow];
     }
-    uint64_t maxKey = UINT64_MAX;
-    for (id_t i = rsidx->size / pow(2, shiftAmount); i < rsidx->size; i++) {
-        memcpy((int8_t *)rsidx->table + i * rsidx->keySize, &maxKey, rsidx->keySize);
+
+    /* Rows past the old last prefix are already empty */
+    for (id_t i = rsidx->prevPrefix + 1; i <= oldPrevPrefix && i < rsidx->size; i++) {
+        rsidx->table[i] = UINT32_MAX;
     }
 }
 
 /**
- * @brief	Add a point to be indexed by the radix spline structure
- * @param	rsdix	Radix spline structure
- * @param	key		New point to be indexed by radix spline
- * @param   page    Page number for spline point to add
+ * @brief	Moves the radix table down so its first row starts at the row of the first spline point.
+ * 			Done instead of a rebuild with a larger shift when enough rows only cover erased points, so the table keeps its resolution while the oldest points are erased.
+ * @param	rsidx	Radix spline structure
+ * @return	1 if the table was moved, 0 if too few rows are before the first spline point
  */
-void radixsplineAddPoint(radixspline *rsidx, void *key, uint32_t page) {
-    splineAdd(rsidx->spl, key, page);
+static int8_t radixsplineRebase(radixspline *rsidx) {
+    uint64_t firstKey = radixLoadKey(rsidx, splinePointLocation(rsidx->spl, 0));
+    uint64_t firstRow = (firstKey - rsidx->minKey) >> rsidx->shiftSize;
+    if (firstRow == 0 || firstRow < rsidx->size / RADIX_REBASE_FRACTION)
+        return 0;
+    if (firstRow > rsidx->prevPrefix)
+        firstRow = rsidx->prevPrefix;
 
-    // Return if not using Radix table
-    if (rsidx->radixSize == 0) {
-        return;
+    memmove(rsidx->table, rsidx->table + firstRow, (rsidx->size - firstRow) * sizeof(id_t));
+    for (uint32_t i = rsidx->size - (uint32_t)firstRow; i < rsidx->size; i++) {
+        rsidx->table[i] = UINT32_MAX;
     }
+    rsidx->prevPrefix -= (id_t)firstRow;
+    rsidx->minKey += firstRow << rsidx->shiftSize;
+    return 1;
+}
 
-    // Determine if need to update radix table based on adding point to spline
-    if (rsidx->spl->count <= rsidx->pointsSeen)
-        return;  // Nothing to do
+/**
+ * @brief	Returns the shift needed for the prefix of a key difference to fit in the radix table.
+ * @param	rsidx	Radix spline structure
+ * @param	keyDiff	Difference between a key and the key of the first row
+ */
+static int8_t radixShiftForKeyDiff(radixspline *rsidx, uint64_t keyDiff) {
+    int8_t bitsToRepresentKey = 0;
+    while (bitsToRepresentKey < 64 && (keyDiff >> bitsToRepresentKey) != 0)
+        bitsToRepresentKey++;
+    return bitsToRepresentKey > rsidx->radixSize ? bitsToRepresentKey - rsidx->radixSize : 0;
+}
 
-    // take the last point that was added to spline
-    key = splinePointLocation(rsidx->spl, rsidx->spl->count - 1);
+/**
+ * @brief	Adds the rows for a spline point to the radix table.
+ * @param	rsidx	Radix spline structure
+ * @param	point	Spline point numbered pointsSeen
+ */
+static void radixsplineAddRow(radixspline *rsidx, void *point) {
+    uint64_t keyVal = radixLoadKey(rsidx, point);
 
     // Initialize table and minKey on first key added
-    if (rsidx->pointsSeen == 0) {
+    if (rsidx->table == NULL) {
         rsidx->table = malloc(sizeof(id_t) * rsidx->size);
         uint64_t maxKey = UINT64_MAX;
         for (int32_t counter = 1; counter < rsidx->size; counter++) {
             memcpy(rsidx->table + counter, &maxKey, sizeof(id_t));
         }
-        rsidx->minKey = key;
+        rsidx->minKey = keyVal;
     }
 
     // Check if prefix will fit in radix table
-    uint64_t keyDiff;
-    if (rsidx->keySize <= 4) {
-        uint32_t keyVal = 0, minKeyVal = 0;
-        memcpy(&keyVal, key, rsidx->keySize);
-        memcpy(&minKeyVal, rsidx->minKey, rsidx->keySize);
-        keyDiff = keyVal - minKeyVal;
-    } else {
-        uint64_t keyVal = 0, minKeyVal = 0;
-        memcpy(&keyVal, key, rsidx->keySize);
-        memcpy(&minKeyVal, rsidx->minKey, rsidx->keySize);
-        keyDiff = keyVal - minKeyVal;
-    }
-
-    uint8_t bitsToRepresentKey = ceil(log2f((float)keyDiff));
-    int8_t newShiftSize;
-    if (bitsToRepresentKey < rsidx->radixSize) {
-        newShiftSize = 0;
-    } else {
-        newShiftSize = bitsToRepresentKey - rsidx->radixSize;
-    }
+    int8_t newShiftSize = radixShiftForKeyDiff(rsidx, keyVal - rsidx->minKey);
 
-    // if the shift size changes, need to remake table from scratch using new shift size
+    // If the table is full, move it past the erased points or coalesce rows for a larger shift
+    if (newShiftSize > rsidx->shiftSize && radixsplineRebase(rsidx))
+        newShiftSize = radixShiftForKeyDiff(rsidx, keyVal - rsidx->minKey);
     if (newShiftSize > rsidx->shiftSize) {
         radixsplineRebuild(rsidx, rsidx->radixSize, newShiftSize - rsidx->shiftSize);
         rsidx->shiftSize = newShiftSize;
     }
 
-    id_t prefix = keyDiff >> rsidx->shiftSize;
+    id_t prefix = (keyVal - rsidx->minKey) >> rsidx->shiftSize;
     if (prefix != rsidx->prevPrefix) {
         // Make all new rows in the radix table point to the last point seen
         for (id_t pr = rsidx->prevPrefix; pr < prefix; pr++) {
@@ -156,6 +190,30 @@ void radixsplineAddPoint(radixspline *rsidx, void *key, uint32_t page) {
     rsidx->pointsSeen++;
 }
 
+/**
+ * @brief	Add a point to be indexed by the radix spline structure
+ * @param	rsdix	Radix spline structure
+ * @param	key		New point to be indexed by radix spline
+ * @param   page    Page number for spline point to add
+ */
+void radixsplineAddPoint(radixspline *rsidx, void *key, uint32_t page) {
+    splineAdd(rsidx->spl, key, page);
+
+    // Return if not using Radix table
+    if (rsidx->radixSize == 0) {
+        return;
+    }
+
+    // Only final points are in the radix table. The temporary last point moves with every key added. Erased points keep their numbers
+    spline *spl = rsidx->spl;
+    id_t numFinalPoints = spl->numErased + spl->count - (spl->tempLastPoint != 0 && spl->count > 0 ? 1 : 0);
+    if (rsidx->pointsSeen < spl->numErased)
+        rsidx->pointsSeen = spl->numErased;
+    while (rsidx->pointsSeen < numFinalPoints) {
+        radixsplineAddRow(rsidx, splinePointLocation(spl, rsidx->pointsSeen - spl->numErased));
+    }
+}
+
 /**
  * @brief	Initialize an empty radix spline index of given size
  * @param	rsdix		Radix spline structure
@@ -171,7 +229,8 @@ void radixsplineInit(radixspline *rsidx, spline *spl, int8_t radixSize, uint8_t
     rsidx->size = pow(2, radixSize);
 
     /* Determine the prefix size (shift bits) based on min and max keys */
-    rsidx->minKey = spl->points;
+    rsidx->minKey = 0;
+    rsidx->table = NULL;
 
     /* Initialize points seen */
     rsidx->pointsSeen = 0;
@@ -184,7 +243,7 @@ void radixsplineInit(radixspline *rsidx, spline *spl, int8_t radixSize, uint8_t
  * @param	low		    Lower search bound (Index of spline point)
  * @param	high	    Higher search bound (Index of spline point)
  * @param	key		    Key to search for
- * @param	compareKey	Function to compare keys
+ * @param	compareKey	Function to compare keys, or NULL to compare keys as unsigned integers
  * @return	Index of spline point that is the upper end of the spline segment that contains the key
  */
 size_t radixBinarySearch(radixspline *rsidx, int low, int high, void *key, int8_t compareKey(void *, void *)) {
@@ -195,10 +254,10 @@ size_t radixBinarySearch(radixspline *rsidx, int low, int high, void *key, int8_
         mid = low + (high - low) / 2;
         void *midKey = splinePointLocation(rsidx->spl, mid);
         void *midKeyMinusOne = splinePointLocation(rsidx->spl, mid - 1);
-        if (compareKey(midKey, key) >= 0 && compareKey(midKeyMinusOne, key) <= 0)
+        if (splineCompareKeys(rsidx->spl, midKey, key, compareKey) >= 0 && splineCompareKeys(rsidx->spl, midKeyMinusOne, key, compareKey) <= 0)
             return mid;
 
-        if (compareKey(midKey, key) > 0)
+        if (splineCompareKeys(rsidx->spl, midKey, key, compareKey) > 0)
             return radixBinarySearch(rsidx, low, mid - 1, key, compareKey);
 
         return radixBinarySearch(rsidx, mid + 1, high, key, compareKey);
@@ -229,32 +288,34 @@ void radixsplineInitBuild(radixspline *rsidx, spline *spl, uint32_t radixSize, v
 /**
  * @brief	Returns the radix index that is end of spline segment containing key using radix table.
  * @param	rsidx	    Radix spline structure
- * @param	key		    Search key
- * @param	compareKey	Function to compare keys
+ * @param	key		    Search key. Must not be smaller than the first spline point
+ * @param	compareKey	Function to compare keys, or NULL to compare keys as unsigned integers
  * @return	Index of spline point that is the upper end of the spline segment that contains the key
  */
 size_t radixsplineGetEntry(radixspline *rsidx, void *key, int8_t compareKey(void *, void *)) {
     /* Use radix table to find range of spline points */
-
-    uint64_t keyVal = 0, minKeyVal = 0;
-    memcpy(&keyVal, key, rsidx->keySize);
-    memcpy(&minKeyVal, rsidx->minKey, rsidx->keySize);
-
-    uint32_t prefix = (keyVal - minKeyVal) >> rsidx->shiftSize;
+    uint64_t keyDiff = radixLoadKey(rsidx, key) - rsidx->minKey;
+    uint64_t keyPrefix = keyDiff >> rsidx->shiftSize;
+    /* Keys past the last row are in the last row */
+    uint32_t prefix = keyPrefix < rsidx->size ? (uint32_t)keyPrefix : rsidx->size - 1;
 
     uint32_t begin, end;
 
     // Determine end, use next higher radix point if within bounds, unless key is exactly prefix
-    if (keyVal == ((uint64_t)prefix << rsidx->shiftSize)) {
-        memcpy(&end, rsidx->table + prefix, sizeof(id_t));
+    uint32_t endRow;
+    if (keyDiff == ((uint64_t)prefix << rsidx->shiftSize)) {
+        endRow = prefix;
     } else {
         if ((prefix + 1) < rsidx->size) {
-            memcpy(&end, rsidx->table + (prefix + 1), sizeof(id_t));
+            endRow = prefix + 1;
         } else {
-            memcpy(&end, rsidx->table + (rsidx->size - 1), sizeof(id_t));
+            endRow = rsidx->size - 1;
         }
     }
 
+    // The temporary last spline point is after the point of the last row
+    end = endRow >= rsidx->prevPrefix ? UINT32_MAX : radixTableEntry(rsidx, endRow);
+
     // check end is in bounds since radix table values are initiated to INT_MAX
     if (end >= rsidx->spl->count) {
         end = rsidx->spl->count - 1;
@@ -264,8 +325,10 @@ size_t radixsplineGetEntry(radixspline *rsidx, void *key, int8_t compareKey(void
     if (prefix == 0) {
         begin = 0;
     } else {
-        memcpy(&begin, rsidx->table + (prefix - 1), sizeof(id_t));
+        begin = radixTableEntry(rsidx, prefix - 1);
     }
+    if (begin > end)
+        begin = end;
 
     return radixBinarySearch(rsidx, begin, end, key, compareKey);
 }
@@ -274,7 +337,7 @@ size_t radixsplineGetEntry(radixspline *rsidx, void *key, int8_t compareKey(void
  * @brief	Returns the radix index that is end of spline segment containing key using binary search.
  * @param	rsidx	    Radix spline structure
  * @param	key		    Search key
- * @param	compareKey	Function to compare keys
+ * @param	compareKey	Function to compare keys, or NULL to compare keys as unsigned integers
  * @return  Index of spline point that is the upper end of the spline segment that contains the key
  */
 size_t radixsplineGetEntryBinarySearch(radixspline *rsidx, void *key, int8_t compareKey(void *, void *)) {
@@ -285,16 +348,11 @@ size_t radixsplineGetEntryBinarySearch(radixspline *rsidx, void *key, int8_t com
  * @brief	Estimate location of key in data using spline points.
  * @param	rsidx	Radix spline structure
  * @param	key		Search key
- * @param	compareKey	Function to compare keys
+ * @param	compareKey	Function to compare keys, or NULL to compare keys as unsigned integers
  * @return	Estimated page number that contains key
  */
 size_t radixsplineEstimateLocation(radixspline *rsidx, void *key, int8_t compareKey(void *, void *)) {
-    uint64_t keyVal = 0, minKeyVal = 0;
-    memcpy(&keyVal, key, rsidx->keySize);
-    memcpy(&minKeyVal, rsidx->minKey, rsidx->keySize);
-
-    if (keyVal < minKeyVal)
-        return 0;
+    uint64_t keyVal = radixLoadKey(rsidx, key);
 
     size_t index;
     if (rsidx->radixSize == 0) {
@@ -304,6 +362,8 @@ size_t radixsplineEstimateLocation(radixspline *rsidx, void *key, int8_t compare
         /* Get index using radix table */
         index = radixsplineGetEntry(rsidx, key, compareKey);
     }
+    if (index == 0)
+        index = 1;
 
     /* Interpolate between two spline points */
     void *down = splinePointLocation(rsidx->spl, index - 1);
@@ -327,12 +387,20 @@ size_t radixsplineEstimateLocation(radixspline *rsidx, void *key, int8_t compare
  * @brief	Finds a value using index. Returns predicted location and low and high error bounds.
  * @param	rsidx	    Radix spline structure
  * @param	key		    Search key
- * @param   compareKey  Function to compare keys
+ * @param   compareKey  Function to compare keys, or NULL to compare keys as unsigned integers
  * @param	loc		    Return of predicted location
  * @param	low		    Return of low bound on predicted location
  * @param	high	    Return of high bound on predicted location
  */
 void radixsplineFind(radixspline *rsidx, void *key, int8_t compareKey(void *, void *), id_t *loc, id_t *low, id_t *high) {
+    /* Keys outside of the spline points are not in a segment */
+    if (rsidx->spl->count < 2 ||
+        splineCompareKeys(rsidx->spl, key, splinePointLocation(rsidx->spl, 0), compareKey) < 0 ||
+        splineCompareKeys(rsidx->spl, key, splinePointLocation(rsidx->spl, rsidx->spl->count - 1), compareKey) > 0) {
+        splineFind(rsidx->spl, key, compareKey, loc, low, high);
+        return;
+    }
+
     /* Estimate location */
     id_t locationEstimate = radixsplineEstimateLocation(rsidx, key, compareKey);
     memcpy(loc, &locationEstimate, sizeof(id_t));
@@ -341,9 +409,9 @@ void radixsplineFind(radixspline *rsidx, void *key, int8_t compareKey(void *, vo
     id_t lowEstimate = (rsidx->spl->maxError > locationEstimate) ? 0 : locationEstimate - rsidx->spl->maxError;
     memcpy(low, &lowEstimate, sizeof(id_t));
     void *lastSplinePoint = splinePointLocation(rsidx->spl, rsidx->spl->count - 1);
-    uint64_t lastKey = 0;
-    memcpy(&lastKey, lastSplinePoint, rsidx->keySize);
-    id_t highEstimate = (locationEstimate + rsidx->spl->maxError > lastKey) ? lastKey : locationEstimate + rsidx->spl->maxError;
+    uint32_t lastPage = 0;
+    memcpy(&lastPage, (int8_t *)lastSplinePoint + rsidx->spl->keySize, sizeof(uint32_t));
+    id_t highEstimate = (locationEstimate + rsidx->spl->maxError > lastPage) ? lastPage : locationEstimate + rsidx->spl->maxError;
     memcpy(high, &highEstimate, sizeof(id_t));
 }
 
@@ -359,9 +427,8 @@ void radixsplinePrint(radixspline *rsidx) {
 
     printf("Radix table (%u):\n", rsidx->size);
     // for (id_t i=0; i < 20; i++)
-    uint64_t minKeyVal = 0;
+    uint64_t minKeyVal = rsidx->minKey;
     id_t tableVal;
-    memcpy(&minKeyVal, rsidx->minKey, rsidx->keySize);
     for (id_t i = 0; i < rsidx->size; i++) {
         printf("[" TO_BINARY_PATTERN "] ", TO_BINARY((uint8_t)(i)));
         memcpy(&tableVal, rsidx->table + i, sizeof(id_t));
@@ -375,7 +442,7 @@ void radixsplinePrint(radixspline *rsidx) {
  * @param	rsidx	Radix spline structure
  */
 size_t radixsplineSize(radixspline *rsidx) {
-    return sizeof(rsidx) + rsidx->size * sizeof(uint32_t) + splineSize(rsidx->spl);
+    return sizeof(radixspline) + rsidx->size * sizeof(uint32_t) + splineSize(rsidx->spl);
 }
 
 /**
@@ -64,13 +64,16 @@ typedef struct radixspline_s radixspline;
 
 #include "spline.h"
 
+/* A full radix table is moved down instead of coalesced when at least 1/REBASE_FRACTION of its rows are before the first spline point */
+#define RADIX_REBASE_FRACTION 4
+
 struct radixspline_s {
     spline *spl;      /* Spline with spline points */
     uint32_t size;    /* Size of radix table */
-    id_t *table;      /* Radix table */
+    id_t *table;      /* Radix table. Rows hold the number of a spline point, which is spl->numErased plus its index */
     int8_t shiftSize; /* Size of prefix/shift (in bits) */
     int8_t radixSize; /* Size of radix (in bits) */
-    void *minKey;     /* Minimum key */
+    uint64_t minKey;  /* Key of the first row of the radix table */
     id_t prevPrefix;  /* Prefix of most recently seen spline point */
     id_t pointsSeen;  /* Number of data points added to radix */
     uint8_t keySize;  /* Size of key in bytes */
@@ -121,7 +124,7 @@ void radixsplineAddPoint(radixspline *rsidx, void *key, uint32_t page);
  * @brief	Finds a value using index. Returns predicted location and low and high error bounds.
  * @param	rsidx	    Radix spline structure
  * @param	key		    Search key
- * @param   compareKey  Function to compare keys
+ * @param   compareKey  Function to compare keys, or NULL to compare keys as unsigned integers
  * @param	loc		    Return of predicted location
  * @param	low		    Return of low bound on predicted location
  * @param	high	    Return of high bound on predicted location
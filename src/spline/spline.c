@@ -69,6 +69,7 @@ int8_t splineInit(spline *spl, id_t size, size_t maxError, uint8_t keySize) {
     spl->upper = malloc(pointSize);
     spl->firstSplinePoint = malloc(pointSize);
     spl->numAddCalls = 0;
+    spl->numErased = 0;
     return 0;
 }
 
@@ -163,6 +164,9 @@ void splineAdd(spline *spl, void *key, uint32_t page) {
     if (splineIsLeft(xdiff, ydiff, upperXDiff, upperYDiff) == 1 ||
         splineIsRight(xdiff, ydiff, lowerXDiff, lowerYDiff) == 1) {
         /* Point is not in error corridor. Add previous point to spline. */
+        /* Leave room for the temporary last point, so it does not overwrite the first point */
+        if (spl->count + 2 > spl->size)
+            splineErase(spl, spl->eraseSize);
         void *nextSplinePoint = splinePointLocation(spl, spl->count);
         memcpy(nextSplinePoint, spl->lastKey, spl->keySize);
         memcpy((int8_t *)nextSplinePoint + spl->keySize, &spl->lastLoc, sizeof(uint32_t));
@@ -222,6 +226,7 @@ int splineErase(spline *spl, uint32_t numPoints) {
 
     spl->count -= numPoints;
     spl->pointsStartIndex = (spl->pointsStartIndex + numPoints) % spl->size;
+    spl->numErased += numPoints;
     if (spl->count == 0)
         spl->numAddCalls = 0;
     return 0;
@@ -277,6 +282,23 @@ uint32_t splineSize(spline *spl) {
     return sizeof(spline) + (spl->size * (spl->keySize + sizeof(uint32_t)));
 }
 
+/**
+ * @brief	Compares two keys with the key comparator, or as unsigned integers if the comparator is NULL
+ * @param	spl			Spline structure
+ * @param	a			First key
+ * @param	b			Second key
+ * @param	compareKey	Function to compare keys, or NULL to compare keys as unsigned integers
+ * @return	Negative if a < b, 0 if a == b, positive if a > b
+ */
+int8_t splineCompareKeys(spline *spl, void *a, void *b, int8_t compareKey(void *, void *)) {
+    if (compareKey != NULL)
+        return compareKey(a, b);
+    uint64_t keyA = 0, keyB = 0;
+    memcpy(&keyA, a, spl->keySize);
+    memcpy(&keyB, b, spl->keySize);
+    return (keyA > keyB) - (keyA < keyB);
+}
+
 /**
  * @brief	Performs a recursive binary search on the spine points for a key
  * @param	arr			Array of spline points to search through
@@ -299,10 +321,10 @@ size_t pointsBinarySearch(spline *spl, int low, int high, void *key, int8_t comp
         void *midSplinePoint = splinePointLocation(spl, mid);
         void *midSplineMinusOnePoint = splinePointLocation(spl, mid - 1);
 
-        if (compareKey(midSplinePoint, key) >= 0 && compareKey(midSplineMinusOnePoint, key) <= 0)
+        if (splineCompareKeys(spl, midSplinePoint, key, compareKey) >= 0 && splineCompareKeys(spl, midSplineMinusOnePoint, key, compareKey) <= 0)
             return mid;
 
-        if (compareKey(midSplinePoint, key) > 0)
+        if (splineCompareKeys(spl, midSplinePoint, key, compareKey) > 0)
             return pointsBinarySearch(spl, low, mid - 1, key, compareKey);
 
         return pointsBinarySearch(spl, mid + 1, high, key, compareKey);
@@ -320,7 +342,7 @@ size_t pointsBinarySearch(spline *spl, int low, int high, void *key, int8_t comp
  * @brief	Estimate the page number of a given key
  * @param	spl			The spline structure to search
  * @param	key			The key to search for
- * @param	compareKey	Function to compare keys
+ * @param	compareKey	Function to compare keys, or NULL to compare keys as unsigned integers
  * @param	loc			A return value for the best estimate of which page the key is on
  * @param	low			A return value for the smallest page that it could be on
  * @param	high		A return value for the largest page it could be on
@@ -334,7 +356,7 @@ void splineFind(spline *spl, void *key, int8_t compareKey(void *, void *), id_t
     memcpy(&smallestKeyVal, smallestSplinePoint, spl->keySize);
     memcpy(&largestKeyVal, largestSplinePoint, spl->keySize);
 
-    if (compareKey(key, splinePointLocation(spl, 0)) < 0 || spl->count <= 1) {
+    if (splineCompareKeys(spl, key, splinePointLocation(spl, 0), compareKey) < 0 || spl->count <= 1) {
         // Key is smaller than any we have on record
         uint32_t lowEstimate, highEstimate, locEstimate = 0;
         memcpy(&lowEstimate, (int8_t *)spl->firstSplinePoint + spl->keySize, sizeof(uint32_t));
@@ -345,7 +367,7 @@ void splineFind(spline *spl, void *key, int8_t compareKey(void *, void *), id_t
         memcpy(low, &lowEstimate, sizeof(uint32_t));
         memcpy(high, &highEstimate, sizeof(uint32_t));
         return;
-    } else if (compareKey(key, splinePointLocation(spl, spl->count - 1)) > 0) {
+    } else if (splineCompareKeys(spl, key, splinePointLocation(spl, spl->count - 1), compareKey) > 0) {
         memcpy(loc, (int8_t *)largestSplinePoint + spl->keySize, sizeof(uint32_t));
         memcpy(low, (int8_t *)largestSplinePoint + spl->keySize, sizeof(uint32_t));
         memcpy(high, (int8_t *)largestSplinePoint + spl->keySize, sizeof(uint32_t));
@@ -63,6 +63,7 @@ struct spline_s {
     uint32_t maxError;       /* Maximum error */
     uint32_t numAddCalls;    /* Number of times the add method has been called */
     uint32_t tempLastPoint;  /* Last spline point is temporary if value is not 0 */
+    uint32_t numErased;      /* Number of points removed by splineErase. A point keeps the number numErased plus its index */
     uint8_t keySize;         /* Size of key in bytes */
 };
 
@@ -111,13 +112,23 @@ uint32_t splineSize(spline *spl);
  * @brief	Estimate the page number of a given key
  * @param	spl			The spline structure to search
  * @param	key			The key to search for
- * @param	compareKey	Function to compare keys
+ * @param	compareKey	Function to compare keys, or NULL to compare keys as unsigned integers
  * @param	loc			A return value for the best estimate of which page the key is on
  * @param	low			A return value for the smallest page that it could be on
  * @param	high		A return value for the largest page it could be on
  */
 void splineFind(spline *spl, void *key, int8_t compareKey(void *, void *), id_t *loc, id_t *low, id_t *high);
 
+/**
+ * @brief	Compares two keys with the key comparator, or as unsigned integers if the comparator is NULL
+ * @param	spl			Spline structure
+ * @param	a			First key
+ * @param	b			Second key
+ * @param	compareKey	Function to compare keys, or NULL to compare keys as unsigned integers
+ * @return	Negative if a < b, 0 if a == b, positive if a > b
+ */
+int8_t splineCompareKeys(spline *spl, void *a, void *b, int8_t compareKey(void *, void *));
+
 /**
  * @brief    Free memory allocated for spline structure.
  * @param    spl        Spline structure
@@ -52,6 +52,9 @@ void* nextRecord(DataSource* source);
 uint32_t dayGroup(const void* record);
 int8_t sameDayGroup(const void* lastRecord, const void* record);
 void writeDayGroup(embedDBAggregateFunc* aggFunc, embedDBSchema* schema, void* recordBuffer, const void* lastRecord);
+void tempBucketKey(const void* record, void* key);
+void writeTempBucket(embedDBAggregateFunc* aggFunc, embedDBSchema* schema, void* recordBuffer, const void* lastRecord);
+void checkHashAggregate(uint32_t memoryBudget);
 void customShiftInit(embedDBOperator* operator);
 int8_t customShiftNext(embedDBOperator* operator);
 void customShiftClose(embedDBOperator* operator);
@@ -196,6 +199,272 @@ void test_selection() {
     TEST_ASSERT_EQUAL_INT32_MESSAGE(4, recordsReturned, "Selection didn't return the right number of records");
 }
 
+void test_selection_pushdown() {
+    embedDBIterator it;
+    it.minKey = NULL;
+    it.maxKey = NULL;
+    it.minData = NULL;
+    it.maxData = NULL;
+    embedDBInitIterator(stateUWA, &it);
+
+    /* Key range and data predicates are moved into the iterator, the range on column 3 is not */
+    uint32_t minKey = 947920860, maxKey = 949122660;
+    int32_t minTemp = 450, minWind = 20;
+    embedDBOperator* scanOp = createTableScanOperator(stateUWA, &it, baseSchema);
+    embedDBOperator* selectMin = createSelectionOperator(scanOp, 0, SELECT_GTE, &minKey);
+    embedDBOperator* selectMax = createSelectionOperator(selectMin, 0, SELECT_LT, &maxKey);
+    embedDBOperator* selectTemp = createSelectionOperator(selectMax, 1, SELECT_GTE, &minTemp);
+    embedDBOperator* selectWind = createSelectionOperator(selectTemp, 3, SELECT_GT, &minWind);
+    selectWind->init(selectWind);
+
+    TEST_ASSERT_EQUAL_UINT32(minKey, *(uint32_t*)it.minKey);
+    TEST_ASSERT_EQUAL_UINT32(maxKey, *(uint32_t*)it.maxKey);
+    TEST_ASSERT_EQUAL_INT32(minTemp, *(int32_t*)it.minData);
+    TEST_ASSERT_NULL(it.maxData);
+
+    uint32_t numReads = stateUWA->numReads;
+    int32_t recordsReturned = 0;
+    int32_t* recordBuffer = selectWind->recordBuffer;
+    while (exec(selectWind)) {
+        recordsReturned++;
+        int32_t* expectedRecord = (int32_t*)nextRecord(uwaData);
+        while ((uint32_t)expectedRecord[0] < minKey || expectedRecord[1] < minTemp || expectedRecord[3] <= minWind) {
+            expectedRecord = (int32_t*)nextRecord(uwaData);
+        }
+        TEST_ASSERT_EQUAL_UINT32_MESSAGE(expectedRecord[0], recordBuffer[0], "First column is wrong");
+        TEST_ASSERT_EQUAL_INT32_MESSAGE(expectedRecord[1], recordBuffer[1], "Second column is wrong");
+        TEST_ASSERT_EQUAL_INT32_MESSAGE(expectedRecord[3], recordBuffer[3], "Fourth column is wrong");
+    }
+    uint32_t pagesRead = stateUWA->numReads - numReads;
+
+    selectWind->close(selectWind);
+    embedDBFreeOperatorRecursive(&selectWind);
+    embedDBCloseIterator(&it);
+
+    /* Only the pages of the key range are read, not the whole table */
+    int32_t expected = 0;
+    fseek(uwaData->fp, 0, SEEK_SET);
+    uwaData->pageRecord = EMBEDDB_GET_COUNT(uwaData->pageBuffer);
+    for (int32_t* record = nextRecord(uwaData); record != NULL; record = nextRecord(uwaData)) {
+        expected += (uint32_t)record[0] >= minKey && (uint32_t)record[0] < maxKey && record[1] >= minTemp && record[3] > minWind;
+    }
+    TEST_ASSERT_EQUAL_INT32_MESSAGE(expected, recordsReturned, "Selection didn't return the right number of records");
+    TEST_ASSERT_TRUE(pagesRead * 10 < stateUWA->nextDataPageId);
+}
+
+void test_batch_execution() {
+    embedDBIterator it;
+    it.minKey = NULL;
+    it.maxKey = NULL;
+    it.minData = NULL;
+    it.maxData = NULL;
+    embedDBInitIterator(stateUWA, &it);
+
+    int32_t minTemp = 450, minWind = 20;
+    embedDBOperator* scanOp = createTableScanOperator(stateUWA, &it, baseSchema);
+    embedDBOperator* selectTemp = createSelectionOperator(scanOp, 1, SELECT_GTE, &minTemp);
+    embedDBOperator* selectWind = createSelectionOperator(selectTemp, 3, SELECT_GT, &minWind);
+    uint8_t projCols[] = {0, 3};
+    embedDBOperator* projOp = createProjectionOperator(selectWind, 2, projCols);
+    projOp->init(projOp);
+
+    /* An odd capacity makes selected records straddle batches */
+    embedDBBatch* batch = embedDBCreateBatch(projOp, 7);
+    TEST_ASSERT_NOT_NULL(batch);
+
+    int32_t recordsReturned = 0;
+    while (execBatch(projOp, batch)) {
+        TEST_ASSERT_TRUE(batch->numSelected <= 7);
+        TEST_ASSERT_EQUAL_UINT16(8, batch->recordSize);
+        for (uint16_t i = 0; i < batch->numSelected; i++) {
+            int32_t* record = (int32_t*)((int8_t*)batch->records + batch->selection[i] * batch->recordSize);
+            int32_t* expectedRecord = (int32_t*)nextRecord(uwaData);
+            while (expectedRecord[1] < minTemp || expectedRecord[3] <= minWind) {
+                expectedRecord = (int32_t*)nextRecord(uwaData);
+            }
+            TEST_ASSERT_EQUAL_UINT32_MESSAGE(expectedRecord[0], record[0], "First column is wrong");
+            TEST_ASSERT_EQUAL_INT32_MESSAGE(expectedRecord[3], record[1], "Second column is wrong");
+            recordsReturned++;
+        }
+    }
+
+    embedDBFreeBatch(&batch);
+    TEST_ASSERT_NULL(batch);
+    projOp->close(projOp);
+    embedDBFreeOperatorRecursive(&projOp);
+    embedDBCloseIterator(&it);
+
+    int32_t expected = 0;
+    fseek(uwaData->fp, 0, SEEK_SET);
+    uwaData->pageRecord = EMBEDDB_GET_COUNT(uwaData->pageBuffer);
+    for (int32_t* record = nextRecord(uwaData); record != NULL; record = nextRecord(uwaData)) {
+        expected += record[1] >= minTemp && record[3] > minWind;
+    }
+    TEST_ASSERT_EQUAL_INT32_MESSAGE(expected, recordsReturned, "Batches didn't return the right number of records");
+}
+
+void test_operators_from_arena() {
+    embedDBIterator it;
+    it.minKey = NULL;
+    it.maxKey = NULL;
+    it.minData = NULL;
+    it.maxData = NULL;
+    embedDBInitIterator(stateUWA, &it);
+
+    int64_t memory[256];
+    embedDBArena arena;
+    embedDBInitArena(&arena, memory, sizeof(memory));
+    embedDBSetQueryArena(&arena);
+
+    embedDBOperator* scanOp = createTableScanOperator(stateUWA, &it, baseSchema);
+    int32_t selVal = 200;
+    embedDBOperator* selectOp = createSelectionOperator(scanOp, 3, SELECT_GTE, &selVal);
+    uint8_t projCols[] = {0, 1, 3};
+    embedDBOperator* projOp = createProjectionOperator(selectOp, 3, projCols);
+    projOp->init(projOp);
+    TEST_ASSERT_TRUE(embedDBInQueryArena(projOp));
+    TEST_ASSERT_TRUE(embedDBInQueryArena(projOp->recordBuffer));
+    TEST_ASSERT_TRUE(embedDBInQueryArena(scanOp->schema));
+    TEST_ASSERT_TRUE(arena.used > 0);
+
+    int32_t recordsReturned = 0;
+    int32_t* recordBuffer = projOp->recordBuffer;
+    while (exec(projOp)) {
+        recordsReturned++;
+        int32_t* expectedRecord = (int32_t*)nextRecord(uwaData);
+        while (expectedRecord[3] < selVal) {
+            expectedRecord = (int32_t*)nextRecord(uwaData);
+        }
+        TEST_ASSERT_EQUAL_UINT32_MESSAGE(expectedRecord[0], recordBuffer[0], "First column is wrong");
+        TEST_ASSERT_EQUAL_UINT32_MESSAGE(expectedRecord[3], recordBuffer[2], "Third column is wrong");
+    }
+
+    // Freeing the chain resets the arena
+    projOp->close(projOp);
+    embedDBFreeOperatorRecursive(&projOp);
+    TEST_ASSERT_NULL(projOp);
+    TEST_ASSERT_EQUAL_UINT32(0, arena.used);
+
+    // Allocations that don't fit fail instead of overrunning the arena
+    TEST_ASSERT_NULL(embedDBQueryMalloc(sizeof(memory) + 1));
+    embedDBSetQueryArena(NULL);
+    embedDBCloseIterator(&it);
+    TEST_ASSERT_TRUE(recordsReturned > 0);
+}
+
+void test_arena_shared_by_two_chains() {
+    embedDBIterator it1, it2;
+    it1.minKey = it2.minKey = NULL;
+    it1.maxKey = it2.maxKey = NULL;
+    it1.minData = it2.minData = NULL;
+    it1.maxData = it2.maxData = NULL;
+    embedDBInitIterator(stateUWA, &it1);
+    embedDBInitIterator(stateUWA, &it2);
+
+    int64_t memory[256];
+    embedDBArena arena;
+    embedDBInitArena(&arena, memory, sizeof(memory));
+    embedDBSetQueryArena(&arena);
+
+    int32_t selVal = 200;
+    embedDBOperator* scan1 = createTableScanOperator(stateUWA, &it1, baseSchema);
+    embedDBOperator* select1 = createSelectionOperator(scan1, 3, SELECT_GTE, &selVal);
+    embedDBOperator* scan2 = createTableScanOperator(stateUWA, &it2, baseSchema);
+    TEST_ASSERT_EQUAL_PTR(&arena, select1->arena);
+    TEST_ASSERT_EQUAL_UINT32(3, arena.numOperators);
+    select1->init(select1);
+    scan2->init(scan2);
+
+    // Freeing one chain leaves the other one in the arena
+    select1->close(select1);
+    embedDBFreeOperatorRecursive(&select1);
+    TEST_ASSERT_EQUAL_UINT32(1, arena.numOperators);
+    TEST_ASSERT_TRUE(arena.used > 0);
+
+    int32_t recordsReturned = 0;
+    int32_t* recordBuffer = scan2->recordBuffer;
+    while (exec(scan2)) {
+        int32_t* expectedRecord = (int32_t*)nextRecord(uwaData);
+        TEST_ASSERT_EQUAL_UINT32_MESSAGE(expectedRecord[0], recordBuffer[0], "First column is wrong");
+        recordsReturned++;
+    }
+    TEST_ASSERT_TRUE(recordsReturned > 0);
+
+    // The arena is reset with its last operator
+    scan2->close(scan2);
+    embedDBFreeOperatorRecursive(&scan2);
+    TEST_ASSERT_EQUAL_UINT32(0, arena.numOperators);
+    TEST_ASSERT_EQUAL_UINT32(0, arena.used);
+
+    embedDBSetQueryArena(NULL);
+    embedDBCloseIterator(&it1);
+    embedDBCloseIterator(&it2);
+}
+
+void test_tree_used_with_another_arena_set() {
+    embedDBIterator it1, it2;
+    it1.minKey = it2.minKey = NULL;
+    it1.maxKey = it2.maxKey = NULL;
+    it1.minData = it2.minData = NULL;
+    it1.maxData = it2.maxData = NULL;
+    embedDBInitIterator(stateUWA, &it1);
+    embedDBInitIterator(stateUWA, &it2);
+
+    int64_t memoryA[1024], memoryB[64];
+    embedDBArena arenaA, arenaB;
+    embedDBInitArena(&arenaA, memoryA, sizeof(memoryA));
+    embedDBInitArena(&arenaB, memoryB, sizeof(memoryB));
+
+    // Both trees and a schema are built in arena A
+    embedDBSetQueryArena(&arenaA);
+    int32_t selVal = 200;
+    uint8_t projCols[] = {0, 1, 3};
+    embedDBOperator* scan1 = createTableScanOperator(stateUWA, &it1, baseSchema);
+    embedDBOperator* select1 = createSelectionOperator(scan1, 3, SELECT_GTE, &selVal);
+    embedDBOperator* proj1 = createProjectionOperator(select1, 3, projCols);
+    embedDBAggregateFunc* counter = createCountAggregate();
+    embedDBOperator* scan2 = createTableScanOperator(stateUWA, &it2, baseSchema);
+    embedDBOperator* agg2 = createAggregateOperator(scan2, sameDayGroup, counter, 1);
+    int8_t colSizes[] = {4, 4};
+    int8_t colSignedness[] = {embedDB_COLUMN_UNSIGNED, embedDB_COLUMN_SIGNED};
+    embedDBSchema* schema = embedDBCreateSchema(2, colSizes, colSignedness);
+    TEST_ASSERT_EQUAL_PTR(&arenaA, schema->arena);
+    TEST_ASSERT_EQUAL_UINT32(5, arenaA.numOperators);
+
+    // The first tree is run, closed and freed with arena B set
+    embedDBSetQueryArena(&arenaB);
+    embedDBFreeSchema(&schema);
+    proj1->init(proj1);
+    TEST_ASSERT_TRUE(embedDBInArena(&arenaA, proj1->recordBuffer));
+    TEST_ASSERT_TRUE(embedDBInArena(&arenaA, proj1->schema));
+    int32_t recordsReturned = 0;
+    while (exec(proj1)) {
+        recordsReturned++;
+    }
+    TEST_ASSERT_TRUE(recordsReturned > 0);
+    proj1->close(proj1);
+    embedDBFreeOperatorRecursive(&proj1);
+    TEST_ASSERT_EQUAL_UINT32(0, arenaB.used);
+    TEST_ASSERT_EQUAL_UINT32(2, arenaA.numOperators);
+
+    // The second tree is run, closed and freed with no arena set, which resets arena A
+    embedDBSetQueryArena(NULL);
+    agg2->init(agg2);
+    TEST_ASSERT_TRUE(embedDBInArena(&arenaA, agg2->recordBuffer));
+    uint32_t numGroups = 0;
+    while (exec(agg2)) {
+        numGroups++;
+    }
+    TEST_ASSERT_TRUE(numGroups > 0);
+    agg2->close(agg2);
+    embedDBFreeOperatorRecursive(&agg2);
+    TEST_ASSERT_EQUAL_UINT32(0, arenaA.numOperators);
+    TEST_ASSERT_EQUAL_UINT32(0, arenaA.used);
+
+    embedDBCloseIterator(&it1);
+    embedDBCloseIterator(&it2);
+}
+
 void test_aggregate() {
     embedDBIterator it;
     it.minKey = NULL;
@@ -274,6 +543,16 @@ void test_aggregate() {
     TEST_ASSERT_EQUAL_INT32_MESSAGE(90, recordsReturned, "Aggregate didn't return the right number of records");
 }
 
+void test_hash_aggregate() {
+    // Enough memory for every group
+    checkHashAggregate(4096);
+}
+
+void test_hash_aggregate_spills() {
+    // Two spill pages and room for only a few of the groups at a time
+    checkHashAggregate(2 * 512 + 6 * 72);
+}
+
 void test_join() {
     embedDBIterator it;
     it.minKey = NULL;
@@ -292,7 +571,7 @@ void test_join() {
 
     // Prepare uwa table
     embedDBOperator* scan1 = createTableScanOperator(stateUWA, &it, baseSchema);
-    embedDBOperator* shift = malloc(sizeof(embedDBOperator));  // Custom operator to shift the year 2000 to 2015 to make the join work
+    embedDBOperator* shift = embedDBCreateOperator();  // Custom operator to shift the year 2000 to 2015 to make the join work
     shift->input = scan1;
     shift->init = customShiftInit;
     shift->next = customShiftNext;
@@ -365,7 +644,14 @@ int main(void) {
 
     RUN_TEST(test_projection);
     RUN_TEST(test_selection);
+    RUN_TEST(test_selection_pushdown);
+    RUN_TEST(test_batch_execution);
+    RUN_TEST(test_operators_from_arena);
+    RUN_TEST(test_arena_shared_by_two_chains);
+    RUN_TEST(test_tree_used_with_another_arena_set);
     RUN_TEST(test_aggregate);
+    RUN_TEST(test_hash_aggregate);
+    RUN_TEST(test_hash_aggregate_spills);
     RUN_TEST(test_join);
 
     UNITY_END();
@@ -434,3 +720,95 @@ void customShiftClose(embedDBOperator* operator) {
     free(operator->recordBuffer);
     operator->recordBuffer = NULL;
 }
+
+/* Groups the UWA records into buckets of 5 degrees, which are not in key order */
+void tempBucketKey(const void* record, void* key) {
+    int32_t bucket = ((const int32_t*)record)[1] / 50;
+    memcpy(key, &bucket, sizeof(int32_t));
+}
+
+void writeTempBucket(embedDBAggregateFunc* aggFunc, embedDBSchema* schema, void* recordBuffer, const void* lastRecord) {
+    int32_t bucket;
+    tempBucketKey(lastRecord, &bucket);
+    memcpy((int8_t*)recordBuffer + getColOffsetFromSchema(schema, aggFunc->colNum), &bucket, sizeof(int32_t));
+}
+
+void checkHashAggregate(uint32_t memoryBudget) {
+    // Compute the expected groups
+    int32_t count[20] = {0}, minWind[20], maxWind[20];
+    int64_t sum[20] = {0};
+    for (uint8_t i = 0; i < 20; i++) {
+        minWind[i] = INT32_MAX;
+        maxWind[i] = INT32_MIN;
+    }
+    int32_t numGroups = 0;
+    for (int32_t* record = nextRecord(uwaData); record != NULL; record = nextRecord(uwaData)) {
+        int32_t bucket = record[1] / 50;
+        numGroups += count[bucket] == 0;
+        count[bucket]++;
+        sum[bucket] += record[2];
+        if (record[3] < minWind[bucket])
+            minWind[bucket] = record[3];
+        if (record[3] > maxWind[bucket])
+            maxWind[bucket] = record[3];
+    }
+
+    embedDBIterator it;
+    it.minKey = NULL;
+    it.maxKey = NULL;
+    it.minData = NULL;
+    it.maxData = NULL;
+    embedDBInitIterator(stateUWA, &it);
+
+    char spillPath1[] = "build/artifacts/spillFile1.bin", spillPath2[] = "build/artifacts/spillFile2.bin";
+    embedDBHashAggregateConfig config;
+    config.memoryBudget = memoryBudget;
+    config.pageSize = 512;
+    config.fileInterface = getFileInterface();
+    config.spillFiles[0] = setupFile(spillPath1);
+    config.spillFiles[1] = setupFile(spillPath2);
+
+    embedDBOperator* scanOp = createTableScanOperator(stateUWA, &it, baseSchema);
+    embedDBAggregateFunc groupName = {NULL, NULL, writeTempBucket, NULL, 4};
+    embedDBAggregateFunc* counter = createCountAggregate();
+    embedDBAggregateFunc* sumPressure = createSumAggregate(2);
+    embedDBAggregateFunc* minWindFunc = createMinAggregate(3, -4);
+    embedDBAggregateFunc* maxWindFunc = createMaxAggregate(3, -4);
+    embedDBAggregateFunc aggFunctions[] = {groupName, *counter, *sumPressure, *minWindFunc, *maxWindFunc};
+    uint32_t functionsLength = 5;
+    embedDBOperator* aggOp = createHashAggregateOperator(scanOp, tempBucketKey, sizeof(int32_t), aggFunctions, functionsLength, &config);
+    aggOp->init(aggOp);
+
+    int32_t recordsReturned = 0;
+    int8_t seen[20] = {0};
+    int32_t* recordBuffer = aggOp->recordBuffer;
+    while (exec(aggOp)) {
+        recordsReturned++;
+        int32_t bucket = recordBuffer[0];
+        TEST_ASSERT_TRUE_MESSAGE(bucket >= 0 && bucket < 20, "Group label is wrong");
+        TEST_ASSERT_FALSE_MESSAGE(seen[bucket], "Group was returned twice");
+        seen[bucket] = 1;
+        TEST_ASSERT_EQUAL_INT32_MESSAGE(count[bucket], recordBuffer[1], "Count is wrong");
+        TEST_ASSERT_EQUAL_INT64_MESSAGE(sum[bucket], *(int64_t*)(recordBuffer + 2), "Sum is wrong");
+        TEST_ASSERT_EQUAL_INT32_MESSAGE(minWind[bucket], recordBuffer[4], "Min is wrong");
+        TEST_ASSERT_EQUAL_INT32_MESSAGE(maxWind[bucket], recordBuffer[5], "Max is wrong");
+    }
+
+    aggOp->close(aggOp);
+    embedDBFreeOperatorRecursive(&aggOp);
+    embedDBCloseIterator(&it);
+    for (int i = 0; i < functionsLength; i++) {
+        if (aggFunctions[i].state != NULL) {
+            free(aggFunctions[i].state);
+        }
+    }
+    free(counter);
+    free(sumPressure);
+    free(minWindFunc);
+    free(maxWindFunc);
+    tearDownFile(config.spillFiles[0]);
+    tearDownFile(config.spillFiles[1]);
+    free(config.fileInterface);
+
+    TEST_ASSERT_EQUAL_INT32_MESSAGE(numGroups, recordsReturned, "Hash aggregate didn't return the right number of groups");
+}
@@ -0,0 +1,211 @@
+#include <stdio.h>
+
+#include "../Unity/src/unity.h"
+#include "../src/embedDB/embedDB.h"
+#include "../src/embedDB/utilityFunctions.h"
+
+embedDBState* init_state(uint32_t parameters);
+void free_state(embedDBState* state);
+int32_t make_data(uint32_t key);
+void insert_records(embedDBState* state, uint32_t numRecords);
+uint32_t count_reads_for_value(embedDBState* state, int32_t value, uint32_t numRecords);
+
+// global variable for state. Use in setUp() function and tearDown()
+embedDBState* state;
+embedDBBitmapBuckets buckets;
+
+void setUp(void) {
+    state = NULL;
+    memset(&buckets, 0, sizeof(buckets));
+}
+
+void tearDown(void) {
+    if (state != NULL)
+        free_state(state);
+    state = NULL;
+}
+
+void test_learn_equi_depth_boundaries(void) {
+    int32_t values[1000];
+    for (int32_t i = 0; i < 1000; i++)
+        values[i] = 1000 - i;
+    TEST_ASSERT_EQUAL_INT8(0, embedDBLearnBitmapBuckets(&buckets, values, 1000, 4));
+    TEST_ASSERT_EQUAL_UINT8(4, buckets.numBuckets);
+    TEST_ASSERT_EQUAL_INT32(250, buckets.boundaries[0]);
+    TEST_ASSERT_EQUAL_INT32(500, buckets.boundaries[1]);
+    TEST_ASSERT_EQUAL_INT32(750, buckets.boundaries[2]);
+
+    /* Repeated values share a bucket */
+    for (int32_t i = 0; i < 1000; i++)
+        values[i] = i < 900 ? 5 : i;
+    TEST_ASSERT_EQUAL_INT8(0, embedDBLearnBitmapBuckets(&buckets, values, 1000, 10));
+    TEST_ASSERT_EQUAL_UINT8(2, buckets.numBuckets);
+    TEST_ASSERT_EQUAL_INT32(5, buckets.boundaries[0]);
+
+    TEST_ASSERT_EQUAL_INT8(-1, embedDBLearnBitmapBuckets(&buckets, values, 0, 4));
+    TEST_ASSERT_EQUAL_INT8(-1, embedDBLearnBitmapBuckets(&buckets, values, 1000, EMBEDDB_MAX_BITMAP_BUCKETS + 1));
+}
+
+void test_learned_buckets_read_fewer_pages_than_fixed_buckets(void) {
+    uint32_t numRecords = 30000;
+
+    /* The 16 bit helper puts every value up to 320 in its first bucket */
+    state = init_state(EMBEDDB_USE_BMAP | EMBEDDB_USE_INDEX | EMBEDDB_RESET_DATA);
+    insert_records(state, numRecords);
+    uint32_t fixedReads = count_reads_for_value(state, 317, numRecords);
+    free_state(state);
+
+    buckets.numSamplePages = 20;
+    state = init_state(EMBEDDB_USE_BMAP | EMBEDDB_USE_BITMAP_BUCKETS | EMBEDDB_USE_INDEX | EMBEDDB_RESET_DATA);
+    insert_records(state, numRecords);
+    TEST_ASSERT_TRUE(buckets.numBuckets > 8);
+    TEST_ASSERT_TRUE(buckets.numBuckets <= 64);
+    for (uint8_t i = 1; i + 1 < buckets.numBuckets; i++)
+        TEST_ASSERT_TRUE(buckets.boundaries[i - 1] < buckets.boundaries[i]);
+    uint32_t learnedReads = count_reads_for_value(state, 317, numRecords);
+
+    TEST_ASSERT_TRUE(learnedReads * 4 < fixedReads);
+}
+
+void test_configured_buckets_with_batch_insert_and_recovery(void) {
+    buckets.numBuckets = 40;
+    buckets.columnOffset = 4;
+    for (uint8_t i = 0; i < 39; i++)
+        buckets.boundaries[i] = 300 + i;
+    state = init_state(EMBEDDB_USE_BMAP | EMBEDDB_USE_BITMAP_BUCKETS | EMBEDDB_USE_INDEX | EMBEDDB_RESET_DATA);
+    uint32_t numRecords = 20000;
+    uint32_t* keys = malloc(numRecords * sizeof(uint32_t));
+    int32_t* data = malloc(numRecords * 2 * sizeof(int32_t));
+    for (uint32_t i = 0; i < numRecords; i++) {
+        keys[i] = i;
+        data[i * 2] = make_data(i);
+        data[i * 2 + 1] = make_data(i);
+    }
+    TEST_ASSERT_EQUAL_INT8(0, embedDBPutBatch(state, keys, data, numRecords));
+    TEST_ASSERT_EQUAL_INT8(0, embedDBFlush(state));
+    uint32_t reads = count_reads_for_value(state, 317, numRecords);
+    TEST_ASSERT_TRUE(reads * 4 < state->nextDataPageId);
+    free_state(state);
+
+    /* Recovered pages are only filtered with the boundaries they were built with */
+    uint8_t numBuckets = buckets.numBuckets;
+    buckets.numBuckets = 0;
+    buckets.numSamplePages = 5;
+    state = init_state(EMBEDDB_USE_BMAP | EMBEDDB_USE_BITMAP_BUCKETS | EMBEDDB_USE_INDEX);
+    TEST_ASSERT_NULL(state);
+
+    buckets.numBuckets = numBuckets;
+    state = init_state(EMBEDDB_USE_BMAP | EMBEDDB_USE_BITMAP_BUCKETS | EMBEDDB_USE_INDEX);
+    TEST_ASSERT_NOT_NULL(state);
+    TEST_ASSERT_EQUAL_UINT32(reads, count_reads_for_value(state, 317, numRecords));
+    free(keys);
+    free(data);
+}
+
+void test_buckets_must_fit_in_bitmap(void) {
+    buckets.numBuckets = EMBEDDB_MAX_BITMAP_BUCKETS + 1;
+    state = init_state(EMBEDDB_USE_BMAP | EMBEDDB_USE_BITMAP_BUCKETS | EMBEDDB_RESET_DATA);
+    TEST_ASSERT_NULL(state);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_learn_equi_depth_boundaries);
+    RUN_TEST(test_learned_buckets_read_fewer_pages_than_fixed_buckets);
+    RUN_TEST(test_configured_buckets_with_batch_insert_and_recovery);
+    RUN_TEST(test_buckets_must_fit_in_bitmap);
+    return UNITY_END();
+}
+
+/* Skewed readings that drift slowly between 300 and 339. Records have the reading in both data columns */
+int32_t make_data(uint32_t key) {
+    return 300 + (int32_t)(key / 20 % 40);
+}
+
+void insert_records(embedDBState* state, uint32_t numRecords) {
+    for (uint32_t key = 0; key < numRecords; key++) {
+        int32_t data[2] = {make_data(key), make_data(key)};
+        TEST_ASSERT_EQUAL_INT8(0, embedDBPut(state, &key, data));
+    }
+}
+
+/* Checks the iterator returns every record with the value and returns the number of data pages read */
+uint32_t count_reads_for_value(embedDBState* state, int32_t value, uint32_t numRecords) {
+    int32_t filter[2] = {value, value};
+    embedDBIterator it;
+    it.minKey = NULL;
+    it.maxKey = NULL;
+    it.minData = filter;
+    it.maxData = filter;
+    embedDBInitIterator(state, &it);
+
+    uint32_t numReads = state->numReads;
+    uint32_t key, numFound = 0, expected = 0;
+    int32_t data[2];
+    while (embedDBNext(state, &it, &key, data)) {
+        TEST_ASSERT_EQUAL_INT32(value, data[0]);
+        numFound++;
+    }
+    embedDBCloseIterator(&it);
+    for (uint32_t i = 0; i < numRecords; i++)
+        expected += make_data(i) == value;
+    TEST_ASSERT_EQUAL_UINT32(expected, numFound);
+    return state->numReads - numReads;
+}
+
+void free_state(embedDBState* state) {
+    embedDBClose(state);
+    tearDownFile(state->dataFile);
+    if (state->indexFile != NULL)
+        tearDownFile(state->indexFile);
+    free(state->fileInterface);
+    free(state->buffer);
+    free(state);
+}
+
+/* Function returns a pointer to a newly created embedDBState, or NULL if embedDB failed to initialize */
+embedDBState* init_state(uint32_t parameters) {
+    embedDBState* state = (embedDBState*)malloc(sizeof(embedDBState));
+    if (state == NULL) {
+        printf("Unable to allocate state. Exiting\n");
+        exit(0);
+    }
+    state->keySize = 4;
+    state->dataSize = 8;
+    state->pageSize = 512;
+    state->numSplinePoints = 300;
+    state->bitmapSize = EMBEDDB_USING_BITMAP_BUCKETS(parameters) ? 8 : 2;
+    state->inBitmap = inBitmapInt16;
+    state->updateBitmap = updateBitmapInt16;
+    state->buildBitmapFromRange = buildBitmapInt16FromRange;
+    state->bitmapBuckets = EMBEDDB_USING_BITMAP_BUCKETS(parameters) ? &buckets : NULL;
+    state->bufferSizeInBlocks = 4;
+    state->buffer = calloc(1, (size_t)state->bufferSizeInBlocks * state->pageSize);
+    if (state->buffer == NULL) {
+        printf("Unable to allocate buffer. Exiting\n");
+        exit(0);
+    }
+    state->numDataPages = 1000;
+    state->numIndexPages = 48;
+    state->eraseSizeInPages = 4;
+    char dataPath[] = "build/artifacts/dataFile.bin";
+    char indexPath[] = "build/artifacts/indexFile.bin";
+    state->fileInterface = getFileInterface();
+    state->dataFile = setupFile(dataPath);
+    state->indexFile = EMBEDDB_USING_INDEX(parameters) ? setupFile(indexPath) : NULL;
+    state->parameters = parameters;
+    state->compareKey = int32Comparator;
+    state->compareData = int32Comparator;
+
+    size_t splineMaxError = 1;
+    if (embedDBInit(state, splineMaxError) != 0) {
+        tearDownFile(state->dataFile);
+        if (state->indexFile != NULL)
+            tearDownFile(state->indexFile);
+        free(state->fileInterface);
+        free(state->buffer);
+        free(state);
+        return NULL;
+    }
+    return state;
+}
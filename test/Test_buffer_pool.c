@@ -0,0 +1,219 @@
+#include <stdio.h>
+
+#include "../Unity/src/unity.h"
+#include "../src/embedDB/embedDB.h"
+#include "../src/embedDB/utilityFunctions.h"
+
+embedDBState* init_state(uint16_t bufferSizeInBlocks, uint32_t numDataPages);
+void insert_records(embedDBState* state, uint32_t startKey, uint32_t numRecords);
+
+// global variable for state. Use in setUp() function and tearDown()
+embedDBState* state;
+
+/* Counts the vectored reads made through the file interface */
+uint32_t (*fileReadMany)(void** buffers, uint32_t pageNum, uint32_t numPages, uint32_t pageSize, void* file);
+uint32_t numReadManyCalls;
+
+uint32_t countingReadMany(void** buffers, uint32_t pageNum, uint32_t numPages, uint32_t pageSize, void* file) {
+    numReadManyCalls++;
+    return fileReadMany(buffers, pageNum, numPages, pageSize, file);
+}
+
+void setUp(void) {
+    state = init_state(8, 20000);
+    TEST_ASSERT_NOT_NULL_MESSAGE(state, "embedDB did not initialize with a buffer pool.");
+}
+
+void tearDown(void) {
+    embedDBClose(state);
+    tearDownFile(state->dataFile);
+    tearDownFile(state->indexFile);
+    free(state->fileInterface);
+    free(state->buffer);
+    free(state);
+    state = NULL;
+}
+
+void test_pool_uses_pages_past_fixed_buffers(void) {
+    TEST_ASSERT_NOT_NULL(state->bufferPool);
+    TEST_ASSERT_EQUAL_UINT16(4, state->bufferPool->numFrames);
+    TEST_ASSERT_EQUAL_PTR((int8_t*)state->buffer + 4 * state->pageSize, state->bufferPool->pages);
+}
+
+void test_repeated_page_queries_hit_pool(void) {
+    uint32_t recordsPerPage = state->maxRecordsPerPage;
+    insert_records(state, 0, recordsPerPage * 10);
+    embedDBFlush(state);
+
+    /* Query a key from each of four pages, alternating so the single data read buffer is always replaced */
+    uint32_t keys[] = {5, recordsPerPage * 3 + 5, recordsPerPage * 6 + 5, recordsPerPage * 9 + 5};
+    int32_t data[3];
+    for (int i = 0; i < 4; i++) {
+        TEST_ASSERT_EQUAL_INT8(0, embedDBGet(state, &keys[i], data));
+        TEST_ASSERT_EQUAL_INT32(keys[i] + 100, data[0]);
+    }
+
+    uint32_t readsAfterFirstPass = state->numReads;
+    uint32_t hitsAfterFirstPass = state->bufferHits;
+    for (int pass = 0; pass < 3; pass++) {
+        for (int i = 3; i >= 0; i--) {
+            TEST_ASSERT_EQUAL_INT8(0, embedDBGet(state, &keys[i], data));
+            TEST_ASSERT_EQUAL_INT32(keys[i] + 100, data[0]);
+        }
+    }
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(readsAfterFirstPass, state->numReads, "Pages already in the buffer pool were read from storage again.");
+    TEST_ASSERT_GREATER_THAN_UINT32(hitsAfterFirstPass, state->bufferHits);
+}
+
+void test_overwritten_page_is_not_served_from_pool(void) {
+    tearDown();
+    state = init_state(8, 16);
+    TEST_ASSERT_NOT_NULL(state);
+
+    uint32_t recordsPerPage = state->maxRecordsPerPage;
+    insert_records(state, 0, recordsPerPage * 12 + 1);
+
+    /* Cache the physical page that logical page 11 lives in */
+    uint32_t key = recordsPerPage * 11 + 1;
+    int32_t data[3];
+    TEST_ASSERT_EQUAL_INT8(0, embedDBGet(state, &key, data));
+    TEST_ASSERT_EQUAL_INT32(key + 100, data[0]);
+
+    /* Wrap around the data file so that logical page 27 overwrites the same physical page */
+    insert_records(state, recordsPerPage * 12 + 1, recordsPerPage * 16 - 1);
+    embedDBFlush(state);
+
+    key = recordsPerPage * 27 + 1;
+    TEST_ASSERT_EQUAL_INT8(0, embedDBGet(state, &key, data));
+    TEST_ASSERT_EQUAL_INT32(key + 100, data[0]);
+}
+
+void test_sequential_iterator_reads_ahead(void) {
+    uint32_t recordsPerPage = state->maxRecordsPerPage;
+    uint32_t numRecords = recordsPerPage * 20;
+    insert_records(state, 0, numRecords);
+    embedDBFlush(state);
+    embedDBResetStats(state);
+
+    fileReadMany = state->fileInterface->readMany;
+    state->fileInterface->readMany = countingReadMany;
+    numReadManyCalls = 0;
+
+    embedDBIterator it;
+    it.minKey = NULL;
+    it.maxKey = NULL;
+    it.minData = NULL;
+    it.maxData = NULL;
+    embedDBInitIterator(state, &it);
+
+    uint32_t key = 0, expectedKey = 0;
+    int32_t data[3];
+    while (embedDBNext(state, &it, &key, data)) {
+        TEST_ASSERT_EQUAL_UINT32(expectedKey, key);
+        TEST_ASSERT_EQUAL_INT32(expectedKey + 100, data[0]);
+        expectedKey++;
+    }
+    embedDBCloseIterator(&it);
+    state->fileInterface->readMany = fileReadMany;
+
+    TEST_ASSERT_EQUAL_UINT32(numRecords, expectedKey);
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(20, state->numReads, "Each data page should be read from storage once.");
+    /* Half of the four frames are used for each read ahead, so every other page is read ahead with the page before it */
+    TEST_ASSERT_EQUAL_UINT32(10, numReadManyCalls);
+}
+
+void test_bitmap_iterator_with_read_ahead(void) {
+    uint32_t recordsPerPage = state->maxRecordsPerPage;
+    /* Enough data pages that the scan moves on to a second index page */
+    uint32_t numDataPages = state->maxIdxRecordsPerPage + 20;
+    insert_records(state, 0, recordsPerPage * numDataPages);
+    embedDBFlush(state);
+
+    int32_t minData = 150, maxData = recordsPerPage * (numDataPages - 2);
+    embedDBIterator it;
+    it.minKey = NULL;
+    it.maxKey = NULL;
+    it.minData = &minData;
+    it.maxData = &maxData;
+    embedDBInitIterator(state, &it);
+
+    uint32_t key = 0, numFound = 0;
+    int32_t data[3];
+    while (embedDBNext(state, &it, &key, data)) {
+        TEST_ASSERT_EQUAL_INT32(key + 100, data[0]);
+        TEST_ASSERT_TRUE(data[0] >= minData && data[0] <= maxData);
+        numFound++;
+    }
+    embedDBCloseIterator(&it);
+    TEST_ASSERT_EQUAL_UINT32(maxData - minData + 1, numFound);
+}
+
+void test_init_fails_without_spare_pages(void) {
+    embedDBState* noPoolState = init_state(4, 20000);
+    TEST_ASSERT_NULL_MESSAGE(noPoolState, "embedDB initialized a buffer pool with no pages past the fixed buffers.");
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_pool_uses_pages_past_fixed_buffers);
+    RUN_TEST(test_repeated_page_queries_hit_pool);
+    RUN_TEST(test_overwritten_page_is_not_served_from_pool);
+    RUN_TEST(test_sequential_iterator_reads_ahead);
+    RUN_TEST(test_bitmap_iterator_with_read_ahead);
+    RUN_TEST(test_init_fails_without_spare_pages);
+    return UNITY_END();
+}
+
+void insert_records(embedDBState* state, uint32_t startKey, uint32_t numRecords) {
+    int32_t data[3] = {0, 0, 0};
+    for (uint32_t key = startKey; key < startKey + numRecords; key++) {
+        data[0] = key + 100;
+        TEST_ASSERT_EQUAL_INT8(0, embedDBPut(state, &key, data));
+    }
+}
+
+/* Function returns a pointer to a newly created embedDBState using a buffer pool, or NULL if embedDB failed to initialize */
+embedDBState* init_state(uint16_t bufferSizeInBlocks, uint32_t numDataPages) {
+    embedDBState* state = (embedDBState*)malloc(sizeof(embedDBState));
+    if (state == NULL) {
+        printf("Unable to allocate state. Exiting\n");
+        exit(0);
+    }
+    state->keySize = 4;
+    state->dataSize = 12;
+    state->pageSize = 512;
+    state->numSplinePoints = 300;
+    state->bitmapSize = 1;
+    state->bufferSizeInBlocks = bufferSizeInBlocks;
+    state->buffer = malloc((size_t)state->bufferSizeInBlocks * state->pageSize);
+    if (state->buffer == NULL) {
+        printf("Unable to allocate buffer. Exiting\n");
+        exit(0);
+    }
+    state->numDataPages = numDataPages;
+    state->numIndexPages = 48;
+    state->eraseSizeInPages = 4;
+    char dataPath[] = "build/artifacts/dataFile.bin", indexPath[] = "build/artifacts/indexFile.bin";
+    state->fileInterface = getFileInterface();
+    state->dataFile = setupFile(dataPath);
+    state->indexFile = setupFile(indexPath);
+    state->parameters = EMBEDDB_USE_BMAP | EMBEDDB_USE_INDEX | EMBEDDB_USE_BUFFER_POOL | EMBEDDB_RESET_DATA;
+    state->inBitmap = inBitmapInt8;
+    state->updateBitmap = updateBitmapInt8;
+    state->buildBitmapFromRange = buildBitmapInt8FromRange;
+    state->compareKey = int32Comparator;
+    state->compareData = int32Comparator;
+
+    size_t splineMaxError = 1;
+    if (embedDBInit(state, splineMaxError) != 0) {
+        tearDownFile(state->dataFile);
+        tearDownFile(state->indexFile);
+        free(state->fileInterface);
+        free(state->buffer);
+        free(state);
+        return NULL;
+    }
+
+    embedDBResetStats(state);
+    return state;
+}
@@ -6,13 +6,13 @@
 
 int insert_static_record(embedDBState* state, uint32_t key, uint32_t data);
 void* query_record(embedDBState* state, uint32_t* key);
-embedDBState* init_state();
+embedDBState* init_state(uint32_t parameters);
 
 // global variable for state. Use in setUp() function and tearDown()
 embedDBState* state;
 
 void setUp(void) {
-    state = init_state();
+    state = init_state(EMBEDDB_USE_BMAP | EMBEDDB_USE_INDEX | EMBEDDB_RESET_DATA);
 }
 
 void tearDown(void) {
@@ -204,6 +204,89 @@ void test_iterator_no_flush_on_data(void) {
     embedDBCloseIterator(&it);
 }
 
+/* Checks that embedDBNextPage returns exactly the records that embedDBNext returns for the same query */
+void compare_next_page_to_next(uint32_t* minKey, uint32_t* maxKey, uint32_t* minData, uint32_t* maxData) {
+    embedDBIterator it, pageIt;
+    it.minKey = pageIt.minKey = minKey;
+    it.maxKey = pageIt.maxKey = maxKey;
+    it.minData = pageIt.minData = minData;
+    it.maxData = pageIt.maxData = maxData;
+    embedDBInitIterator(state, &it);
+
+    uint32_t numRecords = 0;
+    uint32_t expectedKeys[1000];
+    uint32_t itKey;
+    uint32_t itData[] = {0, 0, 0};
+    while (embedDBNext(state, &it, &itKey, itData)) {
+        expectedKeys[numRecords++] = itKey;
+    }
+    embedDBCloseIterator(&it);
+
+    embedDBInitIterator(state, &pageIt);
+    uint32_t numPageRecords = 0;
+    void* records;
+    count_t begin, end;
+    while (embedDBNextPage(state, &pageIt, &records, &begin, &end)) {
+        TEST_ASSERT_TRUE_MESSAGE(begin < end, "embedDBNextPage returned an empty range.");
+        for (count_t i = begin; i < end; i++) {
+            uint32_t pageKey = *(uint32_t*)((int8_t*)records + i * state->recordSize);
+            uint32_t pageData = *(uint32_t*)((int8_t*)records + i * state->recordSize + state->keySize);
+            TEST_ASSERT_TRUE_MESSAGE(numPageRecords < numRecords, "embedDBNextPage returned more records than embedDBNext.");
+            TEST_ASSERT_EQUAL_UINT32_MESSAGE(expectedKeys[numPageRecords], pageKey, "embedDBNextPage returned a different record than embedDBNext.");
+            TEST_ASSERT_EQUAL_UINT32_MESSAGE(pageKey % 50, pageData, "embedDBNextPage returned the wrong data for a record.");
+            numPageRecords++;
+        }
+    }
+    embedDBCloseIterator(&pageIt);
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(numRecords, numPageRecords, "embedDBNextPage did not return the same number of records as embedDBNext.");
+}
+
+void insert_next_page_records(void) {
+    for (uint32_t key = 0; key < 1000; key++) {
+        insert_static_record(state, key, key % 50);
+        if (key == 600)
+            embedDBFlush(state);
+    }
+}
+
+void run_next_page_queries(void) {
+    uint32_t minKey = 95, maxKey = 830, minData = 10, maxData = 20;
+    compare_next_page_to_next(NULL, NULL, NULL, NULL);
+    compare_next_page_to_next(&minKey, &maxKey, NULL, NULL);
+    compare_next_page_to_next(NULL, NULL, &minData, &maxData);
+    compare_next_page_to_next(&minKey, NULL, NULL, &maxData);
+    compare_next_page_to_next(&minKey, &maxKey, &minData, &maxData);
+}
+
+// test ensures page iterator returns the same records as the record iterator
+void test_next_page_matches_next(void) {
+    insert_next_page_records();
+    run_next_page_queries();
+}
+
+// test ensures page iterator returns the same records when the page header min and max are used to skip checks
+void test_next_page_matches_next_with_max_min(void) {
+    tearDown();
+    state = init_state(EMBEDDB_USE_BMAP | EMBEDDB_USE_INDEX | EMBEDDB_USE_MAX_MIN | EMBEDDB_RESET_DATA);
+    insert_next_page_records();
+    run_next_page_queries();
+
+    /* Data range that covers every page should not need any per-record checks and return whole pages */
+    embedDBIterator it;
+    uint32_t minData = 0, maxData = 49;
+    it.minKey = NULL;
+    it.maxKey = NULL;
+    it.minData = &minData;
+    it.maxData = &maxData;
+    embedDBInitIterator(state, &it);
+    void* records;
+    count_t begin, end;
+    TEST_ASSERT_TRUE(embedDBNextPage(state, &it, &records, &begin, &end));
+    TEST_ASSERT_EQUAL_UINT16(0, begin);
+    TEST_ASSERT_EQUAL_UINT16(state->maxRecordsPerPage, end);
+    embedDBCloseIterator(&it);
+}
+
 // will need a test for defined minKey (that is so it can use the bitmap and spline etc)
 // will need a test for inserting records, flushing, and then inserting more (think getting nextDataPageId up to satisfy this if statement if (it->nextDataPage >= state->nextDataPageId))
 // will need a test for a variety of data types including floats
@@ -217,6 +300,8 @@ int main() {
     RUN_TEST(test_iterator_no_flush_on_keys);
     RUN_TEST(test_iterator_flush_on_data);
     RUN_TEST(test_iterator_no_flush_on_data);
+    RUN_TEST(test_next_page_matches_next);
+    RUN_TEST(test_next_page_matches_next_with_max_min);
     UNITY_END();
 }
 
@@ -236,7 +321,7 @@ int insert_static_record(embedDBState* state, uint32_t key, uint32_t data) {
 
 /* Function returns a pointer to a newly created embedDBState*/
 /* @TODO: Make this more dynamic?*/
-embedDBState* init_state() {
+embedDBState* init_state(uint32_t parameters) {
     embedDBState* state = (embedDBState*)malloc(sizeof(embedDBState));
     if (state == NULL) {
         printf("Unable to allocate state. Exiting\n");
@@ -267,7 +352,7 @@ embedDBState* init_state() {
     state->dataFile = setupFile(dataPath);
     state->indexFile = setupFile(indexPath);
     // configure state
-    state->parameters = EMBEDDB_USE_BMAP | EMBEDDB_USE_INDEX | EMBEDDB_RESET_DATA;
+    state->parameters = parameters;
     // Setup for data and bitmap comparison functions */
     state->inBitmap = inBitmapInt8;
     state->updateBitmap = updateBitmapInt8;
@@ -0,0 +1,246 @@
+#include <stdio.h>
+
+#include "../Unity/src/unity.h"
+#include "../src/embedDB/embedDB.h"
+#include "../src/embedDB/utilityFunctions.h"
+
+#define NUM_DATA_PAGES 256
+
+embedDBState* init_state(uint32_t parameters, uint32_t checkpointInterval);
+void free_state(embedDBState* state);
+void insert_records(embedDBState* state, uint32_t startKey, uint32_t numRecords);
+void check_records(embedDBState* state, uint32_t minKey, uint32_t maxKey);
+
+// global variable for state. Use in setUp() function and tearDown()
+embedDBState* state;
+
+/* Counts the pages read from storage while embedDB recovers */
+uint32_t numFileReads;
+int8_t (*fileRead)(void* buffer, uint32_t pageNum, uint32_t pageSize, void* file);
+
+int8_t countingRead(void* buffer, uint32_t pageNum, uint32_t pageSize, void* file) {
+    numFileReads++;
+    return fileRead(buffer, pageNum, pageSize, file);
+}
+
+void setUp(void) {
+    state = NULL;
+    numFileReads = 0;
+}
+
+void tearDown(void) {
+    if (state != NULL)
+        free_state(state);
+    state = NULL;
+}
+
+void test_recovery_only_reads_pages_after_checkpoint(void) {
+    state = init_state(EMBEDDB_USE_CHECKPOINT | EMBEDDB_RESET_DATA, 0);
+    uint32_t recordsPerPage = state->maxRecordsPerPage;
+    insert_records(state, 0, recordsPerPage * 200);
+    TEST_ASSERT_EQUAL_INT8(0, embedDBFlush(state));
+
+    /* Three more pages are written after the checkpoint */
+    insert_records(state, recordsPerPage * 200, recordsPerPage * 3 + 1);
+    id_t nextDataPageId = state->nextDataPageId;
+    free_state(state);
+
+    numFileReads = 0;
+    state = init_state(EMBEDDB_USE_CHECKPOINT, 0);
+    TEST_ASSERT_EQUAL_UINT32(nextDataPageId, state->nextDataPageId);
+    TEST_ASSERT_LESS_THAN_UINT32_MESSAGE(20, numFileReads, "Recovery read more than the checkpoint and the pages written after it.");
+    check_records(state, 0, recordsPerPage * 203);
+}
+
+void test_replayed_state_matches_state_before_restart(void) {
+    state = init_state(EMBEDDB_USE_CHECKPOINT | EMBEDDB_RESET_DATA, 16);
+    uint32_t recordsPerPage = state->maxRecordsPerPage;
+
+    /* Wraps the data file, so erases are replayed after the last checkpoint */
+    uint32_t numRecords = recordsPerPage * (NUM_DATA_PAGES + 90) + 7;
+    insert_records(state, 0, numRecords);
+    embedDBState before = *state;
+    size_t splineCount = state->spl->count;
+    free_state(state);
+
+    state = init_state(EMBEDDB_USE_CHECKPOINT, 16);
+    TEST_ASSERT_EQUAL_UINT32(before.nextDataPageId, state->nextDataPageId);
+    TEST_ASSERT_EQUAL_UINT32(before.minDataPageId, state->minDataPageId);
+    TEST_ASSERT_EQUAL_UINT32(before.numAvailDataPages, state->numAvailDataPages);
+    TEST_ASSERT_EQUAL_UINT64(before.minKey, state->minKey);
+    TEST_ASSERT_EQUAL_UINT32(before.avgKeyDiff, state->avgKeyDiff);
+    TEST_ASSERT_EQUAL_UINT32(splineCount, state->spl->count);
+    TEST_ASSERT_EQUAL_UINT32(before.checkpointSequence, state->checkpointSequence);
+    check_records(state, recordsPerPage * (state->minDataPageId + 1), recordsPerPage * state->nextDataPageId);
+}
+
+void test_stale_checkpoint_falls_back_to_search(void) {
+    state = init_state(EMBEDDB_USE_CHECKPOINT | EMBEDDB_RESET_DATA, 0);
+    uint32_t recordsPerPage = state->maxRecordsPerPage;
+    insert_records(state, 0, recordsPerPage * 10);
+    TEST_ASSERT_EQUAL_INT8(0, embedDBFlush(state));
+
+    /* The last page of the checkpoint is overwritten once the file wraps */
+    insert_records(state, recordsPerPage * 10, recordsPerPage * (NUM_DATA_PAGES + 40));
+    id_t nextDataPageId = state->nextDataPageId;
+    free_state(state);
+
+    numFileReads = 0;
+    state = init_state(EMBEDDB_USE_CHECKPOINT, 0);
+    TEST_ASSERT_EQUAL_UINT32(nextDataPageId, state->nextDataPageId);
+    TEST_ASSERT_EQUAL_UINT32(nextDataPageId - NUM_DATA_PAGES, state->minDataPageId);
+    check_records(state, recordsPerPage * (state->minDataPageId + 1), recordsPerPage * state->nextDataPageId);
+}
+
+void test_search_finds_wrap_point_without_checkpoint(void) {
+    state = init_state(EMBEDDB_RESET_DATA, 0);
+    uint32_t recordsPerPage = state->maxRecordsPerPage;
+    insert_records(state, 0, recordsPerPage * (NUM_DATA_PAGES + 100));
+    id_t nextDataPageId = state->nextDataPageId;
+    free_state(state);
+
+    numFileReads = 0;
+    state = init_state(0, 0);
+    TEST_ASSERT_EQUAL_UINT32(nextDataPageId, state->nextDataPageId);
+    TEST_ASSERT_EQUAL_UINT32(nextDataPageId - NUM_DATA_PAGES, state->minDataPageId);
+    TEST_ASSERT_EQUAL_UINT32(0, state->numAvailDataPages);
+    check_records(state, recordsPerPage * (state->minDataPageId + 1), recordsPerPage * state->nextDataPageId);
+}
+
+void test_torn_checkpoint_uses_previous_slot(void) {
+    state = init_state(EMBEDDB_USE_CHECKPOINT | EMBEDDB_RESET_DATA, 0);
+    uint32_t recordsPerPage = state->maxRecordsPerPage;
+    insert_records(state, 0, recordsPerPage * 20);
+    TEST_ASSERT_EQUAL_INT8(0, embedDBFlush(state));
+    insert_records(state, recordsPerPage * 20, recordsPerPage * 20);
+    TEST_ASSERT_EQUAL_INT8(0, embedDBFlush(state));
+    TEST_ASSERT_EQUAL_UINT32(2, state->checkpointSequence);
+
+    /* Corrupt the newest checkpoint, which starts with the magic number and sequence number 1 */
+    int8_t* page = (int8_t*)state->buffer + EMBEDDB_DATA_READ_BUFFER * state->pageSize;
+    uint32_t header[2] = {0, 0}, slotPage = 1;
+    while (state->fileInterface->read(page, slotPage, state->pageSize, state->checkpointFile)) {
+        memcpy(header, page, sizeof(header));
+        if (header[0] == 0x43424445 && header[1] == 1)
+            break;
+        slotPage++;
+    }
+    TEST_ASSERT_EQUAL_UINT32(1, header[1]);
+    page[30] ^= 0xFF;
+    state->fileInterface->write(page, slotPage, state->pageSize, state->checkpointFile);
+    id_t nextDataPageId = state->nextDataPageId;
+    free_state(state);
+
+    state = init_state(EMBEDDB_USE_CHECKPOINT, 0);
+    TEST_ASSERT_EQUAL_UINT32(1, state->checkpointSequence);
+    TEST_ASSERT_EQUAL_UINT32(nextDataPageId, state->nextDataPageId);
+    check_records(state, 0, recordsPerPage * 40);
+}
+
+void test_variable_data_cursors_are_recovered(void) {
+    state = init_state(EMBEDDB_USE_CHECKPOINT | EMBEDDB_USE_VDATA | EMBEDDB_RESET_DATA, 0);
+    char varData[40] = "Variable data stored with the record";
+    int32_t data[3] = {0, 0, 0};
+    for (uint32_t key = 0; key < 3000; key++) {
+        data[0] = key + 100;
+        TEST_ASSERT_EQUAL_INT8(0, embedDBPutVar(state, &key, data, varData, sizeof(varData)));
+    }
+    TEST_ASSERT_EQUAL_INT8(0, embedDBFlush(state));
+    embedDBState before = *state;
+    free_state(state);
+
+    state = init_state(EMBEDDB_USE_CHECKPOINT | EMBEDDB_USE_VDATA, 0);
+    TEST_ASSERT_EQUAL_UINT32(before.nextVarPageId, state->nextVarPageId);
+    TEST_ASSERT_EQUAL_UINT32(before.numAvailVarPages, state->numAvailVarPages);
+    TEST_ASSERT_EQUAL_UINT64(before.minVarRecordId, state->minVarRecordId);
+    TEST_ASSERT_EQUAL_UINT32(before.currentVarLoc % (state->numVarPages * state->pageSize), state->currentVarLoc);
+
+    uint32_t key = 2990;
+    char readVarData[40];
+    embedDBVarDataStream* stream = NULL;
+    TEST_ASSERT_EQUAL_INT8(0, embedDBGetVar(state, &key, data, &stream));
+    TEST_ASSERT_NOT_NULL(stream);
+    TEST_ASSERT_EQUAL_UINT32(sizeof(varData), embedDBVarDataStreamRead(state, stream, readVarData, sizeof(readVarData)));
+    TEST_ASSERT_EQUAL_STRING(varData, readVarData);
+    free(stream);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_recovery_only_reads_pages_after_checkpoint);
+    RUN_TEST(test_replayed_state_matches_state_before_restart);
+    RUN_TEST(test_stale_checkpoint_falls_back_to_search);
+    RUN_TEST(test_search_finds_wrap_point_without_checkpoint);
+    RUN_TEST(test_torn_checkpoint_uses_previous_slot);
+    RUN_TEST(test_variable_data_cursors_are_recovered);
+    return UNITY_END();
+}
+
+void insert_records(embedDBState* state, uint32_t startKey, uint32_t numRecords) {
+    int32_t data[3] = {0, 0, 0};
+    for (uint32_t key = startKey; key < startKey + numRecords; key++) {
+        data[0] = key + 100;
+        TEST_ASSERT_EQUAL_INT8(0, embedDBPut(state, &key, data));
+    }
+}
+
+void check_records(embedDBState* state, uint32_t minKey, uint32_t maxKey) {
+    int32_t data[3];
+    for (uint32_t key = minKey; key < maxKey; key += 7) {
+        TEST_ASSERT_EQUAL_INT8(0, embedDBGet(state, &key, data));
+        TEST_ASSERT_EQUAL_INT32(key + 100, data[0]);
+    }
+}
+
+void free_state(embedDBState* state) {
+    embedDBClose(state);
+    tearDownFile(state->dataFile);
+    tearDownFile(state->checkpointFile);
+    if (EMBEDDB_USING_VDATA(state->parameters))
+        tearDownFile(state->varFile);
+    free(state->fileInterface);
+    free(state->buffer);
+    free(state);
+}
+
+/* Function returns a pointer to a newly created embedDBState that saves checkpoints if parameters has EMBEDDB_USE_CHECKPOINT */
+embedDBState* init_state(uint32_t parameters, uint32_t checkpointInterval) {
+    embedDBState* state = (embedDBState*)malloc(sizeof(embedDBState));
+    if (state == NULL) {
+        printf("Unable to allocate state. Exiting\n");
+        exit(0);
+    }
+    state->keySize = 4;
+    state->dataSize = 12;
+    state->pageSize = 512;
+    state->numSplinePoints = 300;
+    state->bitmapSize = 0;
+    state->bufferSizeInBlocks = EMBEDDB_USING_VDATA(parameters) ? 4 : 2;
+    state->buffer = calloc(1, (size_t)state->bufferSizeInBlocks * state->pageSize);
+    if (state->buffer == NULL) {
+        printf("Unable to allocate buffer. Exiting\n");
+        exit(0);
+    }
+    state->numDataPages = NUM_DATA_PAGES;
+    state->numVarPages = 128;
+    state->eraseSizeInPages = 4;
+    char dataPath[] = "build/artifacts/dataFile.bin";
+    char varPath[] = "build/artifacts/varFile.bin";
+    char checkpointPath[] = "build/artifacts/checkpointFile.bin";
+    state->fileInterface = getFileInterface();
+    fileRead = state->fileInterface->read;
+    state->fileInterface->read = countingRead;
+    state->fileInterface->readMany = NULL;
+    state->dataFile = setupFile(dataPath);
+    state->varFile = EMBEDDB_USING_VDATA(parameters) ? setupFile(varPath) : NULL;
+    state->checkpointFile = setupFile(checkpointPath);
+    state->checkpointInterval = checkpointInterval;
+    state->parameters = parameters;
+    state->compareKey = int32Comparator;
+    state->compareData = int32Comparator;
+
+    size_t splineMaxError = 1;
+    int8_t result = embedDBInit(state, splineMaxError);
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, result, "embedDB did not initialize correctly.");
+    return state;
+}
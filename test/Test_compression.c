@@ -0,0 +1,257 @@
+#include <stdio.h>
+
+#include "../Unity/src/unity.h"
+#include "../src/embedDB/embedDB.h"
+#include "../src/embedDB/utilityFunctions.h"
+
+/* Sensor reading that changes slowly over time */
+typedef struct {
+    int32_t temperature;
+    int32_t humidity;
+} reading;
+
+embedDBState* init_state(uint32_t parameters);
+void free_state(embedDBState* state);
+uint32_t make_key(uint32_t i);
+reading make_data(uint32_t key);
+void insert_records(embedDBState* state, uint32_t numRecords);
+void check_records(embedDBState* state, uint32_t numRecords);
+
+// global variable for state. Use in setUp() function and tearDown()
+embedDBState* state;
+int8_t dataColumnSizes[] = {-4, -4};
+int8_t randomKeys = 0;
+
+void setUp(void) {
+    state = NULL;
+    randomKeys = 0;
+}
+
+void tearDown(void) {
+    if (state != NULL)
+        free_state(state);
+    state = NULL;
+}
+
+void test_compressed_pages_hold_more_records(void) {
+    uint32_t numRecords = 5000;
+    state = init_state(EMBEDDB_RESET_DATA);
+    insert_records(state, numRecords);
+    id_t uncompressedPages = state->nextDataPageId;
+    free_state(state);
+
+    state = init_state(EMBEDDB_USE_COMPRESSION | EMBEDDB_RESET_DATA);
+    insert_records(state, numRecords);
+    TEST_ASSERT_TRUE(state->nextDataPageId * 3 < uncompressedPages);
+    check_records(state, numRecords);
+}
+
+void test_incompressible_records_are_stored_correctly(void) {
+    randomKeys = 1;
+    state = init_state(EMBEDDB_USE_COMPRESSION | EMBEDDB_USE_MAX_MIN | EMBEDDB_USE_INDEX | EMBEDDB_USE_BMAP | EMBEDDB_RESET_DATA);
+    uint32_t numRecords = 3000;
+    insert_records(state, numRecords);
+    check_records(state, numRecords);
+
+    /* The header is not compressed, so the bitmap and min/max still filter pages */
+    reading expected = make_data(make_key(1500));
+    embedDBIterator it;
+    it.minKey = NULL;
+    it.maxKey = NULL;
+    it.minData = &expected.temperature;
+    it.maxData = &expected.temperature;
+    embedDBInitIterator(state, &it);
+    uint32_t key;
+    reading data;
+    int8_t found = 0;
+    while (embedDBNext(state, &it, &key, &data)) {
+        TEST_ASSERT_EQUAL_INT32(expected.temperature, data.temperature);
+        found |= key == make_key(1500);
+    }
+    embedDBCloseIterator(&it);
+    TEST_ASSERT_TRUE(found);
+}
+
+void test_compression_with_pax_and_variable_data(void) {
+    state = init_state(EMBEDDB_USE_COMPRESSION | EMBEDDB_USE_PAX | EMBEDDB_USE_VDATA | EMBEDDB_RESET_DATA);
+    uint32_t numRecords = 2000;
+    char text[16];
+    for (uint32_t i = 0; i < numRecords; i++) {
+        uint32_t key = make_key(i);
+        reading data = make_data(key);
+        snprintf(text, sizeof(text), "note %u", key);
+        TEST_ASSERT_EQUAL_INT8(0, embedDBPutVar(state, &key, &data, i % 5 == 0 ? text : NULL, i % 5 == 0 ? strlen(text) + 1 : 0));
+    }
+    TEST_ASSERT_EQUAL_INT8(0, embedDBFlush(state));
+
+    for (uint32_t i = 0; i < numRecords; i++) {
+        uint32_t key = make_key(i);
+        reading data, expected = make_data(key);
+        embedDBVarDataStream* stream = NULL;
+        TEST_ASSERT_EQUAL_INT8(0, embedDBGetVar(state, &key, &data, &stream));
+        TEST_ASSERT_EQUAL_MEMORY(&expected, &data, sizeof(reading));
+        if (i % 5 == 0) {
+            char result[16];
+            snprintf(text, sizeof(text), "note %u", key);
+            TEST_ASSERT_NOT_NULL(stream);
+            TEST_ASSERT_EQUAL_UINT32(strlen(text) + 1, embedDBVarDataStreamRead(state, stream, result, sizeof(result)));
+            TEST_ASSERT_EQUAL_STRING(text, result);
+            free(stream);
+        } else {
+            TEST_ASSERT_NULL(stream);
+        }
+    }
+}
+
+void test_compressed_pages_are_recovered(void) {
+    state = init_state(EMBEDDB_USE_COMPRESSION | EMBEDDB_USE_BINARY_SEARCH | EMBEDDB_RESET_DATA);
+    uint32_t numRecords = 4000;
+    uint32_t key = 0;
+    reading data;
+    for (uint32_t i = 0; i < numRecords; i++) {
+        key = make_key(i);
+        data = make_data(key);
+        TEST_ASSERT_EQUAL_INT8(0, embedDBPutBatch(state, &key, &data, 1));
+    }
+    TEST_ASSERT_EQUAL_INT8(0, embedDBFlush(state));
+    free_state(state);
+
+    state = init_state(EMBEDDB_USE_COMPRESSION | EMBEDDB_USE_BINARY_SEARCH);
+    TEST_ASSERT_NOT_NULL(state);
+    check_records(state, numRecords);
+
+    /* Inserts continue after the largest recovered key */
+    key = make_key(numRecords);
+    data = make_data(key);
+    TEST_ASSERT_EQUAL_INT8(0, embedDBPut(state, &key, &data));
+    reading result;
+    TEST_ASSERT_EQUAL_INT8(0, embedDBGet(state, &key, &result));
+    TEST_ASSERT_EQUAL_MEMORY(&data, &result, sizeof(reading));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_compressed_pages_hold_more_records);
+    RUN_TEST(test_incompressible_records_are_stored_correctly);
+    RUN_TEST(test_compression_with_pax_and_variable_data);
+    RUN_TEST(test_compressed_pages_are_recovered);
+    return UNITY_END();
+}
+
+/* Keys are timestamps every 10 seconds with some jitter, or random increasing keys */
+uint32_t make_key(uint32_t i) {
+    if (randomKeys)
+        return i * 1000 + (i * 2654435761u) % 997;
+    return 1700000000 + i * 10 + (i % 7 == 0);
+}
+
+reading make_data(uint32_t key) {
+    reading data;
+    if (randomKeys) {
+        data.temperature = (int32_t)(key * 2246822519u % 1000000);
+        data.humidity = (int32_t)(key * 3266489917u % 1000000);
+    } else {
+        data.temperature = 200 + (int32_t)(key / 400 % 50);
+        data.humidity = 600 + (int32_t)(key / 1500 % 20);
+    }
+    return data;
+}
+
+void insert_records(embedDBState* state, uint32_t numRecords) {
+    for (uint32_t i = 0; i < numRecords; i++) {
+        uint32_t key = make_key(i);
+        reading data = make_data(key);
+        TEST_ASSERT_EQUAL_INT8(0, embedDBPut(state, &key, &data));
+    }
+}
+
+void check_records(embedDBState* state, uint32_t numRecords) {
+    reading data;
+    for (uint32_t i = 0; i < numRecords; i++) {
+        uint32_t key = make_key(i);
+        reading expected = make_data(key);
+        TEST_ASSERT_EQUAL_INT8(0, embedDBGet(state, &key, &data));
+        TEST_ASSERT_EQUAL_MEMORY(&expected, &data, sizeof(reading));
+    }
+
+    uint32_t key, numFound = 0;
+    embedDBIterator it;
+    it.minKey = NULL;
+    it.maxKey = NULL;
+    it.minData = NULL;
+    it.maxData = NULL;
+    embedDBInitIterator(state, &it);
+    while (embedDBNext(state, &it, &key, &data)) {
+        TEST_ASSERT_EQUAL_UINT32(make_key(numFound), key);
+        reading expected = make_data(key);
+        TEST_ASSERT_EQUAL_MEMORY(&expected, &data, sizeof(reading));
+        numFound++;
+    }
+    embedDBCloseIterator(&it);
+    TEST_ASSERT_EQUAL_UINT32(numRecords, numFound);
+}
+
+void free_state(embedDBState* state) {
+    embedDBClose(state);
+    tearDownFile(state->dataFile);
+    if (state->indexFile != NULL)
+        tearDownFile(state->indexFile);
+    if (state->varFile != NULL)
+        tearDownFile(state->varFile);
+    free(state->fileInterface);
+    free(state->buffer);
+    free(state);
+}
+
+/* Function returns a pointer to a newly created embedDBState, or NULL if embedDB failed to initialize */
+embedDBState* init_state(uint32_t parameters) {
+    embedDBState* state = (embedDBState*)malloc(sizeof(embedDBState));
+    if (state == NULL) {
+        printf("Unable to allocate state. Exiting\n");
+        exit(0);
+    }
+    state->keySize = 4;
+    state->dataSize = sizeof(reading);
+    state->pageSize = 512;
+    state->numSplinePoints = 300;
+    state->bitmapSize = EMBEDDB_USING_BMAP(parameters) ? 8 : 0;
+    state->inBitmap = inBitmapInt64;
+    state->updateBitmap = updateBitmapInt64;
+    state->buildBitmapFromRange = buildBitmapInt64FromRange;
+    state->bufferSizeInBlocks = EMBEDDB_USING_VDATA(parameters) || EMBEDDB_USING_INDEX(parameters) ? 4 : 2;
+    state->buffer = calloc(1, (size_t)state->bufferSizeInBlocks * state->pageSize);
+    if (state->buffer == NULL) {
+        printf("Unable to allocate buffer. Exiting\n");
+        exit(0);
+    }
+    state->numDataPages = 1000;
+    state->numIndexPages = 48;
+    state->numVarPages = 100;
+    state->eraseSizeInPages = 4;
+    char dataPath[] = "build/artifacts/dataFile.bin";
+    char indexPath[] = "build/artifacts/indexFile.bin";
+    char varPath[] = "build/artifacts/varFile.bin";
+    state->fileInterface = getFileInterface();
+    state->dataFile = setupFile(dataPath);
+    state->indexFile = EMBEDDB_USING_INDEX(parameters) ? setupFile(indexPath) : NULL;
+    state->varFile = EMBEDDB_USING_VDATA(parameters) ? setupFile(varPath) : NULL;
+    state->parameters = parameters;
+    state->numDataColumns = 2;
+    state->dataColumnSizes = dataColumnSizes;
+    state->compareKey = int32Comparator;
+    state->compareData = int32Comparator;
+
+    size_t splineMaxError = 1;
+    if (embedDBInit(state, splineMaxError) != 0) {
+        tearDownFile(state->dataFile);
+        if (state->indexFile != NULL)
+            tearDownFile(state->indexFile);
+        if (state->varFile != NULL)
+            tearDownFile(state->varFile);
+        free(state->fileInterface);
+        free(state->buffer);
+        free(state);
+        return NULL;
+    }
+    return state;
+}
@@ -190,6 +190,167 @@ void iteratorReturnsCorrectRecords(void) {
     TEST_ASSERT_EQUAL_UINT32_MESSAGE(expectedNum, numRecordsRead, "Iterator did not read the correct number of records");
 }
 
+void embedDB_put_does_not_read_storage_on_page_rollover() {
+    uint32_t key = 0;
+    int32_t data = 0;
+    for (int i = 0; i < 64; i++) {
+        key++;
+        embedDBPut(state, &key, &data);
+    }
+    uint32_t numReads = state->numReads;
+    key++;
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBPut(state, &key, &data), "embedDBPut did not correctly insert data (returned non-zero code)");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(numReads, state->numReads, "embedDBPut read from storage to check key order on page rollover.");
+    key--;
+    TEST_ASSERT_NOT_EQUAL_MESSAGE(0, embedDBPut(state, &key, &data), "embedDBPut accepted a duplicate key after page rollover.");
+}
+
+void embedDB_put_batch_inserts_records_across_pages_correctly() {
+    uint32_t keys[200];
+    int32_t data[200];
+    for (int i = 0; i < 200; i++) {
+        keys[i] = 1000 + i * 3;
+        data[i] = i * 7;
+    }
+    int8_t result = embedDBPutBatch(state, keys, data, 120);
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, result, "embedDBPutBatch did not correctly insert data (returned non-zero code)");
+    result = embedDBPutBatch(state, keys + 120, data + 120, 80);
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, result, "embedDBPutBatch did not correctly insert data (returned non-zero code)");
+    TEST_ASSERT_EQUAL_INT64_MESSAGE(1000, state->minKey, "embedDBPutBatch did not update minimim key on first insert.");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(3, state->nextDataPageId, "embedDBPutBatch did not write the correct number of pages.");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(11, EMBEDDB_GET_COUNT(state->buffer), "embedDBPutBatch did not leave the correct count in buffer.");
+
+    embedDBFlush(state);
+    int32_t returnData = 0;
+    for (int i = 0; i < 200; i++) {
+        TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBGet(state, &keys[i], &returnData), "embedDBGet did not find a record inserted with embedDBPutBatch.");
+        TEST_ASSERT_EQUAL_INT32_MESSAGE(data[i], returnData, "embedDBGet returned the wrong data for a record inserted with embedDBPutBatch.");
+    }
+}
+
+void embedDB_put_batch_rejects_unordered_keys() {
+    uint32_t key = 50;
+    int32_t data = 1;
+    embedDBPut(state, &key, &data);
+
+    uint32_t unsortedKeys[] = {60, 70, 65};
+    int32_t batchData[] = {1, 2, 3};
+    TEST_ASSERT_NOT_EQUAL_MESSAGE(0, embedDBPutBatch(state, unsortedKeys, batchData, 3), "embedDBPutBatch accepted keys that were not in ascending order.");
+    uint32_t smallerKeys[] = {40, 80};
+    TEST_ASSERT_NOT_EQUAL_MESSAGE(0, embedDBPutBatch(state, smallerKeys, batchData, 2), "embedDBPutBatch accepted a key smaller than the last inserted key.");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(1, EMBEDDB_GET_COUNT(state->buffer), "embedDBPutBatch inserted records from a rejected batch.");
+}
+
+embedDBState *createHeaderState(char *dataPath) {
+    embedDBState *headerState = (embedDBState *)malloc(sizeof(embedDBState));
+    headerState->keySize = 4;
+    headerState->dataSize = 4;
+    headerState->pageSize = 512;
+    headerState->bufferSizeInBlocks = 2;
+    headerState->numSplinePoints = 300;
+    headerState->bitmapSize = 1;
+    headerState->buffer = calloc(1, headerState->pageSize * headerState->bufferSizeInBlocks);
+    headerState->numDataPages = 1000;
+    headerState->parameters = EMBEDDB_USE_MAX_MIN | EMBEDDB_USE_BMAP | EMBEDDB_RESET_DATA;
+    headerState->eraseSizeInPages = 4;
+    headerState->fileInterface = getFileInterface();
+    headerState->dataFile = setupFile(dataPath);
+    headerState->compareKey = int32Comparator;
+    headerState->compareData = int32Comparator;
+    headerState->inBitmap = inBitmapInt8;
+    headerState->updateBitmap = updateBitmapInt8;
+    headerState->buildBitmapFromRange = buildBitmapInt8FromRange;
+    embedDBInit(headerState, 1);
+    return headerState;
+}
+
+void freeHeaderState(embedDBState *headerState) {
+    embedDBClose(headerState);
+    tearDownFile(headerState->dataFile);
+    free(headerState->buffer);
+    free(headerState->fileInterface);
+    free(headerState);
+}
+
+void embedDB_put_batch_builds_same_page_as_put() {
+    embedDBState *putState = createHeaderState("build/artifacts/putDataFile.bin");
+    embedDBState *batchState = createHeaderState("build/artifacts/batchDataFile.bin");
+
+    uint32_t keys[70];
+    int32_t data[70];
+    for (int i = 0; i < 70; i++) {
+        keys[i] = 20 + i * 2;
+        data[i] = (i * 37) % 101 - 50;
+        embedDBPut(putState, &keys[i], &data[i]);
+    }
+    embedDBPutBatch(batchState, keys, data, 5);
+    embedDBPutBatch(batchState, keys + 5, data + 5, 65);
+
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(putState->nextDataPageId, batchState->nextDataPageId, "embedDBPutBatch wrote a different number of pages than embedDBPut.");
+    TEST_ASSERT_EQUAL_MEMORY_MESSAGE(putState->buffer, batchState->buffer, putState->pageSize, "embedDBPutBatch built a different write buffer than embedDBPut.");
+
+    readPage(putState, 0);
+    readPage(batchState, 0);
+    TEST_ASSERT_EQUAL_MEMORY_MESSAGE((int8_t *)putState->buffer + putState->pageSize, (int8_t *)batchState->buffer + batchState->pageSize, putState->pageSize, "embedDBPutBatch wrote a different page than embedDBPut.");
+
+    freeHeaderState(putState);
+    freeHeaderState(batchState);
+}
+
+void embedDB_get_many_returns_correct_records() {
+    for (uint32_t key = 0; key < 1000; key++) {
+        int32_t data = key * 2;
+        embedDBPut(state, &key, &data);
+    }
+
+    /* Odd keys past 1000 are not in the database, keys past 945 are still in the write buffer */
+    uint32_t keys[60];
+    for (int i = 0; i < 60; i++) {
+        keys[i] = i < 50 ? i * 19 : 1001 + i;
+    }
+    int32_t data[60];
+    int8_t found[60];
+    int32_t numFound = embedDBGetMany(state, keys, data, found, 60);
+    TEST_ASSERT_EQUAL_INT32_MESSAGE(50, numFound, "embedDBGetMany did not find the correct number of keys.");
+    for (int i = 0; i < 60; i++) {
+        if (i < 50) {
+            TEST_ASSERT_EQUAL_INT8_MESSAGE(1, found[i], "embedDBGetMany did not find a key in the database.");
+            TEST_ASSERT_EQUAL_INT32_MESSAGE(keys[i] * 2, data[i], "embedDBGetMany returned the wrong data.");
+        } else {
+            TEST_ASSERT_EQUAL_INT8_MESSAGE(0, found[i], "embedDBGetMany found a key that is not in the database.");
+        }
+    }
+}
+
+void embedDB_get_many_reads_each_page_once() {
+    for (uint32_t key = 0; key < 1000; key++) {
+        int32_t data = key;
+        embedDBPut(state, &key, &data);
+    }
+    embedDBFlush(state);
+
+    /* Three keys on each of the first 10 pages */
+    uint32_t keys[30];
+    for (int i = 0; i < 30; i++) {
+        keys[i] = (i / 3) * 63 + (i % 3) * 20;
+    }
+    int32_t data[30];
+    int8_t found[30];
+    uint32_t numReads = state->numReads;
+    TEST_ASSERT_EQUAL_INT32_MESSAGE(30, embedDBGetMany(state, keys, data, found, 30), "embedDBGetMany did not find the correct number of keys.");
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32_MESSAGE(10, state->numReads - numReads, "embedDBGetMany read a data page more than once.");
+}
+
+void embedDB_get_many_rejects_unordered_keys() {
+    uint32_t key = 5;
+    int32_t value = 1;
+    embedDBPut(state, &key, &value);
+    uint32_t keys[] = {5, 3};
+    int32_t data[2];
+    int8_t found[2];
+    TEST_ASSERT_EQUAL_INT32_MESSAGE(-1, embedDBGetMany(state, keys, data, found, 2), "embedDBGetMany accepted keys that were not in ascending order.");
+}
+
 void tearDown(void) {
     embedDBClose(state);
     tearDownFile(state->dataFile);
@@ -206,5 +367,12 @@ int main(void) {
     RUN_TEST(embedDB_put_inserts_one_page_of_records_correctly);
     RUN_TEST(embedDB_put_inserts_one_more_than_one_page_of_records_correctly);
     RUN_TEST(iteratorReturnsCorrectRecords);
+    RUN_TEST(embedDB_put_does_not_read_storage_on_page_rollover);
+    RUN_TEST(embedDB_put_batch_inserts_records_across_pages_correctly);
+    RUN_TEST(embedDB_put_batch_rejects_unordered_keys);
+    RUN_TEST(embedDB_put_batch_builds_same_page_as_put);
+    RUN_TEST(embedDB_get_many_returns_correct_records);
+    RUN_TEST(embedDB_get_many_reads_each_page_once);
+    RUN_TEST(embedDB_get_many_rejects_unordered_keys);
     return UNITY_END();
 }
@@ -201,6 +201,68 @@ void test_get_when_all() {
     }
 }
 
+void test_get_and_iterate_into_caller_stream() {
+    char expectedVarData[] = "Testing 000...";
+    char buf[20];
+    embedDBVarDataStream varStream;
+
+    uint32_t key = 57;
+    uint64_t data = 0, expectedData = 57;
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBGetVarInto(state, &key, &data, &varStream), "embedDBGetVarInto did not find the record");
+    TEST_ASSERT_EQUAL_CHAR_ARRAY_MESSAGE(&expectedData, &data, state->dataSize, "embedDBGetVarInto did not return the correct fixed data");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(15, embedDBVarDataStreamRead(state, &varStream, buf, 20), "Returned vardata was not the right length");
+    TEST_ASSERT_EQUAL_CHAR_ARRAY_MESSAGE("Testing 057...", buf, 15, "embedDBGetVarInto did not return the correct vardata");
+
+    // The same stream is set up again for every record of the iterator
+    embedDBIterator it;
+    it.minKey = NULL;
+    it.maxKey = NULL;
+    it.minData = NULL;
+    it.maxData = NULL;
+    embedDBInitIterator(state, &it);
+    uint32_t expectedKey = 0;
+    while (embedDBNextVarInto(state, &it, &key, &data, &varStream)) {
+        expectedVarData[10] = (char)(expectedKey % 10) + '0';
+        expectedVarData[9] = (char)((expectedKey / 10) % 10) + '0';
+        expectedVarData[8] = (char)((expectedKey / 100) % 10) + '0';
+        TEST_ASSERT_EQUAL_UINT32_MESSAGE(expectedKey, key, "embedDBNextVarInto returned the wrong key");
+        TEST_ASSERT_EQUAL_UINT32_MESSAGE(15, embedDBVarDataStreamRead(state, &varStream, buf, 20), "Returned vardata was not the right length");
+        TEST_ASSERT_EQUAL_CHAR_ARRAY_MESSAGE(expectedVarData, buf, 15, "embedDBNextVarInto did not return the correct vardata");
+        expectedKey++;
+    }
+    embedDBCloseIterator(&it);
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(numRecords, expectedKey, "embedDBNextVarInto did not return every record");
+}
+
+uint32_t varLocSeenByListener = 0;
+
+int8_t failingListener(void *context, void *key, void *data) {
+    varLocSeenByListener = state->currentVarLoc;
+    return 1;
+}
+
+void test_failed_listener_keeps_var_record() {
+    embedDBSetInsertListener(state, failingListener, NULL);
+    uint32_t key = numRecords;
+    uint64_t data = 7;
+    char varData[] = "Listener failed";
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBPutVar(state, &key, &data, varData, 16), "embedDBPutVar returned the listener result");
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(1, state->insertListenerError, "The listener failure was not kept");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(state->currentVarLoc, varLocSeenByListener, "The listener was called before the variable data was written");
+
+    char buf[20];
+    uint64_t found = 0;
+    embedDBVarDataStream *varStream = NULL;
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBGetVar(state, &key, &found, &varStream), "embedDBGetVar did not find the record");
+    TEST_ASSERT_NOT_NULL_MESSAGE(varStream, "The record has no variable data");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(16, embedDBVarDataStreamRead(state, varStream, buf, 20), "Returned vardata was not the right length");
+    TEST_ASSERT_EQUAL_CHAR_ARRAY_MESSAGE(varData, buf, 16, "embedDBGetVar did not return the correct vardata");
+    free(varStream);
+
+    embedDBSetInsertListener(state, NULL, NULL);
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(0, state->insertListenerError, "embedDBSetInsertListener did not clear the listener failure");
+}
+
 void test_insert_1() {
     TEST_ASSERT_EQUAL_INT8_MESSAGE(0, insertRecords(1), "embedDBPutVar was not successful when inserting a record");
 }
@@ -234,6 +296,8 @@ int main() {
         RUN_TEST(test_insert_rest);
         embedDBFlush(state);
         RUN_TEST(test_get_when_all);
+        RUN_TEST(test_get_and_iterate_into_caller_stream);
+        RUN_TEST(test_failed_listener_keeps_var_record);
 
         // Clean up state
         resetState();
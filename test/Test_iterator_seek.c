@@ -0,0 +1,233 @@
+#include <stdio.h>
+
+#include "../Unity/src/unity.h"
+#include "../src/embedDB/embedDB.h"
+#include "../src/embedDB/utilityFunctions.h"
+#include "../src/query-interface/advancedQueries.h"
+
+embedDBState* init_state(uint32_t parameters, char* dataPath);
+void free_state(embedDBState* state);
+void insert_records(embedDBState* state, uint32_t numRecords, uint32_t keyStep);
+void check_seeks(embedDBState* state);
+
+// global variables for states. Use in setUp() function and tearDown()
+embedDBState* state;
+embedDBState* sparseState;
+
+void setUp(void) {
+    state = NULL;
+    sparseState = NULL;
+}
+
+void tearDown(void) {
+    if (state != NULL)
+        free_state(state);
+    if (sparseState != NULL)
+        free_state(sparseState);
+    state = NULL;
+    sparseState = NULL;
+}
+
+void test_seek_with_spline(void) {
+    state = init_state(EMBEDDB_RESET_DATA, "build/artifacts/dataFile.bin");
+    insert_records(state, 20000, 2);
+    check_seeks(state);
+}
+
+void test_seek_with_radix_spline_and_binary_search(void) {
+    state = init_state(EMBEDDB_USE_RADIX | EMBEDDB_RESET_DATA, "build/artifacts/dataFile.bin");
+    insert_records(state, 20000, 2);
+    check_seeks(state);
+    free_state(state);
+
+    state = init_state(EMBEDDB_USE_BINARY_SEARCH | EMBEDDB_RESET_DATA, "build/artifacts/dataFile.bin");
+    insert_records(state, 20000, 2);
+    check_seeks(state);
+}
+
+void test_seek_reads_few_pages(void) {
+    state = init_state(EMBEDDB_RESET_DATA, "build/artifacts/dataFile.bin");
+    insert_records(state, 50000, 1);
+
+    embedDBIterator it;
+    it.minKey = NULL;
+    it.maxKey = NULL;
+    it.minData = NULL;
+    it.maxData = NULL;
+    embedDBInitIterator(state, &it);
+
+    uint32_t key, seekKey = 40000, reads = state->numReads;
+    int32_t data;
+    TEST_ASSERT_EQUAL_INT8(0, embedDBIteratorSeek(state, &it, &seekKey));
+    TEST_ASSERT_TRUE(embedDBNext(state, &it, &key, &data));
+    TEST_ASSERT_EQUAL_UINT32(40000, key);
+    TEST_ASSERT_TRUE(state->numReads - reads <= 4);
+    embedDBCloseIterator(&it);
+}
+
+void test_key_join_gallops_over_dense_input(void) {
+    /* Every 1000th key of the dense table is in the sparse table */
+    uint32_t numRecords = 60000;
+    state = init_state(EMBEDDB_RESET_DATA, "build/artifacts/dataFile.bin");
+    insert_records(state, numRecords, 1);
+    sparseState = init_state(EMBEDDB_RESET_DATA, "build/artifacts/dataFile2.bin");
+    insert_records(sparseState, numRecords / 1000, 1000);
+
+    embedDBIterator it1, it2;
+    it1.minKey = it2.minKey = NULL;
+    it1.maxKey = it2.maxKey = NULL;
+    it1.minData = it2.minData = NULL;
+    it1.maxData = it2.maxData = NULL;
+    embedDBInitIterator(sparseState, &it1);
+    embedDBInitIterator(state, &it2);
+
+    int8_t colSizes[] = {4, 4};
+    int8_t colSignedness[] = {embedDB_COLUMN_UNSIGNED, embedDB_COLUMN_SIGNED};
+    embedDBSchema* schema = embedDBCreateSchema(2, colSizes, colSignedness);
+    embedDBOperator* scan1 = createTableScanOperator(sparseState, &it1, schema);
+    embedDBOperator* scan2 = createTableScanOperator(state, &it2, schema);
+    embedDBOperator* join = createKeyJoinOperator(scan1, scan2);
+    join->init(join);
+
+    uint32_t reads = state->numReads, numFound = 0;
+    uint32_t* recordBuffer = join->recordBuffer;
+    while (exec(join)) {
+        TEST_ASSERT_EQUAL_UINT32(numFound * 1000, recordBuffer[0]);
+        TEST_ASSERT_EQUAL_UINT32(numFound * 1000, recordBuffer[2]);
+        TEST_ASSERT_EQUAL_INT32(0, recordBuffer[1]);
+        numFound++;
+    }
+    TEST_ASSERT_EQUAL_UINT32(numRecords / 1000, numFound);
+
+    /* Without seeking every page of the dense table would be read */
+    TEST_ASSERT_TRUE(state->nextDataPageId > 900);
+    TEST_ASSERT_TRUE(state->numReads - reads < 4 * numFound);
+
+    join->close(join);
+    embedDBFreeOperatorRecursive(&join);
+    embedDBFreeOperatorRecursive(&scan2);
+    embedDBFreeSchema(&schema);
+    embedDBCloseIterator(&it1);
+    embedDBCloseIterator(&it2);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_seek_with_spline);
+    RUN_TEST(test_seek_with_radix_spline_and_binary_search);
+    RUN_TEST(test_seek_reads_few_pages);
+    RUN_TEST(test_key_join_gallops_over_dense_input);
+    return UNITY_END();
+}
+
+void insert_records(embedDBState* state, uint32_t numRecords, uint32_t keyStep) {
+    for (uint32_t i = 0; i < numRecords; i++) {
+        uint32_t key = i * keyStep;
+        int32_t data = (int32_t)(key % 1000);
+        TEST_ASSERT_EQUAL_INT8(0, embedDBPut(state, &key, &data));
+    }
+}
+
+/* Checks seeking on a table holding the even keys below 40000, with the last records in the write buffer */
+void check_seeks(embedDBState* state) {
+    TEST_ASSERT_TRUE(EMBEDDB_GET_COUNT(state->dataWriteBuffer) > 0);
+
+    embedDBIterator it;
+    it.minKey = NULL;
+    it.maxKey = NULL;
+    it.minData = NULL;
+    it.maxData = NULL;
+    embedDBInitIterator(state, &it);
+
+    uint32_t key, seekKey;
+    int32_t data;
+
+    /* A key that is not in the table moves to the next key */
+    seekKey = 1001;
+    TEST_ASSERT_EQUAL_INT8(0, embedDBIteratorSeek(state, &it, &seekKey));
+    TEST_ASSERT_TRUE(embedDBNext(state, &it, &key, &data));
+    TEST_ASSERT_EQUAL_UINT32(1002, key);
+    TEST_ASSERT_EQUAL_INT32(2, data);
+
+    /* Seeking backwards does nothing */
+    seekKey = 10;
+    TEST_ASSERT_EQUAL_INT8(0, embedDBIteratorSeek(state, &it, &seekKey));
+    TEST_ASSERT_TRUE(embedDBNext(state, &it, &key, &data));
+    TEST_ASSERT_EQUAL_UINT32(1004, key);
+
+    /* Seeking to the next key keeps reading in order */
+    seekKey = 1006;
+    TEST_ASSERT_EQUAL_INT8(0, embedDBIteratorSeek(state, &it, &seekKey));
+    TEST_ASSERT_TRUE(embedDBNext(state, &it, &key, &data));
+    TEST_ASSERT_EQUAL_UINT32(1006, key);
+
+    /* Keys on the last page on file and in the write buffer */
+    uint32_t lastPageKey = state->nextDataPageId * state->maxRecordsPerPage * 2;
+    seekKey = lastPageKey - 3;
+    TEST_ASSERT_EQUAL_INT8(0, embedDBIteratorSeek(state, &it, &seekKey));
+    TEST_ASSERT_TRUE(embedDBNext(state, &it, &key, &data));
+    TEST_ASSERT_EQUAL_UINT32(lastPageKey - 2, key);
+    TEST_ASSERT_TRUE(embedDBNext(state, &it, &key, &data));
+    TEST_ASSERT_EQUAL_UINT32(lastPageKey, key);
+
+    seekKey = 39991;
+    TEST_ASSERT_EQUAL_INT8(0, embedDBIteratorSeek(state, &it, &seekKey));
+    TEST_ASSERT_TRUE(embedDBNext(state, &it, &key, &data));
+    TEST_ASSERT_EQUAL_UINT32(39992, key);
+
+    /* Past the largest key there is nothing left */
+    seekKey = 50000;
+    TEST_ASSERT_EQUAL_INT8(0, embedDBIteratorSeek(state, &it, &seekKey));
+    TEST_ASSERT_FALSE(embedDBNext(state, &it, &key, &data));
+    embedDBCloseIterator(&it);
+
+    /* Seeking works with a data filter too */
+    int32_t minData = 500;
+    it.minData = &minData;
+    embedDBInitIterator(state, &it);
+    seekKey = 20001;
+    TEST_ASSERT_EQUAL_INT8(0, embedDBIteratorSeek(state, &it, &seekKey));
+    TEST_ASSERT_TRUE(embedDBNext(state, &it, &key, &data));
+    TEST_ASSERT_EQUAL_UINT32(20500, key);
+    embedDBCloseIterator(&it);
+}
+
+void free_state(embedDBState* state) {
+    embedDBClose(state);
+    tearDownFile(state->dataFile);
+    free(state->fileInterface);
+    free(state->buffer);
+    free(state);
+}
+
+/* Function returns a pointer to a newly created embedDBState */
+embedDBState* init_state(uint32_t parameters, char* dataPath) {
+    embedDBState* state = (embedDBState*)malloc(sizeof(embedDBState));
+    if (state == NULL) {
+        printf("Unable to allocate state. Exiting\n");
+        exit(0);
+    }
+    state->keySize = 4;
+    state->dataSize = 4;
+    state->pageSize = 512;
+    state->numSplinePoints = 300;
+    state->radixBits = EMBEDDB_USING_RADIX(parameters) ? 8 : 0;
+    state->bitmapSize = 0;
+    state->bufferSizeInBlocks = 4;
+    state->buffer = calloc(1, (size_t)state->bufferSizeInBlocks * state->pageSize);
+    if (state->buffer == NULL) {
+        printf("Unable to allocate buffer. Exiting\n");
+        exit(0);
+    }
+    state->numDataPages = 2000;
+    state->eraseSizeInPages = 4;
+    state->fileInterface = getFileInterface();
+    state->dataFile = setupFile(dataPath);
+    state->parameters = parameters;
+    state->compareKey = int32Comparator;
+    state->compareData = int32Comparator;
+
+    size_t splineMaxError = 1;
+    TEST_ASSERT_EQUAL_INT8(0, embedDBInit(state, splineMaxError));
+    return state;
+}
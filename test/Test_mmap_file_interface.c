@@ -0,0 +1,179 @@
+#include <stdio.h>
+
+#include "../Unity/src/unity.h"
+#include "../src/embedDB/embedDB.h"
+#include "../src/embedDB/utilityFunctions.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+
+#define NUM_DATA_PAGES 64
+
+embedDBState* init_state(uint32_t parameters);
+void free_state(embedDBState* state);
+void insert_records(embedDBState* state, uint32_t startKey, uint32_t numRecords);
+
+// global variable for state. Use in setUp() function and tearDown()
+embedDBState* state;
+
+void setUp(void) {
+    state = init_state(EMBEDDB_RESET_DATA);
+    TEST_ASSERT_NOT_NULL_MESSAGE(state, "embedDB did not initialize with the mmap file interface.");
+}
+
+void tearDown(void) {
+    free_state(state);
+    state = NULL;
+}
+
+void test_get_reads_page_without_copy(void) {
+    uint32_t recordsPerPage = state->maxRecordsPerPage;
+    insert_records(state, 0, recordsPerPage * 20);
+    embedDBFlush(state);
+
+    int8_t* readBuffer = (int8_t*)state->buffer + EMBEDDB_DATA_READ_BUFFER * state->pageSize;
+    memset(readBuffer, 0, state->pageSize);
+
+    int32_t data[3];
+    for (uint32_t key = 0; key < recordsPerPage * 20; key += 7) {
+        TEST_ASSERT_EQUAL_INT8(0, embedDBGet(state, &key, data));
+        TEST_ASSERT_EQUAL_INT32(key + 100, data[0]);
+        TEST_ASSERT_TRUE_MESSAGE(state->dataReadBuffer != readBuffer, "Data page was copied into the read buffer instead of borrowed.");
+    }
+
+    /* Nothing was ever copied into the read buffer */
+    TEST_ASSERT_EQUAL_UINT16(0, EMBEDDB_GET_COUNT(readBuffer));
+}
+
+void test_iterator_returns_all_records(void) {
+    uint32_t recordsPerPage = state->maxRecordsPerPage;
+    uint32_t numRecords = recordsPerPage * 12 + 5;
+    insert_records(state, 0, numRecords);
+
+    uint32_t minKey = recordsPerPage * 2 + 3;
+    embedDBIterator it;
+    it.minKey = &minKey;
+    it.maxKey = NULL;
+    it.minData = NULL;
+    it.maxData = NULL;
+    embedDBInitIterator(state, &it);
+
+    uint32_t key = 0, expectedKey = minKey;
+    int32_t data[3];
+    while (embedDBNext(state, &it, &key, data)) {
+        TEST_ASSERT_EQUAL_UINT32(expectedKey, key);
+        TEST_ASSERT_EQUAL_INT32(expectedKey + 100, data[0]);
+        expectedKey++;
+    }
+    TEST_ASSERT_EQUAL_UINT32(numRecords, expectedKey);
+    embedDBCloseIterator(&it);
+}
+
+void test_recovers_from_mapped_file(void) {
+    uint32_t recordsPerPage = state->maxRecordsPerPage;
+    uint32_t numRecords = recordsPerPage * 9;
+    insert_records(state, 0, numRecords);
+    embedDBFlush(state);
+    free_state(state);
+
+    state = init_state(0);
+    TEST_ASSERT_NOT_NULL_MESSAGE(state, "embedDB did not recover from the mapped data file.");
+    TEST_ASSERT_EQUAL_UINT32(9, state->nextDataPageId);
+    TEST_ASSERT_EQUAL_UINT32(numRecords - 1, (uint32_t)state->maxKey);
+
+    int32_t data[3];
+    uint32_t key = recordsPerPage * 4 + 1;
+    TEST_ASSERT_EQUAL_INT8(0, embedDBGet(state, &key, data));
+    TEST_ASSERT_EQUAL_INT32(key + 100, data[0]);
+
+    /* Keep inserting after recovery */
+    insert_records(state, numRecords, recordsPerPage);
+    embedDBFlush(state);
+    key = numRecords + 1;
+    TEST_ASSERT_EQUAL_INT8(0, embedDBGet(state, &key, data));
+    TEST_ASSERT_EQUAL_INT32(key + 100, data[0]);
+}
+
+void test_write_past_mapped_size_fails(void) {
+    int8_t* page = (int8_t*)state->buffer;
+    TEST_ASSERT_EQUAL_INT8(1, state->fileInterface->write(page, NUM_DATA_PAGES - 1, state->pageSize, state->dataFile));
+    TEST_ASSERT_EQUAL_INT8(0, state->fileInterface->write(page, NUM_DATA_PAGES, state->pageSize, state->dataFile));
+    TEST_ASSERT_NULL(state->fileInterface->borrow(NUM_DATA_PAGES, state->pageSize, state->dataFile));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_get_reads_page_without_copy);
+    RUN_TEST(test_iterator_returns_all_records);
+    RUN_TEST(test_recovers_from_mapped_file);
+    RUN_TEST(test_write_past_mapped_size_fails);
+    return UNITY_END();
+}
+
+void insert_records(embedDBState* state, uint32_t startKey, uint32_t numRecords) {
+    int32_t data[3] = {0, 0, 0};
+    for (uint32_t key = startKey; key < startKey + numRecords; key++) {
+        data[0] = key + 100;
+        TEST_ASSERT_EQUAL_INT8(0, embedDBPut(state, &key, data));
+    }
+}
+
+void free_state(embedDBState* state) {
+    embedDBClose(state);
+    tearDownMmapFile(state->dataFile);
+    free(state->fileInterface);
+    free(state->buffer);
+    free(state);
+}
+
+/* Function returns a pointer to a newly created embedDBState using the mmap file interface, or NULL if embedDB failed to initialize */
+embedDBState* init_state(uint32_t parameters) {
+    embedDBState* state = (embedDBState*)malloc(sizeof(embedDBState));
+    if (state == NULL) {
+        printf("Unable to allocate state. Exiting\n");
+        exit(0);
+    }
+    state->keySize = 4;
+    state->dataSize = 12;
+    state->pageSize = 512;
+    state->numSplinePoints = 300;
+    state->bitmapSize = 0;
+    state->bufferSizeInBlocks = 2;
+    state->buffer = malloc((size_t)state->bufferSizeInBlocks * state->pageSize);
+    if (state->buffer == NULL) {
+        printf("Unable to allocate buffer. Exiting\n");
+        exit(0);
+    }
+    state->numDataPages = NUM_DATA_PAGES;
+    state->eraseSizeInPages = 4;
+    char dataPath[] = "build/artifacts/dataFile.bin";
+    state->fileInterface = getMmapFileInterface();
+    state->dataFile = setupMmapFile(dataPath, state->numDataPages, state->pageSize);
+    state->parameters = parameters;
+    state->compareKey = int32Comparator;
+    state->compareData = int32Comparator;
+
+    size_t splineMaxError = 1;
+    if (embedDBInit(state, splineMaxError) != 0) {
+        tearDownMmapFile(state->dataFile);
+        free(state->fileInterface);
+        free(state->buffer);
+        free(state);
+        return NULL;
+    }
+
+    embedDBResetStats(state);
+    return state;
+}
+
+#else
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+int main() {
+    UNITY_BEGIN();
+    return UNITY_END();
+}
+
+#endif
@@ -0,0 +1,305 @@
+#include <math.h>
+#include <stdio.h>
+
+#include "../Unity/src/unity.h"
+#include "../src/embedDB/embedDB.h"
+#include "../src/embedDB/utilityFunctions.h"
+#include "../src/query-interface/advancedQueries.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+
+#define NUM_RECORDS 60000
+
+embedDBState* init_state(uint32_t parameters);
+void free_state(embedDBState* state);
+int32_t make_temp(uint32_t key);
+int32_t make_humidity(uint32_t key);
+void insert_records(embedDBState* state, uint32_t numRecords);
+void count_page(void* records, uint32_t numRecords, void* context, uint8_t worker);
+void init_iterator(embedDBIterator* it, uint32_t* minKey, uint32_t* maxKey, int32_t* minData, int32_t* maxData);
+void free_aggregate(embedDBAggregateFunc* func);
+
+/* Records seen by each worker of a scan */
+typedef struct {
+    uint8_t* seen;
+    uint32_t numRecords[EMBEDDB_MAX_SCAN_WORKERS];
+    int64_t sum[EMBEDDB_MAX_SCAN_WORKERS];
+    uint32_t numCalls[EMBEDDB_MAX_SCAN_WORKERS];
+    int8_t duplicate;
+} scanCounts;
+
+void reset_counts(scanCounts* counts);
+
+// global variable for state. Use in setUp() function and tearDown()
+embedDBState* state;
+
+void setUp(void) {
+    state = init_state(EMBEDDB_USE_INDEX | EMBEDDB_USE_BMAP | EMBEDDB_RESET_DATA);
+    insert_records(state, NUM_RECORDS);
+}
+
+void tearDown(void) {
+    free_state(state);
+    state = NULL;
+}
+
+void test_parallel_scan_returns_every_record_once(void) {
+    uint8_t workerCounts[] = {1, 4, 8};
+    for (uint8_t t = 0; t < 3; t++) {
+        scanCounts counts = {0};
+        counts.seen = calloc(NUM_RECORDS, 1);
+        embedDBIterator it;
+        init_iterator(&it, NULL, NULL, NULL, NULL);
+        TEST_ASSERT_EQUAL_INT8(0, embedDBParallelScan(state, &it, workerCounts[t], count_page, &counts));
+        embedDBCloseIterator(&it);
+
+        uint32_t total = 0, numWorkersUsed = 0;
+        int64_t sum = 0;
+        for (uint8_t w = 0; w < EMBEDDB_MAX_SCAN_WORKERS; w++) {
+            total += counts.numRecords[w];
+            sum += counts.sum[w];
+            numWorkersUsed += counts.numCalls[w] > 0;
+        }
+        TEST_ASSERT_FALSE(counts.duplicate);
+        TEST_ASSERT_EQUAL_UINT32(NUM_RECORDS, total);
+        TEST_ASSERT_TRUE(numWorkersUsed <= workerCounts[t]);
+        int64_t expected = 0;
+        for (uint32_t key = 0; key < NUM_RECORDS; key++)
+            expected += make_temp(key);
+        TEST_ASSERT_TRUE(expected == sum);
+        free(counts.seen);
+    }
+}
+
+void test_parallel_scan_filters_and_prunes_pages(void) {
+    /* Key range, including records still in the write buffer */
+    scanCounts counts = {0};
+    counts.seen = calloc(NUM_RECORDS, 1);
+    uint32_t minKey = 10000, maxKey = NUM_RECORDS - 1;
+    embedDBIterator it;
+    init_iterator(&it, &minKey, &maxKey, NULL, NULL);
+    uint32_t numReads = state->numReads;
+    TEST_ASSERT_EQUAL_INT8(0, embedDBParallelScan(state, &it, 4, count_page, &counts));
+    embedDBCloseIterator(&it);
+    uint32_t total = 0;
+    for (uint8_t w = 0; w < EMBEDDB_MAX_SCAN_WORKERS; w++)
+        total += counts.numRecords[w];
+    TEST_ASSERT_EQUAL_UINT32(maxKey - minKey + 1, total);
+    for (uint32_t key = 0; key < NUM_RECORDS; key++)
+        TEST_ASSERT_EQUAL_UINT8(key >= minKey, counts.seen[key]);
+    TEST_ASSERT_TRUE(state->numReads - numReads < state->nextDataPageId - state->minDataPageId);
+
+    /* The bitmap index skips the pages without the hot readings */
+    reset_counts(&counts);
+    int32_t minData = 900;
+    init_iterator(&it, NULL, NULL, &minData, NULL);
+    numReads = state->numReads;
+    TEST_ASSERT_EQUAL_INT8(0, embedDBParallelScan(state, &it, 4, count_page, &counts));
+    embedDBCloseIterator(&it);
+    uint32_t expected = 0;
+    total = 0;
+    for (uint32_t key = 0; key < NUM_RECORDS; key++)
+        expected += make_temp(key) >= minData;
+    for (uint8_t w = 0; w < EMBEDDB_MAX_SCAN_WORKERS; w++)
+        total += counts.numRecords[w];
+    TEST_ASSERT_EQUAL_UINT32(expected, total);
+    TEST_ASSERT_TRUE((state->numReads - numReads) * 4 < state->nextDataPageId);
+
+    /* Pages past the max key are not read */
+    reset_counts(&counts);
+    maxKey = 2000;
+    init_iterator(&it, NULL, &maxKey, NULL, NULL);
+    numReads = state->numReads;
+    TEST_ASSERT_EQUAL_INT8(0, embedDBParallelScan(state, &it, 8, count_page, &counts));
+    embedDBCloseIterator(&it);
+    total = 0;
+    for (uint8_t w = 0; w < EMBEDDB_MAX_SCAN_WORKERS; w++)
+        total += counts.numRecords[w];
+    TEST_ASSERT_EQUAL_UINT32(maxKey + 1, total);
+    TEST_ASSERT_TRUE(state->numReads - numReads < state->nextDataPageId / 4);
+    free(counts.seen);
+}
+
+void test_parallel_aggregate_matches_serial_aggregate(void) {
+    int8_t colSizes[] = {4, 4, 4};
+    int8_t colSignedness[] = {embedDB_COLUMN_UNSIGNED, embedDB_COLUMN_SIGNED, embedDB_COLUMN_SIGNED};
+    embedDBSchema* schema = embedDBCreateSchema(3, colSizes, colSignedness);
+
+    embedDBAggregateFunc* counter = createCountAggregate();
+    embedDBAggregateFunc* sumTemp = createSumAggregate(1);
+    embedDBAggregateFunc* minTemp = createMinAggregate(1, -4);
+    embedDBAggregateFunc* maxHumidity = createMaxAggregate(2, -4);
+    embedDBAggregateFunc* avgTemp = createAvgAggregate(1, 8);
+    embedDBAggregateFunc functions[] = {*counter, *sumTemp, *minTemp, *maxHumidity, *avgTemp};
+
+    uint32_t minKey = 1234;
+    embedDBIterator it;
+    init_iterator(&it, &minKey, NULL, NULL, NULL);
+    int8_t result[4 + 8 + 4 + 4 + 8];
+    TEST_ASSERT_EQUAL_INT8(0, embedDBParallelAggregate(state, &it, schema, functions, 5, 6, result));
+    embedDBCloseIterator(&it);
+
+    uint32_t expectedCount = 0;
+    int64_t expectedSum = 0;
+    int32_t expectedMin = INT32_MAX, expectedMax = INT32_MIN;
+    for (uint32_t key = minKey; key < NUM_RECORDS; key++) {
+        expectedCount++;
+        expectedSum += make_temp(key);
+        expectedMin = min(expectedMin, make_temp(key));
+        expectedMax = max(expectedMax, make_humidity(key));
+    }
+    uint32_t count;
+    int64_t sum;
+    int32_t minValue, maxValue;
+    double avg;
+    memcpy(&count, result, 4);
+    memcpy(&sum, result + 4, 8);
+    memcpy(&minValue, result + 12, 4);
+    memcpy(&maxValue, result + 16, 4);
+    memcpy(&avg, result + 20, 8);
+    TEST_ASSERT_EQUAL_UINT32(expectedCount, count);
+    TEST_ASSERT_TRUE(expectedSum == sum);
+    TEST_ASSERT_EQUAL_INT32(expectedMin, minValue);
+    TEST_ASSERT_EQUAL_INT32(expectedMax, maxValue);
+    TEST_ASSERT_TRUE(fabs(expectedSum / (double)expectedCount - avg) < 1e-9);
+
+    /* A function without a merge cannot be split between workers */
+    embedDBAggregateFunc custom = {NULL, NULL, NULL, NULL, 4};
+    init_iterator(&it, NULL, NULL, NULL, NULL);
+    TEST_ASSERT_EQUAL_INT8(-1, embedDBParallelAggregate(state, &it, schema, &custom, 1, 4, NULL));
+    embedDBCloseIterator(&it);
+
+    free_aggregate(counter);
+    free_aggregate(sumTemp);
+    free_aggregate(minTemp);
+    free_aggregate(maxHumidity);
+    free_aggregate(avgTemp);
+    embedDBFreeSchema(&schema);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_parallel_scan_returns_every_record_once);
+    RUN_TEST(test_parallel_scan_filters_and_prunes_pages);
+    RUN_TEST(test_parallel_aggregate_matches_serial_aggregate);
+    return UNITY_END();
+}
+
+/* Readings below 800 except for a hot spot every 5000 records */
+int32_t make_temp(uint32_t key) {
+    if (key % 5000 < 20)
+        return 1000;
+    return (int32_t)(key / 7 % 700) - 100;
+}
+
+int32_t make_humidity(uint32_t key) {
+    return (int32_t)(key * 31 % 101);
+}
+
+void insert_records(embedDBState* state, uint32_t numRecords) {
+    for (uint32_t key = 0; key < numRecords; key++) {
+        int32_t data[2] = {make_temp(key), make_humidity(key)};
+        TEST_ASSERT_EQUAL_INT8(0, embedDBPut(state, &key, data));
+    }
+}
+
+/* Counts the records of a page for the worker. Every worker only writes its own counts */
+void count_page(void* records, uint32_t numRecords, void* context, uint8_t worker) {
+    scanCounts* counts = (scanCounts*)context;
+    for (uint32_t i = 0; i < numRecords; i++) {
+        int8_t* record = (int8_t*)records + i * 12;
+        uint32_t key;
+        int32_t temp;
+        memcpy(&key, record, 4);
+        memcpy(&temp, record + 4, 4);
+        if (counts->seen[key])
+            counts->duplicate = 1;
+        counts->seen[key] = 1;
+        counts->sum[worker] += temp;
+    }
+    counts->numRecords[worker] += numRecords;
+    counts->numCalls[worker]++;
+}
+
+void reset_counts(scanCounts* counts) {
+    uint8_t* seen = counts->seen;
+    memset(counts, 0, sizeof(scanCounts));
+    memset(seen, 0, NUM_RECORDS);
+    counts->seen = seen;
+}
+
+void init_iterator(embedDBIterator* it, uint32_t* minKey, uint32_t* maxKey, int32_t* minData, int32_t* maxData) {
+    it->minKey = minKey;
+    it->maxKey = maxKey;
+    it->minData = minData;
+    it->maxData = maxData;
+    embedDBInitIterator(state, it);
+}
+
+void free_aggregate(embedDBAggregateFunc* func) {
+    free(func->state);
+    free(func);
+}
+
+void free_state(embedDBState* state) {
+    embedDBClose(state);
+    tearDownPosixFile(state->dataFile);
+    tearDownPosixFile(state->indexFile);
+    free(state->fileInterface);
+    free(state->buffer);
+    free(state);
+}
+
+/* Function returns a pointer to a newly created embedDBState using the POSIX file interface, whose reads can run on several threads */
+embedDBState* init_state(uint32_t parameters) {
+    embedDBState* state = (embedDBState*)malloc(sizeof(embedDBState));
+    if (state == NULL) {
+        printf("Unable to allocate state. Exiting\n");
+        exit(0);
+    }
+    state->keySize = 4;
+    state->dataSize = 8;
+    state->pageSize = 512;
+    state->numSplinePoints = 300;
+    state->bitmapSize = 2;
+    state->inBitmap = inBitmapInt16;
+    state->updateBitmap = updateBitmapInt16;
+    state->buildBitmapFromRange = buildBitmapInt16FromRange;
+    state->bufferSizeInBlocks = 4;
+    state->buffer = calloc(1, (size_t)state->bufferSizeInBlocks * state->pageSize);
+    if (state->buffer == NULL) {
+        printf("Unable to allocate buffer. Exiting\n");
+        exit(0);
+    }
+    state->numDataPages = 3000;
+    state->numIndexPages = 48;
+    state->eraseSizeInPages = 4;
+    char dataPath[] = "build/artifacts/dataFile.bin";
+    char indexPath[] = "build/artifacts/indexFile.bin";
+    state->fileInterface = getPosixFileInterface();
+    state->dataFile = setupPosixFile(dataPath, state->pageSize, 0);
+    state->indexFile = setupPosixFile(indexPath, state->pageSize, 0);
+    state->parameters = parameters;
+    state->compareKey = int32Comparator;
+    state->compareData = int32Comparator;
+
+    size_t splineMaxError = 1;
+    if (embedDBInit(state, splineMaxError) != 0) {
+        printf("Unable to initialize embedDB. Exiting\n");
+        exit(0);
+    }
+    return state;
+}
+
+#else
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+int main() {
+    UNITY_BEGIN();
+    return UNITY_END();
+}
+
+#endif
@@ -0,0 +1,269 @@
+#include <stddef.h>
+#include <stdio.h>
+
+#include "../Unity/src/unity.h"
+#include "../src/embedDB/embedDB.h"
+#include "../src/embedDB/utilityFunctions.h"
+
+/* Data is split into a 4 byte, a 2 byte, a 2 byte and a 4 byte column */
+typedef struct {
+    int32_t value;
+    int16_t small;
+    uint16_t id;
+    int32_t other;
+} record_data;
+
+embedDBState* init_state(uint32_t parameters, uint8_t numDataColumns);
+void free_state(embedDBState* state);
+void insert_records(embedDBState* state, uint32_t numRecords);
+record_data make_data(uint32_t key);
+
+// global variable for state. Use in setUp() function and tearDown()
+embedDBState* state;
+int8_t dataColumnSizes[] = {-4, -2, 2, -4};
+
+void setUp(void) {
+    state = NULL;
+}
+
+void tearDown(void) {
+    if (state != NULL)
+        free_state(state);
+    state = NULL;
+}
+
+void test_page_stores_columns_contiguously(void) {
+    state = init_state(EMBEDDB_USE_PAX | EMBEDDB_RESET_DATA, 4);
+    insert_records(state, 10);
+
+    int8_t* page = (int8_t*)state->buffer + EMBEDDB_DATA_WRITE_BUFFER * state->pageSize;
+    int8_t* keys = page + state->headerSize;
+    int8_t* ids = keys + state->maxRecordsPerPage * (state->keySize + 6);
+    for (uint32_t i = 0; i < 10; i++) {
+        uint32_t key;
+        uint16_t id;
+        memcpy(&key, keys + i * sizeof(uint32_t), sizeof(uint32_t));
+        memcpy(&id, ids + i * sizeof(uint16_t), sizeof(uint16_t));
+        TEST_ASSERT_EQUAL_UINT32(i, key);
+        TEST_ASSERT_EQUAL_UINT16(make_data(i).id, id);
+    }
+}
+
+void test_get_and_next_return_rows(void) {
+    state = init_state(EMBEDDB_USE_PAX | EMBEDDB_RESET_DATA, 4);
+    uint32_t numRecords = state->maxRecordsPerPage * 30 + 7;
+    insert_records(state, numRecords);
+
+    record_data data;
+    for (uint32_t key = 0; key < numRecords; key++) {
+        TEST_ASSERT_EQUAL_INT8(0, embedDBGet(state, &key, &data));
+        record_data expected = make_data(key);
+        TEST_ASSERT_EQUAL_MEMORY(&expected, &data, sizeof(record_data));
+    }
+
+    /* Data filters compare the whole row */
+    int32_t minData = 400, maxData = 900;
+    embedDBIterator it;
+    it.minKey = NULL;
+    it.maxKey = NULL;
+    it.minData = &minData;
+    it.maxData = &maxData;
+    embedDBInitIterator(state, &it);
+    uint32_t key = 0, numFound = 0, expectedFound = 0;
+    for (uint32_t i = 0; i < numRecords; i++)
+        expectedFound += make_data(i).value >= minData && make_data(i).value <= maxData;
+    while (embedDBNext(state, &it, &key, &data)) {
+        record_data expected = make_data(key);
+        TEST_ASSERT_EQUAL_MEMORY(&expected, &data, sizeof(record_data));
+        TEST_ASSERT_TRUE(data.value >= minData && data.value <= maxData);
+        numFound++;
+    }
+    embedDBCloseIterator(&it);
+    TEST_ASSERT_EQUAL_UINT32(expectedFound, numFound);
+}
+
+void test_single_data_column_with_batch_put(void) {
+    state = init_state(EMBEDDB_USE_PAX | EMBEDDB_RESET_DATA, 0);
+    uint32_t numRecords = state->maxRecordsPerPage * 5 + 3;
+    uint32_t* keys = malloc(numRecords * sizeof(uint32_t));
+    record_data* data = malloc(numRecords * sizeof(record_data));
+    for (uint32_t i = 0; i < numRecords; i++) {
+        keys[i] = i * 2;
+        data[i] = make_data(i * 2);
+    }
+    TEST_ASSERT_EQUAL_INT8(0, embedDBPutBatch(state, keys, data, numRecords));
+
+    record_data result;
+    for (uint32_t i = 0; i < numRecords; i++) {
+        TEST_ASSERT_EQUAL_INT8(0, embedDBGet(state, &keys[i], &result));
+        TEST_ASSERT_EQUAL_MEMORY(&data[i], &result, sizeof(record_data));
+    }
+    free(keys);
+    free(data);
+}
+
+void test_get_column_reads_one_column_in_both_layouts(void) {
+    uint32_t parameters[] = {EMBEDDB_RESET_DATA, EMBEDDB_USE_PAX | EMBEDDB_RESET_DATA};
+    for (uint8_t l = 0; l < 2; l++) {
+        state = init_state(parameters[l], 4);
+        uint32_t numRecords = state->maxRecordsPerPage * 12 + 5;
+        insert_records(state, numRecords);
+
+        uint32_t minKey = 100, maxKey = 300;
+        embedDBIterator it;
+        it.minKey = &minKey;
+        it.maxKey = &maxKey;
+        it.minData = NULL;
+        it.maxData = NULL;
+        embedDBInitIterator(state, &it);
+
+        /* Sum the 2 byte id column */
+        void* records;
+        count_t begin, end;
+        uint32_t sum = 0, expectedSum = 0;
+        uint16_t offset = state->keySize + offsetof(record_data, id), keyStride, idStride;
+        while (embedDBNextPage(state, &it, &records, &begin, &end)) {
+            int8_t* keys = embedDBGetColumn(state, records, 0, &keyStride);
+            int8_t* ids = embedDBGetColumn(state, records, offset, &idStride);
+            TEST_ASSERT_EQUAL_UINT16(l == 0 ? state->recordSize : state->keySize, keyStride);
+            TEST_ASSERT_EQUAL_UINT16(l == 0 ? state->recordSize : sizeof(uint16_t), idStride);
+            for (count_t i = begin; i < end; i++) {
+                uint32_t key;
+                uint16_t id;
+                memcpy(&key, keys + i * keyStride, sizeof(uint32_t));
+                memcpy(&id, ids + i * idStride, sizeof(uint16_t));
+                TEST_ASSERT_EQUAL_UINT16(make_data(key).id, id);
+                sum += id;
+            }
+        }
+        embedDBCloseIterator(&it);
+        for (uint32_t key = minKey; key <= maxKey; key++)
+            expectedSum += make_data(key).id;
+        TEST_ASSERT_EQUAL_UINT32(expectedSum, sum);
+
+        free_state(state);
+        state = NULL;
+    }
+}
+
+void test_variable_data_with_pax(void) {
+    state = init_state(EMBEDDB_USE_PAX | EMBEDDB_USE_VDATA | EMBEDDB_RESET_DATA, 4);
+    uint32_t numRecords = state->maxRecordsPerPage * 3 + 2;
+    char text[16];
+    for (uint32_t key = 0; key < numRecords; key++) {
+        record_data data = make_data(key);
+        snprintf(text, sizeof(text), "record %u", key);
+        if (key % 3 == 0)
+            TEST_ASSERT_EQUAL_INT8(0, embedDBPutVar(state, &key, &data, text, strlen(text) + 1));
+        else
+            TEST_ASSERT_EQUAL_INT8(0, embedDBPutVar(state, &key, &data, NULL, 0));
+    }
+    TEST_ASSERT_EQUAL_INT8(0, embedDBFlush(state));
+
+    for (uint32_t key = 0; key < numRecords; key++) {
+        record_data data;
+        embedDBVarDataStream* stream = NULL;
+        TEST_ASSERT_EQUAL_INT8(0, embedDBGetVar(state, &key, &data, &stream));
+        record_data expected = make_data(key);
+        TEST_ASSERT_EQUAL_MEMORY(&expected, &data, sizeof(record_data));
+        if (key % 3 == 0) {
+            TEST_ASSERT_NOT_NULL(stream);
+            char result[16];
+            snprintf(text, sizeof(text), "record %u", key);
+            TEST_ASSERT_EQUAL_UINT32(strlen(text) + 1, embedDBVarDataStreamRead(state, stream, result, sizeof(result)));
+            TEST_ASSERT_EQUAL_STRING(text, result);
+            free(stream);
+        } else {
+            TEST_ASSERT_NULL(stream);
+        }
+    }
+}
+
+void test_column_sizes_must_match_data_size(void) {
+    dataColumnSizes[3] = 2;
+    state = init_state(EMBEDDB_USE_PAX | EMBEDDB_RESET_DATA, 4);
+    dataColumnSizes[3] = -4;
+    TEST_ASSERT_NULL(state);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_page_stores_columns_contiguously);
+    RUN_TEST(test_get_and_next_return_rows);
+    RUN_TEST(test_single_data_column_with_batch_put);
+    RUN_TEST(test_get_column_reads_one_column_in_both_layouts);
+    RUN_TEST(test_variable_data_with_pax);
+    RUN_TEST(test_column_sizes_must_match_data_size);
+    return UNITY_END();
+}
+
+record_data make_data(uint32_t key) {
+    record_data data;
+    data.value = (int32_t)(key * 7 % 1000);
+    data.small = (int16_t)(key % 100) - 50;
+    data.id = (uint16_t)(key * 13);
+    data.other = -(int32_t)key;
+    return data;
+}
+
+void insert_records(embedDBState* state, uint32_t numRecords) {
+    for (uint32_t key = 0; key < numRecords; key++) {
+        record_data data = make_data(key);
+        TEST_ASSERT_EQUAL_INT8(0, embedDBPut(state, &key, &data));
+    }
+}
+
+void free_state(embedDBState* state) {
+    embedDBClose(state);
+    tearDownFile(state->dataFile);
+    if (state->varFile != NULL)
+        tearDownFile(state->varFile);
+    free(state->fileInterface);
+    free(state->buffer);
+    free(state);
+}
+
+/* Function returns a pointer to a newly created embedDBState, or NULL if embedDB failed to initialize */
+embedDBState* init_state(uint32_t parameters, uint8_t numDataColumns) {
+    embedDBState* state = (embedDBState*)malloc(sizeof(embedDBState));
+    if (state == NULL) {
+        printf("Unable to allocate state. Exiting\n");
+        exit(0);
+    }
+    state->keySize = 4;
+    state->dataSize = sizeof(record_data);
+    state->pageSize = 512;
+    state->numSplinePoints = 300;
+    state->bitmapSize = 0;
+    state->bufferSizeInBlocks = EMBEDDB_USING_VDATA(parameters) ? 4 : 2;
+    state->buffer = calloc(1, (size_t)state->bufferSizeInBlocks * state->pageSize);
+    if (state->buffer == NULL) {
+        printf("Unable to allocate buffer. Exiting\n");
+        exit(0);
+    }
+    state->numDataPages = 1000;
+    state->numVarPages = 100;
+    state->eraseSizeInPages = 4;
+    char dataPath[] = "build/artifacts/dataFile.bin";
+    char varPath[] = "build/artifacts/varFile.bin";
+    state->fileInterface = getFileInterface();
+    state->dataFile = setupFile(dataPath);
+    state->varFile = EMBEDDB_USING_VDATA(parameters) ? setupFile(varPath) : NULL;
+    state->parameters = parameters;
+    state->numDataColumns = numDataColumns;
+    state->dataColumnSizes = dataColumnSizes;
+    state->compareKey = int32Comparator;
+    state->compareData = int32Comparator;
+
+    size_t splineMaxError = 1;
+    if (embedDBInit(state, splineMaxError) != 0) {
+        tearDownFile(state->dataFile);
+        if (state->varFile != NULL)
+            tearDownFile(state->varFile);
+        free(state->fileInterface);
+        free(state->buffer);
+        free(state);
+        return NULL;
+    }
+    return state;
+}
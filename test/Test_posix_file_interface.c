@@ -0,0 +1,193 @@
+#include <stdio.h>
+
+#include "../Unity/src/unity.h"
+#include "../src/embedDB/embedDB.h"
+#include "../src/embedDB/utilityFunctions.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+
+#include <stdint.h>
+
+embedDBState* init_state(uint32_t pageSize, int8_t direct, int8_t alignBuffer, uint32_t parameters);
+void free_state(embedDBState* state);
+void insert_records(embedDBState* state, uint32_t startKey, uint32_t numRecords);
+void check_records(embedDBState* state, uint32_t numRecords);
+
+// global variable for state. Use in setUp() function and tearDown()
+embedDBState* state;
+
+void setUp(void) {
+    state = NULL;
+}
+
+void tearDown(void) {
+    if (state != NULL)
+        free_state(state);
+    state = NULL;
+}
+
+void test_buffered_reads_and_writes(void) {
+    state = init_state(512, 0, 0, EMBEDDB_RESET_DATA);
+    TEST_ASSERT_NOT_NULL(state);
+    uint32_t numRecords = state->maxRecordsPerPage * 25 + 3;
+    insert_records(state, 0, numRecords);
+    TEST_ASSERT_EQUAL_INT8(0, embedDBFlush(state));
+    check_records(state, numRecords);
+}
+
+void test_direct_io_with_aligned_buffer(void) {
+    state = init_state(4096, 1, 1, EMBEDDB_RESET_DATA);
+    TEST_ASSERT_NOT_NULL(state);
+    TEST_ASSERT_EQUAL_UINT32(0, (uintptr_t)state->buffer % 4096);
+    uint32_t numRecords = state->maxRecordsPerPage * 6 + 3;
+    insert_records(state, 0, numRecords);
+    TEST_ASSERT_EQUAL_INT8(0, embedDBFlush(state));
+    check_records(state, numRecords);
+}
+
+void test_direct_io_with_unaligned_buffer(void) {
+    state = init_state(4096, 1, 0, EMBEDDB_RESET_DATA);
+    TEST_ASSERT_NOT_NULL(state);
+    uint32_t numRecords = state->maxRecordsPerPage * 6 + 3;
+    insert_records(state, 0, numRecords);
+    TEST_ASSERT_EQUAL_INT8(0, embedDBFlush(state));
+    check_records(state, numRecords);
+}
+
+void test_recovers_from_posix_file(void) {
+    state = init_state(4096, 1, 1, EMBEDDB_RESET_DATA);
+    TEST_ASSERT_NOT_NULL(state);
+    uint32_t numRecords = state->maxRecordsPerPage * 5;
+    insert_records(state, 0, numRecords);
+    TEST_ASSERT_EQUAL_INT8(0, embedDBFlush(state));
+    free_state(state);
+
+    state = init_state(4096, 1, 1, 0);
+    TEST_ASSERT_NOT_NULL_MESSAGE(state, "embedDB did not recover from the data file.");
+    TEST_ASSERT_EQUAL_UINT32(5, state->nextDataPageId);
+    check_records(state, numRecords);
+}
+
+void test_read_many_reads_consecutive_pages(void) {
+    state = init_state(512, 0, 0, EMBEDDB_RESET_DATA);
+    TEST_ASSERT_NOT_NULL(state);
+    insert_records(state, 0, state->maxRecordsPerPage * 4);
+    TEST_ASSERT_EQUAL_INT8(0, embedDBFlush(state));
+
+    int8_t pages[3][512];
+    void* buffers[3] = {pages[0], pages[1], pages[2]};
+    TEST_ASSERT_EQUAL_UINT32(3, state->fileInterface->readMany(buffers, 1, 3, 512, state->dataFile));
+    for (uint32_t i = 0; i < 3; i++) {
+        uint32_t pageId = 0;
+        memcpy(&pageId, pages[i], sizeof(id_t));
+        TEST_ASSERT_EQUAL_UINT32(i + 1, pageId);
+    }
+
+    /* Only the pages that exist are read */
+    TEST_ASSERT_EQUAL_UINT32(1, state->fileInterface->readMany(buffers, 3, 3, 512, state->dataFile));
+}
+
+void test_write_gather_writes_header_and_data(void) {
+    state = init_state(512, 0, 0, EMBEDDB_RESET_DATA);
+    TEST_ASSERT_NOT_NULL(state);
+
+    int8_t header[8], data[504], page[512];
+    for (uint32_t i = 0; i < 8; i++)
+        header[i] = (int8_t)i;
+    for (uint32_t i = 0; i < 504; i++)
+        data[i] = (int8_t)(i * 3 + 1);
+    TEST_ASSERT_EQUAL_INT8(1, state->fileInterface->writeGather(header, 8, data, 2, 512, state->dataFile));
+    TEST_ASSERT_EQUAL_INT8(1, state->fileInterface->read(page, 2, 512, state->dataFile));
+    TEST_ASSERT_EQUAL_MEMORY(header, page, 8);
+    TEST_ASSERT_EQUAL_MEMORY(data, page + 8, 504);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_buffered_reads_and_writes);
+    RUN_TEST(test_direct_io_with_aligned_buffer);
+    RUN_TEST(test_direct_io_with_unaligned_buffer);
+    RUN_TEST(test_recovers_from_posix_file);
+    RUN_TEST(test_read_many_reads_consecutive_pages);
+    RUN_TEST(test_write_gather_writes_header_and_data);
+    return UNITY_END();
+}
+
+void insert_records(embedDBState* state, uint32_t startKey, uint32_t numRecords) {
+    int32_t data[3] = {0, 0, 0};
+    for (uint32_t key = startKey; key < startKey + numRecords; key++) {
+        data[0] = key + 100;
+        TEST_ASSERT_EQUAL_INT8(0, embedDBPut(state, &key, data));
+    }
+}
+
+void check_records(embedDBState* state, uint32_t numRecords) {
+    int32_t data[3];
+    for (uint32_t key = 0; key < numRecords; key += 3) {
+        TEST_ASSERT_EQUAL_INT8(0, embedDBGet(state, &key, data));
+        TEST_ASSERT_EQUAL_INT32(key + 100, data[0]);
+    }
+}
+
+void free_state(embedDBState* state) {
+    embedDBClose(state);
+    tearDownPosixFile(state->dataFile);
+    free(state->fileInterface);
+    free(state->buffer);
+    free(state);
+}
+
+/* Function returns a pointer to a newly created embedDBState using the POSIX file interface, or NULL if embedDB failed to initialize */
+embedDBState* init_state(uint32_t pageSize, int8_t direct, int8_t alignBuffer, uint32_t parameters) {
+    embedDBState* state = (embedDBState*)malloc(sizeof(embedDBState));
+    if (state == NULL) {
+        printf("Unable to allocate state. Exiting\n");
+        exit(0);
+    }
+    state->keySize = 4;
+    state->dataSize = 12;
+    state->pageSize = pageSize;
+    state->numSplinePoints = 300;
+    state->bitmapSize = 0;
+    state->bufferSizeInBlocks = 2;
+    size_t bufferSize = (size_t)state->bufferSizeInBlocks * state->pageSize;
+    /* A malloc buffer is not aligned for direct I/O, so the file interface copies through its aligned page */
+    state->buffer = alignBuffer ? allocateAlignedBuffer(bufferSize, 4096) : malloc(bufferSize);
+    if (state->buffer == NULL) {
+        printf("Unable to allocate buffer. Exiting\n");
+        exit(0);
+    }
+    state->numDataPages = 64;
+    state->eraseSizeInPages = 4;
+    char dataPath[] = "build/artifacts/dataFile.bin";
+    state->fileInterface = getPosixFileInterface();
+    state->dataFile = setupPosixFile(dataPath, state->pageSize, direct);
+    state->parameters = parameters;
+    state->compareKey = int32Comparator;
+    state->compareData = int32Comparator;
+
+    size_t splineMaxError = 1;
+    if (embedDBInit(state, splineMaxError) != 0) {
+        tearDownPosixFile(state->dataFile);
+        free(state->fileInterface);
+        free(state->buffer);
+        free(state);
+        return NULL;
+    }
+
+    embedDBResetStats(state);
+    return state;
+}
+
+#else
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+int main() {
+    UNITY_BEGIN();
+    return UNITY_END();
+}
+
+#endif
@@ -1,11 +1,105 @@
 #include "../src/spline/radixspline.h"
 #include "unity.h"
 
-void setUp(void) {}
+#include <stdlib.h>
+#include <string.h>
 
-void tearDown(void) {}
+#define NUM_PAGES 20000
+#define LIVE_PAGES 300
+#define RADIX_BITS 6
+
+spline *spl;
+radixspline rsidx;
+uint32_t keys[NUM_PAGES];
+
+void setUp(void) {
+    /* Freed by radixsplineClose */
+    spl = (spline *)malloc(sizeof(spline));
+    TEST_ASSERT_EQUAL_INT8(0, splineInit(spl, 128, 1, sizeof(uint32_t)));
+    radixsplineInit(&rsidx, spl, RADIX_BITS, sizeof(uint32_t));
+
+    /* Keys with gaps and changing slopes so the spline needs many points */
+    uint32_t key = 100;
+    for (uint32_t page = 0; page < NUM_PAGES; page++) {
+        keys[page] = key;
+        key += 10 + page % 5 + (page % 13 == 0 ? 500 : 0);
+    }
+}
+
+void tearDown(void) {
+    radixsplineClose(&rsidx);
+}
+
+/* Removes the spline points before a key, the way embedDB cleans the spline when data pages are erased */
+void erase_points_before(uint32_t key) {
+    uint32_t numPoints = 0;
+    while (numPoints < spl->count) {
+        uint32_t pointKey;
+        memcpy(&pointKey, splinePointLocation(spl, numPoints), sizeof(uint32_t));
+        if (pointKey >= key)
+            break;
+        numPoints++;
+    }
+    if (spl->count - numPoints == 1)
+        numPoints--;
+    TEST_ASSERT_EQUAL_INT(0, splineErase(spl, numPoints));
+}
+
+void check_pages(uint32_t firstPage, uint32_t lastPage) {
+    for (uint32_t page = firstPage; page <= lastPage; page++) {
+        id_t loc, low, high, splineLoc, splineLow, splineHigh;
+        radixsplineFind(&rsidx, keys + page, NULL, &loc, &low, &high);
+        splineFind(spl, keys + page, NULL, &splineLoc, &splineLow, &splineHigh);
+        TEST_ASSERT_TRUE_MESSAGE(low <= page && page <= high, "Page of the key is outside of the radix spline bounds.");
+        TEST_ASSERT_EQUAL_UINT32(splineLoc, loc);
+    }
+}
+
+uint8_t bits_for(uint64_t value) {
+    uint8_t bits = 0;
+    while ((value >> bits) != 0)
+        bits++;
+    return bits;
+}
+
+void test_radix_spline_coalesces_rows_as_keys_grow(void) {
+    /* Few enough pages that no spline point is erased */
+    uint32_t numPages = 800;
+    for (uint32_t page = 0; page < numPages; page++) {
+        radixsplineAddPoint(&rsidx, keys + page, page);
+        if (page % 97 == 0)
+            check_pages(0, page);
+    }
+    check_pages(0, numPages - 1);
+    TEST_ASSERT_EQUAL_UINT32(0, spl->numErased);
+
+    /* The rows were coalesced to cover every key, but no more than needed */
+    TEST_ASSERT_TRUE(rsidx.shiftSize > 0);
+    TEST_ASSERT_TRUE(rsidx.shiftSize <= bits_for(keys[numPages - 1] - keys[0]) - RADIX_BITS);
+    TEST_ASSERT_TRUE(((uint64_t)rsidx.prevPrefix << rsidx.shiftSize) <= keys[numPages - 1] - keys[0]);
+}
+
+void test_radix_spline_finds_keys_after_points_are_erased(void) {
+    for (uint32_t page = 0; page < NUM_PAGES; page++) {
+        radixsplineAddPoint(&rsidx, keys + page, page);
+        if (page >= LIVE_PAGES && page % 50 == 0) {
+            uint32_t firstLivePage = page - LIVE_PAGES;
+            erase_points_before(keys[firstLivePage]);
+            check_pages(firstLivePage, page);
+        }
+    }
+    TEST_ASSERT_TRUE(spl->numErased > 0);
+
+    /* The table moves past the erased points instead of growing the shift for every key ever added */
+    TEST_ASSERT_TRUE(rsidx.minKey > keys[0]);
+    uint32_t liveSpan = keys[NUM_PAGES - 1] - keys[NUM_PAGES - 1 - LIVE_PAGES];
+    TEST_ASSERT_TRUE(rsidx.shiftSize <= bits_for(liveSpan) - RADIX_BITS + 2);
+    TEST_ASSERT_TRUE(rsidx.shiftSize < bits_for(keys[NUM_PAGES - 1] - keys[0]) - RADIX_BITS);
+}
 
 int main(void) {
     UNITY_BEGIN();
+    RUN_TEST(test_radix_spline_coalesces_rows_as_keys_grow);
+    RUN_TEST(test_radix_spline_finds_keys_after_points_are_erased);
     return UNITY_END();
 }
@@ -0,0 +1,190 @@
+#include <stdio.h>
+
+#include "../Unity/src/unity.h"
+#include "../src/embedDB/embedDB.h"
+#include "../src/embedDB/utilityFunctions.h"
+
+/* The first column is summed, the second is only stored */
+typedef struct {
+    int32_t value;
+    int32_t other;
+} record_data;
+
+embedDBState* init_state(uint32_t parameters);
+void free_state(embedDBState* state);
+void insert_records(embedDBState* state, uint32_t numRecords);
+record_data make_data(uint32_t key);
+void check_range(embedDBState* state, uint32_t* minKey, uint32_t* maxKey, uint32_t numRecords);
+
+// global variable for state. Use in setUp() function and tearDown()
+embedDBState* state;
+uint8_t sumColumnOffset = 0;
+
+void setUp(void) {
+    state = NULL;
+}
+
+void tearDown(void) {
+    if (state != NULL)
+        free_state(state);
+    state = NULL;
+}
+
+void test_range_aggregate_from_page_headers(void) {
+    state = init_state(EMBEDDB_USE_SUM | EMBEDDB_USE_MAX_MIN | EMBEDDB_RESET_DATA);
+    uint32_t numRecords = state->maxRecordsPerPage * 40 + 11;
+    insert_records(state, numRecords);
+
+    uint32_t minKey = 57, maxKey = 2011;
+    check_range(state, &minKey, &maxKey, numRecords);
+    check_range(state, NULL, &maxKey, numRecords);
+    check_range(state, &minKey, NULL, numRecords);
+    check_range(state, NULL, NULL, numRecords);
+
+    /* Records still in the write buffer are included */
+    minKey = numRecords - 5;
+    check_range(state, &minKey, NULL, numRecords);
+}
+
+void test_range_aggregate_from_index_reads_fewer_pages(void) {
+    state = init_state(EMBEDDB_USE_SUM | EMBEDDB_USE_MAX_MIN | EMBEDDB_USE_INDEX | EMBEDDB_RESET_DATA);
+    uint32_t numRecords = state->maxRecordsPerPage * 60 + 3;
+    insert_records(state, numRecords);
+    TEST_ASSERT_EQUAL_INT8(0, embedDBFlush(state));
+
+    uint32_t minKey = 30, maxKey = numRecords - 30;
+    uint32_t numReads = state->numReads;
+    check_range(state, &minKey, &maxKey, numRecords);
+
+    /* Only the two boundary pages and the index pages are read */
+    uint32_t numIndexPages = state->nextIdxPageId - state->minIndexPageId;
+    TEST_ASSERT_TRUE(state->numReads - numReads <= 2 + numIndexPages);
+    TEST_ASSERT_TRUE(state->numIdxReads > 0);
+}
+
+void test_range_aggregate_empty_range(void) {
+    state = init_state(EMBEDDB_USE_SUM | EMBEDDB_RESET_DATA);
+    insert_records(state, state->maxRecordsPerPage * 3);
+
+    uint32_t minKey = 100000, maxKey = 200000;
+    embedDBAggregate result;
+    result.minData = NULL;
+    result.maxData = NULL;
+    TEST_ASSERT_EQUAL_INT8(0, embedDBGetRangeAggregate(state, &minKey, &maxKey, &result));
+    TEST_ASSERT_EQUAL_UINT32(0, result.count);
+    TEST_ASSERT_EQUAL_INT64(0, result.sum);
+}
+
+void test_sum_column_must_fit_in_data(void) {
+    sumColumnOffset = 6;
+    state = init_state(EMBEDDB_USE_SUM | EMBEDDB_RESET_DATA);
+    sumColumnOffset = 0;
+    TEST_ASSERT_NULL(state);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_range_aggregate_from_page_headers);
+    RUN_TEST(test_range_aggregate_from_index_reads_fewer_pages);
+    RUN_TEST(test_range_aggregate_empty_range);
+    RUN_TEST(test_sum_column_must_fit_in_data);
+    return UNITY_END();
+}
+
+record_data make_data(uint32_t key) {
+    record_data data;
+    data.value = (int32_t)(key * 7919 % 2000) - 1000;
+    data.other = (int32_t)key;
+    return data;
+}
+
+void insert_records(embedDBState* state, uint32_t numRecords) {
+    for (uint32_t key = 0; key < numRecords; key++) {
+        record_data data = make_data(key);
+        TEST_ASSERT_EQUAL_INT8(0, embedDBPut(state, &key, &data));
+    }
+}
+
+/* Compares the aggregates of a range against the aggregates of each inserted record */
+void check_range(embedDBState* state, uint32_t* minKey, uint32_t* maxKey, uint32_t numRecords) {
+    uint32_t count = 0;
+    int64_t sum = 0;
+    int32_t minValue = INT32_MAX, maxValue = INT32_MIN;
+    for (uint32_t key = 0; key < numRecords; key++) {
+        if ((minKey != NULL && key < *minKey) || (maxKey != NULL && key > *maxKey))
+            continue;
+        record_data data = make_data(key);
+        count++;
+        sum += data.value;
+        if (data.value < minValue)
+            minValue = data.value;
+        if (data.value > maxValue)
+            maxValue = data.value;
+    }
+
+    record_data minData, maxData;
+    embedDBAggregate result;
+    result.minData = &minData;
+    result.maxData = &maxData;
+    TEST_ASSERT_EQUAL_INT8(0, embedDBGetRangeAggregate(state, minKey, maxKey, &result));
+    TEST_ASSERT_EQUAL_UINT32(count, result.count);
+    TEST_ASSERT_EQUAL_INT64(sum, result.sum);
+    TEST_ASSERT_EQUAL_FLOAT((float)sum / count, result.average);
+    TEST_ASSERT_EQUAL_INT32(minValue, minData.value);
+    TEST_ASSERT_EQUAL_INT32(maxValue, maxData.value);
+}
+
+void free_state(embedDBState* state) {
+    embedDBClose(state);
+    tearDownFile(state->dataFile);
+    if (state->indexFile != NULL)
+        tearDownFile(state->indexFile);
+    free(state->fileInterface);
+    free(state->buffer);
+    free(state);
+}
+
+/* Function returns a pointer to a newly created embedDBState, or NULL if embedDB failed to initialize */
+embedDBState* init_state(uint32_t parameters) {
+    embedDBState* state = (embedDBState*)malloc(sizeof(embedDBState));
+    if (state == NULL) {
+        printf("Unable to allocate state. Exiting\n");
+        exit(0);
+    }
+    state->keySize = 4;
+    state->dataSize = sizeof(record_data);
+    state->pageSize = 512;
+    state->numSplinePoints = 300;
+    state->bitmapSize = 0;
+    state->bufferSizeInBlocks = EMBEDDB_USING_INDEX(parameters) ? 4 : 2;
+    state->buffer = calloc(1, (size_t)state->bufferSizeInBlocks * state->pageSize);
+    if (state->buffer == NULL) {
+        printf("Unable to allocate buffer. Exiting\n");
+        exit(0);
+    }
+    state->numDataPages = 1000;
+    state->numIndexPages = 48;
+    state->eraseSizeInPages = 4;
+    char dataPath[] = "build/artifacts/dataFile.bin";
+    char indexPath[] = "build/artifacts/indexFile.bin";
+    state->fileInterface = getFileInterface();
+    state->dataFile = setupFile(dataPath);
+    state->indexFile = EMBEDDB_USING_INDEX(parameters) ? setupFile(indexPath) : NULL;
+    state->sumColumnOffset = sumColumnOffset;
+    state->sumColumnSize = -4;
+    state->parameters = parameters;
+    state->compareKey = int32Comparator;
+    state->compareData = int32Comparator;
+
+    size_t splineMaxError = 1;
+    if (embedDBInit(state, splineMaxError) != 0) {
+        tearDownFile(state->dataFile);
+        if (state->indexFile != NULL)
+            tearDownFile(state->indexFile);
+        free(state->fileInterface);
+        free(state->buffer);
+        free(state);
+        return NULL;
+    }
+    return state;
+}
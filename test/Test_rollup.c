@@ -0,0 +1,258 @@
+#include <stdio.h>
+
+#include "../Unity/src/unity.h"
+#include "../src/embedDB/embedDB.h"
+#include "../src/embedDB/utilityFunctions.h"
+#include "../src/query-interface/advancedQueries.h"
+#include "../src/query-interface/rollup.h"
+
+#define BUCKET_WIDTH 100
+#define ROW_DATA_SIZE 20
+
+embedDBState* init_state(uint32_t parameters, char* dataPath, int8_t dataSize, uint32_t numDataPages);
+void free_state(embedDBState* state);
+void open_rollup(uint32_t sourceParameters, uint32_t rollupParameters, uint32_t numDataPages);
+void close_rollup(void);
+int32_t make_data(uint32_t key);
+void insert_records(uint32_t firstKey, uint32_t numRecords);
+uint32_t check_rollup(uint32_t firstKey, uint32_t numRecords, uint32_t* minBucket, uint32_t* maxBucket);
+
+// global variables for the states and rollup. Use in setUp() function and tearDown()
+embedDBState* source;
+embedDBState* rollupState;
+embedDBSchema* sourceSchema;
+embedDBAggregateFunc* functions;
+embedDBRollup rollup;
+
+void setUp(void) {
+    source = NULL;
+    rollupState = NULL;
+    int8_t colSizes[] = {4, 4};
+    int8_t colSignedness[] = {embedDB_COLUMN_UNSIGNED, embedDB_COLUMN_SIGNED};
+    sourceSchema = embedDBCreateSchema(2, colSizes, colSignedness);
+}
+
+void tearDown(void) {
+    if (source != NULL)
+        close_rollup();
+    embedDBFreeSchema(&sourceSchema);
+}
+
+void test_rollup_matches_raw_aggregates(void) {
+    open_rollup(EMBEDDB_RESET_DATA, EMBEDDB_RESET_DATA, 1024);
+    insert_records(0, 20050);
+
+    /* Records inserted in a batch update the rollup too */
+    uint32_t keys[500];
+    int32_t data[500];
+    for (uint32_t i = 0; i < 500; i++) {
+        keys[i] = 20050 + i;
+        data[i] = make_data(keys[i]);
+    }
+    TEST_ASSERT_EQUAL_INT8(0, embedDBPutBatch(source, keys, data, 500));
+
+    /* Every bucket comes from the rollup instance and the open bucket from the function states, so no raw pages are read */
+    uint32_t reads = source->numReads;
+    TEST_ASSERT_EQUAL_UINT32(206, check_rollup(0, 20550, NULL, NULL));
+    TEST_ASSERT_EQUAL_UINT32(reads, source->numReads);
+}
+
+void test_rollup_query_bucket_range(void) {
+    open_rollup(EMBEDDB_RESET_DATA, EMBEDDB_RESET_DATA, 1024);
+    insert_records(0, 10050);
+
+    uint32_t minBucket = 2000, maxBucket = 3000;
+    TEST_ASSERT_EQUAL_UINT32(11, check_rollup(0, 10050, &minBucket, &maxBucket));
+
+    /* The open bucket is returned when its start is in range */
+    minBucket = 9900;
+    TEST_ASSERT_EQUAL_UINT32(2, check_rollup(0, 10050, &minBucket, NULL));
+}
+
+void test_rollup_survives_raw_wraparound(void) {
+    open_rollup(EMBEDDB_RESET_DATA, EMBEDDB_RESET_DATA, 128);
+    insert_records(0, 60000);
+    TEST_ASSERT_TRUE(source->minDataPageId > 0);
+
+    /* The oldest buckets are only in the rollup */
+    TEST_ASSERT_EQUAL_UINT32(600, check_rollup(0, 60000, NULL, NULL));
+}
+
+void test_rollup_rebuilds_open_bucket_after_restart(void) {
+    open_rollup(EMBEDDB_RESET_DATA, EMBEDDB_RESET_DATA, 1024);
+    insert_records(0, 12345);
+    TEST_ASSERT_EQUAL_INT8(0, embedDBFlush(source));
+    TEST_ASSERT_EQUAL_INT8(0, embedDBFlush(rollupState));
+    close_rollup();
+
+    /* The open bucket is added again from the raw records */
+    open_rollup(0, 0, 1024);
+    TEST_ASSERT_EQUAL_UINT32(124, check_rollup(0, 12345, NULL, NULL));
+    insert_records(12345, 1000);
+    TEST_ASSERT_EQUAL_UINT32(134, check_rollup(0, 13345, NULL, NULL));
+    TEST_ASSERT_EQUAL_INT8(0, embedDBFlush(source));
+    close_rollup();
+
+    /* A rollup attached to an instance that already has records starts from its oldest record */
+    open_rollup(0, EMBEDDB_RESET_DATA, 1024);
+    TEST_ASSERT_EQUAL_UINT32(134, check_rollup(0, 13345, NULL, NULL));
+}
+
+void test_rollup_requires_valid_configuration(void) {
+    open_rollup(EMBEDDB_RESET_DATA, EMBEDDB_RESET_DATA, 1024);
+    embedDBRollupClose(&rollup);
+    rollup.bucketWidth = 0;
+    TEST_ASSERT_NOT_EQUAL(0, embedDBRollupInit(&rollup));
+    rollup.bucketWidth = BUCKET_WIDTH;
+    rollup.functionsLength = 3;
+    TEST_ASSERT_NOT_EQUAL(0, embedDBRollupInit(&rollup));
+    rollup.functionsLength = 4;
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_rollup_matches_raw_aggregates);
+    RUN_TEST(test_rollup_query_bucket_range);
+    RUN_TEST(test_rollup_survives_raw_wraparound);
+    RUN_TEST(test_rollup_rebuilds_open_bucket_after_restart);
+    RUN_TEST(test_rollup_requires_valid_configuration);
+    return UNITY_END();
+}
+
+int32_t make_data(uint32_t key) {
+    return (int32_t)((key * 2654435761u) >> 20) - 2048;
+}
+
+void insert_records(uint32_t firstKey, uint32_t numRecords) {
+    for (uint32_t key = firstKey; key < firstKey + numRecords; key++) {
+        int32_t data = make_data(key);
+        TEST_ASSERT_EQUAL_INT8(0, embedDBPut(source, &key, &data));
+    }
+}
+
+/* Checks the rows of the buckets starting between minBucket and maxBucket against the raw records from firstKey and returns the number of rows */
+uint32_t check_rollup(uint32_t firstKey, uint32_t numRecords, uint32_t* minBucket, uint32_t* maxBucket) {
+    embedDBIterator it;
+    it.minKey = minBucket;
+    it.maxKey = maxBucket;
+    it.minData = NULL;
+    it.maxData = NULL;
+    embedDBInitIterator(rollupState, &it);
+
+    embedDBOperator* scan = createRollupScanOperator(&rollup, &it);
+    TEST_ASSERT_NOT_NULL(scan);
+    scan->init(scan);
+
+    uint32_t numRows = 0;
+    uint32_t expectedBucket = minBucket != NULL ? *minBucket : firstKey;
+    int8_t* row = scan->recordBuffer;
+    while (exec(scan)) {
+        uint32_t bucket, count;
+        int64_t sum;
+        int32_t min, max;
+        memcpy(&bucket, row, 4);
+        memcpy(&count, row + 4, 4);
+        memcpy(&sum, row + 8, 8);
+        memcpy(&min, row + 16, 4);
+        memcpy(&max, row + 20, 4);
+        TEST_ASSERT_EQUAL_UINT32(expectedBucket, bucket);
+
+        uint32_t end = bucket + BUCKET_WIDTH < firstKey + numRecords ? bucket + BUCKET_WIDTH : firstKey + numRecords;
+        int64_t expectedSum = 0;
+        int32_t expectedMin = INT32_MAX, expectedMax = INT32_MIN;
+        for (uint32_t key = bucket; key < end; key++) {
+            int32_t value = make_data(key);
+            expectedSum += value;
+            expectedMin = value < expectedMin ? value : expectedMin;
+            expectedMax = value > expectedMax ? value : expectedMax;
+        }
+        TEST_ASSERT_EQUAL_UINT32(end - bucket, count);
+        TEST_ASSERT_TRUE(expectedSum == sum);
+        TEST_ASSERT_EQUAL_INT32(expectedMin, min);
+        TEST_ASSERT_EQUAL_INT32(expectedMax, max);
+        expectedBucket += BUCKET_WIDTH;
+        numRows++;
+    }
+
+    scan->close(scan);
+    embedDBFreeOperatorRecursive(&scan);
+    embedDBCloseIterator(&it);
+    return numRows;
+}
+
+void open_rollup(uint32_t sourceParameters, uint32_t rollupParameters, uint32_t numDataPages) {
+    source = init_state(sourceParameters, "build/artifacts/dataFile.bin", 4, numDataPages);
+    rollupState = init_state(rollupParameters, "build/artifacts/rollupFile.bin", ROW_DATA_SIZE, 64);
+
+    functions = calloc(4, sizeof(embedDBAggregateFunc));
+    embedDBAggregateFunc* counter = createCountAggregate();
+    embedDBAggregateFunc* sum = createSumAggregate(1);
+    embedDBAggregateFunc* min = createMinAggregate(1, -4);
+    embedDBAggregateFunc* max = createMaxAggregate(1, -4);
+    functions[0] = *counter;
+    functions[1] = *sum;
+    functions[2] = *min;
+    functions[3] = *max;
+    free(counter);
+    free(sum);
+    free(min);
+    free(max);
+
+    rollup.source = source;
+    rollup.rollupState = rollupState;
+    rollup.sourceSchema = sourceSchema;
+    rollup.bucketWidth = BUCKET_WIDTH;
+    rollup.functions = functions;
+    rollup.functionsLength = 4;
+    TEST_ASSERT_EQUAL_INT8(0, embedDBRollupInit(&rollup));
+}
+
+void close_rollup(void) {
+    embedDBRollupClose(&rollup);
+    for (uint8_t i = 0; i < 4; i++)
+        free(functions[i].state);
+    free(functions);
+    free_state(source);
+    free_state(rollupState);
+    source = NULL;
+    rollupState = NULL;
+}
+
+void free_state(embedDBState* state) {
+    embedDBClose(state);
+    tearDownFile(state->dataFile);
+    free(state->fileInterface);
+    free(state->buffer);
+    free(state);
+}
+
+/* Function returns a pointer to a newly created embedDBState */
+embedDBState* init_state(uint32_t parameters, char* dataPath, int8_t dataSize, uint32_t numDataPages) {
+    embedDBState* state = (embedDBState*)malloc(sizeof(embedDBState));
+    if (state == NULL) {
+        printf("Unable to allocate state. Exiting\n");
+        exit(0);
+    }
+    state->keySize = 4;
+    state->dataSize = dataSize;
+    state->pageSize = 512;
+    state->numSplinePoints = 300;
+    state->bitmapSize = 0;
+    state->bufferSizeInBlocks = 4;
+    state->buffer = calloc(1, (size_t)state->bufferSizeInBlocks * state->pageSize);
+    if (state->buffer == NULL) {
+        printf("Unable to allocate buffer. Exiting\n");
+        exit(0);
+    }
+    state->numDataPages = numDataPages;
+    state->eraseSizeInPages = 4;
+    state->fileInterface = getFileInterface();
+    state->dataFile = setupFile(dataPath);
+    state->parameters = parameters;
+    state->compareKey = int32Comparator;
+    state->compareData = int32Comparator;
+
+    size_t splineMaxError = 1;
+    TEST_ASSERT_EQUAL_INT8(0, embedDBInit(state, splineMaxError));
+    return state;
+}
@@ -0,0 +1,294 @@
+#include <stdio.h>
+
+#include "../Unity/src/unity.h"
+#include "../src/embedDB/embedDB.h"
+#include "../src/embedDB/utilityFunctions.h"
+
+#define NUM_DATA_PAGES 1000
+#define KEY_STEP 3
+
+embedDBState* init_state(uint32_t parameters, uint8_t radixBits, uint8_t keySize, char* dataPath);
+void free_state(embedDBState* state);
+void insert_records(embedDBState* state, uint64_t startKey, uint32_t numRecords);
+void check_records(embedDBState* state, uint64_t startKey, uint32_t numRecords);
+void check_range(embedDBState* state, uint64_t minKey, uint64_t maxKey);
+void check_unsigned_in_page_search(uint8_t keySize);
+
+// global variables for states. Use in setUp() function and tearDown()
+embedDBState* state;
+embedDBState* otherState;
+
+void setUp(void) {
+    state = NULL;
+    otherState = NULL;
+}
+
+void tearDown(void) {
+    if (state != NULL)
+        free_state(state);
+    if (otherState != NULL)
+        free_state(otherState);
+    state = NULL;
+    otherState = NULL;
+}
+
+void test_spline_is_default_search_method(void) {
+    state = init_state(EMBEDDB_RESET_DATA, 0, 4, "build/artifacts/dataFile.bin");
+    TEST_ASSERT_NOT_NULL(state);
+    TEST_ASSERT_EQUAL_UINT8(EMBEDDB_SEARCH_SPLINE, state->searchMethod);
+    TEST_ASSERT_NOT_NULL(state->spl);
+    TEST_ASSERT_NULL(state->rdix);
+    uint32_t numRecords = state->maxRecordsPerPage * 300 + 11;
+    insert_records(state, 0, numRecords);
+    check_records(state, 0, numRecords);
+    check_range(state, 1000, 9000);
+}
+
+void test_radix_spline_search(void) {
+    state = init_state(EMBEDDB_USE_RADIX | EMBEDDB_RESET_DATA, 8, 4, "build/artifacts/dataFile.bin");
+    TEST_ASSERT_NOT_NULL(state);
+    TEST_ASSERT_EQUAL_UINT8(EMBEDDB_SEARCH_SPLINE, state->searchMethod);
+    TEST_ASSERT_NOT_NULL(state->rdix);
+    uint32_t numRecords = state->maxRecordsPerPage * 300 + 11;
+    insert_records(state, 0, numRecords);
+    check_records(state, 0, numRecords);
+    check_range(state, 1000, 9000);
+}
+
+void test_radix_spline_search_after_pages_are_erased(void) {
+    state = init_state(EMBEDDB_USE_RADIX | EMBEDDB_RESET_DATA, 8, 4, "build/artifacts/dataFile.bin");
+    TEST_ASSERT_NOT_NULL(state);
+
+    /* Keys with random gaps need many spline points, which are erased with the oldest data pages */
+    uint32_t numRecords = state->maxRecordsPerPage * NUM_DATA_PAGES * 3;
+    int32_t data[3] = {0, 0, 0};
+    uint32_t key = 0, gap = 1;
+    for (uint32_t i = 0; i < numRecords; i++) {
+        data[0] = (int32_t)key;
+        TEST_ASSERT_EQUAL_INT8(0, embedDBPut(state, &key, data));
+        gap = gap * 1103515245 + 12345;
+        key += 1 + (gap >> 16) % 16;
+    }
+    TEST_ASSERT_EQUAL_INT8(0, embedDBFlush(state));
+    TEST_ASSERT_TRUE(state->spl->numErased > 0);
+
+    /* Every key on the pages that are still stored is found */
+    uint32_t firstStored = numRecords - state->maxRecordsPerPage * (NUM_DATA_PAGES - 2 * state->eraseSizeInPages);
+    uint32_t numChecked = 0;
+    key = 0;
+    gap = 1;
+    for (uint32_t i = 0; i < numRecords; i++) {
+        if (i >= firstStored && i % 13 == 0) {
+            TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBGet(state, &key, data), "embedDB did not find a key that is still stored.");
+            TEST_ASSERT_EQUAL_INT32(key, data[0]);
+            numChecked++;
+        }
+        gap = gap * 1103515245 + 12345;
+        key += 1 + (gap >> 16) % 16;
+    }
+    TEST_ASSERT_TRUE(numChecked > 1000);
+}
+
+void test_binary_search(void) {
+    state = init_state(EMBEDDB_USE_BINARY_SEARCH | EMBEDDB_RESET_DATA, 0, 4, "build/artifacts/dataFile.bin");
+    TEST_ASSERT_NOT_NULL(state);
+    TEST_ASSERT_EQUAL_UINT8(EMBEDDB_SEARCH_BINARY, state->searchMethod);
+    TEST_ASSERT_NULL(state->spl);
+    uint32_t numRecords = state->maxRecordsPerPage * 300 + 11;
+    insert_records(state, 0, numRecords);
+    check_records(state, 0, numRecords);
+    check_range(state, 1000, 9000);
+}
+
+void test_estimate_search(void) {
+    state = init_state(EMBEDDB_USE_ESTIMATE_SEARCH | EMBEDDB_RESET_DATA, 0, 4, "build/artifacts/dataFile.bin");
+    TEST_ASSERT_NOT_NULL(state);
+    TEST_ASSERT_EQUAL_UINT8(EMBEDDB_SEARCH_ESTIMATE, state->searchMethod);
+    uint32_t numRecords = state->maxRecordsPerPage * 300 + 11;
+    insert_records(state, 0, numRecords);
+    check_records(state, 0, numRecords);
+    check_range(state, 1000, 9000);
+}
+
+void test_unsigned_keys_above_signed_range(void) {
+    state = init_state(EMBEDDB_USE_UNSIGNED_KEYS | EMBEDDB_RESET_DATA, 0, 4, "build/artifacts/dataFile.bin");
+    TEST_ASSERT_NOT_NULL(state);
+    /* Keys cross INT32_MAX, which the signed comparator would order incorrectly */
+    uint64_t startKey = (uint64_t)INT32_MAX - state->maxRecordsPerPage * 50 * KEY_STEP;
+    uint32_t numRecords = state->maxRecordsPerPage * 100 + 5;
+    insert_records(state, startKey, numRecords);
+    check_records(state, startKey, numRecords);
+    check_range(state, (uint64_t)INT32_MAX - 501, (uint64_t)INT32_MAX + 2001);
+}
+
+void test_unsigned_eight_byte_keys_with_radix(void) {
+    state = init_state(EMBEDDB_USE_UNSIGNED_KEYS | EMBEDDB_USE_RADIX | EMBEDDB_RESET_DATA, 6, 8, "build/artifacts/dataFile.bin");
+    TEST_ASSERT_NOT_NULL(state);
+    uint64_t startKey = (uint64_t)UINT32_MAX - 1000;
+    uint32_t numRecords = state->maxRecordsPerPage * 200 + 5;
+    insert_records(state, startKey, numRecords);
+    check_records(state, startKey, numRecords);
+    check_range(state, startKey + 900, startKey + 5000);
+}
+
+void check_unsigned_in_page_search(uint8_t keySize) {
+    state = init_state(EMBEDDB_USE_UNSIGNED_KEYS | EMBEDDB_RESET_DATA, 0, keySize, "build/artifacts/dataFile.bin");
+    TEST_ASSERT_NOT_NULL(state);
+
+    /* Uneven gaps between keys so the estimated location in a page is not exact, and the last page stays in the write buffer */
+    uint32_t numRecords = state->maxRecordsPerPage * 20 + state->maxRecordsPerPage / 2;
+    int32_t data[3] = {0, 0, 0};
+    uint64_t key = 1000;
+    for (uint32_t i = 0; i < numRecords; i++) {
+        data[0] = (int32_t)i;
+        TEST_ASSERT_EQUAL_INT8(0, embedDBPut(state, &key, data));
+        key += 2 + (i * 7) % 11;
+    }
+
+    key = 1000;
+    for (uint32_t i = 0; i < numRecords; i++) {
+        uint64_t missingKey = key - 1;
+        TEST_ASSERT_NOT_EQUAL(0, embedDBGet(state, &missingKey, data));
+        TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBGet(state, &key, data), "embedDB did not find an inserted key.");
+        TEST_ASSERT_EQUAL_INT32(i, data[0]);
+        key += 2 + (i * 7) % 11;
+    }
+    TEST_ASSERT_NOT_EQUAL(0, embedDBGet(state, &key, data));
+}
+
+void test_unsigned_four_byte_in_page_search(void) {
+    check_unsigned_in_page_search(4);
+}
+
+void test_unsigned_eight_byte_in_page_search(void) {
+    check_unsigned_in_page_search(8);
+}
+
+void test_instances_with_different_methods(void) {
+    state = init_state(EMBEDDB_USE_RADIX | EMBEDDB_RESET_DATA, 8, 4, "build/artifacts/dataFile.bin");
+    otherState = init_state(EMBEDDB_USE_BINARY_SEARCH | EMBEDDB_RESET_DATA, 0, 4, "build/artifacts/dataFile2.bin");
+    TEST_ASSERT_NOT_NULL(state);
+    TEST_ASSERT_NOT_NULL(otherState);
+    uint32_t numRecords = state->maxRecordsPerPage * 100 + 3;
+    insert_records(state, 0, numRecords);
+    insert_records(otherState, 50, numRecords);
+    check_records(state, 0, numRecords);
+    check_records(otherState, 50, numRecords);
+}
+
+void test_invalid_search_configurations_are_rejected(void) {
+    TEST_ASSERT_NULL(init_state(EMBEDDB_USE_BINARY_SEARCH | EMBEDDB_USE_RADIX | EMBEDDB_RESET_DATA, 8, 4, "build/artifacts/dataFile.bin"));
+    TEST_ASSERT_NULL(init_state(EMBEDDB_USE_BINARY_SEARCH | EMBEDDB_USE_ESTIMATE_SEARCH | EMBEDDB_RESET_DATA, 0, 4, "build/artifacts/dataFile.bin"));
+    TEST_ASSERT_NULL(init_state(EMBEDDB_USE_RADIX | EMBEDDB_RESET_DATA, 0, 4, "build/artifacts/dataFile.bin"));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_spline_is_default_search_method);
+    RUN_TEST(test_radix_spline_search);
+    RUN_TEST(test_radix_spline_search_after_pages_are_erased);
+    RUN_TEST(test_binary_search);
+    RUN_TEST(test_estimate_search);
+    RUN_TEST(test_unsigned_keys_above_signed_range);
+    RUN_TEST(test_unsigned_eight_byte_keys_with_radix);
+    RUN_TEST(test_unsigned_four_byte_in_page_search);
+    RUN_TEST(test_unsigned_eight_byte_in_page_search);
+    RUN_TEST(test_instances_with_different_methods);
+    RUN_TEST(test_invalid_search_configurations_are_rejected);
+    return UNITY_END();
+}
+
+void insert_records(embedDBState* state, uint64_t startKey, uint32_t numRecords) {
+    int32_t data[3] = {0, 0, 0};
+    uint64_t key = startKey;
+    for (uint32_t i = 0; i < numRecords; i++) {
+        data[0] = (int32_t)i;
+        TEST_ASSERT_EQUAL_INT8(0, embedDBPut(state, &key, data));
+        key += KEY_STEP;
+    }
+    TEST_ASSERT_EQUAL_INT8(0, embedDBFlush(state));
+}
+
+void check_records(embedDBState* state, uint64_t startKey, uint32_t numRecords) {
+    int32_t data[3];
+    for (uint32_t i = 0; i < numRecords; i += 7) {
+        uint64_t key = startKey + (uint64_t)i * KEY_STEP;
+        TEST_ASSERT_EQUAL_INT8_MESSAGE(0, embedDBGet(state, &key, data), "embedDB did not find an inserted key.");
+        TEST_ASSERT_EQUAL_INT32(i, data[0]);
+
+        /* Keys between the inserted keys are not found */
+        key++;
+        TEST_ASSERT_NOT_EQUAL(0, embedDBGet(state, &key, data));
+    }
+}
+
+void check_range(embedDBState* state, uint64_t minKey, uint64_t maxKey) {
+    embedDBIterator it;
+    it.minKey = &minKey;
+    it.maxKey = &maxKey;
+    it.minData = NULL;
+    it.maxData = NULL;
+    embedDBInitIterator(state, &it);
+
+    uint64_t key = 0, previousKey = 0;
+    int32_t data[3];
+    uint32_t numRecords = 0;
+    while (embedDBNext(state, &it, &key, data)) {
+        TEST_ASSERT_TRUE(key >= minKey && key <= maxKey);
+        if (numRecords > 0)
+            TEST_ASSERT_EQUAL_UINT64(previousKey + KEY_STEP, key);
+        previousKey = key;
+        key = 0;
+        numRecords++;
+    }
+    embedDBCloseIterator(&it);
+    TEST_ASSERT_EQUAL_UINT32((maxKey - minKey) / KEY_STEP + 1, numRecords);
+}
+
+void free_state(embedDBState* state) {
+    embedDBClose(state);
+    tearDownFile(state->dataFile);
+    free(state->fileInterface);
+    free(state->buffer);
+    free(state);
+}
+
+/* Function returns a pointer to a newly created embedDBState, or NULL if embedDB failed to initialize */
+embedDBState* init_state(uint32_t parameters, uint8_t radixBits, uint8_t keySize, char* dataPath) {
+    embedDBState* state = (embedDBState*)malloc(sizeof(embedDBState));
+    if (state == NULL) {
+        printf("Unable to allocate state. Exiting\n");
+        exit(0);
+    }
+    state->keySize = keySize;
+    state->dataSize = 12;
+    state->pageSize = 512;
+    state->numSplinePoints = 300;
+    state->radixBits = radixBits;
+    state->bitmapSize = 0;
+    state->bufferSizeInBlocks = 2;
+    state->buffer = malloc((size_t)state->bufferSizeInBlocks * state->pageSize);
+    if (state->buffer == NULL) {
+        printf("Unable to allocate buffer. Exiting\n");
+        exit(0);
+    }
+    state->numDataPages = NUM_DATA_PAGES;
+    state->eraseSizeInPages = 4;
+    state->fileInterface = getFileInterface();
+    state->dataFile = setupFile(dataPath);
+    state->parameters = parameters;
+    state->compareKey = keySize == 4 ? int32Comparator : int64Comparator;
+    state->compareData = int32Comparator;
+
+    size_t splineMaxError = 1;
+    if (embedDBInit(state, splineMaxError) != 0) {
+        tearDownFile(state->dataFile);
+        free(state->fileInterface);
+        free(state->buffer);
+        free(state);
+        return NULL;
+    }
+
+    embedDBResetStats(state);
+    return state;
+}
@@ -0,0 +1,284 @@
+#include <stdio.h>
+
+#include "../Unity/src/unity.h"
+#include "../src/embedDB/embedDB.h"
+#include "../src/embedDB/shardManager.h"
+#include "../src/embedDB/utilityFunctions.h"
+
+#define NUM_SHARDS 4
+
+embedDBState* init_state(uint8_t number, uint8_t dataSize);
+void free_state(embedDBState* state);
+void init_manager(uint8_t numShards, uint8_t routing, uint8_t dataSize);
+void free_manager(void);
+uint32_t check_merge(uint32_t* minKey, uint32_t* maxKey, uint32_t step);
+
+// global variables for the shards. Use in setUp() function and tearDown()
+embedDBState* shards[NUM_SHARDS];
+embedDBShardManager manager;
+uint8_t numShards;
+
+void setUp(void) {
+    memset(&manager, 0, sizeof(manager));
+    numShards = 0;
+}
+
+void tearDown(void) {
+    free_manager();
+}
+
+void test_key_range_routing(void) {
+    uint32_t boundaries[] = {1000, 2000, 3000};
+    init_manager(NUM_SHARDS, EMBEDDB_SHARD_BY_KEY_RANGE, 4);
+    manager.boundaries = boundaries;
+    TEST_ASSERT_EQUAL_INT8(0, embedDBShardInit(&manager));
+
+    for (uint32_t key = 0; key < 4000; key += 2) {
+        int32_t data = key * 3;
+        TEST_ASSERT_EQUAL_INT8(0, embedDBShardPut(&manager, &key, &data));
+    }
+    for (uint8_t s = 0; s < NUM_SHARDS; s++) {
+        TEST_ASSERT_EQUAL_UINT32(s * 1000, (uint32_t)shards[s]->minKey);
+        TEST_ASSERT_EQUAL_UINT32(s * 1000 + 998, (uint32_t)shards[s]->maxKey);
+    }
+
+    uint32_t key = 2500;
+    int32_t data;
+    TEST_ASSERT_EQUAL_INT8(0, embedDBShardGet(&manager, &key, &data));
+    TEST_ASSERT_EQUAL_INT32(7500, data);
+    key = 2501;
+    TEST_ASSERT_NOT_EQUAL(0, embedDBShardGet(&manager, &key, &data));
+    TEST_ASSERT_EQUAL_UINT32(2000, check_merge(NULL, NULL, 2));
+
+    /* Only the shards holding the key range are read */
+    uint32_t minKey = 1500, maxKey = 2600;
+    embedDBShardIterator it;
+    it.minKey = &minKey;
+    it.maxKey = &maxKey;
+    it.minData = NULL;
+    it.maxData = NULL;
+    TEST_ASSERT_EQUAL_INT8(0, embedDBShardInitIterator(&manager, &it));
+    TEST_ASSERT_NULL(it.cursors[0].records);
+    TEST_ASSERT_NOT_NULL(it.cursors[1].records);
+    TEST_ASSERT_NOT_NULL(it.cursors[2].records);
+    TEST_ASSERT_NULL(it.cursors[3].records);
+    embedDBShardCloseIterator(&manager, &it);
+    TEST_ASSERT_EQUAL_UINT32(551, check_merge(&minKey, &maxKey, 2));
+}
+
+void test_time_window_routing(void) {
+    init_manager(NUM_SHARDS, EMBEDDB_SHARD_BY_TIME_WINDOW, 4);
+    manager.windowSize = 100;
+    TEST_ASSERT_EQUAL_INT8(0, embedDBShardInit(&manager));
+
+    uint32_t numRecords = 20000;
+    for (uint32_t key = 0; key < numRecords; key++) {
+        int32_t data = key * 3;
+        TEST_ASSERT_EQUAL_INT8(0, embedDBShardPut(&manager, &key, &data));
+    }
+    for (uint8_t s = 0; s < NUM_SHARDS; s++) {
+        TEST_ASSERT_EQUAL_UINT32(s * 100, (uint32_t)shards[s]->minKey);
+        TEST_ASSERT_EQUAL_UINT32(numRecords - (NUM_SHARDS - 1 - s) * 100 - 1, (uint32_t)shards[s]->maxKey);
+    }
+    for (uint32_t key = 0; key < numRecords; key += 97) {
+        int32_t data;
+        TEST_ASSERT_EQUAL_INT8(0, embedDBShardGet(&manager, &key, &data));
+        TEST_ASSERT_EQUAL_INT32(key * 3, data);
+    }
+    TEST_ASSERT_EQUAL_UINT32(numRecords, check_merge(NULL, NULL, 1));
+
+    uint32_t minKey = 5050, maxKey = 5349;
+    TEST_ASSERT_EQUAL_UINT32(300, check_merge(&minKey, &maxKey, 1));
+}
+
+void test_hash_routing_with_parallel_batches(void) {
+    init_manager(NUM_SHARDS, EMBEDDB_SHARD_BY_HASH, 8);
+    manager.hashColumnOffset = 4;
+    manager.hashColumnSize = 4;
+    manager.parallel = 1;
+    TEST_ASSERT_EQUAL_INT8(0, embedDBShardInit(&manager));
+
+    /* Readings of 10 sensors. The first column is the reading and the second the sensor id that is hashed */
+    uint32_t numRecords = 40000, batchSize = 5000;
+    uint32_t* keys = malloc(batchSize * sizeof(uint32_t));
+    int32_t* data = malloc(batchSize * 2 * sizeof(int32_t));
+    for (uint32_t first = 0; first < numRecords; first += batchSize) {
+        for (uint32_t i = 0; i < batchSize; i++) {
+            keys[i] = first + i;
+            data[i * 2] = (first + i) * 3;
+            data[i * 2 + 1] = (first + i) % 10;
+        }
+        TEST_ASSERT_EQUAL_INT8(0, embedDBShardPutBatch(&manager, keys, data, batchSize));
+    }
+    TEST_ASSERT_EQUAL_INT8(0, embedDBShardFlush(&manager));
+    free(keys);
+    free(data);
+
+    /* Every sensor stays in one shard */
+    int8_t sensorShard[10];
+    memset(sensorShard, -1, sizeof(sensorShard));
+    uint32_t total = 0;
+    for (uint8_t s = 0; s < NUM_SHARDS; s++) {
+        embedDBIterator it;
+        it.minKey = NULL;
+        it.maxKey = NULL;
+        it.minData = NULL;
+        it.maxData = NULL;
+        embedDBInitIterator(shards[s], &it);
+        uint32_t key;
+        int32_t record[2];
+        while (embedDBNext(shards[s], &it, &key, record)) {
+            if (sensorShard[record[1]] == -1)
+                sensorShard[record[1]] = s;
+            TEST_ASSERT_EQUAL_INT8(sensorShard[record[1]], s);
+            total++;
+        }
+        embedDBCloseIterator(&it);
+    }
+    TEST_ASSERT_EQUAL_UINT32(numRecords, total);
+
+    for (uint32_t key = 0; key < numRecords; key += 333) {
+        int32_t record[2];
+        TEST_ASSERT_EQUAL_INT8(0, embedDBShardGet(&manager, &key, record));
+        TEST_ASSERT_EQUAL_INT32(key * 3, record[0]);
+        TEST_ASSERT_EQUAL_INT32(key % 10, record[1]);
+    }
+    uint32_t key = numRecords;
+    int32_t record[2];
+    TEST_ASSERT_NOT_EQUAL(0, embedDBShardGet(&manager, &key, record));
+
+    TEST_ASSERT_EQUAL_UINT32(numRecords, check_merge(NULL, NULL, 1));
+    uint32_t minKey = 12345, maxKey = 23456;
+    TEST_ASSERT_EQUAL_UINT32(maxKey - minKey + 1, check_merge(&minKey, &maxKey, 1));
+
+    /* Data filters are applied in each shard */
+    int32_t minData[2] = {30000, 0};
+    embedDBShardIterator it;
+    it.minKey = NULL;
+    it.maxKey = NULL;
+    it.minData = minData;
+    it.maxData = NULL;
+    TEST_ASSERT_EQUAL_INT8(0, embedDBShardInitIterator(&manager, &it));
+    uint32_t expected = 10000, numFound = 0;
+    while (embedDBShardNext(&manager, &it, &key, record)) {
+        TEST_ASSERT_EQUAL_UINT32(expected++, key);
+        numFound++;
+    }
+    embedDBShardCloseIterator(&manager, &it);
+    TEST_ASSERT_EQUAL_UINT32(numRecords - 10000, numFound);
+}
+
+void test_invalid_configuration(void) {
+    init_manager(NUM_SHARDS, EMBEDDB_SHARD_BY_KEY_RANGE, 4);
+    TEST_ASSERT_NOT_EQUAL(0, embedDBShardInit(&manager));
+
+    manager.routing = EMBEDDB_SHARD_BY_HASH;
+    manager.hashColumnOffset = 2;
+    manager.hashColumnSize = 4;
+    TEST_ASSERT_NOT_EQUAL(0, embedDBShardInit(&manager));
+
+    manager.routing = EMBEDDB_SHARD_BY_TIME_WINDOW;
+    manager.windowSize = 10;
+    manager.numShards = EMBEDDB_MAX_SHARDS + 1;
+    TEST_ASSERT_NOT_EQUAL(0, embedDBShardInit(&manager));
+    manager.numShards = NUM_SHARDS;
+    TEST_ASSERT_EQUAL_INT8(0, embedDBShardInit(&manager));
+
+    /* Shards must have the same record layout */
+    embedDBClose(shards[3]);
+    free_state(shards[3]);
+    shards[3] = init_state(3, 8);
+    TEST_ASSERT_NOT_EQUAL(0, embedDBShardInit(&manager));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_key_range_routing);
+    RUN_TEST(test_time_window_routing);
+    RUN_TEST(test_hash_routing_with_parallel_batches);
+    RUN_TEST(test_invalid_configuration);
+    return UNITY_END();
+}
+
+/* Checks the merged records from minKey to maxKey are in ascending order step apart and returns the number found */
+uint32_t check_merge(uint32_t* minKey, uint32_t* maxKey, uint32_t step) {
+    embedDBShardIterator it;
+    it.minKey = minKey;
+    it.maxKey = maxKey;
+    it.minData = NULL;
+    it.maxData = NULL;
+    TEST_ASSERT_EQUAL_INT8(0, embedDBShardInitIterator(&manager, &it));
+
+    uint32_t key, expected = minKey == NULL ? 0 : *minKey, numFound = 0;
+    int32_t data[2];
+    while (embedDBShardNext(&manager, &it, &key, data)) {
+        TEST_ASSERT_EQUAL_UINT32(expected, key);
+        TEST_ASSERT_EQUAL_INT32(key * 3, data[0]);
+        expected += step;
+        numFound++;
+    }
+    embedDBShardCloseIterator(&manager, &it);
+    return numFound;
+}
+
+void init_manager(uint8_t count, uint8_t routing, uint8_t dataSize) {
+    numShards = count;
+    for (uint8_t s = 0; s < numShards; s++)
+        shards[s] = init_state(s, dataSize);
+    manager.shards = shards;
+    manager.numShards = numShards;
+    manager.routing = routing;
+}
+
+void free_manager(void) {
+    if (numShards == 0)
+        return;
+    manager.numShards = numShards;
+    embedDBShardClose(&manager);
+    for (uint8_t s = 0; s < numShards; s++)
+        free_state(shards[s]);
+    numShards = 0;
+}
+
+void free_state(embedDBState* state) {
+    tearDownFile(state->dataFile);
+    free(state->fileInterface);
+    free(state->buffer);
+    free(state);
+}
+
+/* Function returns a pointer to a newly created embedDBState with its own files */
+embedDBState* init_state(uint8_t number, uint8_t dataSize) {
+    embedDBState* state = (embedDBState*)malloc(sizeof(embedDBState));
+    if (state == NULL) {
+        printf("Unable to allocate state. Exiting\n");
+        exit(0);
+    }
+    state->keySize = 4;
+    state->dataSize = dataSize;
+    state->pageSize = 512;
+    state->numSplinePoints = 300;
+    state->bitmapSize = 0;
+    state->bufferSizeInBlocks = 2;
+    state->buffer = calloc(1, (size_t)state->bufferSizeInBlocks * state->pageSize);
+    if (state->buffer == NULL) {
+        printf("Unable to allocate buffer. Exiting\n");
+        exit(0);
+    }
+    state->numDataPages = 1000;
+    state->eraseSizeInPages = 4;
+    char dataPath[40];
+    snprintf(dataPath, 40, "build/artifacts/shardData%i.bin", number);
+    state->fileInterface = getFileInterface();
+    state->dataFile = setupFile(dataPath);
+    state->parameters = EMBEDDB_RESET_DATA;
+    state->compareKey = int32Comparator;
+    state->compareData = int32Comparator;
+
+    size_t splineMaxError = 1;
+    if (embedDBInit(state, splineMaxError) != 0) {
+        printf("Unable to initialize embedDB. Exiting\n");
+        exit(0);
+    }
+    return state;
+}
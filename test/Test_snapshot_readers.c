@@ -0,0 +1,338 @@
+#include <stdio.h>
+
+#include "../Unity/src/unity.h"
+#include "../src/embedDB/embedDB.h"
+#include "../src/embedDB/utilityFunctions.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+
+#include <pthread.h>
+#include <sched.h>
+
+#define NUM_READERS 2
+
+embedDBState* init_state(uint32_t parameters, uint32_t numDataPages);
+void free_state(embedDBState* state);
+void insert_records(embedDBState* state, uint32_t startKey, uint32_t numRecords);
+uint32_t check_snapshot(embedDBState* view, uint32_t minKey);
+void* writer_thread(void* arg);
+void* reader_thread(void* arg);
+
+// global variable for state. Use in setUp() function and tearDown()
+embedDBState* state;
+volatile int8_t writerDone;
+
+void setUp(void) {
+    state = NULL;
+    writerDone = 0;
+}
+
+void tearDown(void) {
+    if (state != NULL)
+        free_state(state);
+    state = NULL;
+}
+
+void test_snapshot_does_not_see_later_inserts(void) {
+    state = init_state(EMBEDDB_USE_INDEX | EMBEDDB_USE_BMAP | EMBEDDB_RESET_DATA, 256);
+    uint32_t numRecords = state->maxRecordsPerPage * 10 + 7;
+    insert_records(state, 0, numRecords);
+
+    embedDBReader reader;
+    TEST_ASSERT_EQUAL_INT8(0, embedDBInitReader(state, &reader));
+    insert_records(state, numRecords, state->maxRecordsPerPage * 3);
+
+    /* Records of the write buffer at the time of the snapshot are found, later ones are not */
+    int32_t data;
+    uint32_t key = numRecords - 1;
+    TEST_ASSERT_EQUAL_INT8(0, embedDBGet(&reader.view, &key, &data));
+    TEST_ASSERT_EQUAL_INT32(key * 3, data);
+    key = numRecords;
+    TEST_ASSERT_NOT_EQUAL(0, embedDBGet(&reader.view, &key, &data));
+    TEST_ASSERT_EQUAL_UINT32(numRecords, check_snapshot(&reader.view, 0));
+
+    embedDBSnapshot(&reader);
+    TEST_ASSERT_EQUAL_INT8(0, embedDBGet(&reader.view, &key, &data));
+    TEST_ASSERT_EQUAL_UINT32(numRecords + state->maxRecordsPerPage * 3, check_snapshot(&reader.view, 0));
+
+    /* The writer reads are not counted by the reader */
+    TEST_ASSERT_TRUE(reader.view.numReads > 0);
+    TEST_ASSERT_EQUAL_UINT32(0, state->numReads);
+    embedDBCloseReader(&reader);
+}
+
+void test_writer_does_not_erase_pages_of_a_snapshot(void) {
+    state = init_state(EMBEDDB_RESET_DATA, 16);
+    insert_records(state, 0, state->maxRecordsPerPage * 12);
+
+    embedDBReader reader;
+    TEST_ASSERT_EQUAL_INT8(0, embedDBInitReader(state, &reader));
+    uint32_t numInSnapshot = check_snapshot(&reader.view, 0);
+
+    /* Insert until the next page write has to erase the pages the snapshot starts with */
+    uint32_t key = state->maxRecordsPerPage * 12;
+    int32_t data = key * 3;
+    int8_t result;
+    while ((result = embedDBPut(state, &key, &data)) == 0) {
+        key++;
+        data = key * 3;
+    }
+    TEST_ASSERT_EQUAL_INT8(2, result);
+    TEST_ASSERT_EQUAL_INT8(2, embedDBFlush(state));
+
+    /* The snapshot still reads every record it started with */
+    TEST_ASSERT_EQUAL_UINT32(numInSnapshot, check_snapshot(&reader.view, 0));
+
+    /* A newer snapshot lets the writer continue */
+    embedDBSnapshot(&reader);
+    TEST_ASSERT_EQUAL_INT8(0, embedDBPut(state, &key, &data));
+    embedDBCloseReader(&reader);
+    insert_records(state, key + 1, state->maxRecordsPerPage * 20);
+    TEST_ASSERT_EQUAL_INT8(0, embedDBFlush(state));
+}
+
+void test_rejected_batch_inserts_nothing(void) {
+    state = init_state(EMBEDDB_USE_COMPRESSION | EMBEDDB_RESET_DATA, 16);
+    uint32_t key = 0;
+    while (state->nextDataPageId < 10) {
+        int32_t data = key * 3;
+        TEST_ASSERT_EQUAL_INT8(0, embedDBPut(state, &key, &data));
+        key++;
+    }
+
+    embedDBReader reader;
+    TEST_ASSERT_EQUAL_INT8(0, embedDBInitReader(state, &reader));
+
+    /* The batch fits in the free pages at first, but fills more pages than storage has */
+    uint32_t numRecords = state->maxRecordsPerPage * 16;
+    uint32_t* keys = malloc(numRecords * sizeof(uint32_t));
+    int32_t* data = malloc(numRecords * sizeof(int32_t));
+    for (uint32_t i = 0; i < numRecords; i++) {
+        keys[i] = key + i;
+        data[i] = (key + i) * 3;
+    }
+    uint64_t maxKey = state->maxKey;
+    count_t count = EMBEDDB_GET_COUNT(state->dataWriteBuffer);
+    uint32_t nextDataPageId = state->nextDataPageId;
+    TEST_ASSERT_EQUAL_INT8(2, embedDBPutBatch(state, keys, data, numRecords));
+    TEST_ASSERT_EQUAL_UINT64(maxKey, state->maxKey);
+    TEST_ASSERT_EQUAL_UINT32(count, EMBEDDB_GET_COUNT(state->dataWriteBuffer));
+    TEST_ASSERT_EQUAL_UINT32(nextDataPageId, state->nextDataPageId);
+
+    /* Without the snapshot the whole batch goes in */
+    embedDBCloseReader(&reader);
+    TEST_ASSERT_EQUAL_INT8(0, embedDBPutBatch(state, keys, data, numRecords));
+    TEST_ASSERT_EQUAL_UINT64(keys[numRecords - 1], state->maxKey);
+    free(keys);
+    free(data);
+}
+
+void test_reader_slots_are_limited(void) {
+    state = init_state(EMBEDDB_RESET_DATA, 16);
+    embedDBReader readers[EMBEDDB_MAX_READERS + 1];
+    for (uint8_t i = 0; i < EMBEDDB_MAX_READERS; i++)
+        TEST_ASSERT_EQUAL_INT8(0, embedDBInitReader(state, &readers[i]));
+    TEST_ASSERT_NOT_EQUAL(0, embedDBInitReader(state, &readers[EMBEDDB_MAX_READERS]));
+
+    /* A closed slot can be used again */
+    embedDBCloseReader(&readers[1]);
+    TEST_ASSERT_EQUAL_INT8(0, embedDBInitReader(state, &readers[EMBEDDB_MAX_READERS]));
+    for (uint8_t i = 0; i <= EMBEDDB_MAX_READERS; i++) {
+        if (i != 1)
+            embedDBCloseReader(&readers[i]);
+    }
+}
+
+void test_stalled_reader_does_not_stop_writer(void) {
+    state = init_state(EMBEDDB_RESET_DATA, 16);
+
+    /* A reader that asked the writer to wait and is never scheduled again */
+    __atomic_store_n(&state->snapshotWaiting, 1, __ATOMIC_RELEASE);
+    insert_records(state, 0, state->maxRecordsPerPage * 2);
+    TEST_ASSERT_EQUAL_UINT64(state->maxRecordsPerPage * 2 - 1, state->maxKey);
+    __atomic_store_n(&state->snapshotWaiting, 0, __ATOMIC_RELEASE);
+}
+
+void test_readers_run_while_writer_inserts(void) {
+    state = init_state(EMBEDDB_USE_INDEX | EMBEDDB_USE_BMAP | EMBEDDB_RESET_DATA, 64);
+    pthread_t writer, readers[NUM_READERS];
+    uint32_t numSnapshots[NUM_READERS];
+    TEST_ASSERT_EQUAL_INT(0, pthread_create(&writer, NULL, writer_thread, NULL));
+    for (uint8_t i = 0; i < NUM_READERS; i++)
+        TEST_ASSERT_EQUAL_INT(0, pthread_create(&readers[i], NULL, reader_thread, &numSnapshots[i]));
+    pthread_join(writer, NULL);
+    for (uint8_t i = 0; i < NUM_READERS; i++) {
+        pthread_join(readers[i], NULL);
+        TEST_ASSERT_TRUE(numSnapshots[i] > 0);
+    }
+    TEST_ASSERT_EQUAL_UINT32(state->maxRecordsPerPage * state->numDataPages * 4 - 1, (uint32_t)state->maxKey);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_snapshot_does_not_see_later_inserts);
+    RUN_TEST(test_writer_does_not_erase_pages_of_a_snapshot);
+    RUN_TEST(test_rejected_batch_inserts_nothing);
+    RUN_TEST(test_reader_slots_are_limited);
+    RUN_TEST(test_stalled_reader_does_not_stop_writer);
+    RUN_TEST(test_readers_run_while_writer_inserts);
+    return UNITY_END();
+}
+
+/* Inserts enough records to wrap around storage several times. Inserts held up by a snapshot are retried */
+void* writer_thread(void* arg) {
+    (void)arg;
+    uint32_t numRecords = state->maxRecordsPerPage * state->numDataPages * 4;
+    for (uint32_t key = 0; key < numRecords; key++) {
+        int32_t data = key * 3;
+        int8_t result;
+        while ((result = embedDBPut(state, &key, &data)) == 2)
+            sched_yield();
+        if (result != 0)
+            break;
+    }
+    __atomic_store_n(&writerDone, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+/* Repeatedly takes a snapshot and checks the newest records in it. Assertions are only made on the main thread */
+void* reader_thread(void* arg) {
+    embedDBReader reader;
+    uint32_t* numSnapshots = (uint32_t*)arg;
+    *numSnapshots = 0;
+    if (embedDBInitReader(state, &reader) != 0)
+        return NULL;
+    int8_t valid = 1;
+    while (valid && !__atomic_load_n(&writerDone, __ATOMIC_ACQUIRE)) {
+        embedDBSnapshot(&reader);
+        embedDBState* view = &reader.view;
+        if (view->minKey == UINT32_MAX)
+            continue;
+
+        /* Records run from the oldest key on storage to the last key inserted before the snapshot */
+        uint32_t maxKey = (uint32_t)view->maxKey;
+        uint32_t minKey = maxKey > 3000 ? maxKey - 3000 : 0;
+        embedDBIterator it;
+        it.minKey = &minKey;
+        it.maxKey = NULL;
+        it.minData = NULL;
+        it.maxData = NULL;
+        embedDBInitIterator(view, &it);
+        uint32_t key, expected = 0, numFound = 0;
+        int32_t data;
+        while (valid && embedDBNext(view, &it, &key, &data)) {
+            if (numFound > 0 && key != expected)
+                valid = 0;
+            if (data != (int32_t)key * 3 || key < minKey)
+                valid = 0;
+            expected = key + 1;
+            numFound++;
+        }
+        embedDBCloseIterator(&it);
+        if (numFound == 0 || expected != maxKey + 1)
+            valid = 0;
+        if (valid && (embedDBGet(view, &maxKey, &data) != 0 || data != (int32_t)maxKey * 3))
+            valid = 0;
+        if (valid)
+            (*numSnapshots)++;
+    }
+    /* A failed check leaves the count at 0 */
+    if (!valid)
+        *numSnapshots = 0;
+    embedDBCloseReader(&reader);
+    return NULL;
+}
+
+void insert_records(embedDBState* state, uint32_t startKey, uint32_t numRecords) {
+    for (uint32_t key = startKey; key < startKey + numRecords; key++) {
+        int32_t data = key * 3;
+        TEST_ASSERT_EQUAL_INT8(0, embedDBPut(state, &key, &data));
+    }
+}
+
+/* Checks the records of a snapshot from minKey on are consecutive and returns the number found */
+uint32_t check_snapshot(embedDBState* view, uint32_t minKey) {
+    embedDBIterator it;
+    it.minKey = &minKey;
+    it.maxKey = NULL;
+    it.minData = NULL;
+    it.maxData = NULL;
+    embedDBInitIterator(view, &it);
+    uint32_t key, numFound = 0, expected = 0;
+    int32_t data;
+    while (embedDBNext(view, &it, &key, &data)) {
+        if (numFound > 0)
+            TEST_ASSERT_EQUAL_UINT32(expected, key);
+        TEST_ASSERT_EQUAL_INT32(key * 3, data);
+        expected = key + 1;
+        numFound++;
+    }
+    embedDBCloseIterator(&it);
+    TEST_ASSERT_EQUAL_UINT32((uint32_t)view->maxKey + 1, expected);
+    return numFound;
+}
+
+void free_state(embedDBState* state) {
+    embedDBClose(state);
+    tearDownPosixFile(state->dataFile);
+    if (state->indexFile != NULL)
+        tearDownPosixFile(state->indexFile);
+    free(state->fileInterface);
+    free(state->buffer);
+    free(state);
+}
+
+/* Function returns a pointer to a newly created embedDBState using the POSIX file interface, whose reads can run on several threads */
+embedDBState* init_state(uint32_t parameters, uint32_t numDataPages) {
+    embedDBState* state = (embedDBState*)malloc(sizeof(embedDBState));
+    if (state == NULL) {
+        printf("Unable to allocate state. Exiting\n");
+        exit(0);
+    }
+    state->keySize = 4;
+    state->dataSize = 4;
+    state->pageSize = 512;
+    state->numSplinePoints = 300;
+    state->bitmapSize = EMBEDDB_USING_BMAP(parameters) ? 2 : 0;
+    state->inBitmap = inBitmapInt16;
+    state->updateBitmap = updateBitmapInt16;
+    state->buildBitmapFromRange = buildBitmapInt16FromRange;
+    state->bufferSizeInBlocks = EMBEDDB_USING_INDEX(parameters) ? 4 : 2;
+    state->buffer = calloc(1, (size_t)state->bufferSizeInBlocks * state->pageSize);
+    if (state->buffer == NULL) {
+        printf("Unable to allocate buffer. Exiting\n");
+        exit(0);
+    }
+    state->numDataPages = numDataPages;
+    state->numIndexPages = 8;
+    state->eraseSizeInPages = 4;
+    char dataPath[] = "build/artifacts/dataFile.bin";
+    char indexPath[] = "build/artifacts/indexFile.bin";
+    state->fileInterface = getPosixFileInterface();
+    state->dataFile = setupPosixFile(dataPath, state->pageSize, 0);
+    state->indexFile = EMBEDDB_USING_INDEX(parameters) ? setupPosixFile(indexPath, state->pageSize, 0) : NULL;
+    state->parameters = parameters;
+    state->numDataColumns = 0;
+    state->compareKey = int32Comparator;
+    state->compareData = int32Comparator;
+
+    size_t splineMaxError = 1;
+    if (embedDBInit(state, splineMaxError) != 0) {
+        printf("Unable to initialize embedDB. Exiting\n");
+        exit(0);
+    }
+    return state;
+}
+
+#else
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+int main() {
+    UNITY_BEGIN();
+    return UNITY_END();
+}
+
+#endif
@@ -0,0 +1,298 @@
+#include <stdio.h>
+
+#include "../Unity/src/unity.h"
+#include "../src/embedDB/embedDB.h"
+#include "../src/embedDB/utilityFunctions.h"
+
+embedDBState* init_state(uint32_t parameters, uint32_t numDataPages);
+void free_state(embedDBState* state);
+int32_t make_data(uint32_t key);
+void insert_records(embedDBState* state, uint32_t numRecords);
+uint32_t fake_clock(void);
+
+// global variable for state. Use in setUp() function and tearDown()
+embedDBState* state;
+
+/* Ticks of the fake clock. Every read of the clock advances it by CLOCK_STEP */
+uint32_t clockTicks;
+#define CLOCK_STEP 3
+
+void setUp(void) {
+    state = NULL;
+    clockTicks = 0;
+}
+
+void tearDown(void) {
+    if (state != NULL)
+        free_state(state);
+    state = NULL;
+}
+
+void test_stats_split_page_counts_by_file(void) {
+    uint32_t numRecords = 5000;
+    state = init_state(EMBEDDB_USE_INDEX | EMBEDDB_USE_BMAP | EMBEDDB_USE_VDATA | EMBEDDB_RESET_DATA, 64);
+    insert_records(state, numRecords);
+    TEST_ASSERT_EQUAL_INT8(0, embedDBFlush(state));
+
+    embedDBStats stats;
+    embedDBGetStats(state, &stats);
+    TEST_ASSERT_EQUAL_UINT32(numRecords, stats.operations[EMBEDDB_STATS_PUT]);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.operations[EMBEDDB_STATS_FLUSH]);
+
+    /* The old counters add up the data and variable data files */
+    TEST_ASSERT_EQUAL_UINT32(state->nextDataPageId, stats.files[EMBEDDB_DATA_FILE].writes);
+    TEST_ASSERT_EQUAL_UINT32(state->nextIdxPageId, stats.files[EMBEDDB_INDEX_FILE].writes);
+    TEST_ASSERT_EQUAL_UINT32(state->nextVarPageId, stats.files[EMBEDDB_VAR_FILE].writes);
+    TEST_ASSERT_EQUAL_UINT32(state->numWrites, stats.files[EMBEDDB_DATA_FILE].writes + stats.files[EMBEDDB_VAR_FILE].writes);
+    TEST_ASSERT_EQUAL_UINT32(state->numIdxWrites, stats.files[EMBEDDB_INDEX_FILE].writes);
+
+    /* The data and variable data files are full, so their oldest pages were erased and writing wrapped around */
+    TEST_ASSERT_TRUE(stats.files[EMBEDDB_DATA_FILE].erases > 0);
+    TEST_ASSERT_EQUAL_UINT32((state->nextDataPageId - 1) / state->numDataPages, stats.files[EMBEDDB_DATA_FILE].wraps);
+    TEST_ASSERT_TRUE(stats.files[EMBEDDB_VAR_FILE].erases > 0);
+    TEST_ASSERT_TRUE(stats.files[EMBEDDB_VAR_FILE].wraps > 0);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.files[EMBEDDB_INDEX_FILE].wraps);
+
+    /* Reading a record and its variable data reads from both files */
+    uint32_t key = numRecords - 10;
+    int32_t data = 0;
+    char varData[15];
+    embedDBVarDataStream* stream = NULL;
+    TEST_ASSERT_EQUAL_INT8(0, embedDBGetVar(state, &key, &data, &stream));
+    TEST_ASSERT_NOT_NULL(stream);
+    TEST_ASSERT_EQUAL_UINT32(15, embedDBVarDataStreamRead(state, stream, varData, 15));
+    free(stream);
+    embedDBGetStats(state, &stats);
+    TEST_ASSERT_TRUE(stats.files[EMBEDDB_DATA_FILE].reads > 0);
+    TEST_ASSERT_TRUE(stats.files[EMBEDDB_VAR_FILE].reads > 0);
+    TEST_ASSERT_EQUAL_UINT32(state->numReads, stats.files[EMBEDDB_DATA_FILE].reads + stats.files[EMBEDDB_VAR_FILE].reads);
+    TEST_ASSERT_EQUAL_UINT32(state->bufferHits, stats.files[EMBEDDB_DATA_FILE].bufferHits + stats.files[EMBEDDB_INDEX_FILE].bufferHits + stats.files[EMBEDDB_VAR_FILE].bufferHits);
+}
+
+void test_stats_count_pages_probed_and_skipped(void) {
+    uint32_t numRecords = 20000;
+    state = init_state(EMBEDDB_USE_INDEX | EMBEDDB_USE_BMAP | EMBEDDB_RESET_DATA, 1000);
+    insert_records(state, numRecords);
+
+    uint32_t numGets = 0;
+    for (uint32_t key = 0; key < numRecords - 1000; key += 97) {
+        int32_t data = 0;
+        TEST_ASSERT_EQUAL_INT8(0, embedDBGet(state, &key, &data));
+        TEST_ASSERT_EQUAL_INT32(make_data(key), data);
+        numGets++;
+    }
+    embedDBStats stats;
+    embedDBGetStats(state, &stats);
+    TEST_ASSERT_EQUAL_UINT32(numGets, stats.operations[EMBEDDB_STATS_GET]);
+    TEST_ASSERT_TRUE(stats.getPagesProbed >= numGets);
+    TEST_ASSERT_TRUE(stats.getMaxPagesProbed >= 1);
+    TEST_ASSERT_TRUE(stats.getMaxPagesProbed <= state->nextDataPageId);
+    TEST_ASSERT_TRUE(stats.splinePoints >= 2);
+    TEST_ASSERT_TRUE(stats.splineBytes > 0);
+    TEST_ASSERT_EQUAL_UINT32(state->spl->maxError, stats.splineMaxError);
+
+    /* The bitmaps let the iterator skip the pages without hot readings */
+    embedDBResetStats(state);
+    int32_t minData = 1000;
+    embedDBIterator it;
+    it.minKey = NULL;
+    it.maxKey = NULL;
+    it.minData = &minData;
+    it.maxData = NULL;
+    embedDBInitIterator(state, &it);
+    uint32_t key;
+    int32_t data;
+    uint32_t numFound = 0;
+    while (embedDBNext(state, &it, &key, &data))
+        numFound++;
+    embedDBCloseIterator(&it);
+
+    embedDBGetStats(state, &stats);
+    TEST_ASSERT_EQUAL_UINT32(numFound + 1, stats.operations[EMBEDDB_STATS_NEXT]);
+    TEST_ASSERT_TRUE(stats.nextPagesSkipped > 0);
+    TEST_ASSERT_TRUE(stats.nextPagesRead < stats.nextPagesSkipped);
+    TEST_ASSERT_EQUAL_UINT32(state->nextDataPageId - state->minDataPageId, stats.nextPagesRead + stats.nextPagesSkipped);
+    TEST_ASSERT_TRUE(stats.nextPagesRead <= stats.files[EMBEDDB_DATA_FILE].reads + stats.files[EMBEDDB_DATA_FILE].bufferHits);
+}
+
+void test_stats_time_operations_with_clock(void) {
+    uint32_t numRecords = 3000;
+    state = init_state(EMBEDDB_USE_INDEX | EMBEDDB_USE_BMAP | EMBEDDB_RESET_DATA, 1000);
+    embedDBSetClock(state, fake_clock);
+    insert_records(state, numRecords);
+
+    /* A put reads the clock when it starts and when it ends */
+    embedDBStats stats;
+    embedDBGetStats(state, &stats);
+    embedDBLatencyStats* puts = &stats.latency[EMBEDDB_STATS_PUT];
+    TEST_ASSERT_EQUAL_UINT32(numRecords, puts->count);
+    TEST_ASSERT_TRUE(puts->totalTicks == (uint64_t)numRecords * CLOCK_STEP);
+    TEST_ASSERT_EQUAL_UINT32(CLOCK_STEP, puts->maxTicks);
+    TEST_ASSERT_EQUAL_UINT32(numRecords, puts->histogram[2]);
+    TEST_ASSERT_EQUAL_UINT32(CLOCK_STEP, embedDBLatencyPercentile(puts, 50));
+    TEST_ASSERT_EQUAL_UINT32(CLOCK_STEP, embedDBLatencyPercentile(puts, 100));
+
+    for (uint32_t key = 0; key < 2000; key += 10) {
+        int32_t data = 0;
+        TEST_ASSERT_EQUAL_INT8(0, embedDBGet(state, &key, &data));
+    }
+    embedDBGetStats(state, &stats);
+    TEST_ASSERT_EQUAL_UINT32(200, stats.latency[EMBEDDB_STATS_GET].count);
+    TEST_ASSERT_TRUE(stats.latency[EMBEDDB_STATS_GET].maxTicks > CLOCK_STEP);
+    TEST_ASSERT_TRUE(stats.getModelTicks == 200 * CLOCK_STEP);
+    TEST_ASSERT_TRUE(stats.getRecordTicks == 200 * CLOCK_STEP);
+    TEST_ASSERT_TRUE(stats.getProbeTicks > 0);
+
+    /* Without a clock the operations are counted but not timed */
+    embedDBSetClock(state, NULL);
+    TEST_ASSERT_EQUAL_INT8(0, embedDBFlush(state));
+    embedDBGetStats(state, &stats);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.operations[EMBEDDB_STATS_FLUSH]);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.latency[EMBEDDB_STATS_FLUSH].count);
+
+    embedDBResetStats(state);
+    embedDBStats empty;
+    memset(&empty, 0, sizeof(embedDBStats));
+    TEST_ASSERT_EQUAL_MEMORY(&empty, &state->stats, sizeof(embedDBStats));
+    TEST_ASSERT_EQUAL_UINT32(0, state->numReads);
+}
+
+void test_stats_count_batch_operations(void) {
+    state = init_state(EMBEDDB_USE_INDEX | EMBEDDB_USE_BMAP | EMBEDDB_RESET_DATA, 1000);
+    embedDBSetClock(state, fake_clock);
+
+    uint32_t keys[500];
+    int32_t data[500];
+    for (uint32_t i = 0; i < 500; i++) {
+        keys[i] = i;
+        data[i] = make_data(i);
+    }
+    TEST_ASSERT_EQUAL_INT8(0, embedDBPutBatch(state, keys, data, 300));
+    TEST_ASSERT_EQUAL_INT8(0, embedDBPutBatch(state, keys + 300, data + 300, 200));
+
+    /* Each record of a batch is a put, and each call is timed once */
+    embedDBStats stats;
+    embedDBGetStats(state, &stats);
+    TEST_ASSERT_EQUAL_UINT32(500, stats.operations[EMBEDDB_STATS_PUT]);
+    TEST_ASSERT_EQUAL_UINT32(2, stats.operations[EMBEDDB_STATS_PUT_BATCH]);
+    TEST_ASSERT_EQUAL_UINT32(2, stats.latency[EMBEDDB_STATS_PUT_BATCH].count);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.latency[EMBEDDB_STATS_PUT].count);
+
+    int8_t found[500];
+    TEST_ASSERT_EQUAL_INT32(500, embedDBGetMany(state, keys, data, found, 500));
+    embedDBGetStats(state, &stats);
+    TEST_ASSERT_EQUAL_UINT32(500, stats.operations[EMBEDDB_STATS_GET]);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.operations[EMBEDDB_STATS_GET_MANY]);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.latency[EMBEDDB_STATS_GET_MANY].count);
+    TEST_ASSERT_TRUE(stats.latency[EMBEDDB_STATS_GET_MANY].totalTicks >= CLOCK_STEP);
+}
+
+void test_stats_latency_percentile(void) {
+    embedDBLatencyStats latency;
+    memset(&latency, 0, sizeof(embedDBLatencyStats));
+    TEST_ASSERT_EQUAL_UINT32(0, embedDBLatencyPercentile(&latency, 50));
+
+    /* 90 operations of 1 tick and 10 of at least 512 ticks */
+    latency.count = 100;
+    latency.histogram[1] = 90;
+    latency.histogram[10] = 10;
+    latency.maxTicks = 600;
+    TEST_ASSERT_EQUAL_UINT32(1, embedDBLatencyPercentile(&latency, 0));
+    TEST_ASSERT_EQUAL_UINT32(1, embedDBLatencyPercentile(&latency, 50));
+    TEST_ASSERT_EQUAL_UINT32(1, embedDBLatencyPercentile(&latency, 90));
+    TEST_ASSERT_EQUAL_UINT32(600, embedDBLatencyPercentile(&latency, 91));
+    TEST_ASSERT_EQUAL_UINT32(600, embedDBLatencyPercentile(&latency, 99));
+
+    /* The bucket bound is used when it is below the slowest operation */
+    latency.maxTicks = 100000;
+    TEST_ASSERT_EQUAL_UINT32(1023, embedDBLatencyPercentile(&latency, 99));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_stats_split_page_counts_by_file);
+    RUN_TEST(test_stats_count_pages_probed_and_skipped);
+    RUN_TEST(test_stats_time_operations_with_clock);
+    RUN_TEST(test_stats_count_batch_operations);
+    RUN_TEST(test_stats_latency_percentile);
+    return UNITY_END();
+}
+
+uint32_t fake_clock(void) {
+    clockTicks += CLOCK_STEP;
+    return clockTicks;
+}
+
+/* Readings below 770 except for a hot spot every 4000 records */
+int32_t make_data(uint32_t key) {
+    if (key % 4000 < 10)
+        return 1200;
+    return (int32_t)(key / 3 % 700);
+}
+
+void insert_records(embedDBState* state, uint32_t numRecords) {
+    char varData[] = "Variable 00000";
+    for (uint32_t key = 0; key < numRecords; key++) {
+        int32_t data = make_data(key);
+        if (EMBEDDB_USING_VDATA(state->parameters)) {
+            for (uint32_t i = 0, k = key; i < 5; i++, k /= 10)
+                varData[13 - i] = (char)('0' + k % 10);
+            TEST_ASSERT_EQUAL_INT8(0, embedDBPutVar(state, &key, &data, varData, 15));
+        } else {
+            TEST_ASSERT_EQUAL_INT8(0, embedDBPut(state, &key, &data));
+        }
+    }
+}
+
+void free_state(embedDBState* state) {
+    embedDBClose(state);
+    tearDownFile(state->dataFile);
+    tearDownFile(state->indexFile);
+    if (state->varFile != NULL)
+        tearDownFile(state->varFile);
+    free(state->fileInterface);
+    free(state->buffer);
+    free(state);
+}
+
+/* Function returns a pointer to a newly created embedDBState */
+embedDBState* init_state(uint32_t parameters, uint32_t numDataPages) {
+    embedDBState* state = (embedDBState*)malloc(sizeof(embedDBState));
+    if (state == NULL) {
+        printf("Unable to allocate state. Exiting\n");
+        exit(0);
+    }
+    state->keySize = 4;
+    state->dataSize = 4;
+    state->pageSize = 512;
+    state->numSplinePoints = 300;
+    state->bitmapSize = 2;
+    state->inBitmap = inBitmapInt16;
+    state->updateBitmap = updateBitmapInt16;
+    state->buildBitmapFromRange = buildBitmapInt16FromRange;
+    state->bufferSizeInBlocks = 6;
+    state->buffer = calloc(1, (size_t)state->bufferSizeInBlocks * state->pageSize);
+    if (state->buffer == NULL) {
+        printf("Unable to allocate buffer. Exiting\n");
+        exit(0);
+    }
+    state->numDataPages = numDataPages;
+    state->numIndexPages = 48;
+    state->numVarPages = 16;
+    state->eraseSizeInPages = 4;
+    char dataPath[] = "build/artifacts/dataFile.bin", indexPath[] = "build/artifacts/indexFile.bin", varPath[] = "build/artifacts/varFile.bin";
+    state->fileInterface = getFileInterface();
+    state->dataFile = setupFile(dataPath);
+    state->indexFile = setupFile(indexPath);
+    state->varFile = EMBEDDB_USING_VDATA(parameters) ? setupFile(varPath) : NULL;
+    state->parameters = parameters;
+    state->compareKey = int32Comparator;
+    state->compareData = int32Comparator;
+
+    size_t splineMaxError = 1;
+    if (embedDBInit(state, splineMaxError) != 0) {
+        printf("Unable to initialize embedDB. Exiting\n");
+        exit(0);
+    }
+    return state;
+}
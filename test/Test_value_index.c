@@ -0,0 +1,235 @@
+#include <stdio.h>
+
+#include "../Unity/src/unity.h"
+#include "../src/embedDB/embedDB.h"
+#include "../src/embedDB/utilityFunctions.h"
+#include "../src/query-interface/advancedQueries.h"
+
+embedDBState* init_state(uint32_t parameters, uint32_t numValueIndexPages);
+void free_state(embedDBState* state);
+int32_t make_data(uint32_t key);
+void insert_records(embedDBState* state, uint32_t firstKey, uint32_t numRecords);
+uint32_t query_values(embedDBState* state, uint32_t numRecords, int32_t minValue, int32_t maxValue);
+
+// global variable for state. Use in setUp() function and tearDown()
+embedDBState* state;
+
+/* Status codes are mostly 0 to 7. One record in 487 holds one of 50 rare error codes from 1000 */
+#define ERROR_CODE 1000
+#define NUM_ERROR_CODES 50
+
+void setUp(void) {
+    state = NULL;
+}
+
+void tearDown(void) {
+    if (state != NULL)
+        free_state(state);
+    state = NULL;
+}
+
+void test_value_index_point_lookup_reads_fewer_pages(void) {
+    uint32_t numRecords = 60000;
+    uint32_t numReads[2];
+    uint32_t parameters[] = {EMBEDDB_RESET_DATA, EMBEDDB_USE_VALUE_INDEX | EMBEDDB_RESET_DATA};
+    for (uint8_t v = 0; v < 2; v++) {
+        state = init_state(parameters[v], 256);
+        insert_records(state, 0, numRecords);
+
+        uint32_t reads = state->numReads;
+        TEST_ASSERT_TRUE(query_values(state, numRecords, ERROR_CODE + 17, ERROR_CODE + 17) > 0);
+        numReads[v] = state->numReads - reads;
+        free_state(state);
+        state = NULL;
+    }
+
+    /* Without the value index every data page is read. With it only the pages holding the code are */
+    TEST_ASSERT_TRUE(numReads[0] >= numRecords / 64);
+    TEST_ASSERT_TRUE(numReads[1] <= 5);
+}
+
+void test_value_index_narrow_range_and_recovery(void) {
+    uint32_t numRecords = 40000;
+    state = init_state(EMBEDDB_USE_VALUE_INDEX | EMBEDDB_RESET_DATA, 256);
+    insert_records(state, 0, numRecords);
+    TEST_ASSERT_EQUAL_INT8(0, embedDBFlush(state));
+
+    uint32_t reads = state->numReads;
+    uint32_t numFound = query_values(state, numRecords, ERROR_CODE + 10, ERROR_CODE + 14);
+    uint32_t liveReads = state->numReads - reads;
+    TEST_ASSERT_TRUE(numFound > 0);
+    TEST_ASSERT_TRUE(liveReads < 30);
+    free_state(state);
+
+    /* The runs on file are reloaded and the data pages written after the last run are added again */
+    state = init_state(EMBEDDB_USE_VALUE_INDEX, 256);
+    TEST_ASSERT_NOT_NULL(state);
+    reads = state->numReads;
+    TEST_ASSERT_EQUAL_UINT32(numFound, query_values(state, numRecords, ERROR_CODE + 10, ERROR_CODE + 14));
+    TEST_ASSERT_EQUAL_UINT32(liveReads, state->numReads - reads);
+
+    /* Records inserted after recovery are found too */
+    insert_records(state, numRecords, 20000);
+    numRecords += 20000;
+    query_values(state, numRecords, ERROR_CODE + 10, ERROR_CODE + 14);
+    query_values(state, numRecords, 3, 3);
+}
+
+void test_value_index_after_runs_are_erased(void) {
+    /* The value index wraps many times, so only the runs of the newest data pages are on file */
+    uint32_t numRecords = 60000;
+    state = init_state(EMBEDDB_USE_VALUE_INDEX | EMBEDDB_RESET_DATA, 8);
+    insert_records(state, 0, numRecords);
+    TEST_ASSERT_TRUE(state->stats.files[EMBEDDB_VALUE_INDEX_FILE].erases > 0);
+
+    for (int32_t code = ERROR_CODE; code < ERROR_CODE + NUM_ERROR_CODES; code += 7)
+        query_values(state, numRecords, code, code);
+    query_values(state, numRecords, ERROR_CODE, ERROR_CODE + NUM_ERROR_CODES);
+}
+
+void test_value_index_used_by_selection_operator(void) {
+    uint32_t numRecords = 30000;
+    state = init_state(EMBEDDB_USE_VALUE_INDEX | EMBEDDB_RESET_DATA, 256);
+    insert_records(state, 0, numRecords);
+
+    embedDBIterator it;
+    it.minKey = NULL;
+    it.maxKey = NULL;
+    it.minData = NULL;
+    it.maxData = NULL;
+    embedDBInitIterator(state, &it);
+
+    int8_t colSizes[] = {4, 4};
+    int8_t colSignedness[] = {embedDB_COLUMN_UNSIGNED, embedDB_COLUMN_SIGNED};
+    embedDBSchema* schema = embedDBCreateSchema(2, colSizes, colSignedness);
+    int32_t code = ERROR_CODE + 5;
+    embedDBOperator* scanOp = createTableScanOperator(state, &it, schema);
+    embedDBOperator* selectOp = createSelectionOperator(scanOp, 1, SELECT_EQ, &code);
+    selectOp->init(selectOp);
+
+    uint32_t reads = state->numReads;
+    uint32_t numFound = 0, expected = 0;
+    int32_t* recordBuffer = selectOp->recordBuffer;
+    while (exec(selectOp)) {
+        while (make_data(expected) != code)
+            expected++;
+        TEST_ASSERT_EQUAL_UINT32(expected, recordBuffer[0]);
+        TEST_ASSERT_EQUAL_INT32(code, recordBuffer[1]);
+        expected++;
+        numFound++;
+    }
+    TEST_ASSERT_TRUE(numFound > 0);
+    TEST_ASSERT_TRUE(state->numReads - reads <= 5);
+
+    selectOp->close(selectOp);
+    embedDBFreeOperatorRecursive(&selectOp);
+    embedDBFreeSchema(&schema);
+    embedDBCloseIterator(&it);
+}
+
+void test_value_index_requires_valid_configuration(void) {
+    state = init_state(EMBEDDB_USE_VALUE_INDEX | EMBEDDB_RESET_DATA, 6);
+    TEST_ASSERT_NULL(state);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_value_index_point_lookup_reads_fewer_pages);
+    RUN_TEST(test_value_index_narrow_range_and_recovery);
+    RUN_TEST(test_value_index_after_runs_are_erased);
+    RUN_TEST(test_value_index_used_by_selection_operator);
+    RUN_TEST(test_value_index_requires_valid_configuration);
+    return UNITY_END();
+}
+
+int32_t make_data(uint32_t key) {
+    if (key % 487 == 300)
+        return ERROR_CODE + (int32_t)(key / 487 * 7 % NUM_ERROR_CODES);
+    return (int32_t)(key * 2654435761u >> 29);
+}
+
+void insert_records(embedDBState* state, uint32_t firstKey, uint32_t numRecords) {
+    for (uint32_t key = firstKey; key < firstKey + numRecords; key++) {
+        int32_t data = make_data(key);
+        TEST_ASSERT_EQUAL_INT8(0, embedDBPut(state, &key, &data));
+    }
+}
+
+/* Checks the iterator returns every record with data in [minValue, maxValue] and returns the number found */
+uint32_t query_values(embedDBState* state, uint32_t numRecords, int32_t minValue, int32_t maxValue) {
+    embedDBIterator it;
+    it.minKey = NULL;
+    it.maxKey = NULL;
+    it.minData = &minValue;
+    it.maxData = &maxValue;
+    embedDBInitIterator(state, &it);
+
+    uint32_t key, expected = 0, numFound = 0;
+    int32_t data;
+    while (embedDBNext(state, &it, &key, &data)) {
+        while (expected < numRecords && (make_data(expected) < minValue || make_data(expected) > maxValue))
+            expected++;
+        TEST_ASSERT_EQUAL_UINT32(expected, key);
+        TEST_ASSERT_EQUAL_INT32(make_data(key), data);
+        expected++;
+        numFound++;
+    }
+    embedDBCloseIterator(&it);
+
+    while (expected < numRecords && (make_data(expected) < minValue || make_data(expected) > maxValue))
+        expected++;
+    TEST_ASSERT_EQUAL_UINT32(numRecords, expected);
+    return numFound;
+}
+
+void free_state(embedDBState* state) {
+    embedDBClose(state);
+    tearDownFile(state->dataFile);
+    tearDownFile(state->valueIndexFile);
+    free(state->fileInterface);
+    free(state->buffer);
+    free(state);
+}
+
+/* Function returns a pointer to a newly created embedDBState, or NULL if embedDB failed to initialize */
+embedDBState* init_state(uint32_t parameters, uint32_t numValueIndexPages) {
+    embedDBState* state = (embedDBState*)malloc(sizeof(embedDBState));
+    if (state == NULL) {
+        printf("Unable to allocate state. Exiting\n");
+        exit(0);
+    }
+    state->keySize = 4;
+    state->dataSize = 4;
+    state->pageSize = 512;
+    state->numSplinePoints = 300;
+    state->bitmapSize = 0;
+    state->bufferSizeInBlocks = 4;
+    state->buffer = calloc(1, (size_t)state->bufferSizeInBlocks * state->pageSize);
+    if (state->buffer == NULL) {
+        printf("Unable to allocate buffer. Exiting\n");
+        exit(0);
+    }
+    state->numDataPages = 4000;
+    state->numValueIndexPages = numValueIndexPages;
+    state->eraseSizeInPages = 4;
+    char dataPath[] = "build/artifacts/dataFile.bin";
+    char valueIndexPath[] = "build/artifacts/valueIndexFile.bin";
+    state->fileInterface = getFileInterface();
+    state->dataFile = setupFile(dataPath);
+    state->valueIndexFile = setupFile(valueIndexPath);
+    state->valueIndexColumnOffset = 0;
+    state->parameters = parameters;
+    state->compareKey = int32Comparator;
+    state->compareData = int32Comparator;
+
+    size_t splineMaxError = 1;
+    if (embedDBInit(state, splineMaxError) != 0) {
+        tearDownFile(state->dataFile);
+        tearDownFile(state->valueIndexFile);
+        free(state->fileInterface);
+        free(state->buffer);
+        free(state);
+        return NULL;
+    }
+    return state;
+}
@@ -0,0 +1,267 @@
+#include <stdio.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#endif
+
+#include "../Unity/src/unity.h"
+#include "../src/embedDB/embedDB.h"
+#include "../src/embedDB/utilityFunctions.h"
+
+#define NUM_RECORDS 60
+#define MAX_BLOB_SIZE 4000
+#define NUM_VAR_PAGES 2000
+
+#define CONFIG_PLAIN 0
+#define CONFIG_BUFFER_POOL 1
+#define CONFIG_MMAP 2
+
+embedDBState* init_state(uint8_t config, char* varPath);
+void free_state(embedDBState* state, uint8_t config);
+uint32_t blob_length(uint32_t key);
+void make_blob(uint32_t key, uint8_t* blob);
+void insert_records(embedDBState* state, int8_t bulk);
+void check_spans(embedDBState* state, uint32_t maxSpansPerCall);
+void check_same_var_pages(embedDBState* state1, embedDBState* state2);
+
+// global variable for state. Use in setUp() function and tearDown()
+embedDBState* state;
+uint8_t config;
+
+void setUp(void) {
+    state = NULL;
+}
+
+void tearDown(void) {
+    if (state != NULL)
+        free_state(state, config);
+    state = NULL;
+}
+
+void test_bulk_put_writes_same_pages_as_put(void) {
+    config = CONFIG_PLAIN;
+    embedDBState* staged = init_state(config, "build/artifacts/varFile2.bin");
+    insert_records(staged, 0);
+    TEST_ASSERT_EQUAL_INT8(0, embedDBFlush(staged));
+    TEST_ASSERT_EQUAL_UINT32(0, staged->stats.varPagesDirect);
+
+    state = init_state(config, "build/artifacts/varFile.bin");
+    insert_records(state, 1);
+    TEST_ASSERT_EQUAL_INT8(0, embedDBFlush(state));
+    TEST_ASSERT_TRUE(state->stats.varPagesDirect > 0);
+    TEST_ASSERT_TRUE(state->stats.varPagesDirect < state->nextVarPageId);
+    TEST_ASSERT_EQUAL_UINT32(staged->nextVarPageId, state->nextVarPageId);
+    check_same_var_pages(staged, state);
+    free_state(staged, config);
+}
+
+void test_bulk_put_without_gather_write_stages_pages(void) {
+    config = CONFIG_PLAIN;
+    embedDBState* staged = init_state(config, "build/artifacts/varFile2.bin");
+    insert_records(staged, 0);
+    TEST_ASSERT_EQUAL_INT8(0, embedDBFlush(staged));
+
+    state = init_state(config, "build/artifacts/varFile.bin");
+    state->fileInterface->writeGather = NULL;
+    insert_records(state, 1);
+    TEST_ASSERT_EQUAL_INT8(0, embedDBFlush(state));
+    TEST_ASSERT_EQUAL_UINT32(0, state->stats.varPagesDirect);
+    check_same_var_pages(staged, state);
+    free_state(staged, config);
+}
+
+void test_spans_from_var_read_buffer(void) {
+    config = CONFIG_PLAIN;
+    state = init_state(config, "build/artifacts/varFile.bin");
+    insert_records(state, 1);
+    check_spans(state, 1);
+}
+
+void test_spans_from_buffer_pool(void) {
+    config = CONFIG_BUFFER_POOL;
+    state = init_state(config, "build/artifacts/varFile.bin");
+    insert_records(state, 1);
+    check_spans(state, state->bufferPool->numFrames / 2);
+}
+
+void test_spans_from_borrowed_pages(void) {
+#if defined(__unix__) || defined(__APPLE__)
+    config = CONFIG_MMAP;
+    state = init_state(config, "build/artifacts/varFile.bin");
+    insert_records(state, 1);
+    check_spans(state, 16);
+#endif
+}
+
+void test_stream_read_ending_on_page_boundary(void) {
+    config = CONFIG_PLAIN;
+    state = init_state(config, "build/artifacts/varFile.bin");
+    insert_records(state, 1);
+
+    uint32_t key = 1;
+    int32_t data;
+    embedDBVarDataStream stream;
+    TEST_ASSERT_EQUAL_INT8(0, embedDBGetVarInto(state, &key, &data, &stream));
+
+    /* The first read stops at the end of the page and the second continues after the header of the next page */
+    uint8_t expected[MAX_BLOB_SIZE], actual[MAX_BLOB_SIZE];
+    make_blob(key, expected);
+    uint32_t firstLength = state->pageSize - stream.dataStart % state->pageSize;
+    TEST_ASSERT_EQUAL_UINT32(firstLength, embedDBVarDataStreamRead(state, &stream, actual, firstLength));
+    TEST_ASSERT_EQUAL_UINT32(blob_length(key) - firstLength, embedDBVarDataStreamRead(state, &stream, actual + firstLength, MAX_BLOB_SIZE));
+    TEST_ASSERT_EQUAL_MEMORY(expected, actual, blob_length(key));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_bulk_put_writes_same_pages_as_put);
+    RUN_TEST(test_bulk_put_without_gather_write_stages_pages);
+    RUN_TEST(test_spans_from_var_read_buffer);
+    RUN_TEST(test_spans_from_buffer_pool);
+    RUN_TEST(test_spans_from_borrowed_pages);
+    RUN_TEST(test_stream_read_ending_on_page_boundary);
+    return UNITY_END();
+}
+
+/* Odd keys have large blobs, every fifth even key has none and the others have small ones */
+uint32_t blob_length(uint32_t key) {
+    if (key % 2 == 1)
+        return 2000 + key * 31;
+    return key % 10 == 0 ? 0 : 20 + key;
+}
+
+void make_blob(uint32_t key, uint8_t* blob) {
+    for (uint32_t i = 0; i < blob_length(key); i++)
+        blob[i] = (uint8_t)(key * 31 + i * 7);
+}
+
+void insert_records(embedDBState* state, int8_t bulk) {
+#if defined(__unix__) || defined(__APPLE__)
+    /* The blob is read-only, so writing to it would crash */
+    uint8_t* blob = mmap(NULL, MAX_BLOB_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    TEST_ASSERT_TRUE(blob != MAP_FAILED);
+#else
+    uint8_t* blob = malloc(MAX_BLOB_SIZE);
+#endif
+    for (uint32_t key = 0; key < NUM_RECORDS; key++) {
+        int32_t data = (int32_t)key;
+        uint32_t length = blob_length(key);
+#if defined(__unix__) || defined(__APPLE__)
+        TEST_ASSERT_EQUAL_INT(0, mprotect(blob, MAX_BLOB_SIZE, PROT_READ | PROT_WRITE));
+        make_blob(key, blob);
+        TEST_ASSERT_EQUAL_INT(0, mprotect(blob, MAX_BLOB_SIZE, PROT_READ));
+#else
+        make_blob(key, blob);
+#endif
+        void* varData = length == 0 ? NULL : blob;
+        if (bulk) {
+            TEST_ASSERT_EQUAL_INT8(0, embedDBPutVarBulk(state, &key, &data, varData, length));
+        } else {
+            TEST_ASSERT_EQUAL_INT8(0, embedDBPutVar(state, &key, &data, varData, length));
+        }
+    }
+#if defined(__unix__) || defined(__APPLE__)
+    munmap(blob, MAX_BLOB_SIZE);
+#else
+    free(blob);
+#endif
+}
+
+/* Checks that both var files hold the same pages */
+void check_same_var_pages(embedDBState* state1, embedDBState* state2) {
+    uint8_t page1[512], page2[512];
+    for (uint32_t i = 0; i < state2->nextVarPageId; i++) {
+        TEST_ASSERT_EQUAL_INT8(1, state1->fileInterface->read(page1, i, 512, state1->varFile));
+        TEST_ASSERT_EQUAL_INT8(1, state2->fileInterface->read(page2, i, 512, state2->varFile));
+        TEST_ASSERT_EQUAL_MEMORY(page1, page2, 512);
+    }
+}
+
+/* Checks the variable data of every record read as spans, with at most maxSpansPerCall spans from each call */
+void check_spans(embedDBState* state, uint32_t maxSpansPerCall) {
+    uint8_t expected[MAX_BLOB_SIZE];
+    embedDBVarDataSpan spans[16];
+    for (uint32_t key = 0; key < NUM_RECORDS; key++) {
+        int32_t data;
+        embedDBVarDataStream stream;
+        TEST_ASSERT_EQUAL_INT8(0, embedDBGetVarInto(state, &key, &data, &stream));
+        TEST_ASSERT_EQUAL_INT32(key, data);
+        TEST_ASSERT_EQUAL_UINT32(blob_length(key), stream.totalBytes);
+        make_blob(key, expected);
+
+        uint32_t numRead = 0, numSpans;
+        while ((numSpans = embedDBVarDataStreamSpans(state, &stream, spans, 16)) > 0) {
+            TEST_ASSERT_TRUE(numSpans <= maxSpansPerCall);
+            /* Every span of a call is still valid once the call returns */
+            for (uint32_t i = 0; i < numSpans; i++) {
+                TEST_ASSERT_TRUE(spans[i].offset >= state->variableDataHeaderSize);
+                TEST_ASSERT_TRUE(spans[i].offset + spans[i].length <= state->pageSize);
+                TEST_ASSERT_EQUAL_MEMORY(expected + numRead, (int8_t*)spans[i].page + spans[i].offset, spans[i].length);
+                numRead += spans[i].length;
+            }
+        }
+        TEST_ASSERT_EQUAL_UINT32(blob_length(key), numRead);
+    }
+}
+
+void free_state(embedDBState* state, uint8_t config) {
+    embedDBClose(state);
+#if defined(__unix__) || defined(__APPLE__)
+    if (config == CONFIG_MMAP) {
+        tearDownMmapFile(state->dataFile);
+        tearDownMmapFile(state->varFile);
+    } else
+#endif
+    {
+        tearDownFile(state->dataFile);
+        tearDownFile(state->varFile);
+    }
+    free(state->fileInterface);
+    free(state->buffer);
+    free(state);
+}
+
+/* Function returns a pointer to a newly created embedDBState with variable data */
+embedDBState* init_state(uint8_t config, char* varPath) {
+    embedDBState* state = (embedDBState*)malloc(sizeof(embedDBState));
+    if (state == NULL) {
+        printf("Unable to allocate state. Exiting\n");
+        exit(0);
+    }
+    state->keySize = 4;
+    state->dataSize = 4;
+    state->pageSize = 512;
+    state->numSplinePoints = 300;
+    state->bitmapSize = 0;
+    state->bufferSizeInBlocks = config == CONFIG_BUFFER_POOL ? 12 : 4;
+    state->buffer = calloc(1, (size_t)state->bufferSizeInBlocks * state->pageSize);
+    if (state->buffer == NULL) {
+        printf("Unable to allocate buffer. Exiting\n");
+        exit(0);
+    }
+    state->numDataPages = 64;
+    state->numVarPages = NUM_VAR_PAGES;
+    state->eraseSizeInPages = 4;
+    char dataPath[] = "build/artifacts/dataFile.bin";
+#if defined(__unix__) || defined(__APPLE__)
+    if (config == CONFIG_MMAP) {
+        state->fileInterface = getMmapFileInterface();
+        state->dataFile = setupMmapFile(dataPath, state->numDataPages, state->pageSize);
+        state->varFile = setupMmapFile(varPath, state->numVarPages, state->pageSize);
+    } else
+#endif
+    {
+        state->fileInterface = getFileInterface();
+        state->dataFile = setupFile(dataPath);
+        state->varFile = setupFile(varPath);
+    }
+    state->parameters = EMBEDDB_USE_VDATA | EMBEDDB_RESET_DATA;
+    if (config == CONFIG_BUFFER_POOL)
+        state->parameters |= EMBEDDB_USE_BUFFER_POOL;
+    state->compareKey = int32Comparator;
+    state->compareData = int32Comparator;
+
+    size_t splineMaxError = 1;
+    TEST_ASSERT_EQUAL_INT8(0, embedDBInit(state, splineMaxError));
+    return state;
+}
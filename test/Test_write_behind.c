@@ -0,0 +1,235 @@
+#include <stdio.h>
+
+#include "../Unity/src/unity.h"
+#include "../src/embedDB/embedDB.h"
+#include "../src/embedDB/utilityFunctions.h"
+
+#define NUM_DATA_PAGES 64
+#define NUM_PENDING_PAGES 4
+#define PAGE_SIZE 512
+
+/* In-memory file used under the write-behind file so writes can be counted */
+typedef struct {
+    int8_t pages[NUM_DATA_PAGES * PAGE_SIZE];
+    uint32_t numPages;
+    uint32_t numWrites;
+    int8_t failWrites;
+} RAM_FILE;
+
+embedDBState* init_state(int8_t background);
+void free_state(embedDBState* state);
+void insert_records(embedDBState* state, uint32_t startKey, uint32_t numRecords);
+embedDBFileInterface* getRamFileInterface();
+
+// global variable for state. Use in setUp() function and tearDown()
+embedDBState* state;
+embedDBFileInterface* ramInterface;
+RAM_FILE ramFile;
+
+void setUp(void) {
+    ramInterface = getRamFileInterface();
+    memset(&ramFile, 0, sizeof(RAM_FILE));
+    state = NULL;
+}
+
+void tearDown(void) {
+    if (state != NULL)
+        free_state(state);
+    free(ramInterface);
+    state = NULL;
+}
+
+void test_pages_are_queued_until_polled(void) {
+    state = init_state(0);
+    TEST_ASSERT_NOT_NULL(state);
+    uint32_t recordsPerPage = state->maxRecordsPerPage;
+
+    /* Three full pages fit in the ring and are not written yet */
+    insert_records(state, 0, recordsPerPage * 3 + 1);
+    TEST_ASSERT_EQUAL_UINT32(0, ramFile.numWrites);
+
+    /* Reads of queued pages are served from the ring */
+    int32_t data[3];
+    uint32_t key = recordsPerPage + 2;
+    TEST_ASSERT_EQUAL_INT8(0, embedDBGet(state, &key, data));
+    TEST_ASSERT_EQUAL_INT32(key + 100, data[0]);
+
+    TEST_ASSERT_EQUAL_INT8(1, writeBehindPoll(state->dataFile));
+    TEST_ASSERT_EQUAL_UINT32(1, ramFile.numWrites);
+
+    /* Flush is the barrier that writes everything that is queued */
+    TEST_ASSERT_EQUAL_INT8(0, embedDBFlush(state));
+    TEST_ASSERT_EQUAL_UINT32(4, ramFile.numWrites);
+    TEST_ASSERT_EQUAL_INT8(0, writeBehindPoll(state->dataFile));
+}
+
+void test_full_ring_writes_oldest_page(void) {
+    state = init_state(0);
+    TEST_ASSERT_NOT_NULL(state);
+    uint32_t recordsPerPage = state->maxRecordsPerPage;
+
+    insert_records(state, 0, recordsPerPage * (NUM_PENDING_PAGES + 2) + 1);
+    TEST_ASSERT_EQUAL_UINT32(2, ramFile.numWrites);
+
+    int32_t data[3];
+    for (uint32_t key = 0; key < recordsPerPage * (NUM_PENDING_PAGES + 2); key += 5) {
+        TEST_ASSERT_EQUAL_INT8(0, embedDBGet(state, &key, data));
+        TEST_ASSERT_EQUAL_INT32(key + 100, data[0]);
+    }
+}
+
+void test_background_thread_writes_pages(void) {
+#if defined(__unix__) || defined(__APPLE__)
+    state = init_state(1);
+    TEST_ASSERT_NOT_NULL(state);
+    uint32_t recordsPerPage = state->maxRecordsPerPage;
+    uint32_t numRecords = recordsPerPage * 30;
+
+    insert_records(state, 0, numRecords);
+
+    /* Only the background thread writes pages, so polling does nothing */
+    TEST_ASSERT_EQUAL_INT8(0, writeBehindPoll(state->dataFile));
+    TEST_ASSERT_EQUAL_INT8(0, embedDBFlush(state));
+    TEST_ASSERT_EQUAL_UINT32(30, ramFile.numWrites);
+
+    embedDBIterator it;
+    it.minKey = NULL;
+    it.maxKey = NULL;
+    it.minData = NULL;
+    it.maxData = NULL;
+    embedDBInitIterator(state, &it);
+
+    uint32_t key = 0, expectedKey = 0;
+    int32_t data[3];
+    while (embedDBNext(state, &it, &key, data)) {
+        TEST_ASSERT_EQUAL_UINT32(expectedKey, key);
+        TEST_ASSERT_EQUAL_INT32(expectedKey + 100, data[0]);
+        expectedKey++;
+    }
+    TEST_ASSERT_EQUAL_UINT32(numRecords, expectedKey);
+    embedDBCloseIterator(&it);
+#else
+    TEST_IGNORE_MESSAGE("Background writes are not supported on this platform.");
+#endif
+}
+
+void test_failed_write_is_reported_by_flush(void) {
+    state = init_state(0);
+    TEST_ASSERT_NOT_NULL(state);
+    ramFile.failWrites = 1;
+
+    insert_records(state, 0, state->maxRecordsPerPage * 2 + 1);
+    TEST_ASSERT_NOT_EQUAL(0, embedDBFlush(state));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_pages_are_queued_until_polled);
+    RUN_TEST(test_full_ring_writes_oldest_page);
+    RUN_TEST(test_background_thread_writes_pages);
+    RUN_TEST(test_failed_write_is_reported_by_flush);
+    return UNITY_END();
+}
+
+void insert_records(embedDBState* state, uint32_t startKey, uint32_t numRecords) {
+    int32_t data[3] = {0, 0, 0};
+    for (uint32_t key = startKey; key < startKey + numRecords; key++) {
+        data[0] = key + 100;
+        TEST_ASSERT_EQUAL_INT8(0, embedDBPut(state, &key, data));
+    }
+}
+
+void free_state(embedDBState* state) {
+    embedDBClose(state);
+    tearDownWriteBehindFile(state->dataFile);
+    free(state->fileInterface);
+    free(state->buffer);
+    free(state);
+}
+
+/* Function returns a pointer to a newly created embedDBState writing through a write-behind file, or NULL if embedDB failed to initialize */
+embedDBState* init_state(int8_t background) {
+    embedDBState* state = (embedDBState*)malloc(sizeof(embedDBState));
+    if (state == NULL) {
+        printf("Unable to allocate state. Exiting\n");
+        exit(0);
+    }
+    state->keySize = 4;
+    state->dataSize = 12;
+    state->pageSize = PAGE_SIZE;
+    state->numSplinePoints = 300;
+    state->bitmapSize = 0;
+    state->bufferSizeInBlocks = 2;
+    state->buffer = malloc((size_t)state->bufferSizeInBlocks * state->pageSize);
+    if (state->buffer == NULL) {
+        printf("Unable to allocate buffer. Exiting\n");
+        exit(0);
+    }
+    state->numDataPages = NUM_DATA_PAGES;
+    state->eraseSizeInPages = 4;
+    state->fileInterface = getWriteBehindFileInterface();
+    state->dataFile = setupWriteBehindFile(ramInterface, &ramFile, NUM_PENDING_PAGES, state->pageSize, background);
+    state->parameters = EMBEDDB_RESET_DATA;
+    state->compareKey = int32Comparator;
+    state->compareData = int32Comparator;
+
+    size_t splineMaxError = 1;
+    if (state->dataFile == NULL || embedDBInit(state, splineMaxError) != 0) {
+        if (state->dataFile != NULL)
+            tearDownWriteBehindFile(state->dataFile);
+        free(state->fileInterface);
+        free(state->buffer);
+        free(state);
+        return NULL;
+    }
+
+    embedDBResetStats(state);
+    return state;
+}
+
+int8_t RAM_READ(void* buffer, uint32_t pageNum, uint32_t pageSize, void* file) {
+    RAM_FILE* ram = (RAM_FILE*)file;
+    if (pageNum >= ram->numPages)
+        return 0;
+    memcpy(buffer, ram->pages + pageNum * pageSize, pageSize);
+    return 1;
+}
+
+int8_t RAM_WRITE(void* buffer, uint32_t pageNum, uint32_t pageSize, void* file) {
+    RAM_FILE* ram = (RAM_FILE*)file;
+    if (ram->failWrites || pageNum >= NUM_DATA_PAGES)
+        return 0;
+    memcpy(ram->pages + pageNum * pageSize, buffer, pageSize);
+    if (pageNum >= ram->numPages)
+        ram->numPages = pageNum + 1;
+    ram->numWrites++;
+    return 1;
+}
+
+int8_t RAM_OPEN(void* file, uint8_t mode) {
+    RAM_FILE* ram = (RAM_FILE*)file;
+    if (mode == EMBEDDB_FILE_MODE_W_PLUS_B)
+        ram->numPages = 0;
+    return 1;
+}
+
+int8_t RAM_CLOSE(void* file) {
+    return 1;
+}
+
+int8_t RAM_FLUSH(void* file) {
+    return 1;
+}
+
+embedDBFileInterface* getRamFileInterface() {
+    embedDBFileInterface* fileInterface = malloc(sizeof(embedDBFileInterface));
+    fileInterface->close = RAM_CLOSE;
+    fileInterface->read = RAM_READ;
+    fileInterface->write = RAM_WRITE;
+    fileInterface->open = RAM_OPEN;
+    fileInterface->flush = RAM_FLUSH;
+    fileInterface->borrow = NULL;
+    fileInterface->readMany = NULL;
+    fileInterface->writeGather = NULL;
+    return fileInterface;
+}
@@ -0,0 +1,201 @@
+#include <stdio.h>
+
+#include "../Unity/src/unity.h"
+#include "../src/embedDB/embedDB.h"
+#include "../src/embedDB/utilityFunctions.h"
+
+embedDBState* init_state(uint32_t parameters);
+void free_state(embedDBState* state);
+int32_t make_data(uint32_t key);
+void insert_records(embedDBState* state, uint32_t firstKey, uint32_t numRecords);
+uint32_t query_hot_records(embedDBState* state, uint32_t numRecords);
+
+// global variable for state. Use in setUp() function and tearDown()
+embedDBState* state;
+
+/* Readings are below 770, the largest bucket of the 16 bit bitmap, except for a few hot spots */
+#define HOT_VALUE 1200
+#define HOT_MIN 1000
+
+void setUp(void) {
+    state = NULL;
+}
+
+void tearDown(void) {
+    if (state != NULL)
+        free_state(state);
+    state = NULL;
+}
+
+void test_zone_map_skips_index_pages(void) {
+    uint32_t numRecords = 150000;
+    uint32_t numIdxReads[2];
+    uint32_t parameters[] = {EMBEDDB_USE_INDEX | EMBEDDB_USE_BMAP | EMBEDDB_RESET_DATA,
+                             EMBEDDB_USE_INDEX | EMBEDDB_USE_BMAP | EMBEDDB_USE_ZONE_MAP | EMBEDDB_RESET_DATA};
+    for (uint8_t z = 0; z < 2; z++) {
+        state = init_state(parameters[z]);
+        insert_records(state, 0, numRecords);
+        TEST_ASSERT_TRUE(state->nextIdxPageId >= 8);
+
+        uint32_t idxReads = state->numIdxReads;
+        query_hot_records(state, numRecords);
+        numIdxReads[z] = state->numIdxReads - idxReads;
+        free_state(state);
+        state = NULL;
+    }
+
+    /* Without the zone map every index page on file is read. With it only the index pages of the hot spots are */
+    TEST_ASSERT_TRUE(numIdxReads[0] >= 8);
+    TEST_ASSERT_TRUE(numIdxReads[1] <= 5);
+}
+
+void test_zone_map_uses_data_range_and_is_rebuilt_on_recovery(void) {
+    uint32_t numRecords = 50000;
+    state = init_state(EMBEDDB_USE_INDEX | EMBEDDB_USE_SUM | EMBEDDB_USE_MAX_MIN | EMBEDDB_USE_ZONE_MAP | EMBEDDB_RESET_DATA);
+    insert_records(state, 0, numRecords);
+    TEST_ASSERT_EQUAL_INT8(0, embedDBFlush(state));
+
+    uint32_t numReads = state->numReads;
+    query_hot_records(state, numRecords);
+    uint32_t liveReads = state->numReads - numReads;
+    free_state(state);
+
+    state = init_state(EMBEDDB_USE_INDEX | EMBEDDB_USE_SUM | EMBEDDB_USE_MAX_MIN | EMBEDDB_USE_ZONE_MAP);
+    TEST_ASSERT_NOT_NULL(state);
+    numReads = state->numReads;
+    query_hot_records(state, numRecords);
+    TEST_ASSERT_EQUAL_UINT32(liveReads, state->numReads - numReads);
+    TEST_ASSERT_TRUE(liveReads < 30);
+}
+
+void test_zone_map_after_flush_and_recovery(void) {
+    state = init_state(EMBEDDB_USE_INDEX | EMBEDDB_USE_BMAP | EMBEDDB_USE_ZONE_MAP | EMBEDDB_RESET_DATA);
+    /* Flushing writes short index pages */
+    uint32_t numRecords = 0;
+    for (uint8_t i = 0; i < 5; i++) {
+        insert_records(state, numRecords, 7000);
+        numRecords += 7000;
+        TEST_ASSERT_EQUAL_INT8(0, embedDBFlush(state));
+    }
+    query_hot_records(state, numRecords);
+    free_state(state);
+
+    state = init_state(EMBEDDB_USE_INDEX | EMBEDDB_USE_BMAP | EMBEDDB_USE_ZONE_MAP);
+    TEST_ASSERT_NOT_NULL(state);
+    query_hot_records(state, numRecords);
+
+    /* Records inserted after recovery are found too */
+    insert_records(state, numRecords, 20000);
+    numRecords += 20000;
+    query_hot_records(state, numRecords);
+}
+
+void test_zone_map_requires_index(void) {
+    state = init_state(EMBEDDB_USE_BMAP | EMBEDDB_USE_ZONE_MAP | EMBEDDB_RESET_DATA);
+    TEST_ASSERT_NULL(state);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_zone_map_skips_index_pages);
+    RUN_TEST(test_zone_map_uses_data_range_and_is_rebuilt_on_recovery);
+    RUN_TEST(test_zone_map_after_flush_and_recovery);
+    RUN_TEST(test_zone_map_requires_index);
+    return UNITY_END();
+}
+
+int32_t make_data(uint32_t key) {
+    if (key % 25013 == 25000)
+        return HOT_VALUE;
+    return 400 + (int32_t)(key / 50 % 300);
+}
+
+void insert_records(embedDBState* state, uint32_t firstKey, uint32_t numRecords) {
+    for (uint32_t key = firstKey; key < firstKey + numRecords; key++) {
+        int32_t data = make_data(key);
+        TEST_ASSERT_EQUAL_INT8(0, embedDBPut(state, &key, &data));
+    }
+}
+
+/* Checks the iterator returns every hot record and returns the number found */
+uint32_t query_hot_records(embedDBState* state, uint32_t numRecords) {
+    int32_t minData = HOT_MIN;
+    embedDBIterator it;
+    it.minKey = NULL;
+    it.maxKey = NULL;
+    it.minData = &minData;
+    it.maxData = NULL;
+    embedDBInitIterator(state, &it);
+
+    uint32_t key, expected = 0, numFound = 0;
+    int32_t data;
+    while (embedDBNext(state, &it, &key, &data)) {
+        while (expected < numRecords && make_data(expected) < HOT_MIN)
+            expected++;
+        TEST_ASSERT_EQUAL_UINT32(expected, key);
+        TEST_ASSERT_EQUAL_INT32(HOT_VALUE, data);
+        expected++;
+        numFound++;
+    }
+    embedDBCloseIterator(&it);
+    TEST_ASSERT_EQUAL_UINT32(numRecords / 25013 + (numRecords % 25013 > 25000), numFound);
+    return numFound;
+}
+
+void free_state(embedDBState* state) {
+    embedDBClose(state);
+    tearDownFile(state->dataFile);
+    if (state->indexFile != NULL)
+        tearDownFile(state->indexFile);
+    free(state->fileInterface);
+    free(state->buffer);
+    free(state);
+}
+
+/* Function returns a pointer to a newly created embedDBState, or NULL if embedDB failed to initialize */
+embedDBState* init_state(uint32_t parameters) {
+    embedDBState* state = (embedDBState*)malloc(sizeof(embedDBState));
+    if (state == NULL) {
+        printf("Unable to allocate state. Exiting\n");
+        exit(0);
+    }
+    state->keySize = 4;
+    state->dataSize = 4;
+    state->pageSize = 512;
+    state->numSplinePoints = 300;
+    state->bitmapSize = EMBEDDB_USING_BMAP(parameters) ? 2 : 0;
+    state->inBitmap = inBitmapInt16;
+    state->updateBitmap = updateBitmapInt16;
+    state->buildBitmapFromRange = buildBitmapInt16FromRange;
+    state->bufferSizeInBlocks = 4;
+    state->buffer = calloc(1, (size_t)state->bufferSizeInBlocks * state->pageSize);
+    if (state->buffer == NULL) {
+        printf("Unable to allocate buffer. Exiting\n");
+        exit(0);
+    }
+    state->numDataPages = 4000;
+    state->numIndexPages = 48;
+    state->eraseSizeInPages = 4;
+    char dataPath[] = "build/artifacts/dataFile.bin";
+    char indexPath[] = "build/artifacts/indexFile.bin";
+    state->fileInterface = getFileInterface();
+    state->dataFile = setupFile(dataPath);
+    state->indexFile = EMBEDDB_USING_INDEX(parameters) ? setupFile(indexPath) : NULL;
+    state->sumColumnOffset = 0;
+    state->sumColumnSize = -4;
+    state->parameters = parameters;
+    state->compareKey = int32Comparator;
+    state->compareData = int32Comparator;
+
+    size_t splineMaxError = 1;
+    if (embedDBInit(state, splineMaxError) != 0) {
+        tearDownFile(state->dataFile);
+        if (state->indexFile != NULL)
+            tearDownFile(state->indexFile);
+        free(state->fileInterface);
+        free(state->buffer);
+        free(state);
+        return NULL;
+    }
+    return state;
+}